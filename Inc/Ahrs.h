@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Attitude of the rocket from the LSM9DS1 gyroscope, accelerometer and
+ * magnetometer, as a unit quaternion.
+ *
+ * A Mahony complementary filter: the gyroscope rates are integrated over
+ * the time step of each update. The IMU read job drains the LSM9DS1 FIFO
+ * and runs one update per sample, with the sample period it measures, see
+ * ReadAccelGyroMagnetism.c. The accelerometer pulls the estimate of up
+ * towards gravity and the magnetometer pulls the heading towards magnetic
+ * north, through a proportional gain. An integral gain learns the
+ * gyroscope bias while the rocket is at rest.
+ *
+ * The accelerometer only measures gravity at rest. Under thrust, drag or
+ * in free fall it is off 1 g by more than AHRS_ACCEL_GATE_G, or, with
+ * about 1 g of drag towards the tail in coast, more than
+ * AHRS_ACCEL_GATE_COS from the estimated up. The update then leaves it
+ * out, so in flight the tilt comes from the gyroscope alone, with the bias
+ * learnt on the pad. The magnetometer correction is
+ * in the horizontal plane and only moves the heading, so it stays on in
+ * flight. Its hard iron offset is not calibrated out.
+ *
+ * The tilt and angular rate are published in AccelGyroMagnetismData and
+ * logged. The specific force projected on the estimated up is published
+ * too, signed, for the altitude filter: in coast the drag pulls it below
+ * zero, where its magnitude would read the drag as a push up.
+ *
+ * Single precision throughout, for the FPU of the Cortex-M4. One update
+ * has a budget of AHRS_CYCLE_BUDGET cycles, part of the budget of the IMU
+ * job for each sample it drains. Tools/AhrsCheck checks the filter against
+ * synthetic rotations and measures the time per update.
+ */
+
+#define AHRS_CYCLE_BUDGET 2000 // Per update at 168 MHz, 12 us
+#define AHRS_ACCEL_GATE_G 0.1f
+#define AHRS_ACCEL_GATE_COS 0.985f // cos 10 deg, between the measured and the estimated up
+
+typedef struct
+{
+    float       q_[4]; // w, x, y, z, rotates body vectors into the local frame, Z up
+    float       gyroBias_[3]; // Integral term, rad/s, subtracted from the rates
+    float       tilt_; // Between the body Z axis and up, rad
+    float       angularRate_; // Magnitude of the bias corrected rates, rad/s
+    float       verticalAccel_; // Specific force along up, g, 1 at rest
+    uint8_t     initialized_; // The first accelerometer reading sets the tilt
+    uint32_t    updates_;
+    uint32_t    accelRejections_; // Updates with the accelerometer off 1 g or off up
+} Ahrs;
+
+/**
+ * Resets the filter. The first update with the accelerometer at 1 g sets
+ * the attitude directly.
+ */
+void ahrsInit(Ahrs* ahrs);
+
+/**
+ * One step of the filter, for one IMU sample.
+ *
+ * Params:
+ *   gyro - (float[3]) Angular rates, in rad/s
+ *   accel - (float[3]) Specific force, in g
+ *   magneto - (float[3]) Magnetic field, any unit. NULL or all zero to leave it out
+ *   dt - (float) Time since the previous sample, in s
+ */
+void ahrsUpdate(Ahrs* ahrs, const float* gyro, const float* accel, const float* magneto, float dt);
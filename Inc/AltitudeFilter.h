@@ -0,0 +1,171 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "BarometricAltitude.h"
+
+/**
+ * Altitude, vertical velocity and vertical acceleration of the rocket.
+ *
+ * altitudeFilterStep runs the accelerometer and barometer filter once per
+ * parachute control period, with the time step taken from the sample
+ * times. A GNSS fix is an extra measurement of altitude and, from NAV-PVT,
+ * vertical velocity, applied by altitudeFilterGnss whenever one arrives.
+ * The accelerometer input is the specific force along up of the attitude
+ * filter of Ahrs.h, signed, so the drag of a coast decelerates.
+ *
+ * A fix reaches the filter well after its navigation epoch. The receiver
+ * needs time to compute it and to send it, and the filter runs later
+ * still. The filter keeps the states of its last
+ * ALTITUDE_FILTER_HISTORY_LENGTH steps. A fix is compared with the state
+ * at its own epoch. The correction is then carried forward over the
+ * delay, to the current state and to the history, with the same
+ * kinematics as the prediction.
+ *
+ * The GNSS altitude also takes out the offset of the barometric altitude.
+ * Launch day weather moves the offset, and so does the sea level pressure
+ * the filter assumes. While fixes keep arriving, barometer readings far
+ * from the state are taken as disturbances and skipped. Transonic flow
+ * and ejection charges cause such disturbances. Without GNSS the filter
+ * trusts the barometer as before.
+ *
+ * The barometric altitude comes from the table of BarometricAltitude.h,
+ * rescaled to the sea level pressure of the filter. ParachutesControl.c
+ * sets it on the pad from the averaged pad pressure and the known pad
+ * altitude.
+ *
+ * The gain of the accelerometer and barometer is the steady state Kalman
+ * gain of the noise model of AltitudeFilterGain.h at the time step of each
+ * step, so a faster accelerometer or barometer, or a late step, gets the
+ * gain of its own rate. Tools/AltitudeFilterGainGen solves the Riccati
+ * equation at build time for time steps from
+ * ALTITUDE_FILTER_TABLE_MIN_STEP_US to ALTITUDE_FILTER_TABLE_MAX_STEP_US,
+ * in the segments per octave of the pressure table, into
+ * AltitudeFilterGainTable.h. A step finds its segment with a count of
+ * leading zeros and interpolates the gain linearly, without any matrix
+ * arithmetic.
+ */
+
+#define ALTITUDE_FILTER_HISTORY_LENGTH 16 // 750 ms at the parachute control period
+#define ALTITUDE_FILTER_MAX_OUTLIERS 10 // 1 s of fixes at 10 Hz
+
+struct KalmanStateVector
+{
+    double altitude;
+    double velocity;
+    double acceleration;
+};
+
+/**
+ * A GNSS fix, in the units of the filter.
+ */
+typedef struct
+{
+    double      altitude_; // Above mean sea level, m
+    double      velocity_; // Up, m/s
+    double      accuracy_; // Vertical, m
+    uint8_t     hasVelocity_; // NAV-PVT, not GGA
+    uint32_t    sampleTimeUs_; // Navigation epoch
+} GnssMeasurement;
+
+typedef enum
+{
+    GNSS_APPLIED = 0,
+    GNSS_INACCURATE,        // Accuracy worse than the filter accepts
+    GNSS_TOO_OLD,           // Older than the history, or before the first step
+    GNSS_OUTLIER            // Too far from the state, see altitudeFilterGnss
+} GnssUpdateResult;
+
+typedef struct
+{
+    struct KalmanStateVector    state_;
+    double                      barometerAltitude_; // Before the offset, m
+    uint8_t                     barometerUsed_; // 0 if skipped as a disturbance
+    uint32_t                    sampleTimeUs_;
+} AltitudeFilterEntry;
+
+typedef struct
+{
+    struct KalmanStateVector    state_; // Latest step
+    uint32_t                    sampleTimeUs_; // Of the latest step
+    uint32_t                    steps_;
+    int32_t                     pressure_; // Of the latest step, 100*millibars
+    double                      baroOffset_; // Added to the barometric altitude, m
+    BarometricReference         barometer_; // Sea level pressure
+    const double                (*gain_)[2]; // Fixed by altitudeFilterSetGain, NULL for the table
+    AltitudeFilterEntry         history_[ALTITUDE_FILTER_HISTORY_LENGTH];
+    uint8_t                     historyNext_;
+    uint8_t                     historyCount_;
+    uint8_t                     hasGnss_;
+    uint8_t                     gnssOutliers_; // In a row
+    uint32_t                    gnssTimeUs_; // Epoch of the last fix applied
+    uint32_t                    gnssUpdates_;
+    uint32_t                    gnssRejections_;
+    uint32_t                    baroRejections_;
+} AltitudeFilter;
+
+/**
+ * One step of the accelerometer and barometer filter.
+ *
+ * Params:
+ *   oldState - (KalmanStateVector) Past altitude, velocity and acceleration
+ *   barometer - (BarometricReference*) Sea level pressure of the barometric altitude
+ *   currentAccel - (int32_t) Measured specific force along up, in mg, 1000 at
+ *                  rest and below zero with the drag of a coast, see Ahrs.h
+ *   currentPressure - (int32_t) Measured pressure, in 100*millibars
+ *   dtMillis - (double) Time since last step, which picks the gain. In ms.
+ *
+ * Returns:
+ *   newState - (KalmanStateVector) Current altitude, velocity and acceleration
+ */
+struct KalmanStateVector filterSensors(
+    struct KalmanStateVector oldState,
+    const BarometricReference* barometer,
+    int32_t currentAccel,
+    int32_t currentPressure,
+    double dtMillis
+);
+
+/**
+ * Starts the filter at rest at the given altitude, in m.
+ */
+void altitudeFilterInit(AltitudeFilter* filter, double altitude);
+
+/**
+ * Rescales the barometric altitude to the sea level pressure of the launch
+ * site, in 100*millibars. Takes one pow, so not for every step. After the
+ * first step the altitude of the state and the history moves by the change
+ * of the barometric altitude of the latest reading, so the change is not
+ * an innovation.
+ */
+void altitudeFilterSetSeaLevelPressure(AltitudeFilter* filter, double seaLevelPressure);
+
+/**
+ * Fixes the 3x2 gain of the barometer and accelerometer innovations for
+ * every time step, in place of the table after altitudeFilterInit. NULL
+ * goes back to the table. For the host tools that try other gains; the
+ * gain is not copied.
+ */
+void altitudeFilterSetGain(AltitudeFilter* filter, const double (*gain)[2]);
+
+/**
+ * filterSensors with the offset and the disturbance check applied, then
+ * stored in the history. The first step takes defaultStepMillis as its
+ * time step. After that the step is the time between accelerometer sample
+ * times, and the gain is the one of the table for it.
+ */
+void altitudeFilterStep(
+    AltitudeFilter* filter,
+    int32_t currentAccel,
+    int32_t currentPressure,
+    uint32_t accelSampleTimeUs,
+    double defaultStepMillis
+);
+
+/**
+ * Applies a fix at its epoch. An altitude beyond the outlier gate is
+ * rejected. After ALTITUDE_FILTER_MAX_OUTLIERS rejections in a row the fix
+ * is applied anyway: by then the filter is more likely to be wrong than
+ * the receiver.
+ */
+GnssUpdateResult altitudeFilterGnss(AltitudeFilter* filter, const GnssMeasurement* measurement);
@@ -0,0 +1,29 @@
+#pragma once
+
+/**
+ * Generated by Tools/KalmanTuner, do not edit.
+ *
+ * Noise model and steady state gain of the accelerometer and barometer
+ * filter of AltitudeFilter.c, a constant acceleration model driven by
+ * white jerk that measures altitude and acceleration. Tuned over 200
+ * simulated flights, seed 1, and 0 logs for the least altitude RMS plus
+ * 100 m per s of the RMS error of the drogue time against apogee.
+ *   this gain:     altitude RMS 23.393 m, apogee RMS 27.3 ms, cost 26.122
+ *   previous gain: altitude RMS 22.930 m, apogee RMS 53.2 ms, cost 28.254
+ *
+ * Tools/AltitudeFilterGainGen tabulates the gain of this noise model by
+ * time step in AltitudeFilterGainTable.h, which the filter uses.
+ * ALTITUDE_FILTER_GAIN is the gain at the step it was tuned for.
+ */
+
+#define ALTITUDE_FILTER_GAIN_STEP 0.05 // s, the parachute control period
+#define ALTITUDE_FILTER_JERK_NOISE 341.455 // Spectral density, m^2/s^5
+#define ALTITUDE_FILTER_BAROMETER_NOISE 1 // m
+#define ALTITUDE_FILTER_ACCEL_NOISE 0.316228 // m/s^2
+
+#define ALTITUDE_FILTER_GAIN \
+{ \
+    {0.0755391301, 0.000396239422}, \
+    {0.0593223419, 0.0251191669}, \
+    {3.96239422e-05, 0.994210321} \
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+/**
+ * Generated by Tools/AltitudeFilterGainGen, do not edit.
+ *
+ * Steady state gain of the noise model of AltitudeFilterGain.h, at 16
+ * uniform segments per octave of time step from 1024 to 262144 us.
+ * Entry i * 16 + j is at 2^(10 + i) * (1 + j / 16) us, and holds the
+ * altitude, velocity and acceleration rows of the barometer and
+ * accelerometer columns.
+ * Largest linear interpolation error: 8.32e-05
+ */
+
+#define ALTITUDE_FILTER_TABLE_FIRST_OCTAVE 10
+#define ALTITUDE_FILTER_TABLE_SEGMENT_BITS 4
+#define ALTITUDE_FILTER_TABLE_SEGMENTS 16
+#define ALTITUDE_FILTER_TABLE_MIN_STEP_US 1024
+#define ALTITUDE_FILTER_TABLE_MAX_STEP_US 262144
+
+static const float ALTITUDE_FILTER_GAIN_TABLE[129][3][2] =
+{
+    {{0.000867741357f, 3.84823323e-07f}, {0.000367823173f, 0.000608456146f}, {3.84823871e-08f, 0.811608791f}}, // 1024 us
+    {{0.000925181957f, 4.22227231e-07f}, {0.000393546768f, 0.000642295287f}, {4.2222787e-08f, 0.819309831f}}, // 1088 us
+    {{0.000982963946f, 4.61041338e-07f}, {0.000419571705f, 0.000676000782f}, {4.61042013e-08f, 0.826387167f}}, // 1152 us
+    {{0.0010410822f, 5.01259649e-07f}, {0.000445895043f, 0.00070958701f}, {5.01260367e-08f, 0.832915664f}}, // 1216 us
+    {{0.00109953189f, 5.4287699e-07f}, {0.000472513842f, 0.00074306631f}, {5.42877814e-08f, 0.838958383f}}, // 1280 us
+    {{0.00115920627f, 5.85888358e-07f}, {0.000500200375f, 0.000776449393f}, {5.85889204e-08f, 0.844568849f}}, // 1344 us
+    {{0.00121740636f, 6.30291652e-07f}, {0.000526626769f, 0.000809745456f}, {6.30292547e-08f, 0.849792838f}}, // 1408 us
+    {{0.00127682195f, 6.76081584e-07f}, {0.000554115511f, 0.000842962647f}, {6.7608255e-08f, 0.85466975f}}, // 1472 us
+    {{0.00133655069f, 7.23255766e-07f}, {0.000581888889f, 0.00087610801f}, {7.23256832e-08f, 0.859233737f}}, // 1536 us
+    {{0.00139658828f, 7.71811528e-07f}, {0.000609944342f, 0.000909187831f}, {7.71812623e-08f, 0.863514543f}}, // 1600 us
+    {{0.00145693053f, 8.21746369e-07f}, {0.00063827954f, 0.000942207698f}, {8.21747577e-08f, 0.867538095f}}, // 1664 us
+    {{0.00151757349f, 8.73058184e-07f}, {0.000666891865f, 0.000975172501f}, {8.7305942e-08f, 0.8713274f}}, // 1728 us
+    {{0.00157851318f, 9.25744928e-07f}, {0.000695779047f, 0.0010080866f}, {9.25746306e-08f, 0.874902546f}}, // 1792 us
+    {{0.00163974578f, 9.79804895e-07f}, {0.000724938815f, 0.00104095403f}, {9.79806387e-08f, 0.878281474f}}, // 1856 us
+    {{0.00170126767f, 1.03523644e-06f}, {0.000754368783f, 0.00107377814f}, {1.03523796e-07f, 0.881480157f}}, // 1920 us
+    {{0.00176307512f, 1.09203802e-06f}, {0.000784066797f, 0.00110656233f}, {1.0920396e-07f, 0.884512842f}}, // 1984 us
+    {{0.00182516477f, 1.15020816e-06f}, {0.000814030762f, 0.00113930937f}, {1.15020988e-07f, 0.887392223f}}, // 2048 us
+    {{0.00195168832f, 1.27064743e-06f}, {0.000876104983f, 0.00120470207f}, {1.27064936e-07f, 0.892735898f}}, // 2176 us
+    {{0.00207627728f, 1.3965514e-06f}, {0.000936503464f, 0.00126997451f}, {1.39655342e-07f, 0.897590339f}}, // 2304 us
+    {{0.00220344099f, 1.52790551e-06f}, {0.000999282114f, 0.0013351416f}, {1.52790776e-07f, 0.902020276f}}, // 2432 us
+    {{0.00233164406f, 1.66470477e-06f}, {0.00106306851f, 0.00140021613f}, {1.66470727e-07f, 0.90607959f}}, // 2560 us
+    {{0.00246086344f, 1.80694269e-06f}, {0.00112784805f, 0.00146520871f}, {1.80694542e-07f, 0.909813285f}}, // 2688 us
+    {{0.0025910777f, 1.95461348e-06f}, {0.00119360699f, 0.0015301283f}, {1.95461638e-07f, 0.913259327f}}, // 2816 us
+    {{0.00272226543f, 2.10771145e-06f}, {0.00126033172f, 0.00159498281f}, {2.10771461e-07f, 0.916449904f}}, // 2944 us
+    {{0.00285440707f, 2.26623206e-06f}, {0.00132800918f, 0.00165977888f}, {2.26623541e-07f, 0.919412673f}}, // 3072 us
+    {{0.00298748328f, 2.43017007e-06f}, {0.00139662693f, 0.00172452233f}, {2.43017382e-07f, 0.922171235f}}, // 3200 us
+    {{0.00312147569f, 2.59952139e-06f}, {0.00146617298f, 0.00178921828f}, {2.59952543e-07f, 0.924746096f}}, // 3328 us
+    {{0.00325636682f, 2.77428171e-06f}, {0.00153663545f, 0.00185387116f}, {2.77428597e-07f, 0.927155256f}}, // 3456 us
+    {{0.00339213968f, 2.95444693e-06f}, {0.00160800328f, 0.00191848469f}, {2.95445119e-07f, 0.929414153f}}, // 3584 us
+    {{0.00352877774f, 3.14001295e-06f}, {0.00168026541f, 0.0019830626f}, {3.14001767e-07f, 0.931536496f}}, // 3712 us
+    {{0.00366626563f, 3.33097637e-06f}, {0.00175341137f, 0.00204760768f}, {3.33098114e-07f, 0.933534443f}}, // 3840 us
+    {{0.00380458822f, 3.52733309e-06f}, {0.00182743079f, 0.00211212249f}, {3.52733821e-07f, 0.935418606f}}, // 3968 us
+    {{0.00394373108f, 3.72907971e-06f}, {0.0019023139f, 0.00217661005f}, {3.72908517e-07f, 0.93719846f}}, // 4096 us
+    {{0.00422442099f, 4.14872875e-06f}, {0.00205463264f, 0.00230551022f}, {4.14873483e-07f, 0.940478265f}}, // 4352 us
+    {{0.00450822944f, 4.58989598e-06f}, {0.00221029413f, 0.00243432331f}, {4.58990286e-07f, 0.943431437f}}, // 4608 us
+    {{0.00479505677f, 5.05255503e-06f}, {0.00236922852f, 0.00256306096f}, {5.05256253e-07f, 0.946104586f}}, // 4864 us
+    {{0.00508480985f, 5.53667905e-06f}, {0.00253137015f, 0.00269173342f}, {5.53668713e-07f, 0.94853586f}}, // 5120 us
+    {{0.0053774016f, 6.04224306e-06f}, {0.00269665662f, 0.0028203486f}, {6.04225193e-07f, 0.950756729f}}, // 5376 us
+    {{0.00567275006f, 6.56922066e-06f}, {0.00286502857f, 0.00294891372f}, {6.56923078e-07f, 0.952793479f}}, // 5632 us
+    {{0.0059707691f, 7.11758776e-06f}, {0.00303642126f, 0.00307743438f}, {7.1175981e-07f, 0.954668045f}}, // 5888 us
+    {{0.0062714112f, 7.68731752e-06f}, {0.00321080722f, 0.00320591568f}, {7.68732889e-07f, 0.956399202f}}, // 6144 us
+    {{0.00657458231f, 8.2783863e-06f}, {0.00338810892f, 0.00333436159f}, {8.27839813e-07f, 0.958002746f}}, // 6400 us
+    {{0.0068802149f, 8.89076819e-06f}, {0.00356827583f, 0.00346277608f}, {8.8907808e-07f, 0.959492385f}}, // 6656 us
+    {{0.00718826707f, 9.5244377e-06f}, {0.00375128142f, 0.00359116215f}, {9.52445134e-07f, 0.960879743f}}, // 6912 us
+    {{0.00749867037f, 1.01793694e-05f}, {0.00393707072f, 0.00371952238f}, {1.01793842e-06f, 0.962175131f}}, // 7168 us
+    {{0.00781136844f, 1.08555387e-05f}, {0.00412560115f, 0.00384785933f}, {1.08555548e-06f, 0.96338737f}}, // 7424 us
+    {{0.00812630728f, 1.15529201e-05f}, {0.00431683101f, 0.0039761751f}, {1.15529372e-06f, 0.964524209f}}, // 7680 us
+    {{0.00844343752f, 1.22714882e-05f}, {0.00451072073f, 0.0041044713f}, {1.22715062e-06f, 0.965592504f}}, // 7936 us
+    {{0.00876270887f, 1.30112167e-05f}, {0.00470723258f, 0.00423274981f}, {1.30112358e-06f, 0.966598272f}}, // 8192 us
+    {{0.00940749422f, 1.45540544e-05f}, {0.00510797463f, 0.00448925886f}, {1.45540753e-06f, 0.968442976f}}, // 8704 us
+    {{0.0100603132f, 1.61812259e-05f}, {0.00551877916f, 0.00474571204f}, {1.618125e-06f, 0.970094383f}}, // 9216 us
+    {{0.0107208444f, 1.78925238e-05f}, {0.00593938446f, 0.00500211725f}, {1.78925495e-06f, 0.971581459f}}, // 9728 us
+    {{0.0113887927f, 1.96877372e-05f}, {0.00636954792f, 0.00525848055f}, {1.96877659e-06f, 0.972927511f}}, // 10240 us
+    {{0.0120638814f, 2.15666532e-05f}, {0.00680904044f, 0.00551480753f}, {2.15666864e-06f, 0.974151731f}}, // 10752 us
+    {{0.0127458554f, 2.35290609e-05f}, {0.00725764688f, 0.00577110192f}, {2.35290963e-06f, 0.975269973f}}, // 11264 us
+    {{0.0134344762f, 2.55747418e-05f}, {0.00771516375f, 0.00602736743f}, {2.55747796e-06f, 0.976295412f}}, // 11776 us
+    {{0.0141295204f, 2.77034796e-05f}, {0.00818139873f, 0.00628360733f}, {2.77035224e-06f, 0.977239192f}}, // 12288 us
+    {{0.0148307793f, 2.99150561e-05f}, {0.00865617022f, 0.00653982302f}, {2.99150997e-06f, 0.978110611f}}, // 12800 us
+    {{0.0155380564f, 3.22092492e-05f}, {0.00913930498f, 0.00679601775f}, {3.22092978e-06f, 0.978917778f}}, // 13312 us
+    {{0.0162511673f, 3.45858389e-05f}, {0.00963063911f, 0.00705219246f}, {3.45858894e-06f, 0.979667485f}}, // 13824 us
+    {{0.0169699341f, 3.70445996e-05f}, {0.0101300143f, 0.00730834948f}, {3.70446537e-06f, 0.980365694f}}, // 14336 us
+    {{0.0176941957f, 3.95853021e-05f}, {0.0106372824f, 0.0075644888f}, {3.95853613e-06f, 0.98101753f}}, // 14848 us
+    {{0.018423792f, 4.22077283e-05f}, {0.0111522991f, 0.00782061275f}, {4.22077892e-06f, 0.981627464f}}, // 15360 us
+    {{0.0191585775f, 4.49116415e-05f}, {0.0116749275f, 0.0080767218f}, {4.49117078e-06f, 0.982199371f}}, // 15872 us
+    {{0.019898409f, 4.76968198e-05f}, {0.0122050354f, 0.00833281595f}, {4.76968899e-06f, 0.982736766f}}, // 16384 us
+    {{0.0213926807f, 5.35100262e-05f}, {0.0132871922f, 0.00884496514f}, {5.35101026e-06f, 0.983719766f}}, // 17408 us
+    {{0.0229056031f, 5.96454884e-05f}, {0.0143978158f, 0.0093570631f}, {5.96455766e-06f, 0.984596789f}}, // 18432 us
+    {{0.0244362615f, 6.61013182e-05f}, {0.0155360196f, 0.0098691145f}, {6.61014155e-06f, 0.985384107f}}, // 19456 us
+    {{0.0259838123f, 7.28756204e-05f}, {0.0167009793f, 0.0103811212f}, {7.28757232e-06f, 0.986094892f}}, // 20480 us
+    {{0.0275474824f, 7.99664631e-05f}, {0.0178919248f, 0.0108930832f}, {7.9966585e-06f, 0.986739695f}}, // 21504 us
+    {{0.0291265529f, 8.73719255e-05f}, {0.0191081278f, 0.0114050033f}, {8.73720546e-06f, 0.987327337f}}, // 22528 us
+    {{0.0307203569f, 9.50900503e-05f}, {0.0203489084f, 0.0119168796f}, {9.50901904e-06f, 0.98786515f}}, // 23552 us
+    {{0.0323282741f, 0.000103118873f}, {0.0216136239f, 0.012428713f}, {1.03119028e-05f, 0.988359153f}}, // 24576 us
+    {{0.0339497179f, 0.000111456415f}, {0.0229016617f, 0.0129405027f}, {1.11456575e-05f, 0.988814473f}}, // 25600 us
+    {{0.0355841517f, 0.000120100682f}, {0.0242124461f, 0.0134522486f}, {1.20100858e-05f, 0.98923552f}}, // 26624 us
+    {{0.0372310542f, 0.000129049673f}, {0.0255454257f, 0.0139639499f}, {1.29049868e-05f, 0.98962599f}}, // 27648 us
+    {{0.038889952f, 0.000138301373f}, {0.0269000772f, 0.0144756055f}, {1.38301575e-05f, 0.989989161f}}, // 28672 us
+    {{0.0405603833f, 0.00014785376f}, {0.0282758996f, 0.0149872135f}, {1.4785398e-05f, 0.990327775f}}, // 29696 us
+    {{0.0422419198f, 0.000157704795f}, {0.0296724159f, 0.0154987732f}, {1.57705035e-05f, 0.990644217f}}, // 30720 us
+    {{0.0439341515f, 0.000167852442f}, {0.031089168f, 0.0160102826f}, {1.67852704e-05f, 0.990940571f}}, // 31744 us
+    {{0.0456366912f, 0.000178294649f}, {0.0325257182f, 0.0165217426f}, {1.78294904e-05f, 0.991218746f}}, // 32768 us
+    {{0.0490712374f, 0.000200054463f}, {0.0354565345f, 0.0175444987f}, {2.00054765e-05f, 0.991726816f}}, // 34816 us
+    {{0.0525428057f, 0.000222967661f}, {0.038461674f, 0.0185670275f}, {2.22967992e-05f, 0.992179334f}}, // 36864 us
+    {{0.0560488813f, 0.000247017597f}, {0.0415381715f, 0.019589318f}, {2.47017961e-05f, 0.992584884f}}, // 38912 us
+    {{0.059587162f, 0.000272187463f}, {0.044683259f, 0.0206113514f}, {2.72187863e-05f, 0.992950439f}}, // 40960 us
+    {{0.0631555244f, 0.000298460422f}, {0.0478943475f, 0.0216331109f}, {2.98460873e-05f, 0.993281662f}}, // 43008 us
+    {{0.0667519942f, 0.000325819594f}, {0.0511689857f, 0.02265458f}, {3.25820074e-05f, 0.993583143f}}, // 45056 us
+    {{0.0703747571f, 0.000354247983f}, {0.0545048714f, 0.0236757416f}, {3.54248514e-05f, 0.993858695f}}, // 47104 us
+    {{0.0740220919f, 0.000383728591f}, {0.057899829f, 0.0246965773f}, {3.83729166e-05f, 0.994111598f}}, // 49152 us
+    {{0.0776924193f, 0.000414244365f}, {0.0613517836f, 0.0257170685f}, {4.14245005e-05f, 0.994344473f}}, // 51200 us
+    {{0.0813842416f, 0.000445778278f}, {0.0648587719f, 0.0267371964f}, {4.45778933e-05f, 0.994559646f}}, // 53248 us
+    {{0.0850961506f, 0.000478313217f}, {0.0684189126f, 0.0277569443f}, {4.78313923e-05f, 0.994759023f}}, // 55296 us
+    {{0.0888268277f, 0.000511832128f}, {0.0720304102f, 0.028776288f}, {5.11832877e-05f, 0.994944334f}}, // 57344 us
+    {{0.0925750136f, 0.000546317897f}, {0.0756915584f, 0.0297952127f}, {5.46318697e-05f, 0.995116949f}}, // 59392 us
+    {{0.0963395387f, 0.00058175344f}, {0.0794007108f, 0.030813694f}, {5.81754284e-05f, 0.99527818f}}, // 61440 us
+    {{0.100119278f, 0.000618121703f}, {0.0831562877f, 0.0318317153f}, {6.18122649e-05f, 0.995429099f}}, // 63488 us
+    {{0.103913158f, 0.000655405747f}, {0.0869567692f, 0.0328492559f}, {6.55406693e-05f, 0.99557066f}}, // 65536 us
+    {{0.111539356f, 0.000732652785f}, {0.0946866572f, 0.0348828062f}, {7.32653862e-05f, 0.995829046f}}, // 69632 us
+    {{0.119210586f, 0.000813358987f}, {0.102579303f, 0.036914181f}, {8.13360166e-05f, 0.996058941f}}, // 73728 us
+    {{0.126919985f, 0.000897389371f}, {0.110624351f, 0.0389432088f}, {8.9739071e-05f, 0.996264815f}}, // 77824 us
+    {{0.134661227f, 0.000984609942f}, {0.118812114f, 0.0409697257f}, {9.84611397e-05f, 0.996450186f}}, // 81920 us
+    {{0.142428532f, 0.00107488746f}, {0.127133474f, 0.042993553f}, {0.000107488908f, 0.996618092f}}, // 86016 us
+    {{0.150216535f, 0.00116809015f}, {0.135579839f, 0.0450145192f}, {0.000116809191f, 0.996770799f}}, // 90112 us
+    {{0.158020303f, 0.00126408727f}, {0.144143075f, 0.0470324531f}, {0.000126408922f, 0.996910274f}}, // 94208 us
+    {{0.165835232f, 0.00136274949f}, {0.152815461f, 0.0490471758f}, {0.00013627515f, 0.997038245f}}, // 98304 us
+    {{0.173657045f, 0.00146394898f}, {0.161589652f, 0.0510585122f}, {0.000146395105f, 0.997155964f}}, // 102400 us
+    {{0.181481734f, 0.00156755908f}, {0.170458689f, 0.0530662872f}, {0.000156756141f, 0.997264743f}}, // 106496 us
+    {{0.189305589f, 0.00167345535f}, {0.179415926f, 0.0550703295f}, {0.000167345788f, 0.997365415f}}, // 110592 us
+    {{0.197125137f, 0.00178151461f}, {0.188454971f, 0.0570704564f}, {0.000178151735f, 0.997458994f}}, // 114688 us
+    {{0.204937086f, 0.00189161557f}, {0.197569758f, 0.0590665005f}, {0.00018916183f, 0.997546136f}}, // 118784 us
+    {{0.21273838f, 0.00200363854f}, {0.206754461f, 0.0610582829f}, {0.000200364157f, 0.997627437f}}, // 122880 us
+    {{0.220526129f, 0.00211746595f}, {0.216003478f, 0.0630456284f}, {0.000211746912f, 0.997703552f}}, // 126976 us
+    {{0.228297651f, 0.00223298208f}, {0.225311473f, 0.0650283694f}, {0.000223298543f, 0.997774899f}}, // 131072 us
+    {{0.243781909f, 0.00246862695f}, {0.244083911f, 0.0689793527f}, {0.000246863056f, 0.997905076f}}, // 139264 us
+    {{0.259172499f, 0.00270968629f}, {0.263032854f, 0.0729098618f}, {0.000270969031f, 0.998020768f}}, // 147456 us
+    {{0.274452865f, 0.00295530609f}, {0.282122225f, 0.0768185854f}, {0.000295531034f, 0.998124242f}}, // 155648 us
+    {{0.28960821f, 0.00320466515f}, {0.301318437f, 0.0807041973f}, {0.000320466992f, 0.998217404f}}, // 163840 us
+    {{0.304625511f, 0.0034569772f}, {0.320590317f, 0.0845654458f}, {0.000345698238f, 0.998301685f}}, // 172032 us
+    {{0.319493026f, 0.00371148903f}, {0.339908659f, 0.0884010866f}, {0.00037114945f, 0.998378217f}}, // 180224 us
+    {{0.334200412f, 0.00396748213f}, {0.359246314f, 0.0922099203f}, {0.00039674883f, 0.998448074f}}, // 188416 us
+    {{0.348738492f, 0.00422427338f}, {0.378577858f, 0.095990777f}, {0.000422427955f, 0.998512089f}}, // 196608 us
+    {{0.363099068f, 0.00448121177f}, {0.397879481f, 0.0997425541f}, {0.000448121835f, 0.998570919f}}, // 204800 us
+    {{0.37727505f, 0.00473768264f}, {0.41712898f, 0.103464164f}, {0.000473768974f, 0.998625159f}}, // 212992 us
+    {{0.391260058f, 0.00499310344f}, {0.436305553f, 0.107154578f}, {0.000499311078f, 0.998675346f}}, // 221184 us
+    {{0.405048639f, 0.00524692563f}, {0.455389708f, 0.11081282f}, {0.000524693343f, 0.998721838f}}, // 229376 us
+    {{0.418636024f, 0.00549863279f}, {0.474363267f, 0.114437945f}, {0.000549864082f, 0.998765051f}}, // 237568 us
+    {{0.432018101f, 0.00574774155f}, {0.493209213f, 0.118029073f}, {0.000574774982f, 0.998805344f}}, // 245760 us
+    {{0.445191443f, 0.00599379884f}, {0.51191169f, 0.121585354f}, {0.000599380757f, 0.998842955f}}, // 253952 us
+    {{0.458153099f, 0.00623638369f}, {0.530455768f, 0.125106022f}, {0.000623639266f, 0.998878121f}} // 262144 us
+};
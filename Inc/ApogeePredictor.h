@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "AltitudeFilter.h"
+
+/**
+ * Time of apogee, extrapolated from the altitude filter state during
+ * coast.
+ *
+ * The rocket is taken as a point mass under gravity and quadratic drag,
+ * dv/dt = -g - k v|v|. In coast the accelerometer feels the drag alone, so
+ * each step with the rocket faster than APOGEE_MIN_DRAG_VELOCITY measures
+ * k as the downward specific force over v^2, smoothed over the steps. A
+ * step with the specific force pointing up still has thrust, from the
+ * tail-off after the valve closes, and measures nothing. The
+ * time to apogee is then atan(v sqrt(k / g)) / sqrt(k g), v / g without
+ * drag, counted from the sample time of the state rather than from when
+ * the step ran.
+ *
+ * Once apogee is less than APOGEE_ALARM_HORIZON_US away, which covers the
+ * next filter step, apogeePredictorUpdate asks for the drogue to be fired
+ * by a hardware timer at the predicted instant. The first prediction is
+ * only trusted while the filter sees the rocket slowing down by at least
+ * APOGEE_MIN_DECELERATION. Later steps within the horizon can bring the
+ * instant forward but never put it off, so a filter velocity that stalls
+ * near apogee cannot keep the drogue waiting. A prediction beyond the
+ * horizon again cancels it. The measured velocity changing sign fires the
+ * drogue at once, whatever the prediction.
+ *
+ * Single precision, a few bytes of state. Tools/ApogeeMonteCarlo
+ * flies it with the altitude filter against the velocity threshold rule
+ * it replaces.
+ */
+
+#define APOGEE_ALARM_HORIZON_US 100000 // Two parachute control periods
+#define APOGEE_MIN_DRAG_VELOCITY 50.0f // m/s, slower gives a noisy k
+#define APOGEE_MIN_DECELERATION 4.9f // m/s^2, half of g
+#define APOGEE_DRAG_GAIN 0.1f // Per step, 0.5 s time constant
+
+typedef enum
+{
+    APOGEE_WAIT = 0,        // Apogee is further than the horizon, no timer
+    APOGEE_SCHEDULE,        // Fire the drogue at apogeeTimeUs_
+    APOGEE_NOW              // The velocity changed sign, fire the drogue now
+} ApogeeAction;
+
+typedef struct
+{
+    float       dragCoefficient_; // k, 1/m
+    uint8_t     hasDrag_;
+    uint8_t     scheduled_; // The drogue timer is set for apogeeTimeUs_
+    float       timeToApogee_; // s, from the sample time of the last state
+    uint32_t    apogeeTimeUs_; // When to fire, on the timebase
+    uint32_t    updates_;
+} ApogeePredictor;
+
+void apogeePredictorInit(ApogeePredictor* predictor);
+
+/**
+ * Predicts apogee from one filter step.
+ *
+ * Params:
+ *   state - (KalmanStateVector*) Altitude, velocity and acceleration of the step
+ *   accel - (int32_t) Measured specific force along up, in mg
+ *   sampleTimeUs - (uint32_t) Sample time of the step, on the timebase
+ *
+ * Returns:
+ *   - (ApogeeAction) What to do with the drogue
+ */
+ApogeeAction apogeePredictorUpdate(
+    ApogeePredictor* predictor,
+    const struct KalmanStateVector* state,
+    int32_t accel,
+    uint32_t sampleTimeUs
+);
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Altitude from pressure, with the standard atmosphere of the barometer
+ * datasheet: h = A * (1 - (p / p0)^k), p0 the sea level pressure.
+ *
+ * The power is not computed per reading. BarometricAltitudeTable.h holds
+ * the altitude for the reference sea level pressure of the standard
+ * atmosphere, sampled in BAROMETRIC_TABLE_SEGMENTS uniform segments per
+ * octave of pressure, from BAROMETRIC_TABLE_MIN_PRESSURE to
+ * BAROMETRIC_TABLE_MAX_PRESSURE. A reading finds its octave with a count of
+ * leading zeros and its segment with a shift, then interpolates linearly.
+ *
+ * Another sea level pressure rescales the table: with s = (pr / p0)^k,
+ * h = A * (1 - s) + s * h_ref. barometricReferenceInit computes s and the
+ * offset once, with pow, when the sea level pressure is set.
+ *
+ * Over 10 to 1200 mbar, for sea level pressures between
+ * BAROMETRIC_MIN_SEA_LEVEL_PRESSURE and BAROMETRIC_MAX_SEA_LEVEL_PRESSURE,
+ * the altitude is within BAROMETRIC_ALTITUDE_MAX_ERROR of the formula.
+ * Outside the table the formula is computed. Tools/BarometricTableGen
+ * generates the table and Tools/BarometricAltitudeBench checks the bound
+ * at every pressure in range and times the lookup against pow and powf.
+ */
+
+#define BAROMETRIC_SCALE_HEIGHT 44307.69396 // A, m
+#define BAROMETRIC_EXPONENT 0.190284 // k
+#define BAROMETRIC_REFERENCE_PRESSURE 101325 // pr, the table's sea level, in 100*millibars
+
+#define BAROMETRIC_MIN_SEA_LEVEL_PRESSURE 87000 // Lowest on record is 87000
+#define BAROMETRIC_MAX_SEA_LEVEL_PRESSURE 108500 // Highest on record is 108380
+#define BAROMETRIC_ALTITUDE_MAX_ERROR 0.06 // m, below the 1 Pa resolution of the barometer
+
+typedef struct
+{
+    double      seaLevelPressure_; // p0, in 100*millibars
+    float       scale_; // s
+    float       offset_; // A * (1 - s), m
+} BarometricReference;
+
+/**
+ * Sets the sea level pressure, in 100*millibars.
+ */
+void barometricReferenceInit(BarometricReference* reference, double seaLevelPressure);
+
+/**
+ * Altitude above sea level of a pressure, in m, from the table.
+ *
+ * Params:
+ *   pressure - (int32_t) Measured pressure, in 100*millibars
+ */
+double barometricAltitude(const BarometricReference* reference, int32_t pressure);
+
+/**
+ * The same from the formula, with pow.
+ */
+double barometricAltitudeExact(const BarometricReference* reference, int32_t pressure);
+
+/**
+ * The sea level pressure that puts a pressure, in 100*millibars, at a known
+ * altitude, in m. The inverse of the formula, with pow.
+ */
+double barometricSeaLevelPressure(double pressure, double altitude);
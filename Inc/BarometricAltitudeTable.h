@@ -0,0 +1,191 @@
+#pragma once
+
+/**
+ * Generated by Tools/BarometricTableGen, do not edit.
+ *
+ * Altitude in m for a sea level pressure of 101325 Pa, at 128 uniform
+ * segments per octave of pressure from 512 to 131072 Pa.
+ * Entry i * 128 + j is at 2^(9 + i) * (1 + j / 128) Pa.
+ * Largest linear interpolation error: 0.0476 m
+ */
+
+#define BAROMETRIC_TABLE_FIRST_OCTAVE 9
+#define BAROMETRIC_TABLE_SEGMENT_BITS 7
+#define BAROMETRIC_TABLE_SEGMENTS 128
+#define BAROMETRIC_TABLE_MIN_PRESSURE 512
+#define BAROMETRIC_TABLE_MAX_PRESSURE 131072 // Excluded
+
+static const float BAROMETRIC_ALTITUDE_TABLE[1025] =
+{
+    28108.1758f, 28084.1699f, 28060.3145f, 28036.6055f, 28013.043f, 27989.627f,
+    27966.3496f, 27943.2148f, 27920.2188f, 27897.3574f, 27874.6309f, 27852.0391f,
+    27829.5762f, 27807.2441f, 27785.041f, 27762.9629f, 27741.0098f, 27719.1797f,
+    27697.4707f, 27675.8828f, 27654.4121f, 27633.0586f, 27611.8223f, 27590.6992f,
+    27569.6895f, 27548.791f, 27528.0039f, 27507.3242f, 27486.7539f, 27466.2891f,
+    27445.9297f, 27425.6738f, 27405.5215f, 27385.4707f, 27365.5215f, 27345.6699f,
+    27325.918f, 27306.2637f, 27286.7051f, 27267.2402f, 27247.8711f, 27228.5957f,
+    27209.4121f, 27190.3184f, 27171.3164f, 27152.4023f, 27133.5762f, 27114.8379f,
+    27096.1875f, 27077.6211f, 27059.1406f, 27040.7441f, 27022.4297f, 27004.1973f,
+    26986.0469f, 26967.9766f, 26949.9863f, 26932.0762f, 26914.2441f, 26896.4883f,
+    26878.8086f, 26861.207f, 26843.6797f, 26826.2266f, 26808.8457f, 26791.541f,
+    26774.3066f, 26757.1445f, 26740.0547f, 26723.0352f, 26706.084f, 26689.2031f,
+    26672.3906f, 26655.6465f, 26638.9688f, 26622.3574f, 26605.8125f, 26589.334f,
+    26572.9199f, 26556.5703f, 26540.2852f, 26524.0625f, 26507.9023f, 26491.8047f,
+    26475.7676f, 26459.793f, 26443.8789f, 26428.0254f, 26412.2305f, 26396.4961f,
+    26380.8184f, 26365.1992f, 26349.6387f, 26334.1348f, 26318.6875f, 26303.2969f,
+    26287.9609f, 26272.6816f, 26257.457f, 26242.2852f, 26227.1699f, 26212.1074f,
+    26197.0977f, 26182.1406f, 26167.2344f, 26152.3828f, 26137.582f, 26122.832f,
+    26108.1328f, 26093.4824f, 26078.8848f, 26064.334f, 26049.834f, 26035.3828f,
+    26020.9805f, 26006.625f, 25992.3184f, 25978.0586f, 25963.8457f, 25949.6797f,
+    25935.5605f, 25921.4863f, 25907.459f, 25893.4766f, 25879.5391f, 25865.6465f,
+    25851.7988f, 25837.9941f, 25824.2344f, 25796.8418f, 25769.623f, 25742.5723f,
+    25715.6895f, 25688.9688f, 25662.4121f, 25636.0156f, 25609.7754f, 25583.6914f,
+    25557.7617f, 25531.9844f, 25506.3555f, 25480.875f, 25455.5391f, 25430.3496f,
+    25405.3008f, 25380.3926f, 25355.623f, 25330.9922f, 25306.4941f, 25282.1309f,
+    25257.9004f, 25233.7988f, 25209.8262f, 25185.9824f, 25162.2637f, 25138.6699f,
+    25115.1973f, 25091.8477f, 25068.6172f, 25045.5078f, 25022.5137f, 24999.6367f,
+    24976.873f, 24954.2246f, 24931.6875f, 24909.2598f, 24886.9434f, 24864.7363f,
+    24842.6367f, 24820.6426f, 24798.7539f, 24776.9688f, 24755.2871f, 24733.707f,
+    24712.2266f, 24690.8477f, 24669.5664f, 24648.3828f, 24627.2969f, 24606.3066f,
+    24585.4102f, 24564.6074f, 24543.8984f, 24523.2793f, 24502.7539f, 24482.3164f,
+    24461.9707f, 24441.7109f, 24421.541f, 24401.4551f, 24381.457f, 24361.543f,
+    24341.7148f, 24321.9688f, 24302.3047f, 24282.7227f, 24263.2227f, 24243.8027f,
+    24224.4629f, 24205.2012f, 24186.0195f, 24166.9141f, 24147.8848f, 24128.9316f,
+    24110.0547f, 24091.252f, 24072.5234f, 24053.8691f, 24035.2871f, 24016.7773f,
+    23998.3398f, 23979.9727f, 23961.6758f, 23943.4492f, 23925.291f, 23907.2012f,
+    23889.1797f, 23871.2266f, 23853.3379f, 23835.5176f, 23817.7637f, 23800.0723f,
+    23782.4473f, 23764.8867f, 23747.3906f, 23729.9551f, 23712.584f, 23695.2754f,
+    23678.0273f, 23660.8398f, 23643.7148f, 23626.6484f, 23609.6426f, 23592.6953f,
+    23575.8086f, 23558.9785f, 23542.207f, 23525.4922f, 23508.834f, 23492.2344f,
+    23475.6895f, 23459.2012f, 23442.7676f, 23426.3887f, 23410.0645f, 23393.7949f,
+    23377.5781f, 23361.4141f, 23345.3047f, 23329.2461f, 23313.2402f, 23297.2871f,
+    23281.3848f, 23265.5332f, 23249.7324f, 23233.9824f, 23218.2812f, 23187.0293f,
+    23155.9727f, 23125.1074f, 23094.4336f, 23063.9473f, 23033.6465f, 23003.5273f,
+    22973.5879f, 22943.8262f, 22914.2402f, 22884.8281f, 22855.5859f, 22826.5137f,
+    22797.6074f, 22768.8652f, 22740.2852f, 22711.8652f, 22683.6035f, 22655.498f,
+    22627.5469f, 22599.75f, 22572.1016f, 22544.6035f, 22517.25f, 22490.0449f,
+    22462.9824f, 22436.0605f, 22409.2812f, 22382.6387f, 22356.1328f, 22329.7637f,
+    22303.5293f, 22277.4258f, 22251.4531f, 22225.6113f, 22199.8965f, 22174.3086f,
+    22148.8457f, 22123.5078f, 22098.291f, 22073.1953f, 22048.2207f, 22023.3652f,
+    21998.625f, 21974.0039f, 21949.4961f, 21925.1016f, 21900.8203f, 21876.6504f,
+    21852.5918f, 21828.6406f, 21804.7988f, 21781.0625f, 21757.4336f, 21733.9102f,
+    21710.4883f, 21687.1719f, 21663.9551f, 21640.8398f, 21617.8242f, 21594.9082f,
+    21572.0898f, 21549.3691f, 21526.7441f, 21504.2148f, 21481.7793f, 21459.4375f,
+    21437.1875f, 21415.0293f, 21392.9629f, 21370.9863f, 21349.0977f, 21327.2988f,
+    21305.5879f, 21283.9629f, 21262.4238f, 21240.9707f, 21219.6016f, 21198.3164f,
+    21177.1152f, 21155.9961f, 21134.959f, 21114.002f, 21093.125f, 21072.3281f,
+    21051.6094f, 21030.9707f, 21010.4082f, 20989.9219f, 20969.5137f, 20949.1797f,
+    20928.9219f, 20908.7383f, 20888.6289f, 20868.5918f, 20848.627f, 20828.7344f,
+    20808.9141f, 20789.1641f, 20769.4844f, 20749.875f, 20730.3359f, 20710.8633f,
+    20691.459f, 20672.123f, 20652.8555f, 20633.6523f, 20614.5156f, 20595.4453f,
+    20576.4395f, 20557.498f, 20538.6211f, 20519.8066f, 20501.0566f, 20482.3691f,
+    20463.7422f, 20445.1797f, 20426.6758f, 20408.2344f, 20389.8535f, 20371.5312f,
+    20353.2695f, 20335.0664f, 20316.9219f, 20298.8359f, 20280.8066f, 20262.8359f,
+    20244.9219f, 20209.2617f, 20173.8262f, 20138.6113f, 20103.6113f, 20068.8281f,
+    20034.2539f, 19999.8887f, 19965.7285f, 19931.7715f, 19898.0137f, 19864.4551f,
+    19831.0898f, 19797.918f, 19764.9355f, 19732.1406f, 19699.5312f, 19667.1055f,
+    19634.8594f, 19602.791f, 19570.9004f, 19539.1836f, 19507.6367f, 19476.2617f,
+    19445.0527f, 19414.0117f, 19383.1328f, 19352.416f, 19321.8594f, 19291.4629f,
+    19261.2207f, 19231.1328f, 19201.1992f, 19171.416f, 19141.7812f, 19112.2949f,
+    19082.9551f, 19053.7598f, 19024.707f, 18995.7969f, 18967.0254f, 18938.3926f,
+    18909.8965f, 18881.5352f, 18853.3086f, 18825.2148f, 18797.252f, 18769.418f,
+    18741.7129f, 18714.1348f, 18686.6836f, 18659.3574f, 18632.1523f, 18605.0723f,
+    18578.1113f, 18551.2695f, 18524.5469f, 18497.9414f, 18471.4531f, 18445.0781f,
+    18418.8184f, 18392.6719f, 18366.6367f, 18340.7109f, 18314.8965f, 18289.1914f,
+    18263.5918f, 18238.0996f, 18212.7129f, 18187.4316f, 18162.2539f, 18137.1777f,
+    18112.2051f, 18087.332f, 18062.5586f, 18037.8867f, 18013.3105f, 17988.832f,
+    17964.4512f, 17940.166f, 17915.9746f, 17891.877f, 17867.873f, 17843.9629f,
+    17820.1426f, 17796.4141f, 17772.7734f, 17749.2246f, 17725.7637f, 17702.3906f,
+    17679.1035f, 17655.9023f, 17632.7891f, 17609.7598f, 17586.8145f, 17563.9531f,
+    17541.1738f, 17518.4766f, 17495.8613f, 17473.3281f, 17450.873f, 17428.498f,
+    17406.2031f, 17383.9863f, 17361.8477f, 17339.7852f, 17317.7988f, 17295.8887f,
+    17274.0547f, 17252.2949f, 17230.6094f, 17208.998f, 17187.459f, 17165.9941f,
+    17144.5996f, 17123.2773f, 17102.0254f, 17080.8438f, 17059.7324f, 17038.6895f,
+    17017.7168f, 16996.8125f, 16975.9746f, 16955.2051f, 16934.5039f, 16913.8672f,
+    16893.2969f, 16872.791f, 16852.3516f, 16811.666f, 16771.2344f, 16731.0527f,
+    16691.1191f, 16651.4297f, 16611.9824f, 16572.7715f, 16533.7969f, 16495.0508f,
+    16456.5352f, 16418.2441f, 16380.1758f, 16342.3271f, 16304.6943f, 16267.2764f,
+    16230.0693f, 16193.0713f, 16156.2783f, 16119.6895f, 16083.3018f, 16047.1123f,
+    16011.1191f, 15975.3203f, 15939.7119f, 15904.293f, 15869.0615f, 15834.0146f,
+    15799.1494f, 15764.4658f, 15729.96f, 15695.6309f, 15661.4766f, 15627.4941f,
+    15593.6826f, 15560.0391f, 15526.5625f, 15493.251f, 15460.1025f, 15427.1152f,
+    15394.2871f, 15361.6172f, 15329.1035f, 15296.7441f, 15264.5381f, 15232.4824f,
+    15200.5771f, 15168.8193f, 15137.209f, 15105.7432f, 15074.4209f, 15043.2412f,
+    15012.2021f, 14981.3027f, 14950.541f, 14919.915f, 14889.4248f, 14859.0693f,
+    14828.8457f, 14798.7529f, 14768.79f, 14738.957f, 14709.251f, 14679.6709f,
+    14650.2168f, 14620.8857f, 14591.6777f, 14562.5918f, 14533.626f, 14504.7803f,
+    14476.0518f, 14447.4414f, 14418.9473f, 14390.5674f, 14362.3027f, 14334.1504f,
+    14306.1104f, 14278.1807f, 14250.3623f, 14222.6523f, 14195.0508f, 14167.5566f,
+    14140.168f, 14112.8857f, 14085.707f, 14058.6328f, 14031.6611f, 14004.791f,
+    13978.0215f, 13951.3535f, 13924.7832f, 13898.3125f, 13871.9395f, 13845.6631f,
+    13819.4824f, 13793.3975f, 13767.4072f, 13741.5107f, 13715.707f, 13689.9951f,
+    13664.376f, 13638.8467f, 13613.4082f, 13588.0586f, 13562.7979f, 13537.625f,
+    13512.5391f, 13487.541f, 13462.6279f, 13437.8008f, 13413.0576f, 13388.3984f,
+    13363.8232f, 13339.3311f, 13314.9209f, 13290.5918f, 13266.3438f, 13242.1758f,
+    13218.0879f, 13194.0791f, 13170.1494f, 13146.2969f, 13122.5225f, 13098.8252f,
+    13075.2031f, 13051.6572f, 13028.1875f, 13004.791f, 12981.4697f, 12935.0469f,
+    12888.915f, 12843.0693f, 12797.5059f, 12752.2207f, 12707.2109f, 12662.4727f,
+    12618.001f, 12573.7939f, 12529.8477f, 12486.1582f, 12442.7227f, 12399.5371f,
+    12356.5986f, 12313.9053f, 12271.4521f, 12229.2383f, 12187.2578f, 12145.5107f,
+    12103.9922f, 12062.7012f, 12021.6328f, 11980.7861f, 11940.1582f, 11899.7461f,
+    11859.5469f, 11819.5586f, 11779.7783f, 11740.2051f, 11700.834f, 11661.665f,
+    11622.6953f, 11583.9219f, 11545.3428f, 11506.9561f, 11468.7598f, 11430.751f,
+    11392.9287f, 11355.291f, 11317.835f, 11280.5586f, 11243.4609f, 11206.5391f,
+    11169.792f, 11133.2178f, 11096.8145f, 11060.5791f, 11024.5117f, 10988.6104f,
+    10952.8721f, 10917.2959f, 10881.8809f, 10846.624f, 10811.5254f, 10776.582f,
+    10741.793f, 10707.1572f, 10672.6729f, 10638.3369f, 10604.1504f, 10570.1113f,
+    10536.2168f, 10502.4668f, 10468.8594f, 10435.3936f, 10402.0674f, 10368.8809f,
+    10335.8311f, 10302.918f, 10270.1396f, 10237.4951f, 10204.9834f, 10172.6025f,
+    10140.3525f, 10108.2314f, 10076.2373f, 10044.3711f, 10012.6299f, 9981.01367f,
+    9949.52051f, 9918.14941f, 9886.89941f, 9855.77051f, 9824.76074f, 9793.86914f,
+    9763.09473f, 9732.43555f, 9701.89258f, 9671.46387f, 9641.14844f, 9610.94531f,
+    9580.85352f, 9550.87305f, 9521.00098f, 9491.23828f, 9461.58398f, 9432.03613f,
+    9402.59473f, 9373.25781f, 9344.02637f, 9314.89844f, 9285.87305f, 9256.94922f,
+    9228.12695f, 9199.40527f, 9170.7832f, 9142.25977f, 9113.83398f, 9085.50684f,
+    9057.27539f, 9029.13965f, 9001.09961f, 8973.1543f, 8945.30176f, 8917.54297f,
+    8889.87695f, 8862.30176f, 8834.81738f, 8807.42383f, 8780.12012f, 8752.90527f,
+    8725.77832f, 8698.73926f, 8671.78711f, 8644.92188f, 8618.14258f, 8591.44824f,
+    8564.83887f, 8511.87109f, 8459.23438f, 8406.9248f, 8354.9375f, 8303.26855f,
+    8251.91309f, 8200.86621f, 8150.12549f, 8099.68555f, 8049.54297f, 7999.69385f,
+    7950.13428f, 7900.86035f, 7851.86865f, 7803.15527f, 7754.71729f, 7706.55078f,
+    7658.65234f, 7611.01904f, 7563.64746f, 7516.53418f, 7469.67627f, 7423.0708f,
+    7376.71436f, 7330.60449f, 7284.73779f, 7239.11133f, 7193.72314f, 7148.56982f,
+    7103.64844f, 7058.95703f, 7014.49268f, 6970.25244f, 6926.23438f, 6882.43555f,
+    6838.854f, 6795.48682f, 6752.33252f, 6709.3877f, 6666.65088f, 6624.11914f,
+    6581.79102f, 6539.66406f, 6497.73584f, 6456.00488f, 6414.46826f, 6373.125f,
+    6331.97266f, 6291.00879f, 6250.23193f, 6209.64062f, 6169.23193f, 6129.00488f,
+    6088.95752f, 6049.08789f, 6009.39404f, 5969.87451f, 5930.52783f, 5891.35205f,
+    5852.34521f, 5813.50635f, 5774.8335f, 5736.32471f, 5697.97949f, 5659.79492f,
+    5621.771f, 5583.90479f, 5546.1958f, 5508.64209f, 5471.24268f, 5433.99561f,
+    5396.8999f, 5359.9541f, 5323.15674f, 5286.50684f, 5250.00293f, 5213.64307f,
+    5177.42676f, 5141.35303f, 5105.41943f, 5069.62598f, 5033.9707f, 4998.45264f,
+    4963.07031f, 4927.82324f, 4892.70996f, 4857.729f, 4822.87988f, 4788.16064f,
+    4753.57129f, 4719.10986f, 4684.77588f, 4650.56787f, 4616.48486f, 4582.52588f,
+    4548.68994f, 4514.97656f, 4481.38379f, 4447.91162f, 4414.55811f, 4381.32324f,
+    4348.20557f, 4315.2041f, 4282.31836f, 4249.54688f, 4216.88965f, 4184.34473f,
+    4151.91211f, 4119.59033f, 4087.37866f, 4055.27661f, 4023.28296f, 3991.39722f,
+    3959.61841f, 3927.9458f, 3896.37866f, 3864.91577f, 3833.55688f, 3802.30127f,
+    3771.14771f, 3740.0957f, 3709.14453f, 3678.29346f, 3647.5415f, 3616.88843f,
+    3586.3335f, 3555.87549f, 3525.51416f, 3465.07861f, 3405.021f, 3345.33643f,
+    3286.01953f, 3227.06567f, 3168.46924f, 3110.22607f, 3052.3313f, 2994.78003f,
+    2937.56787f, 2880.69043f, 2824.14355f, 2767.92261f, 2712.02368f, 2656.44238f,
+    2601.17505f, 2546.21777f, 2491.56641f, 2437.21729f, 2383.16675f, 2329.41113f,
+    2275.94702f, 2222.77051f, 2169.87842f, 2117.26733f, 2064.93408f, 2012.87512f,
+    1961.0874f, 1909.56787f, 1858.31335f, 1807.3208f, 1756.58728f, 1706.10986f,
+    1655.88574f, 1605.91199f, 1556.18591f, 1506.70459f, 1457.4657f, 1408.46631f,
+    1359.70386f, 1311.1759f, 1262.88f, 1214.81348f, 1166.97412f, 1119.35938f,
+    1071.96692f, 1024.79456f, 977.840027f, 931.100952f, 884.575195f, 838.26062f,
+    792.15509f, 746.25647f, 700.562744f, 655.071838f, 609.781799f, 564.690613f,
+    519.796387f, 475.097137f, 430.591003f, 386.276184f, 342.150787f, 298.213074f,
+    254.461212f, 210.893478f, 167.508148f, 124.30352f, 81.2779236f, 38.4297142f,
+    -4.24274063f, -46.7410431f, -89.0667725f, -131.221497f, -173.206726f, -215.024017f,
+    -256.674835f, -298.160645f, -339.48291f, -380.643097f, -421.642578f, -462.482758f,
+    -503.165009f, -543.690735f, -584.061218f, -624.277771f, -664.341797f, -704.254456f,
+    -744.01709f, -783.630981f, -823.097351f, -862.417358f, -901.592224f, -940.62323f,
+    -979.511475f, -1018.25812f, -1056.86438f, -1095.3313f, -1133.66003f, -1171.85168f,
+    -1209.90735f, -1247.828f, -1285.61499f, -1323.26904f, -1360.79138f, -1398.18311f,
+    -1435.44495f, -1472.57812f, -1509.58362f, -1546.46228f, -1583.21521f, -1619.84338f,
+    -1656.34753f, -1692.72888f, -1728.98816f, -1765.12622f, -1801.14417f, -1837.04272f,
+    -1872.82288f, -1908.48535f, -1944.03125f, -1979.46118f, -2014.77612f, -2049.97681f,
+    -2085.06421f, -2120.03906f, -2154.9021f, -2189.65405f, -2224.29614f
+};
@@ -2,6 +2,8 @@
 
 /* Structs containing data primitives */
 
+// sampleTimeUs_ is timebaseMicros() when the values were sampled, see Timebase.h
+
 typedef struct
 {
     osMutexId   mutex_;
@@ -14,6 +16,10 @@ typedef struct
     int32_t     magnetoX_;
     int32_t     magnetoY_;
     int32_t     magnetoZ_;
+    int32_t     tilt_; // From vertical in millidegrees, see Ahrs.h
+    int32_t     angularRate_; // Magnitude in mdps, less the gyroscope bias
+    int32_t     verticalAccel_; // Specific force along up in mg, 1000 at rest, see Ahrs.h
+    uint32_t    sampleTimeUs_;
 } AccelGyroMagnetismData;
 
 typedef struct
@@ -21,18 +27,18 @@ typedef struct
     osMutexId   mutex_;
     int32_t     pressure_;
     int32_t     temperature_;
+    uint32_t    sampleTimeUs_; // Middle of the pressure conversion
 } BarometerData;
 
 typedef struct
 {
     osMutexId   mutex_;
     int32_t     pressure_;
+    uint32_t    sampleTimeUs_; // Newest of the averaged samples
 } CombustionChamberPressureData;
 
 /* GPS Data */
 
-#define NMEA_MAX_LENGTH 82
-
 typedef struct
 {
     int32_t    degrees_;
@@ -48,20 +54,31 @@ typedef struct
 typedef struct
 {
     osMutexId       mutex_;
-    char            buffer_ [NMEA_MAX_LENGTH + 1];
     uint32_t        time_;
     LatLongType     latitude_;
     LatLongType     longitude_;
     AltitudeType    antennaAltitude_;
     AltitudeType    geoidAltitude_;
     AltitudeType    totalAltitude_;
-    uint8_t         parseFlag_;
+    uint8_t         fixQuality_; // As in GGA, 0 without a fix
+    uint8_t         fixType_; // As in GSA, 1 no fix, 2 2D, 3 3D
+    uint8_t         satellites_; // Used in the fix
+    uint16_t        hdop_; // x100, GGA only, 0 with NAV-PVT
+    uint32_t        groundSpeed_; // cm/s
+    uint32_t        course_; // Degrees from true north x100
+    int32_t         velocityNorth_; // mm/s, NAV-PVT only
+    int32_t         velocityEast_; // mm/s, NAV-PVT only
+    int32_t         velocityDown_; // mm/s, NAV-PVT only
+    uint32_t        horizontalAccuracy_; // mm, NAV-PVT only
+    uint32_t        verticalAccuracy_; // mm, NAV-PVT only
+    uint32_t        sampleTimeUs_; // Navigation epoch of the last fix, from when its GGA or NAV-PVT was received
 } GpsData;
 
 typedef struct
 {
     osMutexId   mutex_;
     int32_t     pressure_;
+    uint32_t    sampleTimeUs_; // Newest of the averaged samples
 } OxidizerTankPressureData;
 
 /* Data Containers */
@@ -79,4 +96,5 @@ typedef struct
 {
     AccelGyroMagnetismData* accelGyroMagnetismData_;
     BarometerData*          barometerData_;
+    GpsData*                gpsData_;
 } ParachutesControlData;
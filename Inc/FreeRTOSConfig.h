@@ -53,7 +53,7 @@ extern uint32_t SystemCoreClock;
 #endif
 #define configUSE_PREEMPTION                     1
 #define configSUPPORT_STATIC_ALLOCATION          1
-#define configSUPPORT_DYNAMIC_ALLOCATION         1
+#define configSUPPORT_DYNAMIC_ALLOCATION         0
 #define configUSE_IDLE_HOOK                      0
 #define configUSE_TICK_HOOK                      0
 #define configCPU_CLOCK_HZ                       ( SystemCoreClock )
@@ -125,6 +125,24 @@ standard names. */
 
 /* USER CODE BEGIN Defines */
 /* Section where parameter definitions can be added (for instance, to override default ones in FreeRTOS.h) */
+
+/* Run time stats come from the DWT cycle counter, extended to 64 bits by
+TaskStats.c. The kernel's 32 bit counters are in units of 1024 cycles so
+they last 7 hours. The switch hooks charge CPU time to tasks registered
+with taskStatsRegister, whose task tag points at their statistics. */
+#if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
+#include "TaskStats.h"
+#endif
+#define configGENERATE_RUN_TIME_STATS            1
+#define configUSE_APPLICATION_TASK_TAG           1
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() taskStatsStartCycleCounter()
+#define portGET_RUN_TIME_COUNTER_VALUE()         taskStatsRunTimeCounter()
+#define traceTASK_SWITCHED_IN()                  taskStatsSwitchedIn((void*) pxCurrentTCB->pxTaskTag)
+#define traceTASK_SWITCHED_OUT()                 taskStatsSwitchedOut((void*) pxCurrentTCB->pxTaskTag)
+
+/* Fills new stacks with a known pattern so MemoryStats.c can find each
+task's high water mark. */
+#define INCLUDE_uxTaskGetStackHighWaterMark      1
 /* USER CODE END Defines */
 
 #endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Entry latency, execution time and nesting of the interrupt handlers in
+ * stm32f4xx_it.c.
+ *
+ * Each handler calls isrStatsEnter first and isrStatsExit last. Execution
+ * time is measured with the DWT cycle counter and excludes the handlers
+ * that preempted it, so every cycle is charged to one handler. A handler
+ * that runs longer than its budget counts an overrun. Nesting is the
+ * number of handlers active when a handler is entered, itself included.
+ *
+ * Entry latency is only known for the 1 MHz timer interrupts, in us,
+ * including the time spent behind masked sections and higher priority
+ * handlers. TIM7 counts from zero at its update event, so its counter read
+ * on entry is the wait. TIM5 is the free running timebase: its update
+ * event is the wrap, where the same holds, and its compare events are
+ * alarms, which waited the counter less the compare value. Other sources
+ * pass ISR_STATS_NO_LATENCY.
+ *
+ * ISR stats telemetry message, big endian, one handler per message in
+ * table order:
+ *   uint8   ISR_STATS_HEADER_BYTE
+ *   uint8   handler index
+ *   uint8   handler count
+ *   uint8   core clock in MHz
+ *   uint16  budget in us
+ *   uint32  calls
+ *   uint32  max and average execution time in cycles
+ *   uint16  max entry latency in us, saturating, 0xFFFF if not measured
+ *   uint8   max nesting
+ *   uint16  budget overruns, saturating
+ */
+
+/**
+ * X(handler, budget in us), handler is the IRQn name without the suffix.
+ * DMA1_Stream2 and UART4 copy at most half the GPS DMA buffer into a
+ * stream buffer, USART2 looks up the flight phase for each command.
+ */
+#define ISR_STATS_TABLE(X) \
+    X(DMA1_Stream2,     20) \
+    X(TIM1_UP_TIM10,    10) \
+    X(USART2,           30) \
+    X(UART4,            20) \
+    X(TIM5,             5) \
+    X(TIM7,             15)
+
+#define ISR_STATS_ID(handler, budgetUs) ISR_STATS_##handler,
+
+typedef enum
+{
+    ISR_STATS_TABLE(ISR_STATS_ID)
+    ISR_STATS_COUNT
+} IsrStatsId;
+
+#define ISR_STATS_NO_LATENCY 0xFFFFFFFFu
+// Deeper nesting is counted but its time goes to the outer handler
+#define ISR_STATS_MAX_DEPTH 8
+
+// A handler name of up to 32 characters, then every field fits in 11 digits and a separator
+#define ISR_STATS_LOG_ENTRY_MAX_LENGTH (32 + 12 * 12)
+
+#define ISR_STATS_HEADER_BYTE 0x3D
+#define ISR_STATS_SERIAL_MSG_SIZE 23
+
+typedef struct
+{
+    const char* name_;
+    uint16_t    budgetUs_;
+    uint32_t    calls_;
+    uint32_t    maxCycles_;
+    uint64_t    totalCycles_;
+    uint32_t    budgetOverruns_;
+    uint32_t    maxLatencyUs_; // ISR_STATS_NO_LATENCY if the source has none
+    uint32_t    nestedCalls_; // Calls that preempted another handler
+    uint8_t     maxDepth_;
+} IsrStatsEntry;
+
+typedef struct
+{
+    uint32_t        timeMs_;
+    uint32_t        coreClockHz_;
+    IsrStatsEntry   handlers_[ISR_STATS_COUNT];
+} IsrStatsSnapshot;
+
+extern const char ISR_STATS_LOG_HEADER[];
+
+/**
+ * Called first and last in a handler. latencyUs is the time in us since
+ * the timer event that raised the interrupt, or ISR_STATS_NO_LATENCY.
+ */
+void isrStatsEnter(IsrStatsId id, uint32_t latencyUs);
+void isrStatsExit(IsrStatsId id);
+
+void isrStatsRead(IsrStatsSnapshot* snapshot);
+int formatIsrStatsEntry(const IsrStatsSnapshot* snapshot, int handler, uint8_t flightPhase, char* buffer);
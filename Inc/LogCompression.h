@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "LogFormat.h"
+
+/**
+ * Compressed flight log stream.
+ *
+ * Records are delta encoded per field against the previous record in the
+ * same block (zigzag + varint), then each block is compressed with an
+ * LZ77 byte coder using a fixed size hash table. Every block starts from a
+ * zero record so blocks decode independently.
+ *
+ * Block layout, little endian:
+ *   uint32  magic (LOG_BLOCK_MAGIC)
+ *   uint32  sequence number
+ *   uint16  record count
+ *   uint16  raw (delta encoded) length
+ *   uint16  payload length
+ *   uint16  flags (LOG_BLOCK_FLAG_STORED if the payload is not compressed)
+ *   uint32  CRC-32 of the payload
+ *   payload
+ */
+
+#define LOG_BLOCK_MAGIC 0x424C5641 // "AVLB"
+#define LOG_BLOCK_HEADER_SIZE 20
+#define LOG_BLOCK_RAW_SIZE 1024
+#define LOG_BLOCK_MAX_SIZE (LOG_BLOCK_HEADER_SIZE + LOG_BLOCK_RAW_SIZE)
+// Cortex-M4 cycles of the appends and finish of one block, 2 ms at 168 MHz or 1% of
+// the fast log period. The logger measures them with DWT into AvionicsStream<N>.csv,
+// LogConverter encode checks them on the host against a budget scaled to host ticks
+#define LOG_BLOCK_CYCLE_BUDGET 336000
+#define LOG_BLOCK_FLAG_STORED 0x0001
+// A 32 bit varint takes at most 5 bytes
+#define LOG_RECORD_MAX_ENCODED_SIZE (LOG_ENTRY_FIELD_COUNT * 5)
+// Every field takes at least one byte
+#define LOG_BLOCK_MAX_RECORDS (LOG_BLOCK_RAW_SIZE / LOG_ENTRY_FIELD_COUNT)
+#define LOG_LZ_HASH_BITS 9
+#define LOG_LZ_MIN_MATCH 4
+
+#define LOG_STREAM_ERROR_FORMAT (-1)
+#define LOG_STREAM_ERROR_CRC (-2)
+
+typedef struct
+{
+    uint32_t    sequence_;
+    uint16_t    recordCount_;
+    uint16_t    rawLength_;
+    uint16_t    payloadLength_;
+    uint16_t    flags_;
+    uint32_t    crc_;
+} LogBlockHeader;
+
+typedef struct
+{
+    LogEntry    previous_;
+    uint32_t    sequence_;
+    uint16_t    recordCount_;
+    uint16_t    rawLength_;
+    uint8_t     raw_[LOG_BLOCK_RAW_SIZE];
+    uint16_t    hashTable_[1 << LOG_LZ_HASH_BITS];
+    uint8_t     block_[LOG_BLOCK_MAX_SIZE];
+} LogStreamEncoder;
+
+void logStreamInit(LogStreamEncoder* encoder);
+uint8_t logStreamAppend(LogStreamEncoder* encoder, const LogEntry* entry);
+uint16_t logStreamFinishBlock(LogStreamEncoder* encoder);
+
+uint32_t logStreamCrc32(const uint8_t* data, size_t length);
+int logStreamReadHeader(const uint8_t* data, LogBlockHeader* header);
+int logStreamDecodeBlock(const uint8_t* block, size_t length, LogEntry* records, int maxRecords);
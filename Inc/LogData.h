@@ -3,3 +3,9 @@
 #include "main.h"
 
 void logDataTask(void const* arg);
+
+/**
+ * Boot time creation of the log file, on a mounted card.
+ */
+int createNextLogFile(uint32_t* index);
+void writeLogIndex(uint32_t index);
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+
+#define LOG_ENTRY_FIELD_COUNT 29
+// Every field fits in a sign, 10 digits and a separator
+#define LOG_ENTRY_MAX_LENGTH (LOG_ENTRY_FIELD_COUNT * 12)
+
+/* Column order of a log record, matches the CSV header written by logDataTask */
+typedef enum
+{
+    LOG_FIELD_ACCEL_X,
+    LOG_FIELD_ACCEL_Y,
+    LOG_FIELD_ACCEL_Z,
+    LOG_FIELD_GYRO_X,
+    LOG_FIELD_GYRO_Y,
+    LOG_FIELD_GYRO_Z,
+    LOG_FIELD_MAGNETO_X,
+    LOG_FIELD_MAGNETO_Y,
+    LOG_FIELD_MAGNETO_Z,
+    LOG_FIELD_PRESSURE,
+    LOG_FIELD_TEMPERATURE,
+    LOG_FIELD_COMBUSTION_CHAMBER_PRESSURE,
+    LOG_FIELD_OXIDIZER_TANK_PRESSURE,
+    LOG_FIELD_GPS_TIME, // Unsigned, like the sample times
+    LOG_FIELD_LATITUDE_DEGREES,
+    LOG_FIELD_LATITUDE_MINUTES,
+    LOG_FIELD_LONGITUDE_DEGREES,
+    LOG_FIELD_LONGITUDE_MINUTES,
+    LOG_FIELD_GPS_ALTITUDE,
+    LOG_FIELD_FLIGHT_PHASE,
+    LOG_FIELD_ELAPSED_TIME,
+    LOG_FIELD_SOFTWARE_VERSION,
+    // timebaseMicros() when each sensor was sampled, see Timebase.h
+    LOG_FIELD_IMU_SAMPLE_TIME,
+    LOG_FIELD_BAROMETER_SAMPLE_TIME,
+    LOG_FIELD_COMBUSTION_CHAMBER_SAMPLE_TIME,
+    LOG_FIELD_OXIDIZER_TANK_SAMPLE_TIME,
+    LOG_FIELD_GPS_SAMPLE_TIME,
+    // Attitude filter outputs, see Ahrs.h
+    LOG_FIELD_TILT,
+    LOG_FIELD_ANGULAR_RATE
+} LogField;
+
+typedef struct
+{
+    int32_t fields_[LOG_ENTRY_FIELD_COUNT];
+} LogEntry;
+
+extern const char LOG_FILE_HEADER[];
+
+int formatLogEntry(const LogEntry* entry, char* buffer);
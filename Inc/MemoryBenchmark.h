@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Boot time benchmark of the estimator and logger paths with their working
+ * data in the main SRAM and in CCM RAM (see MemorySections.h).
+ *
+ * Each workload runs with the scheduler suspended, so only interrupts and
+ * the DMA streams they start compete with it, and the fastest of
+ * MEMORY_BENCHMARK_REPEATS runs is kept. The calling task's stack is the
+ * same for both runs; only the workload's own data moves.
+ */
+
+// Set to 1 to run the benchmark at boot and write AvionicsBenchmark<N>.csv
+#ifndef MEMORY_BENCHMARK
+#define MEMORY_BENCHMARK 0
+#endif
+
+#define MEMORY_BENCHMARK_COUNT 3
+#define MEMORY_BENCHMARK_REPEATS 8
+#define MEMORY_BENCHMARK_LOG_ENTRY_MAX_LENGTH 64
+
+typedef struct
+{
+    const char* name_;
+    uint32_t    sramCycles_;
+    uint32_t    ccmCycles_;
+} MemoryBenchmarkResult;
+
+extern const char MEMORY_BENCHMARK_LOG_HEADER[];
+
+/**
+ * Runs every workload from the calling task.
+ *
+ * @return  Number of results written, MEMORY_BENCHMARK_COUNT.
+ */
+int memoryBenchmarkRun(MemoryBenchmarkResult* results);
+int formatMemoryBenchmarkResult(const MemoryBenchmarkResult* result, char* buffer);
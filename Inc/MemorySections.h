@@ -0,0 +1,27 @@
+#pragma once
+
+/**
+ * Placement of static data in the STM32F405 memories.
+ *
+ * The 64 KB of CCM RAM at 0x10000000 sit on the core's data bus only: zero
+ * wait states and never shared with a DMA stream, but no DMA controller
+ * can reach them. Task stacks, filter state and staging buffers that only
+ * the CPU touches go there. Anything a DMA stream reads or writes must
+ * stay in the main SRAM; mark it DMA_BUFFER so it is not moved later.
+ *
+ * CCM_BSS     zeroed by the startup code, like .bss
+ * CCM_DATA    copied from flash by the startup code, like .data
+ * DMA_BUFFER  main SRAM, the default for .bss and .data
+ *
+ * The host simulation has no CCM, so the attributes are empty there.
+ */
+
+#if defined(__arm__)
+#define CCM_BSS __attribute__((section(".ccmbss")))
+#define CCM_DATA __attribute__((section(".ccmram")))
+#else
+#define CCM_BSS
+#define CCM_DATA
+#endif
+
+#define DMA_BUFFER
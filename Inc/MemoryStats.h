@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Stack and heap high water marks.
+ *
+ * Stack use comes from uxTaskGetStackHighWaterMark, which scans for the
+ * fill pattern the kernel writes into new stacks, so it is the deepest the
+ * task has ever gone. The FreeRTOS heap (heap_4) reports its current and
+ * minimum ever free space, all zero when configSUPPORT_DYNAMIC_ALLOCATION
+ * is 0 and there is no FreeRTOS heap. The newlib heap is the arena malloc
+ * has taken from _sbrk in syscalls.c.
+ *
+ * Memory stats telemetry message, big endian, one task per message in
+ * registration order:
+ *   uint8   MEMORY_STATS_HEADER_BYTE
+ *   uint8   task index
+ *   uint8   task count
+ *   uint16  stack size in words
+ *   uint16  minimum free stack ever in words
+ *   uint16  recommended stack size in words
+ *   uint32  FreeRTOS heap free and minimum ever free in bytes
+ *   uint32  newlib heap size in bytes
+ *   uint16  refused _sbrk calls, saturating
+ */
+
+#define MEMORY_STATS_MAX_TASKS 16
+
+// Recommended stack = used * (1 + 1 / MEMORY_STATS_MARGIN_DIVISOR) + MEMORY_STATS_MARGIN_WORDS, rounded up
+#define MEMORY_STATS_MARGIN_DIVISOR 4
+#define MEMORY_STATS_MARGIN_WORDS 16
+#define MEMORY_STATS_STACK_ROUNDING_WORDS 8
+
+// A task name of up to configMAX_TASK_NAME_LEN characters, then every field fits in 11 digits and a separator
+#define MEMORY_STATS_LOG_ENTRY_MAX_LENGTH (64 + 9 * 12)
+
+#define MEMORY_STATS_HEADER_BYTE 0x3B
+#define MEMORY_STATS_SERIAL_MSG_SIZE 23
+
+typedef struct
+{
+    const char* name_;
+    uint32_t    stackWords_;
+    uint32_t    minFreeWords_;
+    uint32_t    recommendedWords_;
+} MemoryStatsEntry;
+
+typedef struct
+{
+    uint32_t            timeMs_;
+    uint32_t            rtosHeapSize_;
+    uint32_t            rtosHeapFree_;
+    uint32_t            rtosHeapMinFree_;
+    uint32_t            newlibHeapSize_;
+    uint32_t            sbrkFailures_;
+    uint8_t             taskCount_;
+    MemoryStatsEntry    tasks_[MEMORY_STATS_MAX_TASKS];
+} MemoryStatsSnapshot;
+
+extern const char MEMORY_STATS_LOG_HEADER[];
+
+/**
+ * Starts tracking a task's stack. thread is the handle returned by
+ * osThreadCreate and stackWords the stack size from its osThreadDef.
+ * Call before the scheduler starts.
+ */
+void memoryStatsRegister(void* thread, uint32_t stackWords);
+
+void memoryStatsRead(MemoryStatsSnapshot* snapshot);
+int formatMemoryStatsEntry(const MemoryStatsSnapshot* snapshot, int task, uint8_t flightPhase, char* buffer);
+
+/* Defined in syscalls.c */
+uint32_t sbrkHeapSize(void);
+uint32_t sbrkFailureCount(void);
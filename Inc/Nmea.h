@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Incremental NMEA 0183 parser.
+ *
+ * nmeaParse takes one received character at a time and decodes each field
+ * as soon as its delimiter arrives, so a sentence costs one pass over its
+ * characters and the parser needs no line buffer, no allocation and no
+ * floating point. The sentence is only handed out once its checksum
+ * matched; a start character always starts over, so the parser resyncs on
+ * the next sentence after garbage.
+ *
+ * GGA, RMC, VTG and GSA are decoded from any talker (GP, GN, GL, ...), the
+ * others are skipped after their address field. Decimal fields are fixed
+ * point, with the scale given next to each field. Empty fields decode as
+ * zero; the fix quality, status and fix type fields say whether the
+ * position and velocity fields hold anything.
+ */
+
+// From the start character to the end of line
+#define NMEA_MAX_LENGTH 82
+#define NMEA_MAX_FIELD_LENGTH 15
+#define NMEA_GSA_SATELLITES 12
+
+typedef enum
+{
+    NMEA_GGA = 1,
+    NMEA_RMC,
+    NMEA_VTG,
+    NMEA_GSA
+} NmeaSentenceType;
+
+typedef enum
+{
+    NMEA_PENDING = 0,       // The sentence is not complete yet
+    NMEA_OK,                // A sentence was decoded
+    NMEA_UNSUPPORTED,       // A sentence that is not decoded started, it is skipped
+    NMEA_CHECKSUM_ERROR,
+    NMEA_FORMAT_ERROR       // Too long, missing checksum, bad field or cut short by a new sentence
+} NmeaResult;
+
+/**
+ * A latitude or longitude. Both parts are negative south and west.
+ */
+typedef struct
+{
+    int32_t     degrees_;
+    int32_t     minutes_; // 1/100000 minute
+} NmeaCoordinate;
+
+typedef struct
+{
+    uint32_t        time_; // UTC hhmmss x100
+    NmeaCoordinate  latitude_;
+    NmeaCoordinate  longitude_;
+    uint8_t         quality_; // 0 no fix, 1 GPS, 2 DGPS, 4 RTK fixed, 5 RTK float, 6 dead reckoning
+    uint8_t         satellites_;
+    uint16_t        hdop_; // x100
+    int32_t         altitude_; // m above mean sea level x10
+    int32_t         geoidSeparation_; // m x10
+} NmeaGga;
+
+typedef struct
+{
+    uint32_t        time_; // UTC hhmmss x100
+    uint8_t         valid_; // Status A
+    char            mode_; // A autonomous, D differential, E estimated, N not valid, 0 if absent
+    NmeaCoordinate  latitude_;
+    NmeaCoordinate  longitude_;
+    uint32_t        speed_; // Knots x100
+    uint32_t        course_; // Degrees from true north x100
+    uint32_t        date_; // ddmmyy
+} NmeaRmc;
+
+typedef struct
+{
+    uint32_t    courseTrue_; // Degrees x100
+    uint32_t    courseMagnetic_; // Degrees x100
+    uint32_t    speedKnots_; // x100
+    uint32_t    speedKmh_; // x100
+    char        mode_; // As in RMC
+} NmeaVtg;
+
+typedef struct
+{
+    char        selection_; // M manual, A automatic 2D/3D
+    uint8_t     fixType_; // 1 no fix, 2 2D, 3 3D
+    uint8_t     satelliteCount_;
+    uint8_t     satellites_[NMEA_GSA_SATELLITES]; // PRNs used in the fix, satelliteCount_ of them
+    uint16_t    pdop_; // x100
+    uint16_t    hdop_; // x100
+    uint16_t    vdop_; // x100
+} NmeaGsa;
+
+typedef struct
+{
+    NmeaSentenceType    type_;
+    char                talker_[3];
+    union
+    {
+        NmeaGga     gga_;
+        NmeaRmc     rmc_;
+        NmeaVtg     vtg_;
+        NmeaGsa     gsa_;
+    } fix_;
+} NmeaSentence;
+
+typedef struct
+{
+    uint8_t         state_;
+    uint8_t         length_; // Characters since the start character
+    uint8_t         field_; // 0 is the address field
+    uint8_t         fieldLength_;
+    uint8_t         checksum_;
+    uint8_t         receivedChecksum_;
+    char            text_[NMEA_MAX_FIELD_LENGTH + 1];
+    NmeaSentence    sentence_; // Being decoded
+} NmeaParser;
+
+void nmeaInit(NmeaParser* parser);
+
+/**
+ * Feeds one character. When a sentence completes with a matching checksum
+ * it is copied to sentence and NMEA_OK is returned; sentence is not
+ * touched otherwise.
+ */
+NmeaResult nmeaParse(NmeaParser* parser, char c, NmeaSentence* sentence);
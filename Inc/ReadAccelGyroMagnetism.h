@@ -1,7 +1,9 @@
 #pragma once
 
 #include "main.h"
+#include "Data.h"
 
 extern SPI_HandleTypeDef hspi1;
 
-void readAccelGyroMagnetismTask(void const* arg);
+void readAccelGyroMagnetismInit(AccelGyroMagnetismData* accelGyroMagnetismData);
+void readAccelGyroMagnetismJob(void);
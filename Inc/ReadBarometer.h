@@ -1,8 +1,12 @@
 #pragma once
 
 #include "main.h"
+#include "Data.h"
 
 extern SPI_HandleTypeDef hspi2;
 
-void readBarometerTask(void const* arg);
+void readBarometerInit(BarometerData* barometerData);
+void startBarometerPressureJob(void);
+void readBarometerPressureJob(void);
+void readBarometerTemperatureJob(void);
 
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "Data.h"
+
 extern ADC_HandleTypeDef hadc1;
 
-void readCombustionChamberPressureTask(void const* arg);
+void readCombustionChamberPressureInit(CombustionChamberPressureData* combustionChamberPressureData);
+void readCombustionChamberPressureJob(void);
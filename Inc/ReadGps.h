@@ -1,9 +1,84 @@
 #pragma once
 #include "Data.h"
 
-void readGpsTask(void const* arg);
+/**
+ * GPS reception on UART4.
+ *
+ * DMA1 stream 2 receives into a buffer in circular mode and never
+ * stops, so no byte is lost between two messages. The half transfer and
+ * transfer complete interrupts, and the UART idle line interrupt at the
+ * end of every burst, call gpsRxCallback, which copies the bytes the DMA
+ * wrote since the previous call into a stream buffer. Nothing is parsed in
+ * interrupt context: readGpsJob drains the stream buffer through the UBX
+ * and NMEA parsers and updates the GPS data.
+ *
+ * The receiver is a u-blox M8 or later, which starts with NMEA at 9600
+ * baud. readGpsJob configures it at boot without blocking, one step per
+ * run: CFG-PRT switches its UART to GPS_BAUD_RATE with UBX only in and out,
+ * which also stops every NMEA sentence, then CFG-RATE sets the navigation
+ * rate and CFG-MSG enables NAV-PVT. The receiver acknowledges CFG-PRT at
+ * the new baud rate, before the driver listens at it, so CFG-PRT is sent
+ * a second time at GPS_BAUD_RATE. Its acknowledgement confirms the switch,
+ * and it also reaches a receiver that kept its configuration through a
+ * reset of the board. Each further step waits for its acknowledgement.
+ * After GPS_CONFIG_ATTEMPTS the driver goes back to 9600 baud and keeps
+ * decoding the NMEA GGA, RMC, VTG and GSA sentences. Once configured, a
+ * receiver that falls silent, e.g. after a brown out put it back to its
+ * defaults, is configured again.
+ *
+ * The stream buffer holds more than a period of readGpsJob at either
+ * rate. Bytes that do not fit are counted as dropped, as are receive
+ * errors, after which the DMA is restarted.
+ */
+
+#define GPS_DMA_BUFFER_SIZE 128 // A half transfer interrupt every 64 bytes, 67 ms at 9600 baud
+#define GPS_STREAM_BUFFER_SIZE 1024
+#define GPS_DEFAULT_BAUD_RATE 9600 // The receiver's, see MX_UART4_Init
+#define GPS_BAUD_RATE 115200
+#define GPS_MEASUREMENT_PERIOD_MS 100 // 10 Hz NAV-PVT, about 1000 bytes/s
+#define GPS_CONFIG_ATTEMPTS 6
+
+typedef enum
+{
+    GPS_CONFIG_PORT = 0,    // Sending CFG-PRT at GPS_DEFAULT_BAUD_RATE
+    GPS_CONFIG_BAUD,        // Switching to GPS_BAUD_RATE once CFG-PRT went out
+    GPS_CONFIG_PORT_ACK,    // Waiting for CFG-PRT at GPS_BAUD_RATE to be acknowledged
+    GPS_CONFIG_RATE,        // Waiting for CFG-RATE to be acknowledged
+    GPS_CONFIG_MESSAGE,     // Waiting for CFG-MSG to be acknowledged
+    GPS_CONFIGURED,         // Receiving NAV-PVT
+    GPS_CONFIG_FAILED       // Receiving NMEA at GPS_DEFAULT_BAUD_RATE
+} GpsConfigState;
+
+typedef struct
+{
+    uint32_t    bytes_; // Received and queued for readGpsJob
+    uint32_t    droppedBytes_;
+    uint32_t    errors_;
+    uint32_t    sentences_; // NMEA, decoded, see Nmea.h for the sentences
+    uint32_t    frames_; // UBX, received
+    uint32_t    checksumErrors_; // NMEA and UBX
+    uint32_t    formatErrors_; // NMEA and UBX
+    uint8_t     configState_; // GpsConfigState
+    uint8_t     configAttempts_; // Of the current configuration
+    uint8_t     configurations_; // Completed since boot
+} GpsRxStats;
+
+void readGpsInit(GpsData* gps);
+void readGpsJob(void);
+
+/**
+ * Called from the DMA half and full transfer callbacks and the idle line
+ * interrupt of UART4.
+ */
+void gpsRxCallback(void);
+
+/**
+ * Called from HAL_UART_ErrorCallback, after the HAL aborted the DMA.
+ */
+void gpsRxError(void);
+
+void gpsRxStats(GpsRxStats* stats);
 
 extern UART_HandleTypeDef huart4;
 
-extern char dma_rx_buffer[NMEA_MAX_LENGTH + 1];
 extern GpsData* gpsData;
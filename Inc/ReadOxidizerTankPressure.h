@@ -1,5 +1,8 @@
 #pragma once
 
+#include "Data.h"
+
 extern ADC_HandleTypeDef hadc2;
 
-void readOxidizerTankPressureTask(void const* arg);
+void readOxidizerTankPressureInit(OxidizerTankPressureData* oxidizerTankPressureData);
+void readOxidizerTankPressureJob(void);
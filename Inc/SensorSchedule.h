@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Time triggered cyclic executive for the sensor reads.
+ *
+ * TIM7 interrupts every minor frame and releases the sensor schedule task,
+ * which runs the jobs of SENSOR_SCHEDULE_TABLE that are due in that frame,
+ * in table order, then blocks until the next release. A job is due in the
+ * frames where the time since the start of the major frame, modulo its
+ * period, equals its offset. The offsets fix the relative phase of the
+ * sensors, e.g. the barometer conversion started by one job is done when
+ * the next one reads it, and every sample is taken at the same point of
+ * its frame.
+ *
+ * A frame that is still running when the next one is released is an
+ * overrun. The task then goes straight to the newest frame and the frames
+ * in between are skipped. Every job has an execution time budget: the
+ * offline check (Tools/ScheduleCheck) proves each minor frame fits the
+ * budgets of its jobs, and the task counts every job that runs over its
+ * budget so the budgets can be checked against a flight log.
+ *
+ * Start times are read from the TIM7 counter, in us since the frame was
+ * released, so their spread is the sampling jitter of each job.
+ */
+
+#define SENSOR_SCHEDULE_MINOR_FRAME_MS 5
+#define SENSOR_SCHEDULE_MAJOR_FRAME_MS 500
+#define SENSOR_SCHEDULE_FRAME_COUNT (SENSOR_SCHEDULE_MAJOR_FRAME_MS / SENSOR_SCHEDULE_MINOR_FRAME_MS)
+// Interrupt latency, context switch and bookkeeping of one frame, counted by the offline check
+#define SENSOR_SCHEDULE_FRAME_OVERHEAD_US 50
+#define SENSOR_SCHEDULE_MAX_JOBS 16
+
+/**
+ * X(job, period in ms, offset in ms, budget in us), in the order the jobs
+ * of a frame run. Periods divide the major frame, periods and offsets are
+ * multiples of the minor frame. Budgets are for SPI1 and SPI2 at 82 kHz,
+ * about 100 us per byte. The IMU job drains up to two samples of its FIFO,
+ * 119 Hz into a 10 ms period, and its budget also covers one attitude
+ * filter update per sample, AHRS_CYCLE_BUDGET in Ahrs.h. It runs last in
+ * its frames: the FIFO holds its samples, while a barometer conversion
+ * started late in one frame is not done at the start of the next.
+ */
+#define SENSOR_SCHEDULE_TABLE(X) \
+    X(startBarometerPressureJob,        25,     5,  150) \
+    X(readBarometerPressureJob,         25,     10, 600) \
+    X(readBarometerTemperatureJob,      25,     15, 500) \
+    X(readCombustionChamberPressureJob, 50,     20, 150) \
+    X(readGpsJob,                       100,    20, 400) \
+    X(readOxidizerTankPressureJob,      50,     45, 150) \
+    X(readAccelGyroMagnetismJob,        10,     0,  3800)
+
+// A job name of up to 64 characters, then every field fits in 11 digits and a separator
+#define SENSOR_SCHEDULE_LOG_ENTRY_MAX_LENGTH (64 + 13 * 12)
+
+typedef struct
+{
+    const char* name_;
+    uint16_t    periodMs_;
+    uint16_t    offsetMs_;
+    uint16_t    budgetUs_;
+    uint32_t    runs_;
+    uint32_t    maxUs_;
+    uint32_t    budgetOverruns_;
+    uint32_t    minStartUs_; // Since the release of the frame
+    uint32_t    maxStartUs_;
+} SensorScheduleJobStats;
+
+typedef struct
+{
+    uint32_t                timeMs_;
+    uint32_t                frames_;
+    uint32_t                frameOverruns_;
+    uint32_t                skippedFrames_;
+    uint8_t                 jobCount_;
+    SensorScheduleJobStats  jobs_[SENSOR_SCHEDULE_MAX_JOBS];
+} SensorScheduleSnapshot;
+
+extern const char SENSOR_SCHEDULE_LOG_HEADER[];
+
+/**
+ * Initializes the sensors, starts TIM7 and runs the schedule.
+ *
+ * @param   arg A pointer to the AllData struct the jobs will update.
+ */
+void sensorScheduleTask(void const* arg);
+
+/**
+ * Releases the next minor frame. Called from the TIM7 update interrupt.
+ */
+void sensorScheduleRelease(void);
+
+void sensorScheduleRead(SensorScheduleSnapshot* snapshot);
+int formatSensorScheduleEntry(const SensorScheduleSnapshot* snapshot, int job, uint8_t flightPhase, char* buffer);
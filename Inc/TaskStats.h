@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Per-task CPU time and job statistics.
+ *
+ * CPU time is measured with the DWT cycle counter from the FreeRTOS context
+ * switch hooks (see FreeRTOSConfig.h), so interrupt time is charged to the
+ * task it interrupted. A job is the work a periodic task does between two
+ * calls to taskStatsDelayUntil, or between taskStatsStartJob and
+ * taskStatsEndJob; its execution time only counts the cycles the task
+ * itself was running. A job that is still running when its next
+ * release is due counts as a deadline miss.
+ *
+ * Task stats telemetry message, big endian, one task per message in
+ * registration order:
+ *   uint8   TASK_STATS_HEADER_BYTE
+ *   uint8   task index
+ *   uint8   task count
+ *   uint16  CPU load of all tasks in permille, idle excluded
+ *   uint16  CPU load of this task in permille
+ *   uint16  period in ms, 0 if the task is not periodic
+ *   uint32  min, average and max job execution time in us
+ *   uint16  deadline misses, saturating
+ */
+
+#define TASK_STATS_MAX_TASKS 16
+#define TASK_STATS_HISTOGRAM_BINS 8
+// Bin i counts jobs shorter than TASK_STATS_FIRST_BIN_US << i, the last bin counts all longer jobs
+#define TASK_STATS_FIRST_BIN_US 256
+
+// A task name of up to configMAX_TASK_NAME_LEN characters, then every field fits in 11 digits and a separator
+#define TASK_STATS_LOG_ENTRY_MAX_LENGTH (64 + (9 + TASK_STATS_HISTOGRAM_BINS) * 12)
+
+#define TASK_STATS_HEADER_BYTE 0x3A
+#define TASK_STATS_SERIAL_MSG_SIZE 23
+
+typedef struct
+{
+    const char* name_;
+    uint32_t    periodMs_; // Last period passed to taskStatsDelayUntil, 0 if the task is not periodic
+    uint16_t    cpuPermille_; // Share of the CPU since the previous read with the same window
+    uint32_t    jobs_;
+    uint32_t    minJobUs_;
+    uint32_t    avgJobUs_;
+    uint32_t    maxJobUs_;
+    uint32_t    deadlineMisses_;
+    uint32_t    histogram_[TASK_STATS_HISTOGRAM_BINS];
+} TaskStatsEntry;
+
+typedef struct
+{
+    uint32_t        timeMs_;
+    uint16_t        cpuLoadPermille_;
+    uint8_t         taskCount_;
+    TaskStatsEntry  tasks_[TASK_STATS_MAX_TASKS];
+} TaskStatsSnapshot;
+
+/**
+ * Cycle counts at a reader's previous read, so each reader gets the CPU
+ * load over its own interval.
+ */
+typedef struct
+{
+    uint64_t    totalCycles_;
+    uint64_t    taskCycles_[TASK_STATS_MAX_TASKS];
+} TaskStatsWindow;
+
+extern const char TASK_STATS_LOG_HEADER[];
+
+/**
+ * Starts tracking a task. thread is the handle returned by osThreadCreate.
+ * Call before the scheduler starts.
+ */
+void taskStatsRegister(void* thread);
+
+/**
+ * Ends the calling task's current job, then behaves as osDelayUntil and
+ * starts the next job when the task wakes.
+ */
+void taskStatsDelayUntil(uint32_t* previousWakeTime, uint32_t period);
+
+/**
+ * Job boundaries for tasks released by something other than
+ * taskStatsDelayUntil, e.g. a timer interrupt. period is in ms.
+ */
+void taskStatsStartJob(uint32_t period);
+void taskStatsEndJob(uint8_t deadlineMissed);
+
+void taskStatsRead(TaskStatsSnapshot* snapshot, TaskStatsWindow* window);
+int formatTaskStatsEntry(const TaskStatsSnapshot* snapshot, int task, uint8_t flightPhase, char* buffer);
+
+/* Hooks called by the kernel, see FreeRTOSConfig.h */
+void taskStatsStartCycleCounter(void);
+uint32_t taskStatsRunTimeCounter(void);
+void taskStatsSwitchedIn(void* tag);
+void taskStatsSwitchedOut(void* tag);
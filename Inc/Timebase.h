@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Free running microsecond clock shared by the sensor sample times, the
+ * logger, telemetry and the estimator.
+ *
+ * TIM5 is a 32 bit APB1 timer counting at 1 MHz from timebaseInit on, so
+ * timebaseMicros wraps after 71.6 minutes. The difference of two readings
+ * is right across the wrap as long as they are less than that apart, which
+ * covers sample ages and filter steps. timebaseMicros64 adds the count of
+ * TIM5 update interrupts and does not wrap.
+ *
+ * Both can be called from tasks and interrupts, before and after the
+ * scheduler starts.
+ *
+ * Capture/compare channel 1 of TIM5 is a one shot alarm on the same clock.
+ * Its interrupt runs the handler at the set timebaseMicros, without the
+ * granularity of a task period.
+ */
+
+typedef void (*TimebaseAlarmHandler)(void);
+
+void timebaseInit(void);
+uint32_t timebaseMicros(void);
+uint64_t timebaseMicros64(void);
+uint32_t timebaseMillis(void);
+
+/**
+ * Counts a wrap of the 32 bit counter. Called from the TIM5 update interrupt.
+ */
+void timebaseOverflow(void);
+
+/**
+ * Runs handler from the TIM5 interrupt once timebaseMicros reaches timeUs,
+ * or right away if it already has. Replaces an alarm that has not run yet.
+ */
+void timebaseSetAlarm(uint32_t timeUs, TimebaseAlarmHandler handler);
+
+/**
+ * Cancels the alarm if it has not run yet.
+ */
+void timebaseCancelAlarm(void);
+
+/**
+ * Runs the alarm handler once. Called from the TIM5 compare interrupt.
+ */
+void timebaseAlarm(void);
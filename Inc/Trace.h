@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Event tracer for the end to end latency of the control chains, from the
+ * sensor sample to the GPIO that acts on it.
+ *
+ * trace(id, arg) stores the DWT cycle count, a static event id and a 16 bit
+ * argument in a ring of TRACE_RING_SIZE events. It takes no lock and can be
+ * called from tasks and interrupts at any priority: the slot is claimed
+ * with an atomic increment of the head, and the slot's lap is written last
+ * so the reader never copies a half written event. The cost is below 50
+ * cycles. When writers run a full ring ahead of the reader the oldest
+ * events are overwritten and counted as lost.
+ *
+ * A single reader drains the ring, the logger by default, which appends
+ * the events to AvionicsTraceN.bin once a second. With TRACE_TELEMETRY the
+ * transmit task drains it into TRACE_HEADER_BYTE radio messages instead,
+ * for the bench; the radio cannot keep up with every event.
+ *
+ * Cycle counts wrap every 25 s at 168 MHz, so every block of events comes
+ * with a sync point, a cycle count and a timebaseMicros64 reading taken
+ * together. Tools/TraceViewer turns the events into microseconds from the
+ * sync point and prints the latency histograms of each chain.
+ *
+ * Arguments tie the events of one pass through a chain together, e.g. the
+ * barometer sample and the filter step that used it carry the low bits of
+ * the sample time.
+ */
+
+#ifndef TRACE
+#define TRACE 1
+#endif
+
+#ifndef TRACE_TELEMETRY
+#define TRACE_TELEMETRY 0
+#endif
+
+#define TRACE_RING_BITS 10
+#define TRACE_RING_SIZE (1 << TRACE_RING_BITS)
+
+typedef enum
+{
+    TRACE_NONE = 0,
+    TRACE_BAROMETER_SAMPLE,     // arg: low 16 bits of the sample time in us
+    TRACE_FILTER_STEP,          // arg: low 16 bits of the barometer sample time the step used
+    TRACE_DROGUE_DECISION,      // arg: ApogeeAction, 1 at the predicted apogee, 2 on the velocity sign change, 0 on the timeout
+    TRACE_DROGUE_GPIO,
+    TRACE_MAIN_DECISION,        // arg: 1 if the deployment altitude was detected, 0 on the timeout
+    TRACE_MAIN_GPIO,
+    TRACE_GROUND_COMMAND,       // arg: command byte, from the USART2 interrupt
+    TRACE_FLIGHT_PHASE,         // arg: new flight phase
+    TRACE_INJECTION_VALVE,      // arg: 1 opened, 0 closed
+    TRACE_ID_COUNT
+} TraceId;
+
+typedef struct
+{
+    uint32_t    cycles_;
+    uint16_t    arg_;
+    uint8_t     id_;
+    uint8_t     lap_; // Internal to the ring
+} TraceEvent;
+
+/**
+ * AvionicsTraceN.bin is a sequence of blocks, each a TraceBlockHeader
+ * followed by count_ TraceEvents, little endian as stored in memory.
+ */
+#define TRACE_BLOCK_MAGIC 0x45435254 // "TRCE"
+
+typedef struct
+{
+    uint32_t    magic_;
+    uint32_t    count_;
+    uint32_t    lost_; // Events overwritten before this block was read
+    uint32_t    syncCycles_;
+    uint64_t    syncUs_; // timebaseMicros64 at syncCycles_
+    uint32_t    coreClockHz_;
+    uint32_t    reserved_;
+} TraceBlockHeader;
+
+// The file layout is the memory layout, on the target and on the host
+typedef char TraceEventIs8Bytes[sizeof(TraceEvent) == 8 ? 1 : -1];
+typedef char TraceBlockHeaderIs32Bytes[sizeof(TraceBlockHeader) == 32 ? 1 : -1];
+
+/**
+ * Trace telemetry message, big endian:
+ *   uint8   TRACE_HEADER_BYTE
+ *   uint8   event count, up to TRACE_SERIAL_MSG_EVENTS
+ *   uint16  events lost since the previous message, saturating
+ *   uint32  sync cycle count
+ *   uint32  sync time in us, low 32 bits of timebaseMicros64
+ *   uint8   core clock in MHz
+ *   then per event, unused ones zero:
+ *   uint32  cycle count
+ *   uint16  arg
+ *   uint8   id
+ */
+#define TRACE_HEADER_BYTE 0x3C
+#define TRACE_SERIAL_MSG_EVENTS 8
+#define TRACE_SERIAL_MSG_SIZE (13 + TRACE_SERIAL_MSG_EVENTS * 7)
+
+#if TRACE
+void trace(TraceId id, uint16_t arg);
+#else
+#define trace(id, arg) ((void) 0)
+#endif
+
+/**
+ * Copies up to maxEvents of the oldest unread events. Only one task may
+ * read.
+ *
+ * @param   lost    Set to the number of events overwritten since the previous read.
+ * @return  Number of events copied.
+ */
+int traceRead(TraceEvent* events, int maxEvents, uint32_t* lost);
+
+/**
+ * Reads the cycle counter and the microsecond timebase together.
+ */
+void traceSync(uint32_t* cycles, uint64_t* micros);
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * u-blox UBX binary protocol, as spoken by the M8 and later receivers.
+ *
+ * A frame is two sync characters, a class and an id, a little endian
+ * length, the payload and an 8-bit Fletcher checksum over everything from
+ * the class to the end of the payload. ubxParse takes one received byte at
+ * a time and hands out a frame once its checksum matched; the payload is
+ * then decoded with the ubxDecode functions, which check the length of the
+ * message they decode.
+ *
+ * The ubxCfg functions build the configuration frames the driver sends at
+ * boot, see readGpsJob.
+ */
+
+#define UBX_SYNC_1 0xB5
+#define UBX_SYNC_2 0x62
+// Sync characters, class, id and length, then the checksum after the payload
+#define UBX_HEADER_LENGTH 6
+#define UBX_CHECKSUM_LENGTH 2
+#define UBX_FRAME_OVERHEAD (UBX_HEADER_LENGTH + UBX_CHECKSUM_LENGTH)
+// Longest payload stored by the parser, NAV-PVT
+#define UBX_MAX_PAYLOAD_LENGTH 92
+// Longer frames are skipped, a length beyond this is taken as a false sync
+#define UBX_MAX_SKIPPED_LENGTH 1024
+
+#define UBX_CLASS_NAV 0x01
+#define UBX_CLASS_ACK 0x05
+#define UBX_CLASS_CFG 0x06
+
+#define UBX_NAV_PVT 0x07
+#define UBX_ACK_NAK 0x00
+#define UBX_ACK_ACK 0x01
+#define UBX_CFG_PRT 0x00
+#define UBX_CFG_MSG 0x01
+#define UBX_CFG_RATE 0x08
+
+#define UBX_NAV_PVT_LENGTH 92
+#define UBX_ACK_LENGTH 2
+#define UBX_CFG_PRT_LENGTH 20
+#define UBX_CFG_MSG_LENGTH 3
+#define UBX_CFG_RATE_LENGTH 6
+// Largest frame built by the ubxCfg functions
+#define UBX_CFG_MAX_FRAME_LENGTH (UBX_FRAME_OVERHEAD + UBX_CFG_PRT_LENGTH)
+
+// CFG-PRT protocol masks
+#define UBX_PROTOCOL_UBX 0x0001
+#define UBX_PROTOCOL_NMEA 0x0002
+
+// NAV-PVT fixType_
+#define UBX_FIX_NONE 0
+#define UBX_FIX_DEAD_RECKONING 1
+#define UBX_FIX_2D 2
+#define UBX_FIX_3D 3
+#define UBX_FIX_GNSS_DEAD_RECKONING 4
+#define UBX_FIX_TIME_ONLY 5
+
+// NAV-PVT valid_
+#define UBX_VALID_DATE 0x01
+#define UBX_VALID_TIME 0x02
+
+// NAV-PVT flags_
+#define UBX_FLAGS_FIX_OK 0x01
+#define UBX_FLAGS_DIFFERENTIAL 0x02
+#define UBX_FLAGS_CARRIER_SHIFT 6 // 1 float, 2 fixed carrier phase solution
+#define UBX_FLAGS_CARRIER_MASK 0x03
+
+typedef enum
+{
+    UBX_PENDING = 0,        // The frame is not complete yet
+    UBX_OK,                 // A frame was received
+    UBX_UNSUPPORTED,        // A frame too long to store was received, it was skipped
+    UBX_CHECKSUM_ERROR,
+    UBX_FORMAT_ERROR        // Length beyond UBX_MAX_SKIPPED_LENGTH
+} UbxResult;
+
+typedef struct
+{
+    uint8_t     class_;
+    uint8_t     id_;
+    uint16_t    length_;
+    uint8_t     payload_[UBX_MAX_PAYLOAD_LENGTH];
+} UbxFrame;
+
+typedef struct
+{
+    uint8_t     state_;
+    uint16_t    index_; // Payload bytes received
+    uint8_t     checksumA_;
+    uint8_t     checksumB_;
+    UbxFrame    frame_; // Being received
+} UbxParser;
+
+/**
+ * Navigation position velocity time solution. The fields the driver uses,
+ * in the units of the message.
+ */
+typedef struct
+{
+    uint32_t    iTow_; // GPS time of week of the navigation epoch, ms
+    uint16_t    year_;
+    uint8_t     month_;
+    uint8_t     day_;
+    uint8_t     hour_;
+    uint8_t     minute_;
+    uint8_t     second_;
+    uint8_t     valid_;
+    int32_t     nano_; // Fraction of the second, -1e9 to 1e9 ns
+    uint8_t     fixType_;
+    uint8_t     flags_;
+    uint8_t     satellites_;
+    int32_t     longitude_; // 1e-7 degree
+    int32_t     latitude_; // 1e-7 degree
+    int32_t     height_; // Above the ellipsoid, mm
+    int32_t     heightMsl_; // Above mean sea level, mm
+    uint32_t    horizontalAccuracy_; // mm
+    uint32_t    verticalAccuracy_; // mm
+    int32_t     velocityNorth_; // mm/s
+    int32_t     velocityEast_; // mm/s
+    int32_t     velocityDown_; // mm/s
+    int32_t     groundSpeed_; // mm/s
+    int32_t     headingMotion_; // 1e-5 degree
+    uint32_t    speedAccuracy_; // mm/s
+    uint16_t    pdop_; // x100
+} UbxNavPvt;
+
+/**
+ * ACK-ACK or ACK-NAK, the class and id of the acknowledged message.
+ */
+typedef struct
+{
+    uint8_t     acknowledged_;
+    uint8_t     class_;
+    uint8_t     id_;
+} UbxAck;
+
+void ubxInit(UbxParser* parser);
+
+/**
+ * Feeds one byte. When a frame completes with a matching checksum it is
+ * copied to frame and UBX_OK is returned; frame is not touched otherwise.
+ * After an error the parser looks for the next sync characters.
+ */
+UbxResult ubxParse(UbxParser* parser, uint8_t byte, UbxFrame* frame);
+
+/**
+ * @return  1 if frame is a NAV-PVT of the expected length, 0 otherwise.
+ */
+int ubxDecodeNavPvt(const UbxFrame* frame, UbxNavPvt* pvt);
+
+/**
+ * @return  1 if frame is an ACK-ACK or ACK-NAK, 0 otherwise.
+ */
+int ubxDecodeAck(const UbxFrame* frame, UbxAck* ack);
+
+/**
+ * Builds a frame with its header and checksum.
+ *
+ * @return  Frame length, UBX_FRAME_OVERHEAD + length.
+ */
+uint16_t ubxBuildFrame(uint8_t messageClass, uint8_t id, const uint8_t* payload, uint16_t length, uint8_t* frame);
+
+/**
+ * CFG-PRT for the receiver's UART1, 8 data bits, no parity, one stop bit.
+ */
+uint16_t ubxCfgPrt(uint32_t baudRate, uint16_t inProtocols, uint16_t outProtocols, uint8_t* frame);
+
+/**
+ * CFG-RATE, one navigation solution per measurement, aligned to GPS time.
+ */
+uint16_t ubxCfgRate(uint16_t measurementPeriodMs, uint8_t* frame);
+
+/**
+ * CFG-MSG, output of a message on the current port every rate navigation
+ * solutions, 0 to disable it.
+ */
+uint16_t ubxCfgMsg(uint8_t messageClass, uint8_t id, uint8_t rate, uint8_t* frame);
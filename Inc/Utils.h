@@ -2,3 +2,4 @@
 
 uint16_t averageArray(uint16_t array[], int size);
 void writeInt32ToArray(uint8_t* array, int startIndex, int32_t value);
+void writeUint16ToArray(uint8_t* array, int startIndex, uint16_t value);
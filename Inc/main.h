@@ -53,6 +53,7 @@ extern "C" {
 void Error_Handler(void);
 
 /* USER CODE BEGIN EFP */
+void uartIdleCallback(UART_HandleTypeDef* huart);
 
 /* USER CODE END EFP */
 
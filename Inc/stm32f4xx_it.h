@@ -56,6 +56,9 @@ void DebugMon_Handler(void);
 void DMA1_Stream2_IRQHandler(void);
 void TIM1_UP_TIM10_IRQHandler(void);
 void USART2_IRQHandler(void);
+void UART4_IRQHandler(void);
+void TIM5_IRQHandler(void);
+void TIM7_IRQHandler(void);
 /* USER CODE BEGIN EFP */
 
 /* USER CODE END EFP */
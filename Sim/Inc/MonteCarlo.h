@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "stm32f4xx_hal.h"
+#include "cmsis_os.h"
+#include "Trace.h"
+
+/**
+ * Cooperative stand-in for FreeRTOS, the TIM5 alarm, the task statistics
+ * and the tracer, for the Monte Carlo flights of Sim/Src/MonteCarloMain.c.
+ *
+ * The firmware tasks run unchanged as coroutines on a simulated clock in
+ * microseconds. A task runs without using any simulated time until it
+ * calls osDelay or taskStatsDelayUntil, which park it until its tick; the
+ * tick is 1 ms as on the flight computer. Interrupts are the caller's
+ * events between two calls of monteCarloRtosRun, and the timebase alarm,
+ * whose handler runs when the clock reaches it or at once from
+ * timebaseSetAlarm if it is already due.
+ *
+ * Everything is in file statics, like the firmware modules, so one process
+ * flies one flight.
+ */
+
+#define MONTE_CARLO_MAX_TASKS 4
+#define MONTE_CARLO_STACK_SIZE (256 * 1024)
+#define MONTE_CARLO_NEVER UINT64_MAX
+
+/**
+ * Adds a task. Tasks due at the same tick run in the order they were added.
+ */
+void monteCarloTaskCreate(os_pthread function, const void* argument);
+
+/**
+ * Returns the time of the next task wake up or alarm, MONTE_CARLO_NEVER if
+ * there is none.
+ */
+uint64_t monteCarloRtosNextEventUs(void);
+
+/**
+ * Sets the clock to timeUs, which may not go back, runs the alarm if it is
+ * due, then every task whose wake up is due.
+ */
+void monteCarloRtosRun(uint64_t timeUs);
+
+/* Provided by the flight model ----------------------------------------------*/
+
+/**
+ * Called for every HAL_GPIO_WritePin of the firmware.
+ */
+void monteCarloGpio(GPIO_TypeDef* port, uint16_t pin, GPIO_PinState state);
+
+/**
+ * Called for every trace event of the firmware.
+ */
+void monteCarloTrace(TraceId id, uint16_t arg);
+
+/**
+ * Returns 1 if a sensor task holds the mutex at this osMutexWait.
+ */
+int monteCarloMutexBusy(osMutexId mutex);
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Simulated time base and interrupt sources for the host build.
+ *
+ * Firmware code takes no simulated time by itself. Time moves forward when
+ * a HAL operation models a bus transfer or conversion (simAdvance), or when
+ * every task is blocked and the idle task skips to the next tick or event.
+ * Ticks and scheduled events are delivered as interrupts on whichever task
+ * is running, with the same masking rules as the Cortex-M4.
+ */
+
+#define SIM_NS_PER_US 1000ULL
+#define SIM_NS_PER_MS 1000000ULL
+#define SIM_NS_PER_TICK SIM_NS_PER_MS
+#define SIM_MAX_EVENTS 256
+
+typedef void (*SimEventHandler)(void* context, uint32_t value);
+
+/* Time ----------------------------------------------------------------------*/
+uint64_t simNow(void);
+void simAdvance(uint64_t ns);
+void simIdle(void);
+void simResetTime(void);
+void simSetDuration(uint64_t ns);
+void simUpdateCounters(void);
+
+/**
+ * Runs handler in interrupt context once simulated time reaches timeNs.
+ */
+void simSchedule(uint64_t timeNs, SimEventHandler handler, void* context, uint32_t value);
+
+/* Interrupt delivery, called by the port ------------------------------------*/
+int simInterruptPending(void);
+void simDispatchInterrupt(void);
+
+/* Port services used by the simulation --------------------------------------*/
+void vPortServiceInterrupts(void);
+void vPortChargeSimTime(uint64_t ns);
+void vPortFinishSimulation(void);
+void vPortPrintTaskStats(FILE* out, double hostSeconds);
+
+/* Provided by SimMain.c -----------------------------------------------------*/
+extern int simTrace;
+void simShutdown(void);
@@ -0,0 +1,200 @@
+#pragma once
+
+/**
+ * Host replacement for cmsis_gcc.h.
+ *
+ * Pre-included into every translation unit of the host build so the real
+ * CMSIS and HAL headers can be used unchanged. Defining the cmsis_gcc.h
+ * include guard keeps the ARM inline assembly out; the intrinsics the
+ * firmware and the FreeRTOS CMSIS-RTOS layer rely on are mapped onto the
+ * simulated interrupt state kept by the port in Sim/Port/port.c.
+ */
+
+#define __CMSIS_GCC_H
+
+#include <stdint.h>
+
+#define __ASM                   __asm
+#define __INLINE                inline
+#define __STATIC_INLINE         static inline
+#define __STATIC_FORCEINLINE    __attribute__((always_inline)) static inline
+#define __NO_RETURN             __attribute__((__noreturn__))
+#define __USED                  __attribute__((used))
+#define __WEAK                  __attribute__((weak))
+#define __PACKED                __attribute__((packed, aligned(1)))
+#define __PACKED_STRUCT         struct __attribute__((packed, aligned(1)))
+#define __PACKED_UNION          union __attribute__((packed, aligned(1)))
+#define __ALIGNED(x)            __attribute__((aligned(x)))
+#define __RESTRICT              __restrict
+
+struct __attribute__((packed)) T_UINT32 { uint32_t v; };
+__PACKED_STRUCT T_UINT16_WRITE { uint16_t v; };
+__PACKED_STRUCT T_UINT16_READ { uint16_t v; };
+__PACKED_STRUCT T_UINT32_WRITE { uint32_t v; };
+__PACKED_STRUCT T_UINT32_READ { uint32_t v; };
+#define __UNALIGNED_UINT32(x)                   (((struct T_UINT32*)(x))->v)
+#define __UNALIGNED_UINT16_WRITE(addr, val)     (void)((((struct T_UINT16_WRITE*)(void*)(addr))->v) = (val))
+#define __UNALIGNED_UINT16_READ(addr)           (((const struct T_UINT16_READ*)(const void*)(addr))->v)
+#define __UNALIGNED_UINT32_WRITE(addr, val)     (void)((((struct T_UINT32_WRITE*)(void*)(addr))->v) = (val))
+#define __UNALIGNED_UINT32_READ(addr)           (((const struct T_UINT32_READ*)(const void*)(addr))->v)
+
+/* Simulated core state, implemented by the port */
+uint32_t simGetIpsr(void);
+uint32_t simGetPrimask(void);
+void simSetPrimask(uint32_t primask);
+
+__STATIC_FORCEINLINE uint32_t __get_IPSR(void)
+{
+    return simGetIpsr();
+}
+
+__STATIC_FORCEINLINE uint32_t __get_PRIMASK(void)
+{
+    return simGetPrimask();
+}
+
+__STATIC_FORCEINLINE void __set_PRIMASK(uint32_t priMask)
+{
+    simSetPrimask(priMask);
+}
+
+__STATIC_FORCEINLINE void __disable_irq(void)
+{
+    simSetPrimask(1);
+}
+
+__STATIC_FORCEINLINE void __enable_irq(void)
+{
+    simSetPrimask(0);
+}
+
+__STATIC_FORCEINLINE uint32_t __get_BASEPRI(void)
+{
+    return simGetPrimask();
+}
+
+__STATIC_FORCEINLINE void __set_BASEPRI(uint32_t basePri)
+{
+    simSetPrimask(basePri != 0);
+}
+
+__STATIC_FORCEINLINE void __set_BASEPRI_MAX(uint32_t basePri)
+{
+    if (basePri != 0)
+    {
+        simSetPrimask(1);
+    }
+}
+
+__STATIC_FORCEINLINE uint32_t __get_CONTROL(void)
+{
+    return 0;
+}
+
+__STATIC_FORCEINLINE void __set_CONTROL(uint32_t control)
+{
+    (void) control;
+}
+
+__STATIC_FORCEINLINE uint32_t __get_MSP(void)
+{
+    return 0;
+}
+
+__STATIC_FORCEINLINE void __set_MSP(uint32_t topOfMainStack)
+{
+    (void) topOfMainStack;
+}
+
+__STATIC_FORCEINLINE uint32_t __get_PSP(void)
+{
+    return 0;
+}
+
+__STATIC_FORCEINLINE void __set_PSP(uint32_t topOfProcStack)
+{
+    (void) topOfProcStack;
+}
+
+__STATIC_FORCEINLINE uint32_t __get_FPSCR(void)
+{
+    return 0;
+}
+
+__STATIC_FORCEINLINE void __set_FPSCR(uint32_t fpscr)
+{
+    (void) fpscr;
+}
+
+#define __NOP()         __asm volatile ("" ::: "memory")
+#define __WFI()         __NOP()
+#define __WFE()         __NOP()
+#define __SEV()         __NOP()
+#define __BKPT(value)   __builtin_trap()
+
+__STATIC_FORCEINLINE void __ISB(void)
+{
+    __asm volatile ("" ::: "memory");
+}
+
+__STATIC_FORCEINLINE void __DSB(void)
+{
+    __sync_synchronize();
+}
+
+__STATIC_FORCEINLINE void __DMB(void)
+{
+    __sync_synchronize();
+}
+
+__STATIC_FORCEINLINE uint32_t __REV(uint32_t value)
+{
+    return __builtin_bswap32(value);
+}
+
+__STATIC_FORCEINLINE uint32_t __REV16(uint32_t value)
+{
+    return ((value & 0xFF00FF00U) >> 8) | ((value & 0x00FF00FFU) << 8);
+}
+
+__STATIC_FORCEINLINE int16_t __REVSH(int16_t value)
+{
+    return (int16_t) __builtin_bswap16((uint16_t) value);
+}
+
+__STATIC_FORCEINLINE uint32_t __ROR(uint32_t op1, uint32_t op2)
+{
+    op2 %= 32U;
+    return op2 == 0U ? op1 : (op1 >> op2) | (op1 << (32U - op2));
+}
+
+__STATIC_FORCEINLINE uint32_t __RBIT(uint32_t value)
+{
+    uint32_t result = 0;
+
+    for (int i = 0; i < 32; i++)
+    {
+        result = (result << 1) | ((value >> i) & 1U);
+    }
+
+    return result;
+}
+
+// CLZ of zero is 32 on the Cortex-M4 but undefined for the builtin
+__STATIC_FORCEINLINE uint8_t __CLZ(uint32_t value)
+{
+    return value == 0U ? 32U : (uint8_t) __builtin_clz(value);
+}
+
+__STATIC_FORCEINLINE int32_t __SSAT(int32_t val, uint32_t sat)
+{
+    const int32_t max = (int32_t) ((1U << (sat - 1U)) - 1U);
+    const int32_t min = -1 - max;
+    return val > max ? max : val < min ? min : val;
+}
+
+__STATIC_FORCEINLINE uint32_t __USAT(int32_t val, uint32_t sat)
+{
+    const uint32_t max = (1U << sat) - 1U;
+    return val > (int32_t) max ? max : val < 0 ? 0U : (uint32_t) val;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Register-level models of the devices on the flight board's SPI buses
+ * and UARTs. Each answers the command bytes the firmware sends, with the
+ * conversion and access times of its datasheet, and measures the vehicle
+ * state from SimTrajectory.h.
+ */
+
+/**
+ * LSM9DS1 accelerometer/gyroscope (IMU_CS) and magnetometer (MAG_CS) on SPI1.
+ */
+void simLsm9ds1Attach(void);
+
+/**
+ * MS5607-02BA03 barometer on SPI2 (BARO_CS).
+ */
+void simMs5607Attach(void);
+void simMs5607PrintStats(FILE* out);
+
+/**
+ * SDHC card in SPI mode on SPI3, backed by a disk image file. A new image
+ * is created with the given size and formatted through the card model
+ * before the flight starts.
+ */
+int simSdCardOpen(const char* path, uint64_t sizeBytes);
+int simSdCardExtract(const char* directory);
+int simSdCardInsert(const char* path);
+void simSdCardPrintStats(FILE* out);
+uint64_t simSdCardSectorsRead(void);
+
+/**
+ * Times the boot selection of the log file index on a new image filled
+ * with count earlier logs, with and without the index file
+ * (SimLogIndexBench.c).
+ */
+int simLogIndexBench(uint32_t count);
+
+typedef enum
+{
+    SIM_UBLOX_M8,           // Takes the UBX configuration messages
+    SIM_UBLOX_NMEA_ONLY     // Ignores them, as a receiver without UBX input
+} SimUbloxMode;
+
+/**
+ * u-blox M8 GNSS receiver on UART4. Starts with NMEA GGA and RMC at 9600
+ * baud and 1 Hz, as out of the box, with a fix on the pad from the first
+ * epoch on.
+ */
+void simUbloxAttach(SimUbloxMode mode);
+void simUbloxPrintStats(FILE* out);
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "stm32f4xx_hal.h"
+
+/**
+ * Stub HAL for the host build.
+ *
+ * Implements the HAL calls made by the firmware on top of the simulated
+ * clock in Sim.h. Bus operations take the time they would on the STM32 at
+ * the clock tree set up by SystemClock_Config and the configured baud
+ * rates; the data comes from attached device models, scripted input or a
+ * fixed idle value.
+ */
+
+#define SIM_ADC_CONVERSION_NS 1500U // 15 ADCCLK cycles at 21 MHz for a 3 cycle sample time, plus HAL overhead
+#define SIM_SPI_IDLE_BYTE 0xFF // MISO is pulled high when no device drives it
+#define SIM_SPI_PRESCALER_COUNT 8 // CR1 BR values, SCK = PCLK / (2 << BR)
+
+/**
+ * A device on an SPI bus. The device is selected while its chip select pin
+ * is driven low and sees every byte clocked on its bus while selected.
+ * Traffic is accounted per baud rate prescaler in effect at the time.
+ */
+typedef struct SimSpiDevice
+{
+    const char*             name_;
+    SPI_TypeDef*            bus_;
+    GPIO_TypeDef*           csPort_;
+    uint16_t                csPin_;
+    void                    (*select_)(struct SimSpiDevice* device, int selected);
+    uint8_t                 (*exchange_)(struct SimSpiDevice* device, uint8_t mosi);
+    void*                   state_;
+    int                     selected_;
+    uint64_t                bytes_[SIM_SPI_PRESCALER_COUNT];
+    uint64_t                busyNs_[SIM_SPI_PRESCALER_COUNT];
+    struct SimSpiDevice*    next_;
+} SimSpiDevice;
+
+void simSpiAttach(SimSpiDevice* device);
+uint64_t simSpiByteTime(SPI_TypeDef* bus);
+
+/**
+ * Clocks one byte on the bus at the rate programmed in its CR1, for
+ * drivers that use the data register directly (tm_stm32_spi).
+ */
+uint8_t simSpiExchange(SPI_TypeDef* bus, uint8_t mosi);
+
+/**
+ * A device on a UART. receive_ sees every byte the firmware transmits, at
+ * the end of its frame, with the baud rate it was sent at, and answers
+ * through simUartInject.
+ */
+typedef struct SimUartDevice
+{
+    const char*     name_;
+    USART_TypeDef*  uart_;
+    void            (*receive_)(struct SimUartDevice* device, uint8_t byte, uint32_t baudRate);
+    void*           state_;
+} SimUartDevice;
+
+void simUartAttach(SimUartDevice* device);
+
+/**
+ * The baud rate the firmware receives at, 0 before the UART is
+ * initialized.
+ */
+uint32_t simUartBaudRate(USART_TypeDef* instance);
+
+void simGpioSetInput(GPIO_TypeDef* port, uint16_t pin, GPIO_PinState state);
+void simUartInject(USART_TypeDef* instance, const uint8_t* data, uint16_t length);
+void simUartSetOutput(USART_TypeDef* instance, FILE* out);
+void simAdcSet(ADC_TypeDef* instance, uint16_t value);
+
+void simHalResetStats(void);
+void simHalPrintStats(FILE* out, double simSeconds);
@@ -0,0 +1,57 @@
+#pragma once
+
+/**
+ * Replacement for tm_stm32_spi.h in the host build, preincluded when
+ * compiling fatfs_sd.c. The library polls SR and exchanges data through DR,
+ * which is plain memory here, so bytes are clocked through the simulated
+ * bus instead. Defining the include guard keeps the library header out.
+ */
+
+#define TM_SPI_H 100
+
+#include "stm32f4xx_hal.h"
+#include "tm_stm32_gpio.h"
+
+#include "SimHal.h"
+
+// Same defaults as tm_stm32_spi.h, defines.h does not override them
+#ifndef TM_SPI3_PRESCALER
+#define TM_SPI3_PRESCALER SPI_BAUDRATEPRESCALER_32
+#endif
+
+#ifndef TM_SPI3_MODE
+#define TM_SPI3_MODE TM_SPI_Mode_0
+#endif
+
+typedef enum
+{
+    TM_SPI_Mode_0 = 0x00,
+    TM_SPI_Mode_1,
+    TM_SPI_Mode_2,
+    TM_SPI_Mode_3
+} TM_SPI_Mode_t;
+
+typedef enum
+{
+    TM_SPI_PinsPack_1 = 0x00,
+    TM_SPI_PinsPack_2,
+    TM_SPI_PinsPack_3,
+    TM_SPI_PinsPack_4,
+    TM_SPI_PinsPack_Custom
+} TM_SPI_PinsPack_t;
+
+typedef enum
+{
+    TM_SPI_DataSize_8b = 0x00,
+    TM_SPI_DataSize_16b
+} TM_SPI_DataSize_t;
+
+void TM_SPI_Init(SPI_TypeDef* SPIx, TM_SPI_PinsPack_t pinspack);
+void TM_SPI_SendMulti(SPI_TypeDef* SPIx, uint8_t* dataOut, uint8_t* dataIn, uint32_t count);
+void TM_SPI_WriteMulti(SPI_TypeDef* SPIx, uint8_t* dataOut, uint32_t count);
+void TM_SPI_ReadMulti(SPI_TypeDef* SPIx, uint8_t* dataIn, uint8_t dummy, uint32_t count);
+
+static inline uint8_t TM_SPI_Send(SPI_TypeDef* SPIx, uint8_t data)
+{
+    return simSpiExchange(SPIx, data);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Physical state of the vehicle that the sensor models measure, in sensor
+ * frame and SI-ish units.
+ */
+typedef struct
+{
+    double  altitudeM_;
+    double  pressurePa_;
+    double  temperatureC_;
+    double  accelG_[3];
+    double  gyroDps_[3];
+    double  magGauss_[3];
+} SimVehicleState;
+
+/**
+ * Loads a trajectory CSV. Columns are matched by header name, so both
+ * scripted profiles and flight logs recorded by the firmware can be used:
+ *
+ *   time_s | elapsedTime(ms)
+ *   altitude_m
+ *   pressure_pa | pressure (the firmware log, 0.01 mbar)
+ *   temperature_c | temperature(100C)
+ *   accel_x_g .. accel_z_g | accelX .. accelZ (mg)
+ *   gyro_x_dps .. gyro_z_dps | gyroX .. gyroZ (mdps)
+ *   mag_x_gauss .. mag_z_gauss | magnetoX .. magnetoZ (mgauss)
+ *
+ * Missing columns keep the vehicle at rest on the pad; pressure is derived
+ * from altitude when only the latter is given.
+ */
+int simTrajectoryLoad(const char* path);
+
+/**
+ * State at the given simulated time, linearly interpolated between rows.
+ */
+void simTrajectorySample(uint64_t timeNs, SimVehicleState* state);
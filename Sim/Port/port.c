@@ -0,0 +1,440 @@
+/**
+  ******************************************************************************
+  * File Name          : port.c
+  * Description        : FreeRTOS port for the host software-in-the-loop build.
+  *
+  *   One pthread per task with a strict single-runner handoff: a context
+  *   switch wakes the thread of the new pxCurrentTCB and parks the old one.
+  *   Interrupt masking, critical nesting and pended yields follow the
+  *   ARM_CM4F port so kernel code paths behave as on the flight computer.
+  ******************************************************************************
+*/
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "Sim.h"
+
+#define SIM_THREAD_STACK_SIZE (1024 * 1024)
+#define SIM_IRQ_NUMBER 15 // Reported through __get_IPSR while an interrupt is being delivered
+
+typedef struct SimThread
+{
+    pthread_t           thread_;
+    pthread_cond_t      wake_;
+    int                 running_;
+    int                 deleted_;
+    TaskFunction_t      code_;
+    void*               parameters_;
+    void*               tcb_;
+    uint64_t            switches_;
+    uint64_t            hostCpuNs_;
+    uint64_t            simBusyNs_;
+    struct SimThread*   next_;
+} SimThread;
+
+static pthread_mutex_t schedulerLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t finishedCondition = PTHREAD_COND_INITIALIZER;
+static SimThread* threads = NULL;
+
+static int schedulerRunning = 0;
+static int finished = 0;
+static uint32_t criticalNesting = 0;
+static uint32_t interruptsMasked = 0;
+static uint32_t ipsr = 0;
+static int yieldPending = 0;
+
+static uint64_t accountingStart = 0;
+static uint64_t interruptCpuNs = 0;
+static uint64_t interruptSimNs = 0;
+static uint64_t interruptCount = 0;
+
+static uint64_t threadCpuNow(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static SimThread* threadOf(void* tcb)
+{
+    // pxTopOfStack is the first TCB member and points at the SimThread slot
+    StackType_t* topOfStack = *(StackType_t**) tcb;
+    return *(SimThread**) topOfStack;
+}
+
+static SimThread* currentThread(void)
+{
+    return threadOf(xTaskGetCurrentTaskHandle());
+}
+
+static void chargeRunningTask(void)
+{
+    uint64_t now = threadCpuNow();
+    currentThread()->hostCpuNs_ += now - accountingStart;
+    accountingStart = now;
+}
+
+/**
+ * Blocks the calling thread until it is scheduled again.
+ * Must be called with schedulerLock held.
+ */
+static void waitUntilScheduled(SimThread* self)
+{
+    while (!self->running_ && !self->deleted_)
+    {
+        pthread_cond_wait(&self->wake_, &schedulerLock);
+    }
+
+    if (self->deleted_)
+    {
+        pthread_mutex_unlock(&schedulerLock);
+        pthread_exit(NULL);
+    }
+}
+
+static void switchContext(void)
+{
+    SimThread* self = currentThread();
+
+    vTaskSwitchContext();
+
+    SimThread* next = currentThread();
+
+    if (next == self)
+    {
+        return;
+    }
+
+    self->hostCpuNs_ += threadCpuNow() - accountingStart;
+
+    pthread_mutex_lock(&schedulerLock);
+    self->running_ = 0;
+    next->running_ = 1;
+    next->switches_++;
+    pthread_cond_signal(&next->wake_);
+    waitUntilScheduled(self);
+    pthread_mutex_unlock(&schedulerLock);
+
+    accountingStart = threadCpuNow();
+}
+
+static void* taskThread(void* arg)
+{
+    SimThread* self = arg;
+
+    pthread_mutex_lock(&schedulerLock);
+    waitUntilScheduled(self);
+    pthread_mutex_unlock(&schedulerLock);
+
+    accountingStart = threadCpuNow();
+
+    self->code_(self->parameters_);
+
+    // Tasks must never return, same as prvTaskExitError on the target
+    configASSERT(0);
+    return NULL;
+}
+
+StackType_t* pxPortInitialiseStack(StackType_t* pxTopOfStack, TaskFunction_t pxCode, void* pvParameters)
+{
+    SimThread* thread = calloc(1, sizeof(SimThread));
+    pthread_attr_t attributes;
+
+    configASSERT(thread != NULL);
+    thread->code_ = pxCode;
+    thread->parameters_ = pvParameters;
+    pthread_cond_init(&thread->wake_, NULL);
+
+    pthread_attr_init(&attributes);
+    pthread_attr_setstacksize(&attributes, SIM_THREAD_STACK_SIZE);
+    pthread_create(&thread->thread_, &attributes, taskThread, thread);
+    pthread_attr_destroy(&attributes);
+
+    thread->next_ = threads;
+    threads = thread;
+
+    // The task runs on its host thread stack, the FreeRTOS stack only holds the thread handle
+    SimThread** slot = (SimThread**) (((uintptr_t) pxTopOfStack - sizeof(SimThread*)) & ~(uintptr_t) (sizeof(SimThread*) - 1));
+    *slot = thread;
+    return (StackType_t*) slot;
+}
+
+void vPortTaskCreated(void* pxTCB)
+{
+    threadOf(pxTCB)->tcb_ = pxTCB;
+}
+
+void vPortCleanUpTCB(void* pxTCB)
+{
+    SimThread* thread = threadOf(pxTCB);
+
+    pthread_mutex_lock(&schedulerLock);
+    thread->deleted_ = 1;
+    thread->tcb_ = NULL;
+    pthread_cond_signal(&thread->wake_);
+    pthread_mutex_unlock(&schedulerLock);
+}
+
+BaseType_t xPortStartScheduler(void)
+{
+    SimThread* first = currentThread();
+
+    criticalNesting = 0;
+    interruptsMasked = 0;
+    schedulerRunning = 1;
+
+    pthread_mutex_lock(&schedulerLock);
+    first->running_ = 1;
+    first->switches_++;
+    pthread_cond_signal(&first->wake_);
+
+    while (!finished)
+    {
+        pthread_cond_wait(&finishedCondition, &schedulerLock);
+    }
+
+    pthread_mutex_unlock(&schedulerLock);
+
+    simShutdown();
+    return pdFALSE;
+}
+
+void vPortEndScheduler(void)
+{
+    vPortFinishSimulation();
+}
+
+/**
+ * Stops the simulation from the running thread. The main thread reports and
+ * exits, the calling thread never runs again.
+ */
+void vPortFinishSimulation(void)
+{
+    SimThread* self = currentThread();
+
+    self->hostCpuNs_ += threadCpuNow() - accountingStart;
+
+    pthread_mutex_lock(&schedulerLock);
+    finished = 1;
+    self->running_ = 0;
+    pthread_cond_signal(&finishedCondition);
+
+    for (;;)
+    {
+        pthread_cond_wait(&self->wake_, &schedulerLock);
+    }
+}
+
+/* Interrupts ----------------------------------------------------------------*/
+
+/**
+ * Delivers every tick and event that is due, then performs any context
+ * switch requested by them. Does nothing while interrupts are masked; the
+ * pending interrupts are taken as soon as they are unmasked.
+ */
+void vPortServiceInterrupts(void)
+{
+    if (!schedulerRunning || interruptsMasked || criticalNesting != 0 || ipsr != 0)
+    {
+        return;
+    }
+
+    if (simInterruptPending())
+    {
+        chargeRunningTask();
+
+        while (simInterruptPending())
+        {
+            ipsr = SIM_IRQ_NUMBER;
+            interruptCount++;
+            simDispatchInterrupt();
+            ipsr = 0;
+        }
+
+        uint64_t now = threadCpuNow();
+        interruptCpuNs += now - accountingStart;
+        accountingStart = now;
+    }
+
+    if (yieldPending && !interruptsMasked)
+    {
+        yieldPending = 0;
+        switchContext();
+    }
+}
+
+void xPortSysTickHandler(void)
+{
+    uint32_t mask = ulPortSetInterruptMask();
+
+    if (xTaskIncrementTick() != pdFALSE)
+    {
+        yieldPending = 1;
+    }
+
+    vPortClearInterruptMask(mask);
+}
+
+void vPortChargeSimTime(uint64_t ns)
+{
+    if (!schedulerRunning)
+    {
+        return;
+    }
+
+    if (ipsr != 0)
+    {
+        interruptSimNs += ns;
+    }
+    else
+    {
+        currentThread()->simBusyNs_ += ns;
+    }
+}
+
+uint32_t simGetIpsr(void)
+{
+    return ipsr;
+}
+
+uint32_t simGetPrimask(void)
+{
+    return interruptsMasked;
+}
+
+void simSetPrimask(uint32_t primask)
+{
+    if (primask)
+    {
+        vPortDisableInterrupts();
+    }
+    else
+    {
+        vPortEnableInterrupts();
+    }
+}
+
+/* Critical sections ---------------------------------------------------------*/
+
+void vPortDisableInterrupts(void)
+{
+    interruptsMasked = 1;
+}
+
+void vPortEnableInterrupts(void)
+{
+    interruptsMasked = 0;
+
+    if (ipsr == 0)
+    {
+        vPortServiceInterrupts();
+    }
+}
+
+void vPortEnterCritical(void)
+{
+    vPortDisableInterrupts();
+    criticalNesting++;
+}
+
+void vPortExitCritical(void)
+{
+    configASSERT(criticalNesting != 0);
+    criticalNesting--;
+
+    if (criticalNesting == 0)
+    {
+        vPortEnableInterrupts();
+    }
+}
+
+uint32_t ulPortSetInterruptMask(void)
+{
+    uint32_t previous = interruptsMasked;
+    interruptsMasked = 1;
+    return previous;
+}
+
+void vPortClearInterruptMask(uint32_t ulMask)
+{
+    interruptsMasked = ulMask;
+}
+
+/* Yield ---------------------------------------------------------------------*/
+
+void vPortYield(void)
+{
+    // Like PendSV, the switch happens once interrupts are unmasked
+    if (!schedulerRunning || interruptsMasked || criticalNesting != 0 || ipsr != 0)
+    {
+        yieldPending = 1;
+        return;
+    }
+
+    switchContext();
+}
+
+void vPortYieldFromISR(void)
+{
+    yieldPending = 1;
+}
+
+void vPortAssert(const char* pcFile, int ulLine)
+{
+    fprintf(stderr, "sim: assertion failed at %s:%d (%.3f s)\n", pcFile, ulLine, simNow() / 1e9);
+    abort();
+}
+
+/* Idle ----------------------------------------------------------------------*/
+
+void vApplicationIdleHook(void)
+{
+    simIdle();
+}
+
+/* Statistics ----------------------------------------------------------------*/
+
+void vPortPrintTaskStats(FILE* out, double hostSeconds)
+{
+    uint64_t totalCpuNs = interruptCpuNs;
+
+    for (SimThread* thread = threads; thread; thread = thread->next_)
+    {
+        totalCpuNs += thread->hostCpuNs_;
+    }
+
+    fprintf(out, "%-40s %10s %12s %7s %14s\n", "Task", "Switches", "Host CPU ms", "CPU %", "Sim busy ms");
+
+    for (SimThread* thread = threads; thread; thread = thread->next_)
+    {
+        fprintf(
+            out,
+            "%-40s %10llu %12.3f %6.2f%% %14.3f\n",
+            thread->tcb_ ? pcTaskGetName(thread->tcb_) : "(deleted)",
+            (unsigned long long) thread->switches_,
+            thread->hostCpuNs_ / 1e6,
+            totalCpuNs ? 100.0 * thread->hostCpuNs_ / totalCpuNs : 0.0,
+            thread->simBusyNs_ / 1e6
+        );
+    }
+
+    fprintf(
+        out,
+        "%-40s %10llu %12.3f %6.2f%% %14.3f\n",
+        "(interrupts)",
+        (unsigned long long) interruptCount,
+        interruptCpuNs / 1e6,
+        totalCpuNs ? 100.0 * interruptCpuNs / totalCpuNs : 0.0,
+        interruptSimNs / 1e6
+    );
+
+    fprintf(out, "Host CPU in firmware %.3f s of %.3f s wall time\n", totalCpuNs / 1e9, hostSeconds);
+}
@@ -0,0 +1,98 @@
+#ifndef PORTMACRO_H
+#define PORTMACRO_H
+
+/**
+ * FreeRTOS port for the host software-in-the-loop build.
+ *
+ * Every task runs on its own pthread but only the thread of pxCurrentTCB
+ * is ever allowed to run, so the kernel sees the same single core
+ * execution it does on the STM32. Time is simulated: ticks are generated
+ * when the running code consumes simulated time (see Sim.h) or when the
+ * idle task runs, so a flight runs as fast as the host can execute it.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Type definitions. */
+#define portCHAR        char
+#define portFLOAT       float
+#define portDOUBLE      double
+#define portLONG        long
+#define portSHORT       short
+#define portSTACK_TYPE  uint32_t
+#define portBASE_TYPE   long
+
+typedef portSTACK_TYPE StackType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+typedef uint32_t TickType_t;
+#define portMAX_DELAY ( TickType_t ) 0xffffffffUL
+#define portTICK_TYPE_IS_ATOMIC 1
+
+// Pointers are 64 bit on the host, stack words stay 32 bit like the target
+#define portPOINTER_SIZE_TYPE uintptr_t
+
+/* Architecture specifics. */
+#define portSTACK_GROWTH    ( -1 )
+#define portTICK_PERIOD_MS  ( ( TickType_t ) 1000 / configTICK_RATE_HZ )
+#define portBYTE_ALIGNMENT  8
+#define portNOP()
+
+/* The idle task is what moves simulated time forward when every task is blocked. */
+#undef configUSE_IDLE_HOOK
+#define configUSE_IDLE_HOOK 1
+
+/* A failed assertion stops the simulation with its location instead of hanging. */
+void vPortAssert( const char *pcFile, int ulLine );
+#undef configASSERT
+#define configASSERT( x ) if( ( x ) == 0 ) { vPortAssert( __FILE__, __LINE__ ); }
+
+/* Scheduler utilities. */
+void vPortYield( void );
+void vPortYieldFromISR( void );
+#define portYIELD()                 vPortYield()
+#define portEND_SWITCHING_ISR( x )  do { if( ( x ) != pdFALSE ) { vPortYieldFromISR(); } } while( 0 )
+#define portYIELD_FROM_ISR( x )     portEND_SWITCHING_ISR( x )
+
+/* Critical section management. */
+void vPortEnterCritical( void );
+void vPortExitCritical( void );
+void vPortDisableInterrupts( void );
+void vPortEnableInterrupts( void );
+uint32_t ulPortSetInterruptMask( void );
+void vPortClearInterruptMask( uint32_t ulMask );
+#define portDISABLE_INTERRUPTS()                vPortDisableInterrupts()
+#define portENABLE_INTERRUPTS()                 vPortEnableInterrupts()
+#define portENTER_CRITICAL()                    vPortEnterCritical()
+#define portEXIT_CRITICAL()                     vPortExitCritical()
+#define portSET_INTERRUPT_MASK_FROM_ISR()       ulPortSetInterruptMask()
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR( x )  vPortClearInterruptMask( x )
+
+/* Task function macros as described on the FreeRTOS.org WEB site. */
+#define portTASK_FUNCTION_PROTO( vFunction, pvParameters ) void vFunction( void *pvParameters )
+#define portTASK_FUNCTION( vFunction, pvParameters ) void vFunction( void *pvParameters )
+
+/* Port optimised task selection, same bitmap scheme as the ARM_CM4F port. */
+#if configUSE_PORT_OPTIMISED_TASK_SELECTION == 1
+    #define portRECORD_READY_PRIORITY( uxPriority, uxReadyPriorities ) ( uxReadyPriorities ) |= ( 1UL << ( uxPriority ) )
+    #define portRESET_READY_PRIORITY( uxPriority, uxReadyPriorities ) ( uxReadyPriorities ) &= ~( 1UL << ( uxPriority ) )
+    #define portGET_HIGHEST_PRIORITY( uxTopPriority, uxReadyPriorities ) \
+        uxTopPriority = ( 31UL - ( uint32_t ) __builtin_clz( ( uint32_t ) ( uxReadyPriorities ) ) )
+#endif
+
+/* Host thread bookkeeping. */
+void vPortTaskCreated( void *pxTCB );
+void vPortCleanUpTCB( void *pxTCB );
+#define traceTASK_CREATE( pxNewTCB )    vPortTaskCreated( pxNewTCB )
+#define portCLEAN_UP_TCB( pxTCB )       vPortCleanUpTCB( pxTCB )
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PORTMACRO_H */
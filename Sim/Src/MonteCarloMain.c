@@ -0,0 +1,879 @@
+/**
+  ******************************************************************************
+  * File Name          : MonteCarloMain.c
+  * Description        : Randomized flights of the flight phase logic of
+  *                      ParachutesControl.c, EngineControl.c and
+  *                      FlightPhase.c, on a simulated clock and sensor feed.
+  *
+  *   flight-montecarlo [--flights n] [--jobs n] [--seed n]
+  *                     [--dropout p] [--contention p]
+  *       Flies n vertical flights, by default DEFAULT_FLIGHTS on every
+  *       online core. Each flight draws its thrust, burn time, ignition
+  *       delay, drag, sea level pressure and the phase of the sensor
+  *       schedule to the tick. The rocket is a point mass under gravity
+  *       and quadratic drag falling off with the density, lit when the
+  *       firmware opens the injection valve and slowed by the parachutes
+  *       when it fires their GPIOs. The IMU, the barometer and the GPS
+  *       fill the Data.h structures on their own schedules with noise,
+  *       each sample lost with probability p of --dropout, and every
+  *       osMutexWait on them fails with probability p of --contention as
+  *       if the sensor task held it. The ground station arms the rocket at
+  *       ARM_US and sends the launch command a random time later.
+  *
+  *       Prints the distributions of the drogue deployment less the true
+  *       apogee and of the main deployment altitude and latency, counts
+  *       the deployment decisions, the false triggers and the missed
+  *       deployments, and the throughput in flights per second.
+  *
+  *   The firmware keeps its state in file statics, so flights cannot share
+  *   a process. The runner forks a process per flight, at most --jobs of
+  *   them at a time, and they leave their results in shared memory.
+  ******************************************************************************
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "MonteCarlo.h"
+#include "ApogeePredictor.h"
+#include "Data.h"
+#include "EngineControl.h"
+#include "FlightPhase.h"
+#include "ParachutesControl.h"
+#include "Timebase.h"
+
+#define DEFAULT_FLIGHTS 1000
+#define DEFAULT_DROPOUT 0.02
+#define DEFAULT_CONTENTION 0.05
+
+#define TRUTH_STEP_US 1000
+#define MAX_FLIGHT_US 1200000000ULL // Past the parachute timeouts
+#define ARM_US 5000000ULL
+#define LAUNCH_COMMAND_US 10000000ULL // Earliest, the filter settles on the pad before
+#define END_AFTER_MAIN_US 2000000ULL
+
+#define IMU_PERIOD_US 10000 // SensorSchedule.h
+#define BAROMETER_PERIOD_US 25000
+#define BAROMETER_SAMPLE_US 7500 // Middle of the conversion started 5 ms into the barometer period
+#define BAROMETER_READ_US 10000
+#define GPS_PERIOD_US 100000 // 10 Hz NAV-PVT
+#define GPS_LATENCY_US 70000 // From the navigation epoch to the end of the message
+
+#define PI 3.14159265358979323846
+#define GRAVITY 9.80665
+#define PAD_ALTITUDE 1401.0 // SPACE_PORT_AMERICA_ALTITUDE_ABOVE_SEA_LEVEL
+#define MAIN_DEPLOYMENT_ALTITUDE (457.0 + PAD_ALTITUDE) // ParachutesControl.c
+#define DENSITY_SCALE_HEIGHT 8500.0 // m
+#define DROGUE_DESCENT_RATE 25.0 // m/s at the pad
+#define MAIN_DESCENT_RATE 6.0 // m/s at the pad
+#define PARACHUTE_INFLATION_US 1000000.0
+#define GPS_VERTICAL_ACCURACY 5.0 // m
+#define GPS_VELOCITY_NOISE 0.2 // m/s
+
+#define FALSE_DROGUE_MARGIN_MS 1000.0 // Earlier than apogee by more is a false trigger
+#define FALSE_MAIN_MARGIN 100.0 // m, higher than the deployment altitude by more is a false trigger
+#define NONE (-1.0)
+
+typedef struct
+{
+    double      thrust_; // Specific force, m/s^2
+    uint64_t    burnUs_;
+    uint64_t    ignitionDelayUs_; // From the injection valve opening
+    double      drag_; // k of the body at sea level, 1/m
+    double      seaLevelPressure_; // Pa
+    uint64_t    imuPhaseUs_; // Of the sensor schedule to the tick
+    uint64_t    gpsPhaseUs_;
+    uint64_t    launchCommandUs_;
+    double      dropout_;
+    double      contention_;
+} FlightParameters;
+
+/**
+ * Outcome of one flight, in us from power up, m and m/s, NONE for what did
+ * not happen.
+ */
+typedef struct
+{
+    uint8_t     completed_; // 0 if the flight process died
+    uint8_t     drogueDecision_; // TRACE_DROGUE_DECISION argument
+    uint8_t     mainDecision_; // TRACE_MAIN_DECISION argument
+    uint8_t     droguePhase_; // Flight phase when the drogue GPIO was set
+    uint8_t     mainPhase_;
+    double      apogeeUs_;
+    double      apogeeAltitude_;
+    double      coastUs_;
+    double      drogueUs_;
+    double      drogueAltitude_;
+    double      drogueSpeed_;
+    double      mainCrossingUs_; // Truth reaching MAIN_DEPLOYMENT_ALTITUDE on the way down
+    double      mainUs_;
+    double      mainAltitude_;
+    double      mainSpeed_;
+    double      landingUs_;
+} FlightResult;
+
+typedef struct
+{
+    uint64_t    timeUs_;
+    double      altitude_;
+    double      velocity_;
+    double      specificForce_; // Felt by the accelerometer along up, m/s^2
+    uint8_t     valveOpen_;
+    uint64_t    ignitionUs_;
+    uint8_t     launched_;
+    uint8_t     landed_;
+} Truth;
+
+typedef struct
+{
+    uint64_t    nextUs_;
+    uint64_t    periodUs_; // 0 for a one shot event
+    void        (*handler_)(void);
+} SensorEvent;
+
+uint8_t launchCmdReceived = 0; // main.c
+
+static FlightParameters flight;
+static FlightResult* result;
+static Truth truth;
+static FlightPhase phase = PRELAUNCH; // As last traced
+static uint64_t rngState = 1;
+
+static AccelGyroMagnetismData accelGyroMagnetismData;
+static BarometerData barometerData;
+static GpsData gpsData;
+static OxidizerTankPressureData oxidizerTankPressureData;
+static ParachutesControlData parachutesControlData =
+{
+    &accelGyroMagnetismData,
+    &barometerData,
+    &gpsData
+};
+
+// Only the addresses are used, as the handles of the sensor mutexes
+static char accelGyroMagnetismMutex;
+static char barometerMutex;
+static char gpsMutex;
+static char oxidizerTankMutex;
+static char flightPhaseMutexObject;
+
+static double latchedPressure;
+static uint32_t latchedPressureUs;
+static double latchedGpsAltitude;
+static double latchedGpsVelocity;
+
+/* Random numbers ------------------------------------------------------------*/
+
+static double uniform(void)
+{
+    // xorshift64*
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return (double) ((rngState * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+static double between(double low, double high)
+{
+    return low + (high - low) * uniform();
+}
+
+static double gaussian(void)
+{
+    double u = uniform();
+    double v = uniform();
+
+    return sqrt(-2 * log(u > 0 ? u : 1e-300)) * cos(2 * PI * v);
+}
+
+/**
+ * splitmix64 of the run seed and the flight, so a flight is the same
+ * whatever the number of jobs.
+ */
+static uint64_t flightSeed(uint64_t seed, int index)
+{
+    uint64_t z = seed + (uint64_t) (index + 1) * 0x9E3779B97F4A7C15ULL;
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return z != 0 ? z : 1;
+}
+
+/* Truth ---------------------------------------------------------------------*/
+
+/**
+ * Drag coefficient at sea level of a parachute that falls at descentRate
+ * at the pad, scaled by its inflation since deployUs.
+ */
+static double parachuteDrag(double deployUs, double descentRate)
+{
+    if (deployUs == NONE || (double) truth.timeUs_ < deployUs)
+    {
+        return 0;
+    }
+
+    double inflation = fmin(1.0, ((double) truth.timeUs_ - deployUs) / PARACHUTE_INFLATION_US);
+
+    return inflation * GRAVITY / (descentRate * descentRate) * exp(PAD_ALTITUDE / DENSITY_SCALE_HEIGHT);
+}
+
+static double pressureAt(double altitude)
+{
+    // The atmosphere of the simulator
+    return flight.seaLevelPressure_ * pow(1.0 - 2.25577e-5 * altitude, 5.25588);
+}
+
+static void stepTruth(uint64_t stepUs)
+{
+    int burning =
+        truth.valveOpen_ &&
+        truth.timeUs_ >= truth.ignitionUs_ &&
+        truth.timeUs_ < truth.ignitionUs_ + flight.burnUs_;
+    double thrust = burning ? flight.thrust_ : 0;
+    double dt = stepUs / 1e6;
+
+    if (!truth.launched_ && thrust <= GRAVITY)
+    {
+        // On the pad the rail holds the rocket up
+        truth.specificForce_ = GRAVITY;
+        truth.timeUs_ += stepUs;
+        return;
+    }
+
+    truth.launched_ = 1;
+
+    double drag =
+        (flight.drag_ + parachuteDrag(result->drogueUs_, DROGUE_DESCENT_RATE) + parachuteDrag(result->mainUs_, MAIN_DESCENT_RATE)) *
+        exp(-truth.altitude_ / DENSITY_SCALE_HEIGHT) *
+        truth.velocity_ * fabs(truth.velocity_);
+    double velocity = truth.velocity_ + (thrust - drag - GRAVITY) * dt;
+    double altitude = truth.altitude_ + 0.5 * (truth.velocity_ + velocity) * dt;
+
+    truth.specificForce_ = thrust - drag;
+
+    if (result->apogeeUs_ == NONE && !burning && truth.velocity_ > 0 && velocity <= 0)
+    {
+        double fraction = truth.velocity_ / (truth.velocity_ - velocity);
+
+        result->apogeeUs_ = truth.timeUs_ + fraction * stepUs;
+        result->apogeeAltitude_ = truth.altitude_ + 0.5 * truth.velocity_ * fraction * dt;
+    }
+
+    if (result->mainCrossingUs_ == NONE && result->apogeeUs_ != NONE &&
+        truth.altitude_ > MAIN_DEPLOYMENT_ALTITUDE && altitude <= MAIN_DEPLOYMENT_ALTITUDE)
+    {
+        result->mainCrossingUs_ = truth.timeUs_ + (truth.altitude_ - MAIN_DEPLOYMENT_ALTITUDE) / (truth.altitude_ - altitude) * stepUs;
+    }
+
+    truth.timeUs_ += stepUs;
+    truth.velocity_ = velocity;
+    truth.altitude_ = altitude;
+
+    if (altitude <= PAD_ALTITUDE && velocity < 0)
+    {
+        truth.altitude_ = PAD_ALTITUDE;
+        truth.velocity_ = 0;
+        truth.landed_ = 1;
+        result->landingUs_ = truth.timeUs_;
+    }
+}
+
+static void advanceTruth(uint64_t timeUs)
+{
+    while (truth.timeUs_ < timeUs && !truth.landed_)
+    {
+        uint64_t stepUs = timeUs - truth.timeUs_;
+
+        stepTruth(stepUs < TRUTH_STEP_US ? stepUs : TRUTH_STEP_US);
+    }
+}
+
+/* Sensors -------------------------------------------------------------------*/
+
+static int dropped(void)
+{
+    return uniform() < flight.dropout_;
+}
+
+static void sampleImu(void)
+{
+    if (dropped())
+    {
+        return;
+    }
+
+    // LSM9DS1 noise at the 16 g range, about 5 mg, the airframe along X
+    accelGyroMagnetismData.accelX_ = (int32_t) lround(truth.specificForce_ / GRAVITY * 1000 + 5 * gaussian());
+    // The attitude filter does not run here, the airframe stays vertical
+    accelGyroMagnetismData.verticalAccel_ = accelGyroMagnetismData.accelX_;
+    accelGyroMagnetismData.accelY_ = (int32_t) lround(5 * gaussian());
+    accelGyroMagnetismData.accelZ_ = (int32_t) lround(5 * gaussian());
+    accelGyroMagnetismData.sampleTimeUs_ = timebaseMicros();
+}
+
+static void sampleBarometer(void)
+{
+    // The MS5607 at its highest resolution is about 2.5 Pa rms
+    latchedPressure = pressureAt(truth.altitude_) + 2.5 * gaussian();
+    latchedPressureUs = timebaseMicros();
+}
+
+static void readBarometer(void)
+{
+    if (dropped())
+    {
+        return;
+    }
+
+    barometerData.pressure_ = (int32_t) lround(latchedPressure);
+    barometerData.sampleTimeUs_ = latchedPressureUs;
+}
+
+static void sampleGps(void)
+{
+    latchedGpsAltitude = truth.altitude_ + GPS_VERTICAL_ACCURACY / 2 * gaussian();
+    latchedGpsVelocity = truth.velocity_ + GPS_VELOCITY_NOISE * gaussian();
+}
+
+static void readGps(void)
+{
+    if (dropped())
+    {
+        return;
+    }
+
+    gpsData.antennaAltitude_.altitude_ = (int32_t) lround(latchedGpsAltitude * 10);
+    gpsData.velocityDown_ = (int32_t) lround(-latchedGpsVelocity * 1000);
+    gpsData.verticalAccuracy_ = (uint32_t) (GPS_VERTICAL_ACCURACY * 1000);
+    gpsData.fixQuality_ = 1;
+    gpsData.fixType_ = 3;
+    gpsData.sampleTimeUs_ = timebaseMicros();
+}
+
+static void armCommand(void)
+{
+    // From the USART interrupt of the ground station commands
+    newFlightPhase(ARM);
+}
+
+static void launchCommand(void)
+{
+    launchCmdReceived = 2;
+}
+
+/* Firmware hooks ------------------------------------------------------------*/
+
+void monteCarloGpio(GPIO_TypeDef* port, uint16_t pin, GPIO_PinState state)
+{
+    double nowUs = (double) timebaseMicros64();
+
+    if (port == INJECTION_VALVE_GPIO_Port && pin == INJECTION_VALVE_Pin)
+    {
+        if (state == GPIO_PIN_SET && truth.ignitionUs_ == MONTE_CARLO_NEVER)
+        {
+            truth.ignitionUs_ = timebaseMicros64() + flight.ignitionDelayUs_;
+        }
+
+        truth.valveOpen_ = state == GPIO_PIN_SET;
+    }
+    else if (port == DROGUE_PARACHUTE_TEMP_GPIO_Port && pin == DROGUE_PARACHUTE_TEMP_Pin)
+    {
+        if (state == GPIO_PIN_SET && result->drogueUs_ == NONE)
+        {
+            result->drogueUs_ = nowUs;
+            result->drogueAltitude_ = truth.altitude_;
+            result->drogueSpeed_ = fabs(truth.velocity_);
+            result->droguePhase_ = phase;
+        }
+    }
+    else if (port == MAIN_PARACHUTE_GPIO_Port && pin == MAIN_PARACHUTE_Pin)
+    {
+        if (state == GPIO_PIN_SET && result->mainUs_ == NONE)
+        {
+            result->mainUs_ = nowUs;
+            result->mainAltitude_ = truth.altitude_;
+            result->mainSpeed_ = fabs(truth.velocity_);
+            result->mainPhase_ = phase;
+        }
+    }
+}
+
+void monteCarloTrace(TraceId id, uint16_t arg)
+{
+    switch (id)
+    {
+        case TRACE_FLIGHT_PHASE:
+            phase = (FlightPhase) arg;
+
+            if (phase == COAST)
+            {
+                result->coastUs_ = (double) timebaseMicros64();
+            }
+
+            break;
+
+        case TRACE_DROGUE_DECISION:
+            result->drogueDecision_ = (uint8_t) arg;
+            break;
+
+        case TRACE_MAIN_DECISION:
+            result->mainDecision_ = (uint8_t) arg;
+            break;
+
+        default:
+            break;
+    }
+}
+
+int monteCarloMutexBusy(osMutexId mutex)
+{
+    int sensorMutex =
+        mutex == (osMutexId) &accelGyroMagnetismMutex ||
+        mutex == (osMutexId) &barometerMutex ||
+        mutex == (osMutexId) &gpsMutex;
+
+    return sensorMutex && uniform() < flight.contention_;
+}
+
+/* Flight --------------------------------------------------------------------*/
+
+static void drawFlight(uint64_t seed, double dropout, double contention)
+{
+    rngState = seed;
+    flight.thrust_ = between(50, 70);
+    flight.burnUs_ = (uint64_t) between(5e6, 8e6); // Before the valve closes at BURN_DURATION
+    flight.ignitionDelayUs_ = (uint64_t) between(2e5, 6e5);
+    flight.drag_ = between(2e-5, 2e-4);
+    flight.seaLevelPressure_ = between(100000, 102500);
+    flight.imuPhaseUs_ = (uint64_t) between(0, BAROMETER_PERIOD_US);
+    flight.gpsPhaseUs_ = (uint64_t) between(0, GPS_PERIOD_US);
+    flight.launchCommandUs_ = LAUNCH_COMMAND_US + (uint64_t) between(0, 5e6);
+    flight.dropout_ = dropout;
+    flight.contention_ = contention;
+}
+
+/**
+ * Flies one flight in this process and fills in its result.
+ */
+static void fly(FlightResult* flightResult)
+{
+    SensorEvent events[] =
+    {
+        {flight.imuPhaseUs_, IMU_PERIOD_US, sampleImu},
+        {flight.imuPhaseUs_ + BAROMETER_SAMPLE_US, BAROMETER_PERIOD_US, sampleBarometer},
+        {flight.imuPhaseUs_ + BAROMETER_READ_US, BAROMETER_PERIOD_US, readBarometer},
+        {flight.gpsPhaseUs_, GPS_PERIOD_US, sampleGps},
+        {flight.gpsPhaseUs_ + GPS_LATENCY_US, GPS_PERIOD_US, readGps},
+        {ARM_US, 0, armCommand},
+        {flight.launchCommandUs_, 0, launchCommand}
+    };
+    const int eventCount = sizeof(events) / sizeof(events[0]);
+
+    result = flightResult;
+    result->apogeeUs_ = NONE;
+    result->apogeeAltitude_ = NONE;
+    result->coastUs_ = NONE;
+    result->drogueUs_ = NONE;
+    result->mainCrossingUs_ = NONE;
+    result->mainUs_ = NONE;
+    result->landingUs_ = NONE;
+
+    truth.altitude_ = PAD_ALTITUDE;
+    truth.specificForce_ = GRAVITY;
+    truth.ignitionUs_ = MONTE_CARLO_NEVER;
+
+    accelGyroMagnetismData.mutex_ = (osMutexId) &accelGyroMagnetismMutex;
+    barometerData.mutex_ = (osMutexId) &barometerMutex;
+    gpsData.mutex_ = (osMutexId) &gpsMutex;
+    oxidizerTankPressureData.mutex_ = (osMutexId) &oxidizerTankMutex;
+    flightPhaseMutex = (osMutexId) &flightPhaseMutexObject;
+
+    // Sensor values before the first sample, as after the sensor initialization
+    accelGyroMagnetismData.accelX_ = 1000;
+    accelGyroMagnetismData.verticalAccel_ = 1000;
+    barometerData.pressure_ = (int32_t) lround(pressureAt(PAD_ALTITUDE));
+
+    // In the order of their priorities in main.c
+    monteCarloTaskCreate(parachutesControlTask, &parachutesControlData);
+    monteCarloTaskCreate(engineControlTask, &oxidizerTankPressureData);
+
+    for (;;)
+    {
+        uint64_t nextUs = monteCarloRtosNextEventUs();
+
+        for (int i = 0; i < eventCount; i++)
+        {
+            if (events[i].nextUs_ < nextUs)
+            {
+                nextUs = events[i].nextUs_;
+            }
+        }
+
+        if (nextUs > MAX_FLIGHT_US)
+        {
+            break;
+        }
+
+        advanceTruth(nextUs);
+
+        if (truth.landed_ || (result->mainUs_ != NONE && nextUs > result->mainUs_ + END_AFTER_MAIN_US))
+        {
+            break;
+        }
+
+        // Interrupts and the sensor task come before the tasks of the tick
+        for (int i = 0; i < eventCount; i++)
+        {
+            if (events[i].nextUs_ <= nextUs)
+            {
+                events[i].handler_();
+                events[i].nextUs_ = events[i].periodUs_ != 0 ? events[i].nextUs_ + events[i].periodUs_ : MONTE_CARLO_NEVER;
+            }
+        }
+
+        monteCarloRtosRun(nextUs);
+    }
+
+    result->completed_ = 1;
+}
+
+/* Statistics ----------------------------------------------------------------*/
+
+static int compareDoubles(const void* a, const void* b)
+{
+    double x = *(const double*) a;
+    double y = *(const double*) b;
+
+    return x < y ? -1 : x > y;
+}
+
+static double percentile(const double* sorted, int count, double fraction)
+{
+    return sorted[(int) (fraction * (count - 1) + 0.5)];
+}
+
+static void printDistribution(const char* name, double* values, int count)
+{
+    double sum = 0;
+
+    if (count == 0)
+    {
+        printf("  %-26s %9s\n", name, "none");
+        return;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        sum += values[i];
+    }
+
+    qsort(values, count, sizeof(double), compareDoubles);
+    printf("  %-26s %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", name,
+        sum / count,
+        values[0],
+        percentile(values, count, 0.05),
+        percentile(values, count, 0.5),
+        percentile(values, count, 0.95),
+        percentile(values, count, 0.99),
+        values[count - 1]);
+}
+
+static void printCount(const char* name, int count, int total)
+{
+    printf("  %-40s %6d  %6.2f %%\n", name, count, total != 0 ? 100.0 * count / total : 0.0);
+}
+
+static void report(const FlightResult* results, int flights, double wallSeconds, int jobs)
+{
+    double* values = malloc(flights * sizeof(double));
+    int completed = 0;
+    int count;
+
+    for (int i = 0; i < flights; i++)
+    {
+        completed += results[i].completed_;
+    }
+
+    printf("%d flights, %d completed\n", flights, completed);
+    printf("  %-26s %9s %9s %9s %9s %9s %9s %9s\n", "", "mean", "min", "p5", "p50", "p95", "p99", "max");
+
+    count = 0;
+
+    for (int i = 0; i < flights; i++)
+    {
+        if (results[i].completed_ && results[i].apogeeUs_ != NONE)
+        {
+            values[count++] = results[i].apogeeAltitude_;
+        }
+    }
+
+    printDistribution("apogee (m)", values, count);
+    printf("drogue\n");
+
+    count = 0;
+
+    for (int i = 0; i < flights; i++)
+    {
+        if (results[i].completed_ && results[i].apogeeUs_ != NONE && results[i].drogueUs_ != NONE)
+        {
+            values[count++] = (results[i].drogueUs_ - results[i].apogeeUs_) / 1000;
+        }
+    }
+
+    printDistribution("time from apogee (ms)", values, count);
+
+    count = 0;
+
+    for (int i = 0; i < flights; i++)
+    {
+        if (results[i].completed_ && results[i].drogueUs_ != NONE)
+        {
+            values[count++] = results[i].drogueSpeed_;
+        }
+    }
+
+    printDistribution("speed (m/s)", values, count);
+
+    count = 0;
+
+    for (int i = 0; i < flights; i++)
+    {
+        if (results[i].completed_ && results[i].apogeeUs_ != NONE && results[i].drogueUs_ != NONE)
+        {
+            values[count++] = results[i].apogeeAltitude_ - results[i].drogueAltitude_;
+        }
+    }
+
+    printDistribution("altitude loss (m)", values, count);
+    printf("main\n");
+
+    count = 0;
+
+    for (int i = 0; i < flights; i++)
+    {
+        if (results[i].completed_ && results[i].mainUs_ != NONE)
+        {
+            values[count++] = results[i].mainAltitude_ - MAIN_DEPLOYMENT_ALTITUDE;
+        }
+    }
+
+    printDistribution("altitude error (m)", values, count);
+
+    count = 0;
+
+    for (int i = 0; i < flights; i++)
+    {
+        if (results[i].completed_ && results[i].mainUs_ != NONE && results[i].mainCrossingUs_ != NONE)
+        {
+            values[count++] = (results[i].mainUs_ - results[i].mainCrossingUs_) / 1000;
+        }
+    }
+
+    printDistribution("latency (ms)", values, count);
+
+    count = 0;
+
+    for (int i = 0; i < flights; i++)
+    {
+        if (results[i].completed_ && results[i].mainUs_ != NONE)
+        {
+            values[count++] = results[i].mainSpeed_;
+        }
+    }
+
+    printDistribution("speed (m/s)", values, count);
+    free(values);
+
+    int drogueDecisions[3] = {0};
+    int mainOnAltitude = 0;
+    int mainOnTimeout = 0;
+    int drogueEarly = 0;
+    int drogueBeforeCoast = 0;
+    int mainHigh = 0;
+    int mainBeforeDrogue = 0;
+    int drogueMissed = 0;
+    int mainMissed = 0;
+
+    for (int i = 0; i < flights; i++)
+    {
+        const FlightResult* flightResult = &results[i];
+
+        if (!flightResult->completed_)
+        {
+            continue;
+        }
+
+        if (flightResult->drogueUs_ == NONE)
+        {
+            drogueMissed++;
+        }
+        else
+        {
+            drogueDecisions[flightResult->drogueDecision_ <= APOGEE_NOW ? flightResult->drogueDecision_ : APOGEE_WAIT]++;
+            drogueEarly +=
+                flightResult->apogeeUs_ == NONE ||
+                flightResult->drogueUs_ < flightResult->apogeeUs_ - FALSE_DROGUE_MARGIN_MS * 1000;
+            drogueBeforeCoast += flightResult->droguePhase_ < COAST;
+        }
+
+        if (flightResult->mainUs_ == NONE)
+        {
+            mainMissed++;
+        }
+        else
+        {
+            mainOnAltitude += flightResult->mainDecision_ != 0;
+            mainOnTimeout += flightResult->mainDecision_ == 0;
+            mainHigh += flightResult->mainAltitude_ > MAIN_DEPLOYMENT_ALTITUDE + FALSE_MAIN_MARGIN;
+            mainBeforeDrogue += flightResult->drogueUs_ == NONE || flightResult->mainUs_ < flightResult->drogueUs_;
+        }
+    }
+
+    printf("decisions\n");
+    printCount("drogue at the predicted apogee", drogueDecisions[APOGEE_SCHEDULE], completed);
+    printCount("drogue on the velocity sign change", drogueDecisions[APOGEE_NOW], completed);
+    printCount("drogue on the timeout", drogueDecisions[APOGEE_WAIT], completed);
+    printCount("main at the deployment altitude", mainOnAltitude, completed);
+    printCount("main on the timeout", mainOnTimeout, completed);
+    printf("false triggers\n");
+    printCount("drogue over 1 s before apogee", drogueEarly, completed);
+    printCount("drogue before COAST", drogueBeforeCoast, completed);
+    printCount("main over 100 m above its altitude", mainHigh, completed);
+    printCount("main before the drogue", mainBeforeDrogue, completed);
+    printf("missed\n");
+    printCount("drogue", drogueMissed, completed);
+    printCount("main", mainMissed, completed);
+
+    printf("%d flights in %.2f s on %d jobs, %.1f flights/s\n", flights, wallSeconds, jobs, flights / wallSeconds);
+}
+
+/* Runner --------------------------------------------------------------------*/
+
+static double wallClock(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static int run(int flights, int jobs, uint64_t seed, double dropout, double contention)
+{
+    // Shared with the flight processes, zero until a flight completes
+    FlightResult* results = mmap(NULL, flights * sizeof(FlightResult), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (results == MAP_FAILED)
+    {
+        perror("mmap");
+        return 1;
+    }
+
+    double start = wallClock();
+    int running = 0;
+    int failed = 0;
+
+    fflush(stdout);
+
+    for (int next = 0; next < flights || running > 0;)
+    {
+        if (next < flights && running < jobs)
+        {
+            pid_t pid = fork();
+
+            if (pid == 0)
+            {
+                drawFlight(flightSeed(seed, next), dropout, contention);
+                fly(&results[next]);
+                _exit(0);
+            }
+
+            if (pid < 0)
+            {
+                perror("fork");
+                return 1;
+            }
+
+            next++;
+            running++;
+            continue;
+        }
+
+        int status;
+
+        if (wait(&status) > 0)
+        {
+            failed += !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+            running--;
+        }
+    }
+
+    report(results, flights, wallClock() - start, jobs);
+    munmap(results, flights * sizeof(FlightResult));
+
+    if (failed != 0)
+    {
+        printf("%d flight processes failed\n", failed);
+        return 1;
+    }
+
+    return 0;
+}
+
+static void usage(const char* program)
+{
+    fprintf(stderr, "Usage: %s [--flights n] [--jobs n] [--seed n] [--dropout p] [--contention p]\n", program);
+}
+
+int main(int argc, char** argv)
+{
+    int flights = DEFAULT_FLIGHTS;
+    int jobs = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    uint64_t seed = 1;
+    double dropout = DEFAULT_DROPOUT;
+    double contention = DEFAULT_CONTENTION;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 < argc && strcmp(argv[i], "--flights") == 0)
+        {
+            flights = atoi(argv[++i]);
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "--jobs") == 0)
+        {
+            jobs = atoi(argv[++i]);
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "--seed") == 0)
+        {
+            seed = strtoull(argv[++i], NULL, 10);
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "--dropout") == 0)
+        {
+            dropout = atof(argv[++i]);
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "--contention") == 0)
+        {
+            contention = atof(argv[++i]);
+        }
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (flights <= 0 || jobs <= 0)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    printf("seed %llu, dropout %.3f, contention %.3f\n", (unsigned long long) seed, dropout, contention);
+    return run(flights, jobs, seed, dropout, contention);
+}
@@ -0,0 +1,216 @@
+/**
+  ******************************************************************************
+  * File Name          : MonteCarloRtos.c
+  * Description        : Coroutine scheduler on a simulated clock, standing in
+  *                      for the FreeRTOS calls, the timebase, the task
+  *                      statistics and the tracer of the flight phase logic.
+  ******************************************************************************
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ucontext.h>
+
+#include "MonteCarlo.h"
+#include "TaskStats.h"
+#include "Timebase.h"
+
+#define TICK_US 1000 // configTICK_RATE_HZ
+
+typedef struct
+{
+    ucontext_t          context_;
+    os_pthread          function_;
+    const void*         argument_;
+    uint64_t            wakeUs_;
+} Task;
+
+static Task tasks[MONTE_CARLO_MAX_TASKS];
+static int taskCount = 0;
+static Task* currentTask = NULL;
+static ucontext_t schedulerContext;
+
+static uint64_t nowUs = 0;
+static uint64_t alarmUs = MONTE_CARLO_NEVER;
+static TimebaseAlarmHandler alarmHandler = NULL;
+
+/* Scheduler -----------------------------------------------------------------*/
+
+static void taskEntry(int index)
+{
+    tasks[index].function_(tasks[index].argument_);
+
+    // Firmware tasks never return, park one that does for good
+    tasks[index].wakeUs_ = MONTE_CARLO_NEVER;
+    swapcontext(&tasks[index].context_, &schedulerContext);
+}
+
+void monteCarloTaskCreate(os_pthread function, const void* argument)
+{
+    if (taskCount == MONTE_CARLO_MAX_TASKS)
+    {
+        fprintf(stderr, "monte carlo: too many tasks\n");
+        abort();
+    }
+
+    Task* task = &tasks[taskCount];
+
+    getcontext(&task->context_);
+    task->context_.uc_stack.ss_sp = malloc(MONTE_CARLO_STACK_SIZE);
+    task->context_.uc_stack.ss_size = MONTE_CARLO_STACK_SIZE;
+    task->context_.uc_link = NULL;
+    task->function_ = function;
+    task->argument_ = argument;
+    task->wakeUs_ = nowUs;
+    makecontext(&task->context_, (void (*)(void)) taskEntry, 1, taskCount);
+    taskCount++;
+}
+
+/**
+ * Parks the running task until wakeUs.
+ */
+static void block(uint64_t wakeUs)
+{
+    Task* task = currentTask;
+
+    task->wakeUs_ = wakeUs;
+    swapcontext(&task->context_, &schedulerContext);
+}
+
+static void runAlarm(void)
+{
+    if (alarmHandler != NULL && alarmUs <= nowUs)
+    {
+        TimebaseAlarmHandler handler = alarmHandler;
+
+        alarmHandler = NULL;
+        alarmUs = MONTE_CARLO_NEVER;
+        handler();
+    }
+}
+
+uint64_t monteCarloRtosNextEventUs(void)
+{
+    uint64_t next = alarmUs;
+
+    for (int i = 0; i < taskCount; i++)
+    {
+        if (tasks[i].wakeUs_ < next)
+        {
+            next = tasks[i].wakeUs_;
+        }
+    }
+
+    return next;
+}
+
+void monteCarloRtosRun(uint64_t timeUs)
+{
+    if (timeUs > nowUs)
+    {
+        nowUs = timeUs;
+    }
+
+    runAlarm();
+
+    // A task can wake another one with a flight phase, all of them get their turn at this tick
+    for (int ran = 1; ran;)
+    {
+        ran = 0;
+
+        for (int i = 0; i < taskCount; i++)
+        {
+            if (tasks[i].wakeUs_ <= nowUs)
+            {
+                currentTask = &tasks[i];
+                swapcontext(&schedulerContext, &tasks[i].context_);
+                currentTask = NULL;
+                ran = 1;
+            }
+        }
+    }
+}
+
+/* CMSIS-RTOS ----------------------------------------------------------------*/
+
+uint32_t osKernelSysTick(void)
+{
+    return (uint32_t) (nowUs / TICK_US);
+}
+
+osStatus osDelay(uint32_t millisec)
+{
+    // vTaskDelay wakes at the tick millisec after the current one
+    block((nowUs / TICK_US + millisec) * TICK_US);
+    return osOK;
+}
+
+osStatus osMutexWait(osMutexId mutex_id, uint32_t millisec)
+{
+    (void) millisec;
+    return monteCarloMutexBusy(mutex_id) ? osErrorTimeoutResource : osOK;
+}
+
+osStatus osMutexRelease(osMutexId mutex_id)
+{
+    (void) mutex_id;
+    return osOK;
+}
+
+void taskStatsDelayUntil(uint32_t* previousWakeTime, uint32_t period)
+{
+    *previousWakeTime += period;
+
+    // As vTaskDelayUntil, a wake up time that has passed does not block
+    uint64_t wakeUs = (uint64_t) *previousWakeTime * TICK_US;
+
+    if (wakeUs > nowUs)
+    {
+        block(wakeUs);
+    }
+}
+
+/* Timebase ------------------------------------------------------------------*/
+
+uint32_t timebaseMicros(void)
+{
+    return (uint32_t) nowUs;
+}
+
+uint64_t timebaseMicros64(void)
+{
+    return nowUs;
+}
+
+uint32_t timebaseMillis(void)
+{
+    return (uint32_t) (nowUs / 1000);
+}
+
+void timebaseSetAlarm(uint32_t timeUs, TimebaseAlarmHandler handler)
+{
+    // Flights are shorter than the 71 minute wrap of the 32 bit count
+    alarmUs = (int32_t) (timeUs - (uint32_t) nowUs) > 0 ? nowUs + (uint32_t) (timeUs - (uint32_t) nowUs) : nowUs;
+    alarmHandler = handler;
+
+    // An alarm that is already due interrupts the task that set it
+    runAlarm();
+}
+
+void timebaseCancelAlarm(void)
+{
+    alarmHandler = NULL;
+    alarmUs = MONTE_CARLO_NEVER;
+}
+
+/* HAL and tracer ------------------------------------------------------------*/
+
+void HAL_GPIO_WritePin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+    monteCarloGpio(GPIOx, GPIO_Pin, PinState);
+}
+
+void trace(TraceId id, uint16_t arg)
+{
+    monteCarloTrace(id, arg);
+}
@@ -0,0 +1,205 @@
+/**
+  ******************************************************************************
+  * File Name          : SimCore.c
+  * Description        : Simulated clock, tick generation and timed events for
+  *                      the host build.
+  ******************************************************************************
+*/
+
+#include "Sim.h"
+#include "IsrStats.h"
+
+typedef struct
+{
+    uint64_t        time_;
+    uint64_t        order_; // Keeps events scheduled for the same time in FIFO order
+    SimEventHandler handler_;
+    void*           context_;
+    uint32_t        value_;
+} SimEvent;
+
+static uint64_t nowNs = 0;
+static uint64_t nextTickNs = SIM_NS_PER_TICK;
+static uint64_t endNs = 0;
+static uint64_t eventOrder = 0;
+
+static SimEvent events[SIM_MAX_EVENTS];
+static int eventCount = 0;
+
+// FreeRTOSConfig.h maps xPortSysTickHandler onto the SysTick vector
+extern void SysTick_Handler(void);
+extern void HAL_IncTick(void);
+
+static int eventBefore(const SimEvent* a, const SimEvent* b)
+{
+    return a->time_ < b->time_ || (a->time_ == b->time_ && a->order_ < b->order_);
+}
+
+static void swapEvents(int a, int b)
+{
+    SimEvent temp = events[a];
+    events[a] = events[b];
+    events[b] = temp;
+}
+
+uint64_t simNow(void)
+{
+    return nowNs;
+}
+
+/**
+ * Restarts the clock at zero, for work done before the firmware runs.
+ */
+void simResetTime(void)
+{
+    nowNs = 0;
+    nextTickNs = SIM_NS_PER_TICK;
+    simUpdateCounters();
+}
+
+void simSetDuration(uint64_t ns)
+{
+    endNs = ns;
+}
+
+void simSchedule(uint64_t timeNs, SimEventHandler handler, void* context, uint32_t value)
+{
+    if (eventCount == SIM_MAX_EVENTS)
+    {
+        fprintf(stderr, "sim: event queue full, dropping event at %.3f s\n", timeNs / 1e9);
+        return;
+    }
+
+    int i = eventCount++;
+    events[i].time_ = timeNs;
+    events[i].order_ = eventOrder++;
+    events[i].handler_ = handler;
+    events[i].context_ = context;
+    events[i].value_ = value;
+
+    while (i > 0 && eventBefore(&events[i], &events[(i - 1) / 2]))
+    {
+        swapEvents(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static SimEvent popEvent(void)
+{
+    SimEvent top = events[0];
+    events[0] = events[--eventCount];
+
+    for (int i = 0;;)
+    {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+
+        if (left < eventCount && eventBefore(&events[left], &events[smallest]))
+        {
+            smallest = left;
+        }
+
+        if (right < eventCount && eventBefore(&events[right], &events[smallest]))
+        {
+            smallest = right;
+        }
+
+        if (smallest == i)
+        {
+            break;
+        }
+
+        swapEvents(i, smallest);
+        i = smallest;
+    }
+
+    return top;
+}
+
+int simInterruptPending(void)
+{
+    return nowNs >= nextTickNs || (eventCount != 0 && events[0].time_ <= nowNs);
+}
+
+/**
+ * Delivers the earliest due interrupt. Events due before the next tick
+ * boundary run first so that handlers see ticks in order.
+ */
+void simDispatchInterrupt(void)
+{
+    if (eventCount != 0 && events[0].time_ <= nowNs && events[0].time_ < nextTickNs)
+    {
+        SimEvent event = popEvent();
+        event.handler_(event.context_, event.value_);
+        return;
+    }
+
+    if (endNs != 0 && nextTickNs > endNs)
+    {
+        vPortFinishSimulation();
+    }
+
+    // The HAL time base (TIM1 update on the target) and SysTick both run at 1 kHz
+    nextTickNs += SIM_NS_PER_TICK;
+    isrStatsEnter(ISR_STATS_TIM1_UP_TIM10, 0);
+    HAL_IncTick();
+    isrStatsExit(ISR_STATS_TIM1_UP_TIM10);
+    SysTick_Handler();
+}
+
+/**
+ * Time of the next tick or event, whichever comes first.
+ */
+static uint64_t nextInterruptNs(void)
+{
+    if (eventCount != 0 && events[0].time_ < nextTickNs)
+    {
+        return events[0].time_;
+    }
+
+    return nextTickNs;
+}
+
+/**
+ * Consumes simulated time in the running context, e.g. for a bus transfer.
+ * Interrupts are delivered when they become due, part way through if the
+ * transfer is long, and may switch to a higher priority task; the rest of
+ * the time is consumed once the running context gets the CPU back.
+ */
+void simAdvance(uint64_t ns)
+{
+    while (ns != 0)
+    {
+        uint64_t step = ns;
+        uint64_t next = nextInterruptNs();
+
+        if (next > nowNs && next - nowNs < step)
+        {
+            step = next - nowNs;
+        }
+
+        nowNs += step;
+        ns -= step;
+        simUpdateCounters();
+        vPortChargeSimTime(step);
+        vPortServiceInterrupts();
+    }
+}
+
+/**
+ * Called from the idle task: nothing is ready, so skip to the next tick or
+ * event.
+ */
+void simIdle(void)
+{
+    uint64_t next = nextInterruptNs();
+
+    if (next > nowNs)
+    {
+        nowNs = next;
+        simUpdateCounters();
+    }
+
+    vPortServiceInterrupts();
+}
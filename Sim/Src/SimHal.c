@@ -0,0 +1,1259 @@
+/**
+  ******************************************************************************
+  * File Name          : SimHal.c
+  * Description        : Stub HAL for the host build. Only the calls made by
+  *                      the flight software are provided.
+  ******************************************************************************
+*/
+
+#include <string.h>
+
+#include "Sim.h"
+#include "SimHal.h"
+#include "main.h"
+#include "IsrStats.h"
+
+#define SIM_UART_COUNT 6
+#define SIM_UART_FIFO_SIZE 1024
+#define SIM_SPI_BUS_COUNT 3
+#define SIM_ADC_COUNT 3
+#define SIM_ADC_DEFAULT_VALUE 354 // 0.5 V from the pressure transducers, i.e. 0 psi
+#define SIM_TIMER_COUNT 2
+#define SIM_NO_ISR ISR_STATS_COUNT // Interrupts the flight software does not enable
+
+typedef struct
+{
+    const char*     name_;
+    GPIO_TypeDef*   port_;
+    uint16_t        pin_;
+} SimTracedPin;
+
+typedef struct
+{
+    const char*         name_;
+    USART_TypeDef*      instance_;
+    IsrStatsId          isr_; // Handler of the receive interrupt on the target
+    IsrStatsId          idleIsr_; // Handler of the idle line interrupt
+    DMA_HandleTypeDef*  dma_; // Receive stream, for the UARTs received by DMA on the target
+    UART_HandleTypeDef* handle_;
+    FILE*               output_;
+    SimUartDevice*      device_;
+    const uint8_t*      txBuffer_; // Sent by interrupts
+    uint16_t            txSize_;
+    uint16_t            txCount_;
+    uint8_t*            rxBuffer_;
+    uint16_t            rxSize_;
+    uint16_t            rxCount_;
+    uint8_t             fifo_[SIM_UART_FIFO_SIZE];
+    uint16_t            fifoHead_;
+    uint16_t            fifoCount_;
+    int                 deliveryScheduled_;
+    uint64_t            txBytes_;
+    uint64_t            rxBytes_;
+    uint64_t            droppedBytes_;
+    uint64_t            busyNs_;
+} SimUart;
+
+typedef struct
+{
+    const char*     name_;
+    SPI_TypeDef*    instance_;
+    uint64_t        bytes_[SIM_SPI_PRESCALER_COUNT];
+    uint64_t        busyNs_[SIM_SPI_PRESCALER_COUNT];
+    uint64_t        transfers_;
+} SimSpiBus;
+
+typedef struct
+{
+    const char*     name_;
+    ADC_TypeDef*    instance_;
+    uint16_t        value_;
+    uint64_t        conversions_;
+} SimAdc;
+
+typedef struct
+{
+    const char*         name_;
+    TIM_TypeDef*        instance_;
+    IsrStatsId          isr_;
+    TIM_HandleTypeDef*  handle_;
+    int                 running_;
+    uint64_t            periodStartNs_;
+    uint64_t            updateNs_; // When the running period ends
+    uint64_t            updates_;
+    int                 compareArmed_; // Channel 1 interrupt enabled, an event scheduled for compare_
+    uint32_t            compare_;
+    uint32_t            compareGeneration_; // Events of older compares are stale
+    uint64_t            compares_;
+} SimTimer;
+
+__IO uint32_t uwTick;
+
+// tm_stm32_delay.c owns the HAL tick on the target and counts these down for the SD card driver
+__IO uint32_t TM_Time = 0;
+__IO uint32_t TM_Time2 = 0;
+uint32_t uwTickPrio = (1UL << __NVIC_PRIO_BITS);
+HAL_TickFreqTypeDef uwTickFreq = HAL_TICK_FREQ_DEFAULT;
+uint32_t SystemCoreClock = HSI_VALUE;
+
+static uint32_t pllM = 16;
+static uint32_t pllN = 192;
+static uint32_t pllP = RCC_PLLP_DIV2;
+static uint32_t pllSource = RCC_PLLSOURCE_HSI;
+static uint32_t sysclkSource = RCC_SYSCLKSOURCE_HSI;
+static uint32_t ahbDivider = RCC_SYSCLK_DIV1;
+static uint32_t apb1Divider = RCC_HCLK_DIV1;
+static uint32_t apb2Divider = RCC_HCLK_DIV1;
+
+static SimSpiDevice* spiDevices = NULL;
+
+static SimSpiBus spiBuses[SIM_SPI_BUS_COUNT] =
+{
+    {"SPI1", SPI1},
+    {"SPI2", SPI2},
+    {"SPI3", SPI3},
+};
+
+// The receive streams as stm32f4xx_hal_msp.c sets them up, it is not compiled here
+static DMA_HandleTypeDef uart4Dma = {.Instance = DMA1_Stream2, .Init.Mode = DMA_CIRCULAR};
+
+static SimUart uarts[SIM_UART_COUNT] =
+{
+    {"USART1", USART1, SIM_NO_ISR, SIM_NO_ISR},
+    {"USART2", USART2, ISR_STATS_USART2, SIM_NO_ISR},
+    {"USART3", USART3, SIM_NO_ISR, SIM_NO_ISR},
+    {"UART4", UART4, ISR_STATS_DMA1_Stream2, ISR_STATS_UART4, &uart4Dma},
+    {"UART5", UART5, SIM_NO_ISR, SIM_NO_ISR},
+    {"USART6", USART6, SIM_NO_ISR, SIM_NO_ISR},
+};
+
+static SimAdc adcs[SIM_ADC_COUNT] =
+{
+    {"ADC1", ADC1, SIM_ADC_DEFAULT_VALUE},
+    {"ADC2", ADC2, SIM_ADC_DEFAULT_VALUE},
+    {"ADC3", ADC3, 0},
+};
+
+// Up counting timers on APB1, TIM1 is the HAL time base and driven by SimCore.c
+static SimTimer timers[SIM_TIMER_COUNT] =
+{
+    {"TIM5", TIM5, ISR_STATS_TIM5},
+    {"TIM7", TIM7, ISR_STATS_TIM7},
+};
+
+static const SimTracedPin tracedPins[] =
+{
+    {"injection valve", INJECTION_VALVE_GPIO_Port, INJECTION_VALVE_Pin},
+    {"lower vent valve", LOWER_VENT_VALVE_GPIO_Port, LOWER_VENT_VALVE_Pin},
+    {"propulsion 3 valve", PROPULSION_3_VALVE_GPIO_Port, PROPULSION_3_VALVE_Pin},
+    {"drogue parachute", DROGUE_PARACHUTE_TEMP_GPIO_Port, DROGUE_PARACHUTE_TEMP_Pin},
+    {"main parachute", MAIN_PARACHUTE_GPIO_Port, MAIN_PARACHUTE_Pin},
+};
+
+static SimUart* uartOf(USART_TypeDef* instance)
+{
+    for (int i = 0; i < SIM_UART_COUNT; i++)
+    {
+        if (uarts[i].instance_ == instance)
+        {
+            return &uarts[i];
+        }
+    }
+
+    return NULL;
+}
+
+static SimSpiBus* spiBusOf(SPI_TypeDef* instance)
+{
+    for (int i = 0; i < SIM_SPI_BUS_COUNT; i++)
+    {
+        if (spiBuses[i].instance_ == instance)
+        {
+            return &spiBuses[i];
+        }
+    }
+
+    return NULL;
+}
+
+static SimAdc* adcOf(ADC_TypeDef* instance)
+{
+    for (int i = 0; i < SIM_ADC_COUNT; i++)
+    {
+        if (adcs[i].instance_ == instance)
+        {
+            return &adcs[i];
+        }
+    }
+
+    return NULL;
+}
+
+static SimTimer* timerOf(TIM_TypeDef* instance)
+{
+    for (int i = 0; i < SIM_TIMER_COUNT; i++)
+    {
+        if (timers[i].instance_ == instance)
+        {
+            return &timers[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void updateTimerCounters(void);
+static void updateTimerCompares(void);
+
+/* Core ----------------------------------------------------------------------*/
+
+HAL_StatusTypeDef HAL_Init(void)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_InitTick(uint32_t TickPriority)
+{
+    uwTickPrio = TickPriority;
+    return HAL_OK;
+}
+
+void HAL_IncTick(void)
+{
+    uwTick += uwTickFreq;
+    TM_Time++;
+
+    if (TM_Time2)
+    {
+        TM_Time2--;
+    }
+}
+
+uint32_t HAL_GetTick(void)
+{
+    return uwTick;
+}
+
+/**
+ * DWT->CYCCNT and the timer CNT registers are plain memory here, so the
+ * clock writes their counts for the current simulated time whenever it
+ * moves, while they are enabled.
+ */
+void simUpdateCounters(void)
+{
+    if ((CoreDebug->DEMCR & CoreDebug_DEMCR_TRCENA_Msk) && (DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk))
+    {
+        DWT->CYCCNT = (uint32_t) (simNow() * (SystemCoreClock / 1000000) / SIM_NS_PER_US);
+    }
+
+    updateTimerCounters();
+    updateTimerCompares();
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+    simAdvance((uint64_t) Delay * SIM_NS_PER_MS);
+}
+
+void HAL_SuspendTick(void)
+{
+}
+
+void HAL_ResumeTick(void)
+{
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority)
+{
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+}
+
+/* RCC -----------------------------------------------------------------------*/
+
+static uint32_t ahbPrescaler(uint32_t divider)
+{
+    static const uint16_t shifts[8] = {1, 2, 3, 4, 6, 7, 8, 9};
+    uint32_t bits = (divider & RCC_CFGR_HPRE) >> RCC_CFGR_HPRE_Pos;
+    return bits < 8 ? 1 : 1U << shifts[bits - 8];
+}
+
+static uint32_t apbPrescaler(uint32_t divider)
+{
+    uint32_t bits = (divider & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos;
+    return bits < 4 ? 1 : 1U << (bits - 3);
+}
+
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef* RCC_OscInitStruct)
+{
+    if (RCC_OscInitStruct->PLL.PLLState == RCC_PLL_ON)
+    {
+        pllSource = RCC_OscInitStruct->PLL.PLLSource;
+        pllM = RCC_OscInitStruct->PLL.PLLM;
+        pllN = RCC_OscInitStruct->PLL.PLLN;
+        pllP = RCC_OscInitStruct->PLL.PLLP;
+    }
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef* RCC_ClkInitStruct, uint32_t FLatency)
+{
+    sysclkSource = RCC_ClkInitStruct->SYSCLKSource;
+    ahbDivider = RCC_ClkInitStruct->AHBCLKDivider;
+    apb1Divider = RCC_ClkInitStruct->APB1CLKDivider;
+    apb2Divider = RCC_ClkInitStruct->APB2CLKDivider;
+    SystemCoreClock = HAL_RCC_GetHCLKFreq();
+    return HAL_OK;
+}
+
+uint32_t HAL_RCC_GetSysClockFreq(void)
+{
+    if (sysclkSource == RCC_SYSCLKSOURCE_HSE)
+    {
+        return HSE_VALUE;
+    }
+
+    if (sysclkSource == RCC_SYSCLKSOURCE_PLLCLK)
+    {
+        uint32_t input = pllSource == RCC_PLLSOURCE_HSE ? HSE_VALUE : HSI_VALUE;
+        return (uint32_t) ((uint64_t) input / pllM * pllN / pllP);
+    }
+
+    return HSI_VALUE;
+}
+
+uint32_t HAL_RCC_GetHCLKFreq(void)
+{
+    return HAL_RCC_GetSysClockFreq() / ahbPrescaler(ahbDivider);
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void)
+{
+    return HAL_RCC_GetHCLKFreq() / apbPrescaler(apb1Divider);
+}
+
+uint32_t HAL_RCC_GetPCLK2Freq(void)
+{
+    return HAL_RCC_GetHCLKFreq() / apbPrescaler(apb2Divider);
+}
+
+/* GPIO ----------------------------------------------------------------------*/
+
+void HAL_GPIO_Init(GPIO_TypeDef* GPIOx, GPIO_InitTypeDef* GPIO_Init)
+{
+}
+
+void HAL_GPIO_DeInit(GPIO_TypeDef* GPIOx, uint32_t GPIO_Pin)
+{
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin)
+{
+    return (GPIOx->IDR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+/**
+ * Applies a new output data register value, tracing actuator edges and
+ * selecting or deselecting the SPI devices whose chip select changed.
+ */
+static void updateOutputs(GPIO_TypeDef* port, uint32_t odr)
+{
+    uint32_t changed = port->ODR ^ odr;
+
+    port->ODR = odr;
+
+    if (changed == 0)
+    {
+        return;
+    }
+
+    if (simTrace)
+    {
+        for (size_t i = 0; i < sizeof(tracedPins) / sizeof(tracedPins[0]); i++)
+        {
+            if (tracedPins[i].port_ == port && (changed & tracedPins[i].pin_))
+            {
+                printf("[%10.3f s] %s %s\n", simNow() / 1e9, tracedPins[i].name_, (odr & tracedPins[i].pin_) ? "on" : "off");
+            }
+        }
+    }
+
+    for (SimSpiDevice* device = spiDevices; device; device = device->next_)
+    {
+        if (device->csPort_ == port && (changed & device->csPin_))
+        {
+            device->selected_ = (odr & device->csPin_) == 0;
+
+            if (device->select_)
+            {
+                device->select_(device, device->selected_);
+            }
+        }
+    }
+}
+
+/**
+ * Drivers outside the HAL (tm_stm32_gpio) write BSRR directly, which is
+ * plain memory here. The pending set and reset bits are applied before the
+ * next bus transfer, which is the first time a device can observe them.
+ */
+static void latchBsrr(GPIO_TypeDef* port)
+{
+    uint32_t bsrr = port->BSRR;
+
+    if (bsrr != 0)
+    {
+        port->BSRR = 0;
+        updateOutputs(port, (port->ODR & ~(bsrr >> 16)) | (bsrr & 0xFFFF));
+    }
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+    if (PinState != GPIO_PIN_RESET)
+    {
+        updateOutputs(GPIOx, GPIOx->ODR | GPIO_Pin);
+    }
+    else
+    {
+        updateOutputs(GPIOx, GPIOx->ODR & ~(uint32_t) GPIO_Pin);
+    }
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin)
+{
+    updateOutputs(GPIOx, GPIOx->ODR ^ GPIO_Pin);
+}
+
+void simGpioSetInput(GPIO_TypeDef* port, uint16_t pin, GPIO_PinState state)
+{
+    if (state != GPIO_PIN_RESET)
+    {
+        port->IDR |= pin;
+    }
+    else
+    {
+        port->IDR &= ~(uint32_t) pin;
+    }
+}
+
+/* SPI -----------------------------------------------------------------------*/
+
+void simSpiAttach(SimSpiDevice* device)
+{
+    // Chip selects are active low and outputs reset low, so a device is selected until driven high
+    device->selected_ = (device->csPort_->ODR & device->csPin_) == 0;
+    device->next_ = spiDevices;
+    spiDevices = device;
+}
+
+static uint32_t spiBusClock(SPI_TypeDef* bus)
+{
+    return bus == SPI1 ? HAL_RCC_GetPCLK2Freq() : HAL_RCC_GetPCLK1Freq();
+}
+
+static uint32_t spiPrescalerIndex(SPI_TypeDef* bus)
+{
+    return (bus->CR1 & SPI_CR1_BR) >> SPI_CR1_BR_Pos;
+}
+
+/**
+ * One byte takes 8 SCK periods, SCK being the APB clock of the bus divided
+ * by the baud rate prescaler currently programmed in CR1 (2 to 256).
+ */
+uint64_t simSpiByteTime(SPI_TypeDef* bus)
+{
+    return 8ULL * (2U << spiPrescalerIndex(bus)) * 1000000000ULL / spiBusClock(bus);
+}
+
+/**
+ * Clocks one byte between the master and every selected device on the bus
+ * without consuming time.
+ */
+static uint8_t spiShift(SPI_TypeDef* instance, uint8_t mosi, uint64_t byteTime, uint32_t prescaler)
+{
+    uint8_t miso = SIM_SPI_IDLE_BYTE;
+
+    for (SimSpiDevice* device = spiDevices; device; device = device->next_)
+    {
+        if (device->bus_ == instance && device->selected_)
+        {
+            // Every selected device sees the byte; a device not driving MISO returns 0xFF
+            miso &= device->exchange_(device, mosi);
+            device->bytes_[prescaler]++;
+            device->busyNs_[prescaler] += byteTime;
+        }
+    }
+
+    return miso;
+}
+
+static void latchChipSelects(SPI_TypeDef* instance)
+{
+    for (SimSpiDevice* device = spiDevices; device; device = device->next_)
+    {
+        if (device->bus_ == instance)
+        {
+            latchBsrr(device->csPort_);
+        }
+    }
+}
+
+static void spiTransfer(SPI_TypeDef* instance, const uint8_t* tx, uint8_t* rx, uint16_t size)
+{
+    SimSpiBus* bus = spiBusOf(instance);
+    uint32_t prescaler = spiPrescalerIndex(instance);
+    uint64_t byteTime = simSpiByteTime(instance);
+
+    latchChipSelects(instance);
+
+    for (uint16_t i = 0; i < size; i++)
+    {
+        uint8_t miso = spiShift(instance, tx[i], byteTime, prescaler);
+
+        if (rx)
+        {
+            rx[i] = miso;
+        }
+    }
+
+    bus->bytes_[prescaler] += size;
+    bus->busyNs_[prescaler] += byteTime * size;
+    bus->transfers_++;
+    simAdvance(byteTime * size);
+}
+
+uint8_t simSpiExchange(SPI_TypeDef* instance, uint8_t mosi)
+{
+    uint8_t miso;
+    spiTransfer(instance, &mosi, &miso, 1);
+    return miso;
+}
+
+HAL_StatusTypeDef HAL_SPI_Init(SPI_HandleTypeDef* hspi)
+{
+    // Same CR1 layout the HAL programs, the bus timing is derived from it
+    hspi->Instance->CR1 =
+        hspi->Init.Mode | hspi->Init.Direction | hspi->Init.DataSize | hspi->Init.CLKPolarity |
+        hspi->Init.CLKPhase | (hspi->Init.NSS & SPI_CR1_SSM) | hspi->Init.BaudRatePrescaler |
+        hspi->Init.FirstBit | hspi->Init.CRCCalculation | SPI_CR1_SPE;
+    hspi->State = HAL_SPI_STATE_READY;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef* hspi, uint8_t* pData, uint16_t Size, uint32_t Timeout)
+{
+    spiTransfer(hspi->Instance, pData, NULL, Size);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef* hspi, uint8_t* pData, uint16_t Size, uint32_t Timeout)
+{
+    // Like the HAL in full duplex master mode, the receive buffer is clocked out on MOSI
+    spiTransfer(hspi->Instance, pData, pData, Size);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef* hspi, uint8_t* pTxData, uint8_t* pRxData, uint16_t Size, uint32_t Timeout)
+{
+    spiTransfer(hspi->Instance, pTxData, pRxData, Size);
+    return HAL_OK;
+}
+
+/* UART ----------------------------------------------------------------------*/
+
+static uint64_t uartByteTime(UART_HandleTypeDef* huart)
+{
+    // Start bit, 8 data bits and one stop bit
+    return 10ULL * 1000000000ULL / huart->Init.BaudRate;
+}
+
+static void receiveInterrupt(SimUart* uart, IsrStatsId isr, void (*callback)(UART_HandleTypeDef* huart))
+{
+    if (isr != SIM_NO_ISR)
+    {
+        isrStatsEnter(isr, ISR_STATS_NO_LATENCY);
+    }
+
+    callback(uart->handle_);
+
+    if (isr != SIM_NO_ISR)
+    {
+        isrStatsExit(isr);
+    }
+}
+
+/**
+ * The idle line flag is set when the line stays high for a frame after
+ * the last byte received.
+ */
+static void idleLine(void* context, uint32_t value)
+{
+    SimUart* uart = context;
+    UART_HandleTypeDef* huart = uart->handle_;
+
+    if (!uart->deliveryScheduled_ && huart->RxState == HAL_UART_STATE_BUSY_RX && (huart->Instance->CR1 & USART_CR1_IDLEIE))
+    {
+        receiveInterrupt(uart, uart->idleIsr_, uartIdleCallback);
+    }
+}
+
+static void deliverUartByte(void* context, uint32_t value)
+{
+    SimUart* uart = context;
+    uint8_t byte = uart->fifo_[uart->fifoHead_];
+
+    uart->fifoHead_ = (uart->fifoHead_ + 1) % SIM_UART_FIFO_SIZE;
+    uart->fifoCount_--;
+    uart->rxBytes_++;
+
+    if (uart->rxBuffer_ == NULL)
+    {
+        // Nothing armed: the byte is lost as an overrun on the target
+        uart->droppedBytes_++;
+    }
+    else
+    {
+        UART_HandleTypeDef* huart = uart->handle_;
+        DMA_HandleTypeDef* dma = huart->hdmarx;
+
+        uart->rxBuffer_[uart->rxCount_++] = byte;
+
+        if (dma)
+        {
+            dma->Instance->NDTR = uart->rxSize_ - uart->rxCount_;
+
+            if (uart->rxCount_ == uart->rxSize_ / 2)
+            {
+                receiveInterrupt(uart, uart->isr_, HAL_UART_RxHalfCpltCallback);
+            }
+        }
+
+        if (uart->rxCount_ == uart->rxSize_)
+        {
+            if (dma && dma->Init.Mode == DMA_CIRCULAR)
+            {
+                // The stream reloads and carries on from the start of the buffer
+                uart->rxCount_ = 0;
+                dma->Instance->NDTR = uart->rxSize_;
+            }
+            else
+            {
+                uart->rxBuffer_ = NULL;
+                huart->RxState = HAL_UART_STATE_READY;
+            }
+
+            receiveInterrupt(uart, uart->isr_, HAL_UART_RxCpltCallback);
+        }
+    }
+
+    if (uart->fifoCount_ != 0)
+    {
+        simSchedule(simNow() + uartByteTime(uart->handle_), deliverUartByte, uart, 0);
+    }
+    else
+    {
+        uart->deliveryScheduled_ = 0;
+        simSchedule(simNow() + uartByteTime(uart->handle_), idleLine, uart, 0);
+    }
+}
+
+void simUartInject(USART_TypeDef* instance, const uint8_t* data, uint16_t length)
+{
+    SimUart* uart = uartOf(instance);
+
+    if (uart->handle_ == NULL)
+    {
+        uart->droppedBytes_ += length;
+        return;
+    }
+
+    for (uint16_t i = 0; i < length; i++)
+    {
+        if (uart->fifoCount_ == SIM_UART_FIFO_SIZE)
+        {
+            uart->droppedBytes_++;
+            continue;
+        }
+
+        uart->fifo_[(uart->fifoHead_ + uart->fifoCount_) % SIM_UART_FIFO_SIZE] = data[i];
+        uart->fifoCount_++;
+    }
+
+    if (!uart->deliveryScheduled_ && uart->fifoCount_ != 0)
+    {
+        uart->deliveryScheduled_ = 1;
+        simSchedule(simNow() + uartByteTime(uart->handle_), deliverUartByte, uart, 0);
+    }
+}
+
+void simUartSetOutput(USART_TypeDef* instance, FILE* out)
+{
+    uartOf(instance)->output_ = out;
+}
+
+void simUartAttach(SimUartDevice* device)
+{
+    uartOf(device->uart_)->device_ = device;
+}
+
+uint32_t simUartBaudRate(USART_TypeDef* instance)
+{
+    SimUart* uart = uartOf(instance);
+
+    return uart->handle_ ? uart->handle_->Init.BaudRate : 0;
+}
+
+static void transmitToDevice(SimUart* uart, uint8_t byte)
+{
+    if (uart->device_)
+    {
+        uart->device_->receive_(uart->device_, byte, uart->handle_->Init.BaudRate);
+    }
+}
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef* huart)
+{
+    SimUart* uart = uartOf(huart->Instance);
+
+    huart->gState = HAL_UART_STATE_READY;
+    huart->RxState = HAL_UART_STATE_READY;
+    uart->handle_ = huart;
+
+    if (uart->dma_)
+    {
+        // As __HAL_LINKDMA in HAL_UART_MspInit
+        huart->hdmarx = uart->dma_;
+        uart->dma_->Parent = huart;
+    }
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef* huart, uint8_t* pData, uint16_t Size, uint32_t Timeout)
+{
+    SimUart* uart = uartOf(huart->Instance);
+    uint64_t busy = uartByteTime(huart) * Size;
+
+    if (uart->output_)
+    {
+        fwrite(pData, 1, Size, uart->output_);
+    }
+
+    uart->txBytes_ += Size;
+    uart->busyNs_ += busy;
+    simAdvance(busy);
+
+    for (uint16_t i = 0; i < Size; i++)
+    {
+        transmitToDevice(uart, pData[i]);
+    }
+
+    return HAL_OK;
+}
+
+/**
+ * The transmit data register empty interrupt feeds the next byte, the
+ * transmission completes with the last one.
+ */
+static void transmitUartByte(void* context, uint32_t value)
+{
+    SimUart* uart = context;
+    uint8_t byte = uart->txBuffer_[uart->txCount_++];
+
+    if (uart->output_)
+    {
+        fwrite(&byte, 1, 1, uart->output_);
+    }
+
+    uart->txBytes_++;
+    uart->busyNs_ += uartByteTime(uart->handle_);
+    transmitToDevice(uart, byte);
+
+    if (uart->txCount_ == uart->txSize_)
+    {
+        uart->txBuffer_ = NULL;
+        uart->handle_->gState = HAL_UART_STATE_READY;
+    }
+    else
+    {
+        simSchedule(simNow() + uartByteTime(uart->handle_), transmitUartByte, uart, 0);
+    }
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef* huart, uint8_t* pData, uint16_t Size)
+{
+    SimUart* uart = uartOf(huart->Instance);
+
+    if (huart->gState != HAL_UART_STATE_READY)
+    {
+        return HAL_BUSY;
+    }
+
+    if (Size == 0)
+    {
+        return HAL_ERROR;
+    }
+
+    huart->gState = HAL_UART_STATE_BUSY_TX;
+    uart->txBuffer_ = pData;
+    uart->txSize_ = Size;
+    uart->txCount_ = 0;
+    simSchedule(simNow() + uartByteTime(huart), transmitUartByte, uart, 0);
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef armUartReceive(UART_HandleTypeDef* huart, uint8_t* pData, uint16_t Size)
+{
+    SimUart* uart = uartOf(huart->Instance);
+
+    if (uart->rxBuffer_ != NULL)
+    {
+        return HAL_BUSY;
+    }
+
+    huart->pRxBuffPtr = pData;
+    huart->RxXferSize = Size;
+    huart->RxState = HAL_UART_STATE_BUSY_RX;
+    uart->handle_ = huart;
+    uart->rxBuffer_ = pData;
+    uart->rxSize_ = Size;
+    uart->rxCount_ = 0;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef* huart, uint8_t* pData, uint16_t Size)
+{
+    return armUartReceive(huart, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef* huart)
+{
+    SimUart* uart = uartOf(huart->Instance);
+
+    uart->rxBuffer_ = NULL;
+    huart->RxState = HAL_UART_STATE_READY;
+
+    if (huart->hdmarx)
+    {
+        huart->hdmarx->Instance->NDTR = 0;
+    }
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef* huart, uint8_t* pData, uint16_t Size)
+{
+    HAL_StatusTypeDef status = armUartReceive(huart, pData, Size);
+
+    if (status == HAL_OK && huart->hdmarx)
+    {
+        huart->hdmarx->Instance->NDTR = Size;
+    }
+
+    return status;
+}
+
+/* ADC -----------------------------------------------------------------------*/
+
+HAL_StatusTypeDef HAL_ADC_Init(ADC_HandleTypeDef* hadc)
+{
+    hadc->State = HAL_ADC_STATE_READY;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_ConfigChannel(ADC_HandleTypeDef* hadc, ADC_ChannelConfTypeDef* sConfig)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_Start(ADC_HandleTypeDef* hadc)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_PollForConversion(ADC_HandleTypeDef* hadc, uint32_t Timeout)
+{
+    adcOf(hadc->Instance)->conversions_++;
+    simAdvance(SIM_ADC_CONVERSION_NS);
+    return HAL_OK;
+}
+
+uint32_t HAL_ADC_GetValue(ADC_HandleTypeDef* hadc)
+{
+    return adcOf(hadc->Instance)->value_;
+}
+
+void simAdcSet(ADC_TypeDef* instance, uint16_t value)
+{
+    adcOf(instance)->value_ = value;
+}
+
+/* TIM -----------------------------------------------------------------------*/
+
+// APB1 timers run at twice PCLK1 unless the APB1 prescaler is 1
+static uint32_t timerClock(void)
+{
+    return apbPrescaler(apb1Divider) == 1 ? HAL_RCC_GetPCLK1Freq() : 2 * HAL_RCC_GetPCLK1Freq();
+}
+
+// In 128 bits, a full 32 bit period of TIM5 overflows 64 bit nanosecond products
+static uint64_t timerTicksToNs(TIM_TypeDef* instance, uint64_t ticks)
+{
+    return (uint64_t) ((unsigned __int128) ticks * (instance->PSC + 1) * 1000000000ULL / timerClock());
+}
+
+static void updateTimerCounters(void)
+{
+    for (int i = 0; i < SIM_TIMER_COUNT; i++)
+    {
+        SimTimer* timer = &timers[i];
+
+        if (timer->running_)
+        {
+            TIM_TypeDef* instance = timer->instance_;
+            uint64_t elapsedNs = simNow() - timer->periodStartNs_;
+            instance->CNT = (uint32_t) ((unsigned __int128) elapsedNs * timerClock() / ((instance->PSC + 1) * 1000000000ULL));
+        }
+    }
+}
+
+/**
+ * Update event: the counter wraps at ARR and the update interrupt runs
+ * HAL_TIM_PeriodElapsedCallback, as HAL_TIM_IRQHandler does. ARR is read
+ * again for every period, so a new period takes effect at the next update.
+ */
+static void timerUpdate(void* context, uint32_t value)
+{
+    SimTimer* timer = context;
+    TIM_TypeDef* instance = timer->instance_;
+
+    // The counter keeps its own time even if the interrupt was held off
+    timer->periodStartNs_ = timer->updateNs_;
+    timer->updateNs_ += timerTicksToNs(instance, instance->ARR + 1ULL);
+    timer->updates_++;
+    updateTimerCounters();
+    simSchedule(timer->updateNs_, timerUpdate, timer, 0);
+    isrStatsEnter(timer->isr_, instance->CNT);
+    HAL_TIM_PeriodElapsedCallback(timer->handle_);
+    isrStatsExit(timer->isr_);
+}
+
+/**
+ * Compare match on channel 1: sets CC1IF and, if CC1IE is still set for
+ * the same compare, runs HAL_TIM_OC_DelayElapsedCallback as
+ * HAL_TIM_IRQHandler does in output compare mode.
+ */
+static void timerCompare(void* context, uint32_t generation)
+{
+    SimTimer* timer = context;
+    TIM_TypeDef* instance = timer->instance_;
+
+    if (generation != timer->compareGeneration_ || !(instance->DIER & TIM_DIER_CC1IE))
+    {
+        return;
+    }
+
+    updateTimerCounters();
+    instance->SR &= ~TIM_SR_CC1IF;
+    timer->compares_++;
+    isrStatsEnter(timer->isr_, instance->CNT - instance->CCR1); // As TIM5_IRQHandler, on the free running counter
+    timer->handle_->Channel = HAL_TIM_ACTIVE_CHANNEL_1;
+    HAL_TIM_OC_DelayElapsedCallback(timer->handle_);
+    timer->handle_->Channel = HAL_TIM_ACTIVE_CHANNEL_CLEARED;
+    isrStatsExit(timer->isr_);
+}
+
+/**
+ * The firmware programs channel 1 through the registers, so the clock
+ * looks at them whenever it moves. A newly enabled interrupt or a new
+ * CCR1 schedules the match for when CNT reaches it, after the next wrap if
+ * it already passed, as on the target. CC1G in EGR matches right away.
+ */
+static void updateTimerCompares(void)
+{
+    for (int i = 0; i < SIM_TIMER_COUNT; i++)
+    {
+        SimTimer* timer = &timers[i];
+        TIM_TypeDef* instance = timer->instance_;
+
+        if (!timer->running_)
+        {
+            continue;
+        }
+
+        if (!(instance->DIER & TIM_DIER_CC1IE))
+        {
+            timer->compareArmed_ = 0;
+            instance->EGR = 0;
+            continue;
+        }
+
+        if (instance->EGR & TIM_EGR_CC1G)
+        {
+            // EGR reads as zero on the target
+            instance->EGR = 0;
+            timer->compareArmed_ = 1;
+            timer->compare_ = instance->CCR1;
+            simSchedule(simNow(), timerCompare, timer, ++timer->compareGeneration_);
+        }
+        else if (!timer->compareArmed_ || instance->CCR1 != timer->compare_)
+        {
+            uint64_t matchNs = instance->CCR1 >= instance->CNT ? timer->periodStartNs_ : timer->updateNs_;
+
+            timer->compareArmed_ = 1;
+            timer->compare_ = instance->CCR1;
+            simSchedule(matchNs + timerTicksToNs(instance, instance->CCR1), timerCompare, timer, ++timer->compareGeneration_);
+        }
+    }
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef* htim)
+{
+    SimTimer* timer = timerOf(htim->Instance);
+
+    if (timer == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    timer->handle_ = htim;
+    htim->Instance->PSC = htim->Init.Prescaler;
+    htim->Instance->ARR = htim->Init.Period;
+    htim->State = HAL_TIM_STATE_READY;
+    return HAL_OK;
+}
+
+// Only the internal clock is modelled
+HAL_StatusTypeDef HAL_TIM_ConfigClockSource(TIM_HandleTypeDef* htim, TIM_ClockConfigTypeDef* sClockSourceConfig)
+{
+    return sClockSourceConfig->ClockSource == TIM_CLOCKSOURCE_INTERNAL ? HAL_OK : HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_TIMEx_MasterConfigSynchronization(TIM_HandleTypeDef* htim, TIM_MasterConfigTypeDef* sMasterConfig)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef* htim)
+{
+    SimTimer* timer = timerOf(htim->Instance);
+
+    if (timer == NULL || timer->running_)
+    {
+        return HAL_ERROR;
+    }
+
+    timer->running_ = 1;
+    timer->periodStartNs_ = simNow();
+    timer->updateNs_ = simNow() + timerTicksToNs(htim->Instance, htim->Instance->ARR + 1ULL);
+    htim->Instance->CNT = 0;
+    htim->State = HAL_TIM_STATE_BUSY;
+    simSchedule(timer->updateNs_, timerUpdate, timer, 0);
+    return HAL_OK;
+}
+
+/* CRC -----------------------------------------------------------------------*/
+
+HAL_StatusTypeDef HAL_CRC_Init(CRC_HandleTypeDef* hcrc)
+{
+    hcrc->State = HAL_CRC_STATE_READY;
+    return HAL_OK;
+}
+
+/**
+ * Same result as the STM32 CRC unit: CRC-32 polynomial 0x04C11DB7, initial
+ * value 0xFFFFFFFF, fed one 32 bit word at a time MSB first, no reflection
+ * and no final XOR.
+ */
+uint32_t HAL_CRC_Calculate(CRC_HandleTypeDef* hcrc, uint32_t pBuffer[], uint32_t BufferLength)
+{
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (uint32_t i = 0; i < BufferLength; i++)
+    {
+        crc ^= pBuffer[i];
+
+        for (int bit = 0; bit < 32; bit++)
+        {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+        }
+    }
+
+    return crc;
+}
+
+/* Statistics ----------------------------------------------------------------*/
+
+/**
+ * Clears the bus counters, e.g. after the SD card image has been formatted
+ * outside the flight.
+ */
+void simHalResetStats(void)
+{
+    for (int i = 0; i < SIM_SPI_BUS_COUNT; i++)
+    {
+        memset(spiBuses[i].bytes_, 0, sizeof(spiBuses[i].bytes_));
+        memset(spiBuses[i].busyNs_, 0, sizeof(spiBuses[i].busyNs_));
+        spiBuses[i].transfers_ = 0;
+    }
+
+    for (SimSpiDevice* device = spiDevices; device; device = device->next_)
+    {
+        memset(device->bytes_, 0, sizeof(device->bytes_));
+        memset(device->busyNs_, 0, sizeof(device->busyNs_));
+    }
+
+    for (int i = 0; i < SIM_UART_COUNT; i++)
+    {
+        uarts[i].txBytes_ = 0;
+        uarts[i].rxBytes_ = 0;
+        uarts[i].droppedBytes_ = 0;
+        uarts[i].busyNs_ = 0;
+    }
+
+    for (int i = 0; i < SIM_ADC_COUNT; i++)
+    {
+        adcs[i].conversions_ = 0;
+    }
+
+    for (int i = 0; i < SIM_TIMER_COUNT; i++)
+    {
+        timers[i].updates_ = 0;
+        timers[i].compares_ = 0;
+    }
+}
+
+static double spiSckHz(SPI_TypeDef* bus, uint32_t prescaler)
+{
+    return spiBusClock(bus) / (double) (2U << prescaler);
+}
+
+static double load(uint64_t busyNs, double simSeconds)
+{
+    return simSeconds > 0 ? 100.0 * busyNs / (simSeconds * 1e9) : 0.0;
+}
+
+void simHalPrintStats(FILE* out, double simSeconds)
+{
+    fprintf(out, "%-12s %-6s %10s %12s %12s %12s %7s\n", "SPI", "Div", "SCK kHz", "Bytes", "Transfers", "Busy ms", "Load");
+
+    for (int i = 0; i < SIM_SPI_BUS_COUNT; i++)
+    {
+        SimSpiBus* bus = &spiBuses[i];
+
+        for (uint32_t prescaler = 0; prescaler < SIM_SPI_PRESCALER_COUNT; prescaler++)
+        {
+            if (bus->bytes_[prescaler] == 0)
+            {
+                continue;
+            }
+
+            fprintf(
+                out,
+                "%-12s /%-5u %10.1f %12llu %12llu %12.3f %6.2f%%\n",
+                bus->name_,
+                2U << prescaler,
+                spiSckHz(bus->instance_, prescaler) / 1e3,
+                (unsigned long long) bus->bytes_[prescaler],
+                (unsigned long long) bus->transfers_,
+                bus->busyNs_[prescaler] / 1e6,
+                load(bus->busyNs_[prescaler], simSeconds)
+            );
+        }
+    }
+
+    for (SimSpiDevice* device = spiDevices; device; device = device->next_)
+    {
+        for (uint32_t prescaler = 0; prescaler < SIM_SPI_PRESCALER_COUNT; prescaler++)
+        {
+            if (device->bytes_[prescaler] == 0)
+            {
+                continue;
+            }
+
+            fprintf(
+                out,
+                "  %-10s /%-5u %10.1f %12llu %12s %12.3f %6.2f%%\n",
+                device->name_,
+                2U << prescaler,
+                spiSckHz(device->bus_, prescaler) / 1e3,
+                (unsigned long long) device->bytes_[prescaler],
+                "",
+                device->busyNs_[prescaler] / 1e6,
+                load(device->busyNs_[prescaler], simSeconds)
+            );
+        }
+    }
+
+    // The same traffic at every prescaler the bus could be programmed with
+    fprintf(out, "%-12s", "Load at div");
+
+    for (uint32_t prescaler = 0; prescaler < SIM_SPI_PRESCALER_COUNT; prescaler++)
+    {
+        fprintf(out, " %7u", 2U << prescaler);
+    }
+
+    fprintf(out, "\n");
+
+    for (SimSpiDevice* device = spiDevices; device; device = device->next_)
+    {
+        uint64_t bytes = 0;
+
+        for (uint32_t prescaler = 0; prescaler < SIM_SPI_PRESCALER_COUNT; prescaler++)
+        {
+            bytes += device->bytes_[prescaler];
+        }
+
+        fprintf(out, "  %-10s", device->name_);
+
+        for (uint32_t prescaler = 0; prescaler < SIM_SPI_PRESCALER_COUNT; prescaler++)
+        {
+            double busyNs = bytes * 8.0 * 1e9 / spiSckHz(device->bus_, prescaler);
+            fprintf(out, " %6.2f%%", load((uint64_t) busyNs, simSeconds));
+        }
+
+        fprintf(out, "\n");
+    }
+
+    fprintf(out, "%-12s %10s %12s %12s %12s %7s\n", "UART", "Baud", "TX bytes", "RX bytes", "Dropped", "TX load");
+
+    for (int i = 0; i < SIM_UART_COUNT; i++)
+    {
+        SimUart* uart = &uarts[i];
+
+        if (uart->handle_ == NULL)
+        {
+            continue;
+        }
+
+        fprintf(
+            out,
+            "%-12s %10lu %12llu %12llu %12llu %6.2f%%\n",
+            uart->name_,
+            (unsigned long) uart->handle_->Init.BaudRate,
+            (unsigned long long) uart->txBytes_,
+            (unsigned long long) uart->rxBytes_,
+            (unsigned long long) uart->droppedBytes_,
+            load(uart->busyNs_, simSeconds)
+        );
+    }
+
+    for (int i = 0; i < SIM_ADC_COUNT; i++)
+    {
+        fprintf(out, "%s: %llu conversions\n", adcs[i].name_, (unsigned long long) adcs[i].conversions_);
+    }
+
+    for (int i = 0; i < SIM_TIMER_COUNT; i++)
+    {
+        fprintf(out, "%s: %llu updates, %llu compares\n", timers[i].name_,
+            (unsigned long long) timers[i].updates_, (unsigned long long) timers[i].compares_);
+    }
+}
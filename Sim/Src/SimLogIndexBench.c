@@ -0,0 +1,164 @@
+/**
+  ******************************************************************************
+  * File Name          : SimLogIndexBench.c
+  * Description        : Boot time of the log file selection of LogData.c on a
+  *                      card that holds the logs of many earlier boots.
+  *
+  *   avionics-sim --sd image --log-index-bench count
+  *       Fills a new image with AvionicsData1.csv to AvionicsData<count>.csv
+  *       and LogIndex.txt, then boots twice: once with the index file, and
+  *       once without it, so createNextLogFile falls back to the
+  *       f_findfirst scan of the whole directory. Each boot remounts the
+  *       card and reports the simulated time and sectors read by the mount
+  *       and by createNextLogFile, which ends with the first log file and
+  *       the index file written. Fails if either boot picks another index
+  *       than count + 1.
+  ******************************************************************************
+*/
+
+#include <stdio.h>
+
+#include "ff.h"
+
+#include "Sim.h"
+#include "SimDevices.h"
+#include "LogData.h"
+#include "LogFormat.h"
+
+// main.c, the flight clock tree sets the SPI3 clock of the card
+void SystemClock_Config(void);
+
+static FATFS fatfs;
+static FIL file;
+
+typedef struct
+{
+    uint32_t index_;
+    uint64_t mountNs_;
+    uint64_t mountSectors_;
+    uint64_t createNs_;
+    uint64_t createSectors_;
+} SimBootResult;
+
+static int fillCard(uint32_t count)
+{
+    char name[32];
+
+    for (uint32_t index = 1; index <= count; index++)
+    {
+        snprintf(name, sizeof(name), "SD:AvionicsData%lu.csv", (unsigned long) index);
+
+        if (f_open(&file, name, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+        {
+            fprintf(stderr, "sim: cannot create %s\n", name);
+            return -1;
+        }
+
+        f_close(&file);
+
+        // The first boot creates the index file, later ones rewrite it in place
+        if (index == 1 || index == count)
+        {
+            writeLogIndex(index);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Mounts the card and creates the log file as logDataTask does after reset.
+ */
+static int boot(SimBootResult* result)
+{
+    char name[32];
+    uint64_t startNs = simNow();
+    uint64_t startSectors = simSdCardSectorsRead();
+
+    if (f_mount(&fatfs, "SD:", 1) != FR_OK)
+    {
+        fprintf(stderr, "sim: cannot mount the SD card image\n");
+        return -1;
+    }
+
+    result->mountNs_ = simNow() - startNs;
+    result->mountSectors_ = simSdCardSectorsRead() - startSectors;
+    startNs = simNow();
+    startSectors = simSdCardSectorsRead();
+
+    if (!createNextLogFile(&result->index_))
+    {
+        fprintf(stderr, "sim: cannot create the log file\n");
+        return -1;
+    }
+
+    result->createNs_ = simNow() - startNs;
+    result->createSectors_ = simSdCardSectorsRead() - startSectors;
+
+    // Back to the card as it was, so both boots see the same directory
+    snprintf(name, sizeof(name), "SD:AvionicsData%lu.csv", (unsigned long) result->index_);
+    f_unlink(name);
+    writeLogIndex(result->index_ - 1);
+    f_mount(NULL, "SD:", 1);
+    return 0;
+}
+
+static void printResult(const char* what, const SimBootResult* result)
+{
+    printf(
+        "%-16s index %lu, mount %8.3f ms %5llu sectors, createNextLogFile %9.3f ms %6llu sectors\n",
+        what,
+        (unsigned long) result->index_,
+        result->mountNs_ / (double) SIM_NS_PER_MS,
+        (unsigned long long) result->mountSectors_,
+        result->createNs_ / (double) SIM_NS_PER_MS,
+        (unsigned long long) result->createSectors_
+    );
+}
+
+int simLogIndexBench(uint32_t count)
+{
+    SimBootResult withIndex;
+    SimBootResult withoutIndex;
+
+    SystemClock_Config();
+
+    if (f_mount(&fatfs, "SD:", 1) != FR_OK)
+    {
+        fprintf(stderr, "sim: cannot mount the SD card image\n");
+        return -1;
+    }
+
+    if (fillCard(count) != 0)
+    {
+        return -1;
+    }
+
+    f_mount(NULL, "SD:", 1);
+
+    if (boot(&withIndex) != 0)
+    {
+        return -1;
+    }
+
+    f_mount(&fatfs, "SD:", 1);
+    f_unlink("SD:LogIndex.txt");
+    f_mount(NULL, "SD:", 1);
+
+    if (boot(&withoutIndex) != 0)
+    {
+        return -1;
+    }
+
+    printf("%lu log files on the card\n", (unsigned long) count);
+    printResult("LogIndex.txt", &withIndex);
+    printResult("no LogIndex.txt", &withoutIndex);
+
+    if (withIndex.index_ != count + 1 || withoutIndex.index_ != count + 1)
+    {
+        printf("FAIL: expected index %lu\n", (unsigned long) (count + 1));
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,385 @@
+/**
+  ******************************************************************************
+  * File Name          : SimLsm9ds1.c
+  * Description        : LSM9DS1 iNEMO inertial module model for the host build.
+  *                      The accelerometer/gyroscope and the magnetometer are
+  *                      separate SPI slaves with their own register maps.
+  *                      The gyroscope and accelerometer FIFO is modelled in
+  *                      continuous mode.
+  ******************************************************************************
+*/
+
+#include <math.h>
+#include <string.h>
+
+#include "Sim.h"
+#include "SimDevices.h"
+#include "SimHal.h"
+#include "SimTrajectory.h"
+#include "main.h"
+
+#define SIM_LSM9DS1_REGISTER_COUNT 0x80
+
+// Accelerometer/gyroscope registers
+#define AG_WHO_AM_I 0x0F
+#define AG_WHO_AM_I_VALUE 0x68
+#define AG_CTRL_REG1_G 0x10
+#define AG_OUT_TEMP_L 0x15
+#define AG_STATUS_REG 0x17
+#define AG_OUT_X_L_G 0x18
+#define AG_CTRL_REG4 0x1E
+#define AG_CTRL_REG5_XL 0x1F
+#define AG_CTRL_REG6_XL 0x20
+#define AG_CTRL_REG8 0x22
+#define AG_CTRL_REG9 0x23
+#define AG_STATUS_REG_XL 0x27
+#define AG_OUT_X_L_XL 0x28
+#define AG_FIFO_CTRL 0x2E
+#define AG_FIFO_SRC 0x2F
+#define AG_IF_ADD_INC 0x04
+#define AG_FIFO_EN 0x02
+#define AG_FIFO_MODE_CONTINUOUS 0xC0 // FMODE in the top three bits of FIFO_CTRL
+#define AG_FIFO_SIZE 32
+#define AG_FIFO_OVERRUN 0x40
+
+// Magnetometer registers
+#define M_WHO_AM_I 0x0F
+#define M_WHO_AM_I_VALUE 0x3D
+#define M_CTRL_REG1 0x20
+#define M_CTRL_REG2 0x21
+#define M_CTRL_REG3 0x22
+#define M_STATUS_REG 0x27
+#define M_OUT_X_L 0x28
+
+#define SPI_READ 0x80
+#define SPI_M_AUTO_INCREMENT 0x40 // MS bit, magnetometer only
+
+typedef struct
+{
+    int         magnetometer_;
+    uint8_t     registers_[SIM_LSM9DS1_REGISTER_COUNT];
+    int         addressed_; // The address byte of this transaction has been received
+    int         read_;
+    int         autoIncrement_;
+    uint8_t     address_;
+    int         fifoOn_; // Continuous mode, accelerometer/gyroscope only
+    uint64_t    fifoReadNs_; // Sample time of the last sample read out of the FIFO
+    int         fifoOverrun_; // Since the last FIFO_SRC read
+} Lsm9ds1Interface;
+
+// Output data rates selected by ODR_G and ODR_XL, 0 is power-down
+static const double GYRO_ODR_HZ[8] = {0, 14.9, 59.5, 119, 238, 476, 952, 0};
+static const double ACCEL_ODR_HZ[8] = {0, 10, 50, 119, 238, 476, 952, 0};
+static const double MAG_ODR_HZ[8] = {0.625, 1.25, 2.5, 5, 10, 20, 40, 80};
+
+// Sensitivity per LSB for each FS setting
+static const double GYRO_MDPS_PER_LSB[4] = {8.75, 17.5, 0, 70};
+static const double ACCEL_MG_PER_LSB[4] = {0.061, 0.732, 0.122, 0.244};
+static const double MAG_MGAUSS_PER_LSB[4] = {0.14, 0.29, 0.43, 0.58};
+
+static Lsm9ds1Interface accelGyro;
+static Lsm9ds1Interface magnetometer = {1};
+
+static SimSpiDevice accelGyroDevice;
+static SimSpiDevice magnetometerDevice;
+
+static void reset(Lsm9ds1Interface* interface)
+{
+    memset(interface->registers_, 0, sizeof(interface->registers_));
+    interface->fifoOn_ = 0;
+
+    if (interface->magnetometer_)
+    {
+        interface->registers_[M_WHO_AM_I] = M_WHO_AM_I_VALUE;
+        interface->registers_[M_CTRL_REG1] = 0x10; // 10 Hz
+        interface->registers_[M_CTRL_REG3] = 0x03; // Power-down
+    }
+    else
+    {
+        interface->registers_[AG_WHO_AM_I] = AG_WHO_AM_I_VALUE;
+        interface->registers_[AG_CTRL_REG4] = 0x38;
+        interface->registers_[AG_CTRL_REG5_XL] = 0x38;
+        interface->registers_[AG_CTRL_REG8] = AG_IF_ADD_INC;
+    }
+}
+
+/**
+ * Output registers hold the sample taken at the last output data rate
+ * boundary, so reads between two samples return the same data.
+ */
+static uint64_t lastSampleTime(double odrHz)
+{
+    uint64_t periodNs = (uint64_t) (1e9 / odrHz);
+    return simNow() / periodNs * periodNs;
+}
+
+static double gyroOdrHz(void)
+{
+    return GYRO_ODR_HZ[accelGyro.registers_[AG_CTRL_REG1_G] >> 5];
+}
+
+/**
+ * Unread samples in the FIFO. A full FIFO drops its oldest sample for each
+ * new one and flags the overrun.
+ */
+static int fifoSamples(void)
+{
+    uint64_t periodNs = (uint64_t) (1e9 / gyroOdrHz());
+    uint64_t newestNs = lastSampleTime(gyroOdrHz());
+    int samples = newestNs > accelGyro.fifoReadNs_ ? (int) ((newestNs - accelGyro.fifoReadNs_) / periodNs) : 0;
+
+    if (samples > AG_FIFO_SIZE)
+    {
+        accelGyro.fifoReadNs_ = newestNs - AG_FIFO_SIZE * periodNs;
+        accelGyro.fifoOverrun_ = 1;
+        samples = AG_FIFO_SIZE;
+    }
+
+    return samples;
+}
+
+/**
+ * Starts or stops the FIFO after a write to its control registers. It
+ * starts empty.
+ */
+static void updateFifo(void)
+{
+    const uint8_t* registers = accelGyro.registers_;
+    int on =
+        (registers[AG_CTRL_REG9] & AG_FIFO_EN) != 0 &&
+        (registers[AG_FIFO_CTRL] & 0xE0) == AG_FIFO_MODE_CONTINUOUS &&
+        gyroOdrHz() != 0;
+
+    if (on && !accelGyro.fifoOn_)
+    {
+        accelGyro.fifoReadNs_ = lastSampleTime(gyroOdrHz());
+        accelGyro.fifoOverrun_ = 0;
+    }
+
+    accelGyro.fifoOn_ = on;
+}
+
+/**
+ * Time of the sample the output registers hold: the oldest unread one
+ * with the FIFO on and not empty, else the latest one.
+ */
+static uint64_t outputSampleTime(double odrHz)
+{
+    if (accelGyro.fifoOn_ && fifoSamples() > 0)
+    {
+        return accelGyro.fifoReadNs_ + (uint64_t) (1e9 / odrHz);
+    }
+
+    return lastSampleTime(odrHz);
+}
+
+static int16_t saturate(double value)
+{
+    value = round(value);
+    return value > INT16_MAX ? INT16_MAX : value < INT16_MIN ? INT16_MIN : (int16_t) value;
+}
+
+/**
+ * Builds the six output bytes of a sensor, X to Z and low byte first.
+ */
+static void fillAxes(uint8_t* out, const double* values, double unitsPerLsb)
+{
+    for (int axis = 0; axis < 3; axis++)
+    {
+        int16_t raw = saturate(values[axis] / unitsPerLsb);
+        out[2 * axis] = (uint8_t) raw;
+        out[2 * axis + 1] = (uint8_t) ((uint16_t) raw >> 8);
+    }
+}
+
+static uint8_t readAccelGyro(uint8_t address)
+{
+    const uint8_t* registers = accelGyro.registers_;
+    double gyroOdr = GYRO_ODR_HZ[registers[AG_CTRL_REG1_G] >> 5];
+    // With the gyroscope on, both sensors run at its rate
+    double accelOdr = gyroOdr != 0 ? gyroOdr : ACCEL_ODR_HZ[registers[AG_CTRL_REG6_XL] >> 5];
+    uint8_t out[6] = {0};
+    SimVehicleState state;
+
+    if (address >= AG_OUT_X_L_G && address < AG_OUT_X_L_G + 6 && gyroOdr != 0)
+    {
+        double mdps[3];
+        simTrajectorySample(outputSampleTime(gyroOdr), &state);
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            mdps[axis] = state.gyroDps_[axis] * 1e3;
+        }
+
+        fillAxes(out, mdps, GYRO_MDPS_PER_LSB[(registers[AG_CTRL_REG1_G] >> 3) & 0x03]);
+        return out[address - AG_OUT_X_L_G];
+    }
+
+    if (address >= AG_OUT_X_L_XL && address < AG_OUT_X_L_XL + 6 && accelOdr != 0)
+    {
+        double mg[3];
+        simTrajectorySample(outputSampleTime(accelOdr), &state);
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            mg[axis] = state.accelG_[axis] * 1e3;
+        }
+
+        fillAxes(out, mg, ACCEL_MG_PER_LSB[(registers[AG_CTRL_REG6_XL] >> 3) & 0x03]);
+
+        // Reading the last accelerometer byte moves the FIFO to the next sample
+        if (address == AG_OUT_X_L_XL + 5 && accelGyro.fifoOn_ && fifoSamples() > 0)
+        {
+            accelGyro.fifoReadNs_ += (uint64_t) (1e9 / accelOdr);
+        }
+
+        return out[address - AG_OUT_X_L_XL];
+    }
+
+    if ((address == AG_OUT_TEMP_L || address == AG_OUT_TEMP_L + 1) && gyroOdr != 0)
+    {
+        // 16 LSB/°C around 25 °C
+        simTrajectorySample(lastSampleTime(gyroOdr), &state);
+        int16_t raw = saturate((state.temperatureC_ - 25.0) * 16.0);
+        return address == AG_OUT_TEMP_L ? (uint8_t) raw : (uint8_t) ((uint16_t) raw >> 8);
+    }
+
+    if (address == AG_FIFO_SRC)
+    {
+        int samples = accelGyro.fifoOn_ ? fifoSamples() : 0;
+        uint8_t source = (uint8_t) samples | (accelGyro.fifoOverrun_ ? AG_FIFO_OVERRUN : 0);
+
+        accelGyro.fifoOverrun_ = 0;
+        return source;
+    }
+
+    if (address == AG_STATUS_REG || address == AG_STATUS_REG_XL)
+    {
+        // Temperature, gyroscope and accelerometer data available
+        return (gyroOdr != 0 ? 0x06 : 0) | (accelOdr != 0 ? 0x01 : 0);
+    }
+
+    return registers[address];
+}
+
+static uint8_t readMagnetometer(uint8_t address)
+{
+    const uint8_t* registers = magnetometer.registers_;
+    int continuous = (registers[M_CTRL_REG3] & 0x03) == 0;
+
+    if (address >= M_OUT_X_L && address < M_OUT_X_L + 6 && continuous)
+    {
+        uint8_t out[6];
+        double mgauss[3];
+        SimVehicleState state;
+
+        simTrajectorySample(lastSampleTime(MAG_ODR_HZ[(registers[M_CTRL_REG1] >> 2) & 0x07]), &state);
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            mgauss[axis] = state.magGauss_[axis] * 1e3;
+        }
+
+        fillAxes(out, mgauss, MAG_MGAUSS_PER_LSB[(registers[M_CTRL_REG2] >> 5) & 0x03]);
+        return out[address - M_OUT_X_L];
+    }
+
+    if (address == M_STATUS_REG)
+    {
+        return continuous ? 0x0F : 0;
+    }
+
+    return registers[address];
+}
+
+static void selectInterface(SimSpiDevice* device, int selected)
+{
+    Lsm9ds1Interface* interface = device->state_;
+    interface->addressed_ = 0;
+}
+
+/**
+ * First byte: R/W bit, then the register address (and the MS auto-increment
+ * bit on the magnetometer). Following bytes read or write consecutive
+ * registers while auto-increment is enabled.
+ */
+static uint8_t exchangeInterface(SimSpiDevice* device, uint8_t mosi)
+{
+    Lsm9ds1Interface* interface = device->state_;
+    uint8_t miso = SIM_SPI_IDLE_BYTE;
+
+    if (!interface->addressed_)
+    {
+        interface->addressed_ = 1;
+        interface->read_ = (mosi & SPI_READ) != 0;
+
+        if (interface->magnetometer_)
+        {
+            interface->address_ = mosi & 0x3F;
+            interface->autoIncrement_ = (mosi & SPI_M_AUTO_INCREMENT) != 0;
+        }
+        else
+        {
+            interface->address_ = mosi & 0x7F;
+            interface->autoIncrement_ = (interface->registers_[AG_CTRL_REG8] & AG_IF_ADD_INC) != 0;
+        }
+
+        return miso;
+    }
+
+    if (interface->read_)
+    {
+        miso = interface->magnetometer_ ? readMagnetometer(interface->address_) : readAccelGyro(interface->address_);
+    }
+    else
+    {
+        interface->registers_[interface->address_] = mosi;
+
+        if (!interface->magnetometer_ && interface->address_ == AG_CTRL_REG8 && (mosi & 0x01))
+        {
+            reset(interface); // SW_RESET
+        }
+
+        if (!interface->magnetometer_)
+        {
+            updateFifo();
+        }
+    }
+
+    if (interface->autoIncrement_)
+    {
+        interface->address_ = (interface->address_ + 1) % SIM_LSM9DS1_REGISTER_COUNT;
+    }
+
+    return miso;
+}
+
+void simLsm9ds1Attach(void)
+{
+    reset(&accelGyro);
+    reset(&magnetometer);
+
+    accelGyroDevice = (SimSpiDevice)
+    {
+        .name_ = "LSM9DS1 AG",
+        .bus_ = SPI1,
+        .csPort_ = IMU_CS_GPIO_Port,
+        .csPin_ = IMU_CS_Pin,
+        .select_ = selectInterface,
+        .exchange_ = exchangeInterface,
+        .state_ = &accelGyro,
+    };
+    magnetometerDevice = (SimSpiDevice)
+    {
+        .name_ = "LSM9DS1 M",
+        .bus_ = SPI1,
+        .csPort_ = MAG_CS_GPIO_Port,
+        .csPin_ = MAG_CS_Pin,
+        .select_ = selectInterface,
+        .exchange_ = exchangeInterface,
+        .state_ = &magnetometer,
+    };
+
+    simSpiAttach(&accelGyroDevice);
+    simSpiAttach(&magnetometerDevice);
+}
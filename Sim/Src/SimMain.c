@@ -0,0 +1,486 @@
+/**
+  ******************************************************************************
+  * File Name          : SimMain.c
+  * Description        : Entry point of the host software-in-the-loop build.
+  *                      Maps the peripheral address space, attaches the
+  *                      device models, loads the flight scenario and runs the
+  *                      unmodified firmware main.
+  *
+  *   Usage: avionics-sim [--duration s] [--script file] [--trajectory file]
+  *                       [--sd image] [--uart1 file] [--gnss m8|nmea|none]
+  *                       [--trace] [--insert file] [--extract dir]
+  *                       [--log-index-bench count]
+  ******************************************************************************
+*/
+
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include "Sim.h"
+#include "SimDevices.h"
+#include "SimHal.h"
+#include "SimTrajectory.h"
+#include "FlightPhase.h"
+#include "ReadGps.h"
+
+#define SIM_PERIPH_SIZE 0x10100000UL // APB1, APB2, AHB1 and AHB2 (RNG ends at 0x50060C00)
+#define SIM_CORE_PERIPH_BASE 0xE0000000UL
+#define SIM_CORE_PERIPH_SIZE 0x00100000UL
+#define SIM_DEFAULT_DURATION_S 60.0
+#define SIM_DEFAULT_SD_SIZE (64ULL * 1024 * 1024)
+#define SIM_LOG_INDEX_BENCH_SD_SIZE (4ULL * 1024 * 1024 * 1024) // FAT32 as a flight card, a FAT16 root directory holds 512 entries
+#define SIM_PHASE_SAMPLE_NS (10 * SIM_NS_PER_MS)
+#define SIM_MAX_SCRIPT_ENTRIES 64
+#define SIM_MAX_SCRIPT_TEXT 128
+
+typedef enum
+{
+    SCRIPT_UART,
+    SCRIPT_ADC
+} ScriptKind;
+
+/**
+ * One scenario line: inject value into target at start, then every period
+ * until end. A zero period injects once.
+ */
+typedef struct
+{
+    uint64_t        startNs_;
+    uint64_t        periodNs_;
+    uint64_t        endNs_;
+    ScriptKind      kind_;
+    USART_TypeDef*  uart_;
+    ADC_TypeDef*    adc_;
+    uint8_t         data_[SIM_MAX_SCRIPT_TEXT];
+    uint16_t        length_;
+    uint16_t        value_;
+} ScriptEntry;
+
+int firmwareMain(void);
+
+int simTrace = 0;
+
+static ScriptEntry script[SIM_MAX_SCRIPT_ENTRIES];
+static int scriptLength = 0;
+static struct timespec wallStart;
+
+static const char* const PHASE_NAMES[] =
+{
+    "PRELAUNCH",
+    "ARM",
+    "BURN",
+    "COAST",
+    "DROGUE_DESCENT",
+    "MAIN_DESCENT",
+    "POST_FLIGHT",
+    "ABORT_COMMAND_RECEIVED",
+    "ABORT_COMMUNICATION_ERROR",
+    "ABORT_OXIDIZER_PRESSURE",
+    "ABORT_UNSPECIFIED_REASON"
+};
+
+static double wallSeconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - wallStart.tv_sec) + (now.tv_nsec - wallStart.tv_nsec) / 1e9;
+}
+
+/**
+ * The HAL and CMSIS headers address peripherals at their physical
+ * addresses, so plain memory is mapped there to hold the registers.
+ */
+static int mapRegion(uintptr_t base, size_t size)
+{
+    void* region = mmap((void*) base, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+    if (region == MAP_FAILED || region != (void*) base)
+    {
+        fprintf(stderr, "sim: cannot map peripheral region at 0x%08lx\n", (unsigned long) base);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Scenario ------------------------------------------------------------------*/
+
+static void runScriptEntry(void* context, uint32_t value)
+{
+    ScriptEntry* entry = context;
+
+    if (entry->kind_ == SCRIPT_UART)
+    {
+        simUartInject(entry->uart_, entry->data_, entry->length_);
+    }
+    else
+    {
+        simAdcSet(entry->adc_, entry->value_);
+    }
+
+    if (entry->periodNs_ != 0 && simNow() + entry->periodNs_ <= entry->endNs_)
+    {
+        simSchedule(simNow() + entry->periodNs_, runScriptEntry, entry, 0);
+    }
+}
+
+static uint16_t parseText(const char* text, uint8_t* out)
+{
+    uint16_t length = 0;
+
+    for (; *text && length < SIM_MAX_SCRIPT_TEXT; text++)
+    {
+        if (*text == '\\' && text[1] != 0)
+        {
+            text++;
+            out[length++] = *text == 'r' ? '\r' : *text == 'n' ? '\n' : *text;
+        }
+        else
+        {
+            out[length++] = *text;
+        }
+    }
+
+    return length;
+}
+
+static int parseScriptLine(ScriptEntry* entry, char* line)
+{
+    double startMs, periodMs, endMs;
+    char target[16];
+    int consumed;
+
+    if (sscanf(line, "%lf %lf %lf %15s %n", &startMs, &periodMs, &endMs, target, &consumed) != 4)
+    {
+        return -1;
+    }
+
+    char* value = line + consumed;
+    value[strcspn(value, "\r\n")] = 0;
+
+    entry->startNs_ = (uint64_t) (startMs * SIM_NS_PER_MS);
+    entry->periodNs_ = (uint64_t) (periodMs * SIM_NS_PER_MS);
+    entry->endNs_ = (uint64_t) (endMs * SIM_NS_PER_MS);
+
+    if (strncmp(target, "uart", 4) == 0 || strncmp(target, "usart", 5) == 0)
+    {
+        static USART_TypeDef* const UARTS[] = {USART1, USART2, USART3, UART4, UART5, USART6};
+        int number = atoi(target + strcspn(target, "0123456789"));
+
+        if (number < 1 || number > 6)
+        {
+            return -1;
+        }
+
+        entry->kind_ = SCRIPT_UART;
+        entry->uart_ = UARTS[number - 1];
+
+        if (value[0] == '"')
+        {
+            value[strcspn(value + 1, "\"") + 1] = 0;
+            entry->length_ = parseText(value + 1, entry->data_);
+        }
+        else
+        {
+            // Whitespace separated byte values
+            char* end;
+
+            for (entry->length_ = 0; entry->length_ < SIM_MAX_SCRIPT_TEXT; entry->length_++)
+            {
+                unsigned long byte = strtoul(value, &end, 0);
+
+                if (end == value)
+                {
+                    break;
+                }
+
+                entry->data_[entry->length_] = (uint8_t) byte;
+                value = end;
+            }
+        }
+
+        return entry->length_ != 0 ? 0 : -1;
+    }
+
+    if (strncmp(target, "adc", 3) == 0)
+    {
+        static ADC_TypeDef* const ADCS[] = {ADC1, ADC2, ADC3};
+        int number = atoi(target + 3);
+
+        if (number < 1 || number > 3)
+        {
+            return -1;
+        }
+
+        entry->kind_ = SCRIPT_ADC;
+        entry->adc_ = ADCS[number - 1];
+        entry->value_ = (uint16_t) strtoul(value, NULL, 0);
+        return 0;
+    }
+
+    return -1;
+}
+
+/**
+ * Scenario file, one injection per line:
+ *   <start ms> <period ms> <end ms> <target> <value>
+ * target is uartN (value: byte values or a "quoted string" with \r \n
+ * escapes) or adcN (value: raw 12 bit reading). # starts a comment.
+ */
+static int loadScript(const char* path)
+{
+    FILE* in = fopen(path, "r");
+    char line[512];
+    int lineNumber = 0;
+
+    if (in == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), in))
+    {
+        lineNumber++;
+        char* text = line + strspn(line, " \t");
+
+        if (*text == '#' || *text == '\n' || *text == '\r' || *text == 0)
+        {
+            continue;
+        }
+
+        if (scriptLength == SIM_MAX_SCRIPT_ENTRIES || parseScriptLine(&script[scriptLength], text) != 0)
+        {
+            fprintf(stderr, "%s:%d: invalid scenario line\n", path, lineNumber);
+            fclose(in);
+            return -1;
+        }
+
+        simSchedule(script[scriptLength].startNs_, runScriptEntry, &script[scriptLength], 0);
+        scriptLength++;
+    }
+
+    fclose(in);
+    return 0;
+}
+
+/* Tracing -------------------------------------------------------------------*/
+
+static void tracePhase(void* context, uint32_t lastPhase)
+{
+    FlightPhase phase = getCurrentFlightPhase();
+
+    if (phase != lastPhase)
+    {
+        printf("[%10.3f s] phase %s\n", simNow() / 1e9, PHASE_NAMES[phase]);
+        fflush(stdout);
+    }
+
+    simSchedule(simNow() + SIM_PHASE_SAMPLE_NS, tracePhase, NULL, phase);
+}
+
+/* Entry point ---------------------------------------------------------------*/
+
+static void printGpsStats(FILE* out)
+{
+    static const char* const CONFIG_STATES[] =
+    {
+        "sending CFG-PRT",
+        "switching baud rate",
+        "waiting for CFG-PRT",
+        "waiting for CFG-RATE",
+        "waiting for CFG-MSG",
+        "configured for NAV-PVT",
+        "not configured, NMEA"
+    };
+    GpsRxStats stats;
+    gpsRxStats(&stats);
+
+    fprintf(
+        out,
+        "GPS: %lu bytes received, %lu dropped, %lu receive errors, %lu sentences, %lu UBX frames, %lu checksum errors, %lu malformed\n"
+        "GPS receiver: %s at %lu baud, %u attempts, %u configurations\n",
+        (unsigned long) stats.bytes_,
+        (unsigned long) stats.droppedBytes_,
+        (unsigned long) stats.errors_,
+        (unsigned long) stats.sentences_,
+        (unsigned long) stats.frames_,
+        (unsigned long) stats.checksumErrors_,
+        (unsigned long) stats.formatErrors_,
+        CONFIG_STATES[stats.configState_],
+        (unsigned long) huart4.Init.BaudRate,
+        stats.configAttempts_,
+        stats.configurations_
+    );
+}
+
+void simShutdown(void)
+{
+    double host = wallSeconds();
+    double simulated = simNow() / 1e9;
+
+    printf("\nSimulated %.3f s in %.3f s of wall time (%.1fx real time)\n", simulated, host, host > 0 ? simulated / host : 0.0);
+    vPortPrintTaskStats(stdout, host);
+    simHalPrintStats(stdout, simulated);
+    simMs5607PrintStats(stdout);
+    printGpsStats(stdout);
+    simUbloxPrintStats(stdout);
+    simSdCardPrintStats(stdout);
+    fflush(NULL);
+    exit(0);
+}
+
+static void usage(const char* program)
+{
+    fprintf(
+        stderr,
+        "Usage: %s [--duration s] [--script file] [--trajectory file] [--sd image] [--uart1 file] [--gnss m8|nmea|none] [--trace] [--insert file]\n"
+        "       %s [--sd image] --extract dir\n"
+        "       %s [--sd new image] --log-index-bench count\n",
+        program,
+        program,
+        program
+    );
+}
+
+int main(int argc, char** argv)
+{
+    double duration = SIM_DEFAULT_DURATION_S;
+    const char* scriptPath = NULL;
+    const char* trajectoryPath = NULL;
+    const char* imagePath = "sd.img";
+    const char* extractDirectory = NULL;
+    const char* insertPath = NULL;
+    long logIndexBenchCount = 0;
+    const char* uart1Path = NULL;
+    const char* gnssModel = "m8";
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--trace") == 0)
+        {
+            simTrace = 1;
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "--duration") == 0)
+        {
+            duration = atof(argv[++i]);
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "--script") == 0)
+        {
+            scriptPath = argv[++i];
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "--trajectory") == 0)
+        {
+            trajectoryPath = argv[++i];
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "--sd") == 0)
+        {
+            imagePath = argv[++i];
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "--insert") == 0)
+        {
+            insertPath = argv[++i];
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "--extract") == 0)
+        {
+            extractDirectory = argv[++i];
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "--log-index-bench") == 0)
+        {
+            logIndexBenchCount = atol(argv[++i]);
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "--uart1") == 0)
+        {
+            uart1Path = argv[++i];
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "--gnss") == 0)
+        {
+            gnssModel = argv[++i];
+        }
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (mapRegion(PERIPH_BASE, SIM_PERIPH_SIZE) != 0 || mapRegion(SIM_CORE_PERIPH_BASE, SIM_CORE_PERIPH_SIZE) != 0)
+    {
+        return 1;
+    }
+
+    if (simSdCardOpen(imagePath, logIndexBenchCount > 0 ? SIM_LOG_INDEX_BENCH_SD_SIZE : SIM_DEFAULT_SD_SIZE) != 0)
+    {
+        return 1;
+    }
+
+    if (insertPath && simSdCardInsert(insertPath) != 0)
+    {
+        return 1;
+    }
+
+    if (extractDirectory)
+    {
+        return simSdCardExtract(extractDirectory) < 0 ? 1 : 0;
+    }
+
+    if (logIndexBenchCount > 0)
+    {
+        return simLogIndexBench((uint32_t) logIndexBenchCount) < 0 ? 1 : 0;
+    }
+
+    if (trajectoryPath && simTrajectoryLoad(trajectoryPath) != 0)
+    {
+        return 1;
+    }
+
+    simLsm9ds1Attach();
+    simMs5607Attach();
+
+    if (strcmp(gnssModel, "m8") == 0)
+    {
+        simUbloxAttach(SIM_UBLOX_M8);
+    }
+    else if (strcmp(gnssModel, "nmea") == 0)
+    {
+        simUbloxAttach(SIM_UBLOX_NMEA_ONLY);
+    }
+    else if (strcmp(gnssModel, "none") != 0)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (uart1Path)
+    {
+        FILE* out = fopen(uart1Path, "wb");
+
+        if (out == NULL)
+        {
+            perror(uart1Path);
+            return 1;
+        }
+
+        simUartSetOutput(USART1, out);
+    }
+
+    if (scriptPath && loadScript(scriptPath) != 0)
+    {
+        return 1;
+    }
+
+    if (simTrace)
+    {
+        simSchedule(SIM_PHASE_SAMPLE_NS, tracePhase, NULL, PRELAUNCH);
+    }
+
+    simSetDuration((uint64_t) (duration * 1e9));
+    clock_gettime(CLOCK_MONOTONIC, &wallStart);
+
+    return firmwareMain();
+}
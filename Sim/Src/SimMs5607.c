@@ -0,0 +1,268 @@
+/**
+  ******************************************************************************
+  * File Name          : SimMs5607.c
+  * Description        : MS5607-02BA03 barometric pressure sensor model for the
+  *                      host build. Conversions produce the D1/D2 values that
+  *                      the datasheet compensation turns back into the
+  *                      trajectory's pressure and temperature.
+  ******************************************************************************
+*/
+
+#include <math.h>
+
+#include "Sim.h"
+#include "SimDevices.h"
+#include "SimHal.h"
+#include "SimTrajectory.h"
+#include "main.h"
+
+#define CMD_RESET 0x1E
+#define CMD_CONVERT_D1 0x40
+#define CMD_CONVERT_D2 0x50
+#define CMD_ADC_READ 0x00
+#define CMD_PROM_READ 0xA0
+
+#define SIM_MS5607_RELOAD_NS (2800 * SIM_NS_PER_US)
+#define SIM_MS5607_ADC_MAX 0xFFFFFF
+
+typedef enum
+{
+    BARO_COMMAND,
+    BARO_ADC_READ,
+    BARO_PROM_READ,
+    BARO_IGNORE
+} BaroPhase;
+
+typedef struct
+{
+    uint16_t    prom_[8];
+    BaroPhase   phase_;
+    int         byte_;
+    uint8_t     promAddress_;
+    uint64_t    reloadDoneNs_;
+    uint64_t    conversionDoneNs_;
+    uint32_t    result_;
+    int         resultValid_;
+    uint32_t    latched_; // ADC result being shifted out
+    uint64_t    conversions_;
+    uint64_t    earlyReads_;
+} Ms5607;
+
+// Maximum conversion times for OSR 256 to 4096
+static const uint64_t CONVERSION_NS[5] =
+{
+    600 * SIM_NS_PER_US,
+    1170 * SIM_NS_PER_US,
+    2280 * SIM_NS_PER_US,
+    4540 * SIM_NS_PER_US,
+    9040 * SIM_NS_PER_US
+};
+
+// Typical calibration coefficients C1 to C6 from the datasheet example
+static const uint16_t COEFFICIENTS[6] = {46372, 43981, 29059, 27842, 31553, 28165};
+
+static Ms5607 baro;
+static SimSpiDevice baroDevice;
+
+/**
+ * CRC-4 over the PROM with the CRC nibble itself cleared (AN520).
+ */
+static uint8_t promCrc4(const uint16_t* prom)
+{
+    uint16_t remainder = 0;
+
+    for (int i = 0; i < 16; i++)
+    {
+        uint16_t word = i / 2 == 7 ? (prom[7] & 0xFF00) : prom[i / 2];
+        remainder ^= (i % 2 == 1) ? (word & 0x00FF) : (word >> 8);
+
+        for (int bit = 8; bit > 0; bit--)
+        {
+            remainder = (remainder & 0x8000) ? (uint16_t) ((remainder << 1) ^ 0x3000) : (uint16_t) (remainder << 1);
+        }
+    }
+
+    return (remainder >> 12) & 0x0F;
+}
+
+/**
+ * First-order dT to TEMP, less T2 below 20 °C, as the firmware computes it.
+ */
+static double compensatedTemperature(double dT)
+{
+    double temp = 2000.0 + dT * COEFFICIENTS[5] / 8388608.0;
+    return temp < 2000.0 ? temp - dT * dT / 2147483648.0 : temp;
+}
+
+/**
+ * dT that compensates to the temperature, found by fixed-point steps on the
+ * second order curve.
+ */
+static double temperatureToDt(double temperatureC)
+{
+    double target = temperatureC * 100.0;
+    double dT = (target - 2000.0) * 8388608.0 / COEFFICIENTS[5];
+
+    for (int i = 0; i < 4; i++)
+    {
+        dT -= (compensatedTemperature(dT) - target) * 8388608.0 / COEFFICIENTS[5];
+    }
+
+    return dT;
+}
+
+/**
+ * Raw D1 for the pressure at the given dT, inverting
+ * P = (D1 * SENS / 2^21 - OFF) / 2^15 with the second order corrections.
+ */
+static double pressureToD1(double pressurePa, double dT)
+{
+    double temp = 2000.0 + dT * COEFFICIENTS[5] / 8388608.0;
+    double off = COEFFICIENTS[1] * 131072.0 + COEFFICIENTS[3] * dT / 64.0;
+    double sens = COEFFICIENTS[0] * 65536.0 + COEFFICIENTS[2] * dT / 128.0;
+
+    if (temp < 2000.0)
+    {
+        double cold = (temp - 2000.0) * (temp - 2000.0);
+        off -= 61.0 * cold / 16.0;
+        sens -= 2.0 * cold;
+
+        if (temp < -1500.0)
+        {
+            double veryCold = (temp + 1500.0) * (temp + 1500.0);
+            off -= 15.0 * veryCold;
+            sens -= 8.0 * veryCold;
+        }
+    }
+
+    // P is in 0.01 mbar, i.e. Pa
+    return (pressurePa * 32768.0 + off) * 2097152.0 / sens;
+}
+
+static uint32_t toAdc(double value)
+{
+    value = round(value);
+    return value < 0 ? 0 : value > SIM_MS5607_ADC_MAX ? SIM_MS5607_ADC_MAX : (uint32_t) value;
+}
+
+static void startConversion(uint8_t command)
+{
+    SimVehicleState state;
+    double dT;
+
+    simTrajectorySample(simNow(), &state);
+    dT = temperatureToDt(state.temperatureC_);
+
+    if ((command & 0xF0) == CMD_CONVERT_D1)
+    {
+        baro.result_ = toAdc(pressureToD1(state.pressurePa_, dT));
+    }
+    else
+    {
+        baro.result_ = toAdc(dT + COEFFICIENTS[4] * 256.0);
+    }
+
+    baro.conversionDoneNs_ = simNow() + CONVERSION_NS[((command & 0x0F) >> 1) % 5];
+    baro.resultValid_ = 1;
+    baro.conversions_++;
+}
+
+static void command(uint8_t byte)
+{
+    if (byte == CMD_RESET)
+    {
+        baro.reloadDoneNs_ = simNow() + SIM_MS5607_RELOAD_NS;
+        baro.resultValid_ = 0;
+        baro.phase_ = BARO_IGNORE;
+    }
+    else if ((byte & 0xE0) == CMD_CONVERT_D1 && (byte & 0x0F) <= 0x08)
+    {
+        startConversion(byte);
+        baro.phase_ = BARO_IGNORE;
+    }
+    else if (byte == CMD_ADC_READ)
+    {
+        // Reading before the conversion ends, or a second time, returns 0
+        int ready = baro.resultValid_ && simNow() >= baro.conversionDoneNs_;
+
+        if (baro.resultValid_ && !ready)
+        {
+            baro.earlyReads_++;
+        }
+
+        baro.latched_ = ready ? baro.result_ : 0;
+        baro.resultValid_ = 0;
+        baro.phase_ = BARO_ADC_READ;
+        baro.byte_ = 0;
+    }
+    else if ((byte & 0xF0) == CMD_PROM_READ)
+    {
+        baro.promAddress_ = (byte >> 1) & 0x07;
+        baro.phase_ = BARO_PROM_READ;
+        baro.byte_ = 0;
+    }
+}
+
+static void selectBaro(SimSpiDevice* device, int selected)
+{
+    baro.phase_ = BARO_COMMAND;
+}
+
+static uint8_t exchangeBaro(SimSpiDevice* device, uint8_t mosi)
+{
+    uint8_t miso = SIM_SPI_IDLE_BYTE;
+
+    switch (baro.phase_)
+    {
+        case BARO_COMMAND:
+            command(mosi);
+            break;
+
+        case BARO_ADC_READ:
+            miso = baro.byte_ < 3 ? (uint8_t) (baro.latched_ >> (16 - 8 * baro.byte_++)) : 0;
+            break;
+
+        case BARO_PROM_READ:
+        {
+            // The PROM reads as 0 until the reload after reset completes
+            uint16_t word = simNow() >= baro.reloadDoneNs_ ? baro.prom_[baro.promAddress_] : 0;
+            miso = baro.byte_ < 2 ? (uint8_t) (word >> (8 - 8 * baro.byte_++)) : 0;
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    return miso;
+}
+
+void simMs5607Attach(void)
+{
+    baro.prom_[0] = 0x0A70; // Factory data
+    baro.prom_[7] = 0;
+
+    for (int i = 0; i < 6; i++)
+    {
+        baro.prom_[i + 1] = COEFFICIENTS[i];
+    }
+
+    baro.prom_[7] |= promCrc4(baro.prom_);
+
+    baroDevice = (SimSpiDevice)
+    {
+        .name_ = "MS5607",
+        .bus_ = SPI2,
+        .csPort_ = BARO_CS_GPIO_Port,
+        .csPin_ = BARO_CS_Pin,
+        .select_ = selectBaro,
+        .exchange_ = exchangeBaro,
+    };
+
+    simSpiAttach(&baroDevice);
+}
+
+void simMs5607PrintStats(FILE* out)
+{
+    fprintf(out, "MS5607: %llu conversions, %llu ADC reads before the conversion ended\n", (unsigned long long) baro.conversions_, (unsigned long long) baro.earlyReads_);
+}
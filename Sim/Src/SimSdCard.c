@@ -0,0 +1,611 @@
+/**
+  ******************************************************************************
+  * File Name          : SimSdCard.c
+  * Description        : SDHC card in SPI mode for the host build, backed by a
+  *                      disk image. The unmodified fatfs_sd.c driver talks to
+  *                      it byte by byte over SPI3.
+  ******************************************************************************
+*/
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ff.h"
+
+#include "Sim.h"
+#include "SimDevices.h"
+#include "SimHal.h"
+#include "main.h"
+
+#define SIM_SD_SECTOR_SIZE 512
+#define SIM_SD_OUTPUT_SIZE (SIM_SD_SECTOR_SIZE + 16)
+#define SIM_SD_INIT_NS (20 * SIM_NS_PER_MS) // ACMD41 returns idle until the card has powered up
+#define SIM_SD_READ_ACCESS_NS (100 * SIM_NS_PER_US)
+#define SIM_SD_WRITE_BUSY_NS (250 * SIM_NS_PER_US)
+#define SIM_SD_ERASE_BUSY_NS (2 * SIM_NS_PER_MS)
+#define SIM_SD_STOP_BUSY_NS (10 * SIM_NS_PER_US)
+#define SIM_SD_AU_SIZE 9 // 4 MB allocation unit, reported by ACMD13
+
+#define SD_CS_GPIO_Port GPIOA // FATFS_CS_PORT and FATFS_CS_PIN in tm_fatfs/Inc/defines.h
+#define SD_CS_Pin GPIO_PIN_15
+
+// R1 response bits
+#define R1_READY 0x00
+#define R1_IDLE 0x01
+#define R1_ILLEGAL_COMMAND 0x04
+#define R1_ADDRESS_ERROR 0x20
+
+#define TOKEN_START_BLOCK 0xFE
+#define TOKEN_START_MULTIPLE 0xFC
+#define TOKEN_STOP_TRANSMISSION 0xFD
+#define DATA_ACCEPTED 0x05
+
+typedef enum
+{
+    WRITE_NONE,
+    WRITE_SINGLE,
+    WRITE_MULTIPLE
+} WriteMode;
+
+typedef struct
+{
+    int         fd_;
+    uint32_t    sectors_;
+    int         idle_;
+    uint64_t    initDoneNs_;
+    int         appCommand_;
+    uint8_t     command_[6];
+    int         commandLength_;
+    uint8_t     output_[SIM_SD_OUTPUT_SIZE]; // Bytes the card drives on MISO next
+    int         outputHead_;
+    int         outputCount_;
+    uint64_t    busyUntilNs_; // DO held low while programming
+    int         reading_; // 0, or 17/18 while a read command is streaming blocks
+    uint32_t    readSector_;
+    uint64_t    dataReadyNs_;
+    WriteMode   writeMode_;
+    int         receiving_; // Bytes of the current write block received, -1 waiting for a token
+    uint32_t    writeSector_;
+    uint8_t     block_[SIM_SD_SECTOR_SIZE + 2];
+    uint64_t    commands_[64];
+    uint64_t    sectorsRead_;
+    uint64_t    sectorsWritten_;
+} SdCard;
+
+static SdCard card = {-1};
+static SimSpiDevice cardDevice;
+
+static void queue(const uint8_t* data, int length)
+{
+    if (card.outputCount_ == 0)
+    {
+        card.outputHead_ = 0;
+    }
+
+    if (card.outputHead_ + card.outputCount_ + length > SIM_SD_OUTPUT_SIZE)
+    {
+        fprintf(stderr, "sim: SD card output overrun\n");
+        return;
+    }
+
+    memcpy(&card.output_[card.outputHead_ + card.outputCount_], data, length);
+    card.outputCount_ += length;
+}
+
+static void queueByte(uint8_t byte)
+{
+    queue(&byte, 1);
+}
+
+/**
+ * Start token, payload and a CRC the driver does not check.
+ */
+static void queueDataBlock(const uint8_t* data, int length)
+{
+    static const uint8_t crc[2] = {0xFF, 0xFF};
+
+    queueByte(TOKEN_START_BLOCK);
+    queue(data, length);
+    queue(crc, sizeof(crc));
+}
+
+/**
+ * CSD version 2.0 (SDHC) for the image size: C_SIZE is the capacity in
+ * 512 KB units less one.
+ */
+static void queueCsd(void)
+{
+    uint32_t cSize = card.sectors_ / 1024 - 1;
+    uint8_t csd[16] =
+    {
+        0x40, 0x0E, 0x00, 0x32, 0x5B, 0x59, 0x00,
+        (uint8_t) ((cSize >> 16) & 0x3F), (uint8_t) (cSize >> 8), (uint8_t) cSize,
+        0x7F, 0x80, 0x0A, 0x40, 0x00, 0x01
+    };
+
+    queueDataBlock(csd, sizeof(csd));
+}
+
+static void queueCid(void)
+{
+    static const uint8_t cid[16] = {0x03, 'S', 'D', 'S', 'I', 'M', '0', '1', 0x10, 0, 0, 0, 1, 0x01, 0x4A, 0x01};
+    queueDataBlock(cid, sizeof(cid));
+}
+
+static void queueSdStatus(void)
+{
+    uint8_t status[64] = {0};
+
+    status[8] = 0x04; // Speed class 10
+    status[10] = SIM_SD_AU_SIZE << 4;
+    queueDataBlock(status, sizeof(status));
+}
+
+static uint8_t r1(void)
+{
+    return card.idle_ ? R1_IDLE : R1_READY;
+}
+
+/**
+ * Queues the response to a complete command frame, after one byte of NCR.
+ */
+static void execute(uint8_t index, uint32_t argument)
+{
+    int app = card.appCommand_;
+    uint8_t response = r1();
+
+    card.appCommand_ = 0;
+    card.commands_[index]++;
+    queueByte(0xFF);
+
+    switch (index)
+    {
+        case 0: // GO_IDLE_STATE
+            card.idle_ = 1;
+            card.initDoneNs_ = 0;
+            card.reading_ = 0;
+            card.writeMode_ = WRITE_NONE;
+            queueByte(R1_IDLE);
+            return;
+
+        case 8: // SEND_IF_COND, echo the voltage range and check pattern
+        {
+            uint8_t r7[5] = {response, 0x00, 0x00, (uint8_t) ((argument >> 8) & 0x0F), (uint8_t) argument};
+            queue(r7, sizeof(r7));
+            return;
+        }
+
+        case 41:
+            if (!app)
+            {
+                break;
+            }
+
+            // SD_SEND_OP_COND, initialization runs from the first one
+            if (card.initDoneNs_ == 0)
+            {
+                card.initDoneNs_ = simNow() + SIM_SD_INIT_NS;
+            }
+
+            card.idle_ = simNow() < card.initDoneNs_;
+            queueByte(r1());
+            return;
+
+        case 55: // APP_CMD
+            card.appCommand_ = 1;
+            queueByte(response);
+            return;
+
+        case 58: // READ_OCR: powered up, CCS set for block addressing
+        {
+            uint8_t r3[5] = {response, 0xC0, 0xFF, 0x80, 0x00};
+            queue(r3, sizeof(r3));
+            return;
+        }
+
+        case 9: // SEND_CSD
+            queueByte(response);
+            queueCsd();
+            return;
+
+        case 10: // SEND_CID
+            queueByte(response);
+            queueCid();
+            return;
+
+        case 13: // SEND_STATUS (R2), or SD_STATUS (R2 and a 64 byte block)
+            queueByte(response);
+            queueByte(0x00);
+
+            if (app)
+            {
+                queueSdStatus();
+            }
+
+            return;
+
+        case 12: // STOP_TRANSMISSION, after a stuff byte
+            card.reading_ = 0;
+            card.outputCount_ = 0;
+            queueByte(0xFF);
+            queueByte(0xFF);
+            queueByte(response);
+            card.busyUntilNs_ = simNow() + SIM_SD_STOP_BUSY_NS;
+            return;
+
+        case 16: // SET_BLOCKLEN
+        case 23: // SET_WR_BLK_ERASE_COUNT when app
+        case 32: // ERASE_WR_BLK_START
+        case 33: // ERASE_WR_BLK_END
+            queueByte(response);
+            return;
+
+        case 38: // ERASE
+            queueByte(response);
+            card.busyUntilNs_ = simNow() + SIM_SD_ERASE_BUSY_NS;
+            return;
+
+        case 17: // READ_SINGLE_BLOCK
+        case 18: // READ_MULTIPLE_BLOCK
+            if (argument >= card.sectors_)
+            {
+                queueByte(response | R1_ADDRESS_ERROR);
+                return;
+            }
+
+            queueByte(response);
+            card.reading_ = index;
+            card.readSector_ = argument;
+            card.dataReadyNs_ = simNow() + SIM_SD_READ_ACCESS_NS;
+            return;
+
+        case 24: // WRITE_BLOCK
+        case 25: // WRITE_MULTIPLE_BLOCK
+            if (argument >= card.sectors_)
+            {
+                queueByte(response | R1_ADDRESS_ERROR);
+                return;
+            }
+
+            queueByte(response);
+            card.writeMode_ = index == 24 ? WRITE_SINGLE : WRITE_MULTIPLE;
+            card.writeSector_ = argument;
+            card.receiving_ = -1;
+            return;
+
+        default:
+            break;
+    }
+
+    queueByte(response | R1_ILLEGAL_COMMAND);
+}
+
+/**
+ * Data phase of CMD24/CMD25: a start token, the block and its CRC, then
+ * the data response and busy while the block is programmed.
+ */
+static void receiveWriteData(uint8_t mosi)
+{
+    if (card.receiving_ < 0)
+    {
+        if (mosi == TOKEN_STOP_TRANSMISSION && card.writeMode_ == WRITE_MULTIPLE)
+        {
+            card.writeMode_ = WRITE_NONE;
+            card.busyUntilNs_ = simNow() + SIM_SD_STOP_BUSY_NS;
+        }
+        else if (mosi == (card.writeMode_ == WRITE_SINGLE ? TOKEN_START_BLOCK : TOKEN_START_MULTIPLE))
+        {
+            card.receiving_ = 0;
+        }
+
+        return;
+    }
+
+    card.block_[card.receiving_++] = mosi;
+
+    if (card.receiving_ < (int) sizeof(card.block_))
+    {
+        return;
+    }
+
+    if (pwrite(card.fd_, card.block_, SIM_SD_SECTOR_SIZE, (off_t) card.writeSector_ * SIM_SD_SECTOR_SIZE) < 0)
+    {
+        perror("sim: SD card image");
+    }
+
+    card.sectorsWritten_++;
+    card.writeSector_++;
+    card.receiving_ = -1;
+    queueByte(DATA_ACCEPTED);
+    card.busyUntilNs_ = simNow() + SIM_SD_WRITE_BUSY_NS;
+
+    if (card.writeMode_ == WRITE_SINGLE || card.writeSector_ >= card.sectors_)
+    {
+        card.writeMode_ = WRITE_NONE;
+    }
+}
+
+/**
+ * Starts the next block of a read once the access time has passed. Until
+ * then the card keeps DO high and the driver polls for the start token.
+ */
+static void streamReadData(void)
+{
+    uint8_t sector[SIM_SD_SECTOR_SIZE];
+
+    if (card.reading_ == 0 || card.outputCount_ != 0 || simNow() < card.dataReadyNs_)
+    {
+        return;
+    }
+
+    if (pread(card.fd_, sector, sizeof(sector), (off_t) card.readSector_ * SIM_SD_SECTOR_SIZE) < 0)
+    {
+        perror("sim: SD card image");
+    }
+
+    queueDataBlock(sector, sizeof(sector));
+    card.sectorsRead_++;
+    card.readSector_++;
+    card.dataReadyNs_ = simNow() + SIM_SD_READ_ACCESS_NS;
+
+    if (card.reading_ == 17 || card.readSector_ >= card.sectors_)
+    {
+        card.reading_ = 0;
+    }
+}
+
+static void selectCard(SimSpiDevice* device, int selected)
+{
+    // Responses not clocked out before deselection are lost
+    card.commandLength_ = 0;
+    card.outputCount_ = 0;
+}
+
+static uint8_t exchangeCard(SimSpiDevice* device, uint8_t mosi)
+{
+    uint8_t miso = SIM_SPI_IDLE_BYTE;
+
+    streamReadData();
+
+    if (card.outputCount_ != 0)
+    {
+        miso = card.output_[card.outputHead_++];
+        card.outputCount_--;
+    }
+    else if (simNow() < card.busyUntilNs_)
+    {
+        miso = 0x00;
+    }
+
+    if (card.writeMode_ != WRITE_NONE && card.commandLength_ == 0)
+    {
+        receiveWriteData(mosi);
+        return miso;
+    }
+
+    // Command frames start with 01b, the bus idles at 0xFF between them
+    if (card.commandLength_ != 0 || (mosi & 0xC0) == 0x40)
+    {
+        card.command_[card.commandLength_++] = mosi;
+
+        if (card.commandLength_ == sizeof(card.command_))
+        {
+            uint32_t argument = (uint32_t) card.command_[1] << 24 | (uint32_t) card.command_[2] << 16 | (uint32_t) card.command_[3] << 8 | card.command_[4];
+
+            card.commandLength_ = 0;
+
+            if (card.reading_ == 0 || (card.command_[0] & 0x3F) == 12)
+            {
+                execute(card.command_[0] & 0x3F, argument);
+            }
+        }
+    }
+
+    return miso;
+}
+
+/**
+ * Formatting happens before the flight starts, so its simulated time and
+ * bus traffic are discarded.
+ */
+static void discardSetupTime(void)
+{
+    simResetTime();
+    simHalResetStats();
+    card.busyUntilNs_ = 0;
+    card.dataReadyNs_ = 0;
+    memset(card.commands_, 0, sizeof(card.commands_));
+    card.sectorsRead_ = 0;
+    card.sectorsWritten_ = 0;
+}
+
+int simSdCardOpen(const char* path, uint64_t sizeBytes)
+{
+    struct stat info;
+    int created = 0;
+
+    card.fd_ = open(path, O_RDWR | O_CREAT, 0644);
+
+    if (card.fd_ < 0 || fstat(card.fd_, &info) != 0)
+    {
+        perror(path);
+        return -1;
+    }
+
+    if (info.st_size == 0)
+    {
+        if (ftruncate(card.fd_, (off_t) sizeBytes) != 0)
+        {
+            perror(path);
+            return -1;
+        }
+
+        info.st_size = (off_t) sizeBytes;
+        created = 1;
+    }
+
+    card.sectors_ = (uint32_t) (info.st_size / SIM_SD_SECTOR_SIZE);
+    cardDevice = (SimSpiDevice)
+    {
+        .name_ = "SD card",
+        .bus_ = SPI3,
+        .csPort_ = SD_CS_GPIO_Port,
+        .csPin_ = SD_CS_Pin,
+        .select_ = selectCard,
+        .exchange_ = exchangeCard,
+    };
+    simSpiAttach(&cardDevice);
+
+    if (created)
+    {
+        static BYTE work[_MAX_SS * 4];
+        FRESULT result = f_mkfs("SD:", FM_ANY, 0, work, sizeof(work));
+
+        discardSetupTime();
+
+        if (result != FR_OK)
+        {
+            fprintf(stderr, "%s: f_mkfs failed (%d)\n", path, result);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Copies every file in the root directory of the image to a host directory.
+ */
+int simSdCardExtract(const char* directory)
+{
+    static FATFS fatfs;
+    static BYTE buffer[4096];
+    DIR dir;
+    FILINFO info;
+    int extracted = 0;
+
+    if (f_mount(&fatfs, "SD:", 1) != FR_OK || f_opendir(&dir, "SD:/") != FR_OK)
+    {
+        fprintf(stderr, "sim: cannot mount the SD card image\n");
+        return -1;
+    }
+
+    while (f_readdir(&dir, &info) == FR_OK && info.fname[0] != 0)
+    {
+        if (info.fattrib & AM_DIR)
+        {
+            continue;
+        }
+
+        char source[_MAX_LFN + 8];
+        char target[4096];
+        FIL file;
+        UINT length;
+
+        snprintf(source, sizeof(source), "SD:/%s", info.fname);
+        snprintf(target, sizeof(target), "%s/%s", directory, info.fname);
+
+        FILE* out = fopen(target, "wb");
+
+        if (out == NULL || f_open(&file, source, FA_READ) != FR_OK)
+        {
+            perror(target);
+
+            if (out)
+            {
+                fclose(out);
+            }
+
+            continue;
+        }
+
+        while (f_read(&file, buffer, sizeof(buffer), &length) == FR_OK && length != 0)
+        {
+            fwrite(buffer, 1, length, out);
+        }
+
+        f_close(&file);
+        fclose(out);
+        printf("%s (%llu bytes)\n", target, (unsigned long long) info.fsize);
+        extracted++;
+    }
+
+    f_closedir(&dir);
+    f_mount(NULL, "SD:", 1);
+    return extracted;
+}
+
+/**
+ * Copies a host file into the root directory of the image, under its own
+ * name, before the firmware runs. The opposite of simSdCardExtract, for
+ * starting a flight from a card left in a given state.
+ */
+int simSdCardInsert(const char* path)
+{
+    static FATFS fatfs;
+    static BYTE buffer[4096];
+    const char* name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+    char target[_MAX_LFN + 8];
+    FIL file;
+    UINT written;
+    size_t length;
+    int result = 0;
+
+    FILE* in = fopen(path, "rb");
+
+    if (in == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+
+    snprintf(target, sizeof(target), "SD:/%s", name);
+
+    if (f_mount(&fatfs, "SD:", 1) != FR_OK || f_open(&file, target, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+    {
+        fprintf(stderr, "sim: cannot create %s on the SD card image\n", name);
+        fclose(in);
+        return -1;
+    }
+
+    while ((length = fread(buffer, 1, sizeof(buffer), in)) != 0)
+    {
+        if (f_write(&file, buffer, length, &written) != FR_OK || written != length)
+        {
+            fprintf(stderr, "sim: SD card image full writing %s\n", name);
+            result = -1;
+            break;
+        }
+    }
+
+    f_close(&file);
+    f_mount(NULL, "SD:", 1);
+    fclose(in);
+    discardSetupTime();
+    return result;
+}
+
+uint64_t simSdCardSectorsRead(void)
+{
+    return card.sectorsRead_;
+}
+
+void simSdCardPrintStats(FILE* out)
+{
+    fprintf(
+        out,
+        "SD card: %llu sectors read, %llu sectors written; CMD17 %llu, CMD18 %llu, CMD24 %llu, CMD25 %llu, CMD12 %llu, CMD0 %llu\n",
+        (unsigned long long) card.sectorsRead_,
+        (unsigned long long) card.sectorsWritten_,
+        (unsigned long long) card.commands_[17],
+        (unsigned long long) card.commands_[18],
+        (unsigned long long) card.commands_[24],
+        (unsigned long long) card.commands_[25],
+        (unsigned long long) card.commands_[12],
+        (unsigned long long) card.commands_[0]
+    );
+}
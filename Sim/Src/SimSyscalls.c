@@ -0,0 +1,33 @@
+/**
+  ******************************************************************************
+  * File Name          : SimSyscalls.c
+  * Description        : Host stand-ins for the heap accounting in syscalls.c.
+  ******************************************************************************
+*/
+
+#include <stdint.h>
+#include <unistd.h>
+
+#include "MemoryStats.h"
+
+static char* initialBreak;
+
+// The host break starts at a random offset from the end of .bss, measure from where it was at startup
+__attribute__((constructor)) static void recordInitialBreak(void)
+{
+    initialBreak = sbrk(0);
+}
+
+/**
+ * The host malloc also maps large blocks and keeps per-thread arenas, so
+ * this is only a rough figure.
+ */
+uint32_t sbrkHeapSize(void)
+{
+    return (uint32_t) ((char*) sbrk(0) - initialBreak);
+}
+
+uint32_t sbrkFailureCount(void)
+{
+    return 0;
+}
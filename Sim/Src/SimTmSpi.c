@@ -0,0 +1,66 @@
+/**
+  ******************************************************************************
+  * File Name          : SimTmSpi.c
+  * Description        : tm_stm32_spi and tm_stm32_delay entry points used by
+  *                      fatfs_sd.c, on top of the simulated SPI buses.
+  ******************************************************************************
+*/
+
+#include "SimTmSpi.h"
+#include "tm_stm32_delay.h"
+
+/**
+ * Programs the bus the way TM_SPIx_Init does: master, 8 bit, MSB first,
+ * software NSS, at the library's default prescaler and mode. Only SPI3
+ * is used by the SD card driver.
+ */
+void TM_SPI_Init(SPI_TypeDef* SPIx, TM_SPI_PinsPack_t pinspack)
+{
+    SPI_HandleTypeDef handle = {0};
+
+    handle.Instance = SPIx;
+    handle.Init.Mode = SPI_MODE_MASTER;
+    handle.Init.Direction = SPI_DIRECTION_2LINES;
+    handle.Init.DataSize = SPI_DATASIZE_8BIT;
+    handle.Init.NSS = SPI_NSS_SOFT;
+    handle.Init.BaudRatePrescaler = TM_SPI3_PRESCALER;
+    handle.Init.FirstBit = SPI_FIRSTBIT_MSB;
+    handle.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
+    handle.Init.CLKPolarity = TM_SPI3_MODE >= TM_SPI_Mode_2 ? SPI_POLARITY_HIGH : SPI_POLARITY_LOW;
+    handle.Init.CLKPhase = (TM_SPI3_MODE & 1) ? SPI_PHASE_2EDGE : SPI_PHASE_1EDGE;
+
+    HAL_SPI_Init(&handle);
+}
+
+void TM_SPI_SendMulti(SPI_TypeDef* SPIx, uint8_t* dataOut, uint8_t* dataIn, uint32_t count)
+{
+    while (count--)
+    {
+        *dataIn++ = simSpiExchange(SPIx, *dataOut++);
+    }
+}
+
+void TM_SPI_WriteMulti(SPI_TypeDef* SPIx, uint8_t* dataOut, uint32_t count)
+{
+    while (count--)
+    {
+        simSpiExchange(SPIx, *dataOut++);
+    }
+}
+
+void TM_SPI_ReadMulti(SPI_TypeDef* SPIx, uint8_t* dataIn, uint8_t dummy, uint32_t count)
+{
+    while (count--)
+    {
+        *dataIn++ = simSpiExchange(SPIx, dummy);
+    }
+}
+
+/**
+ * The DWT cycle counter is not used by the SD card driver, HAL_IncTick in
+ * SimHal.c keeps TM_Time and TM_Time2 running.
+ */
+uint32_t TM_DELAY_Init(void)
+{
+    return 1;
+}
@@ -0,0 +1,244 @@
+/**
+  ******************************************************************************
+  * File Name          : SimTrajectory.c
+  * Description        : Vehicle state over time for the sensor models, from a
+  *                      scripted profile or a recorded flight log.
+  ******************************************************************************
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Sim.h"
+#include "SimTrajectory.h"
+
+#define SIM_PAD_ALTITUDE_M 1401.0 // Spaceport America
+#define SIM_PAD_TEMPERATURE_C 25.0
+#define SIM_MAX_COLUMNS 64
+
+typedef enum
+{
+    CHANNEL_TIME,
+    CHANNEL_ALTITUDE,
+    CHANNEL_PRESSURE,
+    CHANNEL_TEMPERATURE,
+    CHANNEL_ACCEL_X,
+    CHANNEL_ACCEL_Y,
+    CHANNEL_ACCEL_Z,
+    CHANNEL_GYRO_X,
+    CHANNEL_GYRO_Y,
+    CHANNEL_GYRO_Z,
+    CHANNEL_MAG_X,
+    CHANNEL_MAG_Y,
+    CHANNEL_MAG_Z,
+    CHANNEL_COUNT,
+    CHANNEL_NONE = CHANNEL_COUNT
+} Channel;
+
+typedef struct
+{
+    const char* name_;
+    Channel     channel_;
+    double      scale_; // Column value times scale is the channel value
+} ColumnName;
+
+static const ColumnName COLUMN_NAMES[] =
+{
+    {"time_s", CHANNEL_TIME, 1.0},
+    {"elapsedTime(ms)", CHANNEL_TIME, 1e-3},
+    {"altitude_m", CHANNEL_ALTITUDE, 1.0},
+    {"pressure_pa", CHANNEL_PRESSURE, 1.0},
+    {"pressure", CHANNEL_PRESSURE, 1.0},
+    {"temperature_c", CHANNEL_TEMPERATURE, 1.0},
+    {"temperature(100C)", CHANNEL_TEMPERATURE, 1e-2},
+    {"accel_x_g", CHANNEL_ACCEL_X, 1.0},
+    {"accel_y_g", CHANNEL_ACCEL_Y, 1.0},
+    {"accel_z_g", CHANNEL_ACCEL_Z, 1.0},
+    {"accelX", CHANNEL_ACCEL_X, 1e-3},
+    {"accelY", CHANNEL_ACCEL_Y, 1e-3},
+    {"accelZ", CHANNEL_ACCEL_Z, 1e-3},
+    {"gyro_x_dps", CHANNEL_GYRO_X, 1.0},
+    {"gyro_y_dps", CHANNEL_GYRO_Y, 1.0},
+    {"gyro_z_dps", CHANNEL_GYRO_Z, 1.0},
+    {"gyroX", CHANNEL_GYRO_X, 1e-3},
+    {"gyroY", CHANNEL_GYRO_Y, 1e-3},
+    {"gyroZ", CHANNEL_GYRO_Z, 1e-3},
+    {"mag_x_gauss", CHANNEL_MAG_X, 1.0},
+    {"mag_y_gauss", CHANNEL_MAG_Y, 1.0},
+    {"mag_z_gauss", CHANNEL_MAG_Z, 1.0},
+    {"magnetoX", CHANNEL_MAG_X, 1e-3},
+    {"magnetoY", CHANNEL_MAG_Y, 1e-3},
+    {"magnetoZ", CHANNEL_MAG_Z, 1e-3},
+};
+
+// At rest on the pad, Z axis up, in the local geomagnetic field
+static const double PAD_STATE[CHANNEL_COUNT] =
+{
+    0.0, SIM_PAD_ALTITUDE_M, 0.0, SIM_PAD_TEMPERATURE_C,
+    0.0, 0.0, 1.0,
+    0.0, 0.0, 0.0,
+    0.23, 0.0, -0.43
+};
+
+static double (*rows)[CHANNEL_COUNT] = NULL;
+static size_t rowCount = 0;
+static int present[CHANNEL_COUNT];
+
+/**
+ * International standard atmosphere below 11 km.
+ */
+static double pressureAtAltitude(double altitudeM)
+{
+    return 101325.0 * pow(1.0 - 2.25577e-5 * altitudeM, 5.25588);
+}
+
+/**
+ * Maps each CSV column to a channel and scale. Fails without a time column.
+ */
+static int parseHeader(char* header, Channel* columns, double* scales)
+{
+    int count = 0;
+
+    for (char* name = strtok(header, ",\r\n"); name && count < SIM_MAX_COLUMNS; name = strtok(NULL, ",\r\n"))
+    {
+        columns[count] = CHANNEL_NONE;
+
+        for (size_t i = 0; i < sizeof(COLUMN_NAMES) / sizeof(COLUMN_NAMES[0]); i++)
+        {
+            if (strcmp(name + strspn(name, " "), COLUMN_NAMES[i].name_) == 0)
+            {
+                columns[count] = COLUMN_NAMES[i].channel_;
+                scales[count] = COLUMN_NAMES[i].scale_;
+                present[columns[count]] = 1;
+                break;
+            }
+        }
+
+        count++;
+    }
+
+    for (; count < SIM_MAX_COLUMNS; count++)
+    {
+        columns[count] = CHANNEL_NONE;
+    }
+
+    return present[CHANNEL_TIME] ? 0 : -1;
+}
+
+int simTrajectoryLoad(const char* path)
+{
+    FILE* in = fopen(path, "r");
+    static char line[4096];
+    Channel columns[SIM_MAX_COLUMNS];
+    double scales[SIM_MAX_COLUMNS];
+    size_t capacity = 0;
+
+    if (in == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+
+    if (fgets(line, sizeof(line), in) == NULL || parseHeader(line, columns, scales) != 0)
+    {
+        fprintf(stderr, "%s: no time column in the header\n", path);
+        fclose(in);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), in))
+    {
+        if (rowCount == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 1024;
+            rows = realloc(rows, capacity * sizeof(rows[0]));
+        }
+
+        double* row = rows[rowCount];
+        char* field = line;
+
+        memcpy(row, PAD_STATE, sizeof(PAD_STATE));
+
+        for (int column = 0; column < SIM_MAX_COLUMNS && field; column++)
+        {
+            if (columns[column] != CHANNEL_NONE)
+            {
+                row[columns[column]] = strtod(field, NULL) * scales[column];
+            }
+
+            field = strchr(field, ',');
+            field = field ? field + 1 : NULL;
+        }
+
+        // Logs restart their clock on every boot, keep the first monotonic run
+        if (rowCount != 0 && row[CHANNEL_TIME] < rows[rowCount - 1][CHANNEL_TIME])
+        {
+            break;
+        }
+
+        rowCount++;
+    }
+
+    fclose(in);
+
+    if (rowCount == 0)
+    {
+        fprintf(stderr, "%s: no samples\n", path);
+        return -1;
+    }
+
+    printf("Trajectory %s: %zu samples over %.1f s\n", path, rowCount, rows[rowCount - 1][CHANNEL_TIME] - rows[0][CHANNEL_TIME]);
+    return 0;
+}
+
+void simTrajectorySample(uint64_t timeNs, SimVehicleState* state)
+{
+    double values[CHANNEL_COUNT];
+    double seconds = timeNs / 1e9;
+
+    memcpy(values, PAD_STATE, sizeof(values));
+
+    if (rowCount != 0)
+    {
+        // Rows are in time order; binary search for the interval holding the time
+        size_t low = 0;
+        size_t high = rowCount - 1;
+
+        while (low + 1 < high)
+        {
+            size_t middle = (low + high) / 2;
+
+            if (rows[middle][CHANNEL_TIME] <= seconds)
+            {
+                low = middle;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+
+        double span = rows[high][CHANNEL_TIME] - rows[low][CHANNEL_TIME];
+        double weight = span > 0 ? (seconds - rows[low][CHANNEL_TIME]) / span : 0.0;
+
+        weight = weight < 0 ? 0 : weight > 1 ? 1 : weight;
+
+        for (int i = 0; i < CHANNEL_COUNT; i++)
+        {
+            values[i] = rows[low][i] + (rows[high][i] - rows[low][i]) * weight;
+        }
+    }
+
+    state->altitudeM_ = values[CHANNEL_ALTITUDE];
+    state->pressurePa_ = present[CHANNEL_PRESSURE] ? values[CHANNEL_PRESSURE] : pressureAtAltitude(values[CHANNEL_ALTITUDE]);
+    state->temperatureC_ = values[CHANNEL_TEMPERATURE];
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        state->accelG_[axis] = values[CHANNEL_ACCEL_X + axis];
+        state->gyroDps_[axis] = values[CHANNEL_GYRO_X + axis];
+        state->magGauss_[axis] = values[CHANNEL_MAG_X + axis];
+    }
+}
@@ -0,0 +1,448 @@
+/**
+  ******************************************************************************
+  * File Name          : SimUblox.c
+  * Description        : u-blox M8 GNSS receiver model on UART4 for the host
+  *                      build. Outputs NMEA or NAV-PVT at its navigation
+  *                      rate from the trajectory and answers the CFG-PRT,
+  *                      CFG-RATE and CFG-MSG configuration messages.
+  ******************************************************************************
+*/
+
+#include <math.h>
+#include <string.h>
+
+#include "Sim.h"
+#include "SimDevices.h"
+#include "SimHal.h"
+#include "SimTrajectory.h"
+
+#define SYNC_1 0xB5
+#define SYNC_2 0x62
+#define CLASS_NAV 0x01
+#define CLASS_ACK 0x05
+#define CLASS_CFG 0x06
+#define ID_NAV_PVT 0x07
+#define ID_ACK_NAK 0x00
+#define ID_ACK_ACK 0x01
+#define ID_CFG_PRT 0x00
+#define ID_CFG_MSG 0x01
+#define ID_CFG_RATE 0x08
+#define NAV_PVT_LENGTH 92
+#define MAX_INPUT_PAYLOAD 64
+
+#define PROTOCOL_UBX 0x0001
+#define PROTOCOL_NMEA 0x0002
+#define MODE_8N1_MASK 0x00003FC0 // Character length, parity and stop bits of CFG-PRT mode
+#define MODE_8N1 0x000008C0
+
+#define DEFAULT_BAUD_RATE 9600
+#define DEFAULT_MEASUREMENT_PERIOD_MS 1000
+#define MIN_MEASUREMENT_PERIOD_MS 25
+#define FIRST_EPOCH_NS (500 * SIM_NS_PER_MS) // Hot start with the board
+#define RESPONSE_NS (2 * SIM_NS_PER_MS)
+#define SOLUTION_LATENCY_NS (30 * SIM_NS_PER_MS) // From the epoch to the output
+#define VELOCITY_INTERVAL_NS (100 * SIM_NS_PER_MS) // Centred on the epoch
+
+// On the pad, as in the flight scenarios
+#define PAD_LATITUDE_E7 373910983 // 37 deg 23.4659' N
+#define PAD_LONGITUDE_E7 -1220378267 // 122 deg 2.2696' W
+#define GEOID_SEPARATION_M -25.669
+#define SATELLITES 12
+#define HORIZONTAL_ACCURACY_MM 1500
+#define VERTICAL_ACCURACY_MM 2500
+#define SPEED_ACCURACY_MM_S 300
+#define PDOP 130 // x100
+#define START_SECOND_OF_DAY (17 * 3600 + 28 * 60 + 14) // 17:28:14 UTC
+#define START_TOW_MS 86400000U // Monday, start of the GPS week is the Sunday before
+
+typedef struct
+{
+    SimUbloxMode    mode_;
+    uint32_t        baudRate_;
+    uint16_t        outProtocols_;
+    uint16_t        measurementPeriodMs_;
+    uint8_t         navPvtRate_;
+    uint32_t        epochs_;
+    // Frame being received from the firmware
+    uint8_t         input_[MAX_INPUT_PAYLOAD + 8];
+    uint16_t        inputLength_;
+    // Answer waiting for its response time
+    uint8_t         answer_[16];
+    uint16_t        answerLength_;
+    uint32_t        answerBaudRate_;
+    uint64_t        wrongBaudBytes_;
+    uint64_t        configMessages_;
+    uint64_t        naks_;
+    uint64_t        sentences_;
+    uint64_t        navPvts_;
+    uint64_t        garbledBytes_;
+} Ublox;
+
+static Ublox gnss;
+static SimUartDevice gnssDevice;
+
+/* Output --------------------------------------------------------------------*/
+
+/**
+ * Sends at the receiver's baud rate. The firmware only makes sense of the
+ * bytes if it receives at the same rate, otherwise it gets noise.
+ */
+static void output(const uint8_t* bytes, uint16_t length, uint32_t baudRate)
+{
+    if (baudRate == simUartBaudRate(UART4))
+    {
+        simUartInject(UART4, bytes, length);
+        return;
+    }
+
+    uint8_t noise[256];
+
+    for (uint16_t i = 0; i < length && i < sizeof(noise); i++)
+    {
+        noise[i] = (uint8_t) (bytes[i] * 0x9D + 0x3B);
+    }
+
+    gnss.garbledBytes_ += length;
+    simUartInject(UART4, noise, length < sizeof(noise) ? length : sizeof(noise));
+}
+
+static uint16_t buildFrame(uint8_t messageClass, uint8_t id, const uint8_t* payload, uint16_t length, uint8_t* frame)
+{
+    uint8_t a = 0;
+    uint8_t b = 0;
+
+    frame[0] = SYNC_1;
+    frame[1] = SYNC_2;
+    frame[2] = messageClass;
+    frame[3] = id;
+    frame[4] = (uint8_t) length;
+    frame[5] = (uint8_t) (length >> 8);
+    memcpy(&frame[6], payload, length);
+
+    for (uint16_t i = 2; i < 6 + length; i++)
+    {
+        a += frame[i];
+        b += a;
+    }
+
+    frame[6 + length] = a;
+    frame[7 + length] = b;
+    return length + 8;
+}
+
+static void put2(uint8_t* bytes, uint16_t value)
+{
+    bytes[0] = (uint8_t) value;
+    bytes[1] = (uint8_t) (value >> 8);
+}
+
+static void put4(uint8_t* bytes, uint32_t value)
+{
+    put2(bytes, (uint16_t) value);
+    put2(bytes + 2, (uint16_t) (value >> 16));
+}
+
+static uint16_t get2(const uint8_t* bytes)
+{
+    return (uint16_t) (bytes[0] | (bytes[1] << 8));
+}
+
+static uint32_t get4(const uint8_t* bytes)
+{
+    return get2(bytes) | ((uint32_t) get2(bytes + 2) << 16);
+}
+
+/* Navigation ----------------------------------------------------------------*/
+
+typedef struct
+{
+    uint32_t    towMs_;
+    uint32_t    secondOfDay_;
+    uint32_t    centiseconds_;
+    double      altitudeM_; // Above mean sea level
+    double      climbMs_;
+} Solution;
+
+static void solve(uint64_t timeNs, Solution* solution)
+{
+    SimVehicleState now;
+    SimVehicleState before;
+    SimVehicleState after;
+    uint64_t elapsedMs = timeNs / SIM_NS_PER_MS;
+
+    simTrajectorySample(timeNs, &now);
+    simTrajectorySample(timeNs > VELOCITY_INTERVAL_NS / 2 ? timeNs - VELOCITY_INTERVAL_NS / 2 : 0, &before);
+    simTrajectorySample(timeNs + VELOCITY_INTERVAL_NS / 2, &after);
+
+    solution->towMs_ = (uint32_t) (START_TOW_MS + START_SECOND_OF_DAY * 1000ULL + elapsedMs);
+    solution->secondOfDay_ = (uint32_t) ((START_SECOND_OF_DAY + elapsedMs / 1000) % 86400);
+    solution->centiseconds_ = (uint32_t) (elapsedMs % 1000 / 10);
+    solution->altitudeM_ = now.altitudeM_;
+    solution->climbMs_ = (after.altitudeM_ - before.altitudeM_) * 1e9 / VELOCITY_INTERVAL_NS;
+}
+
+static void sendNmea(const char* body)
+{
+    char sentence[96];
+    uint8_t checksum = 0;
+
+    for (const char* c = body; *c; c++)
+    {
+        checksum ^= (uint8_t) *c;
+    }
+
+    int length = snprintf(sentence, sizeof(sentence), "$%s*%02X\r\n", body, checksum);
+    output((const uint8_t*) sentence, (uint16_t) length, gnss.baudRate_);
+    gnss.sentences_++;
+}
+
+static void outputNmea(const Solution* solution)
+{
+    char body[96];
+    uint32_t hours = solution->secondOfDay_ / 3600;
+    uint32_t minutes = solution->secondOfDay_ / 60 % 60;
+    uint32_t seconds = solution->secondOfDay_ % 60;
+
+    snprintf(
+        body,
+        sizeof(body),
+        "GPGGA,%02u%02u%02u.%02u,3723.4659,N,12202.2696,W,1,%u,0.9,%.3f,M,%.3f,M,,",
+        hours, minutes, seconds, solution->centiseconds_, SATELLITES, solution->altitudeM_, GEOID_SEPARATION_M
+    );
+    sendNmea(body);
+
+    snprintf(
+        body,
+        sizeof(body),
+        "GPRMC,%02u%02u%02u.%02u,A,3723.4659,N,12202.2696,W,0.0,0.0,181026,,,A",
+        hours, minutes, seconds, solution->centiseconds_
+    );
+    sendNmea(body);
+}
+
+static void outputNavPvt(const Solution* solution)
+{
+    uint8_t payload[NAV_PVT_LENGTH] = {0};
+    uint8_t frame[NAV_PVT_LENGTH + 8];
+    int32_t heightMslMm = (int32_t) lround(solution->altitudeM_ * 1000);
+
+    put4(&payload[0], solution->towMs_);
+    put2(&payload[4], 2026);
+    payload[6] = 10;
+    payload[7] = 18;
+    payload[8] = (uint8_t) (solution->secondOfDay_ / 3600);
+    payload[9] = (uint8_t) (solution->secondOfDay_ / 60 % 60);
+    payload[10] = (uint8_t) (solution->secondOfDay_ % 60);
+    payload[11] = 0x07; // Date, time, fully resolved
+    put4(&payload[12], 20); // Time accuracy, ns
+    put4(&payload[16], solution->centiseconds_ * 10000000U);
+    payload[20] = 3; // 3D
+    payload[21] = 0x01; // Fix OK
+    payload[23] = SATELLITES;
+    put4(&payload[24], (uint32_t) PAD_LONGITUDE_E7);
+    put4(&payload[28], (uint32_t) PAD_LATITUDE_E7);
+    put4(&payload[32], (uint32_t) (heightMslMm + (int32_t) lround(GEOID_SEPARATION_M * 1000)));
+    put4(&payload[36], (uint32_t) heightMslMm);
+    put4(&payload[40], HORIZONTAL_ACCURACY_MM);
+    put4(&payload[44], VERTICAL_ACCURACY_MM);
+    put4(&payload[56], (uint32_t) (int32_t) lround(-solution->climbMs_ * 1000));
+    put4(&payload[68], SPEED_ACCURACY_MM_S);
+    put2(&payload[76], PDOP);
+
+    output(frame, buildFrame(CLASS_NAV, ID_NAV_PVT, payload, sizeof(payload), frame), gnss.baudRate_);
+    gnss.navPvts_++;
+}
+
+static void epoch(void* context, uint32_t value)
+{
+    Solution solution;
+
+    // Runs SOLUTION_LATENCY_NS after the epoch
+    solve(simNow() - SOLUTION_LATENCY_NS, &solution);
+
+    if (gnss.outProtocols_ & PROTOCOL_NMEA)
+    {
+        outputNmea(&solution);
+    }
+
+    // CFG-MSG rates count navigation solutions
+    if ((gnss.outProtocols_ & PROTOCOL_UBX) && gnss.navPvtRate_ != 0 && gnss.epochs_ % gnss.navPvtRate_ == 0)
+    {
+        outputNavPvt(&solution);
+    }
+
+    gnss.epochs_++;
+    simSchedule(simNow() + gnss.measurementPeriodMs_ * SIM_NS_PER_MS, epoch, NULL, 0);
+}
+
+/* Configuration -------------------------------------------------------------*/
+
+static void sendAnswer(void* context, uint32_t value)
+{
+    output(gnss.answer_, gnss.answerLength_, gnss.answerBaudRate_);
+}
+
+static void acknowledge(uint8_t messageClass, uint8_t id, int acknowledged)
+{
+    uint8_t payload[2] = {messageClass, id};
+
+    gnss.naks_ += !acknowledged;
+    gnss.answerLength_ = buildFrame(CLASS_ACK, acknowledged ? ID_ACK_ACK : ID_ACK_NAK, payload, sizeof(payload), gnss.answer_);
+    gnss.answerBaudRate_ = gnss.baudRate_;
+    simSchedule(simNow() + RESPONSE_NS, sendAnswer, NULL, 0);
+}
+
+/**
+ * Applies a configuration message and answers it, the acknowledgement of
+ * a new baud rate is sent at that rate.
+ */
+static void configure(uint8_t id, const uint8_t* payload, uint16_t length)
+{
+    gnss.configMessages_++;
+
+    switch (id)
+    {
+        case ID_CFG_PRT:
+            // UART1 only, and only the 8N1 framing the board uses
+            if (length != 20 || payload[0] != 1 || (get4(&payload[4]) & MODE_8N1_MASK) != MODE_8N1 || get4(&payload[8]) == 0)
+            {
+                acknowledge(CLASS_CFG, id, 0);
+                return;
+            }
+
+            gnss.baudRate_ = get4(&payload[8]);
+            gnss.outProtocols_ = get2(&payload[14]);
+            acknowledge(CLASS_CFG, id, 1);
+            return;
+
+        case ID_CFG_RATE:
+            if (length != 6 || get2(&payload[0]) < MIN_MEASUREMENT_PERIOD_MS || get2(&payload[2]) != 1 || get2(&payload[4]) > 1)
+            {
+                acknowledge(CLASS_CFG, id, 0);
+                return;
+            }
+
+            // Takes effect from the next epoch
+            gnss.measurementPeriodMs_ = get2(&payload[0]);
+            acknowledge(CLASS_CFG, id, 1);
+            return;
+
+        case ID_CFG_MSG:
+            if (length != 3)
+            {
+                acknowledge(CLASS_CFG, id, 0);
+                return;
+            }
+
+            if (payload[0] == CLASS_NAV && payload[1] == ID_NAV_PVT)
+            {
+                gnss.navPvtRate_ = payload[2];
+            }
+
+            acknowledge(CLASS_CFG, id, 1);
+            return;
+
+        default:
+            acknowledge(CLASS_CFG, id, 0);
+            return;
+    }
+}
+
+/**
+ * Collects a UBX frame from the firmware's bytes. Bytes sent at another
+ * baud rate are noise to the receiver.
+ */
+static void receive(SimUartDevice* device, uint8_t byte, uint32_t baudRate)
+{
+    if (gnss.mode_ == SIM_UBLOX_NMEA_ONLY)
+    {
+        return;
+    }
+
+    if (baudRate != gnss.baudRate_)
+    {
+        gnss.wrongBaudBytes_++;
+        gnss.inputLength_ = 0;
+        return;
+    }
+
+    if ((gnss.inputLength_ == 0 && byte != SYNC_1) || (gnss.inputLength_ == 1 && byte != SYNC_2))
+    {
+        gnss.inputLength_ = 0;
+        return;
+    }
+
+    gnss.input_[gnss.inputLength_++] = byte;
+
+    if (gnss.inputLength_ < 6)
+    {
+        return;
+    }
+
+    uint16_t length = get2(&gnss.input_[4]);
+
+    if (length > MAX_INPUT_PAYLOAD)
+    {
+        gnss.inputLength_ = 0;
+        return;
+    }
+
+    if (gnss.inputLength_ < length + 8)
+    {
+        return;
+    }
+
+    uint8_t a = 0;
+    uint8_t b = 0;
+
+    for (uint16_t i = 2; i < 6 + length; i++)
+    {
+        a += gnss.input_[i];
+        b += a;
+    }
+
+    gnss.inputLength_ = 0;
+
+    if (a == gnss.input_[6 + length] && b == gnss.input_[7 + length] && gnss.input_[2] == CLASS_CFG)
+    {
+        configure(gnss.input_[3], &gnss.input_[6], length);
+    }
+}
+
+void simUbloxAttach(SimUbloxMode mode)
+{
+    memset(&gnss, 0, sizeof(gnss));
+    gnss.mode_ = mode;
+    gnss.baudRate_ = DEFAULT_BAUD_RATE;
+    gnss.outProtocols_ = PROTOCOL_NMEA;
+    gnss.measurementPeriodMs_ = DEFAULT_MEASUREMENT_PERIOD_MS;
+
+    gnssDevice.name_ = "GNSS";
+    gnssDevice.uart_ = UART4;
+    gnssDevice.receive_ = receive;
+    gnssDevice.state_ = &gnss;
+    simUartAttach(&gnssDevice);
+    simSchedule(FIRST_EPOCH_NS + SOLUTION_LATENCY_NS, epoch, NULL, 0);
+}
+
+void simUbloxPrintStats(FILE* out)
+{
+    if (gnssDevice.uart_ == NULL)
+    {
+        return;
+    }
+
+    fprintf(
+        out,
+        "GNSS receiver: %lu baud, %u ms epochs, %llu NMEA sentences, %llu NAV-PVT, %llu CFG messages, %llu rejected, "
+        "%llu bytes received at the wrong baud rate, %llu bytes sent at the wrong baud rate\n",
+        (unsigned long) gnss.baudRate_,
+        gnss.measurementPeriodMs_,
+        (unsigned long long) gnss.sentences_,
+        (unsigned long long) gnss.navPvts_,
+        (unsigned long long) gnss.configMessages_,
+        (unsigned long long) gnss.naks_,
+        (unsigned long long) gnss.wrongBaudBytes_,
+        (unsigned long long) gnss.garbledBytes_
+    );
+}
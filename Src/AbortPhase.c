@@ -5,6 +5,7 @@
 #include "AbortPhase.h"
 #include "FlightPhase.h"
 #include "ValveControl.h"
+#include "TaskStats.h"
 
 static const int ABORT_PHASE_TASK_PERIOD = 100;
 
@@ -14,7 +15,7 @@ void abortPhaseTask(void const* arg)
 
     for (;;)
     {
-        osDelayUntil(&prevWakeTime, ABORT_PHASE_TASK_PERIOD);
+        taskStatsDelayUntil(&prevWakeTime, ABORT_PHASE_TASK_PERIOD);
 
         if (!IS_ABORT_PHASE)
         {
@@ -0,0 +1,223 @@
+/**
+  ******************************************************************************
+  * File Name          : Ahrs.c
+  * Description        : Mahony attitude filter for the IMU read job. Also
+  *                      built on the host by Tools/AhrsCheck.
+  ******************************************************************************
+*/
+
+#include <math.h>
+#include <string.h>
+
+#include "Ahrs.h"
+
+static const float PROPORTIONAL_GAIN = 1.0f; // 1 s time constant for the corrections
+static const float INTEGRAL_GAIN = 0.05f; // Bias learnt over about 20 s on the pad
+static const float MIN_HORIZONTAL_FIELD = 0.1f; // Of the normalized field, 84 deg inclination
+
+/**
+ * The horizontal part of the field in the local frame, of the normalized
+ * field. Returns its squared magnitude.
+ */
+static float horizontalField(const float* q, const float* magneto, float* hx, float* hy)
+{
+    float norm = 1.0f / sqrtf(magneto[0] * magneto[0] + magneto[1] * magneto[1] + magneto[2] * magneto[2]);
+    float mx = magneto[0] * norm;
+    float my = magneto[1] * norm;
+    float mz = magneto[2] * norm;
+
+    *hx = 2.0f * (mx * (0.5f - q[2] * q[2] - q[3] * q[3]) + my * (q[1] * q[2] - q[0] * q[3]) + mz * (q[1] * q[3] + q[0] * q[2]));
+    *hy = 2.0f * (mx * (q[1] * q[2] + q[0] * q[3]) + my * (0.5f - q[1] * q[1] - q[3] * q[3]) + mz * (q[2] * q[3] - q[0] * q[1]));
+    return *hx * *hx + *hy * *hy;
+}
+
+/**
+ * Sets the attitude from the direction of gravity, the shortest rotation
+ * from the measured up to the local Z axis. Then turns it about up to
+ * bring the field to north, if there is a field.
+ */
+static void initAttitude(Ahrs* ahrs, float ax, float ay, float az, const float* magneto)
+{
+    float* q = ahrs->q_;
+
+    if (az < -0.999f)
+    {
+        // Upside down, any axis in the horizontal plane will do
+        q[0] = 0.0f;
+        q[1] = 1.0f;
+        q[2] = 0.0f;
+        q[3] = 0.0f;
+    }
+    else
+    {
+        // Half way between the measured up and Z: w = 1 + a.z, axis = a x z
+        float w = 1.0f + az;
+        float norm = 1.0f / sqrtf(w * w + ay * ay + ax * ax);
+
+        q[0] = w * norm;
+        q[1] = ay * norm;
+        q[2] = -ax * norm;
+        q[3] = 0.0f;
+    }
+
+    if (magneto == NULL)
+    {
+        return;
+    }
+
+    float hx;
+    float hy;
+    float horizontalSquared = horizontalField(q, magneto, &hx, &hy);
+
+    if (horizontalSquared > MIN_HORIZONTAL_FIELD * MIN_HORIZONTAL_FIELD)
+    {
+        // Rotate by minus the heading of the field, from its cosine with half angle formulas
+        float cosHeading = hx / sqrtf(horizontalSquared);
+        float cosHalf = sqrtf(0.5f * (1.0f + cosHeading));
+        float sinHalf = sqrtf(0.5f * (1.0f - cosHeading));
+        float q0 = q[0];
+        float q1 = q[1];
+        float q2 = q[2];
+        float q3 = q[3];
+
+        sinHalf = hy < 0.0f ? -sinHalf : sinHalf;
+
+        // (cosHalf, 0, 0, -sinHalf) * q
+        q[0] = cosHalf * q0 + sinHalf * q3;
+        q[1] = cosHalf * q1 + sinHalf * q2;
+        q[2] = cosHalf * q2 - sinHalf * q1;
+        q[3] = cosHalf * q3 - sinHalf * q0;
+    }
+}
+
+void ahrsInit(Ahrs* ahrs)
+{
+    memset(ahrs, 0, sizeof(*ahrs));
+    ahrs->q_[0] = 1.0f;
+}
+
+void ahrsUpdate(Ahrs* ahrs, const float* gyro, const float* accel, const float* magneto, float dt)
+{
+    float* q = ahrs->q_;
+    float gx = gyro[0];
+    float gy = gyro[1];
+    float gz = gyro[2];
+    float ex = 0.0f;
+    float ey = 0.0f;
+    float ez = 0.0f;
+
+    float accelSquared = accel[0] * accel[0] + accel[1] * accel[1] + accel[2] * accel[2];
+    // |a| within the gate of 1 g, without the square root
+    int accelAtRest =
+        accelSquared > (1.0f - AHRS_ACCEL_GATE_G) * (1.0f - AHRS_ACCEL_GATE_G) &&
+        accelSquared < (1.0f + AHRS_ACCEL_GATE_G) * (1.0f + AHRS_ACCEL_GATE_G);
+
+    ahrs->updates_++;
+
+    if (magneto != NULL && magneto[0] == 0.0f && magneto[1] == 0.0f && magneto[2] == 0.0f)
+    {
+        magneto = NULL;
+    }
+
+    if (accelAtRest && !ahrs->initialized_)
+    {
+        float norm = 1.0f / sqrtf(accelSquared);
+        initAttitude(ahrs, accel[0] * norm, accel[1] * norm, accel[2] * norm, magneto);
+        ahrs->initialized_ = 1;
+    }
+
+    // Up in the body frame, the third row of the rotation matrix
+    float vx = 2.0f * (q[1] * q[3] - q[0] * q[2]);
+    float vy = 2.0f * (q[0] * q[1] + q[2] * q[3]);
+    float vz = q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3];
+
+    if (accelAtRest)
+    {
+        float norm = 1.0f / sqrtf(accelSquared);
+        float ax = accel[0] * norm;
+        float ay = accel[1] * norm;
+        float az = accel[2] * norm;
+
+        // 1 g of drag towards the tail passes the size gate, so the direction
+        // must also be close to the estimated up
+        accelAtRest = ax * vx + ay * vy + az * vz > AHRS_ACCEL_GATE_COS;
+
+        if (accelAtRest)
+        {
+            // Measured cross estimated up, the rotation that brings them together
+            ex += ay * vz - az * vy;
+            ey += az * vx - ax * vz;
+            ez += ax * vy - ay * vx;
+        }
+    }
+
+    if (!accelAtRest)
+    {
+        ahrs->accelRejections_++;
+    }
+
+    if (magneto != NULL)
+    {
+        float hx;
+        float hy;
+        float horizontalSquared = horizontalField(q, magneto, &hx, &hy);
+
+        // The field cross north is about up only, so the heading moves and
+        // the tilt does not. Skipped with the field close to vertical.
+        if (horizontalSquared > MIN_HORIZONTAL_FIELD * MIN_HORIZONTAL_FIELD)
+        {
+            float headingError = -hy / sqrtf(horizontalSquared);
+
+            ex += headingError * vx;
+            ey += headingError * vy;
+            ez += headingError * vz;
+        }
+    }
+
+    // The bias only moves at rest. In flight a heading error from a disturbed
+    // magnetometer would otherwise be learnt as a bias and tilt the estimate.
+    if (accelAtRest)
+    {
+        ahrs->gyroBias_[0] -= INTEGRAL_GAIN * ex * dt;
+        ahrs->gyroBias_[1] -= INTEGRAL_GAIN * ey * dt;
+        ahrs->gyroBias_[2] -= INTEGRAL_GAIN * ez * dt;
+    }
+
+    gx -= ahrs->gyroBias_[0];
+    gy -= ahrs->gyroBias_[1];
+    gz -= ahrs->gyroBias_[2];
+    ahrs->angularRate_ = sqrtf(gx * gx + gy * gy + gz * gz);
+
+    gx += PROPORTIONAL_GAIN * ex;
+    gy += PROPORTIONAL_GAIN * ey;
+    gz += PROPORTIONAL_GAIN * ez;
+
+    // q' = q + q * (0, g) * dt / 2
+    float halfStep = 0.5f * dt;
+    float q0 = q[0];
+    float q1 = q[1];
+    float q2 = q[2];
+    float q3 = q[3];
+
+    q[0] += (-q1 * gx - q2 * gy - q3 * gz) * halfStep;
+    q[1] += (q0 * gx + q2 * gz - q3 * gy) * halfStep;
+    q[2] += (q0 * gy - q1 * gz + q3 * gx) * halfStep;
+    q[3] += (q0 * gz + q1 * gy - q2 * gx) * halfStep;
+
+    float norm = 1.0f / sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    q[0] *= norm;
+    q[1] *= norm;
+    q[2] *= norm;
+    q[3] *= norm;
+
+    // Cosine of the tilt is the Z component of body Z in the local frame
+    float cosTilt = 1.0f - 2.0f * (q[1] * q[1] + q[2] * q[2]);
+    cosTilt = cosTilt > 1.0f ? 1.0f : cosTilt < -1.0f ? -1.0f : cosTilt;
+    ahrs->tilt_ = acosf(cosTilt);
+
+    // The specific force on up of the new attitude, up in the body frame as above
+    vx = 2.0f * (q[1] * q[3] - q[0] * q[2]);
+    vy = 2.0f * (q[0] * q[1] + q[2] * q[3]);
+    vz = q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3];
+    ahrs->verticalAccel_ = accel[0] * vx + accel[1] * vy + accel[2] * vz;
+}
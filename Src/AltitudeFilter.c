@@ -0,0 +1,347 @@
+/**
+  ******************************************************************************
+  * File Name          : AltitudeFilter.c
+  * Description        : Altitude, vertical velocity and acceleration from the
+  *                      accelerometer, the barometer and GNSS fixes. Also
+  *                      built on the host by the replay benchmark.
+  ******************************************************************************
+*/
+
+#include <math.h>
+#include <string.h>
+
+#include "AltitudeFilter.h"
+#include "AltitudeFilterGainTable.h"
+
+// Pressure at spaceport america in 100*millibars on May 27, 2018. Only until
+// ParachutesControl.c calibrates the launch day value on the pad
+static const double SEA_LEVEL_PRESSURE = 101421.93903699999;
+
+// For the altitude and vertical velocity innovations of a fix with GNSS_REFERENCE_ACCURACY,
+// tuned with Tools/AltitudeFilterBench
+static const double GNSS_GAIN[][2] =
+{
+    {0.25, 0.02},
+    {0.05, 0.3},
+    {0.0, 0.1}
+};
+
+static const double GNSS_REFERENCE_ACCURACY = 3.0; // m, less accurate fixes get the gains scaled down
+static const double GNSS_MAX_ACCURACY = 20.0; // m, less accurate fixes are ignored
+static const double GNSS_OUTLIER_GATE = 50.0; // m
+static const uint32_t GNSS_TIMEOUT_US = 500000; // Without a fix for longer the barometer is trusted again
+static const double BAROMETER_DISTURBANCE_GATE = 30.0; // m
+static const double BAROMETER_OFFSET_GAIN = 0.01; // Per fix, 10 s time constant at 10 Hz
+
+// Milli-g -> g -> m/s^2, less the 1 g of gravity the accelerometer measures at rest.
+// The specific force must be signed: a magnitude turns the drag of a coast into a push up
+static double verticalAcceleration(int32_t accel)
+{
+    return (double) (accel - 1000) / 1000 * 9.8;
+}
+
+/**
+ * Propagates a state using simple kinematics equations.
+ *
+ * Params:
+ *   state - (KalmanStateVector) Altitude, velocity and acceleration
+ *   dt - (double) Time to propagate over. In s.
+ */
+static struct KalmanStateVector predict(struct KalmanStateVector state, double dt)
+{
+    struct KalmanStateVector newState;
+
+    newState.altitude = state.altitude + state.velocity * dt + 0.5 * dt * dt * state.acceleration;
+    newState.velocity = state.velocity + state.acceleration * dt;
+    newState.acceleration = state.acceleration;
+    return newState;
+}
+
+/**
+ * The steady state gain at a time step, interpolated in
+ * ALTITUDE_FILTER_GAIN_TABLE. Steps outside the table take the gain at its
+ * ends.
+ */
+static void scheduledGain(uint32_t stepUs, double gain[3][2])
+{
+    if (stepUs < ALTITUDE_FILTER_TABLE_MIN_STEP_US)
+    {
+        stepUs = ALTITUDE_FILTER_TABLE_MIN_STEP_US;
+    }
+    else if (stepUs >= ALTITUDE_FILTER_TABLE_MAX_STEP_US)
+    {
+        stepUs = ALTITUDE_FILTER_TABLE_MAX_STEP_US - 1; // In the last segment
+    }
+
+    // As the pressure table: the octave is the top bit, the segment the next bits below it
+    int octave = 31 - __builtin_clz(stepUs);
+    int shift = octave - ALTITUDE_FILTER_TABLE_SEGMENT_BITS;
+    uint32_t offset = stepUs - (1u << octave);
+    uint32_t entry = ((octave - ALTITUDE_FILTER_TABLE_FIRST_OCTAVE) << ALTITUDE_FILTER_TABLE_SEGMENT_BITS) + (offset >> shift);
+    double fraction = (double) (offset & ((1u << shift) - 1)) / (1u << shift);
+
+    const float (*start)[2] = ALTITUDE_FILTER_GAIN_TABLE[entry];
+    const float (*end)[2] = ALTITUDE_FILTER_GAIN_TABLE[entry + 1];
+
+    for (int i = 0; i < 3; i++)
+    {
+        gain[i][0] = start[i][0] + (end[i][0] - start[i][0]) * fraction;
+        gain[i][1] = start[i][1] + (end[i][1] - start[i][1]) * fraction;
+    }
+}
+
+/**
+ * Corrects a predicted state with the measurements. altIn is NULL when the
+ * barometer is skipped.
+ */
+static struct KalmanStateVector correct(const double (*gain)[2], struct KalmanStateVector state, const double* altIn, double accelIn)
+{
+    // Calculate the difference between the new state and the measurements
+    double baroDifference = altIn != NULL ? *altIn - state.altitude : 0;
+    double accelDifference = accelIn - state.acceleration;
+
+    // Minimize the chi2 error by means of the Kalman gain matrix
+    state.altitude += gain[0][0] * baroDifference + gain[0][1] * accelDifference;
+    state.velocity += gain[1][0] * baroDifference + gain[1][1] * accelDifference;
+    state.acceleration += gain[2][0] * baroDifference + gain[2][1] * accelDifference;
+    return state;
+}
+
+struct KalmanStateVector filterSensors(
+    struct KalmanStateVector oldState,
+    const BarometricReference* barometer,
+    int32_t currentAccel,
+    int32_t currentPressure,
+    double dtMillis
+)
+{
+    double altIn = barometricAltitude(barometer, currentPressure);
+    double gain[3][2];
+
+    scheduledGain((uint32_t) (dtMillis * 1000), gain);
+    return correct(gain, predict(oldState, dtMillis / 1000), &altIn, verticalAcceleration(currentAccel));
+}
+
+void altitudeFilterInit(AltitudeFilter* filter, double altitude)
+{
+    memset(filter, 0, sizeof(*filter));
+    filter->state_.altitude = altitude;
+    barometricReferenceInit(&filter->barometer_, SEA_LEVEL_PRESSURE);
+}
+
+void altitudeFilterSetSeaLevelPressure(AltitudeFilter* filter, double seaLevelPressure)
+{
+    if (filter->steps_ == 0)
+    {
+        barometricReferenceInit(&filter->barometer_, seaLevelPressure);
+        return;
+    }
+
+    // The barometric altitude of the latest reading moves by shift, the state and
+    // history move with it so the next step sees no jump
+    double before = barometricAltitude(&filter->barometer_, filter->pressure_);
+
+    barometricReferenceInit(&filter->barometer_, seaLevelPressure);
+
+    double shift = barometricAltitude(&filter->barometer_, filter->pressure_) - before;
+
+    filter->state_.altitude += shift;
+
+    for (uint8_t n = 0; n < filter->historyCount_; n++)
+    {
+        AltitudeFilterEntry* entry = &filter->history_[n];
+
+        entry->state_.altitude += shift;
+        entry->barometerAltitude_ += shift;
+    }
+}
+
+void altitudeFilterSetGain(AltitudeFilter* filter, const double (*gain)[2])
+{
+    filter->gain_ = gain;
+}
+
+void altitudeFilterStep(
+    AltitudeFilter* filter,
+    int32_t currentAccel,
+    int32_t currentPressure,
+    uint32_t accelSampleTimeUs,
+    double defaultStepMillis
+)
+{
+    uint32_t stepUs = (uint32_t) (defaultStepMillis * 1000);
+
+    if (filter->steps_ != 0)
+    {
+        stepUs = accelSampleTimeUs - filter->sampleTimeUs_;
+    }
+
+    const double (*gain)[2] = filter->gain_;
+    double scheduled[3][2];
+
+    if (gain == NULL)
+    {
+        scheduledGain(stepUs, scheduled);
+        gain = scheduled;
+    }
+
+    double barometerAltitude = barometricAltitude(&filter->barometer_, currentPressure);
+    double altIn = barometerAltitude + filter->baroOffset_;
+    struct KalmanStateVector predicted = predict(filter->state_, stepUs / 1e6);
+
+    // Only a recent fix vouches for the state, a fix ahead of the step counts as recent
+    int gnssRecent = filter->hasGnss_ && (int32_t) (accelSampleTimeUs - filter->gnssTimeUs_) < (int32_t) GNSS_TIMEOUT_US;
+    uint8_t barometerUsed = !gnssRecent || fabs(altIn - predicted.altitude) < BAROMETER_DISTURBANCE_GATE;
+
+    if (!barometerUsed)
+    {
+        filter->baroRejections_++;
+    }
+
+    filter->state_ = correct(gain, predicted, barometerUsed ? &altIn : NULL, verticalAcceleration(currentAccel));
+    filter->sampleTimeUs_ = accelSampleTimeUs;
+    filter->pressure_ = currentPressure;
+    filter->steps_++;
+
+    AltitudeFilterEntry* entry = &filter->history_[filter->historyNext_];
+    entry->state_ = filter->state_;
+    entry->barometerAltitude_ = barometerAltitude;
+    entry->barometerUsed_ = barometerUsed;
+    entry->sampleTimeUs_ = accelSampleTimeUs;
+
+    filter->historyNext_ = (filter->historyNext_ + 1) % ALTITUDE_FILTER_HISTORY_LENGTH;
+
+    if (filter->historyCount_ < ALTITUDE_FILTER_HISTORY_LENGTH)
+    {
+        filter->historyCount_++;
+    }
+}
+
+// The n-th newest entry of the history, 0 the latest step
+static AltitudeFilterEntry* historyEntry(AltitudeFilter* filter, uint8_t n)
+{
+    return &filter->history_[(filter->historyNext_ + ALTITUDE_FILTER_HISTORY_LENGTH - 1 - n) % ALTITUDE_FILTER_HISTORY_LENGTH];
+}
+
+/**
+ * Adds a correction made at timeUs to a state at stateTimeUs. The
+ * correction grows over the time between the two, as the prediction would
+ * have grown it had it been made then.
+ */
+static void addCorrection(struct KalmanStateVector* state, uint32_t stateTimeUs, const struct KalmanStateVector* correction, uint32_t timeUs)
+{
+    int32_t elapsedUs = (int32_t) (stateTimeUs - timeUs);
+    double dt = elapsedUs > 0 ? elapsedUs / 1e6 : 0;
+    struct KalmanStateVector grown = predict(*correction, dt);
+
+    state->altitude += grown.altitude;
+    state->velocity += grown.velocity;
+    state->acceleration += grown.acceleration;
+}
+
+GnssUpdateResult altitudeFilterGnss(AltitudeFilter* filter, const GnssMeasurement* measurement)
+{
+    uint32_t epochUs = measurement->sampleTimeUs_;
+
+    if (measurement->accuracy_ > GNSS_MAX_ACCURACY)
+    {
+        filter->gnssRejections_++;
+        return GNSS_INACCURATE;
+    }
+
+    if (filter->historyCount_ == 0)
+    {
+        filter->gnssRejections_++;
+        return GNSS_TOO_OLD;
+    }
+
+    // The state at the epoch, and the barometer reading closest to it
+    struct KalmanStateVector atEpoch;
+    const AltitudeFilterEntry* closest = historyEntry(filter, 0);
+    int32_t sinceLatestUs = (int32_t) (epochUs - closest->sampleTimeUs_);
+
+    if (sinceLatestUs >= 0)
+    {
+        atEpoch = predict(closest->state_, sinceLatestUs / 1e6);
+    }
+    else
+    {
+        uint8_t n = 1;
+
+        while (n < filter->historyCount_ && (int32_t) (epochUs - historyEntry(filter, n)->sampleTimeUs_) < 0)
+        {
+            n++;
+        }
+
+        if (n == filter->historyCount_)
+        {
+            filter->gnssRejections_++;
+            return GNSS_TOO_OLD;
+        }
+
+        const AltitudeFilterEntry* before = historyEntry(filter, n);
+        const AltitudeFilterEntry* after = historyEntry(filter, n - 1);
+        double fraction = (double) (uint32_t) (epochUs - before->sampleTimeUs_) / (uint32_t) (after->sampleTimeUs_ - before->sampleTimeUs_);
+
+        atEpoch.altitude = before->state_.altitude + fraction * (after->state_.altitude - before->state_.altitude);
+        atEpoch.velocity = before->state_.velocity + fraction * (after->state_.velocity - before->state_.velocity);
+        atEpoch.acceleration = before->state_.acceleration + fraction * (after->state_.acceleration - before->state_.acceleration);
+        closest = fraction < 0.5 ? before : after;
+    }
+
+    double altitudeDifference = measurement->altitude_ - atEpoch.altitude;
+    double velocityDifference = measurement->hasVelocity_ ? measurement->velocity_ - atEpoch.velocity : 0;
+
+    // The first fix is taken as it is, the state only knew the pad altitude
+    if (filter->hasGnss_ && fabs(altitudeDifference) > GNSS_OUTLIER_GATE && ++filter->gnssOutliers_ < ALTITUDE_FILTER_MAX_OUTLIERS)
+    {
+        filter->gnssRejections_++;
+        return GNSS_OUTLIER;
+    }
+
+    // Gains shrink with the variance of a less accurate fix
+    double weight = 1;
+
+    if (measurement->accuracy_ > GNSS_REFERENCE_ACCURACY)
+    {
+        weight = (GNSS_REFERENCE_ACCURACY * GNSS_REFERENCE_ACCURACY) / (measurement->accuracy_ * measurement->accuracy_);
+    }
+
+    struct KalmanStateVector correction;
+    correction.altitude = weight * (GNSS_GAIN[0][0] * altitudeDifference + GNSS_GAIN[0][1] * velocityDifference);
+    correction.velocity = weight * (GNSS_GAIN[1][0] * altitudeDifference + GNSS_GAIN[1][1] * velocityDifference);
+    correction.acceleration = weight * (GNSS_GAIN[2][0] * altitudeDifference + GNSS_GAIN[2][1] * velocityDifference);
+
+    // Carried forward to every step after the epoch
+    addCorrection(&filter->state_, filter->sampleTimeUs_, &correction, epochUs);
+
+    for (uint8_t n = 0; n < filter->historyCount_; n++)
+    {
+        AltitudeFilterEntry* entry = historyEntry(filter, n);
+
+        if ((int32_t) (entry->sampleTimeUs_ - epochUs) < 0)
+        {
+            break;
+        }
+
+        addCorrection(&entry->state_, entry->sampleTimeUs_, &correction, epochUs);
+    }
+
+    // The barometer offset follows slowly, from readings that were not disturbed
+    double offset = measurement->altitude_ - closest->barometerAltitude_;
+
+    if (!filter->hasGnss_)
+    {
+        filter->baroOffset_ = offset;
+    }
+    else if (closest->barometerUsed_)
+    {
+        filter->baroOffset_ += BAROMETER_OFFSET_GAIN * (offset - filter->baroOffset_);
+    }
+
+    filter->hasGnss_ = 1;
+    filter->gnssOutliers_ = 0;
+    filter->gnssTimeUs_ = epochUs;
+    filter->gnssUpdates_++;
+    return GNSS_APPLIED;
+}
@@ -0,0 +1,100 @@
+/**
+  ******************************************************************************
+  * File Name          : ApogeePredictor.c
+  * Description        : Drag aware time to apogee, for the drogue timer. Also
+  *                      built on the host by Tools/ApogeeMonteCarlo.
+  ******************************************************************************
+*/
+
+#include <math.h>
+#include <string.h>
+
+#include "ApogeePredictor.h"
+
+static const float GRAVITY = 9.80665f; // m/s^2
+static const float MG = 9.80665f / 1000; // m/s^2 per mg
+static const float MIN_DRAG_RATIO = 1e-4f; // k v^2 / g below which drag is left out
+
+void apogeePredictorInit(ApogeePredictor* predictor)
+{
+    memset(predictor, 0, sizeof(*predictor));
+}
+
+/**
+ * Time for a velocity to reach zero under gravity and quadratic drag, in s.
+ */
+static float timeToApogee(float velocity, float dragCoefficient)
+{
+    float dragRatio = dragCoefficient * velocity * velocity / GRAVITY;
+
+    if (dragRatio < MIN_DRAG_RATIO)
+    {
+        return velocity / GRAVITY;
+    }
+
+    return atanf(sqrtf(dragRatio)) / sqrtf(dragCoefficient * GRAVITY);
+}
+
+ApogeeAction apogeePredictorUpdate(
+    ApogeePredictor* predictor,
+    const struct KalmanStateVector* state,
+    int32_t accel,
+    uint32_t sampleTimeUs
+)
+{
+    float velocity = (float) state->velocity;
+
+    predictor->updates_++;
+
+    if (velocity <= 0.0f)
+    {
+        predictor->scheduled_ = 0;
+        predictor->timeToApogee_ = 0.0f;
+        predictor->apogeeTimeUs_ = sampleTimeUs;
+        return APOGEE_NOW;
+    }
+
+    if (velocity > APOGEE_MIN_DRAG_VELOCITY && accel < 0)
+    {
+        // In free flight the accelerometer measures the drag deceleration only
+        float dragCoefficient = -accel * MG / (velocity * velocity);
+
+        if (!predictor->hasDrag_)
+        {
+            predictor->dragCoefficient_ = dragCoefficient;
+            predictor->hasDrag_ = 1;
+        }
+        else
+        {
+            predictor->dragCoefficient_ += APOGEE_DRAG_GAIN * (dragCoefficient - predictor->dragCoefficient_);
+        }
+    }
+
+    predictor->timeToApogee_ = timeToApogee(velocity, predictor->dragCoefficient_);
+    uint32_t apogeeTimeUs = sampleTimeUs + (uint32_t) (predictor->timeToApogee_ * 1e6f);
+
+    if (predictor->timeToApogee_ * 1e6f > APOGEE_ALARM_HORIZON_US)
+    {
+        predictor->scheduled_ = 0;
+        predictor->apogeeTimeUs_ = apogeeTimeUs;
+        return APOGEE_WAIT;
+    }
+
+    if (!predictor->scheduled_)
+    {
+        if (state->acceleration > -APOGEE_MIN_DECELERATION)
+        {
+            predictor->apogeeTimeUs_ = apogeeTimeUs;
+            return APOGEE_WAIT;
+        }
+
+        predictor->scheduled_ = 1;
+        predictor->apogeeTimeUs_ = apogeeTimeUs;
+    }
+    else if ((int32_t) (apogeeTimeUs - predictor->apogeeTimeUs_) < 0)
+    {
+        predictor->apogeeTimeUs_ = apogeeTimeUs;
+    }
+
+    return APOGEE_SCHEDULE;
+}
@@ -0,0 +1,52 @@
+/**
+  ******************************************************************************
+  * File Name          : BarometricAltitude.c
+  * Description        : Pressure to altitude, from the generated table in
+  *                      BarometricAltitudeTable.h. Also built on the host
+  *                      by Tools/BarometricAltitudeBench.
+  ******************************************************************************
+*/
+
+#include <math.h>
+
+#include "BarometricAltitude.h"
+#include "BarometricAltitudeTable.h"
+
+void barometricReferenceInit(BarometricReference* reference, double seaLevelPressure)
+{
+    double scale = pow(BAROMETRIC_REFERENCE_PRESSURE / seaLevelPressure, BAROMETRIC_EXPONENT);
+
+    reference->seaLevelPressure_ = seaLevelPressure;
+    reference->scale_ = (float) scale;
+    reference->offset_ = (float) (BAROMETRIC_SCALE_HEIGHT * (1 - scale));
+}
+
+double barometricAltitude(const BarometricReference* reference, int32_t pressure)
+{
+    if (pressure < BAROMETRIC_TABLE_MIN_PRESSURE || pressure >= BAROMETRIC_TABLE_MAX_PRESSURE)
+    {
+        return barometricAltitudeExact(reference, pressure);
+    }
+
+    // The octave is the position of the top bit, the segment the next bits below it
+    int octave = 31 - __builtin_clz((uint32_t) pressure);
+    int shift = octave - BAROMETRIC_TABLE_SEGMENT_BITS;
+    uint32_t offset = (uint32_t) pressure - (1u << octave);
+    uint32_t entry = ((octave - BAROMETRIC_TABLE_FIRST_OCTAVE) << BAROMETRIC_TABLE_SEGMENT_BITS) + (offset >> shift);
+    float fraction = (float) (offset & ((1u << shift) - 1)) / (float) (1u << shift);
+
+    float start = BAROMETRIC_ALTITUDE_TABLE[entry];
+    float referenceAltitude = start + (BAROMETRIC_ALTITUDE_TABLE[entry + 1] - start) * fraction;
+
+    return reference->offset_ + reference->scale_ * referenceAltitude;
+}
+
+double barometricAltitudeExact(const BarometricReference* reference, int32_t pressure)
+{
+    return BAROMETRIC_SCALE_HEIGHT * (1 - pow(pressure / reference->seaLevelPressure_, BAROMETRIC_EXPONENT));
+}
+
+double barometricSeaLevelPressure(double pressure, double altitude)
+{
+    return pressure / pow(1 - altitude / BAROMETRIC_SCALE_HEIGHT, 1 / BAROMETRIC_EXPONENT);
+}
@@ -6,6 +6,7 @@
 #include "FlightPhase.h"
 #include "Data.h"
 #include "ValveControl.h"
+#include "TaskStats.h"
 
 static const int PRELAUNCH_PHASE_PERIOD = 50;
 static const int BURN_DURATION = 8500;
@@ -25,7 +26,7 @@ void engineControlPrelaunchRoutine(OxidizerTankPressureData* data)
 
     for (;;)
     {
-        osDelayUntil(&prevWakeTime, PRELAUNCH_PHASE_PERIOD);
+        taskStatsDelayUntil(&prevWakeTime, PRELAUNCH_PHASE_PERIOD);
 
         closeInjectionValve();
         closeLowerVentValve();
@@ -81,7 +82,7 @@ void engineControlPostBurnRoutine()
 
     for (;;)
     {
-        osDelayUntil(&prevWakeTime, POST_BURN_PERIOD);
+        taskStatsDelayUntil(&prevWakeTime, POST_BURN_PERIOD);
         FlightPhase phase = getCurrentFlightPhase();
 
         if (phase != COAST && phase != DROGUE_DESCENT && phase != MAIN_DESCENT)
@@ -114,7 +115,7 @@ void engineControlPostFlightRoutine()
 
     for (;;)
     {
-        osDelayUntil(&prevWakeTime, POST_BURN_PERIOD);
+        taskStatsDelayUntil(&prevWakeTime, POST_BURN_PERIOD);
         FlightPhase phase = getCurrentFlightPhase();
 
         if (phase != POST_FLIGHT)
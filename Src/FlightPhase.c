@@ -1,4 +1,5 @@
 #include "FlightPhase.h"
+#include "Trace.h"
 
 static FlightPhase currentFlightPhase = PRELAUNCH;
 
@@ -18,6 +19,7 @@ void newFlightPhase(FlightPhase newPhase)
             if (newPhase > currentFlightPhase)
             {
                 currentFlightPhase = newPhase;
+                trace(TRACE_FLIGHT_PHASE, newPhase);
             }
 
             osMutexRelease(flightPhaseMutex);
@@ -29,6 +31,7 @@ void newFlightPhase(FlightPhase newPhase)
     // if it does, risk a race condition
     // better than not setting the phase
     currentFlightPhase = newPhase;
+    trace(TRACE_FLIGHT_PHASE, newPhase);
     return;
 }
 
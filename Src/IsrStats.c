@@ -0,0 +1,156 @@
+/**
+  ******************************************************************************
+  * File Name          : IsrStats.c
+  * Description        : Entry latency, execution time and nesting of the
+  *                      interrupt handlers, measured with the DWT cycle
+  *                      counter.
+  ******************************************************************************
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "stm32f4xx.h"
+#include "stm32f4xx_hal_conf.h"
+
+#include "IsrStats.h"
+#include "MemorySections.h"
+
+#define ISR_STATS_ENTRY(handler, budgetUs) { #handler, budgetUs, 0, 0, 0, 0, ISR_STATS_NO_LATENCY, 0, 0 },
+
+typedef struct
+{
+    uint32_t    startCycles_;
+    uint32_t    nestedCycles_; // Inclusive time of the handlers that preempted this one
+} IsrFrame;
+
+const char ISR_STATS_LOG_HEADER[] =
+    "elapsedTime(ms),"
+    "currentFlightPhase,"
+    "handler,"
+    "budget(us),"
+    "calls,"
+    "maxExecution(cycles),"
+    "avgExecution(cycles),"
+    "budgetOverruns,"
+    "maxLatency(us),"
+    "nestedCalls,"
+    "maxNesting,"
+    "coreClock(Hz)\n";
+
+// Only written by the handlers, read with interrupts masked
+static IsrStatsEntry isrStats[ISR_STATS_COUNT] CCM_DATA =
+{
+    ISR_STATS_TABLE(ISR_STATS_ENTRY)
+};
+
+static IsrFrame frames[ISR_STATS_MAX_DEPTH] CCM_BSS;
+// A handler that preempts between the read and the write of depth leaves it as it found it
+static volatile uint8_t depth = 0;
+
+void isrStatsEnter(IsrStatsId id, uint32_t latencyUs)
+{
+    uint32_t now = DWT->CYCCNT;
+    uint8_t level = depth++;
+    IsrStatsEntry* entry = &isrStats[id];
+
+    if (level < ISR_STATS_MAX_DEPTH)
+    {
+        frames[level].startCycles_ = now;
+        frames[level].nestedCycles_ = 0;
+    }
+
+    if (level > 0)
+    {
+        entry->nestedCalls_++;
+    }
+
+    if (level + 1 > entry->maxDepth_)
+    {
+        entry->maxDepth_ = level + 1;
+    }
+
+    if (latencyUs != ISR_STATS_NO_LATENCY && (entry->maxLatencyUs_ == ISR_STATS_NO_LATENCY || latencyUs > entry->maxLatencyUs_))
+    {
+        entry->maxLatencyUs_ = latencyUs;
+    }
+}
+
+void isrStatsExit(IsrStatsId id)
+{
+    uint32_t now = DWT->CYCCNT;
+    IsrStatsEntry* entry = &isrStats[id];
+
+    if (depth == 0)
+    {
+        // Exit without an enter
+        return;
+    }
+
+    uint8_t level = --depth;
+    entry->calls_++;
+
+    if (level >= ISR_STATS_MAX_DEPTH)
+    {
+        return;
+    }
+
+    uint32_t inclusive = now - frames[level].startCycles_;
+    uint32_t cycles = inclusive - frames[level].nestedCycles_;
+
+    if (level > 0 && level - 1 < ISR_STATS_MAX_DEPTH)
+    {
+        frames[level - 1].nestedCycles_ += inclusive;
+    }
+
+    if (cycles > entry->maxCycles_)
+    {
+        entry->maxCycles_ = cycles;
+    }
+
+    entry->totalCycles_ += cycles;
+    entry->budgetOverruns_ += cycles > entry->budgetUs_ * (SystemCoreClock / 1000000);
+}
+
+/**
+ * Copies the statistics, totals since boot. Interrupts are masked for the
+ * copy, well under a microsecond.
+ */
+void isrStatsRead(IsrStatsSnapshot* snapshot)
+{
+    snapshot->timeMs_ = HAL_GetTick();
+    snapshot->coreClockHz_ = SystemCoreClock;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    memcpy(snapshot->handlers_, isrStats, sizeof(isrStats));
+    __set_PRIMASK(primask);
+}
+
+/**
+ * Formats one handler of a snapshot as a line of the ISR stats log. A
+ * handler without a latency source logs a latency of -1.
+ *
+ * @return  Number of characters written, at most ISR_STATS_LOG_ENTRY_MAX_LENGTH.
+ */
+int formatIsrStatsEntry(const IsrStatsSnapshot* snapshot, int handler, uint8_t flightPhase, char* buffer)
+{
+    const IsrStatsEntry* entry = &snapshot->handlers_[handler];
+
+    return sprintf(
+               buffer,
+               "%lu,%u,%s,%u,%lu,%lu,%lu,%lu,%ld,%lu,%u,%lu\n",
+               (unsigned long) snapshot->timeMs_,
+               flightPhase,
+               entry->name_,
+               entry->budgetUs_,
+               (unsigned long) entry->calls_,
+               (unsigned long) entry->maxCycles_,
+               (unsigned long) (entry->calls_ ? entry->totalCycles_ / entry->calls_ : 0),
+               (unsigned long) entry->budgetOverruns_,
+               entry->maxLatencyUs_ == ISR_STATS_NO_LATENCY ? -1L : (long) entry->maxLatencyUs_,
+               (unsigned long) entry->nestedCalls_,
+               entry->maxDepth_,
+               (unsigned long) snapshot->coreClockHz_
+           );
+}
@@ -0,0 +1,478 @@
+/**
+  ******************************************************************************
+  * File Name          : LogCompression.c
+  * Description        : Delta + LZ77 block coder for the binary flight log.
+  *                      Memory use is fixed by LogStreamEncoder and the
+  *                      compressor visits every input byte once, so the cost
+  *                      of a block is bounded by LOG_BLOCK_RAW_SIZE.
+  *                      Also built on the host by the log converter tool.
+  ******************************************************************************
+*/
+
+#include <string.h>
+
+#include "LogCompression.h"
+
+static const uint32_t CRC32_NIBBLE_TABLE[16] =
+{
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+static const uint32_t LZ_HASH_MULTIPLIER = 2654435761u;
+
+/* Byte helpers --------------------------------------------------------------*/
+
+static uint32_t read32(const uint8_t* p)
+{
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static void write16(uint8_t* p, uint16_t value)
+{
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+}
+
+static void write32(uint8_t* p, uint32_t value)
+{
+    write16(p, value & 0xFFFF);
+    write16(p + 2, value >> 16);
+}
+
+static uint16_t read16(const uint8_t* p)
+{
+    return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+static uint32_t zigzagEncode(int32_t value)
+{
+    return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+}
+
+static int32_t zigzagDecode(uint32_t value)
+{
+    return (int32_t) (value >> 1) ^ -(int32_t) (value & 1);
+}
+
+uint32_t logStreamCrc32(const uint8_t* data, size_t length)
+{
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ CRC32_NIBBLE_TABLE[crc & 0x0F];
+        crc = (crc >> 4) ^ CRC32_NIBBLE_TABLE[crc & 0x0F];
+    }
+
+    return ~crc;
+}
+
+/* LZ coder ------------------------------------------------------------------*/
+
+/**
+ * Writes a length continuation as a run of 255 bytes and a remainder.
+ *
+ * @return  Number of bytes written.
+ */
+static uint16_t writeLengthExtension(uint8_t* out, uint32_t length)
+{
+    uint16_t written = 0;
+
+    while (length >= 255)
+    {
+        out[written++] = 255;
+        length -= 255;
+    }
+
+    out[written++] = (uint8_t) length;
+    return written;
+}
+
+/**
+ * Emits one sequence: a token with literal and match length nibbles, the
+ * literals, then the match offset. A matchLength of 0 means no match, which
+ * is only used for the final sequence of a block.
+ *
+ * @return  New output length, or 0 if it would not fit in capacity.
+ */
+static uint16_t emitSequence(
+    uint8_t* out,
+    uint16_t outLength,
+    uint16_t capacity,
+    const uint8_t* literals,
+    uint16_t literalLength,
+    uint16_t offset,
+    uint16_t matchLength
+)
+{
+    // Token + extension runs + literals + offset, checked up front so the copy never overruns
+    uint32_t worstCase = 1 + literalLength / 255 + 1 + literalLength + 2 + matchLength / 255 + 1;
+
+    if (outLength + worstCase > capacity)
+    {
+        return 0;
+    }
+
+    uint8_t* token = &out[outLength++];
+    uint16_t matchCode = matchLength ? matchLength - LOG_LZ_MIN_MATCH : 0;
+
+    *token = (uint8_t) (((literalLength < 15 ? literalLength : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+
+    if (literalLength >= 15)
+    {
+        outLength += writeLengthExtension(&out[outLength], literalLength - 15);
+    }
+
+    memcpy(&out[outLength], literals, literalLength);
+    outLength += literalLength;
+
+    if (matchLength)
+    {
+        write16(&out[outLength], offset);
+        outLength += 2;
+
+        if (matchCode >= 15)
+        {
+            outLength += writeLengthExtension(&out[outLength], matchCode - 15);
+        }
+    }
+
+    return outLength;
+}
+
+/**
+ * Compresses the pending raw records into out.
+ *
+ * @return  Compressed length, or 0 if the result would not be smaller than capacity.
+ */
+static uint16_t compressBlock(LogStreamEncoder* encoder, uint8_t* out, uint16_t capacity)
+{
+    const uint8_t* in = encoder->raw_;
+    uint16_t length = encoder->rawLength_;
+    uint16_t anchor = 0;
+    uint16_t position = 0;
+    uint16_t outLength = 0;
+
+    // Table stores position + 1 so that 0 means empty
+    memset(encoder->hashTable_, 0, sizeof(encoder->hashTable_));
+
+    while (position + LOG_LZ_MIN_MATCH <= length)
+    {
+        uint32_t sequence = read32(&in[position]);
+        uint32_t hash = (sequence * LZ_HASH_MULTIPLIER) >> (32 - LOG_LZ_HASH_BITS);
+        uint16_t candidate = encoder->hashTable_[hash];
+        encoder->hashTable_[hash] = position + 1;
+
+        if (candidate == 0 || read32(&in[candidate - 1]) != sequence)
+        {
+            position++;
+            continue;
+        }
+
+        uint16_t reference = candidate - 1;
+        uint16_t matchLength = LOG_LZ_MIN_MATCH;
+
+        while (position + matchLength < length && in[reference + matchLength] == in[position + matchLength])
+        {
+            matchLength++;
+        }
+
+        outLength = emitSequence(
+                        out,
+                        outLength,
+                        capacity,
+                        &in[anchor],
+                        position - anchor,
+                        position - reference,
+                        matchLength
+                    );
+
+        if (outLength == 0)
+        {
+            return 0;
+        }
+
+        position += matchLength;
+        anchor = position;
+    }
+
+    return emitSequence(out, outLength, capacity, &in[anchor], length - anchor, 0, 0);
+}
+
+/**
+ * Inverse of compressBlock.
+ *
+ * @return  Decompressed length, or LOG_STREAM_ERROR_FORMAT on malformed input.
+ */
+static int decompressBlock(const uint8_t* in, size_t inLength, uint8_t* out, size_t outCapacity)
+{
+    size_t inPosition = 0;
+    size_t outLength = 0;
+
+    while (inPosition < inLength)
+    {
+        uint8_t token = in[inPosition++];
+        size_t literalLength = token >> 4;
+        size_t matchLength = token & 0x0F;
+        uint8_t extension;
+
+        if (literalLength == 15)
+        {
+            do
+            {
+                if (inPosition >= inLength)
+                {
+                    return LOG_STREAM_ERROR_FORMAT;
+                }
+
+                extension = in[inPosition++];
+                literalLength += extension;
+            }
+            while (extension == 255);
+        }
+
+        if (inPosition + literalLength > inLength || outLength + literalLength > outCapacity)
+        {
+            return LOG_STREAM_ERROR_FORMAT;
+        }
+
+        memcpy(&out[outLength], &in[inPosition], literalLength);
+        inPosition += literalLength;
+        outLength += literalLength;
+
+        if (inPosition == inLength)
+        {
+            // Final sequence has no match
+            break;
+        }
+
+        if (inPosition + 2 > inLength)
+        {
+            return LOG_STREAM_ERROR_FORMAT;
+        }
+
+        size_t offset = read16(&in[inPosition]);
+        inPosition += 2;
+
+        if (matchLength == 15)
+        {
+            do
+            {
+                if (inPosition >= inLength)
+                {
+                    return LOG_STREAM_ERROR_FORMAT;
+                }
+
+                extension = in[inPosition++];
+                matchLength += extension;
+            }
+            while (extension == 255);
+        }
+
+        matchLength += LOG_LZ_MIN_MATCH;
+
+        if (offset == 0 || offset > outLength || outLength + matchLength > outCapacity)
+        {
+            return LOG_STREAM_ERROR_FORMAT;
+        }
+
+        // Byte copy because the match may overlap its own output
+        for (size_t i = 0; i < matchLength; i++, outLength++)
+        {
+            out[outLength] = out[outLength - offset];
+        }
+    }
+
+    return (int) outLength;
+}
+
+/* Encoder -------------------------------------------------------------------*/
+
+void logStreamInit(LogStreamEncoder* encoder)
+{
+    memset(encoder, 0, sizeof(*encoder));
+}
+
+/**
+ * Delta encodes a record into the pending block.
+ *
+ * @return  1 if the block cannot take another record and must be written
+ *          out with logStreamFinishBlock before the next append, 0 otherwise.
+ */
+uint8_t logStreamAppend(LogStreamEncoder* encoder, const LogEntry* entry)
+{
+    uint8_t* out = &encoder->raw_[encoder->rawLength_];
+
+    for (int i = 0; i < LOG_ENTRY_FIELD_COUNT; i++)
+    {
+        int32_t delta = (int32_t) ((uint32_t) entry->fields_[i] - (uint32_t) encoder->previous_.fields_[i]);
+        uint32_t value = zigzagEncode(delta);
+
+        while (value >= 0x80)
+        {
+            *out++ = (uint8_t) (value | 0x80);
+            value >>= 7;
+        }
+
+        *out++ = (uint8_t) value;
+    }
+
+    encoder->previous_ = *entry;
+    encoder->rawLength_ = out - encoder->raw_;
+    encoder->recordCount_++;
+
+    return encoder->rawLength_ + LOG_RECORD_MAX_ENCODED_SIZE > LOG_BLOCK_RAW_SIZE;
+}
+
+/**
+ * Compresses the pending records into encoder->block_ and starts a new block.
+ * Blocks that do not compress are stored as is.
+ *
+ * @return  Length of the block to write, 0 if there were no pending records.
+ */
+uint16_t logStreamFinishBlock(LogStreamEncoder* encoder)
+{
+    if (encoder->recordCount_ == 0)
+    {
+        return 0;
+    }
+
+    uint8_t* payload = &encoder->block_[LOG_BLOCK_HEADER_SIZE];
+    uint16_t flags = 0;
+    uint16_t payloadLength = compressBlock(encoder, payload, encoder->rawLength_ - 1);
+
+    if (payloadLength == 0)
+    {
+        memcpy(payload, encoder->raw_, encoder->rawLength_);
+        payloadLength = encoder->rawLength_;
+        flags |= LOG_BLOCK_FLAG_STORED;
+    }
+
+    write32(&encoder->block_[0], LOG_BLOCK_MAGIC);
+    write32(&encoder->block_[4], encoder->sequence_);
+    write16(&encoder->block_[8], encoder->recordCount_);
+    write16(&encoder->block_[10], encoder->rawLength_);
+    write16(&encoder->block_[12], payloadLength);
+    write16(&encoder->block_[14], flags);
+    write32(&encoder->block_[16], logStreamCrc32(payload, payloadLength));
+
+    encoder->sequence_++;
+    encoder->recordCount_ = 0;
+    encoder->rawLength_ = 0;
+    memset(&encoder->previous_, 0, sizeof(encoder->previous_));
+
+    return LOG_BLOCK_HEADER_SIZE + payloadLength;
+}
+
+/* Decoder -------------------------------------------------------------------*/
+
+/**
+ * Parses a block header.
+ *
+ * @return  0 on success, LOG_STREAM_ERROR_FORMAT if the magic or lengths are invalid.
+ */
+int logStreamReadHeader(const uint8_t* data, LogBlockHeader* header)
+{
+    if (read32(&data[0]) != LOG_BLOCK_MAGIC)
+    {
+        return LOG_STREAM_ERROR_FORMAT;
+    }
+
+    header->sequence_ = read32(&data[4]);
+    header->recordCount_ = read16(&data[8]);
+    header->rawLength_ = read16(&data[10]);
+    header->payloadLength_ = read16(&data[12]);
+    header->flags_ = read16(&data[14]);
+    header->crc_ = read32(&data[16]);
+
+    if (header->rawLength_ > LOG_BLOCK_RAW_SIZE || header->payloadLength_ > LOG_BLOCK_RAW_SIZE)
+    {
+        return LOG_STREAM_ERROR_FORMAT;
+    }
+
+    return 0;
+}
+
+/**
+ * Verifies and decodes one complete block.
+ *
+ * @param   block       Start of the block header.
+ * @param   length      Bytes available at block, at least the full block.
+ * @param   records     Output records.
+ * @param   maxRecords  Capacity of records.
+ * @return  Number of records decoded, LOG_STREAM_ERROR_CRC if the payload
+ *          is corrupt, or LOG_STREAM_ERROR_FORMAT if the block is malformed.
+ */
+int logStreamDecodeBlock(const uint8_t* block, size_t length, LogEntry* records, int maxRecords)
+{
+    LogBlockHeader header;
+    uint8_t raw[LOG_BLOCK_RAW_SIZE];
+
+    if (length < LOG_BLOCK_HEADER_SIZE || logStreamReadHeader(block, &header) != 0)
+    {
+        return LOG_STREAM_ERROR_FORMAT;
+    }
+
+    const uint8_t* payload = &block[LOG_BLOCK_HEADER_SIZE];
+
+    if (length < LOG_BLOCK_HEADER_SIZE + (size_t) header.payloadLength_ || header.recordCount_ > maxRecords)
+    {
+        return LOG_STREAM_ERROR_FORMAT;
+    }
+
+    if (logStreamCrc32(payload, header.payloadLength_) != header.crc_)
+    {
+        return LOG_STREAM_ERROR_CRC;
+    }
+
+    if (header.flags_ & LOG_BLOCK_FLAG_STORED)
+    {
+        if (header.payloadLength_ != header.rawLength_)
+        {
+            return LOG_STREAM_ERROR_FORMAT;
+        }
+
+        memcpy(raw, payload, header.rawLength_);
+    }
+    else if (decompressBlock(payload, header.payloadLength_, raw, sizeof(raw)) != header.rawLength_)
+    {
+        return LOG_STREAM_ERROR_FORMAT;
+    }
+
+    LogEntry previous;
+    size_t position = 0;
+    memset(&previous, 0, sizeof(previous));
+
+    for (int r = 0; r < header.recordCount_; r++)
+    {
+        for (int i = 0; i < LOG_ENTRY_FIELD_COUNT; i++)
+        {
+            uint32_t value = 0;
+            int shift = 0;
+            uint8_t byte;
+
+            do
+            {
+                if (position >= header.rawLength_ || shift > 28)
+                {
+                    return LOG_STREAM_ERROR_FORMAT;
+                }
+
+                byte = raw[position++];
+                value |= (uint32_t) (byte & 0x7F) << shift;
+                shift += 7;
+            }
+            while (byte & 0x80);
+
+            previous.fields_[i] = (int32_t) ((uint32_t) previous.fields_[i] + (uint32_t) zigzagDecode(value));
+        }
+
+        records[r] = previous;
+    }
+
+    return header.recordCount_;
+}
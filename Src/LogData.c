@@ -1,3 +1,8 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "stm32f4xx.h"
 #include "stm32f4xx_hal_conf.h"
 #include "cmsis_os.h"
@@ -9,32 +14,103 @@
 #include "LogData.h"
 #include "Data.h"
 #include "FlightPhase.h"
+#include "LogFormat.h"
+#include "LogCompression.h"
+#include "TaskStats.h"
+#include "MemoryStats.h"
+#include "SensorSchedule.h"
+#include "IsrStats.h"
+#include "MemorySections.h"
+#include "MemoryBenchmark.h"
+#include "Timebase.h"
+#include "Trace.h"
+
+#define LOG_INDEX_LINE_SIZE 16
+#define PAD_LOG_SLOT_SIZE 512 // One SD sector per record so each write is a single aligned sector
+#define PAD_LOG_HEADER_SLOTS 2 // The ring position, then the CSV header, which no longer fits beside it
+#define PAD_LOG_HEADER_LINE_SIZE 96
+// Set to 1 to log BURN through DROGUE_DESCENT as a compressed binary stream (AvionicsData<N>.avl)
+// instead of CSV. Blocks are written when full, so a power loss can drop up to one block of records.
+#define COMPRESSED_FLIGHT_LOG 0
 
 static int SLOW_LOG_DATA_PERIOD = 700;
 static int FAST_LOG_DATA_PERIOD = 200;
 static uint8_t softwareVersion = 104;
 
-static FATFS fatfs;
-static FIL file;
+// FatFs objects hold the sector buffers the SD driver reads and writes
+static FATFS fatfs DMA_BUFFER;
+static FIL file DMA_BUFFER;
+
+// Index of the last log file created, persisted so boot does not need to probe every existing log
+static const char LOG_INDEX_FILE_NAME[] = "SD:LogIndex.txt";
+static const char LOG_FILE_PATTERN[] = "AvionicsData*.csv";
+static const char LOG_FILE_PREFIX[] = "AvionicsData";
+
+// Pad data goes to a preallocated ring file so holding on the pad has a fixed SD footprint.
+// Every boot reuses the same file and continues its ring, so power cycles do not add files.
+static const char PAD_LOG_FILE_NAME[] = "SD:AvionicsPad.csv";
+static const uint32_t PAD_LOG_DURATION = 15 * 60 * 1000; // 15 minutes kept at the fast logging rate
+// Staging buffers are in CCM RAM. Full sectors go from them straight to the SD driver,
+// which is polled SPI; they must move to SRAM if it ever uses DMA.
+static char padLogSlot[PAD_LOG_SLOT_SIZE] CCM_BSS;
+static uint32_t padLogHead = 0; // Next record slot to write
+static uint32_t padLogCount = 0; // Number of valid record slots
 
 char fileName[32];
 
-void buildLogEntry(AllData* data, char* buffer)
+// Task, memory, sensor schedule and interrupt stats snapshots go to AvionicsTasks<N>.csv,
+// AvionicsMemory<N>.csv, AvionicsSchedule<N>.csv and AvionicsIsr<N>.csv.
+// They share a FIL, one file open at a time, because the pad ring file stays open.
+static const uint32_t STATS_LOG_PERIOD = 5000;
+static FIL statsFile DMA_BUFFER;
+static TaskStatsSnapshot taskStatsSnapshot CCM_BSS;
+static TaskStatsWindow taskStatsWindow CCM_BSS;
+static char taskStatsLine[TASK_STATS_LOG_ENTRY_MAX_LENGTH + 1] CCM_BSS;
+static MemoryStatsSnapshot memoryStatsSnapshot CCM_BSS;
+static char memoryStatsLine[MEMORY_STATS_LOG_ENTRY_MAX_LENGTH + 1] CCM_BSS;
+static SensorScheduleSnapshot sensorScheduleSnapshot CCM_BSS;
+static char sensorScheduleLine[SENSOR_SCHEDULE_LOG_ENTRY_MAX_LENGTH + 1] CCM_BSS;
+static IsrStatsSnapshot isrStatsSnapshot CCM_BSS;
+static char isrStatsLine[ISR_STATS_LOG_ENTRY_MAX_LENGTH + 1] CCM_BSS;
+static uint32_t lastStatsLogTime = 0;
+char taskStatsFileName[32];
+char memoryStatsFileName[32];
+char sensorScheduleFileName[32];
+char isrStatsFileName[32];
+
+#if COMPRESSED_FLIGHT_LOG
+static LogStreamEncoder logStreamEncoder CCM_BSS;
+char streamFileName[32];
+// Encoder cycles from DWT, the appends and finish of the current block, and of
+// every finished block against LOG_BLOCK_CYCLE_BUDGET, summed up in AvionicsStream<N>.csv
+static const char STREAM_STATS_LOG_HEADER[] = "blocks,worstBlockCycles,blocksOverBudget,budgetCycles\n";
+char streamStatsFileName[32];
+static uint32_t streamBlockCycles = 0;
+static uint32_t streamWorstBlockCycles = 0;
+static uint32_t streamBlocks = 0;
+static uint32_t streamBlocksOverBudget = 0;
+#endif
+
+#if TRACE && !TRACE_TELEMETRY
+// Trace events go to AvionicsTrace<N>.bin through the stats FIL, in blocks
+// of up to TRACE_LOG_BLOCK_EVENTS. A second drains about 60 events in flight.
+#define TRACE_LOG_BLOCK_EVENTS 128
+static const uint32_t TRACE_LOG_PERIOD = 1000;
+static TraceEvent traceEvents[TRACE_LOG_BLOCK_EVENTS] CCM_BSS;
+static uint32_t lastTraceLogTime = 0;
+char traceFileName[32];
+#endif
+
+/**
+ * Snapshots every sensor struct into a log record. Sensors whose mutex is
+ * busy are recorded as -1, GPS keeps its last value instead. Each sensor
+ * comes with its sample time; the elapsed time is when the record was
+ * taken.
+ */
+void readLogEntry(AllData* data, LogEntry* entry)
 {
+    int32_t* fields = entry->fields_;
 
-    int32_t accelX = -1;
-    int32_t accelY = -1;
-    int32_t accelZ = -1;
-    int32_t gyroX = -1;
-    int32_t gyroY = -1;
-    int32_t gyroZ = -1;
-    int32_t magnetoX = -1;
-    int32_t magnetoY = -1;
-    int32_t magnetoZ = -1;
-    int32_t pressure = -1;
-    int32_t temperature = -1;
-    int32_t combustionChamberPressure = -1;
-    int32_t oxidizerTankPressure = -1;
     // GPS
     static uint32_t gps_time = 0xFFFF;
     static int32_t latitude_degrees = -1;
@@ -42,31 +118,42 @@ void buildLogEntry(AllData* data, char* buffer)
     static int32_t longitude_degrees = -1;
     static uint32_t longitude_minutes = 0xFFFF;
     static int32_t altitude = -1;
+    static uint32_t gpsSampleTime = 0;
+
+    for (int i = 0; i < LOG_ENTRY_FIELD_COUNT; i++)
+    {
+        fields[i] = -1;
+    }
 
     if (osMutexWait(data->accelGyroMagnetismData_->mutex_, 0) == osOK)
     {
-        accelX = data->accelGyroMagnetismData_->accelX_;
-        accelY = data->accelGyroMagnetismData_->accelY_;
-        accelZ = data->accelGyroMagnetismData_->accelZ_;
-        gyroX = data->accelGyroMagnetismData_->gyroX_;
-        gyroY = data->accelGyroMagnetismData_->gyroY_;
-        gyroZ = data->accelGyroMagnetismData_->gyroZ_;
-        magnetoX = data->accelGyroMagnetismData_->magnetoX_;
-        magnetoY = data->accelGyroMagnetismData_->magnetoY_;
-        magnetoZ = data->accelGyroMagnetismData_->magnetoZ_;
+        fields[LOG_FIELD_ACCEL_X] = data->accelGyroMagnetismData_->accelX_;
+        fields[LOG_FIELD_ACCEL_Y] = data->accelGyroMagnetismData_->accelY_;
+        fields[LOG_FIELD_ACCEL_Z] = data->accelGyroMagnetismData_->accelZ_;
+        fields[LOG_FIELD_GYRO_X] = data->accelGyroMagnetismData_->gyroX_;
+        fields[LOG_FIELD_GYRO_Y] = data->accelGyroMagnetismData_->gyroY_;
+        fields[LOG_FIELD_GYRO_Z] = data->accelGyroMagnetismData_->gyroZ_;
+        fields[LOG_FIELD_MAGNETO_X] = data->accelGyroMagnetismData_->magnetoX_;
+        fields[LOG_FIELD_MAGNETO_Y] = data->accelGyroMagnetismData_->magnetoY_;
+        fields[LOG_FIELD_MAGNETO_Z] = data->accelGyroMagnetismData_->magnetoZ_;
+        fields[LOG_FIELD_TILT] = data->accelGyroMagnetismData_->tilt_;
+        fields[LOG_FIELD_ANGULAR_RATE] = data->accelGyroMagnetismData_->angularRate_;
+        fields[LOG_FIELD_IMU_SAMPLE_TIME] = data->accelGyroMagnetismData_->sampleTimeUs_;
         osMutexRelease(data->accelGyroMagnetismData_->mutex_);
     }
 
     if (osMutexWait(data->barometerData_->mutex_, 0) == osOK)
     {
-        pressure = data->barometerData_->pressure_;
-        temperature = data->barometerData_->temperature_;
+        fields[LOG_FIELD_PRESSURE] = data->barometerData_->pressure_;
+        fields[LOG_FIELD_TEMPERATURE] = data->barometerData_->temperature_;
+        fields[LOG_FIELD_BAROMETER_SAMPLE_TIME] = data->barometerData_->sampleTimeUs_;
         osMutexRelease(data->barometerData_->mutex_);
     }
 
     if (osMutexWait(data->combustionChamberPressureData_->mutex_, 0) == osOK)
     {
-        combustionChamberPressure = data->combustionChamberPressureData_->pressure_;
+        fields[LOG_FIELD_COMBUSTION_CHAMBER_PRESSURE] = data->combustionChamberPressureData_->pressure_;
+        fields[LOG_FIELD_COMBUSTION_CHAMBER_SAMPLE_TIME] = data->combustionChamberPressureData_->sampleTimeUs_;
         osMutexRelease(data->combustionChamberPressureData_->mutex_);
     }
 
@@ -81,42 +168,144 @@ void buildLogEntry(AllData* data, char* buffer)
         longitude_minutes = data->gpsData_->longitude_.minutes_;
 
         altitude = data->gpsData_->totalAltitude_.altitude_;
+        gpsSampleTime = data->gpsData_->sampleTimeUs_;
 
         osMutexRelease(data->gpsData_->mutex_);
     }
 
     if (osMutexWait(data->oxidizerTankPressureData_->mutex_, 0) == osOK)
     {
-        oxidizerTankPressure = data->oxidizerTankPressureData_->pressure_;
+        fields[LOG_FIELD_OXIDIZER_TANK_PRESSURE] = data->oxidizerTankPressureData_->pressure_;
+        fields[LOG_FIELD_OXIDIZER_TANK_SAMPLE_TIME] = data->oxidizerTankPressureData_->sampleTimeUs_;
         osMutexRelease(data->oxidizerTankPressureData_->mutex_);
     }
 
-    sprintf(
-        buffer,
-        "%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%lu,%ld,%ld,%ld,%ld,%ld,%d,%ld,%d\n",
-        accelX,
-        accelY,
-        accelZ,
-        gyroX,
-        gyroY,
-        gyroZ,
-        magnetoX,
-        magnetoY,
-        magnetoZ,
-        pressure,
-        temperature,
-        combustionChamberPressure,
-        oxidizerTankPressure,
-        gps_time,
-        latitude_degrees,
-        latitude_minutes,
-        longitude_degrees,
-        longitude_minutes,
-        altitude,
-        getCurrentFlightPhase(),
-        HAL_GetTick(),
-        softwareVersion
-    );
+    fields[LOG_FIELD_GPS_TIME] = gps_time;
+    fields[LOG_FIELD_LATITUDE_DEGREES] = latitude_degrees;
+    fields[LOG_FIELD_LATITUDE_MINUTES] = latitude_minutes;
+    fields[LOG_FIELD_LONGITUDE_DEGREES] = longitude_degrees;
+    fields[LOG_FIELD_LONGITUDE_MINUTES] = longitude_minutes;
+    fields[LOG_FIELD_GPS_ALTITUDE] = altitude;
+    fields[LOG_FIELD_FLIGHT_PHASE] = getCurrentFlightPhase();
+    fields[LOG_FIELD_ELAPSED_TIME] = timebaseMillis();
+    fields[LOG_FIELD_SOFTWARE_VERSION] = softwareVersion;
+    fields[LOG_FIELD_GPS_SAMPLE_TIME] = gpsSampleTime;
+}
+
+void buildLogEntry(AllData* data, char* buffer)
+{
+    LogEntry entry;
+    readLogEntry(data, &entry);
+    formatLogEntry(&entry, buffer);
+}
+
+/**
+ * Appends one line per task to the task and memory stats files, one line
+ * per job to the sensor schedule file and one line per interrupt handler to
+ * the ISR stats file, if STATS_LOG_PERIOD has passed since the last
+ * snapshot. The card must already be mounted.
+ */
+void logStatsIfDue()
+{
+    if (HAL_GetTick() - lastStatsLogTime < STATS_LOG_PERIOD)
+    {
+        return;
+    }
+
+    lastStatsLogTime = HAL_GetTick();
+    taskStatsRead(&taskStatsSnapshot, &taskStatsWindow);
+    memoryStatsRead(&memoryStatsSnapshot);
+    sensorScheduleRead(&sensorScheduleSnapshot);
+    isrStatsRead(&isrStatsSnapshot);
+
+    if (f_open(&statsFile, taskStatsFileName, FA_OPEN_APPEND | FA_WRITE) == FR_OK)
+    {
+        for (int i = 0; i < taskStatsSnapshot.taskCount_; i++)
+        {
+            formatTaskStatsEntry(&taskStatsSnapshot, i, getCurrentFlightPhase(), taskStatsLine);
+            f_puts(taskStatsLine, &statsFile);
+        }
+
+        f_close(&statsFile);
+    }
+
+    if (f_open(&statsFile, memoryStatsFileName, FA_OPEN_APPEND | FA_WRITE) == FR_OK)
+    {
+        for (int i = 0; i < memoryStatsSnapshot.taskCount_; i++)
+        {
+            formatMemoryStatsEntry(&memoryStatsSnapshot, i, getCurrentFlightPhase(), memoryStatsLine);
+            f_puts(memoryStatsLine, &statsFile);
+        }
+
+        f_close(&statsFile);
+    }
+
+    if (f_open(&statsFile, sensorScheduleFileName, FA_OPEN_APPEND | FA_WRITE) == FR_OK)
+    {
+        for (int i = 0; i < sensorScheduleSnapshot.jobCount_; i++)
+        {
+            formatSensorScheduleEntry(&sensorScheduleSnapshot, i, getCurrentFlightPhase(), sensorScheduleLine);
+            f_puts(sensorScheduleLine, &statsFile);
+        }
+
+        f_close(&statsFile);
+    }
+
+    if (f_open(&statsFile, isrStatsFileName, FA_OPEN_APPEND | FA_WRITE) == FR_OK)
+    {
+        for (int i = 0; i < ISR_STATS_COUNT; i++)
+        {
+            formatIsrStatsEntry(&isrStatsSnapshot, i, getCurrentFlightPhase(), isrStatsLine);
+            f_puts(isrStatsLine, &statsFile);
+        }
+
+        f_close(&statsFile);
+    }
+}
+
+/**
+ * Appends the trace events read since the last call to the trace file, if
+ * TRACE_LOG_PERIOD has passed. The card must already be mounted.
+ */
+void logTraceIfDue()
+{
+#if TRACE && !TRACE_TELEMETRY
+    TraceBlockHeader header;
+    UINT written;
+
+    if (HAL_GetTick() - lastTraceLogTime < TRACE_LOG_PERIOD)
+    {
+        return;
+    }
+
+    lastTraceLogTime = HAL_GetTick();
+
+    if (f_open(&statsFile, traceFileName, FA_OPEN_APPEND | FA_WRITE) != FR_OK)
+    {
+        return;
+    }
+
+    header.magic_ = TRACE_BLOCK_MAGIC;
+    header.coreClockHz_ = SystemCoreClock;
+    header.reserved_ = 0;
+
+    do
+    {
+        traceSync(&header.syncCycles_, &header.syncUs_);
+        header.count_ = traceRead(traceEvents, TRACE_LOG_BLOCK_EVENTS, &header.lost_);
+
+        if (header.count_ == 0 && header.lost_ == 0)
+        {
+            break;
+        }
+
+        f_write(&statsFile, &header, sizeof(header), &written);
+        f_write(&statsFile, traceEvents, header.count_ * sizeof(TraceEvent), &written);
+    }
+    while (header.count_ == TRACE_LOG_BLOCK_EVENTS);
+
+    f_close(&statsFile);
+#endif
 }
 
 void lowFrequencyLogToSdRoutine(AllData* data, char* buffer)
@@ -126,7 +315,7 @@ void lowFrequencyLogToSdRoutine(AllData* data, char* buffer)
 
     for (;;)
     {
-        osDelayUntil(&prevWakeTime, SLOW_LOG_DATA_PERIOD);
+        taskStatsDelayUntil(&prevWakeTime, SLOW_LOG_DATA_PERIOD);
 
         if (getCurrentFlightPhase() != entryPhase)
         {
@@ -146,12 +335,85 @@ void lowFrequencyLogToSdRoutine(AllData* data, char* buffer)
                 f_close(&file);
             }
 
+            logStatsIfDue();
+            logTraceIfDue();
             f_mount(NULL, "SD:", 1);
             HAL_GPIO_WritePin(LED1_GPIO_Port, LED1_Pin, 0);
         }
     }
 }
 
+#if COMPRESSED_FLIGHT_LOG
+static uint8_t appendLogStreamEntry(const LogEntry* entry)
+{
+    uint32_t start = DWT->CYCCNT;
+    uint8_t blockReady = logStreamAppend(&logStreamEncoder, entry);
+
+    streamBlockCycles += DWT->CYCCNT - start;
+    return blockReady;
+}
+
+/**
+ * Compresses the pending records and appends the block to the stream file.
+ * The card must already be mounted.
+ */
+void writeLogStreamBlock()
+{
+    UINT written;
+    uint32_t start = DWT->CYCCNT;
+    uint16_t length = logStreamFinishBlock(&logStreamEncoder);
+
+    streamBlockCycles += DWT->CYCCNT - start;
+
+    if (length != 0)
+    {
+        streamBlocks++;
+
+        if (streamBlockCycles > streamWorstBlockCycles)
+        {
+            streamWorstBlockCycles = streamBlockCycles;
+        }
+
+        if (streamBlockCycles > LOG_BLOCK_CYCLE_BUDGET)
+        {
+            streamBlocksOverBudget++;
+        }
+
+        streamBlockCycles = 0;
+    }
+
+    if (length != 0 && f_open(&file, streamFileName, FA_OPEN_APPEND | FA_WRITE) == FR_OK)
+    {
+        f_write(&file, logStreamEncoder.block_, length, &written);
+        f_close(&file);
+    }
+}
+
+/**
+ * Rewrites AvionicsStream<N>.csv with the encoder cycles of the blocks so far.
+ * The card must already be mounted.
+ */
+void writeLogStreamStats()
+{
+    char line[64];
+
+    if (f_open(&statsFile, streamStatsFileName, FA_CREATE_ALWAYS | FA_WRITE) == FR_OK)
+    {
+        sprintf(
+            line,
+            "%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%d\n",
+            streamBlocks,
+            streamWorstBlockCycles,
+            streamBlocksOverBudget,
+            LOG_BLOCK_CYCLE_BUDGET
+        );
+        f_puts(STREAM_STATS_LOG_HEADER, &statsFile);
+        f_puts(line, &statsFile);
+        f_close(&statsFile);
+    }
+}
+#endif
+
 void highFrequencyLogToSdRoutine(AllData* data, char* buffer)
 {
     // Get card mounted
@@ -179,7 +441,7 @@ void highFrequencyLogToSdRoutine(AllData* data, char* buffer)
 
     for (;;)
     {
-        osDelayUntil(&prevWakeTime, FAST_LOG_DATA_PERIOD);
+        taskStatsDelayUntil(&prevWakeTime, FAST_LOG_DATA_PERIOD);
 
         FlightPhase flightPhase = getCurrentFlightPhase();
 
@@ -191,6 +453,17 @@ void highFrequencyLogToSdRoutine(AllData* data, char* buffer)
             break;
         }
 
+#if COMPRESSED_FLIGHT_LOG
+        LogEntry entry;
+        readLogEntry(data, &entry);
+
+        if (appendLogStreamEntry(&entry))
+        {
+            writeLogStreamBlock();
+            writeLogStreamStats();
+        }
+
+#else
         buildLogEntry(data, buffer);
 
         if (f_open(&file, fileName, FA_OPEN_APPEND | FA_READ | FA_WRITE) == FR_OK)
@@ -198,75 +471,469 @@ void highFrequencyLogToSdRoutine(AllData* data, char* buffer)
             f_puts(buffer, &file);
             f_close(&file); // close to save the file
         }
+
+#endif
+        logStatsIfDue();
+        logTraceIfDue();
     }
 
+#if COMPRESSED_FLIGHT_LOG
+    writeLogStreamBlock();
+    writeLogStreamStats();
+#endif
+
     HAL_GPIO_WritePin(LED1_GPIO_Port, LED1_Pin, 0);
     f_mount(NULL, "SD:", 1);
 }
 
+uint32_t padLogSlotCount()
+{
+    return PAD_LOG_DURATION / FAST_LOG_DATA_PERIOD;
+}
+
+/**
+ * Fills the slot buffer with length bytes of text and pads it with
+ * newlines, so the file still reads as CSV with blank lines.
+ */
+static void fillPadLogSlot(const char* text, size_t length)
+{
+    if (length > PAD_LOG_SLOT_SIZE)
+    {
+        length = PAD_LOG_SLOT_SIZE;
+    }
+
+    memcpy(padLogSlot, text, length);
+    memset(padLogSlot + length, '\n', PAD_LOG_SLOT_SIZE - length);
+}
+
+static FRESULT writePadLogSlot(uint32_t slot)
+{
+    UINT written;
+    FRESULT result = f_lseek(&file, (FSIZE_t) slot * PAD_LOG_SLOT_SIZE);
+
+    if (result == FR_OK)
+    {
+        result = f_write(&file, padLogSlot, PAD_LOG_SLOT_SIZE, &written);
+    }
+
+    return result;
+}
+
+/**
+ * Rewrites slot 0 of the pad ring file, one line recording where the
+ * oldest record is so the file can be unrolled after recovery. Slot 1
+ * holds the usual CSV header, written by openPadRingLog.
+ */
+FRESULT writePadRingLogHeader()
+{
+    char line[PAD_LOG_HEADER_LINE_SIZE];
+    int length = sprintf(
+                     line,
+                     "# pad ring log: slotSize=%d headerSlots=%d slots=%" PRIu32 " head=%" PRIu32 " count=%" PRIu32 "\n",
+                     PAD_LOG_SLOT_SIZE,
+                     PAD_LOG_HEADER_SLOTS,
+                     padLogSlotCount(),
+                     padLogHead,
+                     padLogCount
+                 );
+    fillPadLogSlot(line, length);
+
+    return writePadLogSlot(0);
+}
+
+/**
+ * Restores the ring position from slot 0 of an existing pad ring file, or
+ * starts an empty ring if the line is missing or from another ring size.
+ */
+static void readPadRingLogHeader()
+{
+    char line[PAD_LOG_HEADER_LINE_SIZE];
+    UINT length;
+
+    padLogHead = 0;
+    padLogCount = 0;
+
+    if (f_lseek(&file, 0) != FR_OK || f_read(&file, line, sizeof(line) - 1, &length) != FR_OK)
+    {
+        return;
+    }
+
+    line[length] = '\0';
+
+    char* slots = strstr(line, " slots=");
+    char* head = strstr(line, " head=");
+    char* count = strstr(line, " count=");
+
+    if (slots == NULL || head == NULL || count == NULL || strtoul(slots + 7, NULL, 10) != padLogSlotCount())
+    {
+        return;
+    }
+
+    uint32_t storedHead = strtoul(head + 6, NULL, 10);
+    uint32_t storedCount = strtoul(count + 7, NULL, 10);
+
+    if (storedHead < padLogSlotCount() && storedCount <= padLogSlotCount())
+    {
+        padLogHead = storedHead;
+        padLogCount = storedCount;
+    }
+}
+
+/**
+ * Mounts the card and opens the pad ring file, preallocating it on first use
+ * and cutting a longer file back to the ring size.
+ * An existing ring continues where its header says it stopped, so a reboot
+ * on the pad, an abort reset back to PRELAUNCH, or a power cycle after the
+ * flight keeps the newest records instead of starting over them.
+ *
+ * @return  1 if the file is open and ready, 0 otherwise.
+ */
+uint8_t openPadRingLog()
+{
+    FSIZE_t ringSize = (FSIZE_t) (padLogSlotCount() + PAD_LOG_HEADER_SLOTS) * PAD_LOG_SLOT_SIZE;
+
+    if (f_mount(&fatfs, "SD:", 1) != FR_OK)
+    {
+        return 0;
+    }
+
+    if (f_open(&file, PAD_LOG_FILE_NAME, FA_OPEN_ALWAYS | FA_READ | FA_WRITE) != FR_OK)
+    {
+        f_mount(NULL, "SD:", 1);
+        return 0;
+    }
+
+    if (f_size(&file) > ringSize)
+    {
+        // Left by a longer ring, or damaged, lseek alone never shrinks it
+        f_lseek(&file, ringSize);
+        f_truncate(&file);
+        padLogHead = 0;
+        padLogCount = 0;
+    }
+    else if (f_size(&file) != ringSize)
+    {
+        // Prefer a contiguous allocation, otherwise let lseek extend the file cluster by cluster
+        if (f_size(&file) != 0 || f_expand(&file, ringSize, 1) != FR_OK)
+        {
+            f_lseek(&file, ringSize);
+        }
+
+        padLogHead = 0;
+        padLogCount = 0;
+    }
+    else
+    {
+        readPadRingLogHeader();
+    }
+
+    fillPadLogSlot(LOG_FILE_HEADER, strlen(LOG_FILE_HEADER));
+
+    if (f_size(&file) != ringSize || writePadLogSlot(1) != FR_OK || writePadRingLogHeader() != FR_OK)
+    {
+        f_close(&file);
+        f_mount(NULL, "SD:", 1);
+        return 0;
+    }
+
+    f_sync(&file);
+    HAL_GPIO_WritePin(LED1_GPIO_Port, LED1_Pin, 1);
+    return 1;
+}
+
+/**
+ * Overwrites the oldest slot of the pad ring file with a log entry and
+ * advances the head stored in the header. Costs two sector writes and a sync
+ * no matter how long the rocket has been on the pad.
+ */
+FRESULT writePadRingLogEntry(char* buffer)
+{
+    fillPadLogSlot(buffer, strlen(buffer));
+
+    FRESULT result = writePadLogSlot(padLogHead + PAD_LOG_HEADER_SLOTS);
+
+    if (result != FR_OK)
+    {
+        return result;
+    }
+
+    padLogHead = (padLogHead + 1) % padLogSlotCount();
+
+    if (padLogCount < padLogSlotCount())
+    {
+        padLogCount++;
+    }
+
+    result = writePadRingLogHeader();
+
+    if (result == FR_OK)
+    {
+        result = f_sync(&file);
+    }
+
+    return result;
+}
+
+/**
+ * Logs at the fast rate while in PRELAUNCH or ARM into the pad ring file.
+ * Exits once the flight phase leaves the pad phases so that BURN onwards is
+ * appended to the flight log file.
+ */
+void padRingLogToSdRoutine(AllData* data, char* buffer)
+{
+    uint32_t prevWakeTime = osKernelSysTick();
+    uint8_t fileOpen = 0;
+
+    for (;;)
+    {
+        taskStatsDelayUntil(&prevWakeTime, FAST_LOG_DATA_PERIOD);
+
+        FlightPhase flightPhase = getCurrentFlightPhase();
+
+        if (flightPhase != PRELAUNCH && flightPhase != ARM)
+        {
+            break;
+        }
+
+        if (!fileOpen)
+        {
+            // Card may not be ready yet, retry every period
+            fileOpen = openPadRingLog();
+
+            if (!fileOpen)
+            {
+                continue;
+            }
+        }
+
+        buildLogEntry(data, buffer);
+
+        if (writePadRingLogEntry(buffer) != FR_OK)
+        {
+            // Lost the card, remount on the next period
+            f_close(&file);
+            f_mount(NULL, "SD:", 1);
+            HAL_GPIO_WritePin(LED1_GPIO_Port, LED1_Pin, 0);
+            fileOpen = 0;
+            continue;
+        }
+
+        logStatsIfDue();
+        logTraceIfDue();
+    }
+
+    if (fileOpen)
+    {
+        f_close(&file);
+        f_mount(NULL, "SD:", 1);
+        HAL_GPIO_WritePin(LED1_GPIO_Port, LED1_Pin, 0);
+    }
+}
+
+/**
+ * Reads the index of the last created log file from the index file.
+ * The card must already be mounted.
+ *
+ * @return  The stored index, or 0 if the index file is missing or unreadable.
+ */
+uint32_t readLogIndex()
+{
+    char line[LOG_INDEX_LINE_SIZE];
+    uint32_t index = 0;
+
+    if (f_open(&file, LOG_INDEX_FILE_NAME, FA_OPEN_EXISTING | FA_READ) != FR_OK)
+    {
+        return 0;
+    }
+
+    if (f_gets(line, sizeof(line), &file) != NULL)
+    {
+        index = strtoul(line, NULL, 10);
+    }
+
+    f_close(&file);
+    return index;
+}
+
+/**
+ * Persists the index of the log file that was just created.
+ * The card must already be mounted.
+ */
+void writeLogIndex(uint32_t index)
+{
+    if (f_open(&file, LOG_INDEX_FILE_NAME, FA_CREATE_ALWAYS | FA_WRITE) == FR_OK)
+    {
+        f_printf(&file, "%lu\n", (unsigned long) index); // FatFs f_printf has no PRIu32
+        f_close(&file);
+    }
+}
+
+/**
+ * Finds the highest AvionicsData<N>.csv index on the card with a single
+ * directory pass. Only used when the index file is missing or stale.
+ * The card must already be mounted.
+ *
+ * @return  The highest index found, or 0 if there are no log files.
+ */
+uint32_t scanForLastLogIndex()
+{
+    DIR dir;
+    FILINFO info;
+    uint32_t lastIndex = 0;
+
+    FRESULT result = f_findfirst(&dir, &info, "SD:", LOG_FILE_PATTERN);
+
+    while (result == FR_OK && info.fname[0] != 0)
+    {
+        uint32_t index = strtoul(info.fname + strlen(LOG_FILE_PREFIX), NULL, 10);
+
+        if (index > lastIndex)
+        {
+            lastIndex = index;
+        }
+
+        result = f_findnext(&dir, &info);
+    }
+
+    f_closedir(&dir);
+    return lastIndex;
+}
+
+/**
+ * Creates this boot's AvionicsData<N>.csv with its header, and records N in
+ * the index file. N is normally the stored index plus one, and the
+ * FA_CREATE_NEW open is the only check that it is free: FAT has no directory
+ * index, so any lookup of a new name reads the whole directory, and this one
+ * is needed anyway. Falls back to a directory scan if the index file does
+ * not exist yet or points at a file that already exists.
+ * The card must already be mounted.
+ *
+ * @param index  Set to N, also when the file could not be created.
+ * @return       1 if the log file was created, 0 otherwise.
+ */
+int createNextLogFile(uint32_t* index)
+{
+    FRESULT result = FR_EXIST;
+
+    *index = readLogIndex() + 1;
+
+    if (*index > 1)
+    {
+        sprintf(fileName, "SD:AvionicsData%" PRIu32 ".csv", *index);
+        result = f_open(&file, fileName, FA_CREATE_NEW | FA_READ | FA_WRITE);
+    }
+
+    if (result == FR_EXIST)
+    {
+        *index = scanForLastLogIndex() + 1;
+        sprintf(fileName, "SD:AvionicsData%" PRIu32 ".csv", *index);
+        result = f_open(&file, fileName, FA_CREATE_NEW | FA_READ | FA_WRITE);
+    }
+
+    if (result != FR_OK)
+    {
+        return 0;
+    }
+
+    f_puts(LOG_FILE_HEADER, &file);
+    f_close(&file);
+    writeLogIndex(*index);
+    return 1;
+}
+
+#if MEMORY_BENCHMARK
+/**
+ * Runs the SRAM / CCM RAM benchmark once and writes AvionicsBenchmark<N>.csv.
+ * The card must already be mounted.
+ */
+void logMemoryBenchmark(uint32_t index)
+{
+    MemoryBenchmarkResult results[MEMORY_BENCHMARK_COUNT];
+    char line[MEMORY_BENCHMARK_LOG_ENTRY_MAX_LENGTH + 1];
+    char benchmarkFileName[32];
+    int count = memoryBenchmarkRun(results);
+
+    sprintf(benchmarkFileName, "SD:AvionicsBenchmark%" PRIu32 ".csv", index);
+
+    if (f_open(&statsFile, benchmarkFileName, FA_CREATE_NEW | FA_WRITE) == FR_OK)
+    {
+        f_puts(MEMORY_BENCHMARK_LOG_HEADER, &statsFile);
+
+        for (int i = 0; i < count; i++)
+        {
+            formatMemoryBenchmarkResult(&results[i], line);
+            f_puts(line, &statsFile);
+        }
+
+        f_close(&statsFile);
+    }
+}
+#endif
+
 void logDataTask(void const* arg)
 {
     AllData* data = (AllData*) arg;
-    char buffer[500];
-
-    sprintf(
-        buffer,
-        "accelX,"
-        "accelY,"
-        "accelZ,"
-        "gyroX,"
-        "gyroY,"
-        "gyroZ,"
-        "magnetoX,"
-        "magnetoY,"
-        "magnetoZ,"
-        "pressure,"
-        "temperature(100C),"
-        "combustionChamberPressure(1000psi),"
-        "oxidizerTankPressure(1000psi),"
-        "GPS_time,"
-        "GPS_latitude_degrees,"
-        "GPS_latitude_minutes,"
-        "GPS_longitude_degrees,"
-        "GPS_longitude_minutes,"
-        "GPS_altitude,"
-        "currentFlightPhase,"
-        "elapsedTime(ms),"
-        "softwareVersion\n"
-    );
+    char buffer[LOG_ENTRY_MAX_LENGTH + 1];
 
     if (f_mount(&fatfs, "SD:", 1) == FR_OK)
     {
-        if (f_open(&file, "SD:AvionicsData1.csv", FA_OPEN_EXISTING) == FR_NO_FILE)
+        uint32_t index;
+
+        if (createNextLogFile(&index))
         {
-            f_open(&file, "SD:AvionicsData1.csv", FA_CREATE_NEW | FA_READ | FA_WRITE);
-            f_puts(buffer, &file);
-            f_close(&file);
+            HAL_GPIO_WritePin(LED1_GPIO_Port, LED1_Pin, 1);
         }
-        else
+
+        sprintf(taskStatsFileName, "SD:AvionicsTasks%" PRIu32 ".csv", index);
+        sprintf(memoryStatsFileName, "SD:AvionicsMemory%" PRIu32 ".csv", index);
+        sprintf(sensorScheduleFileName, "SD:AvionicsSchedule%" PRIu32 ".csv", index);
+        sprintf(isrStatsFileName, "SD:AvionicsIsr%" PRIu32 ".csv", index);
+#if TRACE && !TRACE_TELEMETRY
+        sprintf(traceFileName, "SD:AvionicsTrace%" PRIu32 ".bin", index);
+#endif
+#if COMPRESSED_FLIGHT_LOG
+        sprintf(streamFileName, "SD:AvionicsData%" PRIu32 ".avl", index);
+        sprintf(streamStatsFileName, "SD:AvionicsStream%" PRIu32 ".csv", index);
+        logStreamInit(&logStreamEncoder);
+#endif
+
+        if (f_open(&statsFile, taskStatsFileName, FA_CREATE_NEW | FA_WRITE) == FR_OK)
         {
-            uint8_t fileExists = 1;
+            f_puts(TASK_STATS_LOG_HEADER, &statsFile);
+            f_close(&statsFile);
+        }
 
-            for (uint8_t index = 2; fileExists; index++)
-            {
-                sprintf(fileName, "SD:AvionicsData%i.csv", index);
+        if (f_open(&statsFile, memoryStatsFileName, FA_CREATE_NEW | FA_WRITE) == FR_OK)
+        {
+            f_puts(MEMORY_STATS_LOG_HEADER, &statsFile);
+            f_close(&statsFile);
+        }
 
-                if (f_open(&file, fileName, FA_OPEN_EXISTING) == FR_NO_FILE)
-                {
-                    f_open(&file, fileName, FA_CREATE_NEW | FA_READ | FA_WRITE);
-                    HAL_GPIO_WritePin(LED1_GPIO_Port, LED1_Pin, 1);
+        if (f_open(&statsFile, sensorScheduleFileName, FA_CREATE_NEW | FA_WRITE) == FR_OK)
+        {
+            f_puts(SENSOR_SCHEDULE_LOG_HEADER, &statsFile);
+            f_close(&statsFile);
+        }
 
-                    if (f_size(&file) == 0)
-                    {
-                        f_puts(buffer, &file);
-                    }
+        if (f_open(&statsFile, isrStatsFileName, FA_CREATE_NEW | FA_WRITE) == FR_OK)
+        {
+            f_puts(ISR_STATS_LOG_HEADER, &statsFile);
+            f_close(&statsFile);
+        }
 
-                    f_close(&file);
-                    fileExists = 0;
-                }
-            }
+#if TRACE && !TRACE_TELEMETRY
+
+        if (f_open(&statsFile, traceFileName, FA_CREATE_NEW | FA_WRITE) == FR_OK)
+        {
+            f_close(&statsFile);
         }
 
+#endif
+
+#if MEMORY_BENCHMARK
+        logMemoryBenchmark(index);
+#endif
+
         f_mount(NULL, "SD:", 1);
         HAL_GPIO_WritePin(LED1_GPIO_Port, LED1_Pin, 0);
     }
@@ -275,6 +942,11 @@ void logDataTask(void const* arg)
     {
         switch (getCurrentFlightPhase())
         {
+            case PRELAUNCH:
+            case ARM:
+                padRingLogToSdRoutine(data, buffer);
+                break;
+
             case BURN:
             case COAST:
             case DROGUE_DESCENT:
@@ -0,0 +1,137 @@
+/**
+  ******************************************************************************
+  * File Name          : LogFormat.c
+  * Description        : Formats log records as CSV lines without going through
+  *                      printf. Output is byte for byte what one sprintf of
+  *                      the fields produces, with %ld, and %lu for the GPS
+  *                      time and the sample times. Tools/LogFormatBench
+  *                      checks it and times both.
+  ******************************************************************************
+*/
+
+#include "LogFormat.h"
+
+const char LOG_FILE_HEADER[] =
+    "accelX,"
+    "accelY,"
+    "accelZ,"
+    "gyroX,"
+    "gyroY,"
+    "gyroZ,"
+    "magnetoX,"
+    "magnetoY,"
+    "magnetoZ,"
+    "pressure,"
+    "temperature(100C),"
+    "combustionChamberPressure(1000psi),"
+    "oxidizerTankPressure(1000psi),"
+    "GPS_time,"
+    "GPS_latitude_degrees,"
+    "GPS_latitude_minutes,"
+    "GPS_longitude_degrees,"
+    "GPS_longitude_minutes,"
+    "GPS_altitude,"
+    "currentFlightPhase,"
+    "elapsedTime(ms),"
+    "softwareVersion,"
+    "imuSampleTime(us),"
+    "barometerSampleTime(us),"
+    "combustionChamberSampleTime(us),"
+    "oxidizerTankSampleTime(us),"
+    "gpsSampleTime(us),"
+    "tilt(mdeg),"
+    "angularRate(mdps)\n";
+
+static const char DIGIT_PAIRS[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/**
+ * Writes the decimal digits of value to out, two digits per division.
+ *
+ * @return  Pointer to the byte after the last digit written.
+ */
+static char* appendUint32(char* out, uint32_t value)
+{
+    char digits[10];
+    char* end = digits + sizeof(digits);
+    char* p = end;
+
+    while (value >= 100)
+    {
+        uint32_t pair = (value % 100) * 2;
+        value /= 100;
+        *--p = DIGIT_PAIRS[pair + 1];
+        *--p = DIGIT_PAIRS[pair];
+    }
+
+    if (value >= 10)
+    {
+        *--p = DIGIT_PAIRS[value * 2 + 1];
+        *--p = DIGIT_PAIRS[value * 2];
+    }
+    else
+    {
+        *--p = (char) ('0' + value);
+    }
+
+    while (p < end)
+    {
+        *out++ = *p++;
+    }
+
+    return out;
+}
+
+static char* appendInt32(char* out, int32_t value)
+{
+    uint32_t magnitude = (uint32_t) value;
+
+    if (value < 0)
+    {
+        *out++ = '-';
+        magnitude = 0u - magnitude;
+    }
+
+    return appendUint32(out, magnitude);
+}
+
+/**
+ * Formats a log record as one comma separated line ending in a newline.
+ *
+ * @param   entry   The record to format.
+ * @param   buffer  Destination, at least LOG_ENTRY_MAX_LENGTH + 1 bytes.
+ * @return          Length of the line, not counting the null terminator.
+ */
+int formatLogEntry(const LogEntry* entry, char* buffer)
+{
+    char* out = buffer;
+
+    for (int i = 0; i < LOG_ENTRY_FIELD_COUNT; i++)
+    {
+        if (i == LOG_FIELD_GPS_TIME || (i >= LOG_FIELD_IMU_SAMPLE_TIME && i <= LOG_FIELD_GPS_SAMPLE_TIME))
+        {
+            out = appendUint32(out, (uint32_t) entry->fields_[i]);
+        }
+        else
+        {
+            out = appendInt32(out, entry->fields_[i]);
+        }
+
+        *out++ = ',';
+    }
+
+    // Replace the trailing separator with the end of line
+    out[-1] = '\n';
+    *out = '\0';
+
+    return out - buffer;
+}
@@ -0,0 +1,174 @@
+/**
+  ******************************************************************************
+  * File Name          : MemoryBenchmark.c
+  * Description        : Cycle counts of the estimator and logger paths with
+  *                      their data in SRAM and in CCM RAM.
+  ******************************************************************************
+*/
+
+#include <stdio.h>
+
+#include "stm32f4xx.h"
+#include "stm32f4xx_hal_conf.h"
+#include "cmsis_os.h"
+
+#include "MemoryBenchmark.h"
+#include "MemorySections.h"
+#include "ParachutesControl.h"
+#include "AltitudeFilter.h"
+#include "LogFormat.h"
+#include "LogCompression.h"
+
+#if MEMORY_BENCHMARK
+
+#define ESTIMATOR_STEPS 100
+#define LOG_RECORDS 40
+
+typedef void (*Workload)(void* memory);
+
+typedef struct
+{
+    struct KalmanStateVector state_;
+    BarometricReference barometer_;
+} EstimatorMemory;
+
+typedef struct
+{
+    LogEntry    entry_;
+    char        line_[LOG_ENTRY_MAX_LENGTH + 1];
+} LogFormatMemory;
+
+typedef struct
+{
+    LogEntry            entry_;
+    LogStreamEncoder    encoder_;
+} LogCompressionMemory;
+
+const char MEMORY_BENCHMARK_LOG_HEADER[] =
+    "benchmark,"
+    "sramCycles,"
+    "ccmCycles,"
+    "ccmSpeedup(permille)\n";
+
+static EstimatorMemory sramEstimator;
+static EstimatorMemory ccmEstimator CCM_BSS;
+static LogFormatMemory sramLogFormat;
+static LogFormatMemory ccmLogFormat CCM_BSS;
+static LogCompressionMemory sramLogCompression;
+static LogCompressionMemory ccmLogCompression CCM_BSS;
+
+/**
+ * Sensor values that change every record like a flight does, so the log
+ * paths see realistic digit counts and deltas.
+ */
+static void fillLogEntry(LogEntry* entry, int record)
+{
+    for (int i = 0; i < LOG_ENTRY_FIELD_COUNT; i++)
+    {
+        entry->fields_[i] = (i + 1) * 1013 + record * (i % 5 - 2) * 37;
+    }
+
+    entry->fields_[LOG_FIELD_ELAPSED_TIME] = record * 200;
+}
+
+static void runEstimator(void* memory)
+{
+    EstimatorMemory* estimator = (EstimatorMemory*) memory;
+
+    barometricReferenceInit(&estimator->barometer_, BAROMETRIC_REFERENCE_PRESSURE);
+
+    for (int step = 0; step < ESTIMATOR_STEPS; step++)
+    {
+        estimator->state_ = filterSensors(estimator->state_, &estimator->barometer_, 1000 + step, 85000 - step * 10, 50);
+    }
+}
+
+static void runLogFormat(void* memory)
+{
+    LogFormatMemory* logFormat = (LogFormatMemory*) memory;
+
+    for (int record = 0; record < LOG_RECORDS; record++)
+    {
+        fillLogEntry(&logFormat->entry_, record);
+        formatLogEntry(&logFormat->entry_, logFormat->line_);
+    }
+}
+
+static void runLogCompression(void* memory)
+{
+    LogCompressionMemory* logCompression = (LogCompressionMemory*) memory;
+
+    logStreamInit(&logCompression->encoder_);
+
+    for (int record = 0; record < LOG_RECORDS; record++)
+    {
+        fillLogEntry(&logCompression->entry_, record);
+
+        if (logStreamAppend(&logCompression->encoder_, &logCompression->entry_))
+        {
+            logStreamFinishBlock(&logCompression->encoder_);
+        }
+    }
+
+    logStreamFinishBlock(&logCompression->encoder_);
+}
+
+static uint32_t measure(Workload workload, void* memory)
+{
+    uint32_t fastest = UINT32_MAX;
+
+    for (int i = 0; i < MEMORY_BENCHMARK_REPEATS; i++)
+    {
+        vTaskSuspendAll();
+        uint32_t start = DWT->CYCCNT;
+        workload(memory);
+        uint32_t cycles = DWT->CYCCNT - start;
+        xTaskResumeAll();
+
+        if (cycles < fastest)
+        {
+            fastest = cycles;
+        }
+    }
+
+    return fastest;
+}
+
+int memoryBenchmarkRun(MemoryBenchmarkResult* results)
+{
+    results[0].name_ = "estimator";
+    results[0].sramCycles_ = measure(runEstimator, &sramEstimator);
+    results[0].ccmCycles_ = measure(runEstimator, &ccmEstimator);
+
+    results[1].name_ = "logFormat";
+    results[1].sramCycles_ = measure(runLogFormat, &sramLogFormat);
+    results[1].ccmCycles_ = measure(runLogFormat, &ccmLogFormat);
+
+    results[2].name_ = "logCompression";
+    results[2].sramCycles_ = measure(runLogCompression, &sramLogCompression);
+    results[2].ccmCycles_ = measure(runLogCompression, &ccmLogCompression);
+
+    return MEMORY_BENCHMARK_COUNT;
+}
+
+/**
+ * Formats one result as a line of the benchmark log. The speedup is SRAM
+ * cycles over CCM cycles, 1000 when both are the same.
+ *
+ * @return  Number of characters written, at most MEMORY_BENCHMARK_LOG_ENTRY_MAX_LENGTH.
+ */
+int formatMemoryBenchmarkResult(const MemoryBenchmarkResult* result, char* buffer)
+{
+    uint32_t speedup = result->ccmCycles_ ? (uint32_t) ((uint64_t) result->sramCycles_ * 1000 / result->ccmCycles_) : 0;
+
+    return sprintf(
+               buffer,
+               "%s,%lu,%lu,%lu\n",
+               result->name_,
+               (unsigned long) result->sramCycles_,
+               (unsigned long) result->ccmCycles_,
+               (unsigned long) speedup
+           );
+}
+
+#endif
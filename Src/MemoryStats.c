@@ -0,0 +1,119 @@
+/**
+  ******************************************************************************
+  * File Name          : MemoryStats.c
+  * Description        : Stack high water marks with recommended stack sizes,
+  *                      FreeRTOS and newlib heap usage.
+  ******************************************************************************
+*/
+
+#include <stdio.h>
+
+#include "stm32f4xx.h"
+#include "stm32f4xx_hal_conf.h"
+#include "cmsis_os.h"
+
+#include "MemoryStats.h"
+
+typedef struct
+{
+    TaskHandle_t    thread_;
+    uint32_t        stackWords_;
+} MemoryStatsTask;
+
+const char MEMORY_STATS_LOG_HEADER[] =
+    "elapsedTime(ms),"
+    "currentFlightPhase,"
+    "task,"
+    "stack(words),"
+    "minFreeStack(words),"
+    "recommendedStack(words),"
+    "rtosHeapFree(bytes),"
+    "rtosHeapMinFree(bytes),"
+    "newlibHeap(bytes),"
+    "sbrkFailures\n";
+
+static MemoryStatsTask memoryStatsTasks[MEMORY_STATS_MAX_TASKS];
+static uint8_t taskCount = 0;
+
+/**
+ * Smallest stack that keeps a margin over the deepest use seen so far.
+ * Only as good as the code paths the task has been through, so read it
+ * after a full flight.
+ */
+static uint32_t recommendStackWords(uint32_t stackWords, uint32_t minFreeWords)
+{
+    uint32_t usedWords = stackWords - minFreeWords;
+    uint32_t words = usedWords + usedWords / MEMORY_STATS_MARGIN_DIVISOR + MEMORY_STATS_MARGIN_WORDS;
+
+    return (words + MEMORY_STATS_STACK_ROUNDING_WORDS - 1) / MEMORY_STATS_STACK_ROUNDING_WORDS * MEMORY_STATS_STACK_ROUNDING_WORDS;
+}
+
+void memoryStatsRegister(void* thread, uint32_t stackWords)
+{
+    if (thread == NULL || taskCount == MEMORY_STATS_MAX_TASKS)
+    {
+        return;
+    }
+
+    memoryStatsTasks[taskCount].thread_ = (TaskHandle_t) thread;
+    memoryStatsTasks[taskCount].stackWords_ = stackWords;
+    taskCount++;
+}
+
+/**
+ * Reads the high water marks of every registered task and the heap levels.
+ * Each stack scan is proportional to the free space left, a few us per task.
+ */
+void memoryStatsRead(MemoryStatsSnapshot* snapshot)
+{
+    snapshot->timeMs_ = HAL_GetTick();
+#if (configSUPPORT_DYNAMIC_ALLOCATION == 1)
+    snapshot->rtosHeapSize_ = configTOTAL_HEAP_SIZE;
+    snapshot->rtosHeapFree_ = xPortGetFreeHeapSize();
+    snapshot->rtosHeapMinFree_ = xPortGetMinimumEverFreeHeapSize();
+#else
+    snapshot->rtosHeapSize_ = 0;
+    snapshot->rtosHeapFree_ = 0;
+    snapshot->rtosHeapMinFree_ = 0;
+#endif
+    snapshot->newlibHeapSize_ = sbrkHeapSize();
+    snapshot->sbrkFailures_ = sbrkFailureCount();
+    snapshot->taskCount_ = taskCount;
+
+    for (int i = 0; i < taskCount; i++)
+    {
+        const MemoryStatsTask* task = &memoryStatsTasks[i];
+        MemoryStatsEntry* entry = &snapshot->tasks_[i];
+        uint32_t minFreeWords = uxTaskGetStackHighWaterMark(task->thread_);
+
+        entry->name_ = pcTaskGetName(task->thread_);
+        entry->stackWords_ = task->stackWords_;
+        entry->minFreeWords_ = minFreeWords;
+        entry->recommendedWords_ = recommendStackWords(task->stackWords_, minFreeWords);
+    }
+}
+
+/**
+ * Formats one task of a snapshot as a line of the memory stats log.
+ *
+ * @return  Number of characters written, at most MEMORY_STATS_LOG_ENTRY_MAX_LENGTH.
+ */
+int formatMemoryStatsEntry(const MemoryStatsSnapshot* snapshot, int task, uint8_t flightPhase, char* buffer)
+{
+    const MemoryStatsEntry* entry = &snapshot->tasks_[task];
+
+    return sprintf(
+               buffer,
+               "%lu,%u,%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n",
+               (unsigned long) snapshot->timeMs_,
+               flightPhase,
+               entry->name_,
+               (unsigned long) entry->stackWords_,
+               (unsigned long) entry->minFreeWords_,
+               (unsigned long) entry->recommendedWords_,
+               (unsigned long) snapshot->rtosHeapFree_,
+               (unsigned long) snapshot->rtosHeapMinFree_,
+               (unsigned long) snapshot->newlibHeapSize_,
+               (unsigned long) snapshot->sbrkFailures_
+           );
+}
@@ -6,6 +6,7 @@
 #include "FlightPhase.h"
 #include "Data.h"
 #include "ValveControl.h"
+#include "TaskStats.h"
 
 static const int MONITOR_FOR_EMERGENCY_SHUTOFF_PERIOD = 1000;
 
@@ -21,7 +22,7 @@ void monitorForEmergencyShutoffTask(void const* arg)
 
     for (;;)
     {
-        osDelayUntil(&prevWakeTime, MONITOR_FOR_EMERGENCY_SHUTOFF_PERIOD);
+        taskStatsDelayUntil(&prevWakeTime, MONITOR_FOR_EMERGENCY_SHUTOFF_PERIOD);
 
         phase = getCurrentFlightPhase();
 
@@ -31,7 +32,7 @@ void monitorForEmergencyShutoffTask(void const* arg)
         //     osMutexRelease(data->mutex_);
         // }
 
-        switch (getCurrentFlightPhase())
+        switch (phase)
         {
             // Fallthrough because umbilical is still supposed to be connected during these flight phases.
             // This means that an ABORT command can be received or a communication error could happen.
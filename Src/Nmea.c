@@ -0,0 +1,591 @@
+/**
+  ******************************************************************************
+  * File Name          : Nmea.c
+  * Description        : Character at a time NMEA 0183 parser with fixed
+  *                      point field decoding. Also built on the host by the
+  *                      NMEA fuzz and benchmark tool.
+  ******************************************************************************
+*/
+
+#include <string.h>
+
+#include "Nmea.h"
+
+#define STATE_IDLE 0
+#define STATE_FIELDS 1
+#define STATE_CHECKSUM_HIGH 2
+#define STATE_CHECKSUM_LOW 3
+#define STATE_SKIP 4 // In a sentence that is not decoded
+
+#define MINUTE_SCALE 100000 // NmeaCoordinate minutes_
+#define DEGREE_SCALE (60 * MINUTE_SCALE)
+// Integer digits kept by decodeDecimal, so the scaled value fits in 64 bits
+#define MAX_INTEGER_PART 100000000000LL
+
+/* Field decoders --------------------------------------------------------------
+ * Each takes a non empty, NUL terminated field and returns 0 if the field is
+ * malformed or out of range.
+ */
+
+static int isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+/**
+ * [-]digits[.digits] scaled by 10^decimals. Fraction digits beyond that are
+ * truncated, as the receivers round when they format the field.
+ */
+static int decodeDecimal(const char* text, int decimals, int64_t* value)
+{
+    int64_t result = 0;
+    int negative = 0;
+    int fraction = -1; // Fraction digits kept, -1 before the decimal point
+
+    if (*text == '-')
+    {
+        negative = 1;
+        text++;
+    }
+
+    if (*text == 0)
+    {
+        return 0;
+    }
+
+    for (; *text; text++)
+    {
+        if (*text == '.')
+        {
+            if (fraction >= 0)
+            {
+                return 0;
+            }
+
+            fraction = 0;
+        }
+        else if (!isDigit(*text))
+        {
+            return 0;
+        }
+        else if (fraction < 0)
+        {
+            result = result * 10 + (*text - '0');
+
+            if (result > MAX_INTEGER_PART)
+            {
+                return 0;
+            }
+        }
+        else if (fraction < decimals)
+        {
+            result = result * 10 + (*text - '0');
+            fraction++;
+        }
+    }
+
+    for (int i = fraction < 0 ? 0 : fraction; i < decimals; i++)
+    {
+        result *= 10;
+    }
+
+    if (result > INT32_MAX)
+    {
+        return 0;
+    }
+
+    *value = negative ? -result : result;
+    return 1;
+}
+
+static int decodeUnsigned(const char* text, int decimals, uint32_t max, uint32_t* value)
+{
+    int64_t decimal;
+
+    if (!decodeDecimal(text, decimals, &decimal) || decimal < 0 || decimal > max)
+    {
+        return 0;
+    }
+
+    *value = (uint32_t) decimal;
+    return 1;
+}
+
+static int decodeUint8(const char* text, uint8_t max, uint8_t* value)
+{
+    uint32_t decoded;
+
+    if (!decodeUnsigned(text, 0, max, &decoded))
+    {
+        return 0;
+    }
+
+    *value = (uint8_t) decoded;
+    return 1;
+}
+
+static int decodeUint16(const char* text, int decimals, uint16_t* value)
+{
+    uint32_t decoded;
+
+    if (!decodeUnsigned(text, decimals, UINT16_MAX, &decoded))
+    {
+        return 0;
+    }
+
+    *value = (uint16_t) decoded;
+    return 1;
+}
+
+static int decodeSigned(const char* text, int decimals, int32_t* value)
+{
+    int64_t decimal;
+
+    if (!decodeDecimal(text, decimals, &decimal))
+    {
+        return 0;
+    }
+
+    *value = (int32_t) decimal;
+    return 1;
+}
+
+// UTC hhmmss.ss
+static int decodeTime(const char* text, uint32_t* time)
+{
+    return decodeUnsigned(text, 2, 23596099, time);
+}
+
+/**
+ * One of the characters of allowed.
+ */
+static int decodeChar(const char* text, const char* allowed, char* value)
+{
+    if (text[1] != 0 || strchr(allowed, text[0]) == NULL)
+    {
+        return 0;
+    }
+
+    *value = text[0];
+    return 1;
+}
+
+/**
+ * ddmm.mmmmm or dddmm.mmmmm, without the sign until the hemisphere field.
+ */
+static int decodeCoordinate(const char* text, int32_t maxDegrees, NmeaCoordinate* coordinate)
+{
+    int64_t minutes;
+
+    if (!decodeDecimal(text, 5, &minutes) || minutes < 0)
+    {
+        return 0;
+    }
+
+    // Degrees are the digits above the two of the whole minutes
+    int32_t degrees = (int32_t) (minutes / (100 * MINUTE_SCALE));
+    int32_t remainder = (int32_t) (minutes % (100 * MINUTE_SCALE));
+
+    if (remainder >= DEGREE_SCALE || degrees > maxDegrees || (degrees == maxDegrees && remainder != 0))
+    {
+        return 0;
+    }
+
+    coordinate->degrees_ = degrees;
+    coordinate->minutes_ = remainder;
+    return 1;
+}
+
+static int decodeHemisphere(const char* text, char positive, char negative, NmeaCoordinate* coordinate)
+{
+    if (text[1] != 0 || (text[0] != positive && text[0] != negative))
+    {
+        return 0;
+    }
+
+    if (text[0] == negative)
+    {
+        coordinate->degrees_ = -coordinate->degrees_;
+        coordinate->minutes_ = -coordinate->minutes_;
+    }
+
+    return 1;
+}
+
+static int decodeUnit(const char* text, char unit)
+{
+    return text[0] == unit && text[1] == 0;
+}
+
+/* Sentences -----------------------------------------------------------------*/
+
+// $--GGA,hhmmss.ss,llll.ll,a,yyyyy.yy,a,x,xx,x.x,x.x,M,x.x,M,x.x,xxxx
+static int decodeGga(NmeaGga* gga, uint8_t field, const char* text)
+{
+    switch (field)
+    {
+        case 1:
+            return decodeTime(text, &gga->time_);
+
+        case 2:
+            return decodeCoordinate(text, 90, &gga->latitude_);
+
+        case 3:
+            return decodeHemisphere(text, 'N', 'S', &gga->latitude_);
+
+        case 4:
+            return decodeCoordinate(text, 180, &gga->longitude_);
+
+        case 5:
+            return decodeHemisphere(text, 'E', 'W', &gga->longitude_);
+
+        case 6:
+            return decodeUint8(text, 9, &gga->quality_);
+
+        case 7:
+            return decodeUint8(text, 99, &gga->satellites_);
+
+        case 8:
+            return decodeUint16(text, 2, &gga->hdop_);
+
+        case 9:
+            return decodeSigned(text, 1, &gga->altitude_);
+
+        case 10:
+        case 12:
+            return decodeUnit(text, 'M');
+
+        case 11:
+            return decodeSigned(text, 1, &gga->geoidSeparation_);
+
+        default:
+            // Age of the differential corrections and the station id
+            return 1;
+    }
+}
+
+// $--RMC,hhmmss.ss,A,llll.ll,a,yyyyy.yy,a,x.x,x.x,ddmmyy,x.x,a,m
+static int decodeRmc(NmeaRmc* rmc, uint8_t field, const char* text)
+{
+    char status;
+
+    switch (field)
+    {
+        case 1:
+            return decodeTime(text, &rmc->time_);
+
+        case 2:
+            if (!decodeChar(text, "AV", &status))
+            {
+                return 0;
+            }
+
+            rmc->valid_ = status == 'A';
+            return 1;
+
+        case 3:
+            return decodeCoordinate(text, 90, &rmc->latitude_);
+
+        case 4:
+            return decodeHemisphere(text, 'N', 'S', &rmc->latitude_);
+
+        case 5:
+            return decodeCoordinate(text, 180, &rmc->longitude_);
+
+        case 6:
+            return decodeHemisphere(text, 'E', 'W', &rmc->longitude_);
+
+        case 7:
+            return decodeUnsigned(text, 2, UINT32_MAX, &rmc->speed_);
+
+        case 8:
+            return decodeUnsigned(text, 2, 36000, &rmc->course_);
+
+        case 9:
+            return decodeUnsigned(text, 0, 311299, &rmc->date_);
+
+        case 12:
+            return decodeChar(text, "ADEFMNPRS", &rmc->mode_);
+
+        default:
+            // Magnetic variation and, from NMEA 4.1, the navigational status
+            return 1;
+    }
+}
+
+// $--VTG,x.x,T,x.x,M,x.x,N,x.x,K,m
+static int decodeVtg(NmeaVtg* vtg, uint8_t field, const char* text)
+{
+    switch (field)
+    {
+        case 1:
+            return decodeUnsigned(text, 2, 36000, &vtg->courseTrue_);
+
+        case 2:
+            return decodeUnit(text, 'T');
+
+        case 3:
+            return decodeUnsigned(text, 2, 36000, &vtg->courseMagnetic_);
+
+        case 4:
+            return decodeUnit(text, 'M');
+
+        case 5:
+            return decodeUnsigned(text, 2, UINT32_MAX, &vtg->speedKnots_);
+
+        case 6:
+            return decodeUnit(text, 'N');
+
+        case 7:
+            return decodeUnsigned(text, 2, UINT32_MAX, &vtg->speedKmh_);
+
+        case 8:
+            return decodeUnit(text, 'K');
+
+        case 9:
+            return decodeChar(text, "ADEFMNPRS", &vtg->mode_);
+
+        default:
+            return 1;
+    }
+}
+
+// $--GSA,a,x,xx,xx,xx,xx,xx,xx,xx,xx,xx,xx,xx,xx,x.x,x.x,x.x
+static int decodeGsa(NmeaGsa* gsa, uint8_t field, const char* text)
+{
+    if (field >= 3 && field < 3 + NMEA_GSA_SATELLITES)
+    {
+        return decodeUint8(text, UINT8_MAX, &gsa->satellites_[gsa->satelliteCount_++]);
+    }
+
+    switch (field)
+    {
+        case 1:
+            return decodeChar(text, "MA", &gsa->selection_);
+
+        case 2:
+            return decodeUint8(text, 3, &gsa->fixType_) && gsa->fixType_ != 0;
+
+        case 15:
+            return decodeUint16(text, 2, &gsa->pdop_);
+
+        case 16:
+            return decodeUint16(text, 2, &gsa->hdop_);
+
+        case 17:
+            return decodeUint16(text, 2, &gsa->vdop_);
+
+        default:
+            // The system id from NMEA 4.1
+            return 1;
+    }
+}
+
+/**
+ * Talker and sentence formatter, e.g. GNGGA.
+ */
+static int decodeAddress(NmeaParser* parser)
+{
+    static const struct
+    {
+        char                formatter_[4];
+        NmeaSentenceType    type_;
+    } SENTENCES[] =
+    {
+        {"GGA", NMEA_GGA},
+        {"RMC", NMEA_RMC},
+        {"VTG", NMEA_VTG},
+        {"GSA", NMEA_GSA},
+    };
+
+    const char* text = parser->text_;
+
+    if (parser->fieldLength_ != 5 || text[0] < 'A' || text[0] > 'Z' || text[1] < 'A' || text[1] > 'Z')
+    {
+        return 0;
+    }
+
+    for (unsigned i = 0; i < sizeof(SENTENCES) / sizeof(SENTENCES[0]); i++)
+    {
+        if (memcmp(&text[2], SENTENCES[i].formatter_, 3) == 0)
+        {
+            parser->sentence_.type_ = SENTENCES[i].type_;
+            parser->sentence_.talker_[0] = text[0];
+            parser->sentence_.talker_[1] = text[1];
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int decodeField(NmeaParser* parser)
+{
+    NmeaSentence* sentence = &parser->sentence_;
+
+    if (parser->fieldLength_ == 0)
+    {
+        return 1;
+    }
+
+    switch (sentence->type_)
+    {
+        case NMEA_GGA:
+            return decodeGga(&sentence->fix_.gga_, parser->field_, parser->text_);
+
+        case NMEA_RMC:
+            return decodeRmc(&sentence->fix_.rmc_, parser->field_, parser->text_);
+
+        case NMEA_VTG:
+            return decodeVtg(&sentence->fix_.vtg_, parser->field_, parser->text_);
+
+        case NMEA_GSA:
+            return decodeGsa(&sentence->fix_.gsa_, parser->field_, parser->text_);
+
+        default:
+            return 0;
+    }
+}
+
+/* Parser --------------------------------------------------------------------*/
+
+static int hexValue(char c)
+{
+    if (isDigit(c))
+    {
+        return c - '0';
+    }
+
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+
+    return -1;
+}
+
+static NmeaResult fail(NmeaParser* parser)
+{
+    parser->state_ = STATE_IDLE;
+    return NMEA_FORMAT_ERROR;
+}
+
+void nmeaInit(NmeaParser* parser)
+{
+    memset(parser, 0, sizeof(*parser));
+    parser->state_ = STATE_IDLE;
+}
+
+NmeaResult nmeaParse(NmeaParser* parser, char c, NmeaSentence* sentence)
+{
+    if (c == '$')
+    {
+        // A sentence still open was cut short
+        NmeaResult result = (parser->state_ == STATE_IDLE || parser->state_ == STATE_SKIP) ? NMEA_PENDING : NMEA_FORMAT_ERROR;
+
+        memset(&parser->sentence_, 0, sizeof(parser->sentence_));
+        parser->state_ = STATE_FIELDS;
+        parser->length_ = 1;
+        parser->field_ = 0;
+        parser->fieldLength_ = 0;
+        parser->checksum_ = 0;
+        return result;
+    }
+
+    if (parser->state_ == STATE_IDLE || parser->state_ == STATE_SKIP)
+    {
+        return NMEA_PENDING;
+    }
+
+    // Up to the checksum, the end of line takes the last two characters
+    if (++parser->length_ > NMEA_MAX_LENGTH - 2)
+    {
+        return fail(parser);
+    }
+
+    int hex;
+
+    switch (parser->state_)
+    {
+        case STATE_FIELDS:
+            if (c == ',' || c == '*')
+            {
+                parser->text_[parser->fieldLength_] = 0;
+
+                if (c == ',')
+                {
+                    parser->checksum_ ^= c;
+                }
+
+                if (parser->field_ == 0)
+                {
+                    if (!decodeAddress(parser))
+                    {
+                        parser->state_ = STATE_SKIP;
+                        return NMEA_UNSUPPORTED;
+                    }
+                }
+                else if (!decodeField(parser))
+                {
+                    return fail(parser);
+                }
+
+                parser->field_++;
+                parser->fieldLength_ = 0;
+
+                if (c == '*')
+                {
+                    parser->state_ = STATE_CHECKSUM_HIGH;
+                }
+
+                return NMEA_PENDING;
+            }
+
+            // Includes an end of line before the checksum
+            if (c < 0x20 || c > 0x7E || parser->fieldLength_ == NMEA_MAX_FIELD_LENGTH)
+            {
+                return fail(parser);
+            }
+
+            parser->checksum_ ^= c;
+            parser->text_[parser->fieldLength_++] = c;
+            return NMEA_PENDING;
+
+        case STATE_CHECKSUM_HIGH:
+            hex = hexValue(c);
+
+            if (hex < 0)
+            {
+                return fail(parser);
+            }
+
+            parser->receivedChecksum_ = (uint8_t) (hex << 4);
+            parser->state_ = STATE_CHECKSUM_LOW;
+            return NMEA_PENDING;
+
+        case STATE_CHECKSUM_LOW:
+            hex = hexValue(c);
+            parser->state_ = STATE_IDLE;
+
+            if (hex < 0)
+            {
+                return NMEA_FORMAT_ERROR;
+            }
+
+            if ((parser->receivedChecksum_ | hex) != parser->checksum_)
+            {
+                return NMEA_CHECKSUM_ERROR;
+            }
+
+            *sentence = parser->sentence_;
+            return NMEA_OK;
+
+        default:
+            return fail(parser);
+    }
+}
@@ -1,18 +1,19 @@
-#include <math.h>
-
 #include "stm32f4xx.h"
 #include "stm32f4xx_hal_conf.h"
 #include "cmsis_os.h"
 
 #include "ParachutesControl.h"
+#include "AltitudeFilter.h"
+#include "ApogeePredictor.h"
 #include "FlightPhase.h"
 #include "Data.h"
+#include "TaskStats.h"
+#include "MemorySections.h"
+#include "Timebase.h"
+#include "Trace.h"
 
 #define SPACE_PORT_AMERICA_ALTITUDE_ABOVE_SEA_LEVEL (1401) // metres
 
-// Pressure at spaceport america in 100*millibars on May 27, 2018
-static const int SEA_LEVEL_PRESSURE = 101421.93903699999; //TODO: THIS NEEDS TO BE UPDATED AND RECORDED ON LAUNCH DAY
-
 // Units in meters. Equivalent of 1500 ft + altitude of spaceport america.
 static const int MAIN_DEPLOYMENT_ALTITUDE = 457 + SPACE_PORT_AMERICA_ALTITUDE_ABOVE_SEA_LEVEL;
 
@@ -20,45 +21,43 @@ static const int MONITOR_FOR_PARACHUTES_PERIOD = 50;
 static const int KALMAN_FILTER_DROGUE_TIMEOUT = 2 * 60 * 1000; // 2 minutes
 static const int KALMAN_FILTER_MAIN_TIMEOUT = 10 * 60 * 1000; // 10 minutes
 static const int PARACHUTE_PULSE_DURATION = 2 * 1000; // 2 seconds
-static const double KALMAN_GAIN[][2] =
-{
-    {0.105553059, 0.109271566},
-    {0.0361533034, 0.0661198847},
-    {0.000273178915, 0.618030079}
-};
+static const double NMEA_ALTITUDE_ACCURACY = 10.0; // m, GGA does not report it
+static const double PAD_PRESSURE_GAIN = 0.01; // Per period, 5 s time constant
+static const int PAD_CALIBRATION_PERIOD = 1000; // Each calibration takes a pow
 
-struct KalmanStateVector
-{
-    double altitude;
-    double velocity;
-    double acceleration;
-};
+static AltitudeFilter altitudeFilter CCM_BSS;
+static ApogeePredictor apogeePredictor CCM_BSS;
+static uint32_t lastGpsSampleTimeUs = 0;
+static int32_t filterAccel = 0; // Vertical specific force of the latest filter step, mg
+static volatile uint8_t drogueAlarmFired = 0; // Set by the timebase alarm
+static double padPressure = 0; // Averaged on the pad, 100*millibars, 0 before the first reading
 
-static struct KalmanStateVector kalmanFilterState;
-
-int32_t readAccel(AccelGyroMagnetismData* data)
+/**
+ * Reads the latest specific force along up, from the attitude filter.
+ *
+ * Params:
+ *   data - (AccelGyroMagnetismData*) IMU data
+ *   verticalAccel - (int32_t*) Set to the specific force along up, in mg
+ *   sampleTimeUs - (uint32_t*) Set to its sample time
+ *
+ * Returns:
+ *   - (int32_t) 1 if it was read, 0 if not.
+ */
+int32_t readAccel(AccelGyroMagnetismData* data, int32_t* verticalAccel, uint32_t* sampleTimeUs)
 {
     if (osMutexWait(data->mutex_, 0) != osOK)
     {
-        return -1;
+        return 0;
     }
 
-    int32_t accelX = data->accelX_;
-    int32_t accelY = data->accelY_;
-    int32_t accelZ = data->accelZ_;
+    *verticalAccel = data->verticalAccel_;
+    *sampleTimeUs = data->sampleTimeUs_;
     osMutexRelease(data->mutex_);
 
-    int32_t accelMagnitude =
-        sqrt(
-            accelX * accelX +
-            accelY * accelY +
-            accelZ * accelZ
-        );
-
-    return accelMagnitude;
+    return 1;
 }
 
-int32_t readPressure(BarometerData* data)
+int32_t readPressure(BarometerData* data, uint32_t* sampleTimeUs)
 {
     if (osMutexWait(data->mutex_, 0) != osOK)
     {
@@ -66,6 +65,7 @@ int32_t readPressure(BarometerData* data)
     }
 
     int32_t pressure = data->pressure_;
+    *sampleTimeUs = data->sampleTimeUs_;
     osMutexRelease(data->mutex_);
 
     return (int32_t)pressure;
@@ -74,71 +74,81 @@ int32_t readPressure(BarometerData* data)
 
 
 /**
- * Takes an old state vector and current state measurements and
- * converts them into a prediction of the rocket's current state.
+ * Reads the latest GPS fix, if one arrived since the last call.
  *
  * Params:
- *   oldState - (KalmanStateVector) Past altitude, velocity and acceleration
- *   currentAccel - (double) Measured acceleration
- *   currentAltitude - (double) Measured altitude
- *   dt - (double) Time since last step. In ms.
+ *   data - (GpsData*) GPS data
+ *   measurement - (GnssMeasurement*) Set to the fix, in the units of the filter
  *
  * Returns:
- *   newState - (KalmanStateVector) Current altitude, velocity and acceleration
+ *   - (int32_t) 1 if there is a new fix, 0 if not.
  */
-struct KalmanStateVector filterSensors(
-    struct KalmanStateVector oldState,
-    int32_t currentAccel,
-    int32_t currentPressure,
-    double dtMillis
-)
+int32_t readGps(GpsData* data, GnssMeasurement* measurement)
 {
-    struct KalmanStateVector newState;
-
-    double accelIn = (double) currentAccel / 1000 * 9.8; // Milli-g -> g -> m/s
-
-    // Convert from 100*millibars to m. This may or may not be right, depending on where you look. Needs testing
-    double altIn = (double) 44307.69396 * (1 - pow(currentPressure / SEA_LEVEL_PRESSURE, 0.190284));
-
-    // Convert from ms to s
-    double dt = dtMillis / 1000;
-
-
-    // Propagate old state using simple kinematics equations
-    newState.altitude = oldState.altitude + oldState.velocity * dt + 0.5 * dt * dt * oldState.acceleration;
-    newState.velocity = oldState.velocity + oldState.acceleration * dt;
-    newState.acceleration = oldState.acceleration;
+    if (osMutexWait(data->mutex_, 0) != osOK)
+    {
+        return 0;
+    }
 
-    // Calculate the difference between the new state and the measurements
-    double baroDifference = altIn - newState.altitude;
-    double accelDifference = accelIn - newState.acceleration;
+    int32_t newFix = data->fixQuality_ != 0 && data->sampleTimeUs_ != lastGpsSampleTimeUs;
 
-    // Minimize the chi2 error by means of the Kalman gain matrix
-    newState.altitude = newState.altitude + KALMAN_GAIN[0][0] * baroDifference + KALMAN_GAIN[0][1] * accelDifference;
-    newState.velocity = newState.velocity + KALMAN_GAIN[1][0] * baroDifference + KALMAN_GAIN[1][1] * accelDifference;
-    newState.acceleration = newState.velocity + KALMAN_GAIN[2][0] * baroDifference + KALMAN_GAIN[2][1] * accelDifference;
+    if (newFix)
+    {
+        // Only NAV-PVT reports the velocity and the accuracy
+        measurement->altitude_ = data->antennaAltitude_.altitude_ / 10.0;
+        measurement->velocity_ = -data->velocityDown_ / 1000.0;
+        measurement->hasVelocity_ = data->verticalAccuracy_ != 0;
+        measurement->accuracy_ = measurement->hasVelocity_ ? data->verticalAccuracy_ / 1000.0 : NMEA_ALTITUDE_ACCURACY;
+        measurement->sampleTimeUs_ = data->sampleTimeUs_;
+        lastGpsSampleTimeUs = data->sampleTimeUs_;
+    }
 
-    return newState;
+    osMutexRelease(data->mutex_);
+    return newFix;
 }
 
 /**
- * Takes the current state vector and determines if apogee has been reached.
- *
- * Params:
- *   state - (KalmanStateVector) Past altitude, velocity and acceleration
+ * Steps the altitude filter with the latest acceleration and pressure,
+ * then applies the GPS fix if a new one arrived.
  *
  * Returns:
- *   - (int32_t) 1 if apogee has been reached, 0 if not.
+ *   - (int32_t) 1 if the filter was stepped, 0 if the values could not be read.
  */
-int32_t detectApogee(struct KalmanStateVector state)
+static int32_t updateAltitudeFilter(
+    AccelGyroMagnetismData* accelGyroMagnetismData,
+    BarometerData* barometerData,
+    GpsData* gpsData
+)
 {
-    // Monitor for when to deploy drogue chute. Simple velocity tolerance, looking for a minimum.
-    if (state.velocity < 10)
+    uint32_t accelSampleTimeUs;
+    uint32_t pressureSampleTimeUs;
+    int32_t currentAccel;
+
+    if (!readAccel(accelGyroMagnetismData, &currentAccel, &accelSampleTimeUs))
     {
-        return 1;
+        return 0;
     }
 
-    return 0;
+    int32_t currentPressure = readPressure(barometerData, &pressureSampleTimeUs);
+
+    if (currentPressure == -1)
+    {
+        return 0;
+    }
+
+    // The time step comes from the IMU sample times, so the filter sees when the samples were taken
+    filterAccel = currentAccel;
+    altitudeFilterStep(&altitudeFilter, currentAccel, currentPressure, accelSampleTimeUs, MONITOR_FOR_PARACHUTES_PERIOD);
+    trace(TRACE_FILTER_STEP, (uint16_t) pressureSampleTimeUs);
+
+    GnssMeasurement measurement;
+
+    if (readGps(gpsData, &measurement))
+    {
+        altitudeFilterGnss(&altitudeFilter, &measurement);
+    }
+
+    return 1;
 }
 
 /**
@@ -167,6 +177,7 @@ int32_t detectMainDeploymentAltitude(struct KalmanStateVector state)
 void ejectDrogueParachute()
 {
     HAL_GPIO_WritePin(DROGUE_PARACHUTE_TEMP_GPIO_Port, DROGUE_PARACHUTE_TEMP_Pin, GPIO_PIN_SET);  // high signal causes high current to ignite e-match
+    trace(TRACE_DROGUE_GPIO, 0);
 }
 
 void closeDrogueParachute()
@@ -177,6 +188,7 @@ void closeDrogueParachute()
 void ejectMainParachute()
 {
     HAL_GPIO_WritePin(MAIN_PARACHUTE_GPIO_Port, MAIN_PARACHUTE_Pin, GPIO_PIN_SET);  // high signal causes high current to ignite e-match
+    trace(TRACE_MAIN_GPIO, 0);
 }
 
 void closeMainParachute()
@@ -184,52 +196,138 @@ void closeMainParachute()
     HAL_GPIO_WritePin(MAIN_PARACHUTE_GPIO_Port, MAIN_PARACHUTE_Pin, GPIO_PIN_RESET);
 }
 
+/**
+ * Fires the drogue at the predicted apogee, from the TIM5 compare interrupt.
+ */
+static void drogueAlarm(void)
+{
+    trace(TRACE_DROGUE_DECISION, APOGEE_SCHEDULE);
+    ejectDrogueParachute();
+    drogueAlarmFired = 1;
+}
+
+/**
+ * Predicts apogee from the current state vector and schedules the drogue
+ * on the timebase alarm when it is due before the next step.
+ *
+ * Params:
+ *   state - (KalmanStateVector) Past altitude, velocity and acceleration
+ *   accel - (int32_t) Measured specific force along up, in mg
+ *   sampleTimeUs - (uint32_t) Sample time of the state
+ *
+ * Returns:
+ *   - (int32_t) 1 if the drogue has been fired, 0 if not.
+ */
+int32_t detectApogee(struct KalmanStateVector state, int32_t accel, uint32_t sampleTimeUs)
+{
+    if (drogueAlarmFired)
+    {
+        return 1;
+    }
+
+    switch (apogeePredictorUpdate(&apogeePredictor, &state, accel, sampleTimeUs))
+    {
+        case APOGEE_SCHEDULE:
+            timebaseSetAlarm(apogeePredictor.apogeeTimeUs_, drogueAlarm);
+            return 0;
+
+        case APOGEE_NOW:
+            // The measured velocity changed sign before the alarm went off
+            timebaseCancelAlarm();
+
+            if (drogueAlarmFired)
+            {
+                return 1;
+            }
+
+            trace(TRACE_DROGUE_DECISION, APOGEE_NOW);
+            ejectDrogueParachute();
+            return 1;
+
+        default:
+            timebaseCancelAlarm();
+            return 0;
+    }
+}
+
+
+/**
+ * Sets the sea level pressure of the filter from the averaged pad pressure,
+ * so the barometer reads the pad altitude on the pad. A pressure that would
+ * need a sea level pressure off the record is a bad reading, and is skipped.
+ */
+static void calibrateSeaLevelPressure()
+{
+    double seaLevelPressure = barometricSeaLevelPressure(padPressure, SPACE_PORT_AMERICA_ALTITUDE_ABOVE_SEA_LEVEL);
+
+    if (seaLevelPressure >= BAROMETRIC_MIN_SEA_LEVEL_PRESSURE && seaLevelPressure <= BAROMETRIC_MAX_SEA_LEVEL_PRESSURE)
+    {
+        altitudeFilterSetSeaLevelPressure(&altitudeFilter, seaLevelPressure);
+    }
+}
 
 /**
- * This routine just waits for the current flight phase to get out of PRELAUNCH
+ * This routine averages the pad pressure and calibrates the sea level
+ * pressure with it until the flight phase gets out of PRELAUNCH and ARM
  */
-void parachutesControlPrelaunchRoutine()
+void parachutesControlPrelaunchRoutine(BarometerData* barometerData)
 {
     uint32_t prevWakeTime = osKernelSysTick();
+    uint32_t sinceCalibration = 0;
 
     for (;;)
     {
-        osDelayUntil(&prevWakeTime, MONITOR_FOR_PARACHUTES_PERIOD);
+        taskStatsDelayUntil(&prevWakeTime, MONITOR_FOR_PARACHUTES_PERIOD);
+
+        FlightPhase phase = getCurrentFlightPhase();
 
-        if (getCurrentFlightPhase() != PRELAUNCH)
+        if (phase != PRELAUNCH && phase != ARM)
         {
             // Ascent has begun
             return;
         }
+
+        uint32_t sampleTimeUs;
+        int32_t pressure = readPressure(barometerData, &sampleTimeUs);
+
+        if (pressure <= 0)
+        {
+            continue;
+        }
+
+        padPressure = padPressure == 0 ? pressure : padPressure + PAD_PRESSURE_GAIN * (pressure - padPressure);
+        sinceCalibration += MONITOR_FOR_PARACHUTES_PERIOD;
+
+        if (sinceCalibration >= PAD_CALIBRATION_PERIOD)
+        {
+            calibrateSeaLevelPressure();
+            sinceCalibration = 0;
+        }
     }
 }
 
 void parachutesControlBurnRoutine(
     AccelGyroMagnetismData* accelGyroMagnetismData,
-    BarometerData* barometerData
+    BarometerData* barometerData,
+    GpsData* gpsData
 )
 {
     uint32_t prevWakeTime = osKernelSysTick();
 
     for (;;)
     {
-        osDelayUntil(&prevWakeTime, MONITOR_FOR_PARACHUTES_PERIOD);
+        taskStatsDelayUntil(&prevWakeTime, MONITOR_FOR_PARACHUTES_PERIOD);
 
         if (getCurrentFlightPhase() != BURN)
         {
             return;
         }
 
-        int32_t currentAccel = readAccel(accelGyroMagnetismData);
-        int32_t currentPressure = readPressure(barometerData);
-
-        if (currentAccel == -1 || currentPressure == -1)
+        if (!updateAltitudeFilter(accelGyroMagnetismData, barometerData, gpsData))
         {
             // failed to read values
             continue;
         }
-
-        filterSensors(kalmanFilterState, currentAccel, currentPressure, MONITOR_FOR_PARACHUTES_PERIOD);
     }
 }
 
@@ -241,32 +339,43 @@ void parachutesControlBurnRoutine(
  */
 void parachutesControlCoastRoutine(
     AccelGyroMagnetismData* accelGyroMagnetismData,
-    BarometerData* barometerData
+    BarometerData* barometerData,
+    GpsData* gpsData
 )
 {
     uint32_t prevWakeTime = osKernelSysTick();
     uint32_t elapsedTime = 0;
 
+    apogeePredictorInit(&apogeePredictor);
+
     for (;;)
     {
-        osDelayUntil(&prevWakeTime, MONITOR_FOR_PARACHUTES_PERIOD);
+        taskStatsDelayUntil(&prevWakeTime, MONITOR_FOR_PARACHUTES_PERIOD);
 
         elapsedTime += MONITOR_FOR_PARACHUTES_PERIOD;
 
-        int32_t currentAccel = readAccel(accelGyroMagnetismData);
-        int32_t currentPressure = readPressure(barometerData);
-
-        if (currentAccel == -1 || currentPressure == -1)
+        if (!updateAltitudeFilter(accelGyroMagnetismData, barometerData, gpsData))
         {
             // failed to read values
             continue;
         }
 
-        filterSensors(kalmanFilterState, currentAccel, currentPressure, MONITOR_FOR_PARACHUTES_PERIOD);
+        if (detectApogee(altitudeFilter.state_, filterAccel, altitudeFilter.sampleTimeUs_))
+        {
+            newFlightPhase(DROGUE_DESCENT);
+            return;
+        }
 
-        if (detectApogee(kalmanFilterState) || elapsedTime > KALMAN_FILTER_DROGUE_TIMEOUT)
+        if (elapsedTime > KALMAN_FILTER_DROGUE_TIMEOUT)
         {
-            ejectDrogueParachute();
+            timebaseCancelAlarm();
+
+            if (!drogueAlarmFired)
+            {
+                trace(TRACE_DROGUE_DECISION, APOGEE_WAIT);
+                ejectDrogueParachute();
+            }
+
             newFlightPhase(DROGUE_DESCENT);
             return;
         }
@@ -280,7 +389,8 @@ void parachutesControlCoastRoutine(
  */
 void parachutesControlDrogueDescentRoutine(
     AccelGyroMagnetismData* accelGyroMagnetismData,
-    BarometerData* barometerData
+    BarometerData* barometerData,
+    GpsData* gpsData
 )
 {
     uint32_t prevWakeTime = osKernelSysTick();
@@ -288,7 +398,7 @@ void parachutesControlDrogueDescentRoutine(
 
     for (;;)
     {
-        osDelayUntil(&prevWakeTime, MONITOR_FOR_PARACHUTES_PERIOD);
+        taskStatsDelayUntil(&prevWakeTime, MONITOR_FOR_PARACHUTES_PERIOD);
 
         elapsedTime += MONITOR_FOR_PARACHUTES_PERIOD;
 
@@ -297,20 +407,18 @@ void parachutesControlDrogueDescentRoutine(
             closeDrogueParachute();
         }
 
-        int32_t currentAccel = readAccel(accelGyroMagnetismData);
-        int32_t currentPressure = readPressure(barometerData);
-
-        if (currentAccel == -1 || currentPressure == -1)
+        if (!updateAltitudeFilter(accelGyroMagnetismData, barometerData, gpsData))
         {
             // failed to read values
             continue;
         }
 
-        filterSensors(kalmanFilterState, currentAccel, currentPressure, MONITOR_FOR_PARACHUTES_PERIOD);
-
         // detect 4600 ft above sea level and eject main parachute
-        if (detectMainDeploymentAltitude(kalmanFilterState) || elapsedTime > KALMAN_FILTER_MAIN_TIMEOUT)
+        int32_t mainDeploymentAltitude = detectMainDeploymentAltitude(altitudeFilter.state_);
+
+        if (mainDeploymentAltitude || elapsedTime > KALMAN_FILTER_MAIN_TIMEOUT)
         {
+            trace(TRACE_MAIN_DECISION, mainDeploymentAltitude);
             ejectMainParachute();
             newFlightPhase(MAIN_DESCENT);
             return;
@@ -326,7 +434,7 @@ void parachutesControlMainDescentRoutine()
 
     for (;;)
     {
-        osDelayUntil(&prevWakeTime, MONITOR_FOR_PARACHUTES_PERIOD);
+        taskStatsDelayUntil(&prevWakeTime, MONITOR_FOR_PARACHUTES_PERIOD);
 
         elapsedTime += MONITOR_FOR_PARACHUTES_PERIOD;
 
@@ -341,9 +449,7 @@ void parachutesControlMainDescentRoutine()
 void parachutesControlTask(void const* arg)
 {
     ParachutesControlData* data = (ParachutesControlData*) arg;
-    kalmanFilterState.altitude = SPACE_PORT_AMERICA_ALTITUDE_ABOVE_SEA_LEVEL;
-    kalmanFilterState.velocity = 0;
-    kalmanFilterState.acceleration = 0;
+    altitudeFilterInit(&altitudeFilter, SPACE_PORT_AMERICA_ALTITUDE_ABOVE_SEA_LEVEL);
 
     for (;;)
     {
@@ -351,27 +457,30 @@ void parachutesControlTask(void const* arg)
         {
             case PRELAUNCH:
             case ARM:
-                parachutesControlPrelaunchRoutine();
+                parachutesControlPrelaunchRoutine(data->barometerData_);
                 break;
 
             case BURN:
                 parachutesControlBurnRoutine(
                     data->accelGyroMagnetismData_,
-                    data->barometerData_
+                    data->barometerData_,
+                    data->gpsData_
                 );
                 break;
 
             case COAST:
                 parachutesControlCoastRoutine(
                     data->accelGyroMagnetismData_,
-                    data->barometerData_
+                    data->barometerData_,
+                    data->gpsData_
                 );
                 break;
 
             case DROGUE_DESCENT:
                 parachutesControlDrogueDescentRoutine(
                     data->accelGyroMagnetismData_,
-                    data->barometerData_
+                    data->barometerData_,
+                    data->gpsData_
                 );
 
                 break;
@@ -1,12 +1,15 @@
+#include <math.h>
+
 #include "stm32f4xx.h"
 #include "stm32f4xx_hal_conf.h"
 #include "cmsis_os.h"
 
 #include "ReadAccelGyroMagnetism.h"
 
+#include "Ahrs.h"
 #include "Data.h"
-
-static int READ_ACCEL_GYRO_MAGNETISM = 25;
+#include "MemorySections.h"
+#include "Timebase.h"
 
 static const int CMD_TIMEOUT = 150;
 
@@ -18,7 +21,11 @@ static const int CMD_TIMEOUT = 150;
 // Register addresses
 #define G1_CTRL_REGISTER_ADDR 0x10 // CTRL_REG1_G (10h)
 #define XL6_CTRL_REGISTER_ADDR 0x20 // CTRL_REG6_XL (20h)
+#define M1_CTRL_REGISTER_ADDR 0x20 // CTRL_REG1_M (20h)
 #define M3_CTRL_REGISTER_ADDR 0x22 // CTRL_REG3_M (22h)
+#define AG9_CTRL_REGISTER_ADDR 0x23 // CTRL_REG9 (23h)
+#define FIFO_CTRL_REGISTER_ADDR 0x2E // FIFO_CTRL (2Eh)
+#define FIFO_SRC_REGISTER_ADDR 0x2F // FIFO_SRC (2Fh)
 // #define WHOAMI_REGISTER_ADDR 0x0F
 // #define WHOAMIM_REGISTER_ADDR 0x0F
 
@@ -29,6 +36,22 @@ static const int CMD_TIMEOUT = 150;
 #define ACCEL_SENSITIVITY 0.732 // Unit is mg/LSB
 #define GYRO_SENSITIVITY 8.75  // Unit is mdps/LSB
 #define MAGENTO_SENSITIVITY 0.14 // Unit is mgauss/LSB
+#define RADIANS_PER_MILLIDEGREE 1.745329252e-5f
+
+#define FIFO_SRC_OVERRUN 0x40
+#define FIFO_SRC_SAMPLES 0x3F // Unread samples, up to 32
+#define IMU_ODR_HZ 119
+// Holds the job to its budget, the FIFO keeps the rest for the next job
+#define MAX_SAMPLES_PER_JOB 2
+
+// Single precision for the attitude filter, the FPU has no double
+static const float GYRO_RADIANS_PER_LSB = (float) (GYRO_SENSITIVITY * RADIANS_PER_MILLIDEGREE);
+static const float ACCEL_G_PER_LSB = (float) (ACCEL_SENSITIVITY / 1000);
+
+// The LSM9DS1 runs off its own oscillator, so its sample period is measured
+static const float NOMINAL_SAMPLE_PERIOD_S = 1.0f / IMU_ODR_HZ;
+static const float MAX_SAMPLE_PERIOD_ERROR = 0.1f; // Of the nominal, a larger one is a bad window
+static const uint32_t SAMPLE_PERIOD_WINDOW_US = 5000000; // 0.2 % with one sample either way
 
 // Full Commands
 static const uint8_t ACTIVATE_GYRO_ACCEL_CMD = G1_CTRL_REGISTER_ADDR | WRITE_CMD_MASK;
@@ -39,20 +62,48 @@ static const uint8_t SET_ACCEL_SCALE_CMD = XL6_CTRL_REGISTER_ADDR | WRITE_CMD_MA
 // 011 01 0 00 -> ODR 119, +/- 16G
 static const uint8_t SET_ACCEL_SCALE_DATA = 0x68;
 
+static const uint8_t SET_MAGNETO_RATE_CMD = M1_CTRL_REGISTER_ADDR | WRITE_CMD_MASK;
+// 0 10 111 0 0 -> No temperature compensation, high performance X and Y, ODR 80, faster than the job reads it
+static const uint8_t SET_MAGNETO_RATE_DATA = 0x5C;
+
 static const uint8_t ACTIVATE_MAGNETO_CMD = M3_CTRL_REGISTER_ADDR | WRITE_CMD_MASK;
 // 1 0 0 00 0 00 -> I2C Disable, Low power mode disabled, SPI write enable, Continuous-conversion mode
 static const uint8_t ACTIVATE_MAGNETO_DATA = 0x80;
 
+static const uint8_t ENABLE_FIFO_CMD = AG9_CTRL_REGISTER_ADDR | WRITE_CMD_MASK;
+// 0 0 0 0 0 0 1 0 -> FIFO enabled, I2C on, no threshold stop
+static const uint8_t ENABLE_FIFO_DATA = 0x02;
+
+static const uint8_t SET_FIFO_MODE_CMD = FIFO_CTRL_REGISTER_ADDR | WRITE_CMD_MASK;
+// 110 00000 -> Continuous mode, a full FIFO drops its oldest sample
+static const uint8_t SET_FIFO_MODE_DATA = 0xC0;
+
 static const uint8_t READ_GYRO_X_G_LOW_CMD = GYRO_X_G_LOW_REGISTER_ADDR | READ_CMD_MASK | ACCEL_GYRO_MASK;
 static const uint8_t READ_ACCEL_X_LOW_CMD = ACCEL_X_LOW_REGISTER_ADDR | READ_CMD_MASK | ACCEL_GYRO_MASK;
 static const uint8_t READ_MAGNETO_X_LOW_CMD = MAGNETO_X_LOW_REGISTER_ADDR | READ_CMD_MASK | MAGNETO_MASK;
+static const uint8_t READ_FIFO_SRC_CMD = FIFO_SRC_REGISTER_ADDR | READ_CMD_MASK | ACCEL_GYRO_MASK;
 // static const uint8_t READ_WHOAMI_CMD = WHOAMI_REGISTER_ADDR | READ_CMD_MASK | ACCEL_GYRO_MASK;
 // static const uint8_t READ_WHOAMIM_CMD = WHOAMIM_REGISTER_ADDR | READ_CMD_MASK | MAGNETO_MASK;
 
-void readAccelGyroMagnetismTask(void const* arg)
+static AccelGyroMagnetismData* data = NULL;
+static Ahrs ahrs CCM_BSS;
+
+static float samplePeriod = 1.0f / IMU_ODR_HZ; // s, measured over SAMPLE_PERIOD_WINDOW_US
+static uint8_t hasRead = 0;
+static uint32_t lastReadUs = 0;
+static uint8_t leftSamples = 0; // In the FIFO after the last job
+static uint32_t windowUs = 0;
+static uint32_t windowSamples = 0;
+
+/**
+ * Configures the IMU. Runs from the sensor schedule task before the
+ * schedule starts, see SensorSchedule.h.
+ *
+ * @param   accelGyroMagnetismData  The struct readAccelGyroMagnetismJob will update.
+ */
+void readAccelGyroMagnetismInit(AccelGyroMagnetismData* accelGyroMagnetismData)
 {
-    AccelGyroMagnetismData* data = (AccelGyroMagnetismData*) arg;
-    uint32_t prevWakeTime = osKernelSysTick();
+    data = accelGyroMagnetismData;
 
     osDelay(1000);
 
@@ -70,11 +121,26 @@ void readAccelGyroMagnetismTask(void const* arg)
     HAL_SPI_Transmit(&hspi1, &SET_ACCEL_SCALE_DATA, 1, CMD_TIMEOUT);
     HAL_GPIO_WritePin(IMU_CS_GPIO_Port, IMU_CS_Pin, GPIO_PIN_SET);
 
+    HAL_GPIO_WritePin(MAG_CS_GPIO_Port, MAG_CS_Pin, GPIO_PIN_RESET);
+    HAL_SPI_Transmit(&hspi1, &SET_MAGNETO_RATE_CMD, 1, CMD_TIMEOUT);
+    HAL_SPI_Transmit(&hspi1, &SET_MAGNETO_RATE_DATA, 1, CMD_TIMEOUT);
+    HAL_GPIO_WritePin(MAG_CS_GPIO_Port, MAG_CS_Pin, GPIO_PIN_SET);
+
     HAL_GPIO_WritePin(MAG_CS_GPIO_Port, MAG_CS_Pin, GPIO_PIN_RESET);
     HAL_SPI_Transmit(&hspi1, &ACTIVATE_MAGNETO_CMD, 1, CMD_TIMEOUT);
     HAL_SPI_Transmit(&hspi1, &ACTIVATE_MAGNETO_DATA, 1, CMD_TIMEOUT);
     HAL_GPIO_WritePin(MAG_CS_GPIO_Port, MAG_CS_Pin, GPIO_PIN_SET);
 
+    HAL_GPIO_WritePin(IMU_CS_GPIO_Port, IMU_CS_Pin, GPIO_PIN_RESET);
+    HAL_SPI_Transmit(&hspi1, &ENABLE_FIFO_CMD, 1, CMD_TIMEOUT);
+    HAL_SPI_Transmit(&hspi1, &ENABLE_FIFO_DATA, 1, CMD_TIMEOUT);
+    HAL_GPIO_WritePin(IMU_CS_GPIO_Port, IMU_CS_Pin, GPIO_PIN_SET);
+
+    HAL_GPIO_WritePin(IMU_CS_GPIO_Port, IMU_CS_Pin, GPIO_PIN_RESET);
+    HAL_SPI_Transmit(&hspi1, &SET_FIFO_MODE_CMD, 1, CMD_TIMEOUT);
+    HAL_SPI_Transmit(&hspi1, &SET_FIFO_MODE_DATA, 1, CMD_TIMEOUT);
+    HAL_GPIO_WritePin(IMU_CS_GPIO_Port, IMU_CS_Pin, GPIO_PIN_SET);
+
     /* Read WHO AM I register for verification, should read 104. */
     // uint8_t whoami;
     // HAL_GPIO_WritePin(MAG_CS_GPIO_Port, MAG_CS_Pin, GPIO_PIN_RESET);
@@ -82,17 +148,91 @@ void readAccelGyroMagnetismTask(void const* arg)
     // HAL_SPI_Receive(&hspi1, &whoami, 1, CMD_TIMEOUT);
     // HAL_GPIO_WritePin(MAG_CS_GPIO_Port, MAG_CS_Pin, GPIO_PIN_SET);
 
+    ahrsInit(&ahrs);
+}
+
+/**
+ * Measures the sample period from the samples that reach the FIFO between
+ * two jobs, over SAMPLE_PERIOD_WINDOW_US. A window with an overrun lost
+ * samples and is dropped, and so is a period far off the nominal one.
+ *
+ * @param   readUs  When the FIFO was read.
+ * @param   samples Unread samples in the FIFO.
+ * @param   overrun The FIFO dropped samples since the last job.
+ */
+static void measureSamplePeriod(uint32_t readUs, uint8_t samples, int overrun)
+{
+    if (!hasRead || overrun)
+    {
+        hasRead = 1;
+        lastReadUs = readUs;
+        windowUs = 0;
+        windowSamples = 0;
+        return;
+    }
+
+    windowUs += readUs - lastReadUs;
+    windowSamples += samples - leftSamples;
+    lastReadUs = readUs;
+
+    if (windowUs < SAMPLE_PERIOD_WINDOW_US)
+    {
+        return;
+    }
+
+    float period = windowSamples != 0 ? windowUs * 1e-6f / windowSamples : 0.0f;
+
+    if (fabsf(period - NOMINAL_SAMPLE_PERIOD_S) < MAX_SAMPLE_PERIOD_ERROR * NOMINAL_SAMPLE_PERIOD_S)
+    {
+        samplePeriod = period;
+    }
+
+    windowUs = 0;
+    windowSamples = 0;
+}
+
+/**
+ * Drains the gyroscope and accelerometer samples from the FIFO, up to
+ * MAX_SAMPLES_PER_JOB, and steps the attitude filter once per sample with
+ * the measured sample period. The magnetometer is read once per job.
+ * Sensor schedule job.
+ */
+void readAccelGyroMagnetismJob(void)
+{
     uint8_t dataBuffer[6];
+    uint8_t fifoSource;
 
-    int16_t accelX, accelY, accelZ;
-    int16_t gyroX, gyroY, gyroZ;
+    int16_t accelX = 0, accelY = 0, accelZ = 0;
+    int16_t gyroX = 0, gyroY = 0, gyroZ = 0;
     int16_t magnetoX, magnetoY, magnetoZ;
 
-    for (;;)
-    {
-        osDelayUntil(&prevWakeTime, READ_ACCEL_GYRO_MAGNETISM);
+    uint32_t readUs = timebaseMicros();
+
+    //READ------------------------------------------------------
+    HAL_GPIO_WritePin(IMU_CS_GPIO_Port, IMU_CS_Pin, GPIO_PIN_RESET);
+    HAL_SPI_Transmit(&hspi1, &READ_FIFO_SRC_CMD, 1, CMD_TIMEOUT);
+    HAL_SPI_Receive(&hspi1, &fifoSource, 1, CMD_TIMEOUT);
+    HAL_GPIO_WritePin(IMU_CS_GPIO_Port, IMU_CS_Pin, GPIO_PIN_SET);
+
+    uint8_t samples = fifoSource & FIFO_SRC_SAMPLES;
+    uint8_t drained = samples < MAX_SAMPLES_PER_JOB ? samples : MAX_SAMPLES_PER_JOB;
+    measureSamplePeriod(readUs, samples, (fifoSource & FIFO_SRC_OVERRUN) != 0);
+    leftSamples = samples - drained;
 
-        //READ------------------------------------------------------
+    HAL_GPIO_WritePin(MAG_CS_GPIO_Port, MAG_CS_Pin, GPIO_PIN_RESET);
+    HAL_SPI_Transmit(&hspi1, &READ_MAGNETO_X_LOW_CMD, 1, CMD_TIMEOUT);
+    HAL_SPI_Receive(&hspi1, &dataBuffer[0], 6, CMD_TIMEOUT);
+    HAL_GPIO_WritePin(MAG_CS_GPIO_Port, MAG_CS_Pin, GPIO_PIN_SET);
+    magnetoX = (dataBuffer[1] << 8) | (dataBuffer[0]);
+    magnetoY = (dataBuffer[3] << 8) | (dataBuffer[2]);
+    magnetoZ = (dataBuffer[5] << 8) | (dataBuffer[4]);
+
+    // The magnetometer axes are turned from the accelerometer and gyroscope axes, see the LSM9DS1 pin description
+    float magneto[3] = {-magnetoY, -magnetoX, magnetoZ};
+
+    // Oldest sample first. The FIFO moves on once the accelerometer of a sample is read.
+    for (uint8_t sample = 0; sample < drained; sample++)
+    {
         HAL_GPIO_WritePin(IMU_CS_GPIO_Port, IMU_CS_Pin, GPIO_PIN_RESET);
         HAL_SPI_Transmit(&hspi1, &READ_GYRO_X_G_LOW_CMD, 1, CMD_TIMEOUT);
         HAL_SPI_Receive(&hspi1, &dataBuffer[0], 6, CMD_TIMEOUT);
@@ -109,29 +249,39 @@ void readAccelGyroMagnetismTask(void const* arg)
         accelY = (dataBuffer[3] << 8) | (dataBuffer[2]);
         accelZ = (dataBuffer[5] << 8) | (dataBuffer[4]);
 
-        // HAL_GPIO_WritePin(MAG_CS_GPIO_Port, MAG_CS_Pin, GPIO_PIN_RESET);
-        // HAL_SPI_Transmit(&hspi1, &READ_MAGNETO_X_LOW_CMD, 1, CMD_TIMEOUT);
-        // HAL_SPI_Receive(&hspi1, &dataBuffer[0], 6, CMD_TIMEOUT);
-        // HAL_GPIO_WritePin(MAG_CS_GPIO_Port, MAG_CS_Pin, GPIO_PIN_SET);
-        // magnetoX = (dataBuffer[1] << 8) | (dataBuffer[0]);
-        // magnetoY = (dataBuffer[3] << 8) | (dataBuffer[2]);
-        // magnetoZ = (dataBuffer[5] << 8) | (dataBuffer[4]);
-
-        /* Writeback */
-        if (osMutexWait(data->mutex_, 0) != osOK)
-        {
-            continue;
-        }
-
-        data->accelX_ = accelX * ACCEL_SENSITIVITY; // mg
-        data->accelY_ = accelY * ACCEL_SENSITIVITY; // mg
-        data->accelZ_ = accelZ * ACCEL_SENSITIVITY; // mg
-        data->gyroX_ = gyroX * GYRO_SENSITIVITY; // mdps
-        data->gyroY_ = gyroY * GYRO_SENSITIVITY; // mdps
-        data->gyroZ_ = gyroZ * GYRO_SENSITIVITY; // mdps
-        // data->magnetoX_ = magnetoX * MAGENTO_SENSITIVITY; // mgauss
-        // data->magnetoY_ = magnetoY * MAGENTO_SENSITIVITY; // mgauss
-        // data->magnetoZ_ = magnetoZ * MAGENTO_SENSITIVITY; // mgauss
-        osMutexRelease(data->mutex_);
+        // Every sample goes through the filter, even when the writeback is skipped
+        float gyro[3] = {gyroX * GYRO_RADIANS_PER_LSB, gyroY * GYRO_RADIANS_PER_LSB, gyroZ * GYRO_RADIANS_PER_LSB};
+        float accel[3] = {accelX * ACCEL_G_PER_LSB, accelY * ACCEL_G_PER_LSB, accelZ * ACCEL_G_PER_LSB};
+        ahrsUpdate(&ahrs, gyro, accel, magneto, samplePeriod);
     }
+
+    if (drained == 0)
+    {
+        // No sample since the last job
+        return;
+    }
+
+    // The newest sample is about the read time, the ones left in the FIFO came after the last one drained
+    uint32_t sampleTimeUs = readUs - (uint32_t) (leftSamples * samplePeriod * 1e6f);
+
+    /* Writeback */
+    if (osMutexWait(data->mutex_, 0) != osOK)
+    {
+        return;
+    }
+
+    data->accelX_ = accelX * ACCEL_SENSITIVITY; // mg
+    data->accelY_ = accelY * ACCEL_SENSITIVITY; // mg
+    data->accelZ_ = accelZ * ACCEL_SENSITIVITY; // mg
+    data->gyroX_ = gyroX * GYRO_SENSITIVITY; // mdps
+    data->gyroY_ = gyroY * GYRO_SENSITIVITY; // mdps
+    data->gyroZ_ = gyroZ * GYRO_SENSITIVITY; // mdps
+    data->magnetoX_ = magnetoX * MAGENTO_SENSITIVITY; // mgauss
+    data->magnetoY_ = magnetoY * MAGENTO_SENSITIVITY; // mgauss
+    data->magnetoZ_ = magnetoZ * MAGENTO_SENSITIVITY; // mgauss
+    data->tilt_ = ahrs.tilt_ / RADIANS_PER_MILLIDEGREE; // mdeg
+    data->angularRate_ = ahrs.angularRate_ / RADIANS_PER_MILLIDEGREE; // mdps
+    data->verticalAccel_ = ahrs.verticalAccel_ * 1000; // mg
+    data->sampleTimeUs_ = sampleTimeUs;
+    osMutexRelease(data->mutex_);
 }
@@ -3,9 +3,10 @@
   * File Name          : ReadBarometer.c
   * Description        : This file contains constants and functions designed to
   *                      obtain accurate pressure and temperature readings from
-  *                      the MS5607-02BA03 barometer on the flight board. A
-  *                      thread task is included that will constantly loop,
-  *                      reading and updating the passed BarometerData struct.
+  *                      the MS5607-02BA03 barometer on the flight board. One
+  *                      reading is split into three sensor schedule jobs so
+  *                      the conversions run while other sensors are read,
+  *                      updating the passed BarometerData struct.
   ******************************************************************************
 */
 
@@ -17,16 +18,18 @@
 
 #include "ReadBarometer.h"
 #include "Data.h"
+#include "Timebase.h"
+#include "Trace.h"
 
 /* Macros --------------------------------------------------------------------*/
 
 /* Constants -----------------------------------------------------------------*/
 
-static const int READ_BAROMETER_PERIOD      = 25;
 static const int TEMP_LOW                   = 2000;
 static const int TEMP_VERY_LOW              = -1500;
 static const int CMD_SIZE                   = 1;
 static const int CMD_TIMEOUT                = 150;
+static const int CONVERSION_MIDPOINT_US     = 585;  // Half the max conversion time for an over-sampling ratio of 512
 
 static const uint8_t ADC_D1_512_CONV_CMD    = 0x42;
 static const uint8_t ADC_D2_512_CONV_CMD    = 0x52;
@@ -42,21 +45,81 @@ static const uint8_t RESET_CMD              = 0x1E;
 
 /* Variables -----------------------------------------------------------------*/
 
+static BarometerData* data  = NULL;
+
+// PROM calibration coefficients, see readBarometerTemperatureJob
+static uint16_t c1Sens      = 0;
+static uint16_t c2Off       = 0;
+static uint16_t c3Tcs       = 0;
+static uint16_t c4Tco       = 0;
+static uint16_t c5Tref      = 0;
+static uint16_t c6Tempsens  = 0;
+
+static uint32_t pressureReading = 0;    // Stores a 24 bit value
+static uint32_t pressureSampleTimeUs = 0;
+
 /* Structs -------------------------------------------------------------------*/
 
 /* Prototypes ----------------------------------------------------------------*/
 
 uint16_t readCalibrationCoefficient(const uint8_t PROM_READ_CMD);
+static void startConversion(const uint8_t* ADC_CONV_CMD);
+static uint32_t readConversion(void);
 
 /* Functions -----------------------------------------------------------------*/
 
 /**
- * This function is to be used as a thread task that reads and updates
- * pressure and temperature readings from the barometer.
+ * Resets the barometer and reads its calibration coefficients. Runs from
+ * the sensor schedule task before the schedule starts, see SensorSchedule.h.
  *
- * @param   arg A pointer to the BarometerData struct that will be updated.
+ * @param   barometerData   The struct readBarometerTemperatureJob will update.
  */
-void readBarometerTask(void const* arg)
+void readBarometerInit(BarometerData* barometerData)
+{
+    data = barometerData;
+
+    // Reset the barometer
+    HAL_GPIO_WritePin(BARO_CS_GPIO_Port, BARO_CS_Pin, GPIO_PIN_RESET);
+    HAL_SPI_Transmit(&hspi2, &RESET_CMD, CMD_SIZE, CMD_TIMEOUT);
+    osDelay(3); // 2.8ms reload after Reset command
+    HAL_GPIO_WritePin(BARO_CS_GPIO_Port, BARO_CS_Pin, GPIO_PIN_SET);
+
+    // Read PROM for calibration coefficients
+    c1Sens      = readCalibrationCoefficient(PROM_READ_SENS_CMD);
+    c2Off       = readCalibrationCoefficient(PROM_READ_OFF_CMD);
+    c3Tcs       = readCalibrationCoefficient(PROM_READ_TCS_CMD);
+    c4Tco       = readCalibrationCoefficient(PROM_READ_TCO_CMD);
+    c5Tref      = readCalibrationCoefficient(PROM_READ_TREF_CMD);
+    c6Tempsens  = readCalibrationCoefficient(PROM_READ_TEMPSENS_CMD);
+}
+
+/**
+ * Starts the digital pressure (D1) conversion. Sensor schedule job; the
+ * schedule runs readBarometerPressureJob at least 1.17 ms later, the max
+ * conversion time for an over-sampling ratio of 512.
+ */
+void startBarometerPressureJob(void)
+{
+    startConversion(&ADC_D1_512_CONV_CMD);
+    pressureSampleTimeUs = timebaseMicros() + CONVERSION_MIDPOINT_US;
+}
+
+/**
+ * Reads the digital pressure (D1) and starts the digital temperature (D2)
+ * conversion. Sensor schedule job.
+ */
+void readBarometerPressureJob(void)
+{
+    pressureReading = readConversion();
+    startConversion(&ADC_D2_512_CONV_CMD);
+}
+
+/**
+ * Reads the digital temperature (D2), converts both readings into their
+ * calibrated counterparts and updates the data if the mutex is available.
+ * Sensor schedule job.
+ */
+void readBarometerTemperatureJob(void)
 {
     /**
      * Variable Descriptions from MS5607-02BA03 Data Sheet:
@@ -83,134 +146,95 @@ void readBarometerTask(void const* arg)
      *          P = (D1 * SENS) - OFF = ((D1 * SENS)/2^21 - OFF)/2^15
      */
 
-    // Variables
-    BarometerData* data         = (BarometerData*) arg;
-    uint32_t prevWakeTime       = osKernelSysTick();
-    uint32_t pressureReading    = 0;    // Stores a 24 bit value
-    uint32_t temperatureReading = 0;    // Stores a 24 bit value
-    uint8_t dataInBuffer;
-
-    // Reset the barometer
-    HAL_GPIO_WritePin(BARO_CS_GPIO_Port, BARO_CS_Pin, GPIO_PIN_RESET);
-    HAL_SPI_Transmit(&hspi2, &RESET_CMD, CMD_SIZE, CMD_TIMEOUT);
-    osDelay(3); // 2.8ms reload after Reset command
-    HAL_GPIO_WritePin(BARO_CS_GPIO_Port, BARO_CS_Pin, GPIO_PIN_SET);
+    uint32_t temperatureReading = readConversion();    // Stores a 24 bit value
 
-    // Read PROM for calibration coefficients
-    uint16_t c1Sens     = readCalibrationCoefficient(PROM_READ_SENS_CMD);
-    uint16_t c2Off      = readCalibrationCoefficient(PROM_READ_OFF_CMD);
-    uint16_t c3Tcs      = readCalibrationCoefficient(PROM_READ_TCS_CMD);
-    uint16_t c4Tco      = readCalibrationCoefficient(PROM_READ_TCO_CMD);
-    uint16_t c5Tref     = readCalibrationCoefficient(PROM_READ_TREF_CMD);
-    uint16_t c6Tempsens = readCalibrationCoefficient(PROM_READ_TEMPSENS_CMD);
+    /* Calculate First-Order Temperature and Parameters ----------------------*/
 
-    /**
-     * Repeatedly read digital pressure and temperature.
-     * Convert these values into their calibrated counterparts.
-     * Finally, update the data globally if the mutex is available.
-     */
-    for (;;)
-    {
-        osDelayUntil(&prevWakeTime, READ_BAROMETER_PERIOD);
+    // Calibration coefficients need to be type cast to int64_t to avoid overflow during intermediate calculations
+    int32_t dT      = temperatureReading - ((int32_t) c5Tref << 8);
+    int32_t temp    = 2000 + ((dT * (int64_t) c6Tempsens) >> 23); // Divide this value by 100 to get degrees Celsius
+    int64_t off     = ((int64_t) c2Off << 17) + ((dT * (int64_t) c4Tco) >> 6);
+    int64_t sens    = ((int64_t) c1Sens << 16) + ((dT * (int64_t) c3Tcs) >> 7);
 
-        /* Read Digital Pressure (D1) ----------------------------------------*/
+    /* Calculate Second-Order Temperature and Pressure -----------------------*/
 
-        // Tell the barometer to convert the pressure to a digital value with an over-sampling ratio of 512
-        HAL_GPIO_WritePin(BARO_CS_GPIO_Port, BARO_CS_Pin, GPIO_PIN_RESET);
-        HAL_SPI_Transmit(&hspi2, &ADC_D1_512_CONV_CMD, CMD_SIZE, CMD_TIMEOUT);
-        HAL_GPIO_WritePin(BARO_CS_GPIO_Port, BARO_CS_Pin, GPIO_PIN_SET);
-
-        osDelay(2); // 1.17ms max conversion time for an over-sampling ratio of 512
-
-        HAL_GPIO_WritePin(BARO_CS_GPIO_Port, BARO_CS_Pin, GPIO_PIN_RESET);
-
-        HAL_SPI_Transmit(&hspi2, &ADC_READ_CMD, CMD_SIZE, CMD_TIMEOUT);
-
-        // Read the first byte (bits 23-16)
-        HAL_SPI_TransmitReceive(&hspi2, &READ_BYTE_CMD, &dataInBuffer, CMD_SIZE, CMD_TIMEOUT);
-        pressureReading = dataInBuffer << 16;
-
-        // Read the second byte (bits 15-8)
-        HAL_SPI_TransmitReceive(&hspi2, &READ_BYTE_CMD, &dataInBuffer, CMD_SIZE, CMD_TIMEOUT);
-        pressureReading += dataInBuffer << 8;
-
-        // Read the third byte (bits 7-0)
-        HAL_SPI_TransmitReceive(&hspi2, &READ_BYTE_CMD, &dataInBuffer, CMD_SIZE, CMD_TIMEOUT);
-        pressureReading += dataInBuffer;
-
-        HAL_GPIO_WritePin(BARO_CS_GPIO_Port, BARO_CS_Pin, GPIO_PIN_SET);
-
-        /* Read Digital Temperature (D2) -------------------------------------*/
-
-        // Tell the barometer to convert the temperature to a digital value with an over-sampling ratio of 512
-        HAL_GPIO_WritePin(BARO_CS_GPIO_Port, BARO_CS_Pin, GPIO_PIN_RESET);
-        HAL_SPI_Transmit(&hspi2, &ADC_D2_512_CONV_CMD, CMD_SIZE, CMD_TIMEOUT);
-        HAL_GPIO_WritePin(BARO_CS_GPIO_Port, BARO_CS_Pin, GPIO_PIN_SET);
+    if (temp < TEMP_LOW)    // If the temperature is below 20°C
+    {
+        int32_t t2      = ((int64_t) dT * dT) >> 31;
+        int64_t off2    = 61 * (((int64_t) (temp - 2000) * (temp - 2000)) >> 4);
+        int64_t sens2   = 2 * ((int64_t) (temp - 2000) * (temp - 2000));
 
-        osDelay(2); // 1.17ms max conversion time for an over-sampling ratio of 512
+        if (temp < TEMP_VERY_LOW)   // If the temperature is below -15°C
+        {
+            off2    = off2 + (15 * ((int64_t) (temp + 1500) * (temp + 1500)));
+            sens2   = sens2 + (8 * ((int64_t) (temp + 1500) * (temp + 1500)));
+        }
 
-        HAL_GPIO_WritePin(BARO_CS_GPIO_Port, BARO_CS_Pin, GPIO_PIN_RESET);
+        temp    = temp  - t2;
+        off     = off   - off2;
+        sens    = sens  - sens2;
+    }
 
-        HAL_SPI_Transmit(&hspi2, &ADC_READ_CMD, CMD_SIZE, CMD_TIMEOUT);
+    int32_t p   = (((pressureReading * sens) >> 21) - off) >> 15;   // Divide this value by 100 to get millibars
 
-        // Read the first byte (bits 23-16)
-        HAL_SPI_TransmitReceive(&hspi2, &ADC_READ_CMD, &dataInBuffer, CMD_SIZE, CMD_TIMEOUT);
-        temperatureReading = dataInBuffer << 16;
+    /* Store Data ------------------------------------------------------------*/
 
-        // Read the second byte (bits 15-8)
-        HAL_SPI_TransmitReceive(&hspi2, &ADC_READ_CMD, &dataInBuffer, CMD_SIZE, CMD_TIMEOUT);
-        temperatureReading += dataInBuffer << 8;
+    if (osMutexWait(data->mutex_, 0) == osOK)
+    {
+        data->pressure_     = p;
+        data->temperature_  = temp;
+        data->sampleTimeUs_ = pressureSampleTimeUs;
+        osMutexRelease(data->mutex_);
+        trace(TRACE_BAROMETER_SAMPLE, (uint16_t) pressureSampleTimeUs);
+    }
 
-        // Read the third byte (bits 7-0)
-        HAL_SPI_TransmitReceive(&hspi2, &ADC_READ_CMD, &dataInBuffer, CMD_SIZE, CMD_TIMEOUT);
-        temperatureReading += dataInBuffer;
+    // All equations provided by MS5607-02BA03 data sheet
 
-        HAL_GPIO_WritePin(BARO_CS_GPIO_Port, BARO_CS_Pin, GPIO_PIN_SET);
+    // PRESSURE AND TEMPERATURE VALUES ARE STORED AT 100x VALUE TO MAINTAIN
+    // 2 DECIMAL POINTS OF PRECISION AS AN INTEGER!
+    // E.x. The value 1234 should be interpreted as 12.34
+}
 
-        /* Calculate First-Order Temperature and Parameters ------------------*/
+/**
+ * Tells the barometer to convert the pressure or temperature to a digital
+ * value.
+ * @param   ADC_CONV_CMD    ADC_D1_512_CONV_CMD or ADC_D2_512_CONV_CMD.
+ */
+static void startConversion(const uint8_t* ADC_CONV_CMD)
+{
+    HAL_GPIO_WritePin(BARO_CS_GPIO_Port, BARO_CS_Pin, GPIO_PIN_RESET);
+    HAL_SPI_Transmit(&hspi2, ADC_CONV_CMD, CMD_SIZE, CMD_TIMEOUT);
+    HAL_GPIO_WritePin(BARO_CS_GPIO_Port, BARO_CS_Pin, GPIO_PIN_SET);
+}
 
-        // Calibration coefficients need to be type cast to int64_t to avoid overflow during intermediate calculations
-        int32_t dT      = temperatureReading - ((int32_t) c5Tref << 8);
-        int32_t temp    = 2000 + ((dT * (int64_t) c6Tempsens) >> 23); // Divide this value by 100 to get degrees Celsius
-        int64_t off     = ((int64_t) c2Off << 17) + ((dT * (int64_t) c4Tco) >> 6);
-        int64_t sens    = ((int64_t) c1Sens << 16) + ((dT * (int64_t) c3Tcs) >> 7);
+/**
+ * Reads the 24-bit result of the last conversion.
+ * @return  The digital pressure or temperature value.
+ */
+static uint32_t readConversion(void)
+{
+    uint32_t reading;
+    uint8_t dataInBuffer;
 
-        /* Calculate Second-Order Temperature and Pressure -------------------*/
+    HAL_GPIO_WritePin(BARO_CS_GPIO_Port, BARO_CS_Pin, GPIO_PIN_RESET);
 
-        if (temp < TEMP_LOW)    // If the temperature is below 20°C
-        {
-            int32_t t2      = ((int64_t) dT * dT) >> 31;
-            int64_t off2    = 61 * (((int64_t) (temp - 2000) * (temp - 2000)) >> 4);
-            int64_t sens2   = 2 * ((int64_t) (temp - 2000) * (temp - 2000));
-
-            if (temp < TEMP_VERY_LOW)   // If the temperature is below -15°C
-            {
-                off2    = off2 + (15 * ((int64_t) (temp + 1500) * (temp + 1500)));
-                sens2   = sens2 + (8 * ((int64_t) (temp + 1500) * (temp + 1500)));
-            }
-
-            temp    = temp  - t2;
-            off     = off   - off2;
-            sens    = sens  - sens2;
-        }
+    HAL_SPI_Transmit(&hspi2, &ADC_READ_CMD, CMD_SIZE, CMD_TIMEOUT);
 
-        int32_t p   = (((pressureReading * sens) >> 21) - off) >> 15;   // Divide this value by 100 to get millibars
+    // Read the first byte (bits 23-16)
+    HAL_SPI_TransmitReceive(&hspi2, &READ_BYTE_CMD, &dataInBuffer, CMD_SIZE, CMD_TIMEOUT);
+    reading = dataInBuffer << 16;
 
-        /* Store Data --------------------------------------------------------*/
+    // Read the second byte (bits 15-8)
+    HAL_SPI_TransmitReceive(&hspi2, &READ_BYTE_CMD, &dataInBuffer, CMD_SIZE, CMD_TIMEOUT);
+    reading += dataInBuffer << 8;
 
-        if (osMutexWait(data->mutex_, 0) == osOK)
-        {
-            data->pressure_     = p;
-            data->temperature_  = temp;
-            osMutexRelease(data->mutex_);
-        }
+    // Read the third byte (bits 7-0)
+    HAL_SPI_TransmitReceive(&hspi2, &READ_BYTE_CMD, &dataInBuffer, CMD_SIZE, CMD_TIMEOUT);
+    reading += dataInBuffer;
 
-        // All equations provided by MS5607-02BA03 data sheet
+    HAL_GPIO_WritePin(BARO_CS_GPIO_Port, BARO_CS_Pin, GPIO_PIN_SET);
 
-        // PRESSURE AND TEMPERATURE VALUES ARE STORED AT 100x VALUE TO MAINTAIN
-        // 2 DECIMAL POINTS OF PRECISION AS AN INTEGER!
-        // E.x. The value 1234 should be interpreted as 12.34
-    }
+    return reading;
 }
 
 /**
@@ -1,136 +1,596 @@
 #include "stm32f4xx.h"
 #include "stm32f4xx_hal_conf.h"
 #include "cmsis_os.h"
+#include "stream_buffer.h"
 
 #include "ReadGps.h"
 
 #include "Data.h"
+#include "MemorySections.h"
+#include "Nmea.h"
+#include "Timebase.h"
+#include "Ubx.h"
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
+// Waiting for an acknowledgement, which comes within tens of ms unless the receiver is busy starting up
+static const uint32_t CONFIG_TIMEOUT_MS = 1000;
+// Without a NAV-PVT once configured
+static const uint32_t SILENCE_TIMEOUT_MS = 2000;
+// From a navigation epoch to the start of its output, a typical figure for the receiver
+static const uint32_t SOLUTION_LATENCY_US = 30000;
 
-static int READ_GPS_PERIOD = 500;
+static GpsData* data = NULL;
 
-void readGpsTask(void const* arg)
+static uint8_t dmaBuffer[GPS_DMA_BUFFER_SIZE] DMA_BUFFER;
+static uint8_t streamStorage[GPS_STREAM_BUFFER_SIZE + 1] CCM_BSS; // FreeRTOS keeps one byte free
+static StaticStreamBuffer_t streamControl CCM_BSS;
+static StreamBufferHandle_t stream = NULL;
+
+// Written by the DMA and UART4 interrupts, which share a priority and so never preempt each other
+static uint16_t dmaReadIndex = 0;
+static uint32_t queuedBytes = 0;
+static uint32_t queuedTimeUs = 0; // When the last byte queued was taken from the DMA buffer
+static uint32_t droppedBytes = 0;
+static uint32_t errors = 0;
+
+// Only touched by readGpsJob
+static uint32_t drainedBytes = 0;
+static NmeaParser nmeaParser;
+static UbxParser ubxParser;
+static uint32_t sentences = 0;
+static uint32_t frames = 0;
+static uint32_t checksumErrors = 0;
+static uint32_t formatErrors = 0;
+
+static GpsConfigState configState = GPS_CONFIG_PORT;
+static uint8_t configAttempts = 0;
+static uint8_t configurations = 0;
+static uint32_t configDeadlineMs = 0;
+static uint32_t lastNavPvtMs = 0;
+static int8_t ackReceived = 0; // 1 acknowledged, -1 rejected, for the message being configured
+static uint8_t txFrame[UBX_CFG_MAX_FRAME_LENGTH]; // Sent by interrupts
+
+static void startReception(void)
+{
+    HAL_UART_Receive_DMA(&huart4, dmaBuffer, GPS_DMA_BUFFER_SIZE);
+    __HAL_UART_ENABLE_IT(&huart4, UART_IT_IDLE);
+}
+
+void readGpsInit(GpsData* gps)
+{
+    data = gps;
+    nmeaInit(&nmeaParser);
+    ubxInit(&ubxParser);
+    stream = xStreamBufferCreateStatic(GPS_STREAM_BUFFER_SIZE, 1, streamStorage, &streamControl);
+
+    startReception();
+}
+
+static void queue(const uint8_t* bytes, uint16_t length)
+{
+    size_t sent = xStreamBufferSendFromISR(stream, bytes, length, NULL);
+
+    queuedBytes += sent;
+    droppedBytes += length - sent;
+}
+
+void gpsRxCallback(void)
+{
+    // NDTR counts down to zero and reloads, the DMA writes the next byte at writeIndex
+    uint16_t writeIndex = (GPS_DMA_BUFFER_SIZE - __HAL_DMA_GET_COUNTER(huart4.hdmarx)) % GPS_DMA_BUFFER_SIZE;
+
+    if (writeIndex == dmaReadIndex)
+    {
+        return;
+    }
+
+    if (writeIndex < dmaReadIndex)
+    {
+        queue(&dmaBuffer[dmaReadIndex], GPS_DMA_BUFFER_SIZE - dmaReadIndex);
+        dmaReadIndex = 0;
+    }
+
+    if (writeIndex != 0)
+    {
+        queue(&dmaBuffer[dmaReadIndex], writeIndex - dmaReadIndex);
+    }
+
+    dmaReadIndex = writeIndex;
+    queuedTimeUs = timebaseMicros();
+}
+
+void gpsRxError(void)
+{
+    errors++;
+
+    // Keep what the DMA wrote before the HAL aborted it
+    gpsRxCallback();
+
+    dmaReadIndex = 0;
+    HAL_UART_Receive_DMA(&huart4, dmaBuffer, GPS_DMA_BUFFER_SIZE);
+}
+
+void gpsRxStats(GpsRxStats* stats)
+{
+    taskENTER_CRITICAL();
+    stats->bytes_ = queuedBytes;
+    stats->droppedBytes_ = droppedBytes;
+    stats->errors_ = errors;
+    taskEXIT_CRITICAL();
+
+    stats->sentences_ = sentences;
+    stats->frames_ = frames;
+    stats->checksumErrors_ = checksumErrors;
+    stats->formatErrors_ = formatErrors;
+    stats->configState_ = configState;
+    stats->configAttempts_ = configAttempts;
+    stats->configurations_ = configurations;
+}
+
+// Knots x100 to cm/s
+static uint32_t knotsToCms(uint32_t knots)
+{
+    return (uint32_t) (((uint64_t) knots * 514444 + 500000) / 1000000);
+}
+
+/**
+ * 1e-7 degree to degrees and 1/100000 minute, both negative south and west.
+ */
+static void toLatLong(int32_t degrees, LatLongType* latLong)
 {
-    GpsData* data = (GpsData*) arg;
-    uint32_t prevWakeTime = osKernelSysTick();
+    int32_t fraction = degrees % 10000000;
+
+    latLong->degrees_ = degrees / 10000000;
+    // x60 / 100, rounded away from zero
+    latLong->minutes_ = (fraction * 6 + (fraction < 0 ? -5 : 5)) / 10;
+}
 
-    HAL_UART_Receive_DMA(&huart4, (uint8_t*) &dma_rx_buffer, NMEA_MAX_LENGTH + 1);
+// mm to m x10, rounded
+static int32_t toDecimeters(int32_t millimeters)
+{
+    return (millimeters + (millimeters < 0 ? -50 : 50)) / 100;
+}
+
+/**
+ * Sets the position of a fix. Altitudes are in m x10, timeUs is the
+ * navigation epoch. Called with the mutex held.
+ */
+static void setPosition(const LatLongType* latitude, const LatLongType* longitude, int32_t altitude, int32_t geoidSeparation, uint32_t timeUs)
+{
+    data->latitude_ = *latitude;
+    data->longitude_ = *longitude;
+    data->antennaAltitude_.altitude_ = altitude;
+    data->antennaAltitude_.unit_ = 'M';
+    data->geoidAltitude_.altitude_ = geoidSeparation;
+    data->geoidAltitude_.unit_ = 'M';
+
+    // Subtract geoid altitude from antenna altitude to get Height Above Ellipsoid (HAE)
+    data->totalAltitude_.altitude_ = data->antennaAltitude_.altitude_ - data->geoidAltitude_.altitude_;
+    data->totalAltitude_.unit_ = data->antennaAltitude_.unit_;
+
+    data->sampleTimeUs_ = timeUs;
+}
+
+/**
+ * Updates the GPS data from a decoded sentence. timeUs is the navigation
+ * epoch.
+ */
+static void updateFromSentence(const NmeaSentence* sentence, uint32_t timeUs)
+{
+    if (osMutexWait(data->mutex_, 0) != osOK)
+    {
+        return;
+    }
 
-    for (;;)
+    switch (sentence->type_)
     {
-        osDelayUntil(&prevWakeTime, READ_GPS_PERIOD);
+        case NMEA_GGA:
+        {
+            const NmeaGga* gga = &sentence->fix_.gga_;
+
+            data->time_ = gga->time_;
+            data->fixQuality_ = gga->quality_;
+            data->satellites_ = gga->satellites_;
+            data->hdop_ = gga->hdop_;
+
+            // Without a fix the position fields are empty, keep the last known position
+            if (gga->quality_ != 0)
+            {
+                LatLongType latitude = {gga->latitude_.degrees_, gga->latitude_.minutes_};
+                LatLongType longitude = {gga->longitude_.degrees_, gga->longitude_.minutes_};
+
+                setPosition(&latitude, &longitude, gga->altitude_, gga->geoidSeparation_, timeUs);
+
+                // Left from a NAV-PVT, GGA has neither
+                data->velocityNorth_ = 0;
+                data->velocityEast_ = 0;
+                data->velocityDown_ = 0;
+                data->horizontalAccuracy_ = 0;
+                data->verticalAccuracy_ = 0;
+            }
+
+            break;
+        }
+
+        case NMEA_RMC:
+        {
+            const NmeaRmc* rmc = &sentence->fix_.rmc_;
+
+            if (rmc->valid_)
+            {
+                data->groundSpeed_ = knotsToCms(rmc->speed_);
+                data->course_ = rmc->course_;
+            }
+
+            break;
+        }
 
-        if (osMutexWait(data->mutex_, 0) != osOK)
+        case NMEA_VTG:
         {
-            continue;
+            const NmeaVtg* vtg = &sentence->fix_.vtg_;
+
+            if (vtg->mode_ != 'N')
+            {
+                data->groundSpeed_ = knotsToCms(vtg->speedKnots_);
+                data->course_ = vtg->courseTrue_;
+            }
+
+            break;
         }
 
-        if (data->parseFlag_ == 1)
+        case NMEA_GSA:
         {
-            // Returns the first token
-            char* gps_item = strtok(data->buffer_, ",");
-            uint8_t counter = 0;
-            char direction;
+            data->fixType_ = sentence->fix_.gsa_.fixType_;
+            break;
+        }
+    }
+
+    osMutexRelease(data->mutex_);
+}
+
+/**
+ * The GGA fix quality of a solution, 0 if it is not valid.
+ */
+static uint8_t navPvtQuality(const UbxNavPvt* pvt)
+{
+    uint8_t carrier = (pvt->flags_ >> UBX_FLAGS_CARRIER_SHIFT) & UBX_FLAGS_CARRIER_MASK;
+
+    if (!(pvt->flags_ & UBX_FLAGS_FIX_OK) || pvt->fixType_ == UBX_FIX_NONE || pvt->fixType_ == UBX_FIX_TIME_ONLY)
+    {
+        return 0;
+    }
+
+    if (pvt->fixType_ == UBX_FIX_DEAD_RECKONING)
+    {
+        return 6;
+    }
+
+    if (carrier != 0)
+    {
+        return carrier == 2 ? 4 : 5;
+    }
+
+    return (pvt->flags_ & UBX_FLAGS_DIFFERENTIAL) ? 2 : 1;
+}
+
+/**
+ * Updates the GPS data from a navigation solution. timeUs is the navigation
+ * epoch.
+ */
+static void updateFromNavPvt(const UbxNavPvt* pvt, uint32_t timeUs)
+{
+    if (osMutexWait(data->mutex_, 0) != osOK)
+    {
+        return;
+    }
+
+    if (pvt->valid_ & UBX_VALID_TIME)
+    {
+        // The fraction may be negative when the rounded second is ahead
+        int32_t centiseconds = pvt->nano_ > 0 ? pvt->nano_ / 10000000 : 0;
+        data->time_ = pvt->hour_ * 1000000UL + pvt->minute_ * 10000UL + pvt->second_ * 100UL + centiseconds;
+    }
+
+    data->fixQuality_ = navPvtQuality(pvt);
+    data->fixType_ = pvt->fixType_ == UBX_FIX_2D ? 2 : (pvt->fixType_ == UBX_FIX_3D || pvt->fixType_ == UBX_FIX_GNSS_DEAD_RECKONING) ? 3 : 1;
+    data->satellites_ = pvt->satellites_;
+    data->hdop_ = 0;
+
+    if (data->fixQuality_ != 0)
+    {
+        LatLongType latitude;
+        LatLongType longitude;
+
+        toLatLong(pvt->latitude_, &latitude);
+        toLatLong(pvt->longitude_, &longitude);
+        setPosition(&latitude, &longitude, toDecimeters(pvt->heightMsl_), toDecimeters(pvt->height_ - pvt->heightMsl_), timeUs);
+
+        data->groundSpeed_ = pvt->groundSpeed_ > 0 ? pvt->groundSpeed_ / 10 : 0;
+        data->course_ = pvt->headingMotion_ > 0 ? pvt->headingMotion_ / 1000 : 0;
+        data->velocityNorth_ = pvt->velocityNorth_;
+        data->velocityEast_ = pvt->velocityEast_;
+        data->velocityDown_ = pvt->velocityDown_;
+        data->horizontalAccuracy_ = pvt->horizontalAccuracy_;
+        data->verticalAccuracy_ = pvt->verticalAccuracy_;
+    }
+
+    osMutexRelease(data->mutex_);
+}
+
+/* Receiver configuration ----------------------------------------------------*/
+
+/**
+ * Restarts the reception at another baud rate. Bytes on the way are lost,
+ * those already queued stay in the stream buffer.
+ */
+static void setBaudRate(uint32_t baudRate)
+{
+    if (huart4.Init.BaudRate == baudRate)
+    {
+        return;
+    }
+
+    // Nothing may copy from the DMA buffer while the stream restarts
+    __HAL_UART_DISABLE_IT(&huart4, UART_IT_IDLE);
+    HAL_UART_AbortReceive(&huart4);
+
+    taskENTER_CRITICAL();
+    dmaReadIndex = 0;
+    taskEXIT_CRITICAL();
+
+    huart4.Init.BaudRate = baudRate;
+    HAL_UART_Init(&huart4);
+    startReception();
+}
+
+/**
+ * Sends a configuration frame and moves on to next, which may wait for
+ * its acknowledgement.
+ */
+static void sendConfig(uint16_t length, GpsConfigState next)
+{
+    ackReceived = 0;
+    configDeadlineMs = HAL_GetTick() + CONFIG_TIMEOUT_MS;
+    configState = next;
+    HAL_UART_Transmit_IT(&huart4, txFrame, length);
+}
+
+static void retryConfig(void)
+{
+    if (++configAttempts < GPS_CONFIG_ATTEMPTS)
+    {
+        configState = GPS_CONFIG_PORT;
+        return;
+    }
+
+    // An NMEA only receiver, or none at all
+    configState = GPS_CONFIG_FAILED;
+    setBaudRate(GPS_DEFAULT_BAUD_RATE);
+}
+
+/**
+ * Called with each acknowledgement received.
+ */
+static void acknowledged(const UbxAck* ack)
+{
+    static const uint8_t EXPECTED[] =
+    {
+        [GPS_CONFIG_PORT_ACK] = UBX_CFG_PRT,
+        [GPS_CONFIG_RATE] = UBX_CFG_RATE,
+        [GPS_CONFIG_MESSAGE] = UBX_CFG_MSG
+    };
+
+    if (configState >= GPS_CONFIG_PORT_ACK && configState <= GPS_CONFIG_MESSAGE && ack->class_ == UBX_CLASS_CFG && ack->id_ == EXPECTED[configState])
+    {
+        ackReceived = ack->acknowledged_ ? 1 : -1;
+    }
+}
+
+/**
+ * @return  1 once the message being configured was acknowledged. Retries
+ *          the configuration if it was rejected or timed out.
+ */
+static int waitForAck(uint32_t now)
+{
+    if (ackReceived == 1)
+    {
+        return 1;
+    }
+
+    if (ackReceived == -1 || (int32_t) (now - configDeadlineMs) >= 0)
+    {
+        retryConfig();
+    }
+
+    return 0;
+}
+
+/**
+ * One step of the receiver configuration, see ReadGps.h.
+ */
+static void configure(void)
+{
+    uint32_t now = HAL_GetTick();
+
+    // A frame still going out
+    if (huart4.gState != HAL_UART_STATE_READY)
+    {
+        return;
+    }
+
+    switch (configState)
+    {
+        case GPS_CONFIG_PORT:
+            setBaudRate(GPS_DEFAULT_BAUD_RATE);
+            sendConfig(ubxCfgPrt(GPS_BAUD_RATE, UBX_PROTOCOL_UBX, UBX_PROTOCOL_UBX, txFrame), GPS_CONFIG_BAUD);
+            break;
+
+        case GPS_CONFIG_BAUD:
+            // CFG-PRT went out a run ago, the receiver has switched by now
+            setBaudRate(GPS_BAUD_RATE);
+            sendConfig(ubxCfgPrt(GPS_BAUD_RATE, UBX_PROTOCOL_UBX, UBX_PROTOCOL_UBX, txFrame), GPS_CONFIG_PORT_ACK);
+            break;
+
+        case GPS_CONFIG_PORT_ACK:
+            if (waitForAck(now))
+            {
+                sendConfig(ubxCfgRate(GPS_MEASUREMENT_PERIOD_MS, txFrame), GPS_CONFIG_RATE);
+            }
+
+            break;
+
+        case GPS_CONFIG_RATE:
+            if (waitForAck(now))
+            {
+                sendConfig(ubxCfgMsg(UBX_CLASS_NAV, UBX_NAV_PVT, 1, txFrame), GPS_CONFIG_MESSAGE);
+            }
+
+            break;
+
+        case GPS_CONFIG_MESSAGE:
+            if (waitForAck(now))
+            {
+                configState = GPS_CONFIGURED;
+                configurations++;
+                lastNavPvtMs = now;
+            }
+
+            break;
+
+        case GPS_CONFIGURED:
+            if (now - lastNavPvtMs >= SILENCE_TIMEOUT_MS)
+            {
+                configAttempts = 0;
+                configState = GPS_CONFIG_PORT;
+            }
+
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Job -----------------------------------------------------------------------*/
+
+/**
+ * The navigation epoch of a message whose last byte arrived at timeUs:
+ * before it, the message took its time on the wire and the receiver its
+ * solution latency.
+ */
+static uint32_t epochTimeUs(uint32_t timeUs, uint32_t messageBytes)
+{
+    return timeUs - messageBytes * (10 * 1000000 / huart4.Init.BaudRate) - SOLUTION_LATENCY_US;
+}
+
+static void parseUbx(uint8_t byte, uint32_t timeUs)
+{
+    UbxFrame frame;
+    UbxNavPvt pvt;
+    UbxAck ack;
 
-            // Keeps printing tokens while one of the delimiters present in gps_item
-            while (gps_item != NULL)
+    switch (ubxParse(&ubxParser, byte, &frame))
+    {
+        case UBX_OK:
+            frames++;
+
+            if (ubxDecodeNavPvt(&frame, &pvt))
+            {
+                lastNavPvtMs = HAL_GetTick();
+                updateFromNavPvt(&pvt, epochTimeUs(timeUs, UBX_FRAME_OVERHEAD + UBX_NAV_PVT_LENGTH));
+            }
+            else if (ubxDecodeAck(&frame, &ack))
             {
-                switch (counter)
-                {
-                    // case 0 is when gps_item is "$GPGGA"
-                    case 1:
-                    {
-                        data->time_ = (uint32_t) (atof(gps_item) * 100); // HHMMSS.SS format. Time is multiplied by 100.
-                        break;
-                    }
-
-                    case 2:
-                    {
-                        double latitude = (atof(gps_item)); // DDMM.MMMMMM
-                        data->latitude_.degrees_ = (int32_t) latitude / 100; // First 2 numbers are the latitude degrees
-                        data->latitude_.minutes_ = (int32_t) ((latitude - data->latitude_.degrees_ * 100) * 100000); // Latitude minutes is multplied by 100000
-                        break;
-                    }
-
-                    case 3:	// Latitude direction
-                    {
-                        direction = *gps_item;
-
-                        // N is represented as a positive value
-                        // S is represented as a negative value
-                        if (direction == 'S')
-                        {
-                            data->latitude_.degrees_ *= -1;
-                            data->latitude_.minutes_ *= -1;
-                        }
-
-                        break;
-                    }
-
-                    case 4:
-                    {
-                        double longitude = (atof(gps_item)); // DDMM.MMMMMM
-                        data->longitude_.degrees_ = (int32_t) longitude / 100; // First 2 numbers are the longitude degrees
-                        data->longitude_.minutes_ = (int32_t) ((longitude - data->longitude_.degrees_ * 100) * 100000); // Longitude minutes is multplied by 100000
-                        break;
-                    }
-
-                    case 5: // Longitude direction
-                    {
-                        direction = *gps_item;
-
-                        // E is represented as a positive value
-                        // W is represented as a negative value
-                        if (direction == 'W')
-                        {
-                            data->longitude_.degrees_ *= -1;
-                            data->longitude_.minutes_ *= -1;
-                        }
-
-                        break;
-                    }
-
-                    case 9:
-                    {
-                        data->antennaAltitude_.altitude_ = (int32_t) (atof(gps_item) * 10); // Antenna altitude is multiplied by 10
-                        break;
-                    }
-
-                    case 10: // Antenna altitude unit
-                    {
-                        data->antennaAltitude_.unit_ = *gps_item;
-                        break;
-                    }
-
-                    case 11:
-                    {
-                        data->geoidAltitude_.altitude_ = (int32_t) (atof(gps_item) * 10); // Geoid altitude is multiplied by 10
-                        break;
-                    }
-
-                    case 12: // Geoid altitude unit
-                    {
-                        data->geoidAltitude_.unit_ = *gps_item;
-                        break;
-                    }
-
-                    default:
-                        break;
-                }
-
-                counter++;
-                gps_item = strtok(NULL, ",");
+                acknowledged(&ack);
             }
+
+            break;
+
+        case UBX_CHECKSUM_ERROR:
+            checksumErrors++;
+            break;
+
+        case UBX_FORMAT_ERROR:
+            formatErrors++;
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void parseNmea(char c, uint32_t timeUs)
+{
+    NmeaSentence sentence;
+
+    switch (nmeaParse(&nmeaParser, c, &sentence))
+    {
+        case NMEA_OK:
+            sentences++;
+            // The parser counted the sentence up to its checksum, the last character received
+            updateFromSentence(&sentence, epochTimeUs(timeUs, nmeaParser.length_));
+            break;
+
+        case NMEA_CHECKSUM_ERROR:
+            checksumErrors++;
+            break;
+
+        case NMEA_FORMAT_ERROR:
+            formatErrors++;
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ * Drains the bytes received since the last run through the parsers, then
+ * takes the next step of the receiver configuration. Sensor schedule job.
+ */
+void readGpsJob(void)
+{
+    uint8_t bytes[64];
+    uint32_t queued;
+    uint32_t lastByteUs;
+
+    taskENTER_CRITICAL();
+    queued = queuedBytes;
+    lastByteUs = queuedTimeUs;
+    taskEXIT_CRITICAL();
+
+    // Start bit, 8 data bits and one stop bit
+    uint32_t byteTimeUs = 10 * 1000000 / huart4.Init.BaudRate;
+    // Binary payloads are full of characters that would start NMEA sentences
+    int nmea = configState != GPS_CONFIGURED;
+
+    while (drainedBytes != queued)
+    {
+        uint32_t wanted = queued - drainedBytes < sizeof(bytes) ? queued - drainedBytes : sizeof(bytes);
+        size_t length = xStreamBufferReceive(stream, bytes, wanted, 0);
+
+        if (length == 0)
+        {
+            break;
         }
 
-        // Subtract geoid altitude from antenna altitude to get Height Above Ellipsoid (HAE)
-        data->totalAltitude_.altitude_ = data->antennaAltitude_.altitude_ - data->geoidAltitude_.altitude_;
-        data->totalAltitude_.unit_ = data->antennaAltitude_.unit_;
+        for (size_t i = 0; i < length; i++)
+        {
+            drainedBytes++;
+
+            // The bytes queued after this one arrived one byte time apart
+            uint32_t timeUs = lastByteUs - (queued - drainedBytes) * byteTimeUs;
+
+            parseUbx(bytes[i], timeUs);
 
-        data->parseFlag_ = 0;
-        osMutexRelease(data->mutex_);
+            if (nmea)
+            {
+                parseNmea(bytes[i], timeUs);
+            }
+        }
+    }
+
+    if (configState != GPS_CONFIG_FAILED)
+    {
+        configure();
     }
 }
@@ -0,0 +1,227 @@
+/**
+  ******************************************************************************
+  * File Name          : SensorSchedule.c
+  * Description        : Cyclic executive that runs the sensor reads from a
+  *                      table of periods and offsets, released by TIM7.
+  ******************************************************************************
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "stm32f4xx.h"
+#include "stm32f4xx_hal_conf.h"
+#include "cmsis_os.h"
+
+#include "SensorSchedule.h"
+#include "ReadAccelGyroMagnetism.h"
+#include "ReadBarometer.h"
+#include "ReadCombustionChamberPressure.h"
+#include "ReadGps.h"
+#include "ReadOxidizerTankPressure.h"
+#include "Data.h"
+#include "TaskStats.h"
+#include "MemorySections.h"
+
+#define SENSOR_SCHEDULE_JOB(job, periodMs, offsetMs, budgetUs) { #job, job, periodMs, offsetMs, budgetUs },
+
+// TIM7 counts at 1 MHz, see MX_TIM7_Init
+#define TIMER_TICKS_PER_MS 1000
+
+typedef struct
+{
+    const char* name_;
+    void        (*run_)(void);
+    uint16_t    periodMs_;
+    uint16_t    offsetMs_;
+    uint16_t    budgetUs_;
+} SensorScheduleJob;
+
+extern TIM_HandleTypeDef htim7;
+
+const char SENSOR_SCHEDULE_LOG_HEADER[] =
+    "elapsedTime(ms),"
+    "currentFlightPhase,"
+    "job,"
+    "period(ms),"
+    "offset(ms),"
+    "budget(us),"
+    "runs,"
+    "maxJob(us),"
+    "budgetOverruns,"
+    "minStart(us),"
+    "maxStart(us),"
+    "frames,"
+    "frameOverruns,"
+    "skippedFrames\n";
+
+static const SensorScheduleJob jobs[] =
+{
+    SENSOR_SCHEDULE_TABLE(SENSOR_SCHEDULE_JOB)
+};
+
+#define JOB_COUNT (sizeof(jobs) / sizeof(jobs[0]))
+
+// Fails to compile if the table outgrows the snapshot
+typedef char JobTableFitsSnapshot[JOB_COUNT <= SENSOR_SCHEDULE_MAX_JOBS ? 1 : -1];
+
+static SensorScheduleJobStats jobStats[JOB_COUNT] CCM_BSS;
+static uint32_t frames = 0;
+static uint32_t skippedFrames = 0;
+
+// Shared with the TIM7 interrupt
+static TaskHandle_t scheduleTask = NULL;
+static volatile uint32_t releasedFrame = 0;
+static volatile uint32_t nextFrame = 0;
+static volatile uint8_t frameRunning = 0;
+static volatile uint8_t frameOverrun = 0;
+static volatile uint32_t frameOverruns = 0;
+
+void sensorScheduleRelease(void)
+{
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+    if (scheduleTask == NULL)
+    {
+        return;
+    }
+
+    if (frameRunning)
+    {
+        frameOverrun = 1;
+        frameOverruns++;
+    }
+
+    releasedFrame = nextFrame;
+    nextFrame = (nextFrame + 1) % SENSOR_SCHEDULE_FRAME_COUNT;
+
+    vTaskNotifyGiveFromISR(scheduleTask, &higherPriorityTaskWoken);
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+static void runJob(int index)
+{
+    const SensorScheduleJob* job = &jobs[index];
+    SensorScheduleJobStats* stats = &jobStats[index];
+    uint32_t startUs = htim7.Instance->CNT;
+    uint32_t startCycles = DWT->CYCCNT;
+
+    job->run_();
+
+    uint32_t us = (DWT->CYCCNT - startCycles) / (SystemCoreClock / 1000000);
+
+    if (stats->runs_ == 0 || startUs < stats->minStartUs_)
+    {
+        stats->minStartUs_ = startUs;
+    }
+
+    if (startUs > stats->maxStartUs_)
+    {
+        stats->maxStartUs_ = startUs;
+    }
+
+    if (us > stats->maxUs_)
+    {
+        stats->maxUs_ = us;
+    }
+
+    stats->budgetOverruns_ += us > job->budgetUs_;
+    stats->runs_++;
+}
+
+static void runFrame(uint32_t frame)
+{
+    uint32_t timeMs = frame * SENSOR_SCHEDULE_MINOR_FRAME_MS;
+
+    for (int i = 0; i < JOB_COUNT; i++)
+    {
+        if (timeMs % jobs[i].periodMs_ == jobs[i].offsetMs_)
+        {
+            runJob(i);
+        }
+    }
+}
+
+void sensorScheduleTask(void const* arg)
+{
+    AllData* data = (AllData*) arg;
+
+    for (int i = 0; i < JOB_COUNT; i++)
+    {
+        jobStats[i].name_ = jobs[i].name_;
+        jobStats[i].periodMs_ = jobs[i].periodMs_;
+        jobStats[i].offsetMs_ = jobs[i].offsetMs_;
+        jobStats[i].budgetUs_ = jobs[i].budgetUs_;
+    }
+
+    // The IMU needs a second after power up, so it goes last
+    readBarometerInit(data->barometerData_);
+    readCombustionChamberPressureInit(data->combustionChamberPressureData_);
+    readOxidizerTankPressureInit(data->oxidizerTankPressureData_);
+    readGpsInit(data->gpsData_);
+    readAccelGyroMagnetismInit(data->accelGyroMagnetismData_);
+
+    scheduleTask = xTaskGetCurrentTaskHandle();
+    __HAL_TIM_SET_AUTORELOAD(&htim7, SENSOR_SCHEDULE_MINOR_FRAME_MS * TIMER_TICKS_PER_MS - 1);
+    HAL_TIM_Base_Start_IT(&htim7);
+
+    for (;;)
+    {
+        // More than one release means frames went by while the previous one ran
+        uint32_t releases = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        taskStatsStartJob(SENSOR_SCHEDULE_MINOR_FRAME_MS);
+        frameRunning = 1;
+        runFrame(releasedFrame);
+        frameRunning = 0;
+
+        frames++;
+        skippedFrames += releases - 1;
+        taskStatsEndJob(frameOverrun);
+        frameOverrun = 0;
+    }
+}
+
+/**
+ * Copies the schedule statistics, totals since boot.
+ */
+void sensorScheduleRead(SensorScheduleSnapshot* snapshot)
+{
+    vTaskSuspendAll();
+    snapshot->timeMs_ = HAL_GetTick();
+    snapshot->frames_ = frames;
+    snapshot->frameOverruns_ = frameOverruns;
+    snapshot->skippedFrames_ = skippedFrames;
+    snapshot->jobCount_ = JOB_COUNT;
+    memcpy(snapshot->jobs_, jobStats, sizeof(jobStats));
+    xTaskResumeAll();
+}
+
+/**
+ * Formats one job of a snapshot as a line of the sensor schedule log.
+ *
+ * @return  Number of characters written, at most SENSOR_SCHEDULE_LOG_ENTRY_MAX_LENGTH.
+ */
+int formatSensorScheduleEntry(const SensorScheduleSnapshot* snapshot, int job, uint8_t flightPhase, char* buffer)
+{
+    const SensorScheduleJobStats* stats = &snapshot->jobs_[job];
+
+    return sprintf(
+               buffer,
+               "%lu,%u,%s,%u,%u,%u,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n",
+               (unsigned long) snapshot->timeMs_,
+               flightPhase,
+               stats->name_,
+               stats->periodMs_,
+               stats->offsetMs_,
+               stats->budgetUs_,
+               (unsigned long) stats->runs_,
+               (unsigned long) stats->maxUs_,
+               (unsigned long) stats->budgetOverruns_,
+               (unsigned long) stats->minStartUs_,
+               (unsigned long) stats->maxStartUs_,
+               (unsigned long) snapshot->frames_,
+               (unsigned long) snapshot->frameOverruns_,
+               (unsigned long) snapshot->skippedFrames_
+           );
+}
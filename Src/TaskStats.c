@@ -0,0 +1,278 @@
+/**
+  ******************************************************************************
+  * File Name          : TaskStats.c
+  * Description        : Per-task CPU time, job execution time histograms and
+  *                      deadline misses, measured with the DWT cycle counter.
+  ******************************************************************************
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "stm32f4xx.h"
+#include "stm32f4xx_hal_conf.h"
+#include "cmsis_os.h"
+
+#include "TaskStats.h"
+#include "MemorySections.h"
+
+// FreeRTOS run time counters are 32 bit, in units of 1024 cycles they wrap after 7 hours at 168 MHz
+#define RUN_TIME_COUNTER_SHIFT 10
+
+typedef struct
+{
+    const char* name_;
+    uint32_t    periodMs_;
+    uint64_t    cycles_; // CPU cycles spent running, up to the last switch out
+    uint64_t    jobStartCycles_;
+    uint8_t     jobRunning_;
+    uint32_t    jobs_;
+    uint32_t    minJobUs_;
+    uint32_t    maxJobUs_;
+    uint64_t    totalJobUs_;
+    uint32_t    deadlineMisses_;
+    uint32_t    histogram_[TASK_STATS_HISTOGRAM_BINS];
+} TaskStats;
+
+// Must match TASK_STATS_HISTOGRAM_BINS and TASK_STATS_FIRST_BIN_US
+const char TASK_STATS_LOG_HEADER[] =
+    "elapsedTime(ms),"
+    "currentFlightPhase,"
+    "task,"
+    "period(ms),"
+    "cpu(permille),"
+    "jobs,"
+    "minJob(us),"
+    "avgJob(us),"
+    "maxJob(us),"
+    "deadlineMisses,"
+    "jobsUnder256us,"
+    "jobsUnder512us,"
+    "jobsUnder1024us,"
+    "jobsUnder2048us,"
+    "jobsUnder4096us,"
+    "jobsUnder8192us,"
+    "jobsUnder16384us,"
+    "jobsOver16384us\n";
+
+// Touched on every context switch
+static TaskStats taskStats[TASK_STATS_MAX_TASKS] CCM_BSS;
+static uint8_t taskCount = 0;
+
+// DWT->CYCCNT extended to 64 bits, only touched from the switch hooks or with the scheduler suspended
+static uint32_t lastCycleCount = 0;
+static uint32_t cycleCountWraps = 0;
+static uint64_t switchedInCycles = 0;
+
+/**
+ * Extends the cycle counter past its 25 s wrap at 168 MHz. Periodic tasks
+ * switch many times a second, so no wrap is ever missed.
+ */
+static uint64_t readCycles()
+{
+    uint32_t count = DWT->CYCCNT;
+
+    if (count < lastCycleCount)
+    {
+        cycleCountWraps++;
+    }
+
+    lastCycleCount = count;
+    return ((uint64_t) cycleCountWraps << 32) | count;
+}
+
+/**
+ * Cycles the calling task has run for, including its current time slice.
+ * Call with the scheduler suspended.
+ */
+static uint64_t currentTaskCycles(TaskStats* stats)
+{
+    return stats->cycles_ + (readCycles() - switchedInCycles);
+}
+
+static uint32_t cyclesToUs(uint64_t cycles)
+{
+    uint64_t us = cycles / (SystemCoreClock / 1000000);
+    return us > UINT32_MAX ? UINT32_MAX : (uint32_t) us;
+}
+
+static void recordJob(TaskStats* stats, uint32_t us)
+{
+    int bin = 0;
+
+    while (bin < TASK_STATS_HISTOGRAM_BINS - 1 && us >= ((uint32_t) TASK_STATS_FIRST_BIN_US << bin))
+    {
+        bin++;
+    }
+
+    if (stats->jobs_ == 0 || us < stats->minJobUs_)
+    {
+        stats->minJobUs_ = us;
+    }
+
+    if (us > stats->maxJobUs_)
+    {
+        stats->maxJobUs_ = us;
+    }
+
+    stats->jobs_++;
+    stats->totalJobUs_ += us;
+    stats->histogram_[bin]++;
+}
+
+void taskStatsStartCycleCounter()
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    lastCycleCount = 0;
+    cycleCountWraps = 0;
+    switchedInCycles = 0;
+}
+
+uint32_t taskStatsRunTimeCounter()
+{
+    return (uint32_t) (readCycles() >> RUN_TIME_COUNTER_SHIFT);
+}
+
+void taskStatsSwitchedIn(void* tag)
+{
+    switchedInCycles = readCycles();
+}
+
+void taskStatsSwitchedOut(void* tag)
+{
+    TaskStats* stats = (TaskStats*) tag;
+
+    if (stats != NULL)
+    {
+        stats->cycles_ += readCycles() - switchedInCycles;
+    }
+}
+
+void taskStatsRegister(void* thread)
+{
+    if (thread == NULL || taskCount == TASK_STATS_MAX_TASKS)
+    {
+        return;
+    }
+
+    TaskStats* stats = &taskStats[taskCount++];
+    memset(stats, 0, sizeof(TaskStats));
+    stats->name_ = pcTaskGetName((TaskHandle_t) thread);
+    vTaskSetApplicationTaskTag((TaskHandle_t) thread, (TaskHookFunction_t) stats);
+}
+
+void taskStatsEndJob(uint8_t deadlineMissed)
+{
+    TaskStats* stats = (TaskStats*) xTaskGetApplicationTaskTag(NULL);
+
+    if (stats != NULL && stats->jobRunning_)
+    {
+        vTaskSuspendAll();
+        recordJob(stats, cyclesToUs(currentTaskCycles(stats) - stats->jobStartCycles_));
+        stats->deadlineMisses_ += deadlineMissed;
+        stats->jobRunning_ = 0;
+        xTaskResumeAll();
+    }
+}
+
+void taskStatsStartJob(uint32_t period)
+{
+    TaskStats* stats = (TaskStats*) xTaskGetApplicationTaskTag(NULL);
+
+    if (stats != NULL)
+    {
+        vTaskSuspendAll();
+        stats->periodMs_ = period;
+        stats->jobStartCycles_ = currentTaskCycles(stats);
+        stats->jobRunning_ = 1;
+        xTaskResumeAll();
+    }
+}
+
+void taskStatsDelayUntil(uint32_t* previousWakeTime, uint32_t period)
+{
+    // The job released at previousWakeTime had to end before the next release
+    taskStatsEndJob((uint32_t) (osKernelSysTick() - *previousWakeTime) >= period);
+    osDelayUntil(previousWakeTime, period);
+    taskStatsStartJob(period);
+}
+
+/**
+ * Copies every task's statistics. CPU load is over the interval since the
+ * previous read with the same window, min/avg/max, histograms and deadline
+ * misses are totals since boot. Snapshots are large, keep them off task stacks.
+ */
+void taskStatsRead(TaskStatsSnapshot* snapshot, TaskStatsWindow* window)
+{
+    uint64_t busyCycles = 0;
+
+    vTaskSuspendAll();
+    uint64_t totalCycles = readCycles();
+    uint64_t elapsed = totalCycles - window->totalCycles_;
+    TaskStats* current = (TaskStats*) xTaskGetApplicationTaskTag(NULL);
+
+    snapshot->timeMs_ = HAL_GetTick();
+    snapshot->taskCount_ = taskCount;
+    window->totalCycles_ = totalCycles;
+
+    for (int i = 0; i < taskCount; i++)
+    {
+        const TaskStats* stats = &taskStats[i];
+        TaskStatsEntry* entry = &snapshot->tasks_[i];
+        // Include the reading task's current slice so its own load is not under reported
+        uint64_t cycles = stats == current ? currentTaskCycles(current) : stats->cycles_;
+        uint64_t taskCycles = cycles - window->taskCycles_[i];
+
+        window->taskCycles_[i] = cycles;
+        busyCycles += taskCycles;
+
+        entry->name_ = stats->name_;
+        entry->periodMs_ = stats->periodMs_;
+        entry->cpuPermille_ = elapsed ? (uint16_t) (taskCycles * 1000 / elapsed) : 0;
+        entry->jobs_ = stats->jobs_;
+        entry->minJobUs_ = stats->minJobUs_;
+        entry->avgJobUs_ = stats->jobs_ ? (uint32_t) (stats->totalJobUs_ / stats->jobs_) : 0;
+        entry->maxJobUs_ = stats->maxJobUs_;
+        entry->deadlineMisses_ = stats->deadlineMisses_;
+        memcpy(entry->histogram_, stats->histogram_, sizeof(entry->histogram_));
+    }
+
+    xTaskResumeAll();
+
+    snapshot->cpuLoadPermille_ = elapsed ? (uint16_t) (busyCycles * 1000 / elapsed) : 0;
+}
+
+/**
+ * Formats one task of a snapshot as a line of the task stats log.
+ *
+ * @return  Number of characters written, at most TASK_STATS_LOG_ENTRY_MAX_LENGTH.
+ */
+int formatTaskStatsEntry(const TaskStatsSnapshot* snapshot, int task, uint8_t flightPhase, char* buffer)
+{
+    const TaskStatsEntry* entry = &snapshot->tasks_[task];
+    int length = sprintf(
+                     buffer,
+                     "%lu,%u,%s,%lu,%u,%lu,%lu,%lu,%lu,%lu",
+                     (unsigned long) snapshot->timeMs_,
+                     flightPhase,
+                     entry->name_,
+                     (unsigned long) entry->periodMs_,
+                     entry->cpuPermille_,
+                     (unsigned long) entry->jobs_,
+                     (unsigned long) entry->minJobUs_,
+                     (unsigned long) entry->avgJobUs_,
+                     (unsigned long) entry->maxJobUs_,
+                     (unsigned long) entry->deadlineMisses_
+                 );
+
+    for (int bin = 0; bin < TASK_STATS_HISTOGRAM_BINS; bin++)
+    {
+        length += sprintf(buffer + length, ",%lu", (unsigned long) entry->histogram_[bin]);
+    }
+
+    buffer[length++] = '\n';
+    buffer[length] = '\0';
+    return length;
+}
@@ -0,0 +1,102 @@
+/**
+  ******************************************************************************
+  * File Name          : Timebase.c
+  * Description        : Microsecond clock on TIM5, extended to 64 bits by its
+  *                      update interrupt.
+  ******************************************************************************
+*/
+
+#include "stm32f4xx.h"
+#include "stm32f4xx_hal_conf.h"
+
+#include "Timebase.h"
+
+extern TIM_HandleTypeDef htim5;
+
+static volatile uint32_t overflows = 0;
+static volatile TimebaseAlarmHandler alarmHandler = NULL;
+
+/**
+ * Starts the counter. MX_TIM5_Init must have run.
+ */
+void timebaseInit(void)
+{
+    // HAL_TIM_Base_Init sets the update flag when it loads the prescaler, which would count as a wrap
+    __HAL_TIM_CLEAR_FLAG(&htim5, TIM_FLAG_UPDATE);
+    __HAL_TIM_SET_COUNTER(&htim5, 0);
+    HAL_TIM_Base_Start_IT(&htim5);
+}
+
+uint32_t timebaseMicros(void)
+{
+    return htim5.Instance->CNT;
+}
+
+uint64_t timebaseMicros64(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t high = overflows;
+    uint32_t low = htim5.Instance->CNT;
+
+    // The counter wrapped but the interrupt has not run yet, because it is
+    // masked or the caller preempts it. A low count means it wrapped before
+    // the read rather than after.
+    if (__HAL_TIM_GET_FLAG(&htim5, TIM_FLAG_UPDATE) && low < 0x80000000u)
+    {
+        high++;
+    }
+
+    __set_PRIMASK(primask);
+    return ((uint64_t) high << 32) | low;
+}
+
+uint32_t timebaseMillis(void)
+{
+    return (uint32_t) (timebaseMicros64() / 1000);
+}
+
+void timebaseOverflow(void)
+{
+    overflows++;
+}
+
+void timebaseSetAlarm(uint32_t timeUs, TimebaseAlarmHandler handler)
+{
+    // Not HAL_TIM_OC_Stop_IT, it stops the counter once no channel is enabled
+    __HAL_TIM_DISABLE_IT(&htim5, TIM_IT_CC1);
+    alarmHandler = handler;
+    __HAL_TIM_SET_COMPARE(&htim5, TIM_CHANNEL_1, timeUs);
+    __HAL_TIM_CLEAR_FLAG(&htim5, TIM_FLAG_CC1);
+    __HAL_TIM_ENABLE_IT(&htim5, TIM_IT_CC1);
+
+    // A compare already passed only matches again after a wrap, so raise it now.
+    // Had it matched since the flag was cleared, the flag is set just once. The
+    // compare moves to now so the handler's CNT - CCR1 is its entry latency.
+    if ((int32_t) (timeUs - htim5.Instance->CNT) <= 0)
+    {
+        __HAL_TIM_SET_COMPARE(&htim5, TIM_CHANNEL_1, htim5.Instance->CNT);
+        htim5.Instance->EGR = TIM_EGR_CC1G;
+    }
+}
+
+void timebaseCancelAlarm(void)
+{
+    __HAL_TIM_DISABLE_IT(&htim5, TIM_IT_CC1);
+    __HAL_TIM_CLEAR_FLAG(&htim5, TIM_FLAG_CC1);
+    alarmHandler = NULL;
+}
+
+void timebaseAlarm(void)
+{
+    TimebaseAlarmHandler handler = alarmHandler;
+
+    __HAL_TIM_DISABLE_IT(&htim5, TIM_IT_CC1);
+    alarmHandler = NULL;
+
+    if (handler != NULL)
+    {
+        handler();
+    }
+}
@@ -0,0 +1,96 @@
+/**
+  ******************************************************************************
+  * File Name          : Trace.c
+  * Description        : Lock free ring of timestamped trace events, written
+  *                      from tasks and interrupts, drained by one reader.
+  ******************************************************************************
+*/
+
+#include "stm32f4xx.h"
+#include "stm32f4xx_hal_conf.h"
+
+#include "Trace.h"
+#include "Timebase.h"
+#include "MemorySections.h"
+
+#define RING_MASK (TRACE_RING_SIZE - 1)
+// Laps are stored plus one, so a slot that was never written does not match lap 0
+#define LAP_MASK 0x7F
+#define LAP_WRITING 0xFF
+#define LAP(index) ((uint8_t) ((((index) >> TRACE_RING_BITS) & LAP_MASK) + 1))
+
+static TraceEvent ring[TRACE_RING_SIZE] CCM_BSS;
+static uint32_t head = 0; // Slots claimed by writers
+static uint32_t tail = 0; // Next slot to read, only touched by the reader
+
+#if TRACE
+void trace(TraceId id, uint16_t arg)
+{
+    uint32_t index = __atomic_fetch_add(&head, 1, __ATOMIC_RELAXED);
+    volatile TraceEvent* event = &ring[index & RING_MASK];
+
+    event->lap_ = LAP_WRITING;
+    event->cycles_ = DWT->CYCCNT;
+    event->arg_ = arg;
+    event->id_ = id;
+    event->lap_ = LAP(index);
+}
+#endif
+
+int traceRead(TraceEvent* events, int maxEvents, uint32_t* lost)
+{
+    uint32_t claimed = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    int count = 0;
+
+    *lost = 0;
+
+    while (count < maxEvents && tail != claimed)
+    {
+        if (claimed - tail > TRACE_RING_SIZE)
+        {
+            // Writers went round the ring since the last read
+            *lost += claimed - tail - TRACE_RING_SIZE;
+            tail = claimed - TRACE_RING_SIZE;
+        }
+
+        volatile TraceEvent* slot = &ring[tail & RING_MASK];
+        uint8_t lap = LAP(tail);
+
+        if (slot->lap_ == lap)
+        {
+            events[count].cycles_ = slot->cycles_;
+            events[count].arg_ = slot->arg_;
+            events[count].id_ = slot->id_;
+            events[count].lap_ = lap;
+
+            if (slot->lap_ == lap)
+            {
+                count++;
+                tail++;
+                continue;
+            }
+        }
+
+        // The slot is being written, or was overwritten while it was copied
+        claimed = __atomic_load_n(&head, __ATOMIC_RELAXED);
+
+        if (claimed - tail <= TRACE_RING_SIZE)
+        {
+            // Still being written, pick it up on the next read
+            break;
+        }
+    }
+
+    return count;
+}
+
+void traceSync(uint32_t* cycles, uint64_t* micros)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    *cycles = DWT->CYCCNT;
+    *micros = timebaseMicros64();
+
+    __set_PRIMASK(primask);
+}
@@ -5,6 +5,11 @@
 #include "Utils.h"
 #include "FlightPhase.h"
 #include "Data.h"
+#include "TaskStats.h"
+#include "MemoryStats.h"
+#include "IsrStats.h"
+#include "MemorySections.h"
+#include "Trace.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -32,12 +37,15 @@ static const int8_t LOWER_VALVE_STATUS_HEADER_BYTE = 0x39;
 #define F1_REPLACEMENT_1 (0xF1)
 #define F1_REPLACEMENT_2 (0xF3)
 #define FLAGS_AND_CRC_SIZE (6) //1 byte for header flag, 1 byte for ender flag, 4 bytes for crc
-#define IMU_SERIAL_MSG_SIZE (37)
-#define BAROMETER_SERIAL_MSG_SIZE (9)
-#define GPS_SERIAL_MSG_SIZE (25)
-#define OXIDIZER_TANK_SERIAL_MSG_SIZE (5)
-#define COMBUSTION_CHAMBER_SERIAL_MSG_SIZE (5)
+// Sensor messages end with the sample time in us, see Timebase.h
+#define IMU_SERIAL_MSG_SIZE (41)
+#define BAROMETER_SERIAL_MSG_SIZE (13)
+#define GPS_SERIAL_MSG_SIZE (29)
+#define OXIDIZER_TANK_SERIAL_MSG_SIZE (9)
+#define COMBUSTION_CHAMBER_SERIAL_MSG_SIZE (9)
 #define ONE_BYTE_SERIAL_MSG_SIZE (2)
+#define TRACE_MESSAGES_PER_PERIOD (2)
+#define ENCODED_BUFFER_SIZE(messageSize) ((messageSize) * 2 + FLAGS_AND_CRC_SIZE) // Every byte stuffed
 
 static const uint8_t UART_TIMEOUT = 100;
 
@@ -85,6 +93,7 @@ void transmitImuData(AllData* data)
     int32_t magnetoX = -1;
     int32_t magnetoY = -1;
     int32_t magnetoZ = -1;
+    uint32_t sampleTime = 0;
 
     //obtain current values from sensors
     if (osMutexWait(data->accelGyroMagnetismData_->mutex_, 0) == osOK)
@@ -98,10 +107,11 @@ void transmitImuData(AllData* data)
         magnetoX = data->accelGyroMagnetismData_->magnetoX_;
         magnetoY = data->accelGyroMagnetismData_->magnetoY_;
         magnetoZ = data->accelGyroMagnetismData_->magnetoZ_;
+        sampleTime = data->accelGyroMagnetismData_->sampleTimeUs_;
         osMutexRelease(data->accelGyroMagnetismData_->mutex_);
     }
 
-    //construct the message in the format accelXYZ, gyroXYZ, MagnetoXYZ
+    //construct the message in the format accelXYZ, gyroXYZ, MagnetoXYZ, sample time
     uint8_t message[IMU_SERIAL_MSG_SIZE] = { 0 };
     int messageIndex = 0;
     message[0] = IMU_HEADER_BYTE;
@@ -124,6 +134,8 @@ void transmitImuData(AllData* data)
     messageIndex += 4;
     writeInt32ToArray(message, messageIndex, magnetoZ);
     messageIndex += 4;
+    writeInt32ToArray(message, messageIndex, sampleTime);
+    messageIndex += 4;
     //Find the final length of the encoded buffer based on number of overlaps
     int encodedMessageLength = IMU_SERIAL_MSG_SIZE;
 
@@ -137,29 +149,29 @@ void transmitImuData(AllData* data)
     }
 
     int bufferLength = encodedMessageLength + FLAGS_AND_CRC_SIZE;
-    //Dynamic allocate a buffer because variable length arrays are not allowed
-    uint8_t* buffer = malloc(bufferLength * sizeof(uint8_t));
+    uint8_t buffer[ENCODED_BUFFER_SIZE(IMU_SERIAL_MSG_SIZE)];
     //Encode the message and send it to ground systems and radio
     encodeMessage(message, IMU_SERIAL_MSG_SIZE, buffer);
 
     if ((getCurrentFlightPhase() == PRELAUNCH) || (getCurrentFlightPhase() == ARM) || (getCurrentFlightPhase() == BURN) || (IS_ABORT_PHASE))
     {
-        HAL_UART_Transmit(&huart2, &buffer, sizeof(buffer), UART_TIMEOUT);  // Ground Systems
+        HAL_UART_Transmit(&huart2, buffer, bufferLength, UART_TIMEOUT);  // Ground Systems
     }
 
-    HAL_UART_Transmit(&huart1, &buffer, sizeof(buffer), UART_TIMEOUT);  // Radio
-    free(buffer);
+    HAL_UART_Transmit(&huart1, buffer, bufferLength, UART_TIMEOUT);  // Radio
 }
 
 void transmitBarometerData(AllData* data)
 {
     int32_t pressure = -1;
     int32_t temperature = -1;
+    uint32_t sampleTime = 0;
 
     if (osMutexWait(data->barometerData_->mutex_, 0) == osOK)
     {
         pressure = data->barometerData_->pressure_;
         temperature = data->barometerData_->temperature_;
+        sampleTime = data->barometerData_->sampleTimeUs_;
         osMutexRelease(data->barometerData_->mutex_);
     }
 
@@ -171,6 +183,8 @@ void transmitBarometerData(AllData* data)
     messageIndex += 4;
     writeInt32ToArray(message, messageIndex, temperature);
     messageIndex += 4;
+    writeInt32ToArray(message, messageIndex, sampleTime);
+    messageIndex += 4;
     int encodedMessageLength = BAROMETER_SERIAL_MSG_SIZE;
 
     for (int i = 0; i < BAROMETER_SERIAL_MSG_SIZE; i++)
@@ -182,16 +196,15 @@ void transmitBarometerData(AllData* data)
     }
 
     int bufferLength = encodedMessageLength + FLAGS_AND_CRC_SIZE;
-    uint8_t* buffer = malloc(bufferLength * sizeof(uint8_t));
+    uint8_t buffer[ENCODED_BUFFER_SIZE(BAROMETER_SERIAL_MSG_SIZE)];
     encodeMessage(message, BAROMETER_SERIAL_MSG_SIZE, buffer);
 
     if ((getCurrentFlightPhase() == PRELAUNCH) || (getCurrentFlightPhase() == ARM) || (getCurrentFlightPhase() == BURN) || (IS_ABORT_PHASE))
     {
-        HAL_UART_Transmit(&huart2, &buffer, sizeof(buffer), UART_TIMEOUT);  // Ground Systems
+        HAL_UART_Transmit(&huart2, buffer, bufferLength, UART_TIMEOUT);  // Ground Systems
     }
 
-    HAL_UART_Transmit(&huart1, &buffer, sizeof(buffer), UART_TIMEOUT);  // Radio
-    free(buffer);
+    HAL_UART_Transmit(&huart1, buffer, bufferLength, UART_TIMEOUT);  // Radio
 }
 
 void transmitGpsData(AllData* data)
@@ -202,6 +215,7 @@ void transmitGpsData(AllData* data)
     int32_t longitude_degrees = -1;
     int32_t longitude_minutes = -1;
     int32_t altitude = -1;
+    uint32_t sampleTime = 0;
 
     if (osMutexWait(data->gpsData_->mutex_, 0) == osOK)
     {
@@ -214,6 +228,7 @@ void transmitGpsData(AllData* data)
         longitude_minutes = data->gpsData_->longitude_.minutes_;
 
         altitude = data->gpsData_->totalAltitude_.altitude_;
+        sampleTime = data->gpsData_->sampleTimeUs_;
 
         osMutexRelease(data->gpsData_->mutex_);
     }
@@ -234,6 +249,8 @@ void transmitGpsData(AllData* data)
     messageIndex += 4;
     writeInt32ToArray(message, messageIndex, altitude);
     messageIndex += 4;
+    writeInt32ToArray(message, messageIndex, sampleTime);
+    messageIndex += 4;
 
     int encodedMessageLength = GPS_SERIAL_MSG_SIZE;
 
@@ -246,25 +263,26 @@ void transmitGpsData(AllData* data)
     }
 
     int bufferLength = encodedMessageLength + FLAGS_AND_CRC_SIZE;
-    uint8_t* buffer = malloc(bufferLength * sizeof(uint8_t));
+    uint8_t buffer[ENCODED_BUFFER_SIZE(GPS_SERIAL_MSG_SIZE)];
     encodeMessage(message, GPS_SERIAL_MSG_SIZE, buffer);
 
     if ((getCurrentFlightPhase() == PRELAUNCH) || (getCurrentFlightPhase() == ARM) || (getCurrentFlightPhase() == BURN) || (IS_ABORT_PHASE))
     {
-        HAL_UART_Transmit(&huart2, &buffer, sizeof(buffer), UART_TIMEOUT); // Ground Systems
+        HAL_UART_Transmit(&huart2, buffer, bufferLength, UART_TIMEOUT); // Ground Systems
     }
 
-    HAL_UART_Transmit(&huart1, &buffer, sizeof(buffer), UART_TIMEOUT);  // Radio
-    free(buffer);
+    HAL_UART_Transmit(&huart1, buffer, bufferLength, UART_TIMEOUT);  // Radio
 }
 
 void transmitOxidizerTankData(AllData* data)
 {
     int32_t oxidizerTankPressure = -1;
+    uint32_t sampleTime = 0;
 
     if (osMutexWait(data->oxidizerTankPressureData_->mutex_, 0) == osOK)
     {
         oxidizerTankPressure = data->oxidizerTankPressureData_->pressure_;
+        sampleTime = data->oxidizerTankPressureData_->sampleTimeUs_;
         osMutexRelease(data->oxidizerTankPressureData_->mutex_);
     }
 
@@ -274,6 +292,8 @@ void transmitOxidizerTankData(AllData* data)
     messageIndex++;
     writeInt32ToArray(message, messageIndex, oxidizerTankPressure);
     messageIndex += 4;
+    writeInt32ToArray(message, messageIndex, sampleTime);
+    messageIndex += 4;
 
     int encodedMessageLength = OXIDIZER_TANK_SERIAL_MSG_SIZE;
 
@@ -286,25 +306,26 @@ void transmitOxidizerTankData(AllData* data)
     }
 
     int bufferLength = encodedMessageLength + FLAGS_AND_CRC_SIZE;
-    uint8_t* buffer = malloc(bufferLength * sizeof(uint8_t));
+    uint8_t buffer[ENCODED_BUFFER_SIZE(OXIDIZER_TANK_SERIAL_MSG_SIZE)];
     encodeMessage(message, OXIDIZER_TANK_SERIAL_MSG_SIZE, buffer);
 
     if ((getCurrentFlightPhase() == PRELAUNCH) || (getCurrentFlightPhase() == ARM) || (getCurrentFlightPhase() == BURN) || (IS_ABORT_PHASE))
     {
-        HAL_UART_Transmit(&huart2, &buffer, sizeof(buffer), UART_TIMEOUT);  // Ground Systems
+        HAL_UART_Transmit(&huart2, buffer, bufferLength, UART_TIMEOUT);  // Ground Systems
     }
 
-    HAL_UART_Transmit(&huart1, &buffer, sizeof(buffer), UART_TIMEOUT);  // Radio
-    free(buffer);
+    HAL_UART_Transmit(&huart1, buffer, bufferLength, UART_TIMEOUT);  // Radio
 }
 
 void transmitCombustionChamberData(AllData* data)
 {
     int32_t combustionChamberPressure = -1;
+    uint32_t sampleTime = 0;
 
     if (osMutexWait(data->combustionChamberPressureData_->mutex_, 0) == osOK)
     {
         combustionChamberPressure = data->combustionChamberPressureData_->pressure_;
+        sampleTime = data->combustionChamberPressureData_->sampleTimeUs_;
         osMutexRelease(data->combustionChamberPressureData_->mutex_);
     }
 
@@ -314,6 +335,8 @@ void transmitCombustionChamberData(AllData* data)
     messageIndex++;
     writeInt32ToArray(message, messageIndex, combustionChamberPressure);
     messageIndex += 4;
+    writeInt32ToArray(message, messageIndex, sampleTime);
+    messageIndex += 4;
 
     int encodedMessageLength = COMBUSTION_CHAMBER_SERIAL_MSG_SIZE;
 
@@ -326,16 +349,15 @@ void transmitCombustionChamberData(AllData* data)
     }
 
     int bufferLength = encodedMessageLength + FLAGS_AND_CRC_SIZE;
-    uint8_t* buffer = malloc(bufferLength * sizeof(uint8_t));
+    uint8_t buffer[ENCODED_BUFFER_SIZE(COMBUSTION_CHAMBER_SERIAL_MSG_SIZE)];
     encodeMessage(message, COMBUSTION_CHAMBER_SERIAL_MSG_SIZE, buffer);
 
     if ((getCurrentFlightPhase() == PRELAUNCH) || (getCurrentFlightPhase() == ARM) || (getCurrentFlightPhase() == BURN) || (IS_ABORT_PHASE))
     {
-        HAL_UART_Transmit(&huart2, &buffer, sizeof(buffer), UART_TIMEOUT);  // Ground Systems
+        HAL_UART_Transmit(&huart2, buffer, bufferLength, UART_TIMEOUT);  // Ground Systems
     }
 
-    HAL_UART_Transmit(&huart1, &buffer, sizeof(buffer), UART_TIMEOUT);  // Radio
-    free(buffer);
+    HAL_UART_Transmit(&huart1, buffer, bufferLength, UART_TIMEOUT);  // Radio
 }
 
 void transmitFlightPhaseData(AllData* data)
@@ -357,16 +379,15 @@ void transmitFlightPhaseData(AllData* data)
     }
 
     int bufferLength = encodedMessageLength + FLAGS_AND_CRC_SIZE;
-    uint8_t* buffer = malloc(bufferLength * sizeof(uint8_t));
+    uint8_t buffer[ENCODED_BUFFER_SIZE(ONE_BYTE_SERIAL_MSG_SIZE)];
     encodeMessage(message, ONE_BYTE_SERIAL_MSG_SIZE, buffer);
 
     if ((getCurrentFlightPhase() == PRELAUNCH) || (getCurrentFlightPhase() == ARM) || (getCurrentFlightPhase() == BURN) || (IS_ABORT_PHASE))
     {
-        HAL_UART_Transmit(&huart2, &buffer, sizeof(buffer), UART_TIMEOUT);  // Ground Systems
+        HAL_UART_Transmit(&huart2, buffer, bufferLength, UART_TIMEOUT);  // Ground Systems
     }
 
-    HAL_UART_Transmit(&huart1, &buffer, sizeof(buffer), UART_TIMEOUT);  // Radio
-    free(buffer);
+    HAL_UART_Transmit(&huart1, buffer, bufferLength, UART_TIMEOUT);  // Radio
 }
 
 void transmitInjectionValveStatus()
@@ -387,16 +408,15 @@ void transmitInjectionValveStatus()
     }
 
     int bufferLength = encodedMessageLength + FLAGS_AND_CRC_SIZE;
-    uint8_t* buffer = malloc(bufferLength * sizeof(uint8_t));
+    uint8_t buffer[ENCODED_BUFFER_SIZE(ONE_BYTE_SERIAL_MSG_SIZE)];
     encodeMessage(message, ONE_BYTE_SERIAL_MSG_SIZE, buffer);
 
     if ((getCurrentFlightPhase() == PRELAUNCH) || (getCurrentFlightPhase() == ARM) || (getCurrentFlightPhase() == BURN) || (IS_ABORT_PHASE))
     {
-        HAL_UART_Transmit(&huart2, &buffer, sizeof(buffer), UART_TIMEOUT); // Ground Systems
+        HAL_UART_Transmit(&huart2, buffer, bufferLength, UART_TIMEOUT); // Ground Systems
     }
 
-    HAL_UART_Transmit(&huart1, &buffer, sizeof(buffer), UART_TIMEOUT);  // Radio
-    free(buffer);
+    HAL_UART_Transmit(&huart1, buffer, bufferLength, UART_TIMEOUT);  // Radio
 }
 
 void transmitLowerVentValveStatus()
@@ -417,17 +437,268 @@ void transmitLowerVentValveStatus()
     }
 
     int bufferLength = encodedMessageLength + FLAGS_AND_CRC_SIZE;
-    uint8_t* buffer = malloc(bufferLength * sizeof(uint8_t));
+    uint8_t buffer[ENCODED_BUFFER_SIZE(ONE_BYTE_SERIAL_MSG_SIZE)];
     encodeMessage(message, ONE_BYTE_SERIAL_MSG_SIZE, buffer);
 
     if ((getCurrentFlightPhase() == PRELAUNCH) || (getCurrentFlightPhase() == ARM) || (getCurrentFlightPhase() == BURN) || (IS_ABORT_PHASE))
     {
-        HAL_UART_Transmit(&huart2, &buffer, sizeof(buffer), UART_TIMEOUT); // Ground Systems
+        HAL_UART_Transmit(&huart2, buffer, bufferLength, UART_TIMEOUT); // Ground Systems
+    }
+
+    HAL_UART_Transmit(&huart1, buffer, bufferLength, UART_TIMEOUT);  // Radio
+}
+
+/**
+ * Sends the statistics of one task per call, cycling through the tasks so
+ * the radio load stays at one short message per period. CPU load is over
+ * the interval since the previous message.
+ */
+void transmitTaskStatsData()
+{
+    static TaskStatsSnapshot snapshot CCM_BSS;
+    static TaskStatsWindow window CCM_BSS;
+    static uint8_t taskIndex = 0;
+
+    taskStatsRead(&snapshot, &window);
+
+    if (snapshot.taskCount_ == 0)
+    {
+        return;
+    }
+
+    taskIndex %= snapshot.taskCount_;
+    const TaskStatsEntry* entry = &snapshot.tasks_[taskIndex];
+
+    uint8_t message[TASK_STATS_SERIAL_MSG_SIZE] = { 0 };
+    int messageIndex = 0;
+    message[messageIndex++] = TASK_STATS_HEADER_BYTE;
+    message[messageIndex++] = taskIndex;
+    message[messageIndex++] = snapshot.taskCount_;
+    writeUint16ToArray(message, messageIndex, snapshot.cpuLoadPermille_);
+    messageIndex += 2;
+    writeUint16ToArray(message, messageIndex, entry->cpuPermille_);
+    messageIndex += 2;
+    writeUint16ToArray(message, messageIndex, entry->periodMs_ > UINT16_MAX ? UINT16_MAX : entry->periodMs_);
+    messageIndex += 2;
+    writeInt32ToArray(message, messageIndex, entry->minJobUs_);
+    messageIndex += 4;
+    writeInt32ToArray(message, messageIndex, entry->avgJobUs_);
+    messageIndex += 4;
+    writeInt32ToArray(message, messageIndex, entry->maxJobUs_);
+    messageIndex += 4;
+    writeUint16ToArray(message, messageIndex, entry->deadlineMisses_ > UINT16_MAX ? UINT16_MAX : entry->deadlineMisses_);
+    messageIndex += 2;
+    taskIndex++;
+
+    int encodedMessageLength = TASK_STATS_SERIAL_MSG_SIZE;
+
+    for (int i = 0; i < TASK_STATS_SERIAL_MSG_SIZE; i++)
+    {
+        if (message[i] == F0_ESCAPE || message[i] == F1_ESCAPE)
+        {
+            encodedMessageLength++;
+        }
     }
 
-    HAL_UART_Transmit(&huart1, &buffer, sizeof(buffer), UART_TIMEOUT);  // Radio
-    free(buffer);
+    int bufferLength = encodedMessageLength + FLAGS_AND_CRC_SIZE;
+    uint8_t buffer[ENCODED_BUFFER_SIZE(TASK_STATS_SERIAL_MSG_SIZE)];
+    encodeMessage(message, TASK_STATS_SERIAL_MSG_SIZE, buffer);
+
+    if ((getCurrentFlightPhase() == PRELAUNCH) || (getCurrentFlightPhase() == ARM) || (getCurrentFlightPhase() == BURN) || (IS_ABORT_PHASE))
+    {
+        HAL_UART_Transmit(&huart2, buffer, bufferLength, UART_TIMEOUT); // Ground Systems
+    }
+
+    HAL_UART_Transmit(&huart1, buffer, bufferLength, UART_TIMEOUT);  // Radio
+}
+
+/**
+ * Sends the stack high water mark of one task per call together with the
+ * heap levels, cycling through the tasks like transmitTaskStatsData.
+ */
+void transmitMemoryStatsData()
+{
+    static MemoryStatsSnapshot snapshot CCM_BSS;
+    static uint8_t taskIndex = 0;
+
+    memoryStatsRead(&snapshot);
+
+    if (snapshot.taskCount_ == 0)
+    {
+        return;
+    }
+
+    taskIndex %= snapshot.taskCount_;
+    const MemoryStatsEntry* entry = &snapshot.tasks_[taskIndex];
+
+    uint8_t message[MEMORY_STATS_SERIAL_MSG_SIZE] = { 0 };
+    int messageIndex = 0;
+    message[messageIndex++] = MEMORY_STATS_HEADER_BYTE;
+    message[messageIndex++] = taskIndex;
+    message[messageIndex++] = snapshot.taskCount_;
+    writeUint16ToArray(message, messageIndex, entry->stackWords_);
+    messageIndex += 2;
+    writeUint16ToArray(message, messageIndex, entry->minFreeWords_);
+    messageIndex += 2;
+    writeUint16ToArray(message, messageIndex, entry->recommendedWords_);
+    messageIndex += 2;
+    writeInt32ToArray(message, messageIndex, snapshot.rtosHeapFree_);
+    messageIndex += 4;
+    writeInt32ToArray(message, messageIndex, snapshot.rtosHeapMinFree_);
+    messageIndex += 4;
+    writeInt32ToArray(message, messageIndex, snapshot.newlibHeapSize_);
+    messageIndex += 4;
+    writeUint16ToArray(message, messageIndex, snapshot.sbrkFailures_ > UINT16_MAX ? UINT16_MAX : snapshot.sbrkFailures_);
+    messageIndex += 2;
+    taskIndex++;
+
+    int encodedMessageLength = MEMORY_STATS_SERIAL_MSG_SIZE;
+
+    for (int i = 0; i < MEMORY_STATS_SERIAL_MSG_SIZE; i++)
+    {
+        if (message[i] == F0_ESCAPE || message[i] == F1_ESCAPE)
+        {
+            encodedMessageLength++;
+        }
+    }
+
+    int bufferLength = encodedMessageLength + FLAGS_AND_CRC_SIZE;
+    uint8_t buffer[ENCODED_BUFFER_SIZE(MEMORY_STATS_SERIAL_MSG_SIZE)];
+    encodeMessage(message, MEMORY_STATS_SERIAL_MSG_SIZE, buffer);
+
+    if ((getCurrentFlightPhase() == PRELAUNCH) || (getCurrentFlightPhase() == ARM) || (getCurrentFlightPhase() == BURN) || (IS_ABORT_PHASE))
+    {
+        HAL_UART_Transmit(&huart2, buffer, bufferLength, UART_TIMEOUT); // Ground Systems
+    }
+
+    HAL_UART_Transmit(&huart1, buffer, bufferLength, UART_TIMEOUT);  // Radio
+}
+
+/**
+ * Sends the statistics of one interrupt handler per call, cycling through
+ * the handlers like transmitTaskStatsData.
+ */
+void transmitIsrStatsData()
+{
+    static IsrStatsSnapshot snapshot CCM_BSS;
+    static uint8_t handlerIndex = 0;
+
+    isrStatsRead(&snapshot);
+
+    handlerIndex %= ISR_STATS_COUNT;
+    const IsrStatsEntry* entry = &snapshot.handlers_[handlerIndex];
+    uint32_t avgCycles = entry->calls_ ? entry->totalCycles_ / entry->calls_ : 0;
+
+    uint8_t message[ISR_STATS_SERIAL_MSG_SIZE] = { 0 };
+    int messageIndex = 0;
+    message[messageIndex++] = ISR_STATS_HEADER_BYTE;
+    message[messageIndex++] = handlerIndex;
+    message[messageIndex++] = ISR_STATS_COUNT;
+    message[messageIndex++] = snapshot.coreClockHz_ / 1000000;
+    writeUint16ToArray(message, messageIndex, entry->budgetUs_);
+    messageIndex += 2;
+    writeInt32ToArray(message, messageIndex, entry->calls_);
+    messageIndex += 4;
+    writeInt32ToArray(message, messageIndex, entry->maxCycles_);
+    messageIndex += 4;
+    writeInt32ToArray(message, messageIndex, avgCycles);
+    messageIndex += 4;
+    writeUint16ToArray(message, messageIndex, entry->maxLatencyUs_ > UINT16_MAX ? UINT16_MAX : entry->maxLatencyUs_);
+    messageIndex += 2;
+    message[messageIndex++] = entry->maxDepth_;
+    writeUint16ToArray(message, messageIndex, entry->budgetOverruns_ > UINT16_MAX ? UINT16_MAX : entry->budgetOverruns_);
+    messageIndex += 2;
+    handlerIndex++;
+
+    int encodedMessageLength = ISR_STATS_SERIAL_MSG_SIZE;
+
+    for (int i = 0; i < ISR_STATS_SERIAL_MSG_SIZE; i++)
+    {
+        if (message[i] == F0_ESCAPE || message[i] == F1_ESCAPE)
+        {
+            encodedMessageLength++;
+        }
+    }
+
+    int bufferLength = encodedMessageLength + FLAGS_AND_CRC_SIZE;
+    uint8_t buffer[ENCODED_BUFFER_SIZE(ISR_STATS_SERIAL_MSG_SIZE)];
+    encodeMessage(message, ISR_STATS_SERIAL_MSG_SIZE, buffer);
+
+    if ((getCurrentFlightPhase() == PRELAUNCH) || (getCurrentFlightPhase() == ARM) || (getCurrentFlightPhase() == BURN) || (IS_ABORT_PHASE))
+    {
+        HAL_UART_Transmit(&huart2, buffer, bufferLength, UART_TIMEOUT); // Ground Systems
+    }
+
+    HAL_UART_Transmit(&huart1, buffer, bufferLength, UART_TIMEOUT);  // Radio
+}
+
+#if TRACE && TRACE_TELEMETRY
+/**
+ * Drains the trace ring into up to TRACE_MESSAGES_PER_PERIOD messages on
+ * the radio only, so the ground link keeps its time for the commands.
+ * That is fewer events than the barometer alone produces, the rest are
+ * lost and counted; trace over telemetry is meant for the bench.
+ */
+void transmitTraceData()
+{
+    static TraceEvent events[TRACE_SERIAL_MSG_EVENTS];
+    static uint32_t lost = 0;
+
+    for (int i = 0; i < TRACE_MESSAGES_PER_PERIOD; i++)
+    {
+        uint32_t cycles;
+        uint64_t micros;
+        uint32_t newlyLost;
+
+        traceSync(&cycles, &micros);
+        int count = traceRead(events, TRACE_SERIAL_MSG_EVENTS, &newlyLost);
+        lost += newlyLost;
+
+        if (count == 0)
+        {
+            return;
+        }
+
+        uint8_t message[TRACE_SERIAL_MSG_SIZE] = { 0 };
+        int messageIndex = 0;
+        message[messageIndex++] = TRACE_HEADER_BYTE;
+        message[messageIndex++] = count;
+        writeUint16ToArray(message, messageIndex, lost > UINT16_MAX ? UINT16_MAX : lost);
+        messageIndex += 2;
+        writeInt32ToArray(message, messageIndex, cycles);
+        messageIndex += 4;
+        writeInt32ToArray(message, messageIndex, (uint32_t) micros);
+        messageIndex += 4;
+        message[messageIndex++] = SystemCoreClock / 1000000;
+
+        for (int event = 0; event < count; event++)
+        {
+            writeInt32ToArray(message, messageIndex, events[event].cycles_);
+            messageIndex += 4;
+            writeUint16ToArray(message, messageIndex, events[event].arg_);
+            messageIndex += 2;
+            message[messageIndex++] = events[event].id_;
+        }
+
+        lost = 0;
+
+        int encodedMessageLength = TRACE_SERIAL_MSG_SIZE;
+
+        for (int j = 0; j < TRACE_SERIAL_MSG_SIZE; j++)
+        {
+            if (message[j] == F0_ESCAPE || message[j] == F1_ESCAPE)
+            {
+                encodedMessageLength++;
+            }
+        }
+
+        int bufferLength = encodedMessageLength + FLAGS_AND_CRC_SIZE;
+        uint8_t buffer[ENCODED_BUFFER_SIZE(TRACE_SERIAL_MSG_SIZE)];
+        encodeMessage(message, TRACE_SERIAL_MSG_SIZE, buffer);
+        HAL_UART_Transmit(&huart1, buffer, bufferLength, UART_TIMEOUT);  // Radio
+    }
 }
+#endif
 
 void transmitDataTask(void const* arg)
 {
@@ -436,7 +707,7 @@ void transmitDataTask(void const* arg)
 
     for (;;)
     {
-        osDelayUntil(&prevWakeTime, TRANSMIT_DATA_PERIOD);
+        taskStatsDelayUntil(&prevWakeTime, TRANSMIT_DATA_PERIOD);
 
         transmitImuData(data);
         transmitBarometerData(data);
@@ -446,6 +717,12 @@ void transmitDataTask(void const* arg)
         transmitFlightPhaseData(data);
         transmitInjectionValveStatus();
         transmitLowerVentValveStatus();
+        transmitTaskStatsData();
+        transmitMemoryStatsData();
+        transmitIsrStatsData();
+#if TRACE && TRACE_TELEMETRY
+        transmitTraceData();
+#endif
         HAL_UART_Receive_IT(&huart2, &launchSystemsRxChar, 1);
     }
 }
@@ -0,0 +1,267 @@
+/**
+  ******************************************************************************
+  * File Name          : Ubx.c
+  * Description        : Byte at a time u-blox UBX frame parser, NAV-PVT and
+  *                      ACK decoding and the configuration frames. Also
+  *                      built on the host by the NMEA and UBX check tool.
+  ******************************************************************************
+*/
+
+#include <stddef.h>
+#include <string.h>
+
+#include "Ubx.h"
+
+#define STATE_SYNC_1 0
+#define STATE_SYNC_2 1
+#define STATE_CLASS 2
+#define STATE_ID 3
+#define STATE_LENGTH_LOW 4
+#define STATE_LENGTH_HIGH 5
+#define STATE_PAYLOAD 6
+#define STATE_CHECKSUM_A 7
+#define STATE_CHECKSUM_B 8
+
+#define CFG_PRT_PORT_UART1 1
+#define CFG_PRT_MODE_8N1 0x000008D0
+#define CFG_RATE_TIME_GPS 1
+
+/* Little endian fields ------------------------------------------------------*/
+
+static uint16_t readU2(const uint8_t* bytes)
+{
+    return (uint16_t) (bytes[0] | (bytes[1] << 8));
+}
+
+static uint32_t readU4(const uint8_t* bytes)
+{
+    return (uint32_t) bytes[0] | ((uint32_t) bytes[1] << 8) | ((uint32_t) bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
+
+static int32_t readI4(const uint8_t* bytes)
+{
+    return (int32_t) readU4(bytes);
+}
+
+static void writeU2(uint8_t* bytes, uint16_t value)
+{
+    bytes[0] = (uint8_t) value;
+    bytes[1] = (uint8_t) (value >> 8);
+}
+
+static void writeU4(uint8_t* bytes, uint32_t value)
+{
+    writeU2(bytes, (uint16_t) value);
+    writeU2(bytes + 2, (uint16_t) (value >> 16));
+}
+
+/* Parser --------------------------------------------------------------------*/
+
+static void addToChecksum(UbxParser* parser, uint8_t byte)
+{
+    parser->checksumA_ += byte;
+    parser->checksumB_ += parser->checksumA_;
+}
+
+void ubxInit(UbxParser* parser)
+{
+    memset(parser, 0, sizeof(*parser));
+    parser->state_ = STATE_SYNC_1;
+}
+
+UbxResult ubxParse(UbxParser* parser, uint8_t byte, UbxFrame* frame)
+{
+    switch (parser->state_)
+    {
+        case STATE_SYNC_1:
+            if (byte == UBX_SYNC_1)
+            {
+                parser->state_ = STATE_SYNC_2;
+            }
+
+            return UBX_PENDING;
+
+        case STATE_SYNC_2:
+            // A repeated first sync character may still start a frame
+            parser->state_ = byte == UBX_SYNC_2 ? STATE_CLASS : byte == UBX_SYNC_1 ? STATE_SYNC_2 : STATE_SYNC_1;
+            parser->checksumA_ = 0;
+            parser->checksumB_ = 0;
+            return UBX_PENDING;
+
+        case STATE_CLASS:
+            parser->frame_.class_ = byte;
+            parser->state_ = STATE_ID;
+            break;
+
+        case STATE_ID:
+            parser->frame_.id_ = byte;
+            parser->state_ = STATE_LENGTH_LOW;
+            break;
+
+        case STATE_LENGTH_LOW:
+            parser->frame_.length_ = byte;
+            parser->state_ = STATE_LENGTH_HIGH;
+            break;
+
+        case STATE_LENGTH_HIGH:
+            parser->frame_.length_ |= (uint16_t) (byte << 8);
+            parser->index_ = 0;
+
+            if (parser->frame_.length_ > UBX_MAX_SKIPPED_LENGTH)
+            {
+                parser->state_ = STATE_SYNC_1;
+                return UBX_FORMAT_ERROR;
+            }
+
+            parser->state_ = parser->frame_.length_ == 0 ? STATE_CHECKSUM_A : STATE_PAYLOAD;
+            break;
+
+        case STATE_PAYLOAD:
+            if (parser->index_ < UBX_MAX_PAYLOAD_LENGTH)
+            {
+                parser->frame_.payload_[parser->index_] = byte;
+            }
+
+            if (++parser->index_ == parser->frame_.length_)
+            {
+                parser->state_ = STATE_CHECKSUM_A;
+            }
+
+            break;
+
+        case STATE_CHECKSUM_A:
+            parser->state_ = byte == parser->checksumA_ ? STATE_CHECKSUM_B : STATE_SYNC_1;
+            return byte == parser->checksumA_ ? UBX_PENDING : UBX_CHECKSUM_ERROR;
+
+        case STATE_CHECKSUM_B:
+            parser->state_ = STATE_SYNC_1;
+
+            if (byte != parser->checksumB_)
+            {
+                return UBX_CHECKSUM_ERROR;
+            }
+
+            if (parser->frame_.length_ > UBX_MAX_PAYLOAD_LENGTH)
+            {
+                return UBX_UNSUPPORTED;
+            }
+
+            // Only the received part of the payload
+            memcpy(frame, &parser->frame_, offsetof(UbxFrame, payload_) + parser->frame_.length_);
+            return UBX_OK;
+
+        default:
+            parser->state_ = STATE_SYNC_1;
+            return UBX_PENDING;
+    }
+
+    // Class to the end of the payload
+    addToChecksum(parser, byte);
+    return UBX_PENDING;
+}
+
+/* Decoders ------------------------------------------------------------------*/
+
+int ubxDecodeNavPvt(const UbxFrame* frame, UbxNavPvt* pvt)
+{
+    const uint8_t* payload = frame->payload_;
+
+    if (frame->class_ != UBX_CLASS_NAV || frame->id_ != UBX_NAV_PVT || frame->length_ != UBX_NAV_PVT_LENGTH)
+    {
+        return 0;
+    }
+
+    pvt->iTow_ = readU4(&payload[0]);
+    pvt->year_ = readU2(&payload[4]);
+    pvt->month_ = payload[6];
+    pvt->day_ = payload[7];
+    pvt->hour_ = payload[8];
+    pvt->minute_ = payload[9];
+    pvt->second_ = payload[10];
+    pvt->valid_ = payload[11];
+    pvt->nano_ = readI4(&payload[16]);
+    pvt->fixType_ = payload[20];
+    pvt->flags_ = payload[21];
+    pvt->satellites_ = payload[23];
+    pvt->longitude_ = readI4(&payload[24]);
+    pvt->latitude_ = readI4(&payload[28]);
+    pvt->height_ = readI4(&payload[32]);
+    pvt->heightMsl_ = readI4(&payload[36]);
+    pvt->horizontalAccuracy_ = readU4(&payload[40]);
+    pvt->verticalAccuracy_ = readU4(&payload[44]);
+    pvt->velocityNorth_ = readI4(&payload[48]);
+    pvt->velocityEast_ = readI4(&payload[52]);
+    pvt->velocityDown_ = readI4(&payload[56]);
+    pvt->groundSpeed_ = readI4(&payload[60]);
+    pvt->headingMotion_ = readI4(&payload[64]);
+    pvt->speedAccuracy_ = readU4(&payload[68]);
+    pvt->pdop_ = readU2(&payload[76]);
+    return 1;
+}
+
+int ubxDecodeAck(const UbxFrame* frame, UbxAck* ack)
+{
+    if (frame->class_ != UBX_CLASS_ACK || (frame->id_ != UBX_ACK_ACK && frame->id_ != UBX_ACK_NAK) || frame->length_ != UBX_ACK_LENGTH)
+    {
+        return 0;
+    }
+
+    ack->acknowledged_ = frame->id_ == UBX_ACK_ACK;
+    ack->class_ = frame->payload_[0];
+    ack->id_ = frame->payload_[1];
+    return 1;
+}
+
+/* Configuration frames ------------------------------------------------------*/
+
+uint16_t ubxBuildFrame(uint8_t messageClass, uint8_t id, const uint8_t* payload, uint16_t length, uint8_t* frame)
+{
+    uint8_t checksumA = 0;
+    uint8_t checksumB = 0;
+
+    frame[0] = UBX_SYNC_1;
+    frame[1] = UBX_SYNC_2;
+    frame[2] = messageClass;
+    frame[3] = id;
+    writeU2(&frame[4], length);
+    memcpy(&frame[UBX_HEADER_LENGTH], payload, length);
+
+    for (uint16_t i = 2; i < UBX_HEADER_LENGTH + length; i++)
+    {
+        checksumA += frame[i];
+        checksumB += checksumA;
+    }
+
+    frame[UBX_HEADER_LENGTH + length] = checksumA;
+    frame[UBX_HEADER_LENGTH + length + 1] = checksumB;
+    return UBX_FRAME_OVERHEAD + length;
+}
+
+uint16_t ubxCfgPrt(uint32_t baudRate, uint16_t inProtocols, uint16_t outProtocols, uint8_t* frame)
+{
+    uint8_t payload[UBX_CFG_PRT_LENGTH] = {0};
+
+    payload[0] = CFG_PRT_PORT_UART1;
+    writeU4(&payload[4], CFG_PRT_MODE_8N1);
+    writeU4(&payload[8], baudRate);
+    writeU2(&payload[12], inProtocols);
+    writeU2(&payload[14], outProtocols);
+    return ubxBuildFrame(UBX_CLASS_CFG, UBX_CFG_PRT, payload, sizeof(payload), frame);
+}
+
+uint16_t ubxCfgRate(uint16_t measurementPeriodMs, uint8_t* frame)
+{
+    uint8_t payload[UBX_CFG_RATE_LENGTH];
+
+    writeU2(&payload[0], measurementPeriodMs);
+    writeU2(&payload[2], 1);
+    writeU2(&payload[4], CFG_RATE_TIME_GPS);
+    return ubxBuildFrame(UBX_CLASS_CFG, UBX_CFG_RATE, payload, sizeof(payload), frame);
+}
+
+uint16_t ubxCfgMsg(uint8_t messageClass, uint8_t id, uint8_t rate, uint8_t* frame)
+{
+    uint8_t payload[UBX_CFG_MSG_LENGTH] = {messageClass, id, rate};
+
+    return ubxBuildFrame(UBX_CLASS_CFG, UBX_CFG_MSG, payload, sizeof(payload), frame);
+}
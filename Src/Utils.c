@@ -23,3 +23,9 @@ void writeInt32ToArray(uint8_t* array, int startIndex, int32_t value)
     array[startIndex + 2] = (value >> 8) & 0xFF;
     array[startIndex + 3] = value & 0xFF;
 }
+
+void writeUint16ToArray(uint8_t* array, int startIndex, uint16_t value)
+{
+    array[startIndex + 0] = (value >> 8) & 0xFF;
+    array[startIndex + 1] = value & 0xFF;
+}
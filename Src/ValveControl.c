@@ -3,6 +3,7 @@
 #include "cmsis_os.h"
 
 #include "ValveControl.h"
+#include "Trace.h"
 
 int injectionValveIsOpen = 0;
 int lowerVentValveIsOpen = 0;
@@ -12,6 +13,12 @@ void openInjectionValve()
 {
     // Powered is open
     HAL_GPIO_WritePin(INJECTION_VALVE_GPIO_Port, INJECTION_VALVE_Pin, GPIO_PIN_SET);
+
+    if (!injectionValveIsOpen)
+    {
+        trace(TRACE_INJECTION_VALVE, 1);
+    }
+
     injectionValveIsOpen = 1;
 }
 
@@ -19,6 +26,12 @@ void closeInjectionValve()
 {
     // Unpowered is closed
     HAL_GPIO_WritePin(INJECTION_VALVE_GPIO_Port, INJECTION_VALVE_Pin, GPIO_PIN_RESET);
+
+    if (injectionValveIsOpen)
+    {
+        trace(TRACE_INJECTION_VALVE, 0);
+    }
+
     injectionValveIsOpen = 0;
 }
 
@@ -27,11 +27,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include "ReadAccelGyroMagnetism.h"
-#include "ReadBarometer.h"
-#include "ReadCombustionChamberPressure.h"
 #include "ReadGps.h"
-#include "ReadOxidizerTankPressure.h"
+#include "SensorSchedule.h"
 #include "MonitorForEmergencyShutoff.h"
 #include "EngineControl.h"
 #include "ParachutesControl.h"
@@ -41,6 +38,11 @@
 #include "Data.h"
 #include "FlightPhase.h"
 #include "ValveControl.h"
+#include "TaskStats.h"
+#include "MemoryStats.h"
+#include "MemorySections.h"
+#include "Timebase.h"
+#include "Trace.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -50,6 +52,23 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
+// Task stack sizes in words, see the memory stats report for recommendations
+#define SENSOR_SCHEDULE_STACK_SIZE (configMINIMAL_STACK_SIZE * 2)
+#define MONITOR_FOR_EMERGENCY_SHUTOFF_STACK_SIZE configMINIMAL_STACK_SIZE
+#define ENGINE_CONTROL_STACK_SIZE (configMINIMAL_STACK_SIZE * 2)
+#define PARACHUTES_CONTROL_STACK_SIZE (configMINIMAL_STACK_SIZE * 2)
+#define LOG_DATA_STACK_SIZE (configMINIMAL_STACK_SIZE * 3)
+#define TRANSMIT_DATA_STACK_SIZE (configMINIMAL_STACK_SIZE * 3)
+#define ABORT_PHASE_STACK_SIZE configMINIMAL_STACK_SIZE
+
+// Everything the tasks share is allocated statically, nothing uses a heap after boot.
+// No DMA stream touches task memory or the sensor data, so both live in CCM RAM by default.
+#ifndef TASK_MEMORY_SECTION
+#define TASK_MEMORY_SECTION CCM_BSS
+#endif
+#ifndef FLIGHT_DATA_SECTION
+#define FLIGHT_DATA_SECTION CCM_BSS
+#endif
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -68,19 +87,21 @@ SPI_HandleTypeDef hspi1;
 SPI_HandleTypeDef hspi2;
 SPI_HandleTypeDef hspi3;
 
+TIM_HandleTypeDef htim5;
+TIM_HandleTypeDef htim7;
+
 UART_HandleTypeDef huart4;
 UART_HandleTypeDef huart1;
 UART_HandleTypeDef huart2;
 DMA_HandleTypeDef hdma_uart4_rx;
 
 osThreadId defaultTaskHandle;
+uint32_t defaultTaskBuffer[ 128 ];
+osStaticThreadDef_t defaultTaskControlBlock;
 /* USER CODE BEGIN PV */
 /* Private variables ---------------------------------------------------------*/
-static osThreadId readAccelGyroMagnetismTaskHandle;
-static osThreadId readBarometerTaskHandle;
-static osThreadId readCombustionChamberPressureTaskHandle;
-static osThreadId readGpsTaskHandle;
-static osThreadId readOxidizerTankPressureTaskHandle;
+// Sensor reads, one time triggered task for all of them
+static osThreadId sensorScheduleTaskHandle;
 // Controls that will perform actions
 static osThreadId monitorForEmergencyShutoffTaskHandle;
 static osThreadId engineControlTaskHandle;
@@ -91,6 +112,38 @@ static osThreadId transmitDataTaskHandle;
 // Special abort thread
 static osThreadId abortPhaseTaskHandle;
 
+static uint32_t sensorScheduleStack[SENSOR_SCHEDULE_STACK_SIZE] TASK_MEMORY_SECTION;
+static uint32_t monitorForEmergencyShutoffStack[MONITOR_FOR_EMERGENCY_SHUTOFF_STACK_SIZE] TASK_MEMORY_SECTION;
+static uint32_t engineControlStack[ENGINE_CONTROL_STACK_SIZE] TASK_MEMORY_SECTION;
+static uint32_t parachutesControlStack[PARACHUTES_CONTROL_STACK_SIZE] TASK_MEMORY_SECTION;
+static uint32_t logDataStack[LOG_DATA_STACK_SIZE] TASK_MEMORY_SECTION;
+static uint32_t transmitDataStack[TRANSMIT_DATA_STACK_SIZE] TASK_MEMORY_SECTION;
+static uint32_t abortPhaseStack[ABORT_PHASE_STACK_SIZE] TASK_MEMORY_SECTION;
+
+static osStaticThreadDef_t sensorScheduleControlBlock TASK_MEMORY_SECTION;
+static osStaticThreadDef_t monitorForEmergencyShutoffControlBlock TASK_MEMORY_SECTION;
+static osStaticThreadDef_t engineControlControlBlock TASK_MEMORY_SECTION;
+static osStaticThreadDef_t parachutesControlControlBlock TASK_MEMORY_SECTION;
+static osStaticThreadDef_t logDataControlBlock TASK_MEMORY_SECTION;
+static osStaticThreadDef_t transmitDataControlBlock TASK_MEMORY_SECTION;
+static osStaticThreadDef_t abortPhaseControlBlock TASK_MEMORY_SECTION;
+
+static osStaticMutexDef_t accelGyroMagnetismDataMutexControlBlock TASK_MEMORY_SECTION;
+static osStaticMutexDef_t barometerDataMutexControlBlock TASK_MEMORY_SECTION;
+static osStaticMutexDef_t combustionChamberPressureDataMutexControlBlock TASK_MEMORY_SECTION;
+static osStaticMutexDef_t gpsDataMutexControlBlock TASK_MEMORY_SECTION;
+static osStaticMutexDef_t oxidizerTankPressureDataMutexControlBlock TASK_MEMORY_SECTION;
+static osStaticMutexDef_t flightPhaseMutexControlBlock TASK_MEMORY_SECTION;
+
+// Data primitive structs and containers
+static AccelGyroMagnetismData accelGyroMagnetismDataStorage FLIGHT_DATA_SECTION;
+static BarometerData barometerDataStorage FLIGHT_DATA_SECTION;
+static CombustionChamberPressureData combustionChamberPressureDataStorage FLIGHT_DATA_SECTION;
+static GpsData gpsDataStorage FLIGHT_DATA_SECTION;
+static OxidizerTankPressureData oxidizerTankPressureDataStorage FLIGHT_DATA_SECTION;
+static AllData allDataStorage FLIGHT_DATA_SECTION;
+static ParachutesControlData parachutesControlDataStorage FLIGHT_DATA_SECTION;
+
 static const uint8_t LAUNCH_CMD_BYTE = 0x20;
 static const uint8_t ARM_CMD_BYTE = 0x21;
 static const uint8_t ABORT_CMD_BYTE = 0x2F;
@@ -110,7 +163,6 @@ int32_t heartbeatTimer = 0; // Initalized to HEARTBEAT_TIMEOUT in MonitorForEmer
 static const int FLIGHT_PHASE_DISPLAY_FREQ = 1000;
 static const int FLIGHT_PHASE_BLINK_FREQ = 100;
 
-char dma_rx_buffer[NMEA_MAX_LENGTH + 1] = {0};
 GpsData* gpsData;
 
 /* USER CODE END PV */
@@ -129,6 +181,8 @@ static void MX_USART2_UART_Init(void);
 static void MX_UART4_Init(void);
 static void MX_ADC3_Init(void);
 static void MX_CRC_Init(void);
+static void MX_TIM7_Init(void);
+static void MX_TIM5_Init(void);
 void StartDefaultTask(void const* argument);
 
 /* USER CODE BEGIN PFP */
@@ -180,20 +234,20 @@ int main(void)
     MX_UART4_Init();
     MX_ADC3_Init();
     MX_CRC_Init();
+    MX_TIM7_Init();
+    MX_TIM5_Init();
     /* USER CODE BEGIN 2 */
+    // Sample times are taken from here on
+    timebaseInit();
+
     // Data primitive structs
-    AccelGyroMagnetismData* accelGyroMagnetismData =
-        malloc(sizeof(AccelGyroMagnetismData));
-    BarometerData* barometerData =
-        malloc(sizeof(BarometerData));
-    CombustionChamberPressureData* combustionChamberPressureData =
-        malloc(sizeof(CombustionChamberPressureData));
-    gpsData =
-        calloc(1, sizeof(GpsData));
-    OxidizerTankPressureData* oxidizerTankPressureData =
-        malloc(sizeof(OxidizerTankPressureData));
-
-    osMutexDef(ACCEL_GYRO_MAGNETISM_DATA_MUTEX);
+    AccelGyroMagnetismData* accelGyroMagnetismData = &accelGyroMagnetismDataStorage;
+    BarometerData* barometerData = &barometerDataStorage;
+    CombustionChamberPressureData* combustionChamberPressureData = &combustionChamberPressureDataStorage;
+    gpsData = &gpsDataStorage;
+    OxidizerTankPressureData* oxidizerTankPressureData = &oxidizerTankPressureDataStorage;
+
+    osMutexStaticDef(ACCEL_GYRO_MAGNETISM_DATA_MUTEX, &accelGyroMagnetismDataMutexControlBlock);
     accelGyroMagnetismData->mutex_ = osMutexCreate(osMutex(ACCEL_GYRO_MAGNETISM_DATA_MUTEX));
     accelGyroMagnetismData->accelX_ = -1;
     accelGyroMagnetismData->accelY_ = -2;
@@ -204,40 +258,42 @@ int main(void)
     accelGyroMagnetismData->magnetoX_ = -7;
     accelGyroMagnetismData->magnetoY_ = -8;
     accelGyroMagnetismData->magnetoZ_ = -9;
+    accelGyroMagnetismData->tilt_ = -1;
+    accelGyroMagnetismData->angularRate_ = -1;
+    accelGyroMagnetismData->verticalAccel_ = -1;
 
-    osMutexDef(BAROMETER_DATA_MUTEX);
+    osMutexStaticDef(BAROMETER_DATA_MUTEX, &barometerDataMutexControlBlock);
     barometerData->mutex_ = osMutexCreate(osMutex(BAROMETER_DATA_MUTEX));
     barometerData->pressure_ = -10;
     barometerData->temperature_ = -11;
 
-    osMutexDef(COMBUSTION_CHAMBER_PRESSURE_DATA_MUTEX);
+    osMutexStaticDef(COMBUSTION_CHAMBER_PRESSURE_DATA_MUTEX, &combustionChamberPressureDataMutexControlBlock);
     combustionChamberPressureData->mutex_ = osMutexCreate(osMutex(COMBUSTION_CHAMBER_PRESSURE_DATA_MUTEX));
     combustionChamberPressureData->pressure_ = -12;
 
-    osMutexDef(GPS_DATA_MUTEX);
+    osMutexStaticDef(GPS_DATA_MUTEX, &gpsDataMutexControlBlock);
     gpsData->mutex_ = osMutexCreate(osMutex(GPS_DATA_MUTEX));
 
-    osMutexDef(OXIDIZER_TANK_PRESSURE_DATA_MUTEX);
+    osMutexStaticDef(OXIDIZER_TANK_PRESSURE_DATA_MUTEX, &oxidizerTankPressureDataMutexControlBlock);
     oxidizerTankPressureData->mutex_ = osMutexCreate(osMutex(OXIDIZER_TANK_PRESSURE_DATA_MUTEX));
     oxidizerTankPressureData->pressure_ = -17;
 
     // Data containers
-    AllData* allData =
-        malloc(sizeof(AllData));
+    AllData* allData = &allDataStorage;
     allData->accelGyroMagnetismData_ = accelGyroMagnetismData;
     allData->barometerData_ = barometerData;
     allData->combustionChamberPressureData_ = combustionChamberPressureData;
     allData->gpsData_ = gpsData;
     allData->oxidizerTankPressureData_ = oxidizerTankPressureData;
 
-    ParachutesControlData* parachutesControlData =
-        malloc(sizeof(ParachutesControlData));
+    ParachutesControlData* parachutesControlData = &parachutesControlDataStorage;
     parachutesControlData->accelGyroMagnetismData_ = accelGyroMagnetismData;
     parachutesControlData->barometerData_ = barometerData;
+    parachutesControlData->gpsData_ = gpsData;
     /* USER CODE END 2 */
 
     /* USER CODE BEGIN RTOS_MUTEX */
-    osMutexDef(FLIGHT_PHASE_MUTEX);
+    osMutexStaticDef(FLIGHT_PHASE_MUTEX, &flightPhaseMutexControlBlock);
     flightPhaseMutex = osMutexCreate(osMutex(FLIGHT_PHASE_MUTEX));
     /* USER CODE END RTOS_MUTEX */
 
@@ -257,120 +313,118 @@ int main(void)
 
     /* Create the thread(s) */
     /* definition and creation of defaultTask */
-    osThreadDef(defaultTask, StartDefaultTask, osPriorityNormal, 0, 128);
+    osThreadStaticDef(defaultTask, StartDefaultTask, osPriorityNormal, 0, 128, defaultTaskBuffer, &defaultTaskControlBlock);
     defaultTaskHandle = osThreadCreate(osThread(defaultTask), NULL);
 
     /* USER CODE BEGIN RTOS_THREADS */
 
-    osThreadDef(
-        readAccelGyroMagnetismThread,
-        readAccelGyroMagnetismTask,
-        osPriorityNormal,
-        1,
-        configMINIMAL_STACK_SIZE
-    );
-    readAccelGyroMagnetismTaskHandle =
-        osThreadCreate(osThread(readAccelGyroMagnetismThread), accelGyroMagnetismData);
-
-    osThreadDef(
-        readBarometerThread,
-        readBarometerTask,
-        osPriorityNormal,
+    // Above every other task, so sampling jitter is only the TIM7 interrupt latency
+    osThreadStaticDef(
+        sensorScheduleThread,
+        sensorScheduleTask,
+        osPriorityRealtime,
         1,
-        configMINIMAL_STACK_SIZE
+        SENSOR_SCHEDULE_STACK_SIZE,
+        sensorScheduleStack,
+        &sensorScheduleControlBlock
     );
-    readBarometerTaskHandle =
-        osThreadCreate(osThread(readBarometerThread), barometerData);
+    sensorScheduleTaskHandle =
+        osThreadCreate(osThread(sensorScheduleThread), allData);
 
-    osThreadDef(
-        readCombustionChamberPressureThread,
-        readCombustionChamberPressureTask,
-        osPriorityAboveNormal,
-        1,
-        configMINIMAL_STACK_SIZE
-    );
-    readCombustionChamberPressureTaskHandle =
-        osThreadCreate(osThread(readCombustionChamberPressureThread), combustionChamberPressureData);
-
-    osThreadDef(
-        readGpsThread,
-        readGpsTask,
-        osPriorityBelowNormal,
-        1,
-        configMINIMAL_STACK_SIZE
-    );
-    readGpsTaskHandle =
-        osThreadCreate(osThread(readGpsThread), gpsData);
-
-    osThreadDef(
-        readOxidizerTankPressureThread,
-        readOxidizerTankPressureTask,
-        osPriorityAboveNormal,
-        1,
-        configMINIMAL_STACK_SIZE
-    );
-    readOxidizerTankPressureTaskHandle =
-        osThreadCreate(osThread(readOxidizerTankPressureThread), oxidizerTankPressureData);
-
-    osThreadDef(
+    osThreadStaticDef(
         monitorForEmergencyShutoffThread,
         monitorForEmergencyShutoffTask,
         osPriorityHigh,
         1,
-        configMINIMAL_STACK_SIZE
+        MONITOR_FOR_EMERGENCY_SHUTOFF_STACK_SIZE,
+        monitorForEmergencyShutoffStack,
+        &monitorForEmergencyShutoffControlBlock
     );
     monitorForEmergencyShutoffTaskHandle =
         osThreadCreate(osThread(monitorForEmergencyShutoffThread), accelGyroMagnetismData);
 
-    osThreadDef(
+    osThreadStaticDef(
         engineControlThread,
         engineControlTask,
         osPriorityNormal,
         1,
-        configMINIMAL_STACK_SIZE * 2
+        ENGINE_CONTROL_STACK_SIZE,
+        engineControlStack,
+        &engineControlControlBlock
     );
     engineControlTaskHandle =
         osThreadCreate(osThread(engineControlThread), oxidizerTankPressureData);
 
-    osThreadDef(
+    osThreadStaticDef(
         parachutesControlThread,
         parachutesControlTask,
         osPriorityAboveNormal,
         1,
-        configMINIMAL_STACK_SIZE * 2
+        PARACHUTES_CONTROL_STACK_SIZE,
+        parachutesControlStack,
+        &parachutesControlControlBlock
     );
     parachutesControlTaskHandle =
         osThreadCreate(osThread(parachutesControlThread), parachutesControlData);
 
-    osThreadDef(
+    osThreadStaticDef(
         logDataThread,
         logDataTask,
         osPriorityNormal,
         1,
-        configMINIMAL_STACK_SIZE * 3
+        LOG_DATA_STACK_SIZE,
+        logDataStack,
+        &logDataControlBlock
     );
     logDataTaskHandle =
         osThreadCreate(osThread(logDataThread), allData);
 
-    osThreadDef(
+    osThreadStaticDef(
         transmitDataThread,
         transmitDataTask,
         osPriorityNormal,
         1,
-        configMINIMAL_STACK_SIZE * 3
+        TRANSMIT_DATA_STACK_SIZE,
+        transmitDataStack,
+        &transmitDataControlBlock
     );
     transmitDataTaskHandle =
         osThreadCreate(osThread(transmitDataThread), allData);
 
-    osThreadDef(
+    osThreadStaticDef(
         abortPhaseThread,
         abortPhaseTask,
         osPriorityHigh,
         1,
-        configMINIMAL_STACK_SIZE
+        ABORT_PHASE_STACK_SIZE,
+        abortPhaseStack,
+        &abortPhaseControlBlock
     );
     abortPhaseTaskHandle =
         osThreadCreate(osThread(abortPhaseThread), NULL);
+
+    // Registration order is the task index in task and memory stats telemetry
+    struct
+    {
+        osThreadId           thread_;
+        const osThreadDef_t* definition_;
+    } statsThreads[] =
+    {
+        { defaultTaskHandle, osThread(defaultTask) },
+        { sensorScheduleTaskHandle, osThread(sensorScheduleThread) },
+        { monitorForEmergencyShutoffTaskHandle, osThread(monitorForEmergencyShutoffThread) },
+        { engineControlTaskHandle, osThread(engineControlThread) },
+        { parachutesControlTaskHandle, osThread(parachutesControlThread) },
+        { logDataTaskHandle, osThread(logDataThread) },
+        { transmitDataTaskHandle, osThread(transmitDataThread) },
+        { abortPhaseTaskHandle, osThread(abortPhaseThread) }
+    };
+
+    for (int i = 0; i < sizeof(statsThreads) / sizeof(statsThreads[0]); i++)
+    {
+        taskStatsRegister(statsThreads[i].thread_);
+        memoryStatsRegister(statsThreads[i].thread_, statsThreads[i].definition_->stacksize);
+    }
     /* USER CODE END RTOS_THREADS */
 
     /* Start scheduler */
@@ -386,14 +440,6 @@ int main(void)
 
         /* USER CODE BEGIN 3 */
     }
-
-    free(accelGyroMagnetismData);
-    free(barometerData);
-    free(combustionChamberPressureData);
-    free(gpsData);
-    free(oxidizerTankPressureData);
-    free(allData);
-    free(parachutesControlData);
     /* USER CODE END 3 */
 }
 
@@ -631,6 +677,99 @@ static void MX_CRC_Init(void)
 
 }
 
+/**
+  * @brief TIM5 Initialization Function
+  * @param None
+  * @retval None
+  */
+static void MX_TIM5_Init(void)
+{
+
+    /* USER CODE BEGIN TIM5_Init 0 */
+
+    /* USER CODE END TIM5_Init 0 */
+
+    TIM_ClockConfigTypeDef sClockSourceConfig = {0};
+    TIM_MasterConfigTypeDef sMasterConfig = {0};
+
+    /* USER CODE BEGIN TIM5_Init 1 */
+    // Free running 1 MHz counter over the full 32 bits, see Timebase.h
+    /* USER CODE END TIM5_Init 1 */
+    htim5.Instance = TIM5;
+    htim5.Init.Prescaler = 41;
+    htim5.Init.CounterMode = TIM_COUNTERMODE_UP;
+    htim5.Init.Period = 4294967295;
+    htim5.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    htim5.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+
+    if (HAL_TIM_Base_Init(&htim5) != HAL_OK)
+    {
+        Error_Handler();
+    }
+
+    sClockSourceConfig.ClockSource = TIM_CLOCKSOURCE_INTERNAL;
+
+    if (HAL_TIM_ConfigClockSource(&htim5, &sClockSourceConfig) != HAL_OK)
+    {
+        Error_Handler();
+    }
+
+    sMasterConfig.MasterOutputTrigger = TIM_TRGO_RESET;
+    sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+
+    if (HAL_TIMEx_MasterConfigSynchronization(&htim5, &sMasterConfig) != HAL_OK)
+    {
+        Error_Handler();
+    }
+
+    /* USER CODE BEGIN TIM5_Init 2 */
+
+    /* USER CODE END TIM5_Init 2 */
+
+}
+
+/**
+  * @brief TIM7 Initialization Function
+  * @param None
+  * @retval None
+  */
+static void MX_TIM7_Init(void)
+{
+
+    /* USER CODE BEGIN TIM7_Init 0 */
+
+    /* USER CODE END TIM7_Init 0 */
+
+    TIM_MasterConfigTypeDef sMasterConfig = {0};
+
+    /* USER CODE BEGIN TIM7_Init 1 */
+    // 1 MHz counter from the 42 MHz APB1 timer clock, the period is set by the sensor schedule
+    /* USER CODE END TIM7_Init 1 */
+    htim7.Instance = TIM7;
+    htim7.Init.Prescaler = 41;
+    htim7.Init.CounterMode = TIM_COUNTERMODE_UP;
+    htim7.Init.Period = 4999;
+    htim7.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+
+    if (HAL_TIM_Base_Init(&htim7) != HAL_OK)
+    {
+        Error_Handler();
+    }
+
+    sMasterConfig.MasterOutputTrigger = TIM_TRGO_RESET;
+    sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+
+    if (HAL_TIMEx_MasterConfigSynchronization(&htim7, &sMasterConfig) != HAL_OK)
+    {
+        Error_Handler();
+    }
+
+    /* USER CODE BEGIN TIM7_Init 2 */
+
+    /* USER CODE END TIM7_Init 2 */
+
+}
+
 /**
   * @brief SPI1 Initialization Function
   * @param None
@@ -964,13 +1103,19 @@ static void MX_GPIO_Init(void)
 /* USER CODE BEGIN 4 */
 void HAL_UART_ErrorCallback(UART_HandleTypeDef* huart)
 {
-
+    if (huart->Instance == UART4)
+    {
+        // The HAL stops a DMA reception on a framing, noise or overrun error
+        gpsRxError();
+    }
 }
 
 void HAL_UART_RxCpltCallback(UART_HandleTypeDef* huart)
 {
     if (huart->Instance == USART2)
     {
+        trace(TRACE_GROUND_COMMAND, launchSystemsRxChar);
+
         if (launchSystemsRxChar == LAUNCH_CMD_BYTE)
         {
             if (ARM == getCurrentFlightPhase())
@@ -1014,69 +1159,37 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef* huart)
     }
     else if (huart->Instance == UART4)
     {
-        static char rx_buffer[NMEA_MAX_LENGTH + 1];
-        static int rx_index = 0;
-        static int gpggaDetected = 0;
-        char message[6] = "$GPGGA";
+        gpsRxCallback();
+    }
+}
 
-        for (int i = 0; i < NMEA_MAX_LENGTH + 1; i++)
-        {
-            char rx = dma_rx_buffer[i]; // Read 1 character
+void HAL_UART_RxHalfCpltCallback(UART_HandleTypeDef* huart)
+{
+    if (huart->Instance == UART4)
+    {
+        gpsRxCallback();
+    }
+}
 
-            if ((rx == '\r') || (rx == '\n')) // End of line character has been reached
-            {
-                if (rx_index != 0 && rx_buffer[0] == '$') // Check that buffer has content and that the message is valid
-                {
-                    rx_buffer[rx_index++] = 0;
-
-                    if (osMutexWait(gpsData->mutex_, 0) == osOK)
-                    {
-                        memcpy(&gpsData->buffer_, &rx_buffer, rx_index); // Copy to gps data buffer from rx_buffer
-                        gpsData->parseFlag_ = 1; // Data in gps data buffer is ready to be parsed
-                    }
-
-                    osMutexRelease(gpsData->mutex_);
-
-                    // Reset back to initial values
-                    rx_index = 0;
-                    gpggaDetected = 0;
-                }
-            }
-            else
-            {
-                if ((rx == '$') || (rx_index == NMEA_MAX_LENGTH)) // If start character received or end of rx buffer reached
-                {
-                    // Reset back to initial values
-                    rx_index = 0;
-                    gpggaDetected = 0;
-                    rx_buffer[rx_index++] = rx;
-                }
-                else if (gpggaDetected == 0)
-                {
-                    if (rx_index >= 6) // If the first 6 characters follow $GPGGA, set gpggaDetected to 1
-                    {
-                        gpggaDetected = 1;
-                        rx_buffer[rx_index++] = rx; // Contents of the rx_buffer will be $GPGGA at this point
-                    }
-                    else if (rx == message[rx_index]) // Check if the first 6 characters follow $GPGGA
-                    {
-                        rx_buffer[rx_index++] = rx;
-                    }
-                    else
-                    {
-                        // If any of the first 6 characters does not follow $GPGGA, reset to initial values
-                        rx_index = 0;
-                        gpggaDetected = 0;
-                    }
-                }
-                else
-                {
-                    rx_buffer[rx_index++] = rx; // Copy received characters to rx_buffer
-                }
-            }
-        }
+/**
+ * Called from the interrupt handler of a UART whose idle line interrupt is
+ * enabled, once the line has been idle for a frame after receiving. This
+ * HAL has no callback for it.
+ */
+void uartIdleCallback(UART_HandleTypeDef* huart)
+{
+    if (huart->Instance == UART4)
+    {
+        gpsRxCallback();
+    }
+}
 
-        HAL_UART_Receive_DMA(&huart4, (uint8_t*) &dma_rx_buffer, NMEA_MAX_LENGTH + 1);
+// TIM5 channel 1 is the timebase alarm
+void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef* htim)
+{
+    if (htim->Instance == TIM5 && htim->Channel == HAL_TIM_ACTIVE_CHANNEL_1)
+    {
+        timebaseAlarm();
     }
 }
 /* USER CODE END 4 */
@@ -1135,6 +1248,15 @@ void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef* htim)
     }
 
     /* USER CODE BEGIN Callback 1 */
+    if (htim->Instance == TIM5)
+    {
+        timebaseOverflow();
+    }
+
+    if (htim->Instance == TIM7)
+    {
+        sensorScheduleRelease();
+    }
 
     /* USER CODE END Callback 1 */
 }
@@ -418,6 +418,84 @@ void HAL_SPI_MspDeInit(SPI_HandleTypeDef* hspi)
 
 }
 
+/**
+* @brief TIM_Base MSP Initialization
+* This function configures the hardware resources used in this example
+* @param htim_base: TIM_Base handle pointer
+* @retval None
+*/
+void HAL_TIM_Base_MspInit(TIM_HandleTypeDef* htim_base)
+{
+    if (htim_base->Instance == TIM5)
+    {
+        /* USER CODE BEGIN TIM5_MspInit 0 */
+
+        /* USER CODE END TIM5_MspInit 0 */
+        /* Peripheral clock enable */
+        __HAL_RCC_TIM5_CLK_ENABLE();
+        /* TIM5 interrupt Init */
+        HAL_NVIC_SetPriority(TIM5_IRQn, 5, 0);
+        HAL_NVIC_EnableIRQ(TIM5_IRQn);
+        /* USER CODE BEGIN TIM5_MspInit 1 */
+
+        /* USER CODE END TIM5_MspInit 1 */
+    }
+    else if (htim_base->Instance == TIM7)
+    {
+        /* USER CODE BEGIN TIM7_MspInit 0 */
+
+        /* USER CODE END TIM7_MspInit 0 */
+        /* Peripheral clock enable */
+        __HAL_RCC_TIM7_CLK_ENABLE();
+        /* TIM7 interrupt Init */
+        HAL_NVIC_SetPriority(TIM7_IRQn, 5, 0);
+        HAL_NVIC_EnableIRQ(TIM7_IRQn);
+        /* USER CODE BEGIN TIM7_MspInit 1 */
+
+        /* USER CODE END TIM7_MspInit 1 */
+    }
+
+}
+
+/**
+* @brief TIM_Base MSP De-Initialization
+* This function freeze the hardware resources used in this example
+* @param htim_base: TIM_Base handle pointer
+* @retval None
+*/
+void HAL_TIM_Base_MspDeInit(TIM_HandleTypeDef* htim_base)
+{
+    if (htim_base->Instance == TIM5)
+    {
+        /* USER CODE BEGIN TIM5_MspDeInit 0 */
+
+        /* USER CODE END TIM5_MspDeInit 0 */
+        /* Peripheral clock disable */
+        __HAL_RCC_TIM5_CLK_DISABLE();
+
+        /* TIM5 interrupt DeInit */
+        HAL_NVIC_DisableIRQ(TIM5_IRQn);
+        /* USER CODE BEGIN TIM5_MspDeInit 1 */
+
+        /* USER CODE END TIM5_MspDeInit 1 */
+    }
+    else if (htim_base->Instance == TIM7)
+    {
+        /* USER CODE BEGIN TIM7_MspDeInit 0 */
+
+        /* USER CODE END TIM7_MspDeInit 0 */
+        /* Peripheral clock disable */
+        __HAL_RCC_TIM7_CLK_DISABLE();
+
+        /* TIM7 interrupt DeInit */
+        HAL_NVIC_DisableIRQ(TIM7_IRQn);
+        /* USER CODE BEGIN TIM7_MspDeInit 1 */
+
+        /* USER CODE END TIM7_MspDeInit 1 */
+    }
+
+}
+
 /**
 * @brief UART MSP Initialization
 * This function configures the hardware resources used in this example
@@ -457,7 +535,7 @@ void HAL_UART_MspInit(UART_HandleTypeDef* huart)
         hdma_uart4_rx.Init.MemInc = DMA_MINC_ENABLE;
         hdma_uart4_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
         hdma_uart4_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
-        hdma_uart4_rx.Init.Mode = DMA_NORMAL;
+        hdma_uart4_rx.Init.Mode = DMA_CIRCULAR;
         hdma_uart4_rx.Init.Priority = DMA_PRIORITY_LOW;
         hdma_uart4_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
 
@@ -468,6 +546,9 @@ void HAL_UART_MspInit(UART_HandleTypeDef* huart)
 
         __HAL_LINKDMA(huart, hdmarx, hdma_uart4_rx);
 
+        /* UART4 interrupt Init */
+        HAL_NVIC_SetPriority(UART4_IRQn, 5, 0);
+        HAL_NVIC_EnableIRQ(UART4_IRQn);
         /* USER CODE BEGIN UART4_MspInit 1 */
 
         /* USER CODE END UART4_MspInit 1 */
@@ -550,6 +631,9 @@ void HAL_UART_MspDeInit(UART_HandleTypeDef* huart)
 
         /* UART4 DMA DeInit */
         HAL_DMA_DeInit(huart->hdmarx);
+
+        /* UART4 interrupt DeInit */
+        HAL_NVIC_DisableIRQ(UART4_IRQn);
         /* USER CODE BEGIN UART4_MspDeInit 1 */
 
         /* USER CODE END UART4_MspDeInit 1 */
@@ -25,6 +25,7 @@
 #include "task.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "IsrStats.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -59,7 +60,10 @@
 
 /* External variables --------------------------------------------------------*/
 extern DMA_HandleTypeDef hdma_uart4_rx;
+extern TIM_HandleTypeDef htim5;
+extern TIM_HandleTypeDef htim7;
 extern UART_HandleTypeDef huart2;
+extern UART_HandleTypeDef huart4;
 extern TIM_HandleTypeDef htim1;
 
 /* USER CODE BEGIN EV */
@@ -168,11 +172,11 @@ void DebugMon_Handler(void)
 void DMA1_Stream2_IRQHandler(void)
 {
     /* USER CODE BEGIN DMA1_Stream2_IRQn 0 */
-
+    isrStatsEnter(ISR_STATS_DMA1_Stream2, ISR_STATS_NO_LATENCY);
     /* USER CODE END DMA1_Stream2_IRQn 0 */
     HAL_DMA_IRQHandler(&hdma_uart4_rx);
     /* USER CODE BEGIN DMA1_Stream2_IRQn 1 */
-
+    isrStatsExit(ISR_STATS_DMA1_Stream2);
     /* USER CODE END DMA1_Stream2_IRQn 1 */
 }
 
@@ -182,11 +186,12 @@ void DMA1_Stream2_IRQHandler(void)
 void TIM1_UP_TIM10_IRQHandler(void)
 {
     /* USER CODE BEGIN TIM1_UP_TIM10_IRQn 0 */
-
+    // TIM1 counts at 1 MHz from the update event, see HAL_InitTick
+    isrStatsEnter(ISR_STATS_TIM1_UP_TIM10, htim1.Instance->CNT);
     /* USER CODE END TIM1_UP_TIM10_IRQn 0 */
     HAL_TIM_IRQHandler(&htim1);
     /* USER CODE BEGIN TIM1_UP_TIM10_IRQn 1 */
-
+    isrStatsExit(ISR_STATS_TIM1_UP_TIM10);
     /* USER CODE END TIM1_UP_TIM10_IRQn 1 */
 }
 
@@ -196,14 +201,72 @@ void TIM1_UP_TIM10_IRQHandler(void)
 void USART2_IRQHandler(void)
 {
     /* USER CODE BEGIN USART2_IRQn 0 */
-
+    isrStatsEnter(ISR_STATS_USART2, ISR_STATS_NO_LATENCY);
     /* USER CODE END USART2_IRQn 0 */
     HAL_UART_IRQHandler(&huart2);
     /* USER CODE BEGIN USART2_IRQn 1 */
-
+    isrStatsExit(ISR_STATS_USART2);
     /* USER CODE END USART2_IRQn 1 */
 }
 
+/**
+  * @brief This function handles UART4 global interrupt.
+  */
+void UART4_IRQHandler(void)
+{
+    /* USER CODE BEGIN UART4_IRQn 0 */
+    isrStatsEnter(ISR_STATS_UART4, ISR_STATS_NO_LATENCY);
+
+    if (__HAL_UART_GET_FLAG(&huart4, UART_FLAG_IDLE) && __HAL_UART_GET_IT_SOURCE(&huart4, UART_IT_IDLE))
+    {
+        // Reading SR then DR clears the flag, the DMA has already taken the last byte
+        __HAL_UART_CLEAR_IDLEFLAG(&huart4);
+        uartIdleCallback(&huart4);
+    }
+
+    /* USER CODE END UART4_IRQn 0 */
+    HAL_UART_IRQHandler(&huart4);
+    /* USER CODE BEGIN UART4_IRQn 1 */
+    isrStatsExit(ISR_STATS_UART4);
+    /* USER CODE END UART4_IRQn 1 */
+}
+
+/**
+  * @brief This function handles TIM5 global interrupt.
+  */
+void TIM5_IRQHandler(void)
+{
+    /* USER CODE BEGIN TIM5_IRQn 0 */
+    // The counter is free running: the wrap waited CNT, the drogue alarm on CC1 waited CNT - CCR1
+    uint32_t latencyUs = htim5.Instance->CNT;
+
+    if (__HAL_TIM_GET_FLAG(&htim5, TIM_FLAG_CC1) && __HAL_TIM_GET_IT_SOURCE(&htim5, TIM_IT_CC1))
+    {
+        latencyUs -= htim5.Instance->CCR1;
+    }
+
+    isrStatsEnter(ISR_STATS_TIM5, latencyUs);
+    /* USER CODE END TIM5_IRQn 0 */
+    HAL_TIM_IRQHandler(&htim5);
+    /* USER CODE BEGIN TIM5_IRQn 1 */
+    isrStatsExit(ISR_STATS_TIM5);
+    /* USER CODE END TIM5_IRQn 1 */
+}
+
+/**
+  * @brief This function handles TIM7 global interrupt.
+  */
+void TIM7_IRQHandler(void)
+{
+    /* USER CODE BEGIN TIM7_IRQn 0 */
+    isrStatsEnter(ISR_STATS_TIM7, htim7.Instance->CNT);
+    /* USER CODE END TIM7_IRQn 0 */
+    HAL_TIM_IRQHandler(&htim7);
+    /* USER CODE BEGIN TIM7_IRQn 1 */
+    isrStatsExit(ISR_STATS_TIM7);
+    /* USER CODE END TIM7_IRQn 1 */
+}
+
 /* USER CODE BEGIN 1 */
 
 /* USER CODE END 1 */
@@ -55,6 +55,7 @@
 #include <time.h>
 #include <sys/time.h>
 #include <sys/times.h>
+#include <stdint.h>
 
 
 /* Variables */
@@ -116,10 +117,12 @@ __attribute__((weak)) int _write(int file, char* ptr, int len)
     return len;
 }
 
+extern char end asm("end");
+static char* heap_end;
+static uint32_t sbrkFailures;
+
 caddr_t _sbrk(int incr)
 {
-    extern char end asm("end");
-    static char* heap_end;
     char* prev_heap_end;
 
     if (heap_end == 0)
@@ -133,6 +136,7 @@ caddr_t _sbrk(int incr)
     {
 //		write(1, "Heap and stack collision\n", 25);
 //		abort();
+        sbrkFailures++;
         errno = ENOMEM;
         return (caddr_t) - 1;
     }
@@ -142,6 +146,25 @@ caddr_t _sbrk(int incr)
     return (caddr_t) prev_heap_end;
 }
 
+/**
+ * Bytes between the end of .bss and the program break, i.e. the newlib
+ * malloc arena. sbrk(0) does not work from a task: task stacks are static
+ * in .bss below the break, so _sbrk sees a collision.
+ */
+uint32_t sbrkHeapSize(void)
+{
+    return heap_end ? (uint32_t) (heap_end - &end) : 0;
+}
+
+/**
+ * Number of _sbrk calls refused because the break would pass the stack
+ * pointer.
+ */
+uint32_t sbrkFailureCount(void)
+{
+    return sbrkFailures;
+}
+
 int _close(int file)
 {
     return -1;
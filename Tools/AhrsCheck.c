@@ -0,0 +1,513 @@
+/**
+  ******************************************************************************
+  * File Name          : AhrsCheck.c
+  * Description        : Host checks and benchmark of the attitude filter
+  *                      (Ahrs.h).
+  *
+  *   AhrsCheck check
+  *       Runs the filter on synthetic rotations: a rocket at rest at
+  *       several tilts, a gyroscope bias learnt on the pad, a heading
+  *       found from the magnetometer, a rolling and pitching boost with
+  *       the accelerometer gated out, the same boost with the sample period
+  *       off its nominal value, a coast with 1 g of drag towards the
+  *       tail that the gate must also leave out, and a tumble. The true attitude is
+  *       integrated in double precision with exact rotations on a finer
+  *       step. Fails if a case ends further from the truth than its bound.
+  *
+  *   AhrsCheck bench [updates]
+  *       Time per update with and without the magnetometer, in TSC ticks
+  *       on x86 and ns elsewhere.
+  ******************************************************************************
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "Ahrs.h"
+
+#define PI 3.14159265358979323846
+#define DEG (PI / 180)
+#define SUBSTEPS 25 // Truth steps per filter step
+#define BENCH_DEFAULT_UPDATES 10000000
+#define ODR_STEP_S (1.0f / 119) // The LSM9DS1 output data rate, one update per sample
+
+// The simulator's pad field, north and down, in gauss
+static const double FIELD[3] = {0.23, 0.0, -0.43};
+
+static int failures = 0;
+
+// Angular rates in rad/s and the specific force in g, at time t in s
+typedef void (*Motion)(double t, double* rates, double* force);
+
+static void expect(int condition, const char* what)
+{
+    if (!condition)
+    {
+        printf("FAIL %s\n", what);
+        failures++;
+    }
+}
+
+/* Quaternions ---------------------------------------------------------------*/
+
+static void multiply(const double* a, const double* b, double* out)
+{
+    double w = a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3];
+    double x = a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2];
+    double y = a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1];
+    double z = a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0];
+
+    out[0] = w;
+    out[1] = x;
+    out[2] = y;
+    out[3] = z;
+}
+
+static void fromAxisAngle(double x, double y, double z, double angle, double* q)
+{
+    double norm = sqrt(x * x + y * y + z * z);
+    double s = norm > 0 ? sin(angle / 2) / norm : 0;
+
+    q[0] = cos(angle / 2);
+    q[1] = x * s;
+    q[2] = y * s;
+    q[3] = z * s;
+}
+
+// A local vector in the body frame
+static void toBody(const double* q, const double* v, double* out)
+{
+    double conjugate[4] = {q[0], -q[1], -q[2], -q[3]};
+    double vector[4] = {0, v[0], v[1], v[2]};
+    double half[4];
+    double full[4];
+
+    multiply(conjugate, vector, half);
+    multiply(half, q, full);
+    memcpy(out, &full[1], 3 * sizeof(double));
+}
+
+// Rotation between the two attitudes, in rad
+static double angleBetween(const double* a, const float* b)
+{
+    double dot = fabs(a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]);
+    return 2 * acos(dot > 1 ? 1 : dot);
+}
+
+static double tiltOf(const double* q)
+{
+    double cosTilt = 1 - 2 * (q[1] * q[1] + q[2] * q[2]);
+    return acos(cosTilt > 1 ? 1 : cosTilt < -1 ? -1 : cosTilt);
+}
+
+/* Cases ---------------------------------------------------------------------*/
+
+static double bias[3];
+static double rateAmplitude;
+static double flightTime; // Of the motion, carried from one fly to the next
+static float stepS = ODR_STEP_S; // Between samples, the time step of each update
+
+static void atRest(double t, double* rates, double* force)
+{
+    rates[0] = rates[1] = rates[2] = 0;
+    force[0] = NAN; // Gravity
+}
+
+// 30 dps of roll and 2 dps of pitch over at 5 g, a boost off the rail
+static void boost(double t, double* rates, double* force)
+{
+    rates[0] = 0;
+    rates[1] = 2 * DEG;
+    rates[2] = 30 * DEG;
+    force[0] = 0;
+    force[1] = 0;
+    force[2] = 5;
+}
+
+// 1 dps of pitch over with 1 g of drag along the body -Z, a coast that passes the size gate
+static void coast(double t, double* rates, double* force)
+{
+    rates[0] = 0;
+    rates[1] = 1 * DEG;
+    rates[2] = 0;
+    force[0] = 0;
+    force[1] = 0;
+    force[2] = -1;
+}
+
+// Rates on every axis at different frequencies, in free fall
+static void tumble(double t, double* rates, double* force)
+{
+    rates[0] = rateAmplitude * sin(2 * PI * 0.3 * t);
+    rates[1] = rateAmplitude * cos(2 * PI * 0.7 * t + 1);
+    rates[2] = 0.5 * rateAmplitude * sin(2 * PI * 1.1 * t + 2);
+    force[0] = force[1] = force[2] = 0;
+}
+
+/**
+ * Flies the motion from the attitude for the given time, feeding the
+ * filter what the IMU would read: the mean rate over each step plus the
+ * bias, the specific force, and the field unless noMagneto is set. The
+ * filter starts from scratch unless ahrs is already running. Returns the
+ * final true attitude in truth.
+ */
+static void fly(Ahrs* ahrs, double* truth, Motion motion, double seconds, int noMagneto)
+{
+    long steps = (long) (seconds / stepS + 0.5);
+    double dt = stepS / (double) SUBSTEPS;
+
+    for (long step = 0; step < steps; step++)
+    {
+        double t = flightTime + step * (double) stepS;
+        double meanRates[3] = {0, 0, 0};
+        double rates[3];
+        double force[3];
+        double up[3] = {0, 0, 1};
+        double gravity[3];
+        double field[3];
+        float gyro[3];
+        float accel[3];
+        float magneto[3];
+
+        // The sensors sample the attitude at the start of the step
+        motion(t, rates, force);
+        toBody(truth, up, gravity);
+        toBody(truth, FIELD, field);
+
+        for (int i = 0; i < SUBSTEPS; i++)
+        {
+            double rotation[4];
+            motion(t + (i + 0.5) * dt, rates, force);
+            fromAxisAngle(rates[0], rates[1], rates[2], sqrt(rates[0] * rates[0] + rates[1] * rates[1] + rates[2] * rates[2]) * dt, rotation);
+            multiply(truth, rotation, truth);
+
+            for (int axis = 0; axis < 3; axis++)
+            {
+                meanRates[axis] += rates[axis] / SUBSTEPS;
+            }
+        }
+
+        motion(t, rates, force);
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            gyro[axis] = (float) (meanRates[axis] + bias[axis]);
+            accel[axis] = (float) (isnan(force[0]) ? gravity[axis] : force[axis]);
+            magneto[axis] = (float) field[axis];
+        }
+
+        ahrsUpdate(ahrs, gyro, accel, noMagneto ? NULL : magneto, stepS);
+    }
+
+    flightTime += steps * (double) stepS;
+}
+
+static void checkRest(void)
+{
+    static const double TILTS[] = {0, 5, 30, 90, 150, 180};
+    char what[96];
+
+    memset(bias, 0, sizeof(bias));
+
+    for (size_t i = 0; i < sizeof(TILTS) / sizeof(TILTS[0]); i++)
+    {
+        Ahrs ahrs;
+        double truth[4];
+
+        // About a horizontal axis off X, so every component of the attitude is used
+        fromAxisAngle(1, 0.4, 0, TILTS[i] * DEG, truth);
+        ahrsInit(&ahrs);
+        fly(&ahrs, truth, atRest, stepS, 0);
+
+        snprintf(what, sizeof(what), "at rest %.0f deg, first update tilt %.3f deg", TILTS[i], ahrs.tilt_ / DEG);
+        expect(fabs(ahrs.tilt_ - tiltOf(truth)) < 0.1 * DEG, what);
+
+        fly(&ahrs, truth, atRest, 30, 0);
+        snprintf(what, sizeof(what), "at rest %.0f deg, after 30 s %.3f deg from the truth", TILTS[i], angleBetween(truth, ahrs.q_) / DEG);
+        expect(angleBetween(truth, ahrs.q_) < 1 * DEG, what);
+        snprintf(what, sizeof(what), "at rest %.0f deg, angular rate %.4f dps", TILTS[i], ahrs.angularRate_ / DEG);
+        expect(ahrs.angularRate_ < 0.01 * DEG, what);
+    }
+}
+
+static void checkBias(void)
+{
+    Ahrs ahrs;
+    double truth[4];
+    char what[96];
+
+    bias[0] = 0.5 * DEG;
+    bias[1] = -0.3 * DEG;
+    bias[2] = 0.4 * DEG;
+    fromAxisAngle(0, 1, 0, 4 * DEG, truth); // On the rail
+    ahrsInit(&ahrs);
+    fly(&ahrs, truth, atRest, 120, 0);
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        snprintf(what, sizeof(what), "bias %c learnt on the pad, %.4f dps off", 'X' + axis, (ahrs.gyroBias_[axis] - bias[axis]) / DEG);
+        expect(fabs(ahrs.gyroBias_[axis] - bias[axis]) < 0.02 * DEG, what);
+    }
+
+    snprintf(what, sizeof(what), "tilt with a gyroscope bias, %.3f deg off", (ahrs.tilt_ - tiltOf(truth)) / DEG);
+    expect(fabs(ahrs.tilt_ - tiltOf(truth)) < 0.1 * DEG, what);
+
+    // Then a boost with the accelerometer gated, on the learnt bias
+    fly(&ahrs, truth, boost, 8.5, 0);
+    snprintf(what, sizeof(what), "boost after the bias was learnt, tilt %.3f deg off", (ahrs.tilt_ - tiltOf(truth)) / DEG);
+    expect(fabs(ahrs.tilt_ - tiltOf(truth)) < 0.5 * DEG, what);
+    expect(ahrs.accelRejections_ == (uint32_t) (8.5 / stepS + 0.5), "boost, accelerometer gated every update");
+    memset(bias, 0, sizeof(bias));
+}
+
+static void checkHeading(void)
+{
+    Ahrs ahrs;
+    double truth[4];
+    char what[96];
+
+    // Facing west and leaning on the rail, the first update sets the heading too
+    fromAxisAngle(0, 0, 1, 90 * DEG, truth);
+    double rail[4];
+    fromAxisAngle(0, 1, 0, 4 * DEG, rail);
+    multiply(truth, rail, truth);
+    ahrsInit(&ahrs);
+    fly(&ahrs, truth, atRest, stepS, 0);
+    snprintf(what, sizeof(what), "heading from the first update, %.3f deg off", angleBetween(truth, ahrs.q_) / DEG);
+    expect(angleBetween(truth, ahrs.q_) < 0.1 * DEG, what);
+
+    // Without the magnetometer on the first update the heading starts 90 deg off
+    ahrsInit(&ahrs);
+    fly(&ahrs, truth, atRest, stepS, 1);
+    expect(angleBetween(truth, ahrs.q_) > 80 * DEG, "heading unknown without the magnetometer");
+    fly(&ahrs, truth, atRest, 20, 1);
+    expect(angleBetween(truth, ahrs.q_) > 80 * DEG, "heading stays unknown without the magnetometer");
+
+    // The correction then finds it, without moving the tilt
+    double maxTiltError = 0;
+
+    for (int second = 0; second < 60; second++)
+    {
+        fly(&ahrs, truth, atRest, 1, 0);
+        maxTiltError = fmax(maxTiltError, fabs(ahrs.tilt_ - tiltOf(truth)));
+    }
+
+    snprintf(what, sizeof(what), "heading from the magnetometer after 60 s, %.3f deg off", angleBetween(truth, ahrs.q_) / DEG);
+    expect(angleBetween(truth, ahrs.q_) < 0.5 * DEG, what);
+    snprintf(what, sizeof(what), "heading correction moves the tilt by %.3f deg", maxTiltError / DEG);
+    expect(maxTiltError < 0.1 * DEG, what);
+}
+
+static void checkBoost(void)
+{
+    Ahrs ahrs;
+    double truth[4];
+    double final[4];
+    char what[96];
+
+    fromAxisAngle(0, 1, 0, 4 * DEG, truth);
+    ahrsInit(&ahrs);
+    fly(&ahrs, truth, atRest, 2, 0);
+    fly(&ahrs, truth, boost, 8.5, 0);
+    memcpy(final, truth, sizeof(final));
+
+    snprintf(what, sizeof(what), "boost, tilt %.3f deg against %.3f deg", ahrs.tilt_ / DEG, tiltOf(final) / DEG);
+    expect(fabs(ahrs.tilt_ - tiltOf(final)) < 0.2 * DEG, what);
+    snprintf(what, sizeof(what), "boost, angular rate %.3f dps", ahrs.angularRate_ / DEG);
+    expect(fabs(ahrs.angularRate_ - sqrt(2 * 2 + 30 * 30) * DEG) < 0.1 * DEG, what);
+    snprintf(what, sizeof(what), "boost, vertical specific force %.4f g against %.4f g", ahrs.verticalAccel_, 5 * cos(tiltOf(final)));
+    expect(fabs(ahrs.verticalAccel_ - 5 * cos(tiltOf(final))) < 0.01, what);
+}
+
+static void checkSamplePeriod(void)
+{
+    static const double PERIOD_ERRORS[] = {-0.05, 0.05};
+    char what[112];
+
+    // An oscillator off its nominal rate, the filter steps with the measured period
+    for (size_t i = 0; i < sizeof(PERIOD_ERRORS) / sizeof(PERIOD_ERRORS[0]); i++)
+    {
+        Ahrs ahrs;
+        double truth[4];
+
+        stepS = (float) (ODR_STEP_S * (1 + PERIOD_ERRORS[i]));
+        fromAxisAngle(0, 1, 0, 4 * DEG, truth);
+        ahrsInit(&ahrs);
+        fly(&ahrs, truth, atRest, 2, 0);
+        fly(&ahrs, truth, boost, 8.5, 0);
+
+        snprintf(what, sizeof(what), "boost at a %+.0f %% sample period, %.3f deg from the truth", PERIOD_ERRORS[i] * 100, angleBetween(truth, ahrs.q_) / DEG);
+        expect(angleBetween(truth, ahrs.q_) < 0.5 * DEG, what);
+    }
+
+    stepS = ODR_STEP_S;
+}
+
+static void checkCoast(void)
+{
+    Ahrs ahrs;
+    double truth[4];
+    float learnt[3];
+    char what[112];
+
+    bias[0] = 0.5 * DEG;
+    bias[1] = -0.3 * DEG;
+    bias[2] = 0.4 * DEG;
+    fromAxisAngle(0, 1, 0, 20 * DEG, truth);
+    ahrsInit(&ahrs);
+    fly(&ahrs, truth, atRest, 120, 0);
+    memcpy(learnt, ahrs.gyroBias_, sizeof(learnt));
+    ahrs.accelRejections_ = 0;
+
+    // Drag points the accelerometer at the tail, it must not be taken for up
+    fly(&ahrs, truth, coast, 20, 0);
+    snprintf(what, sizeof(what), "coast with 1 g of drag, tilt %.3f deg against %.3f deg", ahrs.tilt_ / DEG, tiltOf(truth) / DEG);
+    expect(fabs(ahrs.tilt_ - tiltOf(truth)) < 0.5 * DEG, what);
+    expect(ahrs.accelRejections_ == (uint32_t) (20 / stepS + 0.5), "coast, accelerometer gated every update");
+    snprintf(what, sizeof(what), "coast, vertical specific force %.4f g against %.4f g", ahrs.verticalAccel_, -cos(tiltOf(truth)));
+    expect(fabs(ahrs.verticalAccel_ + cos(tiltOf(truth))) < 0.01, what);
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        snprintf(what, sizeof(what), "bias %c kept through the coast, moved %.4f dps", 'X' + axis, (ahrs.gyroBias_[axis] - learnt[axis]) / DEG);
+        expect(ahrs.gyroBias_[axis] == learnt[axis], what);
+    }
+
+    memset(bias, 0, sizeof(bias));
+}
+
+static void checkTumble(void)
+{
+    static const double AMPLITUDES[] = {30, 90, 360};
+    char what[96];
+
+    for (size_t i = 0; i < sizeof(AMPLITUDES) / sizeof(AMPLITUDES[0]); i++)
+    {
+        Ahrs ahrs;
+        double truth[4] = {1, 0, 0, 0};
+
+        rateAmplitude = AMPLITUDES[i] * DEG;
+        ahrsInit(&ahrs);
+        fly(&ahrs, truth, atRest, stepS, 0);
+        flightTime = 0;
+
+        // The motion repeats every 10 s, the worst error is on the way
+        double error = 0;
+
+        for (int chunk = 0; chunk < 40; chunk++)
+        {
+            fly(&ahrs, truth, tumble, 0.25, 1);
+            error = fmax(error, angleBetween(truth, ahrs.q_));
+        }
+
+        snprintf(what, sizeof(what), "tumble at %.0f dps for 10 s, at most %.3f deg from the truth", AMPLITUDES[i], error / DEG);
+        printf("%s\n", what);
+        // Rates change within a step, the error grows with the amplitude
+        expect(error < (AMPLITUDES[i] < 100 ? 0.2 : 3) * DEG, what);
+    }
+}
+
+static int check(void)
+{
+    checkRest();
+    checkBias();
+    checkHeading();
+    checkBoost();
+    checkSamplePeriod();
+    checkCoast();
+    checkTumble();
+
+    printf("%s\n", failures == 0 ? "PASS" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
+
+/* Benchmark -----------------------------------------------------------------*/
+
+static uint64_t ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+/**
+ * Runs count updates on readings that change every update, and returns
+ * the ticks per update.
+ */
+static double benchAhrs(long count, int magneto, int accelAtRest)
+{
+    Ahrs ahrs;
+    uint64_t total = 0;
+    uint32_t rng = 1;
+
+    ahrsInit(&ahrs);
+
+    for (long i = 0; i < count; i++)
+    {
+        rng = rng * 1664525u + 1013904223u;
+        float noise = (float) (rng >> 16) / 65536.0f * 0.01f;
+        float gyro[3] = {0.01f + noise, -0.02f, 0.5f - noise};
+        float accel[3] = {0.05f + noise, -0.03f, accelAtRest ? 1.0f - noise : 5.0f};
+        float field[3] = {0.23f, noise, -0.43f};
+
+        uint64_t start = ticks();
+        ahrsUpdate(&ahrs, gyro, accel, magneto ? field : NULL, ODR_STEP_S);
+        total += ticks() - start;
+    }
+
+    // Keeps the updates from being optimized out
+    if (ahrs.tilt_ > 10.0f)
+    {
+        printf("%f\n", ahrs.tilt_);
+    }
+
+    return (double) total / count;
+}
+
+static int bench(long count)
+{
+    const char* unit =
+#if defined(__x86_64__) || defined(__i386__)
+        "TSC ticks";
+#else
+        "ns";
+#endif
+
+    // Warm up the caches and the branch predictors
+    benchAhrs(count / 10, 1, 1);
+
+    printf("%ld updates per run, %s per update, including the timer reads\n", count, unit);
+    printf("%-34s %10.1f\n", "gyro + accel + magneto, on the pad", benchAhrs(count, 1, 1));
+    printf("%-34s %10.1f\n", "gyro + accel, on the pad", benchAhrs(count, 0, 1));
+    printf("%-34s %10.1f\n", "gyro + magneto, in flight", benchAhrs(count, 1, 0));
+    printf("%-34s %10.1f\n", "gyro only, in flight", benchAhrs(count, 0, 0));
+    printf("Budget on the flight computer: %d cycles\n", AHRS_CYCLE_BUDGET);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc == 2 && strcmp(argv[1], "check") == 0)
+    {
+        return check();
+    }
+
+    if (argc >= 2 && argc <= 3 && strcmp(argv[1], "bench") == 0)
+    {
+        return bench(argc > 2 ? atol(argv[2]) : BENCH_DEFAULT_UPDATES);
+    }
+
+    fprintf(stderr, "usage: %s check | bench [updates]\n", argv[0]);
+    return 2;
+}
@@ -0,0 +1,655 @@
+/**
+  ******************************************************************************
+  * File Name          : AltitudeFilterBench.c
+  * Description        : Host replay and benchmark of the altitude filter
+  *                      (AltitudeFilter.h).
+  *
+  *   AltitudeFilterBench replay [trajectory] [flights] [seed]
+  *       Flies the trajectory, by default the simulator's nominal flight,
+  *       with noisy accelerometer, barometer and GNSS readings, through
+  *       the filter as the parachute control task runs it. Each flight
+  *       draws its own noise, weather and receiver bias. The barometer
+  *       is disturbed around Mach 1 and by the ejection charges. The
+  *       receiver loses its fix above 4 g, like an M8 in its airborne
+  *       model. Prints the altitude and velocity errors, the drogue
+  *       decision time against the true apogee and the altitude of the
+  *       main decision. The filter runs three ways: without GNSS, with
+  *       each fix applied when it arrives, and with each fix applied at
+  *       its epoch.
+  *
+  *   AltitudeFilterBench bench [updates]
+  *       Time per filter step and per GNSS update, in TSC ticks on x86
+  *       and ns elsewhere.
+  ******************************************************************************
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "AltitudeFilter.h"
+
+#define DEFAULT_TRAJECTORY "../Sim/Flights/nominal_trajectory.csv"
+#define DEFAULT_FLIGHTS 200
+#define BENCH_DEFAULT_UPDATES 1000000
+#define MAX_LINE 512
+#define PI 3.14159265358979323846
+
+// As in ParachutesControl.c
+#define STEP_MS 50
+#define PAD_ALTITUDE 1401.0
+#define MAIN_DEPLOYMENT_ALTITUDE (457 + PAD_ALTITUDE)
+#define APOGEE_VELOCITY 10.0
+
+// Sensors
+#define ACCEL_JOB_PERIOD_S 0.010
+#define BAROMETER_JOB_PERIOD_S 0.025
+#define ACCEL_NOISE_MG 30.0
+#define PRESSURE_NOISE_PA 3.0
+#define WEATHER_PRESSURE_PA 300.0 // Sea level pressure spread against the filter's
+
+// Receiver, 10 Hz NAV-PVT
+#define GNSS_PERIOD_S 0.1
+#define GNSS_LATENCY_S 0.0387 // Solution latency and the frame at 115200 baud, as ReadGps.c subtracts
+#define GNSS_JOB_PERIOD_S 0.1
+#define GNSS_ALTITUDE_NOISE_M 2.5
+#define GNSS_ALTITUDE_BIAS_M 2.0
+#define GNSS_VELOCITY_NOISE_MS 0.15
+#define GNSS_ACCURACY_M 3.5
+#define GNSS_MAX_G 4.0
+
+// Barometer disturbances
+#define TRANSONIC_ERROR_M 150.0 // Peak barometric altitude error at Mach 1
+#define EJECTION_PRESSURE_PA 1000.0
+#define EJECTION_DECAY_S 0.5
+
+// The filter sees wrapping sample times early in the flight
+#define TIME_BASE_US 0xFFF00000u
+
+typedef enum
+{
+    MODE_BAROMETER,
+    MODE_GNSS_ARRIVAL,
+    MODE_GNSS_EPOCH,
+    MODE_COUNT
+} Mode;
+
+static const char* const MODE_NAMES[MODE_COUNT] =
+{
+    "accel + baro",
+    "+ GNSS at arrival",
+    "+ GNSS at epoch"
+};
+
+typedef struct
+{
+    double  time_;
+    double  altitude_;
+    double  accelG_[3];
+} Row;
+
+typedef struct
+{
+    Row*    rows_;
+    int     count_;
+    double  launch_; // Above 2 g
+    double  burnout_; // Back below 2 g
+    double  apogee_;
+    double  landing_;
+} Trajectory;
+
+typedef struct
+{
+    double  altitudeRms_;
+    double  velocityRms_;
+    double  transonicError_; // Largest altitude error, m
+    double  ejectionError_; // Largest altitude error in the 2 s after a decision, m
+    double  drogueError_; // Decision time less the true apogee, s
+    double  mainError_; // True altitude at the decision less the deployment altitude, m
+    int     drogue_;
+    int     main_;
+} FlightResult;
+
+static Trajectory trajectory;
+
+/* Trajectory ----------------------------------------------------------------*/
+
+static int column(char* header, const char* name)
+{
+    int index = 0;
+
+    for (char* field = strtok(header, ",\r\n"); field != NULL; field = strtok(NULL, ",\r\n"), index++)
+    {
+        if (strcmp(field, name) == 0)
+        {
+            return index;
+        }
+    }
+
+    return -1;
+}
+
+static int loadTrajectory(const char* path)
+{
+    static const char* const NAMES[] = {"time_s", "altitude_m", "accel_x_g", "accel_y_g", "accel_z_g"};
+    char header[MAX_LINE];
+    char line[MAX_LINE];
+    int columns[5];
+    int capacity = 0;
+    FILE* file = fopen(path, "r");
+
+    if (file == NULL || fgets(header, sizeof(header), file) == NULL)
+    {
+        fprintf(stderr, "cannot read %s\n", path);
+        return 0;
+    }
+
+    for (int i = 0; i < 5; i++)
+    {
+        char copy[MAX_LINE];
+        strcpy(copy, header);
+        columns[i] = column(copy, NAMES[i]);
+
+        if (columns[i] < 0)
+        {
+            fprintf(stderr, "%s has no %s column\n", path, NAMES[i]);
+            return 0;
+        }
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        double values[32];
+        int count = 0;
+
+        for (char* field = strtok(line, ",\r\n"); field != NULL && count < 32; field = strtok(NULL, ",\r\n"))
+        {
+            values[count++] = atof(field);
+        }
+
+        if (count <= columns[4] || count <= columns[1])
+        {
+            continue;
+        }
+
+        if (trajectory.count_ == capacity)
+        {
+            capacity = capacity ? 2 * capacity : 1024;
+            trajectory.rows_ = realloc(trajectory.rows_, capacity * sizeof(Row));
+        }
+
+        Row* row = &trajectory.rows_[trajectory.count_++];
+        row->time_ = values[columns[0]];
+        row->altitude_ = values[columns[1]];
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            row->accelG_[axis] = values[columns[2 + axis]];
+        }
+    }
+
+    fclose(file);
+    return trajectory.count_ > 1;
+}
+
+static void interpolate(double time, double* altitude, double accelG[3])
+{
+    const Row* rows = trajectory.rows_;
+    int high = trajectory.count_ - 1;
+    int low = 0;
+
+    if (time <= rows[0].time_ || time >= rows[high].time_)
+    {
+        const Row* row = time <= rows[0].time_ ? &rows[0] : &rows[high];
+        *altitude = row->altitude_;
+        memcpy(accelG, row->accelG_, sizeof(row->accelG_));
+        return;
+    }
+
+    while (high - low > 1)
+    {
+        int middle = (low + high) / 2;
+
+        if (rows[middle].time_ <= time)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    double fraction = (time - rows[low].time_) / (rows[high].time_ - rows[low].time_);
+    *altitude = rows[low].altitude_ + fraction * (rows[high].altitude_ - rows[low].altitude_);
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        accelG[axis] = rows[low].accelG_[axis] + fraction * (rows[high].accelG_[axis] - rows[low].accelG_[axis]);
+    }
+}
+
+static double altitudeAt(double time)
+{
+    double altitude;
+    double accelG[3];
+
+    interpolate(time, &altitude, accelG);
+    return altitude;
+}
+
+static double velocityAt(double time)
+{
+    return (altitudeAt(time + 0.05) - altitudeAt(time - 0.05)) / 0.1;
+}
+
+static double gAt(double time)
+{
+    double altitude;
+    double accelG[3];
+
+    // The trajectories fly straight up on the body Z axis, so Z is the specific force along up
+    interpolate(time, &altitude, accelG);
+    return accelG[2];
+}
+
+static void findEvents(void)
+{
+    const Row* rows = trajectory.rows_;
+    int apogee = 0;
+
+    for (int i = 0; i < trajectory.count_; i++)
+    {
+        double g = sqrt(rows[i].accelG_[0] * rows[i].accelG_[0] + rows[i].accelG_[1] * rows[i].accelG_[1] + rows[i].accelG_[2] * rows[i].accelG_[2]);
+
+        if (trajectory.launch_ == 0 && g > 2)
+        {
+            trajectory.launch_ = rows[i].time_;
+        }
+        else if (trajectory.launch_ != 0 && trajectory.burnout_ == 0 && g < 2)
+        {
+            trajectory.burnout_ = rows[i].time_;
+        }
+
+        if (rows[i].altitude_ > rows[apogee].altitude_)
+        {
+            apogee = i;
+        }
+    }
+
+    trajectory.apogee_ = rows[apogee].time_;
+    trajectory.landing_ = rows[trajectory.count_ - 1].time_;
+
+    for (int i = apogee; i < trajectory.count_; i++)
+    {
+        if (rows[i].altitude_ <= rows[0].altitude_)
+        {
+            trajectory.landing_ = rows[i].time_;
+            break;
+        }
+    }
+}
+
+/* Sensors -------------------------------------------------------------------*/
+
+static uint32_t rng;
+
+static uint32_t random32(void)
+{
+    // xorshift32
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static double uniform(void)
+{
+    return (random32() + 0.5) / 4294967296.0;
+}
+
+static double gaussian(void)
+{
+    // Box-Muller
+    return sqrt(-2 * log(uniform())) * cos(2 * PI * uniform());
+}
+
+// 1976 standard atmosphere troposphere, as the simulator's barometer
+static double pressureAt(double altitude, double seaLevelPressure)
+{
+    return seaLevelPressure * pow(1.0 - 2.25577e-5 * altitude, 5.25588);
+}
+
+static double speedOfSound(double altitude)
+{
+    return 340.3 - 0.0041 * altitude;
+}
+
+// Static pressure error near Mach 1, as an error of the barometric altitude
+static double transonicError(double time)
+{
+    double mach = fabs(velocityAt(time)) / speedOfSound(altitudeAt(time));
+
+    if (mach < 0.9 || mach > 1.1)
+    {
+        return 0;
+    }
+
+    double shape = sin(PI * (mach - 0.9) / 0.2);
+    return TRANSONIC_ERROR_M * shape * shape;
+}
+
+static uint32_t timeUs(double time)
+{
+    return TIME_BASE_US + (uint32_t) llround(time * 1e6);
+}
+
+/* Replay --------------------------------------------------------------------*/
+
+static void fly(Mode mode, uint32_t seed, FlightResult* result)
+{
+    AltitudeFilter filter;
+    double seaLevelPressure;
+    double gnssBias;
+    double ejections[2] = {-1, -1};
+    double altitudeSquares = 0;
+    double velocitySquares = 0;
+    int steps = 0;
+
+    memset(result, 0, sizeof(*result));
+    rng = seed * 2654435761u + 1;
+    seaLevelPressure = 101325.0 + WEATHER_PRESSURE_PA * gaussian();
+    gnssBias = GNSS_ALTITUDE_BIAS_M * gaussian();
+
+    altitudeFilterInit(&filter, PAD_ALTITUDE);
+
+    // Epochs on the GPS second, the first after the launch
+    double epoch = ceil(trajectory.launch_ / GNSS_PERIOD_S) * GNSS_PERIOD_S;
+    double arrival = epoch + GNSS_LATENCY_S + GNSS_JOB_PERIOD_S * uniform();
+    GnssMeasurement fix;
+    int hasFix = 0;
+
+    for (double step = trajectory.launch_ + STEP_MS / 1000.0; step < trajectory.landing_; step += STEP_MS / 1000.0)
+    {
+        double accelTime = step - ACCEL_JOB_PERIOD_S * uniform();
+        double pressureTime = step - BAROMETER_JOB_PERIOD_S * uniform();
+        double pressureAltitude = altitudeAt(pressureTime) + transonicError(pressureTime);
+        double pressure = pressureAt(pressureAltitude, seaLevelPressure) + PRESSURE_NOISE_PA * gaussian();
+
+        for (int i = 0; i < 2; i++)
+        {
+            if (ejections[i] >= 0 && pressureTime > ejections[i])
+            {
+                pressure += EJECTION_PRESSURE_PA * exp(-(pressureTime - ejections[i]) / EJECTION_DECAY_S);
+            }
+        }
+
+        int32_t accel = (int32_t) lround(gAt(accelTime) * 1000 + ACCEL_NOISE_MG * gaussian());
+        altitudeFilterStep(&filter, accel, (int32_t) lround(pressure), timeUs(accelTime), STEP_MS);
+
+        // The newest fix the GPS job decoded by now, older ones were overwritten
+        while (arrival <= step)
+        {
+            if (fabs(gAt(epoch)) <= GNSS_MAX_G)
+            {
+                fix.altitude_ = altitudeAt(epoch) + gnssBias + GNSS_ALTITUDE_NOISE_M * gaussian();
+                fix.velocity_ = velocityAt(epoch) + GNSS_VELOCITY_NOISE_MS * gaussian();
+                fix.accuracy_ = GNSS_ACCURACY_M;
+                fix.hasVelocity_ = 1;
+                fix.sampleTimeUs_ = timeUs(epoch);
+                hasFix = 1;
+            }
+
+            epoch += GNSS_PERIOD_S;
+            arrival = epoch + GNSS_LATENCY_S + GNSS_JOB_PERIOD_S * uniform();
+        }
+
+        if (hasFix && mode != MODE_BAROMETER)
+        {
+            if (mode == MODE_GNSS_ARRIVAL)
+            {
+                fix.sampleTimeUs_ = filter.sampleTimeUs_;
+            }
+
+            altitudeFilterGnss(&filter, &fix);
+            hasFix = 0;
+        }
+
+        double altitudeError = filter.state_.altitude - altitudeAt(accelTime);
+        double velocityError = filter.state_.velocity - velocityAt(accelTime);
+        altitudeSquares += altitudeError * altitudeError;
+        velocitySquares += velocityError * velocityError;
+        steps++;
+
+        if (transonicError(accelTime) > 0 && fabs(altitudeError) > result->transonicError_)
+        {
+            result->transonicError_ = fabs(altitudeError);
+        }
+
+        for (int i = 0; i < 2; i++)
+        {
+            if (ejections[i] >= 0 && accelTime - ejections[i] < 2 && fabs(altitudeError) > result->ejectionError_)
+            {
+                result->ejectionError_ = fabs(altitudeError);
+            }
+        }
+
+        // The decisions of the coast and drogue descent routines
+        if (!result->drogue_ && step >= trajectory.burnout_ && filter.state_.velocity < APOGEE_VELOCITY)
+        {
+            result->drogue_ = 1;
+            result->drogueError_ = step - trajectory.apogee_;
+            ejections[0] = step;
+        }
+        else if (result->drogue_ && !result->main_ && filter.state_.altitude < MAIN_DEPLOYMENT_ALTITUDE)
+        {
+            result->main_ = 1;
+            result->mainError_ = altitudeAt(step) - MAIN_DEPLOYMENT_ALTITUDE;
+            ejections[1] = step;
+        }
+    }
+
+    result->altitudeRms_ = sqrt(altitudeSquares / steps);
+    result->velocityRms_ = sqrt(velocitySquares / steps);
+}
+
+static int compareDoubles(const void* a, const void* b)
+{
+    double x = *(const double*) a;
+    double y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+// Mean and 95th percentile of the absolute values
+static void summarize(double* values, int count, double* mean, double* p95)
+{
+    double sum = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        values[i] = fabs(values[i]);
+        sum += values[i];
+    }
+
+    qsort(values, count, sizeof(double), compareDoubles);
+    *mean = count ? sum / count : 0;
+    *p95 = count ? values[(int) (0.95 * (count - 1))] : 0;
+}
+
+static int replay(const char* path, int flights, uint32_t seed)
+{
+    if (!loadTrajectory(path))
+    {
+        return 1;
+    }
+
+    findEvents();
+    printf(
+        "%s: launch %.2f s, burnout %.2f s, apogee %.2f s at %.1f m, landing %.2f s\n",
+        path, trajectory.launch_, trajectory.burnout_, trajectory.apogee_, altitudeAt(trajectory.apogee_), trajectory.landing_
+    );
+    printf("%d flights, mean and 95th percentile of the absolute values of:\n", flights);
+    printf("  RMS altitude and velocity errors over the flight\n");
+    printf("  largest altitude errors around Mach 1 and in the 2 s after an ejection\n");
+    printf("  drogue decision time from the true apogee, true altitude at the main decision from the deployment altitude\n\n");
+    printf(
+        "%-18s %15s %15s %15s %15s %15s %15s %8s\n",
+        "", "altitude m", "velocity m/s", "transonic m", "ejection m", "drogue s", "main m", "missed"
+    );
+
+    FlightResult* results = malloc(flights * sizeof(FlightResult));
+    double* values = malloc(flights * sizeof(double));
+
+    for (int mode = 0; mode < MODE_COUNT; mode++)
+    {
+        int missed = 0;
+
+        for (int i = 0; i < flights; i++)
+        {
+            fly((Mode) mode, seed + i, &results[i]);
+            missed += !results[i].drogue_ || !results[i].main_;
+        }
+
+        printf("%-18s", MODE_NAMES[mode]);
+
+        for (int metric = 0; metric < 6; metric++)
+        {
+            int count = 0;
+            double mean;
+            double p95;
+
+            for (int i = 0; i < flights; i++)
+            {
+                const FlightResult* r = &results[i];
+                const double metrics[6] = {r->altitudeRms_, r->velocityRms_, r->transonicError_, r->ejectionError_, r->drogueError_, r->mainError_};
+
+                if ((metric == 4 && !r->drogue_) || (metric == 5 && !r->main_))
+                {
+                    continue;
+                }
+
+                values[count++] = metrics[metric];
+            }
+
+            summarize(values, count, &mean, &p95);
+            printf(" %7.2f %7.2f", mean, p95);
+        }
+
+        printf(" %8d\n", missed);
+    }
+
+    free(results);
+    free(values);
+    return 0;
+}
+
+/* Benchmark -----------------------------------------------------------------*/
+
+static uint64_t ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+/**
+ * Runs count steps, with a fix every second step when gnss is set, and
+ * returns the ticks per step and per fix.
+ */
+static void benchFilter(long count, int gnss, double* stepTicks, double* fixTicks)
+{
+    AltitudeFilter filter;
+    GnssMeasurement fix = {1401.0, 0.0, GNSS_ACCURACY_M, 1, 0};
+    uint64_t stepTotal = 0;
+    uint64_t fixTotal = 0;
+    long fixes = 0;
+
+    altitudeFilterInit(&filter, PAD_ALTITUDE);
+    rng = 1;
+
+    for (long i = 0; i < count; i++)
+    {
+        // Values that change every step, so nothing is hoisted out of the loop
+        int32_t accel = 1000 + (int32_t) (random32() % 61) - 30;
+        int32_t pressure = 85600 + (int32_t) (random32() % 7) - 3;
+        uint32_t sampleTimeUs = (uint32_t) (i * STEP_MS * 1000);
+
+        uint64_t start = ticks();
+        altitudeFilterStep(&filter, accel, pressure, sampleTimeUs, STEP_MS);
+        stepTotal += ticks() - start;
+
+        if (gnss && i % 2 == 1)
+        {
+            // 39 ms old, between the two latest steps
+            fix.sampleTimeUs_ = sampleTimeUs - 39000;
+            fix.altitude_ = 1401.0 + (random32() % 5) * 0.5;
+
+            start = ticks();
+            altitudeFilterGnss(&filter, &fix);
+            fixTotal += ticks() - start;
+            fixes++;
+        }
+    }
+
+    *stepTicks = (double) stepTotal / count;
+    *fixTicks = fixes ? (double) fixTotal / fixes : 0;
+}
+
+static int bench(long count)
+{
+    double stepTicks;
+    double fixTicks;
+    const char* unit =
+#if defined(__x86_64__) || defined(__i386__)
+        "TSC ticks";
+#else
+        "ns";
+#endif
+
+    // Warm up the caches and the branch predictors
+    benchFilter(count / 10, 1, &stepTicks, &fixTicks);
+
+    printf("%ld steps per run, %s per update, including the timer reads\n", count, unit);
+    benchFilter(count, 0, &stepTicks, &fixTicks);
+    printf("%-34s %10.1f\n", "step, accel + baro", stepTicks);
+    benchFilter(count, 1, &stepTicks, &fixTicks);
+    printf("%-34s %10.1f\n", "step, with GNSS", stepTicks);
+    printf("%-34s %10.1f\n", "GNSS update", fixTicks);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc >= 2 && argc <= 5 && strcmp(argv[1], "replay") == 0)
+    {
+        return replay(
+            argc > 2 ? argv[2] : DEFAULT_TRAJECTORY,
+            argc > 3 ? atoi(argv[3]) : DEFAULT_FLIGHTS,
+            argc > 4 ? (uint32_t) strtoul(argv[4], NULL, 0) : 1
+        );
+    }
+
+    if (argc >= 2 && argc <= 3 && strcmp(argv[1], "bench") == 0)
+    {
+        return bench(argc > 2 ? atol(argv[2]) : BENCH_DEFAULT_UPDATES);
+    }
+
+    fprintf(
+        stderr,
+        "usage: %s replay [trajectory] [flights] [seed]\n"
+        "       %s bench [updates]\n",
+        argv[0],
+        argv[0]
+    );
+    return 2;
+}
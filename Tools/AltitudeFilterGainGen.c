@@ -0,0 +1,124 @@
+/**
+  ******************************************************************************
+  * File Name          : AltitudeFilterGainGen.c
+  * Description        : Generates Inc/AltitudeFilterGainTable.h, the gains
+  *                      of AltitudeFilter.c by time step.
+  *
+  *   AltitudeFilterGainGen > ../Inc/AltitudeFilterGainTable.h
+  *       Prints the header: the steady state gain of the noise model of
+  *       AltitudeFilterGain.h at the segment ends, and the largest error
+  *       of linear interpolation between them, taken against the exact
+  *       gain at CHECK_POINTS time steps across every segment.
+  *
+  *   The header is committed, so the firmware builds without the host
+  *   tools. make check fails if it is out of date, and make gain
+  *   regenerates it after the tuner.
+  ******************************************************************************
+*/
+
+#include <math.h>
+#include <stdio.h>
+
+#include "AltitudeFilterGain.h"
+#include "SteadyStateGain.h"
+
+#define FIRST_OCTAVE 10 // 1024 us, a 1 kHz accelerometer FIFO
+#define OCTAVES 8 // To 262144 us, five missed parachute control periods
+#define SEGMENT_BITS 4
+#define SEGMENTS (1 << SEGMENT_BITS)
+#define ENTRIES (OCTAVES * SEGMENTS + 1)
+#define CHECK_POINTS 16 // Per segment
+
+static double entryStepUs(int entry)
+{
+    int octave = entry / SEGMENTS;
+    int segment = entry % SEGMENTS;
+
+    return ldexp(1.0, FIRST_OCTAVE + octave) + segment * ldexp(1.0, FIRST_OCTAVE + octave - SEGMENT_BITS);
+}
+
+static int gainAt(double stepUs, double gain[3][2])
+{
+    return steadyStateGain(stepUs / 1e6, ALTITUDE_FILTER_JERK_NOISE, ALTITUDE_FILTER_BAROMETER_NOISE, ALTITUDE_FILTER_ACCEL_NOISE, gain);
+}
+
+/**
+ * The largest error of any gain interpolated between the exact segment
+ * ends, so the error of the table itself and not of its float arithmetic.
+ */
+static double interpolationError(double table[ENTRIES][3][2])
+{
+    double maxError = 0;
+
+    for (int entry = 0; entry + 1 < ENTRIES; entry++)
+    {
+        double start = entryStepUs(entry);
+        double end = entryStepUs(entry + 1);
+
+        for (int point = 1; point < CHECK_POINTS; point++)
+        {
+            double fraction = (double) point / CHECK_POINTS;
+            double exact[3][2];
+
+            gainAt(start + (end - start) * fraction, exact);
+
+            for (int i = 0; i < 3; i++)
+            {
+                for (int j = 0; j < 2; j++)
+                {
+                    double interpolated = table[entry][i][j] + (table[entry + 1][i][j] - table[entry][i][j]) * fraction;
+                    double error = fabs(interpolated - exact[i][j]);
+
+                    maxError = error > maxError ? error : maxError;
+                }
+            }
+        }
+    }
+
+    return maxError;
+}
+
+int main(void)
+{
+    static double table[ENTRIES][3][2];
+
+    for (int entry = 0; entry < ENTRIES; entry++)
+    {
+        if (!gainAt(entryStepUs(entry), table[entry]))
+        {
+            fprintf(stderr, "AltitudeFilterGainGen: no steady state at %.0f us\n", entryStepUs(entry));
+            return 1;
+        }
+    }
+
+    printf("#pragma once\n\n");
+    printf("/**\n");
+    printf(" * Generated by Tools/AltitudeFilterGainGen, do not edit.\n");
+    printf(" *\n");
+    printf(" * Steady state gain of the noise model of AltitudeFilterGain.h, at %d\n", SEGMENTS);
+    printf(" * uniform segments per octave of time step from %d to %d us.\n", 1 << FIRST_OCTAVE, 1 << (FIRST_OCTAVE + OCTAVES));
+    printf(" * Entry i * %d + j is at 2^(%d + i) * (1 + j / %d) us, and holds the\n", SEGMENTS, FIRST_OCTAVE, SEGMENTS);
+    printf(" * altitude, velocity and acceleration rows of the barometer and\n");
+    printf(" * accelerometer columns.\n");
+    printf(" * Largest linear interpolation error: %.3g\n", interpolationError(table));
+    printf(" */\n\n");
+    printf("#define ALTITUDE_FILTER_TABLE_FIRST_OCTAVE %d\n", FIRST_OCTAVE);
+    printf("#define ALTITUDE_FILTER_TABLE_SEGMENT_BITS %d\n", SEGMENT_BITS);
+    printf("#define ALTITUDE_FILTER_TABLE_SEGMENTS %d\n", SEGMENTS);
+    printf("#define ALTITUDE_FILTER_TABLE_MIN_STEP_US %d\n", 1 << FIRST_OCTAVE);
+    printf("#define ALTITUDE_FILTER_TABLE_MAX_STEP_US %d\n\n", 1 << (FIRST_OCTAVE + OCTAVES));
+    printf("static const float ALTITUDE_FILTER_GAIN_TABLE[%d][3][2] =\n{\n", ENTRIES);
+
+    for (int entry = 0; entry < ENTRIES; entry++)
+    {
+        printf("    {{%.9gf, %.9gf}, {%.9gf, %.9gf}, {%.9gf, %.9gf}}%s // %.0f us\n",
+            (float) table[entry][0][0], (float) table[entry][0][1],
+            (float) table[entry][1][0], (float) table[entry][1][1],
+            (float) table[entry][2][0], (float) table[entry][2][1],
+            entry + 1 < ENTRIES ? "," : "",
+            entryStepUs(entry));
+    }
+
+    printf("};\n");
+    return 0;
+}
@@ -0,0 +1,402 @@
+/**
+  ******************************************************************************
+  * File Name          : ApogeeMonteCarlo.c
+  * Description        : Monte Carlo comparison of the drogue deployment
+  *                      rules, the velocity threshold of old and the apogee
+  *                      predictor (ApogeePredictor.h).
+  *
+  *   ApogeeMonteCarlo [trials] [seed]
+  *       Flies trials vertical flights with a random thrust, burn time,
+  *       drag and sea level pressure. Point mass, quadratic drag falling
+  *       off with the density. The barometer and the accelerometer are
+  *       sampled on the sensor schedule with noise, and the altitude
+  *       filter runs every parachute control period at a random phase
+  *       to it, as on the flight computer. Each rule deploys from the
+  *       filter state:
+  *         threshold: when the filter velocity drops below 10 m/s
+  *         predictor: at the timer instant the predictor schedules, or
+  *                    when the filter velocity changes sign
+  *       Prints the distribution of the deployment time less the true
+  *       apogee time, and of the speed and altitude lost at deployment.
+  *
+  *   ApogeeMonteCarlo check
+  *       The same over CHECK_TRIALS flights. Fails if the predictor
+  *       deploys further than CHECK_MAX_ERROR_MS from apogee in more than
+  *       5 % of the flights, or is not closer than the threshold rule.
+  ******************************************************************************
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "AltitudeFilter.h"
+#include "ApogeePredictor.h"
+
+#define DEFAULT_TRIALS 2000
+#define CHECK_TRIALS 500
+#define CHECK_MAX_ERROR_MS 150.0
+
+#define TRUTH_STEP_US 1000
+#define MAX_FLIGHT_US 120000000 // Well past apogee for any of the flights
+#define TRUTH_SAMPLES (MAX_FLIGHT_US / TRUTH_STEP_US + 1)
+#define LAUNCH_US 2000000 // On the pad before, for the filter to settle
+#define STEP_US 50000 // MONITOR_FOR_PARACHUTES_PERIOD
+#define IMU_PERIOD_US 10000 // SensorSchedule.h
+#define BAROMETER_PERIOD_US 25000
+#define BAROMETER_OFFSET_US 5000 // Conversion started 5 ms into the barometer period
+#define COAST_DELAY_US 500000 // From burnout to the COAST phase
+
+#define PI 3.14159265358979323846
+#define GRAVITY 9.80665
+#define PAD_ALTITUDE 1401.0
+#define DENSITY_SCALE_HEIGHT 8500.0 // m
+#define THRESHOLD_VELOCITY 10.0 // m/s, the rule the predictor replaced
+
+typedef struct
+{
+    double      altitude_; // m
+    double      velocity_; // m/s
+    double      specificForce_; // Felt by the accelerometer along up, m/s^2
+} TruthSample;
+
+typedef struct
+{
+    double      timeErrorMs_; // Deployment less apogee
+    double      speed_; // At deployment, m/s
+    double      altitudeLoss_; // Apogee less the deployment altitude, m
+    int         fallback_; // Predictor only: deployed on the velocity sign change
+} Deployment;
+
+typedef struct
+{
+    double      thrust_; // Specific force, m/s^2
+    uint32_t    burnUs_;
+    double      drag_; // k at sea level, 1/m
+    double      seaLevelPressure_; // Pa
+    uint32_t    stepPhaseUs_; // Of the control task to the sensor schedule
+} Flight;
+
+static TruthSample truth[TRUTH_SAMPLES];
+static uint64_t rngState = 1;
+
+/* Random numbers ------------------------------------------------------------*/
+
+static double uniform(void)
+{
+    // xorshift64*
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return (double) ((rngState * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+static double between(double low, double high)
+{
+    return low + (high - low) * uniform();
+}
+
+static double gaussian(void)
+{
+    double u = uniform();
+    double v = uniform();
+
+    return sqrt(-2 * log(u > 0 ? u : 1e-300)) * cos(2 * PI * v);
+}
+
+/* Flight --------------------------------------------------------------------*/
+
+static double dragAt(const Flight* flight, double altitude)
+{
+    return flight->drag_ * exp(-altitude / DENSITY_SCALE_HEIGHT);
+}
+
+/**
+ * Integrates the flight and returns the apogee time in us, from the zero
+ * crossing of the velocity.
+ */
+static double flyTruth(const Flight* flight)
+{
+    double altitude = PAD_ALTITUDE;
+    double velocity = 0;
+    double apogeeUs = -1;
+    double dt = TRUTH_STEP_US / 1e6;
+
+    for (int i = 0; i < TRUTH_SAMPLES; i++)
+    {
+        uint32_t timeUs = (uint32_t) i * TRUTH_STEP_US;
+        int launched = timeUs >= LAUNCH_US;
+        int burning = launched && timeUs < LAUNCH_US + flight->burnUs_;
+        double drag = dragAt(flight, altitude) * velocity * fabs(velocity);
+        double thrust = burning ? flight->thrust_ : 0;
+
+        // On the pad the rail holds the rocket up, in flight only thrust and drag are felt
+        truth[i].altitude_ = altitude;
+        truth[i].velocity_ = velocity;
+        truth[i].specificForce_ = launched ? thrust - drag : GRAVITY;
+
+        if (!launched)
+        {
+            continue;
+        }
+
+        double acceleration = thrust - drag - GRAVITY;
+        double nextVelocity = velocity + acceleration * dt;
+
+        if (apogeeUs < 0 && !burning && velocity > 0 && nextVelocity <= 0)
+        {
+            apogeeUs = timeUs + velocity / (velocity - nextVelocity) * TRUTH_STEP_US;
+        }
+
+        altitude += 0.5 * (velocity + nextVelocity) * dt;
+        velocity = nextVelocity;
+    }
+
+    return apogeeUs;
+}
+
+static const TruthSample* truthAt(uint32_t timeUs)
+{
+    uint32_t index = timeUs / TRUTH_STEP_US;
+
+    return &truth[index < TRUTH_SAMPLES ? index : TRUTH_SAMPLES - 1];
+}
+
+static int32_t sampleAccel(uint32_t timeUs)
+{
+    // LSM9DS1 noise at the 16 g range, about 5 mg
+    return (int32_t) lround(truthAt(timeUs)->specificForce_ / GRAVITY * 1000 + 5 * gaussian());
+}
+
+static int32_t samplePressure(const Flight* flight, uint32_t timeUs)
+{
+    // The atmosphere of the simulator, the MS5607 at its highest resolution is about 2.5 Pa rms
+    double pressure = flight->seaLevelPressure_ * pow(1.0 - 2.25577e-5 * truthAt(timeUs)->altitude_, 5.25588);
+
+    return (int32_t) lround(pressure + 2.5 * gaussian());
+}
+
+static Deployment deployment(double deployUs, double apogeeUs, int fallback)
+{
+    Deployment result;
+    const TruthSample* sample = truthAt((uint32_t) deployUs);
+
+    result.timeErrorMs_ = (deployUs - apogeeUs) / 1000;
+    result.speed_ = fabs(sample->velocity_);
+    result.altitudeLoss_ = truthAt((uint32_t) apogeeUs)->altitude_ - sample->altitude_;
+    result.fallback_ = fallback;
+    return result;
+}
+
+/**
+ * Runs the filter and both rules over the flight in truth. The IMU is
+ * sampled every IMU_PERIOD_US from 0, the barometer every
+ * BAROMETER_PERIOD_US from BAROMETER_OFFSET_US, and the control task steps at its own phase with the latest
+ * samples.
+ */
+static void flyRules(const Flight* flight, double apogeeUs, Deployment* threshold, Deployment* predicted)
+{
+    AltitudeFilter filter;
+    ApogeePredictor predictor;
+    uint32_t coastUs = LAUNCH_US + flight->burnUs_ + COAST_DELAY_US;
+    int thresholdDone = 0;
+    int predictedDone = 0;
+
+    altitudeFilterInit(&filter, PAD_ALTITUDE);
+    apogeePredictorInit(&predictor);
+
+    for (uint32_t stepUs = flight->stepPhaseUs_; stepUs + STEP_US < MAX_FLIGHT_US; stepUs += STEP_US)
+    {
+        uint32_t accelUs = stepUs / IMU_PERIOD_US * IMU_PERIOD_US;
+        uint32_t pressureUs = stepUs >= BAROMETER_OFFSET_US ? (stepUs - BAROMETER_OFFSET_US) / BAROMETER_PERIOD_US * BAROMETER_PERIOD_US + BAROMETER_OFFSET_US : 0;
+        int32_t accel = sampleAccel(accelUs);
+
+        altitudeFilterStep(&filter, accel, samplePressure(flight, pressureUs), accelUs, STEP_US / 1000.0);
+
+        if (stepUs < coastUs)
+        {
+            continue;
+        }
+
+        if (!thresholdDone && filter.state_.velocity < THRESHOLD_VELOCITY)
+        {
+            *threshold = deployment(stepUs, apogeeUs, 0);
+            thresholdDone = 1;
+        }
+
+        if (!predictedDone)
+        {
+            ApogeeAction action = apogeePredictorUpdate(&predictor, &filter.state_, accel, accelUs);
+
+            if (action == APOGEE_NOW)
+            {
+                *predicted = deployment(stepUs, apogeeUs, 1);
+                predictedDone = 1;
+            }
+            else if (action == APOGEE_SCHEDULE && (int32_t) (predictor.apogeeTimeUs_ - (stepUs + STEP_US)) < 0)
+            {
+                // The alarm goes off before the next step, or at once if its time has passed
+                double alarmUs = (int32_t) (predictor.apogeeTimeUs_ - stepUs) > 0 ? predictor.apogeeTimeUs_ : stepUs;
+
+                *predicted = deployment(alarmUs, apogeeUs, 0);
+                predictedDone = 1;
+            }
+        }
+
+        if (thresholdDone && predictedDone)
+        {
+            return;
+        }
+    }
+}
+
+/* Statistics ----------------------------------------------------------------*/
+
+static int compareDoubles(const void* a, const void* b)
+{
+    double x = *(const double*) a;
+    double y = *(const double*) b;
+
+    return x < y ? -1 : x > y;
+}
+
+static double percentile(const double* sorted, int count, double fraction)
+{
+    return sorted[(int) (fraction * (count - 1) + 0.5)];
+}
+
+static void printDistribution(const char* name, double* values, int count)
+{
+    double sum = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        sum += values[i];
+    }
+
+    qsort(values, count, sizeof(double), compareDoubles);
+    printf("  %-20s %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", name,
+        sum / count,
+        values[0],
+        percentile(values, count, 0.05),
+        percentile(values, count, 0.5),
+        percentile(values, count, 0.95),
+        percentile(values, count, 0.99),
+        values[count - 1]);
+}
+
+/**
+ * Prints the distributions of a rule and returns the 95th percentile of
+ * the absolute time error, in ms.
+ */
+static double printRule(const char* name, const Deployment* deployments, int count)
+{
+    double* values = malloc(count * sizeof(double));
+    int fallbacks = 0;
+
+    printf("%s\n  %-20s %9s %9s %9s %9s %9s %9s %9s\n", name, "", "mean", "min", "p5", "p50", "p95", "p99", "max");
+
+    for (int i = 0; i < count; i++)
+    {
+        values[i] = deployments[i].timeErrorMs_;
+        fallbacks += deployments[i].fallback_;
+    }
+
+    printDistribution("time error (ms)", values, count);
+
+    for (int i = 0; i < count; i++)
+    {
+        values[i] = deployments[i].speed_;
+    }
+
+    printDistribution("speed (m/s)", values, count);
+
+    for (int i = 0; i < count; i++)
+    {
+        values[i] = deployments[i].altitudeLoss_;
+    }
+
+    printDistribution("altitude loss (m)", values, count);
+
+    for (int i = 0; i < count; i++)
+    {
+        values[i] = fabs(deployments[i].timeErrorMs_);
+    }
+
+    qsort(values, count, sizeof(double), compareDoubles);
+    double p95 = percentile(values, count, 0.95);
+
+    printf("  |time error| p95 %.1f ms", p95);
+
+    if (fallbacks != 0)
+    {
+        printf(", %d deployed on the velocity sign change", fallbacks);
+    }
+
+    printf("\n");
+    free(values);
+    return p95;
+}
+
+static int run(int trials, uint64_t seed, int check)
+{
+    Deployment* threshold = calloc(trials, sizeof(Deployment));
+    Deployment* predicted = calloc(trials, sizeof(Deployment));
+
+    rngState = seed != 0 ? seed : 1;
+
+    for (int trial = 0; trial < trials; trial++)
+    {
+        Flight flight;
+
+        flight.thrust_ = between(50, 70);
+        flight.burnUs_ = (uint32_t) between(5e6, 8e6);
+        flight.drag_ = between(2e-5, 2e-4);
+        flight.seaLevelPressure_ = between(100000, 102500);
+        flight.stepPhaseUs_ = (uint32_t) between(0, BAROMETER_PERIOD_US);
+
+        double apogeeUs = flyTruth(&flight);
+
+        flyRules(&flight, apogeeUs, &threshold[trial], &predicted[trial]);
+    }
+
+    printf("%d flights, seed %llu\n", trials, (unsigned long long) seed);
+    double thresholdP95 = printRule("threshold, velocity below 10 m/s", threshold, trials);
+    double predictedP95 = printRule("predictor, timer at the predicted apogee", predicted, trials);
+
+    free(threshold);
+    free(predicted);
+
+    if (!check)
+    {
+        return 0;
+    }
+
+    int pass = predictedP95 <= CHECK_MAX_ERROR_MS && predictedP95 < thresholdP95;
+
+    printf("%s\n", pass ? "PASS" : "FAILED");
+    return pass ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc == 2 && strcmp(argv[1], "check") == 0)
+    {
+        return run(CHECK_TRIALS, 1, 1);
+    }
+
+    if (argc <= 3)
+    {
+        int trials = argc > 1 ? atoi(argv[1]) : DEFAULT_TRIALS;
+        uint64_t seed = argc > 2 ? strtoull(argv[2], NULL, 10) : 1;
+
+        if (trials > 0)
+        {
+            return run(trials, seed, 0);
+        }
+    }
+
+    fprintf(stderr, "usage: %s [trials] [seed] | check\n", argv[0]);
+    return 2;
+}
@@ -0,0 +1,205 @@
+/**
+  ******************************************************************************
+  * File Name          : BarometricAltitudeBench.c
+  * Description        : Host check and benchmark of the pressure to altitude
+  *                      table (BarometricAltitude.h).
+  *
+  *   BarometricAltitudeBench check
+  *       Compares the table with the formula in double precision at every
+  *       whole pressure from 10 to 1200 mbar, for the reference sea level
+  *       pressure, the extremes of BAROMETRIC_MIN_SEA_LEVEL_PRESSURE and
+  *       BAROMETRIC_MAX_SEA_LEVEL_PRESSURE and the flight computer's
+  *       default. Fails if any is off by more than
+  *       BAROMETRIC_ALTITUDE_MAX_ERROR, or if a pressure outside the table
+  *       does not give the formula.
+  *
+  *   BarometricAltitudeBench bench [conversions]
+  *       Time per conversion of the table, of pow in double precision and
+  *       of powf, in TSC ticks on x86 and ns elsewhere.
+  ******************************************************************************
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "BarometricAltitude.h"
+
+#define MIN_PRESSURE 1000 // 10 mbar
+#define MAX_PRESSURE 120000 // 1200 mbar
+#define BENCH_DEFAULT_CONVERSIONS 10000000
+
+static const double SEA_LEVEL_PRESSURES[] =
+{
+    BAROMETRIC_REFERENCE_PRESSURE,
+    BAROMETRIC_MIN_SEA_LEVEL_PRESSURE,
+    BAROMETRIC_MAX_SEA_LEVEL_PRESSURE,
+    101421.93903699999 // AltitudeFilter.c
+};
+
+static int failures = 0;
+
+static void expect(int condition, const char* what)
+{
+    if (!condition)
+    {
+        printf("FAIL %s\n", what);
+        failures++;
+    }
+}
+
+/* Check ---------------------------------------------------------------------*/
+
+static double formula(double seaLevelPressure, double pressure)
+{
+    return BAROMETRIC_SCALE_HEIGHT * (1 - pow(pressure / seaLevelPressure, BAROMETRIC_EXPONENT));
+}
+
+static void checkRange(double seaLevelPressure)
+{
+    BarometricReference reference;
+    double maxError = 0;
+    int32_t maxErrorPressure = 0;
+
+    barometricReferenceInit(&reference, seaLevelPressure);
+
+    for (int32_t pressure = MIN_PRESSURE; pressure <= MAX_PRESSURE; pressure++)
+    {
+        double error = fabs(barometricAltitude(&reference, pressure) - formula(seaLevelPressure, pressure));
+
+        if (error > maxError)
+        {
+            maxError = error;
+            maxErrorPressure = pressure;
+        }
+    }
+
+    printf("sea level %9.2f Pa: max error %.4f m at %d Pa\n", seaLevelPressure, maxError, maxErrorPressure);
+    expect(maxError <= BAROMETRIC_ALTITUDE_MAX_ERROR, "error bound");
+}
+
+static void checkOutside(void)
+{
+    static const int32_t PRESSURES[] = {1, 100, 511, 131072, 200000};
+    BarometricReference reference;
+
+    barometricReferenceInit(&reference, BAROMETRIC_REFERENCE_PRESSURE);
+
+    for (unsigned i = 0; i < sizeof(PRESSURES) / sizeof(PRESSURES[0]); i++)
+    {
+        double expected = formula(BAROMETRIC_REFERENCE_PRESSURE, PRESSURES[i]);
+
+        expect(fabs(barometricAltitude(&reference, PRESSURES[i]) - expected) < 1e-9, "formula outside the table");
+        expect(fabs(barometricAltitudeExact(&reference, PRESSURES[i]) - expected) < 1e-9, "exact altitude");
+    }
+}
+
+static int check(void)
+{
+    for (unsigned i = 0; i < sizeof(SEA_LEVEL_PRESSURES) / sizeof(SEA_LEVEL_PRESSURES[0]); i++)
+    {
+        checkRange(SEA_LEVEL_PRESSURES[i]);
+    }
+
+    checkOutside();
+
+    printf("%s\n", failures == 0 ? "PASS" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
+
+/* Benchmark -----------------------------------------------------------------*/
+
+typedef double (*Conversion)(const BarometricReference* reference, int32_t pressure);
+
+static uint64_t ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+// The formula of AltitudeFilter.c before the table
+static double powDouble(const BarometricReference* reference, int32_t pressure)
+{
+    return 44307.69396 * (1 - pow(pressure / reference->seaLevelPressure_, 0.190284));
+}
+
+static double powSingle(const BarometricReference* reference, int32_t pressure)
+{
+    return 44307.69396f * (1.0f - powf((float) pressure / (float) reference->seaLevelPressure_, 0.190284f));
+}
+
+/**
+ * Converts count pressures that sweep the flight range, and returns the
+ * ticks per conversion. The timer is read once per run, not per
+ * conversion, as a conversion is close to the cost of a timer read.
+ */
+static double benchConversion(Conversion conversion, long count)
+{
+    BarometricReference reference;
+    double sum = 0;
+
+    barometricReferenceInit(&reference, BAROMETRIC_REFERENCE_PRESSURE);
+
+    uint64_t start = ticks();
+
+    for (long i = 0; i < count; i++)
+    {
+        sum += conversion(&reference, MIN_PRESSURE + (int32_t) ((i * 7919) % (MAX_PRESSURE - MIN_PRESSURE)));
+    }
+
+    uint64_t total = ticks() - start;
+
+    // Keeps the conversions from being optimized out
+    if (sum == 1.0)
+    {
+        printf("%f\n", sum);
+    }
+
+    return (double) total / count;
+}
+
+static int bench(long count)
+{
+    const char* unit =
+#if defined(__x86_64__) || defined(__i386__)
+        "TSC ticks";
+#else
+        "ns";
+#endif
+
+    // Warm up the caches and the branch predictors
+    benchConversion(barometricAltitude, count / 10);
+
+    printf("%ld conversions per run, %s per conversion\n", count, unit);
+    printf("%-10s %10.1f\n", "table", benchConversion(barometricAltitude, count));
+    printf("%-10s %10.1f\n", "pow", benchConversion(powDouble, count));
+    printf("%-10s %10.1f\n", "powf", benchConversion(powSingle, count));
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc == 2 && strcmp(argv[1], "check") == 0)
+    {
+        return check();
+    }
+
+    if (argc >= 2 && argc <= 3 && strcmp(argv[1], "bench") == 0)
+    {
+        return bench(argc > 2 ? atol(argv[2]) : BENCH_DEFAULT_CONVERSIONS);
+    }
+
+    fprintf(stderr, "usage: %s check | bench [conversions]\n", argv[0]);
+    return 2;
+}
@@ -0,0 +1,97 @@
+/**
+  ******************************************************************************
+  * File Name          : BarometricTableGen.c
+  * Description        : Generates Inc/BarometricAltitudeTable.h, the
+  *                      pressure to altitude table of BarometricAltitude.c.
+  *
+  *   BarometricTableGen > ../Inc/BarometricAltitudeTable.h
+  *       Prints the header: the altitudes of the standard atmosphere at
+  *       the segment ends, for the reference sea level pressure, and the
+  *       largest error of linear interpolation between them over every
+  *       whole pressure of the table, in double precision.
+  *
+  *   The header is committed, so the firmware builds without the host
+  *   tools. make check fails if it is out of date.
+  ******************************************************************************
+*/
+
+#include <math.h>
+#include <stdio.h>
+
+#include "BarometricAltitude.h"
+
+#define FIRST_OCTAVE 9 // 512 Pa, below 10 mbar
+#define OCTAVES 8 // To 131072 Pa, above 1200 mbar
+#define SEGMENT_BITS 7
+#define SEGMENTS (1 << SEGMENT_BITS)
+#define ENTRIES (OCTAVES * SEGMENTS + 1)
+#define VALUES_PER_LINE 6
+
+static double referenceAltitude(double pressure)
+{
+    return BAROMETRIC_SCALE_HEIGHT * (1 - pow(pressure / BAROMETRIC_REFERENCE_PRESSURE, BAROMETRIC_EXPONENT));
+}
+
+static double entryPressure(int entry)
+{
+    int octave = entry / SEGMENTS;
+    int segment = entry % SEGMENTS;
+
+    return ldexp(1.0, FIRST_OCTAVE + octave) + segment * ldexp(1.0, FIRST_OCTAVE + octave - SEGMENT_BITS);
+}
+
+/**
+ * The largest error of interpolating between the exact segment ends, so
+ * the error of the table itself and not of its float arithmetic.
+ */
+static double interpolationError(void)
+{
+    double maxError = 0;
+    int32_t minPressure = 1 << FIRST_OCTAVE;
+    int32_t maxPressure = 1 << (FIRST_OCTAVE + OCTAVES);
+
+    for (int32_t pressure = minPressure; pressure < maxPressure; pressure++)
+    {
+        int octave = 31 - __builtin_clz((uint32_t) pressure);
+        int shift = octave - SEGMENT_BITS;
+        int entry = (octave - FIRST_OCTAVE) * SEGMENTS + ((pressure - (1 << octave)) >> shift);
+        double start = referenceAltitude(entryPressure(entry));
+        double end = referenceAltitude(entryPressure(entry + 1));
+        double fraction = (pressure - entryPressure(entry)) / ldexp(1.0, shift);
+        double error = fabs(start + (end - start) * fraction - referenceAltitude(pressure));
+
+        maxError = error > maxError ? error : maxError;
+    }
+
+    return maxError;
+}
+
+int main(void)
+{
+    printf("#pragma once\n\n");
+    printf("/**\n");
+    printf(" * Generated by Tools/BarometricTableGen, do not edit.\n");
+    printf(" *\n");
+    printf(" * Altitude in m for a sea level pressure of %d Pa, at %d uniform\n", BAROMETRIC_REFERENCE_PRESSURE, SEGMENTS);
+    printf(" * segments per octave of pressure from %d to %d Pa.\n", 1 << FIRST_OCTAVE, 1 << (FIRST_OCTAVE + OCTAVES));
+    printf(" * Entry i * %d + j is at 2^(%d + i) * (1 + j / %d) Pa.\n", SEGMENTS, FIRST_OCTAVE, SEGMENTS);
+    printf(" * Largest linear interpolation error: %.4f m\n", interpolationError());
+    printf(" */\n\n");
+    printf("#define BAROMETRIC_TABLE_FIRST_OCTAVE %d\n", FIRST_OCTAVE);
+    printf("#define BAROMETRIC_TABLE_SEGMENT_BITS %d\n", SEGMENT_BITS);
+    printf("#define BAROMETRIC_TABLE_SEGMENTS %d\n", SEGMENTS);
+    printf("#define BAROMETRIC_TABLE_MIN_PRESSURE %d\n", 1 << FIRST_OCTAVE);
+    printf("#define BAROMETRIC_TABLE_MAX_PRESSURE %d // Excluded\n\n", 1 << (FIRST_OCTAVE + OCTAVES));
+    printf("static const float BAROMETRIC_ALTITUDE_TABLE[%d] =\n{", ENTRIES);
+
+    for (int entry = 0; entry < ENTRIES; entry++)
+    {
+        printf("%s%.9gf%s",
+            entry % VALUES_PER_LINE == 0 ? "\n    " : " ",
+            (float) referenceAltitude(entryPressure(entry)),
+            entry + 1 < ENTRIES ? "," : "");
+    }
+
+    printf("\n};\n");
+    return 0;
+}
@@ -0,0 +1,900 @@
+/**
+  ******************************************************************************
+  * File Name          : KalmanTuner.c
+  * Description        : Tunes the noise model of the accelerometer and
+  *                      barometer filter (AltitudeFilter.c) and generates
+  *                      Inc/AltitudeFilterGain.h.
+  *
+  *   KalmanTuner [-j threads] [-n flights] [-s seed] [-w weight] [log.csv ...]
+  *       > ../Inc/AltitudeFilterGain.h
+  *       Replays flights through the filter and the apogee predictor as
+  *       the parachute control task runs them, with each candidate gain.
+  *       The flights are n simulated ones, 200 by default, and the
+  *       AvionicsData*.csv logs given:
+  *         simulated: a point mass with a random thrust, burn time, drag
+  *                    and weather. The accelerometer, the barometer and
+  *                    GNSS fixes are sampled with the noise, transonic
+  *                    error and fix loss of Tools/AltitudeFilterBench,
+  *                    and a random accelerometer bias and scale. Half of
+  *                    them fly without a fix, as the gain is all the
+  *                    filter has when the receiver is lost.
+  *         logs:      the recorded accelerometer and barometer, without
+  *                    GNSS as the log holds the ellipsoid height. The
+  *                    reference is the barometric altitude smoothed over
+  *                    LOG_SMOOTHING_S either side, the apogee is its peak.
+  *       Each flight is replayed from LAUNCH_S before launch to
+  *       DESCENT_S after apogee.
+  *
+  *       A candidate is the steady state Kalman gain at the parachute
+  *       control period of a constant acceleration model driven by white
+  *       jerk. The model measures altitude and acceleration. Only the
+  *       ratios of the noises shape the gain, so the barometer noise is
+  *       fixed and the jerk and accelerometer noises are searched. The
+  *       search is a log spaced grid, then REFINE_ROUNDS finer grids
+  *       around the best candidate so far. The cost is the altitude RMS
+  *       over every step of every flight, plus weight m per s of the RMS
+  *       error of the drogue time against apogee, 100 by default.
+  *
+  *       The candidates of a grid are spread over the threads, one per
+  *       online core by default. Each thread replays whole candidates,
+  *       so the run time falls with the number of cores until there are
+  *       fewer candidates than threads. The flights are generated once
+  *       and shared read only.
+  *
+  *       Prints the header on stdout, and the progress and the cost of
+  *       the gain table of AltitudeFilter.c on stderr.
+  ******************************************************************************
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "AltitudeFilter.h"
+#include "ApogeePredictor.h"
+#include "SteadyStateGain.h"
+
+#define DEFAULT_FLIGHTS 200
+#define DEFAULT_APOGEE_WEIGHT 100.0 // m of altitude RMS per s of apogee RMS
+#define MAX_THREADS 64
+#define MAX_LINE 1024
+#define PI 3.14159265358979323846
+
+// As in ParachutesControl.c and EngineControl.c
+#define STEP_S 0.05
+#define PAD_ALTITUDE 1401.0
+#define BURN_DURATION_S 8.5 // COAST starts this long after the launch command
+
+// Noise model
+#define BAROMETER_NOISE 1.0 // m, fixed as only the ratios shape the gain
+#define GRID_POINTS 16
+#define REFINE_POINTS 9
+#define REFINE_ROUNDS 3
+#define MIN_LOG_JERK_NOISE -2.0
+#define MAX_LOG_JERK_NOISE 6.0
+#define MIN_LOG_ACCEL_NOISE -2.0
+#define MAX_LOG_ACCEL_NOISE 2.0
+
+// Replay
+#define LAUNCH_S 2.0 // On the pad before, for the filter to settle
+#define DESCENT_S 30.0
+#define MISSED_APOGEE_S 5.0 // Error charged for a drogue that never fires
+
+// Simulated flights, as Tools/AltitudeFilterBench
+#define TRUTH_STEP_S 0.001
+#define GRAVITY 9.80665
+#define DENSITY_SCALE_HEIGHT 8500.0 // m
+#define DROGUE_DRAG 0.0157 // k of the drogue at sea level, 25 m/s under it
+#define ACCEL_JOB_PERIOD_S 0.010
+#define BAROMETER_JOB_PERIOD_S 0.025
+#define ACCEL_NOISE_MG 30.0
+#define ACCEL_BIAS_MG 20.0 // Per flight, 1 sigma
+#define ACCEL_SCALE_ERROR 0.01 // Per flight, 1 sigma
+#define PRESSURE_NOISE_PA 3.0
+#define WEATHER_PRESSURE_PA 300.0
+#define TRANSONIC_ERROR_M 150.0
+#define GNSS_PERIOD_S 0.1
+#define GNSS_LATENCY_S 0.0387
+#define GNSS_JOB_PERIOD_S 0.1
+#define GNSS_ALTITUDE_NOISE_M 2.5
+#define GNSS_ALTITUDE_BIAS_M 2.0
+#define GNSS_VELOCITY_NOISE_MS 0.15
+#define GNSS_ACCURACY_M 3.5
+#define GNSS_MAX_G 4.0
+#define GNSS_LOST_SHARE 0.5 // Of the flights without a fix, the gain has to do without
+
+// Logs
+#define LOG_SEA_LEVEL_PRESSURE 101421.93903699999 // AltitudeFilter.c
+#define LOG_SMOOTHING_S 0.5
+#define LOG_PHASE_BURN 2 // FlightPhase.h
+#define LOG_PHASE_COAST 3
+
+// The filter sees wrapping sample times early in the flight
+#define TIME_BASE_US 0xFFF00000u
+
+typedef struct
+{
+    double              time_; // Of the step, s from the start of the flight
+    double              accelTime_; // s from the start of the flight
+    uint32_t            accelTimeUs_; // On the timebase
+    int32_t             accel_; // Specific force along up, mg
+    int32_t             pressure_; // Pa
+    double              altitude_; // True or reference, at the accelerometer sample
+    uint8_t             hasFix_;
+    GnssMeasurement     fix_;
+} Step;
+
+typedef struct
+{
+    const char*     name_;
+    Step*           steps_;
+    int             count_;
+    int             capacity_;
+    double          padAltitude_; // Where the filter starts
+    double          coast_; // s, the coast routine runs the predictor from here
+    double          apogee_; // s
+} Flight;
+
+typedef struct
+{
+    double  logJerkNoise_;
+    double  logAccelNoise_;
+    double  gain_[3][2];
+    int     useBuiltIn_; // The gain of AltitudeFilter.c, not the model
+    double  altitudeRms_; // m
+    double  apogeeRms_; // s
+    double  cost_;
+} Candidate;
+
+typedef struct
+{
+    Candidate*      candidates_;
+    int             count_;
+    int             next_;
+    pthread_mutex_t mutex_;
+} Batch;
+
+static Flight* flights = NULL;
+static int flightCount = 0;
+static double apogeeWeight = DEFAULT_APOGEE_WEIGHT;
+static uint64_t rngState = 1;
+
+/* Random numbers ------------------------------------------------------------*/
+
+static double uniform(void)
+{
+    // xorshift64*
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return (double) ((rngState * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+static double between(double low, double high)
+{
+    return low + (high - low) * uniform();
+}
+
+static double gaussian(void)
+{
+    double u = uniform();
+    double v = uniform();
+
+    return sqrt(-2 * log(u > 0 ? u : 1e-300)) * cos(2 * PI * v);
+}
+
+/* Flights -------------------------------------------------------------------*/
+
+static Step* addStep(Flight* flight)
+{
+    if (flight->count_ == flight->capacity_)
+    {
+        flight->capacity_ = flight->capacity_ ? 2 * flight->capacity_ : 1024;
+        flight->steps_ = realloc(flight->steps_, flight->capacity_ * sizeof(Step));
+    }
+
+    Step* step = &flight->steps_[flight->count_++];
+    memset(step, 0, sizeof(*step));
+    return step;
+}
+
+static Flight* addFlight(const char* name)
+{
+    flights = realloc(flights, (flightCount + 1) * sizeof(Flight));
+
+    Flight* flight = &flights[flightCount++];
+    memset(flight, 0, sizeof(*flight));
+    flight->name_ = name;
+    return flight;
+}
+
+static uint32_t timeUs(double time)
+{
+    return TIME_BASE_US + (uint32_t) llround(time * 1e6);
+}
+
+static double pressureAt(double altitude, double seaLevelPressure)
+{
+    return seaLevelPressure * pow(1.0 - 2.25577e-5 * altitude, 5.25588);
+}
+
+typedef struct
+{
+    double  altitude_;
+    double  velocity_;
+    double  g_; // Felt by the accelerometer along up
+} TruthSample;
+
+static const TruthSample* truthAt(const TruthSample* truth, int count, double time)
+{
+    int index = (int) (time / TRUTH_STEP_S);
+
+    return &truth[index < 0 ? 0 : index < count ? index : count - 1];
+}
+
+static double transonicError(const TruthSample* sample)
+{
+    double mach = fabs(sample->velocity_) / (340.3 - 0.0041 * sample->altitude_);
+
+    if (mach < 0.9 || mach > 1.1)
+    {
+        return 0;
+    }
+
+    double shape = sin(PI * (mach - 0.9) / 0.2);
+    return TRANSONIC_ERROR_M * shape * shape;
+}
+
+/**
+ * A vertical flight with the drogue open from apogee, sampled as the
+ * parachute control task reads the sensors.
+ */
+static void simulateFlight(uint64_t seed)
+{
+    double thrust = 0;
+    double burn = 0;
+    double drag = 0;
+    double seaLevelPressure = 0;
+    double gnssBias = 0;
+    double accelBias = 0;
+    double accelScale = 0;
+    int hasGnss = 0;
+
+    rngState = seed;
+    thrust = between(50, 70);
+    burn = between(5, 8);
+    drag = between(2e-5, 2e-4);
+    seaLevelPressure = 101325.0 + WEATHER_PRESSURE_PA * gaussian();
+    gnssBias = GNSS_ALTITUDE_BIAS_M * gaussian();
+    accelBias = ACCEL_BIAS_MG * gaussian();
+    accelScale = 1 + ACCEL_SCALE_ERROR * gaussian();
+    hasGnss = uniform() >= GNSS_LOST_SHARE;
+
+    // Truth until DESCENT_S after apogee
+    int capacity = 1 << 16;
+    int count = 0;
+    TruthSample* truth = malloc(capacity * sizeof(TruthSample));
+    double altitude = PAD_ALTITUDE;
+    double velocity = 0;
+    double apogee = -1;
+
+    for (double time = 0; apogee < 0 || time < apogee + DESCENT_S + 1; time += TRUTH_STEP_S)
+    {
+        int launched = time >= LAUNCH_S;
+        double thrustNow = launched && time < LAUNCH_S + burn ? thrust : 0;
+        double k = (drag + (apogee >= 0 ? DROGUE_DRAG : 0)) * exp(-altitude / DENSITY_SCALE_HEIGHT);
+        double dragNow = k * velocity * fabs(velocity);
+
+        if (count == capacity)
+        {
+            capacity *= 2;
+            truth = realloc(truth, capacity * sizeof(TruthSample));
+        }
+
+        truth[count].altitude_ = altitude;
+        truth[count].velocity_ = velocity;
+        truth[count].g_ = launched ? (thrustNow - dragNow) / GRAVITY : 1;
+        count++;
+
+        if (!launched)
+        {
+            continue;
+        }
+
+        double nextVelocity = velocity + (thrustNow - dragNow - GRAVITY) * TRUTH_STEP_S;
+
+        if (apogee < 0 && time > LAUNCH_S + burn && velocity > 0 && nextVelocity <= 0)
+        {
+            apogee = time + velocity / (velocity - nextVelocity) * TRUTH_STEP_S;
+        }
+
+        altitude += 0.5 * (velocity + nextVelocity) * TRUTH_STEP_S;
+        velocity = nextVelocity;
+    }
+
+    Flight* flight = addFlight("simulated");
+    flight->padAltitude_ = PAD_ALTITUDE;
+    flight->coast_ = LAUNCH_S + BURN_DURATION_S;
+    flight->apogee_ = apogee;
+
+    double epoch = ceil(LAUNCH_S / GNSS_PERIOD_S) * GNSS_PERIOD_S;
+    double arrival = epoch + GNSS_LATENCY_S + GNSS_JOB_PERIOD_S * uniform();
+
+    for (double time = STEP_S; time < apogee + DESCENT_S; time += STEP_S)
+    {
+        double accelTime = time - ACCEL_JOB_PERIOD_S * uniform();
+        double pressureTime = time - BAROMETER_JOB_PERIOD_S * uniform();
+        const TruthSample* atPressure = truthAt(truth, count, pressureTime);
+        double pressure = pressureAt(atPressure->altitude_ + transonicError(atPressure), seaLevelPressure);
+        Step* step = addStep(flight);
+
+        step->time_ = time;
+        step->accelTime_ = accelTime;
+        step->accelTimeUs_ = timeUs(accelTime);
+        step->accel_ = (int32_t) lround(truthAt(truth, count, accelTime)->g_ * 1000 * accelScale + accelBias + ACCEL_NOISE_MG * gaussian());
+        step->pressure_ = (int32_t) lround(pressure + PRESSURE_NOISE_PA * gaussian());
+        step->altitude_ = truthAt(truth, count, accelTime)->altitude_;
+
+        // The newest fix the GPS job decoded by now
+        while (arrival <= time)
+        {
+            const TruthSample* atEpoch = truthAt(truth, count, epoch);
+
+            if (hasGnss && fabs(atEpoch->g_) <= GNSS_MAX_G)
+            {
+                step->hasFix_ = 1;
+                step->fix_.altitude_ = atEpoch->altitude_ + gnssBias + GNSS_ALTITUDE_NOISE_M * gaussian();
+                step->fix_.velocity_ = atEpoch->velocity_ + GNSS_VELOCITY_NOISE_MS * gaussian();
+                step->fix_.accuracy_ = GNSS_ACCURACY_M;
+                step->fix_.hasVelocity_ = 1;
+                step->fix_.sampleTimeUs_ = timeUs(epoch);
+            }
+
+            epoch += GNSS_PERIOD_S;
+            arrival = epoch + GNSS_LATENCY_S + GNSS_JOB_PERIOD_S * uniform();
+        }
+    }
+
+    free(truth);
+}
+
+static int column(const char* header, const char* name)
+{
+    char copy[MAX_LINE];
+    int index = 0;
+
+    strncpy(copy, header, sizeof(copy) - 1);
+    copy[sizeof(copy) - 1] = '\0';
+
+    for (char* field = strtok(copy, ",\r\n"); field != NULL; field = strtok(NULL, ",\r\n"), index++)
+    {
+        if (strcmp(field, name) == 0)
+        {
+            return index;
+        }
+    }
+
+    return -1;
+}
+
+typedef enum
+{
+    LOG_ACCEL_X,
+    LOG_ACCEL_Y,
+    LOG_ACCEL_Z,
+    LOG_PRESSURE,
+    LOG_PHASE,
+    LOG_ELAPSED_TIME,
+    LOG_IMU_SAMPLE_TIME,
+    LOG_COLUMN_COUNT
+} LogColumn;
+
+static const char* const LOG_COLUMNS[LOG_COLUMN_COUNT] =
+{
+    "accelX", "accelY", "accelZ", "pressure", "currentFlightPhase", "elapsedTime(ms)", "imuSampleTime(us)"
+};
+
+typedef struct
+{
+    double      time_; // s
+    uint32_t    accelTimeUs_;
+    int32_t     accel_;
+    int32_t     pressure_;
+    int         phase_;
+    double      altitude_; // Barometric, then smoothed
+} LogRow;
+
+/**
+ * Loads an AvionicsData*.csv log, one step per parachute control period
+ * with the newest row by then.
+ */
+static int loadLog(const char* path)
+{
+    char header[MAX_LINE];
+    char line[MAX_LINE];
+    int columns[LOG_COLUMN_COUNT];
+    FILE* file = fopen(path, "r");
+
+    if (file == NULL || fgets(header, sizeof(header), file) == NULL)
+    {
+        fprintf(stderr, "cannot read %s\n", path);
+        return 0;
+    }
+
+    for (int i = 0; i < LOG_COLUMN_COUNT; i++)
+    {
+        columns[i] = column(header, LOG_COLUMNS[i]);
+
+        if (columns[i] < 0)
+        {
+            fprintf(stderr, "%s has no %s column\n", path, LOG_COLUMNS[i]);
+            fclose(file);
+            return 0;
+        }
+    }
+
+    BarometricReference barometer;
+    LogRow* rows = NULL;
+    int count = 0;
+    int capacity = 0;
+
+    barometricReferenceInit(&barometer, LOG_SEA_LEVEL_PRESSURE);
+
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        double values[64];
+        int fields = 0;
+
+        for (char* field = strtok(line, ",\r\n"); field != NULL && fields < 64; field = strtok(NULL, ",\r\n"))
+        {
+            values[fields++] = atof(field);
+        }
+
+        if (fields < LOG_COLUMN_COUNT || fields <= columns[LOG_IMU_SAMPLE_TIME] || values[columns[LOG_PRESSURE]] <= 0)
+        {
+            continue;
+        }
+
+        if (count == capacity)
+        {
+            capacity = capacity ? 2 * capacity : 4096;
+            rows = realloc(rows, capacity * sizeof(LogRow));
+        }
+
+        LogRow* row = &rows[count++];
+        double x = values[columns[LOG_ACCEL_X]];
+        double y = values[columns[LOG_ACCEL_Y]];
+        double z = values[columns[LOG_ACCEL_Z]];
+
+        row->time_ = values[columns[LOG_ELAPSED_TIME]] / 1000;
+        row->accelTimeUs_ = (uint32_t) values[columns[LOG_IMU_SAMPLE_TIME]];
+        // The log holds no vertical specific force, so the magnitude takes the
+        // sign of the flight phase: in coast the drag points down
+        row->accel_ = (int32_t) lround(sqrt(x * x + y * y + z * z));
+        row->phase_ = (int) values[columns[LOG_PHASE]];
+        row->accel_ = row->phase_ == LOG_PHASE_COAST ? -row->accel_ : row->accel_;
+        row->pressure_ = (int32_t) values[columns[LOG_PRESSURE]];
+        row->altitude_ = barometricAltitudeExact(&barometer, row->pressure_);
+    }
+
+    fclose(file);
+
+    int launch = 0;
+    int coast = -1;
+
+    while (launch < count && rows[launch].phase_ < LOG_PHASE_BURN)
+    {
+        launch++;
+    }
+
+    for (int i = launch; i < count && coast < 0; i++)
+    {
+        if (rows[i].phase_ >= LOG_PHASE_COAST)
+        {
+            coast = i;
+        }
+    }
+
+    if (coast < 0)
+    {
+        fprintf(stderr, "%s has no COAST\n", path);
+        free(rows);
+        return 0;
+    }
+
+    // Centered moving average of the barometric altitude, the reference
+    double* smoothed = malloc(count * sizeof(double));
+    double sum = 0;
+    int low = 0;
+    int high = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        while (high < count && rows[high].time_ <= rows[i].time_ + LOG_SMOOTHING_S)
+        {
+            sum += rows[high++].altitude_;
+        }
+
+        while (rows[low].time_ < rows[i].time_ - LOG_SMOOTHING_S)
+        {
+            sum -= rows[low++].altitude_;
+        }
+
+        smoothed[i] = sum / (high - low);
+    }
+
+    int apogee = coast;
+    int padRows = 0;
+    double padAltitude = 0;
+
+    for (int i = coast; i < count; i++)
+    {
+        apogee = smoothed[i] > smoothed[apogee] ? i : apogee;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        rows[i].altitude_ = smoothed[i];
+
+        if (i < launch && rows[i].time_ >= rows[launch].time_ - LAUNCH_S)
+        {
+            padAltitude += smoothed[i];
+            padRows++;
+        }
+    }
+
+    double apogeeAltitude = smoothed[apogee];
+
+    free(smoothed);
+
+    Flight* flight = addFlight(path);
+    double start = rows[launch].time_ - LAUNCH_S;
+    double time = STEP_S;
+
+    flight->padAltitude_ = padRows != 0 ? padAltitude / padRows : rows[launch].altitude_;
+    flight->coast_ = rows[coast].time_ - start;
+    flight->apogee_ = rows[apogee].time_ - start;
+
+    for (int i = 0; time < flight->apogee_ + DESCENT_S; time += STEP_S)
+    {
+        // The newest row by this step
+        while (i + 1 < count && rows[i + 1].time_ - start <= time)
+        {
+            i++;
+        }
+
+        Step* step = addStep(flight);
+        step->time_ = time;
+        step->accelTime_ = rows[i].time_ - start;
+        step->accelTimeUs_ = rows[i].accelTimeUs_;
+        step->accel_ = rows[i].accel_;
+        step->pressure_ = rows[i].pressure_;
+        step->altitude_ = rows[i].altitude_;
+    }
+
+    free(rows);
+    fprintf(stderr, "%s: %d steps, apogee %.2f s after launch at %.1f m\n",
+        path, flight->count_, flight->apogee_ - LAUNCH_S, apogeeAltitude);
+    return 1;
+}
+
+/* Replay --------------------------------------------------------------------*/
+
+/**
+ * Replays a flight with a gain, NULL for the gain table. Adds the
+ * squared altitude errors to the sums and returns the drogue time less
+ * the apogee, in s.
+ */
+static double replay(const Flight* flight, const double (*gain)[2], double* altitudeSquares, long* steps)
+{
+    AltitudeFilter filter;
+    ApogeePredictor predictor;
+
+    altitudeFilterInit(&filter, flight->padAltitude_);
+    apogeePredictorInit(&predictor);
+
+    if (gain != NULL)
+    {
+        altitudeFilterSetGain(&filter, gain);
+    }
+
+    double drogue = -1;
+
+    for (int i = 0; i < flight->count_; i++)
+    {
+        const Step* step = &flight->steps_[i];
+
+        altitudeFilterStep(&filter, step->accel_, step->pressure_, step->accelTimeUs_, STEP_S * 1000);
+
+        if (step->hasFix_)
+        {
+            altitudeFilterGnss(&filter, &step->fix_);
+        }
+
+        double error = filter.state_.altitude - step->altitude_;
+        *altitudeSquares += error * error;
+        (*steps)++;
+
+        if (drogue >= 0 || step->time_ < flight->coast_)
+        {
+            continue;
+        }
+
+        // The coast routine, the timer goes off before the next step or at once
+        ApogeeAction action = apogeePredictorUpdate(&predictor, &filter.state_, step->accel_, filter.sampleTimeUs_);
+        double alarm = step->accelTime_ + (int32_t) (predictor.apogeeTimeUs_ - filter.sampleTimeUs_) / 1e6;
+
+        if (action == APOGEE_NOW)
+        {
+            drogue = step->time_;
+        }
+        else if (action == APOGEE_SCHEDULE && alarm < step->time_ + STEP_S)
+        {
+            drogue = fmax(step->time_, alarm);
+        }
+    }
+
+    return drogue >= 0 ? drogue - flight->apogee_ : MISSED_APOGEE_S;
+}
+
+static void evaluate(Candidate* candidate)
+{
+    double altitudeSquares = 0;
+    double apogeeSquares = 0;
+    long steps = 0;
+
+    for (int i = 0; i < flightCount; i++)
+    {
+        double apogeeError = replay(&flights[i], candidate->useBuiltIn_ ? NULL : candidate->gain_, &altitudeSquares, &steps);
+
+        apogeeSquares += apogeeError * apogeeError;
+    }
+
+    candidate->altitudeRms_ = sqrt(altitudeSquares / steps);
+    candidate->apogeeRms_ = sqrt(apogeeSquares / flightCount);
+    candidate->cost_ = candidate->altitudeRms_ + apogeeWeight * candidate->apogeeRms_;
+}
+
+static void* worker(void* argument)
+{
+    Batch* batch = (Batch*) argument;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&batch->mutex_);
+        int index = batch->next_++;
+        pthread_mutex_unlock(&batch->mutex_);
+
+        if (index >= batch->count_)
+        {
+            return NULL;
+        }
+
+        evaluate(&batch->candidates_[index]);
+    }
+}
+
+static void evaluateAll(Candidate* candidates, int count, int threads)
+{
+    Batch batch = {candidates, count, 0, PTHREAD_MUTEX_INITIALIZER};
+    pthread_t workers[MAX_THREADS];
+
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_create(&workers[i], NULL, worker, &batch);
+    }
+
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_join(workers[i], NULL);
+    }
+}
+
+/* Search --------------------------------------------------------------------*/
+
+static double wallClock(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * Evaluates a points x points grid of the log noises centered on the best
+ * candidate, spacing apart, and keeps the best.
+ */
+static void searchGrid(Candidate* best, int points, double jerkSpacing, double accelSpacing, int threads)
+{
+    Candidate* grid = calloc(points * points, sizeof(Candidate));
+    int count = 0;
+
+    for (int i = 0; i < points; i++)
+    {
+        for (int j = 0; j < points; j++)
+        {
+            Candidate* candidate = &grid[count];
+
+            candidate->logJerkNoise_ = best->logJerkNoise_ + (i - (points - 1) / 2.0) * jerkSpacing;
+            candidate->logAccelNoise_ = best->logAccelNoise_ + (j - (points - 1) / 2.0) * accelSpacing;
+
+            if (steadyStateGain(STEP_S, pow(10, candidate->logJerkNoise_), BAROMETER_NOISE, pow(10, candidate->logAccelNoise_), candidate->gain_))
+            {
+                count++;
+            }
+        }
+    }
+
+    evaluateAll(grid, count, threads);
+
+    for (int i = 0; i < count; i++)
+    {
+        if (grid[i].cost_ < best->cost_)
+        {
+            *best = grid[i];
+        }
+    }
+
+    free(grid);
+}
+
+static void printCandidate(const char* name, const Candidate* candidate)
+{
+    fprintf(stderr, "%-10s altitude RMS %7.3f m, apogee RMS %7.1f ms, cost %8.3f\n",
+        name, candidate->altitudeRms_, candidate->apogeeRms_ * 1000, candidate->cost_);
+}
+
+static void printHeader(const Candidate* best, const Candidate* builtIn, int simulated, uint64_t seed, char** logs, int logCount)
+{
+    printf("#pragma once\n\n");
+    printf("/**\n");
+    printf(" * Generated by Tools/KalmanTuner, do not edit.\n");
+    printf(" *\n");
+    printf(" * Noise model and steady state gain of the accelerometer and barometer\n");
+    printf(" * filter of AltitudeFilter.c, a constant acceleration model driven by\n");
+    printf(" * white jerk that measures altitude and acceleration. Tuned over %d\n", simulated);
+    printf(" * simulated flights, seed %llu, and %d logs for the least altitude RMS plus\n", (unsigned long long) seed, logCount);
+    printf(" * %g m per s of the RMS error of the drogue time against apogee.\n", apogeeWeight);
+
+    for (int i = 0; i < logCount; i++)
+    {
+        printf(" *   %s\n", logs[i]);
+    }
+
+    printf(" *   this gain:     altitude RMS %.3f m, apogee RMS %.1f ms, cost %.3f\n", best->altitudeRms_, best->apogeeRms_ * 1000, best->cost_);
+    printf(" *   previous gain: altitude RMS %.3f m, apogee RMS %.1f ms, cost %.3f\n", builtIn->altitudeRms_, builtIn->apogeeRms_ * 1000, builtIn->cost_);
+    printf(" *\n");
+    printf(" * Tools/AltitudeFilterGainGen tabulates the gain of this noise model by\n");
+    printf(" * time step in AltitudeFilterGainTable.h, which the filter uses.\n");
+    printf(" * ALTITUDE_FILTER_GAIN is the gain at the step it was tuned for.\n");
+    printf(" */\n\n");
+    printf("#define ALTITUDE_FILTER_GAIN_STEP 0.05 // s, the parachute control period\n");
+    printf("#define ALTITUDE_FILTER_JERK_NOISE %.6g // Spectral density, m^2/s^5\n", pow(10, best->logJerkNoise_));
+    printf("#define ALTITUDE_FILTER_BAROMETER_NOISE %.6g // m\n", BAROMETER_NOISE);
+    printf("#define ALTITUDE_FILTER_ACCEL_NOISE %.6g // m/s^2\n\n", pow(10, best->logAccelNoise_));
+    printf("#define ALTITUDE_FILTER_GAIN \\\n{ \\\n");
+
+    for (int i = 0; i < 3; i++)
+    {
+        printf("    {%.9g, %.9g}%s \\\n", best->gain_[i][0], best->gain_[i][1], i < 2 ? "," : "");
+    }
+
+    printf("}\n");
+}
+
+static int tune(int threads, int simulated, uint64_t seed, char** logs, int logCount)
+{
+    for (int i = 0; i < simulated; i++)
+    {
+        // splitmix64, so the flights do not depend on each other's draws
+        uint64_t z = seed + (uint64_t) (i + 1) * 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        simulateFlight((z ^ (z >> 31)) | 1);
+    }
+
+    for (int i = 0; i < logCount; i++)
+    {
+        if (!loadLog(logs[i]))
+        {
+            return 1;
+        }
+    }
+
+    if (flightCount == 0)
+    {
+        fprintf(stderr, "no flights\n");
+        return 1;
+    }
+
+    long steps = 0;
+
+    for (int i = 0; i < flightCount; i++)
+    {
+        steps += flights[i].count_;
+    }
+
+    double start = wallClock();
+    Candidate builtIn = {0};
+    Candidate best = {0};
+    double jerkSpacing = (MAX_LOG_JERK_NOISE - MIN_LOG_JERK_NOISE) / (GRID_POINTS - 1);
+    double accelSpacing = (MAX_LOG_ACCEL_NOISE - MIN_LOG_ACCEL_NOISE) / (GRID_POINTS - 1);
+    int candidates = 1 + GRID_POINTS * GRID_POINTS + REFINE_ROUNDS * REFINE_POINTS * REFINE_POINTS;
+
+    builtIn.useBuiltIn_ = 1;
+    evaluate(&builtIn);
+
+    best.cost_ = INFINITY;
+    best.logJerkNoise_ = (MIN_LOG_JERK_NOISE + MAX_LOG_JERK_NOISE) / 2;
+    best.logAccelNoise_ = (MIN_LOG_ACCEL_NOISE + MAX_LOG_ACCEL_NOISE) / 2;
+    searchGrid(&best, GRID_POINTS, jerkSpacing, accelSpacing, threads);
+
+    for (int round = 0; round < REFINE_ROUNDS; round++)
+    {
+        // The next grid spans two spacings of this one either side of the best
+        jerkSpacing *= 4.0 / (REFINE_POINTS - 1);
+        accelSpacing *= 4.0 / (REFINE_POINTS - 1);
+        searchGrid(&best, REFINE_POINTS, jerkSpacing, accelSpacing, threads);
+    }
+
+    double seconds = wallClock() - start;
+
+    fprintf(stderr, "%d flights, %ld steps, %d candidates in %.2f s on %d threads, %.2e filter steps/s\n",
+        flightCount, steps, candidates, seconds, threads, (double) steps * candidates / seconds);
+    fprintf(stderr, "best: jerk noise %.4g m^2/s^5, accelerometer noise %.4g m/s^2\n",
+        pow(10, best.logJerkNoise_), pow(10, best.logAccelNoise_));
+
+    if (best.logJerkNoise_ <= MIN_LOG_JERK_NOISE || best.logJerkNoise_ >= MAX_LOG_JERK_NOISE ||
+        best.logAccelNoise_ <= MIN_LOG_ACCEL_NOISE || best.logAccelNoise_ >= MAX_LOG_ACCEL_NOISE)
+    {
+        fprintf(stderr, "warning: the best candidate is at the edge of the search\n");
+    }
+
+    printCandidate("built in", &builtIn);
+    printCandidate("tuned", &best);
+    printHeader(&best, &builtIn, simulated, seed, logs, logCount);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    int threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    int simulated = DEFAULT_FLIGHTS;
+    uint64_t seed = 1;
+    int option;
+
+    while ((option = getopt(argc, argv, "j:n:s:w:")) != -1)
+    {
+        switch (option)
+        {
+            case 'j':
+                threads = atoi(optarg);
+                break;
+
+            case 'n':
+                simulated = atoi(optarg);
+                break;
+
+            case 's':
+                seed = strtoull(optarg, NULL, 10);
+                break;
+
+            case 'w':
+                apogeeWeight = atof(optarg);
+                break;
+
+            default:
+                fprintf(stderr, "usage: %s [-j threads] [-n flights] [-s seed] [-w weight] [log.csv ...]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    threads = threads < 1 ? 1 : threads > MAX_THREADS ? MAX_THREADS : threads;
+    return tune(threads, simulated < 0 ? 0 : simulated, seed, argv + optind, argc - optind);
+}
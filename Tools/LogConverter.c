@@ -0,0 +1,362 @@
+/**
+  ******************************************************************************
+  * File Name          : LogConverter.c
+  * Description        : Host tool for the compressed flight log stream.
+  *
+  *   LogConverter decode <AvionicsDataN.avl> [out.csv]
+  *       Verifies every block and writes the records in the CSV layout
+  *       produced by logDataTask.
+  *
+  *   LogConverter encode <AvionicsDataN.csv> <out.avl>
+  *       Runs a recorded CSV log through the firmware encoder and reports
+  *       the compression ratio and the time spent per block, its appends
+  *       and its finish, in TSC ticks on x86 and ns elsewhere. Each block
+  *       counts its best of ENCODE_PASSES passes. Fails if the worst block
+  *       is over HOST_TICK_BUDGET, LOG_BLOCK_CYCLE_BUDGET scaled from
+  *       Cortex-M4 cycles to host ticks.
+  ******************************************************************************
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// M4_CYCLES_PER_TICK bounds the Cortex-M4 cycles one host tick of the encoder is
+// worth. It is an estimate and not a measurement: the M4 retires at most one
+// instruction per cycle, a desktop core three to four per cycle on this integer
+// code, with its core clock up to 1.5 times its TSC. The logger measures the
+// real cycles with DWT into AvionicsStream<N>.csv.
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TICK_UNIT "TSC ticks"
+#define M4_CYCLES_PER_TICK 8
+#else
+#define TICK_UNIT "ns"
+#define M4_CYCLES_PER_TICK 24 // As for TSC ticks, at 3 GHz
+#endif
+
+#include "LogCompression.h"
+#include "LogFormat.h"
+#include "LogReader.h"
+
+#define IO_BUFFER_SIZE (1 << 20)
+#define CSV_LINE_SIZE 1024
+#define ENCODE_PASSES 5
+// A block within it on the host is within LOG_BLOCK_CYCLE_BUDGET on the target
+#define HOST_TICK_BUDGET (LOG_BLOCK_CYCLE_BUDGET / M4_CYCLES_PER_TICK)
+
+static int decode(int threads, LogOutputFormat format, const char* inPath, const char* outPath)
+{
+    LogReaderStats stats;
+
+    FILE* in = fopen(inPath, "rb");
+    FILE* out = outPath ? fopen(outPath, "wb") : stdout;
+
+    if (!in || !out)
+    {
+        fprintf(stderr, "Cannot open %s\n", !in ? inPath : outPath);
+        return 1;
+    }
+
+    // Large stdio buffers keep the single reader from becoming the bottleneck
+    setvbuf(in, NULL, _IOFBF, IO_BUFFER_SIZE);
+    setvbuf(out, NULL, _IOFBF, IO_BUFFER_SIZE);
+
+    int result = logReaderConvert(in, out, format, threads, &stats);
+
+    fclose(in);
+
+    if (out != stdout && fclose(out) != 0)
+    {
+        result = -1;
+    }
+
+    if (result != 0)
+    {
+        fprintf(stderr, "Writing %s failed\n", outPath ? outPath : "output");
+    }
+
+    fprintf(
+        stderr,
+        "%llu records from %llu blocks, %llu bad, %llu missing, %llu bytes skipped\n"
+        "%.1f MB in, %.1f MB out, %.2f s on %d threads: %.0f records/s, %.1f MB/s\n",
+        stats.records_,
+        stats.blocks_,
+        stats.badBlocks_,
+        stats.missingBlocks_,
+        stats.skippedBytes_,
+        stats.inputBytes_ / 1e6,
+        stats.outputBytes_ / 1e6,
+        stats.seconds_,
+        threads,
+        stats.seconds_ > 0 ? stats.records_ / stats.seconds_ : 0.0,
+        stats.seconds_ > 0 ? stats.inputBytes_ / 1e6 / stats.seconds_ : 0.0
+    );
+
+    return result != 0 || stats.badBlocks_ != 0 || stats.skippedBytes_ != 0;
+}
+
+/**
+ * Parses one CSV log line into a record.
+ *
+ * @return  1 if the line held a full record, 0 for headers, comments and blank lines.
+ */
+static int parseCsvLine(const char* line, LogEntry* entry)
+{
+    const char* p = line;
+
+    for (int i = 0; i < LOG_ENTRY_FIELD_COUNT; i++)
+    {
+        char* end;
+        long long value = strtoll(p, &end, 10);
+
+        if (end == p)
+        {
+            return 0;
+        }
+
+        entry->fields_[i] = (int32_t) (uint32_t) value;
+        p = (*end == ',') ? end + 1 : end;
+    }
+
+    return 1;
+}
+
+static uint64_t ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+/**
+ * Encodes the records as the logger would and writes the stream to out if
+ * it is not NULL. Each block's ticks, its appends and its finish, go into
+ * blockTicks unless they are higher than the ones already there.
+ *
+ * @return  Number of blocks.
+ */
+static unsigned long encodeRecords(const LogEntry* records, unsigned long count, FILE* out, uint64_t* blockTicks, unsigned long* outBytes)
+{
+    static LogStreamEncoder encoder;
+    unsigned long blocks = 0;
+    uint64_t blockTime = 0;
+
+    logStreamInit(&encoder);
+
+    for (unsigned long i = 0; i <= count; i++)
+    {
+        int blockReady = 0;
+        uint64_t start = ticks();
+
+        if (i < count)
+        {
+            blockReady = logStreamAppend(&encoder, &records[i]);
+        }
+
+        uint16_t length = 0;
+
+        if (blockReady || i == count)
+        {
+            length = logStreamFinishBlock(&encoder);
+        }
+
+        blockTime += ticks() - start;
+
+        if (length != 0)
+        {
+            if (out != NULL)
+            {
+                fwrite(encoder.block_, 1, length, out);
+                *outBytes += length;
+            }
+
+            if (blockTime < blockTicks[blocks])
+            {
+                blockTicks[blocks] = blockTime;
+            }
+
+            blocks++;
+        }
+
+        if (blockReady || i == count)
+        {
+            blockTime = 0;
+        }
+    }
+
+    return blocks;
+}
+
+static int encode(const char* inPath, const char* outPath)
+{
+    char line[CSV_LINE_SIZE];
+    LogEntry* records = NULL;
+    unsigned long capacity = 0;
+    unsigned long recordCount = 0;
+    unsigned long inBytes = 0;
+    unsigned long outBytes = 0;
+    unsigned long blocks = 0;
+
+    FILE* in = fopen(inPath, "r");
+    FILE* out = fopen(outPath, "wb");
+
+    if (!in || !out)
+    {
+        fprintf(stderr, "Cannot open %s\n", !in ? inPath : outPath);
+        return 1;
+    }
+
+    while (fgets(line, sizeof(line), in) != NULL)
+    {
+        if (recordCount == capacity)
+        {
+            capacity = capacity ? 2 * capacity : 4096;
+            LogEntry* grown = realloc(records, capacity * sizeof(LogEntry));
+
+            if (grown == NULL)
+            {
+                fprintf(stderr, "Out of memory reading %s\n", inPath);
+                free(records);
+                fclose(in);
+                fclose(out);
+                return 1;
+            }
+
+            records = grown;
+        }
+
+        if (parseCsvLine(line, &records[recordCount]))
+        {
+            // Same byte count the CSV logger would have written for this record
+            char formatted[LOG_ENTRY_MAX_LENGTH + 1];
+            inBytes += formatLogEntry(&records[recordCount], formatted);
+            recordCount++;
+        }
+    }
+
+    fclose(in);
+
+    // Every block holds at least one record, plus the final flush
+    uint64_t* blockTicks = malloc((recordCount + 1) * sizeof(uint64_t));
+
+    if (blockTicks == NULL)
+    {
+        fprintf(stderr, "Out of memory encoding %s\n", inPath);
+        free(records);
+        fclose(out);
+        return 1;
+    }
+
+    for (unsigned long i = 0; i <= recordCount; i++)
+    {
+        blockTicks[i] = UINT64_MAX;
+    }
+
+    // The best of several passes, so an interrupt on the host does not count against a block
+    for (int pass = 0; pass < ENCODE_PASSES; pass++)
+    {
+        blocks = encodeRecords(records, recordCount, pass == 0 ? out : NULL, blockTicks, &outBytes);
+    }
+
+    fclose(out);
+
+    uint64_t totalTicks = 0;
+    uint64_t worstTicks = 0;
+    unsigned long worstBlock = 0;
+
+    for (unsigned long i = 0; i < blocks; i++)
+    {
+        totalTicks += blockTicks[i];
+
+        if (blockTicks[i] > worstTicks)
+        {
+            worstTicks = blockTicks[i];
+            worstBlock = i;
+        }
+    }
+
+    int overBudget = worstTicks > HOST_TICK_BUDGET;
+
+    fprintf(
+        stderr,
+        "%lu records, %lu blocks\n"
+        "CSV bytes %lu, stream bytes %lu, ratio %.2f\n"
+        "%s per block, best of %d passes: mean %.0f, worst %llu (block %lu), budget %d (%d M4 cycles / %d)%s\n",
+        recordCount,
+        blocks,
+        inBytes,
+        outBytes,
+        outBytes ? (double) inBytes / outBytes : 0.0,
+        TICK_UNIT,
+        ENCODE_PASSES,
+        blocks ? (double) totalTicks / blocks : 0.0,
+        (unsigned long long) worstTicks,
+        worstBlock,
+        HOST_TICK_BUDGET,
+        LOG_BLOCK_CYCLE_BUDGET,
+        M4_CYCLES_PER_TICK,
+        overBudget ? ", OVER BUDGET" : ""
+    );
+
+    free(blockTicks);
+    free(records);
+    return overBudget;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc >= 3 && strcmp(argv[1], "decode") == 0)
+    {
+        int threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+        LogOutputFormat format = LOG_OUTPUT_CSV;
+        int option;
+
+        optind = 2;
+
+        while ((option = getopt(argc, argv, "j:c")) != -1)
+        {
+            if (option == 'j')
+            {
+                threads = atoi(optarg);
+            }
+            else if (option == 'c')
+            {
+                format = LOG_OUTPUT_COLUMNAR;
+            }
+            else
+            {
+                optind = argc;
+                break;
+            }
+        }
+
+        if (optind < argc && argc - optind <= 2)
+        {
+            return decode(threads, format, argv[optind], optind + 1 < argc ? argv[optind + 1] : NULL);
+        }
+    }
+
+    if (argc == 4 && strcmp(argv[1], "encode") == 0)
+    {
+        return encode(argv[2], argv[3]);
+    }
+
+    fprintf(
+        stderr,
+        "usage: %s decode [-j threads] [-c] <in.avl> [out]\n"
+        "       %s encode <in.csv> <out.avl>\n"
+        "  -c  write the columnar layout described in LogReader.h instead of CSV\n",
+        argv[0],
+        argv[0]
+    );
+    return 2;
+}
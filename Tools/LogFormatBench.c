@@ -0,0 +1,257 @@
+/**
+  ******************************************************************************
+  * File Name          : LogFormatBench.c
+  * Description        : Host check and benchmark of the log record formatter
+  *                      (LogFormat.h) against the sprintf it replaced.
+  *
+  *   LogFormatBench check [records]
+  *       Formats edge case records, then random ones, 1000000 by default,
+  *       with formatLogEntry and with one sprintf of the same fields: %ld,
+  *       and %lu for the GPS time and the sample times. Fails on the first
+  *       record where the two differ by a byte, or that is longer than
+  *       LOG_ENTRY_MAX_LENGTH.
+  *
+  *   LogFormatBench bench [records]
+  *       Time per record of both, in TSC ticks on x86 and ns elsewhere.
+  ******************************************************************************
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "LogFormat.h"
+
+#define DEFAULT_CHECK_RECORDS 1000000
+#define DEFAULT_BENCH_RECORDS 1000000
+#define BENCH_POOL 1024 // Records formatted in turn, so the branches see varied lengths
+
+static uint64_t rngState = 1;
+
+static uint32_t random32(void)
+{
+    // xorshift64*
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return (uint32_t) ((rngState * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+/**
+ * The record as the sprintf of buildLogEntry wrote it before LogFormat, with
+ * the columns added since.
+ */
+static int referenceFormat(const LogEntry* entry, char* buffer)
+{
+    const int32_t* f = entry->fields_;
+
+    return sprintf(
+               buffer,
+               "%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%lu,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%lu,%lu,%lu,%lu,%lu,%ld,%ld\n",
+               (long) f[LOG_FIELD_ACCEL_X],
+               (long) f[LOG_FIELD_ACCEL_Y],
+               (long) f[LOG_FIELD_ACCEL_Z],
+               (long) f[LOG_FIELD_GYRO_X],
+               (long) f[LOG_FIELD_GYRO_Y],
+               (long) f[LOG_FIELD_GYRO_Z],
+               (long) f[LOG_FIELD_MAGNETO_X],
+               (long) f[LOG_FIELD_MAGNETO_Y],
+               (long) f[LOG_FIELD_MAGNETO_Z],
+               (long) f[LOG_FIELD_PRESSURE],
+               (long) f[LOG_FIELD_TEMPERATURE],
+               (long) f[LOG_FIELD_COMBUSTION_CHAMBER_PRESSURE],
+               (long) f[LOG_FIELD_OXIDIZER_TANK_PRESSURE],
+               (unsigned long) (uint32_t) f[LOG_FIELD_GPS_TIME],
+               (long) f[LOG_FIELD_LATITUDE_DEGREES],
+               (long) f[LOG_FIELD_LATITUDE_MINUTES],
+               (long) f[LOG_FIELD_LONGITUDE_DEGREES],
+               (long) f[LOG_FIELD_LONGITUDE_MINUTES],
+               (long) f[LOG_FIELD_GPS_ALTITUDE],
+               (long) f[LOG_FIELD_FLIGHT_PHASE],
+               (long) f[LOG_FIELD_ELAPSED_TIME],
+               (long) f[LOG_FIELD_SOFTWARE_VERSION],
+               (unsigned long) (uint32_t) f[LOG_FIELD_IMU_SAMPLE_TIME],
+               (unsigned long) (uint32_t) f[LOG_FIELD_BAROMETER_SAMPLE_TIME],
+               (unsigned long) (uint32_t) f[LOG_FIELD_COMBUSTION_CHAMBER_SAMPLE_TIME],
+               (unsigned long) (uint32_t) f[LOG_FIELD_OXIDIZER_TANK_SAMPLE_TIME],
+               (unsigned long) (uint32_t) f[LOG_FIELD_GPS_SAMPLE_TIME],
+               (long) f[LOG_FIELD_TILT],
+               (long) f[LOG_FIELD_ANGULAR_RATE]
+           );
+}
+
+/**
+ * Random fields of every length: a random number of digits, then a random
+ * sign, so short values are as common as long ones.
+ */
+static void randomEntry(LogEntry* entry)
+{
+    for (int i = 0; i < LOG_ENTRY_FIELD_COUNT; i++)
+    {
+        uint32_t value = random32();
+        int bits = random32() % 33;
+
+        entry->fields_[i] = (int32_t) (bits == 32 ? value : value & ((1u << bits) - 1));
+
+        if (random32() & 1)
+        {
+            entry->fields_[i] = (int32_t) (0u - (uint32_t) entry->fields_[i]);
+        }
+    }
+}
+
+static int compare(const LogEntry* entry, const char* what)
+{
+    char expected[LOG_ENTRY_MAX_LENGTH * 2];
+    char actual[LOG_ENTRY_MAX_LENGTH + 1];
+    int expectedLength = referenceFormat(entry, expected);
+    int actualLength = formatLogEntry(entry, actual);
+
+    if (actualLength != expectedLength || memcmp(actual, expected, expectedLength + 1) != 0)
+    {
+        printf("FAIL %s\n  sprintf:        %s  formatLogEntry: %s", what, expected, actual);
+        return 1;
+    }
+
+    if (actualLength > LOG_ENTRY_MAX_LENGTH)
+    {
+        printf("FAIL %s: %d bytes, over LOG_ENTRY_MAX_LENGTH\n", what, actualLength);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int check(long records)
+{
+    static const int64_t EDGES[] =
+    {
+        0, 1, -1, 9, -9, 10, -10, 99, -99, 100, -100, 999, 1000,
+        99999, 100000, 999999999, -999999999, 1000000000, -1000000000,
+        INT32_MAX, INT32_MIN, INT32_MIN + 1, UINT32_MAX
+    };
+    const int edgeCount = sizeof(EDGES) / sizeof(EDGES[0]);
+    LogEntry entry;
+    char what[64];
+
+    // Every edge in every column, the other columns on their neighbours
+    for (int edge = 0; edge < edgeCount; edge++)
+    {
+        for (int i = 0; i < LOG_ENTRY_FIELD_COUNT; i++)
+        {
+            entry.fields_[i] = (int32_t) (uint32_t) EDGES[(edge + i) % edgeCount];
+        }
+
+        snprintf(what, sizeof(what), "edge case %d", edge);
+
+        if (compare(&entry, what))
+        {
+            return 1;
+        }
+    }
+
+    for (long record = 0; record < records; record++)
+    {
+        randomEntry(&entry);
+        snprintf(what, sizeof(what), "random record %ld", record);
+
+        if (compare(&entry, what))
+        {
+            return 1;
+        }
+    }
+
+    printf("passed: %d edge cases, %ld random records byte for byte\n", edgeCount, records);
+    return 0;
+}
+
+/* Benchmark -----------------------------------------------------------------*/
+
+static uint64_t ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+typedef int (*Formatter)(const LogEntry* entry, char* buffer);
+
+/**
+ * Formats count records from the pool and returns the ticks per record.
+ */
+static double benchFormatter(Formatter formatter, const LogEntry* pool, long count)
+{
+    char buffer[LOG_ENTRY_MAX_LENGTH * 2];
+    uint64_t bytes = 0;
+    uint64_t start = ticks();
+
+    for (long i = 0; i < count; i++)
+    {
+        bytes += formatter(&pool[i % BENCH_POOL], buffer);
+    }
+
+    double perRecord = (double) (ticks() - start) / count;
+
+    // Keeps the calls from being optimized out
+    if (bytes == 0)
+    {
+        printf("%s\n", buffer);
+    }
+
+    return perRecord;
+}
+
+static int bench(long count)
+{
+    static LogEntry pool[BENCH_POOL];
+    const char* unit =
+#if defined(__x86_64__) || defined(__i386__)
+        "TSC ticks";
+#else
+        "ns";
+#endif
+
+    for (int i = 0; i < BENCH_POOL; i++)
+    {
+        randomEntry(&pool[i]);
+    }
+
+    // Warm up the caches and the branch predictors
+    benchFormatter(formatLogEntry, pool, count / 10);
+    benchFormatter(referenceFormat, pool, count / 10);
+
+    double formatted = benchFormatter(formatLogEntry, pool, count);
+    double printed = benchFormatter(referenceFormat, pool, count);
+
+    printf("%ld records per run, %s per record\n", count, unit);
+    printf("%-16s %10.1f\n", "formatLogEntry", formatted);
+    printf("%-16s %10.1f\n", "sprintf", printed);
+    printf("speedup %.2fx\n", printed / formatted);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc >= 2 && argc <= 3 && strcmp(argv[1], "check") == 0)
+    {
+        return check(argc > 2 ? atol(argv[2]) : DEFAULT_CHECK_RECORDS);
+    }
+
+    if (argc >= 2 && argc <= 3 && strcmp(argv[1], "bench") == 0)
+    {
+        return bench(argc > 2 ? atol(argv[2]) : DEFAULT_BENCH_RECORDS);
+    }
+
+    fprintf(stderr, "usage: %s check [records] | bench [records]\n", argv[0]);
+    return 2;
+}
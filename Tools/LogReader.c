@@ -0,0 +1,481 @@
+/**
+  ******************************************************************************
+  * File Name          : LogReader.c
+  * Description        : Parallel conversion of the compressed flight log stream
+  *                      to CSV or columnar files.
+  ******************************************************************************
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "LogCompression.h"
+#include "LogFormat.h"
+#include "LogReader.h"
+
+#define BATCH_MAX_RECORDS (LOG_READER_BATCH_BLOCKS * LOG_BLOCK_MAX_RECORDS)
+#define BATCH_CSV_SIZE (BATCH_MAX_RECORDS * LOG_ENTRY_MAX_LENGTH + 1)
+#define BATCH_COLUMNAR_SIZE (4 + BATCH_MAX_RECORDS * LOG_ENTRY_FIELD_COUNT * 4)
+
+typedef enum
+{
+    SLOT_FREE,
+    SLOT_FILLED,
+    SLOT_DECODING,
+    SLOT_DONE,
+} SlotState;
+
+typedef struct
+{
+    SlotState           state_;
+    unsigned long long  batch_;
+    int                 blockCount_;
+    size_t              offsets_[LOG_READER_BATCH_BLOCKS];
+    size_t              lengths_[LOG_READER_BATCH_BLOCKS];
+    uint8_t*            data_;
+    LogEntry*           records_;
+    char*               output_;
+    size_t              outputLength_;
+    unsigned long       recordCount_;
+    int                 badCount_;
+    uint32_t            badSequence_[LOG_READER_BATCH_BLOCKS];
+    int                 badError_[LOG_READER_BATCH_BLOCKS];
+} LogBatch;
+
+typedef struct
+{
+    pthread_mutex_t     mutex_;
+    pthread_cond_t      changed_;
+    LogBatch*           slots_;
+    int                 slotCount_;
+    int                 readerDone_;
+    unsigned long long  batchCount_;
+    int                 writeError_;
+    LogOutputFormat     format_;
+    FILE*               out_;
+    LogReaderStats*     stats_;
+} LogReader;
+
+static void put32(char* p, uint32_t value)
+{
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+    p[2] = (value >> 16) & 0xFF;
+    p[3] = (value >> 24) & 0xFF;
+}
+
+/**
+ * Reads the next block, skipping forward to the next valid header if the
+ * stream is damaged.
+ *
+ * @return  Block length, or 0 at end of file.
+ */
+static size_t readNextBlock(FILE* in, uint8_t* block, LogBlockHeader* header, LogReaderStats* stats)
+{
+    size_t have = fread(block, 1, LOG_BLOCK_HEADER_SIZE, in);
+    stats->inputBytes_ += have;
+
+    while (have == LOG_BLOCK_HEADER_SIZE && logStreamReadHeader(block, header) != 0)
+    {
+        memmove(block, &block[1], LOG_BLOCK_HEADER_SIZE - 1);
+        stats->skippedBytes_++;
+        have = LOG_BLOCK_HEADER_SIZE - 1 + fread(&block[LOG_BLOCK_HEADER_SIZE - 1], 1, 1, in);
+        stats->inputBytes_ += have - (LOG_BLOCK_HEADER_SIZE - 1);
+    }
+
+    if (have < LOG_BLOCK_HEADER_SIZE)
+    {
+        stats->skippedBytes_ += have;
+        return 0;
+    }
+
+    size_t payload = fread(&block[LOG_BLOCK_HEADER_SIZE], 1, header->payloadLength_, in);
+    stats->inputBytes_ += payload;
+
+    if (payload != header->payloadLength_)
+    {
+        stats->skippedBytes_ += LOG_BLOCK_HEADER_SIZE + payload;
+        return 0;
+    }
+
+    return LOG_BLOCK_HEADER_SIZE + payload;
+}
+
+/**
+ * Reads up to LOG_READER_BATCH_BLOCKS blocks into a batch.
+ * Runs on the calling thread only.
+ */
+static void fillBatch(FILE* in, LogBatch* batch, uint32_t* expectedSequence, LogReaderStats* stats)
+{
+    size_t offset = 0;
+    batch->blockCount_ = 0;
+
+    while (batch->blockCount_ < LOG_READER_BATCH_BLOCKS)
+    {
+        LogBlockHeader header;
+        size_t length = readNextBlock(in, &batch->data_[offset], &header, stats);
+
+        if (length == 0)
+        {
+            break;
+        }
+
+        if (stats->blocks_ != 0 && header.sequence_ != *expectedSequence)
+        {
+            if (header.sequence_ > *expectedSequence)
+            {
+                stats->missingBlocks_ += header.sequence_ - *expectedSequence;
+            }
+
+            fprintf(stderr, "Sequence jumps from %lu to %lu\n", (unsigned long) *expectedSequence, (unsigned long) header.sequence_);
+        }
+
+        *expectedSequence = header.sequence_ + 1;
+        stats->blocks_++;
+
+        batch->offsets_[batch->blockCount_] = offset;
+        batch->lengths_[batch->blockCount_] = length;
+        batch->blockCount_++;
+        offset += length;
+    }
+}
+
+static void formatCsv(LogBatch* batch)
+{
+    char* p = batch->output_;
+
+    for (unsigned long i = 0; i < batch->recordCount_; i++)
+    {
+        p += formatLogEntry(&batch->records_[i], p);
+    }
+
+    batch->outputLength_ = p - batch->output_;
+}
+
+static void formatColumnar(LogBatch* batch)
+{
+    char* p = batch->output_;
+
+    put32(p, batch->recordCount_);
+    p += 4;
+
+    for (int field = 0; field < LOG_ENTRY_FIELD_COUNT; field++)
+    {
+        for (unsigned long i = 0; i < batch->recordCount_; i++)
+        {
+            put32(p, (uint32_t) batch->records_[i].fields_[field]);
+            p += 4;
+        }
+    }
+
+    batch->outputLength_ = p - batch->output_;
+}
+
+static void decodeBatch(LogReader* reader, LogBatch* batch)
+{
+    batch->recordCount_ = 0;
+    batch->badCount_ = 0;
+
+    for (int i = 0; i < batch->blockCount_; i++)
+    {
+        const uint8_t* block = &batch->data_[batch->offsets_[i]];
+        int count = logStreamDecodeBlock(block, batch->lengths_[i], &batch->records_[batch->recordCount_], LOG_BLOCK_MAX_RECORDS);
+
+        if (count < 0)
+        {
+            LogBlockHeader header;
+            logStreamReadHeader(block, &header);
+            batch->badSequence_[batch->badCount_] = header.sequence_;
+            batch->badError_[batch->badCount_] = count;
+            batch->badCount_++;
+            continue;
+        }
+
+        batch->recordCount_ += count;
+    }
+
+    if (reader->format_ == LOG_OUTPUT_COLUMNAR)
+    {
+        formatColumnar(batch);
+    }
+    else
+    {
+        formatCsv(batch);
+    }
+}
+
+static void* decodeThread(void* arg)
+{
+    LogReader* reader = arg;
+
+    pthread_mutex_lock(&reader->mutex_);
+
+    for (;;)
+    {
+        LogBatch* next = NULL;
+
+        for (int i = 0; i < reader->slotCount_; i++)
+        {
+            LogBatch* slot = &reader->slots_[i];
+
+            if (slot->state_ == SLOT_FILLED && (!next || slot->batch_ < next->batch_))
+            {
+                next = slot;
+            }
+        }
+
+        if (!next)
+        {
+            if (reader->readerDone_)
+            {
+                break;
+            }
+
+            pthread_cond_wait(&reader->changed_, &reader->mutex_);
+            continue;
+        }
+
+        next->state_ = SLOT_DECODING;
+        pthread_mutex_unlock(&reader->mutex_);
+
+        decodeBatch(reader, next);
+
+        pthread_mutex_lock(&reader->mutex_);
+        next->state_ = SLOT_DONE;
+        pthread_cond_broadcast(&reader->changed_);
+    }
+
+    pthread_mutex_unlock(&reader->mutex_);
+    return NULL;
+}
+
+static void* writeThread(void* arg)
+{
+    LogReader* reader = arg;
+    LogReaderStats* stats = reader->stats_;
+
+    for (unsigned long long n = 0;; n++)
+    {
+        LogBatch* batch = &reader->slots_[n % reader->slotCount_];
+
+        pthread_mutex_lock(&reader->mutex_);
+
+        while (!(batch->state_ == SLOT_DONE && batch->batch_ == n) && !(reader->readerDone_ && n >= reader->batchCount_))
+        {
+            pthread_cond_wait(&reader->changed_, &reader->mutex_);
+        }
+
+        int ready = batch->state_ == SLOT_DONE && batch->batch_ == n;
+        pthread_mutex_unlock(&reader->mutex_);
+
+        if (!ready)
+        {
+            break;
+        }
+
+        for (int i = 0; i < batch->badCount_; i++)
+        {
+            fprintf(
+                stderr,
+                "Block %lu: %s\n",
+                (unsigned long) batch->badSequence_[i],
+                batch->badError_[i] == LOG_STREAM_ERROR_CRC ? "CRC mismatch" : "malformed"
+            );
+        }
+
+        stats->badBlocks_ += batch->badCount_;
+        stats->records_ += batch->recordCount_;
+
+        // Keep draining after a write error so the reader never stalls on a full pipeline
+        int failed = 0;
+
+        if (!reader->writeError_ && batch->recordCount_ != 0)
+        {
+            failed = fwrite(batch->output_, 1, batch->outputLength_, reader->out_) != batch->outputLength_;
+            stats->outputBytes_ += batch->outputLength_;
+        }
+
+        pthread_mutex_lock(&reader->mutex_);
+        reader->writeError_ |= failed;
+        batch->state_ = SLOT_FREE;
+        pthread_cond_broadcast(&reader->changed_);
+        pthread_mutex_unlock(&reader->mutex_);
+    }
+
+    return NULL;
+}
+
+static int writeFileHeader(LogReader* reader)
+{
+    size_t headerLength = strlen(LOG_FILE_HEADER);
+
+    if (reader->format_ == LOG_OUTPUT_COLUMNAR)
+    {
+        char prefix[16];
+        memcpy(prefix, LOG_COLUMNAR_MAGIC, 4);
+        put32(&prefix[4], LOG_COLUMNAR_VERSION);
+        put32(&prefix[8], LOG_ENTRY_FIELD_COUNT);
+        put32(&prefix[12], headerLength);
+
+        if (fwrite(prefix, 1, sizeof(prefix), reader->out_) != sizeof(prefix))
+        {
+            return -1;
+        }
+
+        reader->stats_->outputBytes_ += sizeof(prefix);
+    }
+
+    if (fwrite(LOG_FILE_HEADER, 1, headerLength, reader->out_) != headerLength)
+    {
+        return -1;
+    }
+
+    reader->stats_->outputBytes_ += headerLength;
+    return 0;
+}
+
+static void freeSlots(LogReader* reader)
+{
+    if (!reader->slots_)
+    {
+        return;
+    }
+
+    for (int i = 0; i < reader->slotCount_; i++)
+    {
+        free(reader->slots_[i].data_);
+        free(reader->slots_[i].records_);
+        free(reader->slots_[i].output_);
+    }
+
+    free(reader->slots_);
+}
+
+static int allocateSlots(LogReader* reader)
+{
+    size_t outputSize = reader->format_ == LOG_OUTPUT_COLUMNAR ? BATCH_COLUMNAR_SIZE : BATCH_CSV_SIZE;
+
+    reader->slots_ = calloc(reader->slotCount_, sizeof(LogBatch));
+
+    if (!reader->slots_)
+    {
+        return -1;
+    }
+
+    for (int i = 0; i < reader->slotCount_; i++)
+    {
+        LogBatch* slot = &reader->slots_[i];
+        slot->state_ = SLOT_FREE;
+        slot->data_ = malloc(LOG_READER_BATCH_BLOCKS * LOG_BLOCK_MAX_SIZE);
+        slot->records_ = malloc(BATCH_MAX_RECORDS * sizeof(LogEntry));
+        slot->output_ = malloc(outputSize);
+
+        if (!slot->data_ || !slot->records_ || !slot->output_)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int logReaderConvert(FILE* in, FILE* out, LogOutputFormat format, int threads, LogReaderStats* stats)
+{
+    LogReader reader;
+    pthread_t decoders[LOG_READER_MAX_THREADS];
+    pthread_t writer;
+    uint32_t expectedSequence = 0;
+    struct timespec start;
+    struct timespec end;
+
+    threads = threads < 1 ? 1 : threads > LOG_READER_MAX_THREADS ? LOG_READER_MAX_THREADS : threads;
+
+    memset(stats, 0, sizeof(*stats));
+    memset(&reader, 0, sizeof(reader));
+    reader.slotCount_ = threads * LOG_READER_SLOTS_PER_THREAD;
+    reader.format_ = format;
+    reader.out_ = out;
+    reader.stats_ = stats;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (allocateSlots(&reader) != 0 || writeFileHeader(&reader) != 0)
+    {
+        freeSlots(&reader);
+        return -1;
+    }
+
+    pthread_mutex_init(&reader.mutex_, NULL);
+    pthread_cond_init(&reader.changed_, NULL);
+
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_create(&decoders[i], NULL, decodeThread, &reader);
+    }
+
+    pthread_create(&writer, NULL, writeThread, &reader);
+
+    for (unsigned long long n = 0; !feof(in); n++)
+    {
+        LogBatch* batch = &reader.slots_[n % reader.slotCount_];
+
+        pthread_mutex_lock(&reader.mutex_);
+
+        while (batch->state_ != SLOT_FREE)
+        {
+            pthread_cond_wait(&reader.changed_, &reader.mutex_);
+        }
+
+        int failed = reader.writeError_;
+        pthread_mutex_unlock(&reader.mutex_);
+
+        if (failed)
+        {
+            break;
+        }
+
+        fillBatch(in, batch, &expectedSequence, stats);
+
+        if (batch->blockCount_ == 0)
+        {
+            break;
+        }
+
+        pthread_mutex_lock(&reader.mutex_);
+        batch->batch_ = n;
+        batch->state_ = SLOT_FILLED;
+        reader.batchCount_ = n + 1;
+        pthread_cond_broadcast(&reader.changed_);
+        pthread_mutex_unlock(&reader.mutex_);
+    }
+
+    pthread_mutex_lock(&reader.mutex_);
+    reader.readerDone_ = 1;
+    pthread_cond_broadcast(&reader.changed_);
+    pthread_mutex_unlock(&reader.mutex_);
+
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_join(decoders[i], NULL);
+    }
+
+    pthread_join(writer, NULL);
+
+    if (fflush(out) != 0)
+    {
+        reader.writeError_ = 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    stats->seconds_ = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    pthread_cond_destroy(&reader.changed_);
+    pthread_mutex_destroy(&reader.mutex_);
+    freeSlots(&reader);
+
+    return reader.writeError_ ? -1 : 0;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Parallel reader for the compressed flight log stream (LogCompression.h).
+ *
+ * The input is read sequentially in batches of blocks. Batches are decoded
+ * and formatted on worker threads and written back in order, so output is
+ * identical to a single threaded conversion. At most LOG_READER_SLOTS_PER_THREAD
+ * batches per worker are in flight, so memory use does not depend on the
+ * input size.
+ *
+ * Columnar output (.avc), little endian:
+ *   char[4] "AVLC"
+ *   uint32  LOG_COLUMNAR_VERSION
+ *   uint32  field count
+ *   uint32  header length, followed by the CSV header text
+ *   row groups until end of file:
+ *     uint32  record count N
+ *     N int32 values for each field in LogField order
+ */
+
+#define LOG_READER_BATCH_BLOCKS 64
+#define LOG_READER_SLOTS_PER_THREAD 2
+#define LOG_READER_MAX_THREADS 64
+#define LOG_COLUMNAR_MAGIC "AVLC"
+#define LOG_COLUMNAR_VERSION 1
+
+typedef enum
+{
+    LOG_OUTPUT_CSV,
+    LOG_OUTPUT_COLUMNAR,
+} LogOutputFormat;
+
+typedef struct
+{
+    unsigned long long  blocks_;
+    unsigned long long  badBlocks_;     // Failed CRC or could not be decoded
+    unsigned long long  missingBlocks_; // Gaps in the sequence numbers
+    unsigned long long  records_;
+    unsigned long long  inputBytes_;
+    unsigned long long  skippedBytes_;  // Skipped while searching for the next block header
+    unsigned long long  outputBytes_;
+    double              seconds_;
+} LogReaderStats;
+
+/**
+ * Converts a whole stream.
+ *
+ * @param   in      Stream file opened for binary reading.
+ * @param   out     Output file, opened for binary writing for columnar output.
+ * @param   format  Output layout.
+ * @param   threads Number of decoding threads, clamped to 1..LOG_READER_MAX_THREADS.
+ * @param   stats   Filled in with totals for the run.
+ * @return  0 on success, -1 if the output could not be written or memory ran out.
+ */
+int logReaderConvert(FILE* in, FILE* out, LogOutputFormat format, int threads, LogReaderStats* stats);
@@ -0,0 +1,627 @@
+/**
+  ******************************************************************************
+  * File Name          : NmeaBench.c
+  * Description        : Host checks and benchmark of the NMEA parser (Nmea.h).
+  *
+  *   NmeaBench check
+  *       Decodes a set of sentences and compares every field with the
+  *       expected value.
+  *
+  *   NmeaBench fuzz [iterations] [seed]
+  *       Feeds mutated sentences and random bytes. Every sentence the
+  *       parser hands out must have a matching checksum and fields in
+  *       range, and a valid sentence after the garbage must still decode.
+  *       Run from the sanitized build by "make check".
+  *
+  *   NmeaBench bench [sentences]
+  *       Time per sentence of the parser against the strtok and atof GGA
+  *       path it replaced, in TSC ticks on x86 and ns elsewhere.
+  ******************************************************************************
+*/
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "Nmea.h"
+
+#define MAX_TEXT 256
+#define FUZZ_DEFAULT_ITERATIONS 200000
+#define BENCH_DEFAULT_SENTENCES 200000
+
+// Flight receiver output at 1 Hz and the corners of the field decoders
+static const char GGA[] = "$GPGGA,172814.0,3723.4659,N,12202.2696,W,2,6,1.2,18.893,M,-25.669,M,2.0,0031*44\r\n";
+static const char GGA_SOUTH_EAST[] = "$GNGGA,001043.00,3340.34399,S,15113.26586,E,1,12,0.50,-1.5,M,22.2,M,,*7C\r\n";
+static const char GGA_NO_FIX[] = "$GPGGA,,,,,,0,00,99.99,,,,,,*48\r\n";
+static const char GGA_TOO_LONG[] = "$GPGGA,172814.0,3723.46587704,N,12202.26957864,W,2,6,1.2,18.893,M,-25.669,M,2.0,0031*4F\r\n";
+static const char RMC[] = "$GNRMC,123519.00,A,4807.03800,N,01131.00000,E,022.4,084.4,230394,003.1,W,A*37\r\n";
+static const char RMC_NO_FIX[] = "$GPRMC,,V,,,,,,,,,,N*53\r\n";
+static const char VTG[] = "$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K,A*25\r\n";
+static const char VTG_NO_FIX[] = "$GPVTG,,T,,M,,N,,K,N*2C\r\n";
+static const char GSA[] = "$GNGSA,A,3,10,07,05,02,29,04,08,13,,,,,1.72,1.03,1.38*14\r\n";
+static const char GSV[] = "$GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00*74\r\n";
+
+static const char* const CORPUS[] =
+{
+    GGA, GGA_SOUTH_EAST, GGA_NO_FIX, RMC, RMC_NO_FIX, VTG, VTG_NO_FIX, GSA, GSV
+};
+
+#define CORPUS_SIZE ((int) (sizeof(CORPUS) / sizeof(CORPUS[0])))
+
+static int failures = 0;
+
+/* Helpers -------------------------------------------------------------------*/
+
+typedef struct
+{
+    int             results_[NMEA_FORMAT_ERROR + 1];
+    NmeaSentence    last_;
+} FeedResult;
+
+static void feed(NmeaParser* parser, const char* text, size_t length, FeedResult* result)
+{
+    memset(result, 0, sizeof(*result));
+
+    for (size_t i = 0; i < length; i++)
+    {
+        result->results_[nmeaParse(parser, text[i], &result->last_)]++;
+    }
+}
+
+static void expect(int condition, const char* what, const char* sentence)
+{
+    if (!condition)
+    {
+        printf("FAIL %s: %.*s\n", what, (int) strcspn(sentence, "\r\n"), sentence);
+        failures++;
+    }
+}
+
+#define EXPECT(condition, sentence) expect(condition, #condition, sentence)
+
+/**
+ * Decodes one sentence from a fresh parser, expecting result.
+ */
+static NmeaSentence decode(const char* text, NmeaResult result)
+{
+    NmeaParser parser;
+    FeedResult fed;
+
+    nmeaInit(&parser);
+    feed(&parser, text, strlen(text), &fed);
+    expect(fed.results_[result] == 1, "single expected result", text);
+    return fed.last_;
+}
+
+static void appendChecksum(char* text)
+{
+    uint8_t checksum = 0;
+    char* p = text + 1;
+
+    for (; *p && *p != '*'; p++)
+    {
+        checksum ^= (uint8_t) *p;
+    }
+
+    sprintf(p, "*%02X\r\n", checksum);
+}
+
+/* Known answers -------------------------------------------------------------*/
+
+static int check(void)
+{
+    NmeaSentence s;
+
+    s = decode(GGA, NMEA_OK);
+    EXPECT(s.type_ == NMEA_GGA && strcmp(s.talker_, "GP") == 0, GGA);
+    EXPECT(s.fix_.gga_.time_ == 17281400, GGA);
+    EXPECT(s.fix_.gga_.latitude_.degrees_ == 37 && s.fix_.gga_.latitude_.minutes_ == 2346590, GGA);
+    EXPECT(s.fix_.gga_.longitude_.degrees_ == -122 && s.fix_.gga_.longitude_.minutes_ == -226960, GGA);
+    EXPECT(s.fix_.gga_.quality_ == 2 && s.fix_.gga_.satellites_ == 6 && s.fix_.gga_.hdop_ == 120, GGA);
+    EXPECT(s.fix_.gga_.altitude_ == 188 && s.fix_.gga_.geoidSeparation_ == -256, GGA);
+
+    s = decode(GGA_SOUTH_EAST, NMEA_OK);
+    EXPECT(strcmp(s.talker_, "GN") == 0 && s.fix_.gga_.time_ == 104300, GGA_SOUTH_EAST);
+    EXPECT(s.fix_.gga_.latitude_.degrees_ == -33 && s.fix_.gga_.latitude_.minutes_ == -4034399, GGA_SOUTH_EAST);
+    EXPECT(s.fix_.gga_.longitude_.degrees_ == 151 && s.fix_.gga_.longitude_.minutes_ == 1326586, GGA_SOUTH_EAST);
+    EXPECT(s.fix_.gga_.satellites_ == 12 && s.fix_.gga_.hdop_ == 50, GGA_SOUTH_EAST);
+    EXPECT(s.fix_.gga_.altitude_ == -15 && s.fix_.gga_.geoidSeparation_ == 222, GGA_SOUTH_EAST);
+
+    s = decode(GGA_NO_FIX, NMEA_OK);
+    EXPECT(s.fix_.gga_.quality_ == 0 && s.fix_.gga_.hdop_ == 9999 && s.fix_.gga_.latitude_.degrees_ == 0, GGA_NO_FIX);
+
+    decode(GGA_TOO_LONG, NMEA_FORMAT_ERROR);
+
+    s = decode(RMC, NMEA_OK);
+    EXPECT(s.type_ == NMEA_RMC && s.fix_.rmc_.valid_ && s.fix_.rmc_.mode_ == 'A', RMC);
+    EXPECT(s.fix_.rmc_.time_ == 12351900 && s.fix_.rmc_.date_ == 230394, RMC);
+    EXPECT(s.fix_.rmc_.latitude_.degrees_ == 48 && s.fix_.rmc_.latitude_.minutes_ == 703800, RMC);
+    EXPECT(s.fix_.rmc_.longitude_.degrees_ == 11 && s.fix_.rmc_.longitude_.minutes_ == 3100000, RMC);
+    EXPECT(s.fix_.rmc_.speed_ == 2240 && s.fix_.rmc_.course_ == 8440, RMC);
+
+    s = decode(RMC_NO_FIX, NMEA_OK);
+    EXPECT(!s.fix_.rmc_.valid_ && s.fix_.rmc_.mode_ == 'N', RMC_NO_FIX);
+
+    s = decode(VTG, NMEA_OK);
+    EXPECT(s.type_ == NMEA_VTG && s.fix_.vtg_.courseTrue_ == 5470 && s.fix_.vtg_.courseMagnetic_ == 3440, VTG);
+    EXPECT(s.fix_.vtg_.speedKnots_ == 550 && s.fix_.vtg_.speedKmh_ == 1020 && s.fix_.vtg_.mode_ == 'A', VTG);
+
+    s = decode(VTG_NO_FIX, NMEA_OK);
+    EXPECT(s.fix_.vtg_.mode_ == 'N' && s.fix_.vtg_.speedKnots_ == 0, VTG_NO_FIX);
+
+    s = decode(GSA, NMEA_OK);
+    EXPECT(s.type_ == NMEA_GSA && s.fix_.gsa_.selection_ == 'A' && s.fix_.gsa_.fixType_ == 3, GSA);
+    EXPECT(s.fix_.gsa_.satelliteCount_ == 8 && s.fix_.gsa_.satellites_[0] == 10 && s.fix_.gsa_.satellites_[7] == 13, GSA);
+    EXPECT(s.fix_.gsa_.pdop_ == 172 && s.fix_.gsa_.hdop_ == 103 && s.fix_.gsa_.vdop_ == 138, GSA);
+
+    decode(GSV, NMEA_UNSUPPORTED);
+    decode("$GPGGA,172814.0,3723.4659,N,12202.2696,W,2,6,1.2,18.893,M,-25.669,M,2.0,0031*45\r\n", NMEA_CHECKSUM_ERROR);
+    decode("$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K,A*25", NMEA_OK);
+    decode("$gpvtg,054.7,T,034.4,M,005.5,N,010.2,K,A*25", NMEA_UNSUPPORTED);
+    decode("$GNGSA,A,3,10,07,05,02,29,04,08,13,,,,,1.72,1.03,1.38*14\r\n", NMEA_OK);
+    decode("$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K,A\r\n", NMEA_FORMAT_ERROR);
+    decode("$GPVTG,054.7,T,034.4,M$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K,A*25", NMEA_FORMAT_ERROR);
+
+    // Lower case checksum digits are accepted, other characters are not
+    decode("$GPVTG,,T,,M,,N,,K,N*2c\r\n", NMEA_OK);
+    decode("$GPVTG,,T,,M,,N,,K,N*2x\r\n", NMEA_FORMAT_ERROR);
+
+    // Fields out of range with a valid checksum
+    char text[MAX_TEXT];
+    static const char* const BAD_FIELDS[] =
+    {
+        "$GPGGA,172814.0,3760.0000,N,12202.2696,W,2,6,1.2,18.893,M,-25.669,M,,",
+        "$GPGGA,172814.0,9100.0000,N,12202.2696,W,2,6,1.2,18.893,M,-25.669,M,,",
+        "$GPGGA,172814.0,3723.4659,X,12202.2696,W,2,6,1.2,18.893,M,-25.669,M,,",
+        "$GPGGA,172814.0,3723.4659,N,12202.2696,W,2,6,1.2,18.8.93,M,-25.669,M,,",
+        "$GPGGA,250000.0,3723.4659,N,12202.2696,W,2,6,1.2,18.893,M,-25.669,M,,",
+        "$GPGGA,172814.0,3723.4659,N,12202.2696,W,2,6,1.2,99999999999999,M,-25.669,M,,",
+        "$GPRMC,123519.00,Q,4807.03800,N,01131.00000,E,022.4,084.4,230394,003.1,W,A",
+        "$GNGSA,A,4,10,07,05,02,29,04,08,13,,,,,1.72,1.03,1.38",
+        "$GNGSA,A,3,10,07,05,02,29,04,08,256,,,,,1.72,1.03,1.38",
+        "$GPVTG,054.7,T,034.4,M,005.5,N,010.2,X,A",
+    };
+
+    for (unsigned i = 0; i < sizeof(BAD_FIELDS) / sizeof(BAD_FIELDS[0]); i++)
+    {
+        strcpy(text, BAD_FIELDS[i]);
+        appendChecksum(text);
+        decode(text, NMEA_FORMAT_ERROR);
+    }
+
+    // Two sentences back to back without an end of line, and garbage in between
+    NmeaParser parser;
+    FeedResult fed;
+    nmeaInit(&parser);
+    snprintf(text, sizeof(text), "x\x01\xFF%s%s,,*\r\n%s", GGA, "$GPGGA,1", RMC);
+    feed(&parser, text, strlen(text), &fed);
+    expect(fed.results_[NMEA_OK] == 2 && fed.results_[NMEA_FORMAT_ERROR] == 1 && fed.last_.type_ == NMEA_RMC, "resync", text);
+
+    printf("%s\n", failures ? "check failed" : "check passed");
+    return failures ? 1 : 0;
+}
+
+/* Fuzz ----------------------------------------------------------------------*/
+
+static uint32_t rng;
+
+static uint32_t random32(void)
+{
+    // xorshift32
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static size_t mutate(char* text, size_t length)
+{
+    switch (random32() % 6)
+    {
+        case 0: // Flip a byte
+            text[random32() % length] = (char) random32();
+            break;
+
+        case 1: // Insert a byte
+            if (length + 1 < MAX_TEXT / 2)
+            {
+                size_t at = random32() % length;
+                memmove(text + at + 1, text + at, length - at);
+                text[at] = "0123456789.,-*$ANSEWMTK"[random32() % 23];
+                length++;
+            }
+
+            break;
+
+        case 2: // Delete a byte
+            if (length > 1)
+            {
+                size_t at = random32() % length;
+                memmove(text + at, text + at + 1, length - at - 1);
+                length--;
+            }
+
+            break;
+
+        case 3: // Truncate
+            length = 1 + random32() % length;
+            break;
+
+        case 4: // Repeat a stretch
+        {
+            size_t at = random32() % length;
+            size_t count = 1 + random32() % 12;
+
+            if (at + count <= length && length + count < MAX_TEXT / 2)
+            {
+                memmove(text + at + count, text + at, length - at);
+                length += count;
+            }
+
+            break;
+        }
+
+        default: // Digit to digit, keeps the shape of the fields
+        {
+            size_t at = random32() % length;
+
+            if (text[at] >= '0' && text[at] <= '9')
+            {
+                text[at] = '0' + random32() % 10;
+            }
+
+            break;
+        }
+    }
+
+    return length;
+}
+
+/**
+ * Checks a decoded sentence against the text it came from, from its start
+ * character up to the last character fed.
+ */
+static void checkDecoded(const NmeaSentence* s, const char* text, size_t length)
+{
+    uint8_t checksum = 0;
+    size_t star = 1;
+
+    while (star < length && text[star] != '*')
+    {
+        checksum ^= (uint8_t) text[star++];
+    }
+
+    char expected[3];
+    snprintf(expected, sizeof(expected), "%02X", checksum);
+
+    expect(text[0] == '$' && star + 3 == length && length <= NMEA_MAX_LENGTH - 2, "sentence framing", text);
+    expect(toupper((unsigned char) text[star + 1]) == expected[0] && toupper((unsigned char) text[star + 2]) == expected[1], "checksum", text);
+    expect(memcmp(&text[1], s->talker_, 2) == 0, "talker", text);
+
+    switch (s->type_)
+    {
+        case NMEA_GGA:
+            expect(abs(s->fix_.gga_.latitude_.degrees_) <= 90 && abs(s->fix_.gga_.latitude_.minutes_) < 6000000, "latitude range", text);
+            expect(abs(s->fix_.gga_.longitude_.degrees_) <= 180 && abs(s->fix_.gga_.longitude_.minutes_) < 6000000, "longitude range", text);
+            expect(s->fix_.gga_.time_ < 24000000 && s->fix_.gga_.quality_ <= 9, "GGA range", text);
+            break;
+
+        case NMEA_RMC:
+            expect(s->fix_.rmc_.course_ <= 36000 && s->fix_.rmc_.date_ <= 311299, "RMC range", text);
+            break;
+
+        case NMEA_VTG:
+            expect(s->fix_.vtg_.courseTrue_ <= 36000 && s->fix_.vtg_.courseMagnetic_ <= 36000, "VTG range", text);
+            break;
+
+        case NMEA_GSA:
+            expect(s->fix_.gsa_.satelliteCount_ <= NMEA_GSA_SATELLITES && s->fix_.gsa_.fixType_ <= 3, "GSA range", text);
+            break;
+
+        default:
+            expect(0, "sentence type", text);
+            break;
+    }
+}
+
+static int fuzz(long iterations, uint32_t seed)
+{
+    NmeaParser parser;
+    NmeaSentence sentence;
+    long decoded = 0;
+
+    rng = seed ? seed : 1;
+    nmeaInit(&parser);
+
+    for (long i = 0; i < iterations && failures < 20; i++)
+    {
+        char text[MAX_TEXT];
+        size_t length;
+
+        if (random32() % 8 == 0)
+        {
+            // Random bytes
+            length = 1 + random32() % 100;
+
+            for (size_t j = 0; j < length; j++)
+            {
+                text[j] = (char) random32();
+            }
+        }
+        else
+        {
+            const char* base = CORPUS[random32() % CORPUS_SIZE];
+            length = strcspn(base, "\r");
+            memcpy(text, base, length);
+
+            for (uint32_t mutations = 1 + random32() % 4; mutations > 0; mutations--)
+            {
+                length = mutate(text, length);
+            }
+
+            if (random32() % 2)
+            {
+                // Mutated fields with a valid checksum reach the decoders
+                text[length] = 0;
+                text[strcspn(text, "*")] = 0;
+                appendChecksum(text);
+                length = strlen(text);
+            }
+        }
+
+        text[length] = 0;
+
+        size_t start = 0;
+
+        for (size_t j = 0; j < length; j++)
+        {
+            if (text[j] == '$')
+            {
+                start = j;
+            }
+
+            if (nmeaParse(&parser, text[j], &sentence) == NMEA_OK)
+            {
+                decoded++;
+                checkDecoded(&sentence, &text[start], j + 1 - start);
+            }
+        }
+
+        // Whatever came before, the next valid sentence decodes
+        const char* valid = CORPUS[random32() % CORPUS_SIZE];
+        FeedResult fed;
+        feed(&parser, valid, strlen(valid), &fed);
+        expect(fed.results_[valid == GSV ? NMEA_UNSUPPORTED : NMEA_OK] == 1, "resync", valid);
+    }
+
+    printf("%ld iterations, %ld mutated sentences decoded, %d failures\n", iterations, decoded, failures);
+    return failures ? 1 : 0;
+}
+
+/* Benchmark -----------------------------------------------------------------*/
+
+typedef struct
+{
+    uint32_t    time_;
+    int32_t     latitudeDegrees_;
+    int32_t     latitudeMinutes_;
+    int32_t     longitudeDegrees_;
+    int32_t     longitudeMinutes_;
+    int32_t     altitude_;
+    int32_t     geoidAltitude_;
+} LegacyGga;
+
+/**
+ * The line assembly of the UART4 callback and the strtok and atof parse of
+ * readGpsJob before the NMEA parser, without the locking.
+ */
+static int legacyParse(char rx, LegacyGga* gga)
+{
+    static char line[NMEA_MAX_LENGTH + 1];
+    static int index = 0;
+
+    if (rx == '$')
+    {
+        line[0] = rx;
+        index = 1;
+        return 0;
+    }
+
+    if (rx != '\r' && rx != '\n')
+    {
+        if (index != 0 && index < NMEA_MAX_LENGTH)
+        {
+            line[index++] = rx;
+        }
+
+        return 0;
+    }
+
+    if (index == 0)
+    {
+        return 0;
+    }
+
+    line[index] = 0;
+    index = 0;
+
+    if (strncmp(line, "$GPGGA,", 7) != 0)
+    {
+        return 0;
+    }
+
+    char* item = strtok(line, ",");
+
+    for (int counter = 0; item != NULL; counter++, item = strtok(NULL, ","))
+    {
+        switch (counter)
+        {
+            case 1:
+                gga->time_ = (uint32_t) (atof(item) * 100);
+                break;
+
+            case 2:
+            {
+                double latitude = atof(item);
+                gga->latitudeDegrees_ = (int32_t) latitude / 100;
+                gga->latitudeMinutes_ = (int32_t) ((latitude - gga->latitudeDegrees_ * 100) * 100000);
+                break;
+            }
+
+            case 3:
+                if (*item == 'S')
+                {
+                    gga->latitudeDegrees_ *= -1;
+                    gga->latitudeMinutes_ *= -1;
+                }
+
+                break;
+
+            case 4:
+            {
+                double longitude = atof(item);
+                gga->longitudeDegrees_ = (int32_t) longitude / 100;
+                gga->longitudeMinutes_ = (int32_t) ((longitude - gga->longitudeDegrees_ * 100) * 100000);
+                break;
+            }
+
+            case 5:
+                if (*item == 'W')
+                {
+                    gga->longitudeDegrees_ *= -1;
+                    gga->longitudeMinutes_ *= -1;
+                }
+
+                break;
+
+            case 9:
+                gga->altitude_ = (int32_t) (atof(item) * 10);
+                break;
+
+            case 11:
+                gga->geoidAltitude_ = (int32_t) (atof(item) * 10);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    return 1;
+}
+
+static uint64_t ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+/**
+ * Feeds the sentences count times, one character at a time as the GPS job
+ * does, and returns the ticks per sentence.
+ */
+static double benchParser(const char* const* sentences, int sentenceCount, long count)
+{
+    NmeaParser parser;
+    NmeaSentence sentence;
+    volatile uint32_t sink = 0;
+
+    nmeaInit(&parser);
+    uint64_t start = ticks();
+
+    for (long i = 0; i < count; i++)
+    {
+        for (const char* p = sentences[i % sentenceCount]; *p; p++)
+        {
+            if (nmeaParse(&parser, *p, &sentence) == NMEA_OK)
+            {
+                sink += sentence.type_;
+            }
+        }
+    }
+
+    return (double) (ticks() - start) / count;
+}
+
+static double benchLegacy(const char* const* sentences, int sentenceCount, long count)
+{
+    LegacyGga gga;
+    volatile uint32_t sink = 0;
+
+    uint64_t start = ticks();
+
+    for (long i = 0; i < count; i++)
+    {
+        for (const char* p = sentences[i % sentenceCount]; *p; p++)
+        {
+            if (legacyParse(*p, &gga))
+            {
+                sink += gga.time_;
+            }
+        }
+    }
+
+    return (double) (ticks() - start) / count;
+}
+
+static int bench(long count)
+{
+    static const char* const GGA_ONLY[] = {GGA};
+    static const char* const BURST[] = {GGA, RMC, VTG, GSA, GSV};
+    const char* unit =
+#if defined(__x86_64__) || defined(__i386__)
+        "TSC ticks";
+#else
+        "ns";
+#endif
+
+    // Warm up the caches and the branch predictors
+    benchParser(GGA_ONLY, 1, count / 10);
+    benchLegacy(GGA_ONLY, 1, count / 10);
+
+    printf("%ld sentences per run, %s per sentence\n", count, unit);
+    printf("%-34s %10.1f\n", "GGA, strtok and atof", benchLegacy(GGA_ONLY, 1, count));
+    printf("%-34s %10.1f\n", "GGA, NMEA parser", benchParser(GGA_ONLY, 1, count));
+    printf("%-34s %10.1f\n", "GGA RMC VTG GSA GSV, NMEA parser", benchParser(BURST, 5, count));
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc == 2 && strcmp(argv[1], "check") == 0)
+    {
+        return check();
+    }
+
+    if (argc >= 2 && argc <= 4 && strcmp(argv[1], "fuzz") == 0)
+    {
+        return fuzz(argc > 2 ? atol(argv[2]) : FUZZ_DEFAULT_ITERATIONS, argc > 3 ? (uint32_t) strtoul(argv[3], NULL, 0) : 1);
+    }
+
+    if (argc >= 2 && argc <= 3 && strcmp(argv[1], "bench") == 0)
+    {
+        return bench(argc > 2 ? atol(argv[2]) : BENCH_DEFAULT_SENTENCES);
+    }
+
+    fprintf(
+        stderr,
+        "usage: %s check\n"
+        "       %s fuzz [iterations] [seed]\n"
+        "       %s bench [sentences]\n",
+        argv[0],
+        argv[0],
+        argv[0]
+    );
+    return 2;
+}
@@ -0,0 +1,391 @@
+/**
+  ******************************************************************************
+  * File Name          : ScheduleCheck.c
+  * Description        : Offline schedulability check of the sensor schedule
+  *                      (SensorSchedule.h).
+  *
+  *   ScheduleCheck
+  *       Checks SENSOR_SCHEDULE_TABLE: every period divides the major
+  *       frame, periods and offsets are multiples of the minor frame, and
+  *       the budgets of the jobs due in each minor frame plus the frame
+  *       overhead fit in the frame. Prints the utilization of each job and
+  *       the frame timeline. Exits with 1 if the table is not schedulable.
+  *
+  *   ScheduleCheck <AvionicsScheduleN.csv>
+  *       Checks the table, then compares the last snapshot of a flight
+  *       log with it: worst execution time against budget, start jitter,
+  *       frame overruns and skipped frames. Exits with 1 if a job ran
+  *       over its budget or a frame overran.
+  ******************************************************************************
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SensorSchedule.h"
+
+#define SENSOR_SCHEDULE_JOB(job, periodMs, offsetMs, budgetUs) { #job, periodMs, offsetMs, budgetUs },
+
+#define CSV_LINE_SIZE 1024
+#define JOB_NAME_SIZE 65
+#define FRAME_US (SENSOR_SCHEDULE_MINOR_FRAME_MS * 1000)
+
+typedef struct
+{
+    const char* name_;
+    uint32_t    periodMs_;
+    uint32_t    offsetMs_;
+    uint32_t    budgetUs_;
+} Job;
+
+typedef struct
+{
+    uint32_t    timeMs_;
+    char        name_[JOB_NAME_SIZE];
+    uint32_t    budgetUs_;
+    uint32_t    runs_;
+    uint32_t    maxUs_;
+    uint32_t    budgetOverruns_;
+    uint32_t    minStartUs_;
+    uint32_t    maxStartUs_;
+    uint32_t    frames_;
+    uint32_t    frameOverruns_;
+    uint32_t    skippedFrames_;
+} JobRow;
+
+static const Job JOBS[] =
+{
+    SENSOR_SCHEDULE_TABLE(SENSOR_SCHEDULE_JOB)
+};
+
+#define JOB_COUNT ((int) (sizeof(JOBS) / sizeof(JOBS[0])))
+
+static int isDue(const Job* job, int frame)
+{
+    return (frame * SENSOR_SCHEDULE_MINOR_FRAME_MS) % job->periodMs_ == job->offsetMs_;
+}
+
+static uint32_t frameLoadUs(int frame)
+{
+    uint32_t us = SENSOR_SCHEDULE_FRAME_OVERHEAD_US;
+
+    for (int i = 0; i < JOB_COUNT; i++)
+    {
+        if (isDue(&JOBS[i], frame))
+        {
+            us += JOBS[i].budgetUs_;
+        }
+    }
+
+    return us;
+}
+
+static int sameJobs(int frame, int other)
+{
+    for (int i = 0; i < JOB_COUNT; i++)
+    {
+        if (isDue(&JOBS[i], frame) != isDue(&JOBS[i], other))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static uint32_t gcd(uint32_t a, uint32_t b)
+{
+    while (b != 0)
+    {
+        uint32_t r = a % b;
+        a = b;
+        b = r;
+    }
+
+    return a;
+}
+
+static int checkTable(void)
+{
+    int errors = 0;
+
+    if (SENSOR_SCHEDULE_MAJOR_FRAME_MS % SENSOR_SCHEDULE_MINOR_FRAME_MS != 0)
+    {
+        printf("error: the minor frame (%d ms) does not divide the major frame (%d ms)\n", SENSOR_SCHEDULE_MINOR_FRAME_MS, SENSOR_SCHEDULE_MAJOR_FRAME_MS);
+        return 1;
+    }
+
+    if (JOB_COUNT > SENSOR_SCHEDULE_MAX_JOBS)
+    {
+        printf("error: %d jobs, SENSOR_SCHEDULE_MAX_JOBS is %d\n", JOB_COUNT, SENSOR_SCHEDULE_MAX_JOBS);
+        errors++;
+    }
+
+    for (int i = 0; i < JOB_COUNT; i++)
+    {
+        const Job* job = &JOBS[i];
+
+        if (job->periodMs_ == 0 || SENSOR_SCHEDULE_MAJOR_FRAME_MS % job->periodMs_ != 0)
+        {
+            printf("error: %s: period %lu ms does not divide the major frame\n", job->name_, (unsigned long) job->periodMs_);
+            errors++;
+        }
+        else if (job->periodMs_ % SENSOR_SCHEDULE_MINOR_FRAME_MS != 0)
+        {
+            printf("error: %s: period %lu ms is not a multiple of the minor frame\n", job->name_, (unsigned long) job->periodMs_);
+            errors++;
+        }
+
+        if (job->offsetMs_ % SENSOR_SCHEDULE_MINOR_FRAME_MS != 0)
+        {
+            printf("error: %s: offset %lu ms is not a multiple of the minor frame\n", job->name_, (unsigned long) job->offsetMs_);
+            errors++;
+        }
+        else if (job->offsetMs_ >= job->periodMs_)
+        {
+            printf("error: %s: offset %lu ms is not less than the period\n", job->name_, (unsigned long) job->offsetMs_);
+            errors++;
+        }
+    }
+
+    if (errors != 0)
+    {
+        return errors;
+    }
+
+    for (int frame = 0; frame < SENSOR_SCHEDULE_FRAME_COUNT; frame++)
+    {
+        uint32_t us = frameLoadUs(frame);
+
+        if (us > FRAME_US)
+        {
+            printf("error: frame %d at %d ms needs %lu us of %d us\n", frame, frame * SENSOR_SCHEDULE_MINOR_FRAME_MS, (unsigned long) us, FRAME_US);
+            errors++;
+        }
+    }
+
+    return errors;
+}
+
+static void printTable(void)
+{
+    double utilization = 0;
+    int worstFrame = 0;
+    // Frames repeat every least common multiple of the periods shorter than the major frame
+    uint32_t cycleMs = SENSOR_SCHEDULE_MINOR_FRAME_MS;
+
+    printf("%-36s %7s %7s %7s %7s\n", "Job", "Period", "Offset", "Budget", "Util %");
+
+    for (int i = 0; i < JOB_COUNT; i++)
+    {
+        const Job* job = &JOBS[i];
+        double jobUtilization = 100.0 * job->budgetUs_ / (job->periodMs_ * 1000.0);
+
+        utilization += jobUtilization;
+
+        if (job->periodMs_ < SENSOR_SCHEDULE_MAJOR_FRAME_MS)
+        {
+            cycleMs = cycleMs / gcd(cycleMs, job->periodMs_) * job->periodMs_;
+        }
+
+        printf("%-36s %7lu %7lu %7lu %7.2f\n", job->name_, (unsigned long) job->periodMs_, (unsigned long) job->offsetMs_, (unsigned long) job->budgetUs_, jobUtilization);
+    }
+
+    for (int frame = 0; frame < SENSOR_SCHEDULE_FRAME_COUNT; frame++)
+    {
+        if (frameLoadUs(frame) > frameLoadUs(worstFrame))
+        {
+            worstFrame = frame;
+        }
+    }
+
+    printf(
+        "\n%d ms minor frame, %d ms major frame, %d us overhead per frame\n",
+        SENSOR_SCHEDULE_MINOR_FRAME_MS,
+        SENSOR_SCHEDULE_MAJOR_FRAME_MS,
+        SENSOR_SCHEDULE_FRAME_OVERHEAD_US
+    );
+    printf(
+        "Utilization %.2f%% of the CPU, worst frame %d at %d ms uses %lu of %d us (%.1f%%)\n\n",
+        utilization + 100.0 * SENSOR_SCHEDULE_FRAME_OVERHEAD_US / FRAME_US,
+        worstFrame,
+        worstFrame * SENSOR_SCHEDULE_MINOR_FRAME_MS,
+        (unsigned long) frameLoadUs(worstFrame),
+        FRAME_US,
+        100.0 * frameLoadUs(worstFrame) / FRAME_US
+    );
+
+    // The first cycle in full, then only the frames that differ from the same frame of the first cycle
+    printf("%5s %8s %8s  %s\n", "Frame", "Time ms", "Load us", "Jobs");
+
+    for (int frame = 0; frame < SENSOR_SCHEDULE_FRAME_COUNT; frame++)
+    {
+        int cycleFrames = cycleMs / SENSOR_SCHEDULE_MINOR_FRAME_MS;
+
+        if (frame >= cycleFrames && sameJobs(frame, frame % cycleFrames))
+        {
+            continue;
+        }
+
+        printf("%5d %8d %8lu ", frame, frame * SENSOR_SCHEDULE_MINOR_FRAME_MS, (unsigned long) frameLoadUs(frame));
+
+        for (int i = 0; i < JOB_COUNT; i++)
+        {
+            if (isDue(&JOBS[i], frame))
+            {
+                printf(" %s", JOBS[i].name_);
+            }
+        }
+
+        printf("\n");
+    }
+
+    printf("Frames from %lu ms on repeat the first %lu ms unless listed\n", (unsigned long) cycleMs, (unsigned long) cycleMs);
+}
+
+/**
+ * Parses one line of the sensor schedule log, see SENSOR_SCHEDULE_LOG_HEADER.
+ */
+static int parseJobRow(char* line, JobRow* row)
+{
+    char* fields[14];
+    int count = 0;
+
+    for (char* token = strtok(line, ",\r\n"); token && count < 14; token = strtok(NULL, ",\r\n"))
+    {
+        fields[count++] = token;
+    }
+
+    if (count != 14)
+    {
+        return 0;
+    }
+
+    row->timeMs_ = strtoul(fields[0], NULL, 10);
+    snprintf(row->name_, JOB_NAME_SIZE, "%s", fields[2]);
+    row->budgetUs_ = strtoul(fields[5], NULL, 10);
+    row->runs_ = strtoul(fields[6], NULL, 10);
+    row->maxUs_ = strtoul(fields[7], NULL, 10);
+    row->budgetOverruns_ = strtoul(fields[8], NULL, 10);
+    row->minStartUs_ = strtoul(fields[9], NULL, 10);
+    row->maxStartUs_ = strtoul(fields[10], NULL, 10);
+    row->frames_ = strtoul(fields[11], NULL, 10);
+    row->frameOverruns_ = strtoul(fields[12], NULL, 10);
+    row->skippedFrames_ = strtoul(fields[13], NULL, 10);
+    return 1;
+}
+
+static int checkLog(const char* path)
+{
+    FILE* in = fopen(path, "r");
+    char line[CSV_LINE_SIZE];
+    JobRow rows[SENSOR_SCHEDULE_MAX_JOBS];
+    int rowCount = 0;
+    int failures = 0;
+
+    if (in == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+
+    // Header
+    if (fgets(line, sizeof(line), in) == NULL)
+    {
+        fclose(in);
+        return -1;
+    }
+
+    // Keep the last snapshot, all of its rows share a time stamp
+    while (fgets(line, sizeof(line), in))
+    {
+        JobRow row;
+
+        if (!parseJobRow(line, &row))
+        {
+            continue;
+        }
+
+        if (rowCount != 0 && row.timeMs_ != rows[0].timeMs_)
+        {
+            rowCount = 0;
+        }
+
+        if (rowCount < SENSOR_SCHEDULE_MAX_JOBS)
+        {
+            rows[rowCount++] = row;
+        }
+    }
+
+    fclose(in);
+
+    if (rowCount == 0)
+    {
+        printf("%s: no snapshots\n", path);
+        return -1;
+    }
+
+    printf("\n%s, snapshot at %.1f s\n", path, rows[0].timeMs_ / 1000.0);
+    printf("%-36s %9s %7s %7s %7s %9s\n", "Job", "Runs", "Max us", "Budget", "Over", "Jitter us");
+
+    for (int i = 0; i < rowCount; i++)
+    {
+        const JobRow* row = &rows[i];
+
+        printf(
+            "%-36s %9lu %7lu %7lu %7lu %9lu%s\n",
+            row->name_,
+            (unsigned long) row->runs_,
+            (unsigned long) row->maxUs_,
+            (unsigned long) row->budgetUs_,
+            (unsigned long) row->budgetOverruns_,
+            (unsigned long) (row->maxStartUs_ - row->minStartUs_),
+            row->budgetOverruns_ ? "  OVER BUDGET" : ""
+        );
+
+        failures += row->budgetOverruns_ != 0;
+    }
+
+    printf(
+        "%lu frames, %lu overruns, %lu skipped\n",
+        (unsigned long) rows[0].frames_,
+        (unsigned long) rows[0].frameOverruns_,
+        (unsigned long) rows[0].skippedFrames_
+    );
+
+    return failures + (rows[0].frameOverruns_ != 0);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 2)
+    {
+        fprintf(stderr, "usage: %s [AvionicsScheduleN.csv]\n", argv[0]);
+        return 2;
+    }
+
+    int errors = checkTable();
+
+    if (errors != 0)
+    {
+        printf("Not schedulable, %d errors\n", errors);
+        return 1;
+    }
+
+    printTable();
+
+    if (argc == 2)
+    {
+        int failures = checkLog(argv[1]);
+
+        if (failures < 0)
+        {
+            return 2;
+        }
+
+        return failures != 0;
+    }
+
+    return 0;
+}
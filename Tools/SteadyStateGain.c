@@ -0,0 +1,84 @@
+/**
+  ******************************************************************************
+  * File Name          : SteadyStateGain.c
+  * Description        : Steady state gain of the accelerometer and barometer
+  *                      filter, for Tools/KalmanTuner and
+  *                      Tools/AltitudeFilterGainGen.
+  ******************************************************************************
+*/
+
+#include <math.h>
+#include <string.h>
+
+#include "SteadyStateGain.h"
+
+#define RICCATI_MAX_ITERATIONS 100000
+#define RICCATI_TOLERANCE 1e-13
+
+int steadyStateGain(double dt, double jerkNoise, double barometerNoise, double accelNoise, double gain[3][2])
+{
+    const double F[3][3] = {{1, dt, dt * dt / 2}, {0, 1, dt}, {0, 0, 1}};
+    const double Q[3][3] =
+    {
+        {pow(dt, 5) / 20 * jerkNoise, pow(dt, 4) / 8 * jerkNoise, pow(dt, 3) / 6 * jerkNoise},
+        {pow(dt, 4) / 8 * jerkNoise, pow(dt, 3) / 3 * jerkNoise, dt * dt / 2 * jerkNoise},
+        {pow(dt, 3) / 6 * jerkNoise, dt * dt / 2 * jerkNoise, dt * jerkNoise}
+    };
+    double P[3][3] = {{100, 0, 0}, {0, 100, 0}, {0, 0, 100}};
+
+    memset(gain, 0, 6 * sizeof(double));
+
+    for (int iteration = 0; iteration < RICCATI_MAX_ITERATIONS; iteration++)
+    {
+        double FP[3][3];
+        double predicted[3][3];
+
+        for (int i = 0; i < 3; i++)
+        {
+            for (int j = 0; j < 3; j++)
+            {
+                FP[i][j] = F[i][0] * P[0][j] + F[i][1] * P[1][j] + F[i][2] * P[2][j];
+            }
+        }
+
+        for (int i = 0; i < 3; i++)
+        {
+            for (int j = 0; j < 3; j++)
+            {
+                predicted[i][j] = FP[i][0] * F[j][0] + FP[i][1] * F[j][1] + FP[i][2] * F[j][2] + Q[i][j];
+            }
+        }
+
+        // The measurements are the altitude and the acceleration, rows 0 and 2 of the state
+        double s00 = predicted[0][0] + barometerNoise * barometerNoise;
+        double s01 = predicted[0][2];
+        double s11 = predicted[2][2] + accelNoise * accelNoise;
+        double determinant = s00 * s11 - s01 * s01;
+        double change = 0;
+
+        for (int i = 0; i < 3; i++)
+        {
+            double k0 = (predicted[i][0] * s11 - predicted[i][2] * s01) / determinant;
+            double k1 = (predicted[i][2] * s00 - predicted[i][0] * s01) / determinant;
+
+            change = fmax(change, fmax(fabs(k0 - gain[i][0]), fabs(k1 - gain[i][1])));
+            gain[i][0] = k0;
+            gain[i][1] = k1;
+        }
+
+        for (int i = 0; i < 3; i++)
+        {
+            for (int j = 0; j < 3; j++)
+            {
+                P[i][j] = predicted[i][j] - gain[i][0] * predicted[0][j] - gain[i][1] * predicted[2][j];
+            }
+        }
+
+        if (iteration > 0 && change < RICCATI_TOLERANCE)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
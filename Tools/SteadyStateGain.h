@@ -0,0 +1,20 @@
+#pragma once
+
+/**
+ * Steady state Kalman gain of the accelerometer and barometer filter of
+ * AltitudeFilter.c: a constant acceleration model driven by white jerk,
+ * measuring altitude and acceleration.
+ *
+ * Host only, as the firmware takes its gains from the generated
+ * AltitudeFilterGainTable.h.
+ */
+
+/**
+ * Steady state gain of the filter at time step dt, in s, for white jerk
+ * of spectral density jerkNoise in m^2/s^5 and white measurement noises
+ * in m and m/s^2, by iterating the discrete Riccati equation.
+ *
+ * Returns:
+ *   converged - (int) 0 if the iteration did not converge
+ */
+int steadyStateGain(double dt, double jerkNoise, double barometerNoise, double accelNoise, double gain[3][2]);
@@ -0,0 +1,1014 @@
+/**
+  ******************************************************************************
+  * File Name          : TaskStatsViewer.c
+  * Description        : Host viewer for the task statistics (TaskStats.h),
+  *                      memory statistics (MemoryStats.h) and interrupt
+  *                      statistics (IsrStats.h).
+  *
+  *   TaskStatsViewer log <AvionicsTasksN.csv>
+  *       Prints the task table at the end of each flight phase, with the
+  *       deadline misses added during the phase and the peak CPU load,
+  *       then the job execution time histograms of the last snapshot.
+  *
+  *   TaskStatsViewer memory <AvionicsMemoryN.csv>
+  *       Prints each task's deepest stack use over the flight with the
+  *       recommended osThreadDef stack size, and the heap levels.
+  *
+  *   TaskStatsViewer isr <AvionicsIsrN.csv>
+  *       Prints the interrupt handler table at the end of each flight
+  *       phase, flagging the handlers that ran over their budget.
+  *
+  *   TaskStatsViewer telemetry <capture.bin>
+  *       Picks the task stats messages out of a raw radio capture and
+  *       prints the table every time all tasks have been received, then
+  *       the last memory and interrupt stats received for each task and
+  *       handler.
+  ******************************************************************************
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "TaskStats.h"
+#include "MemoryStats.h"
+#include "IsrStats.h"
+
+#define CSV_LINE_SIZE 1024
+#define TASK_NAME_SIZE 65
+#define START_FLAG 0xF0
+#define END_FLAG 0xF0
+#define ESCAPE 0xF1
+#define F0_REPLACEMENT 0xF2
+#define F1_REPLACEMENT 0xF3
+#define CRC_SIZE 4
+#define MAX_SERIAL_MSG_SIZE 23
+#define STACK_WORD_SIZE 4
+
+typedef struct
+{
+    uint32_t    timeMs_;
+    int         phase_;
+    char        name_[TASK_NAME_SIZE];
+    uint32_t    periodMs_;
+    uint32_t    cpuPermille_;
+    uint32_t    jobs_;
+    uint32_t    minJobUs_;
+    uint32_t    avgJobUs_;
+    uint32_t    maxJobUs_;
+    uint32_t    deadlineMisses_;
+    uint32_t    histogram_[TASK_STATS_HISTOGRAM_BINS];
+} TaskRow;
+
+typedef struct
+{
+    char        name_[TASK_NAME_SIZE];
+    uint32_t    stackWords_;
+    uint32_t    minFreeWords_;
+    uint32_t    recommendedWords_;
+    uint32_t    rtosHeapFree_;
+    uint32_t    rtosHeapMinFree_;
+    uint32_t    newlibHeap_;
+    uint32_t    sbrkFailures_;
+} MemoryRow;
+
+typedef struct
+{
+    char        name_[TASK_NAME_SIZE];
+    uint32_t    budgetUs_;
+    uint32_t    calls_;
+    uint32_t    maxCycles_;
+    uint32_t    avgCycles_;
+    uint32_t    budgetOverruns_;
+    uint32_t    maxLatencyUs_; // ISR_STATS_NO_LATENCY if not measured
+    uint32_t    nestedCalls_; // UINT32_MAX if not known, telemetry does not carry it
+    uint32_t    maxDepth_;
+    uint32_t    coreClockHz_;
+} IsrRow;
+
+typedef struct
+{
+    TaskRow     last_;
+    uint32_t    peakCpuPermille_;
+    uint32_t    phaseStartMisses_; // Deadline misses when the current phase started
+} TaskHistory;
+
+static const char* const PHASE_NAMES[] =
+{
+    "PRELAUNCH",
+    "ARM",
+    "BURN",
+    "COAST",
+    "DROGUE_DESCENT",
+    "MAIN_DESCENT",
+    "POST_FLIGHT",
+    "ABORT_COMMAND_RECEIVED",
+    "ABORT_COMMUNICATION_ERROR",
+    "ABORT_OXIDIZER_PRESSURE",
+    "ABORT_UNSPECIFIED_REASON"
+};
+
+#define ISR_STATS_NAME(handler, budgetUs) #handler,
+
+// Telemetry only carries the handler index
+static const char* const ISR_NAMES[] =
+{
+    ISR_STATS_TABLE(ISR_STATS_NAME)
+};
+
+// Registration order in main(), telemetry only carries the task index
+static const char* const TASK_NAMES[] =
+{
+    "defaultTask",
+    "sensorScheduleThread",
+    "monitorForEmergencyShutoffThread",
+    "engineControlThread",
+    "parachutesControlThread",
+    "logDataThread",
+    "transmitDataThread",
+    "abortPhaseThread"
+};
+
+static const char* phaseName(int phase)
+{
+    return phase >= 0 && phase < (int) (sizeof(PHASE_NAMES) / sizeof(PHASE_NAMES[0])) ? PHASE_NAMES[phase] : "?";
+}
+
+static void printTableHeader(void)
+{
+    printf(
+        "%-36s %7s %6s %6s %8s %9s %9s %9s %8s %8s\n",
+        "Task",
+        "Period",
+        "CPU %",
+        "Peak %",
+        "Jobs",
+        "Min us",
+        "Avg us",
+        "Max us",
+        "Misses",
+        "+Phase"
+    );
+}
+
+static void printRow(const char* name, const TaskRow* row, uint32_t peakCpuPermille, uint32_t phaseMisses)
+{
+    printf(
+        "%-36s %7lu %6.1f %6.1f %8lu %9lu %9lu %9lu %8lu %8lu\n",
+        name,
+        (unsigned long) row->periodMs_,
+        row->cpuPermille_ / 10.0,
+        peakCpuPermille / 10.0,
+        (unsigned long) row->jobs_,
+        (unsigned long) row->minJobUs_,
+        (unsigned long) row->avgJobUs_,
+        (unsigned long) row->maxJobUs_,
+        (unsigned long) row->deadlineMisses_,
+        (unsigned long) phaseMisses
+    );
+}
+
+/**
+ * Parses one line of the task stats log.
+ *
+ * @return  1 if the line held a full row, 0 for the header and blank lines.
+ */
+static int parseRow(const char* line, TaskRow* row)
+{
+    uint32_t* numbers[] =
+    {
+        &row->periodMs_,
+        &row->cpuPermille_,
+        &row->jobs_,
+        &row->minJobUs_,
+        &row->avgJobUs_,
+        &row->maxJobUs_,
+        &row->deadlineMisses_
+    };
+    char* end;
+    const char* p = line;
+
+    row->timeMs_ = strtoul(p, &end, 10);
+
+    if (end == p || *end != ',')
+    {
+        return 0;
+    }
+
+    p = end + 1;
+    row->phase_ = (int) strtol(p, &end, 10);
+
+    if (end == p || *end != ',')
+    {
+        return 0;
+    }
+
+    p = end + 1;
+    size_t length = strcspn(p, ",");
+
+    if (length == 0 || length >= TASK_NAME_SIZE || p[length] != ',')
+    {
+        return 0;
+    }
+
+    memcpy(row->name_, p, length);
+    row->name_[length] = '\0';
+    p += length + 1;
+
+    for (int i = 0; i < (int) (sizeof(numbers) / sizeof(numbers[0])) + TASK_STATS_HISTOGRAM_BINS; i++)
+    {
+        uint32_t* field = i < (int) (sizeof(numbers) / sizeof(numbers[0])) ? numbers[i] : &row->histogram_[i - sizeof(numbers) / sizeof(numbers[0])];
+        *field = strtoul(p, &end, 10);
+
+        if (end == p)
+        {
+            return 0;
+        }
+
+        p = (*end == ',') ? end + 1 : end;
+    }
+
+    return 1;
+}
+
+/**
+ * Parses one line of the memory stats log.
+ *
+ * @return  1 if the line held a full row, 0 for the header and blank lines.
+ */
+static int parseMemoryRow(const char* line, MemoryRow* row)
+{
+    uint32_t* numbers[] =
+    {
+        &row->stackWords_,
+        &row->minFreeWords_,
+        &row->recommendedWords_,
+        &row->rtosHeapFree_,
+        &row->rtosHeapMinFree_,
+        &row->newlibHeap_,
+        &row->sbrkFailures_
+    };
+    char* end;
+    const char* p = line;
+
+    // Time and phase are not used by the report
+    for (int i = 0; i < 2; i++)
+    {
+        strtoul(p, &end, 10);
+
+        if (end == p || *end != ',')
+        {
+            return 0;
+        }
+
+        p = end + 1;
+    }
+
+    size_t length = strcspn(p, ",");
+
+    if (length == 0 || length >= TASK_NAME_SIZE || p[length] != ',')
+    {
+        return 0;
+    }
+
+    memcpy(row->name_, p, length);
+    row->name_[length] = '\0';
+    p += length + 1;
+
+    for (int i = 0; i < (int) (sizeof(numbers) / sizeof(numbers[0])); i++)
+    {
+        *numbers[i] = strtoul(p, &end, 10);
+
+        if (end == p)
+        {
+            return 0;
+        }
+
+        p = (*end == ',') ? end + 1 : end;
+    }
+
+    return 1;
+}
+
+/**
+ * Parses one line of the ISR stats log. A latency of -1 reads as
+ * ISR_STATS_NO_LATENCY.
+ *
+ * @return  1 if the line held a full row, 0 for the header and blank lines.
+ */
+static int parseIsrRow(const char* line, uint32_t* timeMs, int* phase, IsrRow* row)
+{
+    uint32_t* numbers[] =
+    {
+        &row->budgetUs_,
+        &row->calls_,
+        &row->maxCycles_,
+        &row->avgCycles_,
+        &row->budgetOverruns_,
+        &row->maxLatencyUs_,
+        &row->nestedCalls_,
+        &row->maxDepth_,
+        &row->coreClockHz_
+    };
+    char* end;
+    const char* p = line;
+
+    *timeMs = strtoul(p, &end, 10);
+
+    if (end == p || *end != ',')
+    {
+        return 0;
+    }
+
+    p = end + 1;
+    *phase = strtol(p, &end, 10);
+
+    if (end == p || *end != ',')
+    {
+        return 0;
+    }
+
+    p = end + 1;
+    size_t length = strcspn(p, ",");
+
+    if (length == 0 || length >= TASK_NAME_SIZE || p[length] != ',')
+    {
+        return 0;
+    }
+
+    memcpy(row->name_, p, length);
+    row->name_[length] = '\0';
+    p += length + 1;
+
+    for (int i = 0; i < (int) (sizeof(numbers) / sizeof(numbers[0])); i++)
+    {
+        *numbers[i] = strtoul(p, &end, 10);
+
+        if (end == p)
+        {
+            return 0;
+        }
+
+        p = (*end == ',') ? end + 1 : end;
+    }
+
+    return 1;
+}
+
+/**
+ * Prints the interrupt handler table. Execution times exclude the handlers
+ * that preempted the handler; handlers that ever ran over their budget are
+ * flagged.
+ */
+static void printIsrTable(const IsrRow* rows, int handlerCount)
+{
+    printf(
+        "%-20s %7s %10s %8s %8s %9s %9s %9s %8s %9s\n",
+        "Handler", "Budget", "Calls", "Max us", "Avg us", "Max cyc", "Overruns", "Max lat", "Nested", "Max nest"
+    );
+
+    for (int i = 0; i < handlerCount; i++)
+    {
+        const IsrRow* row = &rows[i];
+        double cyclesPerUs = row->coreClockHz_ ? row->coreClockHz_ / 1e6 : 1;
+        char latency[16] = "-";
+        char nested[16] = "-";
+
+        if (row->maxLatencyUs_ != ISR_STATS_NO_LATENCY)
+        {
+            snprintf(latency, sizeof(latency), "%lu", (unsigned long) row->maxLatencyUs_);
+        }
+
+        if (row->nestedCalls_ != UINT32_MAX)
+        {
+            snprintf(nested, sizeof(nested), "%lu", (unsigned long) row->nestedCalls_);
+        }
+
+        printf(
+            "%-20s %7lu %10lu %8.2f %8.2f %9lu %9lu %9s %8s %9lu%s\n",
+            row->name_,
+            (unsigned long) row->budgetUs_,
+            (unsigned long) row->calls_,
+            row->maxCycles_ / cyclesPerUs,
+            row->avgCycles_ / cyclesPerUs,
+            (unsigned long) row->maxCycles_,
+            (unsigned long) row->budgetOverruns_,
+            latency,
+            nested,
+            (unsigned long) row->maxDepth_,
+            row->budgetOverruns_ > 0 ? "  OVER BUDGET" : ""
+        );
+    }
+}
+
+static int viewIsr(const char* path)
+{
+    static IsrRow handlers[ISR_STATS_COUNT * 2];
+    char line[CSV_LINE_SIZE];
+    int handlerCount = 0;
+    int currentPhase = -1;
+    uint32_t currentTimeMs = 0;
+    uint32_t timeMs;
+    int phase;
+    IsrRow row;
+
+    FILE* in = fopen(path, "r");
+
+    if (!in)
+    {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return 1;
+    }
+
+    while (fgets(line, sizeof(line), in))
+    {
+        if (!parseIsrRow(line, &timeMs, &phase, &row))
+        {
+            continue;
+        }
+
+        if (phase != currentPhase && handlerCount > 0)
+        {
+            printf("\nEnd of %s at %.1f s, totals since boot\n", phaseName(currentPhase), currentTimeMs / 1000.0);
+            printIsrTable(handlers, handlerCount);
+        }
+
+        currentPhase = phase;
+        currentTimeMs = timeMs;
+
+        int handler = 0;
+
+        while (handler < handlerCount && strcmp(handlers[handler].name_, row.name_) != 0)
+        {
+            handler++;
+        }
+
+        if (handler == handlerCount)
+        {
+            if (handlerCount == (int) (sizeof(handlers) / sizeof(handlers[0])))
+            {
+                continue;
+            }
+
+            handlerCount++;
+        }
+
+        handlers[handler] = row;
+    }
+
+    fclose(in);
+
+    if (handlerCount == 0)
+    {
+        fprintf(stderr, "%s has no ISR stats rows\n", path);
+        return 1;
+    }
+
+    printf("\nEnd of log in %s at %.1f s, totals since boot\n", phaseName(currentPhase), currentTimeMs / 1000.0);
+    printIsrTable(handlers, handlerCount);
+    return 0;
+}
+
+static void printPhaseTable(int phase, uint32_t timeMs, TaskHistory* tasks, int taskCount)
+{
+    printf("\n%s, snapshot at %.1f s\n", phaseName(phase), timeMs / 1000.0);
+    printTableHeader();
+
+    for (int i = 0; i < taskCount; i++)
+    {
+        const TaskRow* row = &tasks[i].last_;
+        printRow(row->name_, row, tasks[i].peakCpuPermille_, row->deadlineMisses_ - tasks[i].phaseStartMisses_);
+        tasks[i].phaseStartMisses_ = row->deadlineMisses_;
+    }
+}
+
+static void printHistograms(const TaskHistory* tasks, int taskCount)
+{
+    printf("\nJob execution time, %% of jobs per bin\n%-36s", "Task");
+
+    for (int bin = 0; bin < TASK_STATS_HISTOGRAM_BINS; bin++)
+    {
+        char label[16];
+        snprintf(label, sizeof(label), "%s%lu", bin < TASK_STATS_HISTOGRAM_BINS - 1 ? "<" : ">=", (unsigned long) TASK_STATS_FIRST_BIN_US << (bin < TASK_STATS_HISTOGRAM_BINS - 1 ? bin : bin - 1));
+        printf(" %7s", label);
+    }
+
+    printf("\n");
+
+    for (int i = 0; i < taskCount; i++)
+    {
+        const TaskRow* row = &tasks[i].last_;
+
+        if (row->jobs_ == 0)
+        {
+            continue;
+        }
+
+        printf("%-36s", row->name_);
+
+        for (int bin = 0; bin < TASK_STATS_HISTOGRAM_BINS; bin++)
+        {
+            printf(" %7.1f", 100.0 * row->histogram_[bin] / row->jobs_);
+        }
+
+        printf("\n");
+    }
+}
+
+static int viewLog(const char* path)
+{
+    static TaskHistory tasks[TASK_STATS_MAX_TASKS];
+    char line[CSV_LINE_SIZE];
+    int taskCount = 0;
+    int phase = -1;
+    uint32_t timeMs = 0;
+    TaskRow row;
+
+    FILE* in = fopen(path, "r");
+
+    if (!in)
+    {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return 1;
+    }
+
+    while (fgets(line, sizeof(line), in))
+    {
+        if (!parseRow(line, &row))
+        {
+            continue;
+        }
+
+        // Every row of a snapshot has the same phase, print the previous phase's last snapshot when it changes
+        if (phase != -1 && row.phase_ != phase)
+        {
+            printPhaseTable(phase, timeMs, tasks, taskCount);
+        }
+
+        phase = row.phase_;
+        timeMs = row.timeMs_;
+
+        int task = 0;
+
+        while (task < taskCount && strcmp(tasks[task].last_.name_, row.name_) != 0)
+        {
+            task++;
+        }
+
+        if (task == taskCount)
+        {
+            if (taskCount == TASK_STATS_MAX_TASKS)
+            {
+                continue;
+            }
+
+            memset(&tasks[taskCount++], 0, sizeof(TaskHistory));
+        }
+
+        tasks[task].last_ = row;
+
+        if (row.cpuPermille_ > tasks[task].peakCpuPermille_)
+        {
+            tasks[task].peakCpuPermille_ = row.cpuPermille_;
+        }
+    }
+
+    fclose(in);
+
+    if (phase == -1)
+    {
+        fprintf(stderr, "%s has no task stats rows\n", path);
+        return 1;
+    }
+
+    printPhaseTable(phase, timeMs, tasks, taskCount);
+    printHistograms(tasks, taskCount);
+    return 0;
+}
+
+/**
+ * Prints the stack table for the deepest use of each task, with the change
+ * each recommendation makes. Tasks whose recommendation is above their
+ * current stack are running without the margin and are flagged.
+ */
+static void printMemoryTable(const MemoryRow* rows, int taskCount)
+{
+    long savedWords = 0;
+
+    printf("%-36s %7s %9s %7s %7s %12s\n", "Task", "Stack", "Min free", "Used %", "Recom.", "Change bytes");
+
+    for (int i = 0; i < taskCount; i++)
+    {
+        const MemoryRow* row = &rows[i];
+        long change = ((long) row->recommendedWords_ - (long) row->stackWords_) * STACK_WORD_SIZE;
+
+        printf(
+            "%-36s %7lu %9lu %7.1f %7lu %+12ld%s\n",
+            row->name_,
+            (unsigned long) row->stackWords_,
+            (unsigned long) row->minFreeWords_,
+            row->stackWords_ ? 100.0 * (row->stackWords_ - row->minFreeWords_) / row->stackWords_ : 0.0,
+            (unsigned long) row->recommendedWords_,
+            change,
+            change > 0 ? "  grow" : ""
+        );
+        savedWords += (long) row->stackWords_ - (long) row->recommendedWords_;
+    }
+
+    printf("\nRecommended stacks use %ld bytes %s than today\n", labs(savedWords) * STACK_WORD_SIZE, savedWords >= 0 ? "less" : "more");
+    printf("Stack sizes are in words as passed to osThreadDef, recommendation is used * %d / %d + %d rounded up to %d\n",
+           MEMORY_STATS_MARGIN_DIVISOR + 1, MEMORY_STATS_MARGIN_DIVISOR, MEMORY_STATS_MARGIN_WORDS, MEMORY_STATS_STACK_ROUNDING_WORDS);
+}
+
+static void printHeapSummary(const MemoryRow* last, uint32_t rtosHeapMinFree, uint32_t newlibHeapPeak, uint32_t sbrkFailures)
+{
+    printf("\nFreeRTOS heap: %lu bytes free now, %lu minimum ever\n", (unsigned long) last->rtosHeapFree_, (unsigned long) rtosHeapMinFree);
+    printf("newlib heap: %lu bytes peak, %lu refused sbrk calls\n", (unsigned long) newlibHeapPeak, (unsigned long) sbrkFailures);
+
+    if (sbrkFailures > 0)
+    {
+        printf("malloc failed from a task, see sbrkFailureCount in syscalls.c\n");
+    }
+}
+
+static int viewMemory(const char* path)
+{
+    static MemoryRow tasks[MEMORY_STATS_MAX_TASKS];
+    char line[CSV_LINE_SIZE];
+    int taskCount = 0;
+    uint32_t rtosHeapMinFree = UINT32_MAX;
+    uint32_t newlibHeapPeak = 0;
+    uint32_t sbrkFailures = 0;
+    MemoryRow row;
+    MemoryRow last;
+
+    FILE* in = fopen(path, "r");
+
+    if (!in)
+    {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return 1;
+    }
+
+    while (fgets(line, sizeof(line), in))
+    {
+        if (!parseMemoryRow(line, &row))
+        {
+            continue;
+        }
+
+        last = row;
+
+        if (row.rtosHeapMinFree_ < rtosHeapMinFree)
+        {
+            rtosHeapMinFree = row.rtosHeapMinFree_;
+        }
+
+        if (row.newlibHeap_ > newlibHeapPeak)
+        {
+            newlibHeapPeak = row.newlibHeap_;
+        }
+
+        if (row.sbrkFailures_ > sbrkFailures)
+        {
+            sbrkFailures = row.sbrkFailures_;
+        }
+
+        int task = 0;
+
+        while (task < taskCount && strcmp(tasks[task].name_, row.name_) != 0)
+        {
+            task++;
+        }
+
+        if (task == taskCount)
+        {
+            if (taskCount == MEMORY_STATS_MAX_TASKS)
+            {
+                continue;
+            }
+
+            tasks[taskCount++] = row;
+        }
+
+        // High water marks only go down, but keep the deepest in case the log spans a reboot
+        if (row.minFreeWords_ < tasks[task].minFreeWords_ || row.stackWords_ != tasks[task].stackWords_)
+        {
+            tasks[task] = row;
+        }
+
+        if (row.recommendedWords_ > tasks[task].recommendedWords_)
+        {
+            tasks[task].recommendedWords_ = row.recommendedWords_;
+        }
+    }
+
+    fclose(in);
+
+    if (taskCount == 0)
+    {
+        fprintf(stderr, "%s has no memory stats rows\n", path);
+        return 1;
+    }
+
+    printMemoryTable(tasks, taskCount);
+    printHeapSummary(&last, rtosHeapMinFree, newlibHeapPeak, sbrkFailures);
+    return 0;
+}
+
+static uint16_t readUint16(const uint8_t* data)
+{
+    return (uint16_t) ((data[0] << 8) | data[1]);
+}
+
+static uint32_t readUint32(const uint8_t* data)
+{
+    return ((uint32_t) data[0] << 24) | ((uint32_t) data[1] << 16) | ((uint32_t) data[2] << 8) | data[3];
+}
+
+static int messageSize(uint8_t header)
+{
+    switch (header)
+    {
+        case TASK_STATS_HEADER_BYTE:
+            return TASK_STATS_SERIAL_MSG_SIZE;
+
+        case MEMORY_STATS_HEADER_BYTE:
+            return MEMORY_STATS_SERIAL_MSG_SIZE;
+
+        case ISR_STATS_HEADER_BYTE:
+            return ISR_STATS_SERIAL_MSG_SIZE;
+
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Undoes the byte stuffing of encodeMessage in TransmitData.c for one task,
+ * memory or ISR stats message starting after the start flag. The CRC is not
+ * stuffed and is not checked, only the framing.
+ *
+ * @return  Number of input bytes used, or 0 if this is not a complete message.
+ */
+static size_t decodeMessage(const uint8_t* data, size_t length, uint8_t* message)
+{
+    size_t in = 0;
+    int out = 0;
+    // Other messages are skipped as soon as their header byte is seen
+    int size = length > 0 ? messageSize(data[0]) : 0;
+
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    while (out < size && in < length)
+    {
+        uint8_t byte = data[in++];
+
+        if (byte == ESCAPE)
+        {
+            if (in == length || (data[in] != F0_REPLACEMENT && data[in] != F1_REPLACEMENT))
+            {
+                return 0;
+            }
+
+            byte = data[in++] == F0_REPLACEMENT ? START_FLAG : ESCAPE;
+        }
+        else if (byte == START_FLAG)
+        {
+            return 0;
+        }
+
+        message[out++] = byte;
+    }
+
+    if (out < size || in + CRC_SIZE >= length || data[in + CRC_SIZE] != END_FLAG)
+    {
+        return 0;
+    }
+
+    return in + CRC_SIZE + 1;
+}
+
+static int viewTelemetry(const char* path)
+{
+    TaskRow rows[TASK_STATS_MAX_TASKS];
+    MemoryRow memoryRows[MEMORY_STATS_MAX_TASKS];
+    IsrRow isrRows[ISR_STATS_COUNT];
+    uint8_t message[MAX_SERIAL_MSG_SIZE];
+    unsigned long messages = 0;
+    unsigned long memoryMessages = 0;
+    unsigned long isrMessages = 0;
+    int memoryTaskCount = 0;
+    int isrCount = 0;
+    unsigned long rounds = 0;
+    int received = 0;
+    uint32_t cpuLoadPermille = 0;
+
+    FILE* in = fopen(path, "rb");
+
+    if (!in)
+    {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return 1;
+    }
+
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    uint8_t* data = malloc(size > 0 ? size : 1);
+
+    if (!data || fread(data, 1, size, in) != (size_t) size)
+    {
+        fprintf(stderr, "Cannot read %s\n", path);
+        fclose(in);
+        free(data);
+        return 1;
+    }
+
+    fclose(in);
+
+    for (size_t i = 0; i + 1 < (size_t) size; i++)
+    {
+        if (data[i] != START_FLAG)
+        {
+            continue;
+        }
+
+        size_t used = decodeMessage(data + i + 1, size - i - 1, message);
+
+        if (used == 0)
+        {
+            continue;
+        }
+
+        i += used;
+
+        int task = message[1];
+        int taskCount = message[2];
+
+        if (message[0] == ISR_STATS_HEADER_BYTE)
+        {
+            // The handler table is compiled in, a different count is another build
+            if (task >= taskCount || taskCount != ISR_STATS_COUNT)
+            {
+                continue;
+            }
+
+            IsrRow* row = &isrRows[task];
+            uint16_t latencyUs = readUint16(message + 18);
+            snprintf(row->name_, TASK_NAME_SIZE, "%s", ISR_NAMES[task]);
+            row->coreClockHz_ = message[3] * 1000000u;
+            row->budgetUs_ = readUint16(message + 4);
+            row->calls_ = readUint32(message + 6);
+            row->maxCycles_ = readUint32(message + 10);
+            row->avgCycles_ = readUint32(message + 14);
+            row->maxLatencyUs_ = latencyUs == UINT16_MAX ? ISR_STATS_NO_LATENCY : latencyUs;
+            row->maxDepth_ = message[20];
+            row->budgetOverruns_ = readUint16(message + 21);
+            row->nestedCalls_ = UINT32_MAX;
+
+            if (task == isrCount && isrCount < taskCount)
+            {
+                isrCount++;
+            }
+
+            isrMessages++;
+            continue;
+        }
+
+        if (message[0] == MEMORY_STATS_HEADER_BYTE)
+        {
+            if (task >= taskCount || taskCount > MEMORY_STATS_MAX_TASKS)
+            {
+                continue;
+            }
+
+            MemoryRow* row = &memoryRows[task];
+            snprintf(row->name_, TASK_NAME_SIZE, "%s", task < (int) (sizeof(TASK_NAMES) / sizeof(TASK_NAMES[0])) ? TASK_NAMES[task] : "?");
+            row->stackWords_ = readUint16(message + 3);
+            row->minFreeWords_ = readUint16(message + 5);
+            row->recommendedWords_ = readUint16(message + 7);
+            row->rtosHeapFree_ = readUint32(message + 9);
+            row->rtosHeapMinFree_ = readUint32(message + 13);
+            row->newlibHeap_ = readUint32(message + 17);
+            row->sbrkFailures_ = readUint16(message + 21);
+
+            // Tasks 0 to memoryTaskCount - 1 have all been received at least once
+            if (task == memoryTaskCount && memoryTaskCount < taskCount)
+            {
+                memoryTaskCount++;
+            }
+
+            memoryMessages++;
+            continue;
+        }
+
+        messages++;
+
+        if (task >= taskCount || taskCount > TASK_STATS_MAX_TASKS)
+        {
+            continue;
+        }
+
+        // A new round starts at task 0, print the previous one if it was complete
+        if (task == 0)
+        {
+            if (received == taskCount)
+            {
+                printf("\nRound %lu, CPU load %.1f %%\n", ++rounds, cpuLoadPermille / 10.0);
+                printf("%-36s %7s %6s %9s %9s %9s %8s\n", "Task", "Period", "CPU %", "Min us", "Avg us", "Max us", "Misses");
+
+                for (int t = 0; t < taskCount; t++)
+                {
+                    printf(
+                        "%-36s %7lu %6.1f %9lu %9lu %9lu %8lu\n",
+                        t < (int) (sizeof(TASK_NAMES) / sizeof(TASK_NAMES[0])) ? TASK_NAMES[t] : "?",
+                        (unsigned long) rows[t].periodMs_,
+                        rows[t].cpuPermille_ / 10.0,
+                        (unsigned long) rows[t].minJobUs_,
+                        (unsigned long) rows[t].avgJobUs_,
+                        (unsigned long) rows[t].maxJobUs_,
+                        (unsigned long) rows[t].deadlineMisses_
+                    );
+                }
+            }
+
+            received = 0;
+        }
+
+        if (task != received)
+        {
+            // Lost a message, wait for the next round
+            received = -1;
+            continue;
+        }
+
+        TaskRow* row = &rows[task];
+        memset(row, 0, sizeof(TaskRow));
+        cpuLoadPermille = readUint16(message + 3);
+        row->cpuPermille_ = readUint16(message + 5);
+        row->periodMs_ = readUint16(message + 7);
+        row->minJobUs_ = readUint32(message + 9);
+        row->avgJobUs_ = readUint32(message + 13);
+        row->maxJobUs_ = readUint32(message + 17);
+        row->deadlineMisses_ = readUint16(message + 21);
+        received++;
+    }
+
+    free(data);
+
+    if (memoryTaskCount > 0)
+    {
+        printf("\nMemory, last report per task\n");
+        printMemoryTable(memoryRows, memoryTaskCount);
+        printHeapSummary(&memoryRows[memoryTaskCount - 1], memoryRows[memoryTaskCount - 1].rtosHeapMinFree_, memoryRows[memoryTaskCount - 1].newlibHeap_, memoryRows[memoryTaskCount - 1].sbrkFailures_);
+    }
+
+    if (isrCount > 0)
+    {
+        printf("\nInterrupts, last report per handler\n");
+        printIsrTable(isrRows, isrCount);
+    }
+
+    fprintf(stderr, "%lu task stats messages, %lu complete rounds, %lu memory stats messages, %lu ISR stats messages\n", messages, rounds, memoryMessages, isrMessages);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc == 3 && strcmp(argv[1], "log") == 0)
+    {
+        return viewLog(argv[2]);
+    }
+
+    if (argc == 3 && strcmp(argv[1], "memory") == 0)
+    {
+        return viewMemory(argv[2]);
+    }
+
+    if (argc == 3 && strcmp(argv[1], "isr") == 0)
+    {
+        return viewIsr(argv[2]);
+    }
+
+    if (argc == 3 && strcmp(argv[1], "telemetry") == 0)
+    {
+        return viewTelemetry(argv[2]);
+    }
+
+    fprintf(
+        stderr,
+        "usage: %s log <AvionicsTasksN.csv>\n"
+        "       %s memory <AvionicsMemoryN.csv>\n"
+        "       %s isr <AvionicsIsrN.csv>\n"
+        "       %s telemetry <capture.bin>\n",
+        argv[0],
+        argv[0],
+        argv[0],
+        argv[0]
+    );
+    return 2;
+}
@@ -0,0 +1,594 @@
+/**
+  ******************************************************************************
+  * File Name          : TraceViewer.c
+  * Description        : Host viewer for the trace events (Trace.h), with the
+  *                      end to end latency of each control chain.
+  *
+  *   TraceViewer log <AvionicsTraceN.bin>
+  *       Reads the trace blocks the logger wrote to the SD card.
+  *
+  *   TraceViewer telemetry <capture.bin>
+  *       Picks the trace messages out of a raw radio capture.
+  *
+  *   Both print the number of events of each id, then for every chain the
+  *   latency of each stage and end to end: min, average, max and a
+  *   histogram. A pass through a chain is found from its last event back,
+  *   taking the latest earlier event of each previous stage.
+  ******************************************************************************
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Trace.h"
+
+#define START_FLAG 0xF0
+#define END_FLAG 0xF0
+#define ESCAPE 0xF1
+#define F0_REPLACEMENT 0xF2
+#define F1_REPLACEMENT 0xF3
+#define CRC_SIZE 4
+
+#define MAX_STAGES 4
+#define ANY_ARG -1
+#define SAME_ARG -2 // The arg of the next stage's event
+#define MAX_CHAIN_SPAN_US 10000000 // Passes spread over more than 10 s are not a pass
+#define HISTOGRAM_BINS 12
+// Bin i counts latencies shorter than FIRST_BIN_US << i, the last bin counts all longer ones
+#define FIRST_BIN_US 64
+
+// See main.c and FlightPhase.h
+#define LAUNCH_CMD_BYTE 0x20
+#define ABORT_CMD_BYTE 0x2F
+#define BURN_PHASE 2
+#define ABORT_COMMAND_RECEIVED_PHASE 7
+
+typedef struct
+{
+    int64_t     timeUs_;
+    uint16_t    arg_;
+    uint8_t     id_;
+} Event;
+
+typedef struct
+{
+    TraceId     id_;
+    int         arg_; // ANY_ARG, SAME_ARG or the value the arg must have
+} Stage;
+
+typedef struct
+{
+    const char* name_;
+    int         stageCount_;
+    Stage       stages_[MAX_STAGES];
+    // The first event's arg is the low 16 bits of the sample time, which starts the chain
+    int         startsAtSampleTime_;
+} Chain;
+
+typedef struct
+{
+    uint32_t    count_;
+    int64_t     minUs_;
+    int64_t     maxUs_;
+    int64_t     totalUs_;
+    uint32_t    histogram_[HISTOGRAM_BINS];
+} Latency;
+
+typedef struct
+{
+    Event*      events_;
+    size_t      count_;
+    size_t      capacity_;
+    uint64_t    lost_;
+} EventList;
+
+static const char* const EVENT_NAMES[TRACE_ID_COUNT] =
+{
+    "none",
+    "barometer sample",
+    "filter step",
+    "drogue decision",
+    "drogue gpio",
+    "main decision",
+    "main gpio",
+    "ground command",
+    "flight phase",
+    "injection valve"
+};
+
+static const Chain CHAINS[] =
+{
+    {
+        "barometer to filter", 2,
+        { { TRACE_BAROMETER_SAMPLE, SAME_ARG }, { TRACE_FILTER_STEP, ANY_ARG } },
+        1
+    },
+    {
+        "drogue", 4,
+        { { TRACE_BAROMETER_SAMPLE, SAME_ARG }, { TRACE_FILTER_STEP, ANY_ARG }, { TRACE_DROGUE_DECISION, ANY_ARG }, { TRACE_DROGUE_GPIO, ANY_ARG } },
+        1
+    },
+    {
+        "main", 4,
+        { { TRACE_BAROMETER_SAMPLE, SAME_ARG }, { TRACE_FILTER_STEP, ANY_ARG }, { TRACE_MAIN_DECISION, ANY_ARG }, { TRACE_MAIN_GPIO, ANY_ARG } },
+        1
+    },
+    {
+        "launch", 3,
+        { { TRACE_GROUND_COMMAND, LAUNCH_CMD_BYTE }, { TRACE_FLIGHT_PHASE, BURN_PHASE }, { TRACE_INJECTION_VALVE, 1 } },
+        0
+    },
+    {
+        "abort", 2,
+        { { TRACE_GROUND_COMMAND, ABORT_CMD_BYTE }, { TRACE_FLIGHT_PHASE, ABORT_COMMAND_RECEIVED_PHASE } },
+        0
+    },
+    {
+        "abort in flight", 3,
+        { { TRACE_GROUND_COMMAND, ABORT_CMD_BYTE }, { TRACE_FLIGHT_PHASE, ABORT_COMMAND_RECEIVED_PHASE }, { TRACE_INJECTION_VALVE, 0 } },
+        0
+    }
+};
+
+#define CHAIN_COUNT (sizeof(CHAINS) / sizeof(CHAINS[0]))
+
+static const char* eventName(int id)
+{
+    return id < TRACE_ID_COUNT ? EVENT_NAMES[id] : "unknown";
+}
+
+static void addEvent(EventList* list, int64_t timeUs, uint16_t arg, uint8_t id)
+{
+    if (list->count_ == list->capacity_)
+    {
+        list->capacity_ = list->capacity_ ? list->capacity_ * 2 : 1024;
+        list->events_ = realloc(list->events_, list->capacity_ * sizeof(Event));
+
+        if (!list->events_)
+        {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+    }
+
+    Event* event = &list->events_[list->count_++];
+    event->timeUs_ = timeUs;
+    event->arg_ = arg;
+    event->id_ = id;
+}
+
+/**
+ * Microseconds of a cycle count from the sync point of its block. Events
+ * are at most a few seconds from the sync point, well within the 25 s
+ * wrap of the cycle counter.
+ */
+static int64_t eventTimeUs(uint32_t cycles, uint32_t syncCycles, int64_t syncUs, uint32_t coreClockHz)
+{
+    int32_t sinceSync = (int32_t) (cycles - syncCycles);
+    return syncUs + (int64_t) sinceSync * 1000000 / coreClockHz;
+}
+
+static int compareEvents(const void* a, const void* b)
+{
+    int64_t timeA = ((const Event*) a)->timeUs_;
+    int64_t timeB = ((const Event*) b)->timeUs_;
+
+    return (timeA > timeB) - (timeA < timeB);
+}
+
+static void addLatency(Latency* latency, int64_t us)
+{
+    if (latency->count_ == 0 || us < latency->minUs_)
+    {
+        latency->minUs_ = us;
+    }
+
+    if (latency->count_ == 0 || us > latency->maxUs_)
+    {
+        latency->maxUs_ = us;
+    }
+
+    latency->count_++;
+    latency->totalUs_ += us;
+
+    int bin = 0;
+
+    while (bin < HISTOGRAM_BINS - 1 && us >= (int64_t) FIRST_BIN_US << bin)
+    {
+        bin++;
+    }
+
+    latency->histogram_[bin]++;
+}
+
+static int stageMatches(const Stage* stage, const Event* event, const Event* next)
+{
+    if (event->id_ != stage->id_)
+    {
+        return 0;
+    }
+
+    if (stage->arg_ == SAME_ARG)
+    {
+        return next && event->arg_ == next->arg_;
+    }
+
+    return stage->arg_ == ANY_ARG || event->arg_ == stage->arg_;
+}
+
+static void printLatencyHeader(void)
+{
+    printf("%-36s %6s %9s %9s %9s", "Stage", "passes", "min(us)", "avg(us)", "max(us)");
+
+    for (int bin = 0; bin < HISTOGRAM_BINS; bin++)
+    {
+        char label[16];
+        snprintf(label, sizeof(label), "%s%lu", bin < HISTOGRAM_BINS - 1 ? "<" : ">=", (unsigned long) FIRST_BIN_US << (bin < HISTOGRAM_BINS - 1 ? bin : bin - 1));
+        printf(" %7s", label);
+    }
+
+    printf("\n");
+}
+
+static void printLatency(const char* name, const Latency* latency)
+{
+    printf("%-36s %6lu", name, (unsigned long) latency->count_);
+
+    if (latency->count_ == 0)
+    {
+        printf("\n");
+        return;
+    }
+
+    printf(
+        " %9lld %9lld %9lld",
+        (long long) latency->minUs_,
+        (long long) (latency->totalUs_ / latency->count_),
+        (long long) latency->maxUs_
+    );
+
+    for (int bin = 0; bin < HISTOGRAM_BINS; bin++)
+    {
+        printf(" %7.1f", 100.0 * latency->histogram_[bin] / latency->count_);
+    }
+
+    printf("\n");
+}
+
+static void printChain(const Chain* chain, const EventList* list)
+{
+    // Stage latencies, plus the sample time to the first event, plus end to end
+    Latency latencies[MAX_STAGES + 1];
+    memset(latencies, 0, sizeof(latencies));
+
+    for (size_t last = 0; last < list->count_; last++)
+    {
+        const Event* pass[MAX_STAGES];
+        int stage = chain->stageCount_ - 1;
+
+        if (!stageMatches(&chain->stages_[stage], &list->events_[last], NULL))
+        {
+            continue;
+        }
+
+        pass[stage] = &list->events_[last];
+
+        for (size_t i = last; i-- > 0 && stage > 0;)
+        {
+            const Event* event = &list->events_[i];
+
+            if (pass[chain->stageCount_ - 1]->timeUs_ - event->timeUs_ > MAX_CHAIN_SPAN_US)
+            {
+                break;
+            }
+
+            if (stageMatches(&chain->stages_[stage - 1], event, pass[stage]))
+            {
+                pass[--stage] = event;
+            }
+        }
+
+        if (stage > 0)
+        {
+            continue;
+        }
+
+        int64_t startUs = pass[0]->timeUs_;
+
+        if (chain->startsAtSampleTime_)
+        {
+            // Latest time at or before the first event with these low 16 bits
+            startUs -= (uint16_t) ((uint16_t) pass[0]->timeUs_ - pass[0]->arg_);
+            addLatency(&latencies[0], pass[0]->timeUs_ - startUs);
+        }
+
+        for (int i = 1; i < chain->stageCount_; i++)
+        {
+            addLatency(&latencies[i], pass[i]->timeUs_ - pass[i - 1]->timeUs_);
+        }
+
+        addLatency(&latencies[chain->stageCount_], pass[chain->stageCount_ - 1]->timeUs_ - startUs);
+    }
+
+    printf("\nChain: %s, %% of passes per bin\n", chain->name_);
+    printLatencyHeader();
+
+    if (chain->startsAtSampleTime_)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "sample -> %s", eventName(chain->stages_[0].id_));
+        printLatency(name, &latencies[0]);
+    }
+
+    for (int i = 1; i < chain->stageCount_; i++)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "%s -> %s", eventName(chain->stages_[i - 1].id_), eventName(chain->stages_[i].id_));
+        printLatency(name, &latencies[i]);
+    }
+
+    printLatency("end to end", &latencies[chain->stageCount_]);
+}
+
+static void printReport(EventList* list)
+{
+    uint32_t counts[TRACE_ID_COUNT + 1] = { 0 };
+
+    qsort(list->events_, list->count_, sizeof(Event), compareEvents);
+
+    for (size_t i = 0; i < list->count_; i++)
+    {
+        counts[list->events_[i].id_ < TRACE_ID_COUNT ? list->events_[i].id_ : TRACE_ID_COUNT]++;
+    }
+
+    printf("%-36s %8s\n", "Event", "count");
+
+    for (int id = 1; id <= TRACE_ID_COUNT; id++)
+    {
+        if (id < TRACE_ID_COUNT || counts[id] != 0)
+        {
+            printf("%-36s %8lu\n", eventName(id), (unsigned long) counts[id]);
+        }
+    }
+
+    printf("%-36s %8llu\n", "lost", (unsigned long long) list->lost_);
+
+    if (list->count_ > 0)
+    {
+        printf(
+            "%.3f s to %.3f s\n",
+            list->events_[0].timeUs_ / 1e6,
+            list->events_[list->count_ - 1].timeUs_ / 1e6
+        );
+    }
+
+    for (size_t i = 0; i < CHAIN_COUNT; i++)
+    {
+        printChain(&CHAINS[i], list);
+    }
+}
+
+static uint8_t* readFile(const char* path, long* size)
+{
+    FILE* in = fopen(path, "rb");
+
+    if (!in)
+    {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return NULL;
+    }
+
+    fseek(in, 0, SEEK_END);
+    *size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    uint8_t* data = malloc(*size > 0 ? *size : 1);
+
+    if (!data || fread(data, 1, *size, in) != (size_t) *size)
+    {
+        fprintf(stderr, "Cannot read %s\n", path);
+        fclose(in);
+        free(data);
+        return NULL;
+    }
+
+    fclose(in);
+    return data;
+}
+
+static int viewLog(const char* path)
+{
+    EventList list = { 0 };
+    long size;
+    long offset = 0;
+    unsigned long blocks = 0;
+    uint8_t* data = readFile(path, &size);
+
+    if (!data)
+    {
+        return 2;
+    }
+
+    while (offset + (long) sizeof(TraceBlockHeader) <= size)
+    {
+        TraceBlockHeader header;
+        memcpy(&header, data + offset, sizeof(header));
+
+        if (header.magic_ != TRACE_BLOCK_MAGIC || header.coreClockHz_ == 0)
+        {
+            fprintf(stderr, "Bad block at offset %ld\n", offset);
+            break;
+        }
+
+        offset += sizeof(header);
+
+        if (offset + (long) (header.count_ * sizeof(TraceEvent)) > size)
+        {
+            fprintf(stderr, "Truncated block at offset %ld\n", offset);
+            break;
+        }
+
+        for (uint32_t i = 0; i < header.count_; i++)
+        {
+            TraceEvent event;
+            memcpy(&event, data + offset, sizeof(event));
+            offset += sizeof(event);
+            addEvent(&list, eventTimeUs(event.cycles_, header.syncCycles_, header.syncUs_, header.coreClockHz_), event.arg_, event.id_);
+        }
+
+        list.lost_ += header.lost_;
+        blocks++;
+    }
+
+    free(data);
+    printReport(&list);
+    fprintf(stderr, "%lu blocks, %lu events\n", blocks, (unsigned long) list.count_);
+    free(list.events_);
+    return 0;
+}
+
+static uint16_t readUint16(const uint8_t* data)
+{
+    return (uint16_t) ((data[0] << 8) | data[1]);
+}
+
+static uint32_t readUint32(const uint8_t* data)
+{
+    return ((uint32_t) data[0] << 24) | ((uint32_t) data[1] << 16) | ((uint32_t) data[2] << 8) | data[3];
+}
+
+/**
+ * Undoes the byte stuffing of encodeMessage in TransmitData.c for one
+ * trace message starting after the start flag. The CRC is not stuffed and
+ * is not checked, only the framing.
+ *
+ * @return  Number of input bytes used, or 0 if this is not a complete message.
+ */
+static size_t decodeMessage(const uint8_t* data, size_t length, uint8_t* message)
+{
+    size_t in = 0;
+    int out = 0;
+
+    // Other messages are skipped as soon as their header byte is seen
+    if (length == 0 || data[0] != TRACE_HEADER_BYTE)
+    {
+        return 0;
+    }
+
+    while (out < TRACE_SERIAL_MSG_SIZE && in < length)
+    {
+        uint8_t byte = data[in++];
+
+        if (byte == ESCAPE)
+        {
+            if (in == length || (data[in] != F0_REPLACEMENT && data[in] != F1_REPLACEMENT))
+            {
+                return 0;
+            }
+
+            byte = data[in++] == F0_REPLACEMENT ? START_FLAG : ESCAPE;
+        }
+        else if (byte == START_FLAG)
+        {
+            return 0;
+        }
+
+        message[out++] = byte;
+    }
+
+    if (out < TRACE_SERIAL_MSG_SIZE || in + CRC_SIZE >= length || data[in + CRC_SIZE] != END_FLAG)
+    {
+        return 0;
+    }
+
+    return in + CRC_SIZE + 1;
+}
+
+static int viewTelemetry(const char* path)
+{
+    EventList list = { 0 };
+    uint8_t message[TRACE_SERIAL_MSG_SIZE];
+    unsigned long messages = 0;
+    long size;
+    // The messages only carry the low 32 bits of the sync time
+    uint32_t lastSyncUs = 0;
+    int64_t syncWraps = 0;
+    uint8_t* data = readFile(path, &size);
+
+    if (!data)
+    {
+        return 2;
+    }
+
+    for (size_t i = 0; i + 1 < (size_t) size; i++)
+    {
+        if (data[i] != START_FLAG)
+        {
+            continue;
+        }
+
+        size_t used = decodeMessage(data + i + 1, size - i - 1, message);
+
+        if (used == 0)
+        {
+            continue;
+        }
+
+        i += used;
+
+        int count = message[1];
+        uint32_t syncCycles = readUint32(&message[4]);
+        uint32_t syncUs = readUint32(&message[8]);
+        uint32_t coreClockHz = message[12] * 1000000u;
+
+        if (count > TRACE_SERIAL_MSG_EVENTS || coreClockHz == 0)
+        {
+            continue;
+        }
+
+        if (messages > 0 && syncUs < lastSyncUs)
+        {
+            syncWraps++;
+        }
+
+        lastSyncUs = syncUs;
+        list.lost_ += readUint16(&message[2]);
+
+        for (int event = 0; event < count; event++)
+        {
+            const uint8_t* field = &message[13 + event * 7];
+            int64_t fullSyncUs = (syncWraps << 32) | syncUs;
+            addEvent(&list, eventTimeUs(readUint32(field), syncCycles, fullSyncUs, coreClockHz), readUint16(field + 4), field[6]);
+        }
+
+        messages++;
+    }
+
+    free(data);
+    printReport(&list);
+    fprintf(stderr, "%lu trace messages, %lu events\n", messages, (unsigned long) list.count_);
+    free(list.events_);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc == 3 && strcmp(argv[1], "log") == 0)
+    {
+        return viewLog(argv[2]);
+    }
+
+    if (argc == 3 && strcmp(argv[1], "telemetry") == 0)
+    {
+        return viewTelemetry(argv[2]);
+    }
+
+    fprintf(
+        stderr,
+        "usage: %s log <AvionicsTraceN.bin>\n"
+        "       %s telemetry <capture.bin>\n",
+        argv[0],
+        argv[0]
+    );
+    return 2;
+}
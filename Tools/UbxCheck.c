@@ -0,0 +1,358 @@
+/**
+  ******************************************************************************
+  * File Name          : UbxCheck.c
+  * Description        : Host checks of the UBX parser and configuration
+  *                      frames (Ubx.h).
+  *
+  *   UbxCheck check
+  *       Compares the configuration frames with the bytes given in the
+  *       u-blox protocol description and decodes a NAV-PVT and the
+  *       acknowledgements field by field, across a stream with noise,
+  *       repeated sync characters, corrupted and overlong frames.
+  *
+  *   UbxCheck fuzz [iterations] [seed]
+  *       Feeds valid frames between random bytes and mutated frames. Every
+  *       frame the parser hands out must have the length it announced, and
+  *       the valid frame after the garbage must still come out intact.
+  *       Run from the sanitized build by "make check".
+  ******************************************************************************
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Ubx.h"
+
+#define FUZZ_DEFAULT_ITERATIONS 200000
+#define MAX_STREAM 2048
+
+typedef struct
+{
+    int         frames_;
+    int         unsupported_;
+    int         checksumErrors_;
+    int         formatErrors_;
+    UbxFrame    last_;
+} FeedResult;
+
+static int failures = 0;
+
+static void feed(UbxParser* parser, const uint8_t* bytes, size_t length, FeedResult* result)
+{
+    UbxFrame frame;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        switch (ubxParse(parser, bytes[i], &frame))
+        {
+            case UBX_OK:
+                result->frames_++;
+                result->last_ = frame;
+                break;
+
+            case UBX_UNSUPPORTED:
+                result->unsupported_++;
+                break;
+
+            case UBX_CHECKSUM_ERROR:
+                result->checksumErrors_++;
+                break;
+
+            case UBX_FORMAT_ERROR:
+                result->formatErrors_++;
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+static void expect(int condition, const char* what)
+{
+    if (!condition)
+    {
+        printf("FAIL %s\n", what);
+        failures++;
+    }
+}
+
+static void expectBytes(const uint8_t* bytes, uint16_t length, const uint8_t* expected, uint16_t expectedLength, const char* what)
+{
+    expect(length == expectedLength && memcmp(bytes, expected, length) == 0, what);
+}
+
+static void put4(uint8_t* bytes, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        bytes[i] = (uint8_t) (value >> (8 * i));
+    }
+}
+
+/**
+ * A NAV-PVT with a distinct value in every decoded field.
+ */
+static uint16_t navPvtFrame(uint8_t* frame)
+{
+    uint8_t payload[UBX_NAV_PVT_LENGTH] = {0};
+
+    put4(&payload[0], 123456789);
+    payload[4] = 0xEA; // 2026
+    payload[5] = 0x07;
+    payload[6] = 10;
+    payload[7] = 18;
+    payload[8] = 17;
+    payload[9] = 28;
+    payload[10] = 14;
+    payload[11] = UBX_VALID_DATE | UBX_VALID_TIME;
+    put4(&payload[16], (uint32_t) -250000);
+    payload[20] = UBX_FIX_3D;
+    payload[21] = UBX_FLAGS_FIX_OK | UBX_FLAGS_DIFFERENTIAL | (2 << UBX_FLAGS_CARRIER_SHIFT);
+    payload[23] = 14;
+    put4(&payload[24], (uint32_t) -1220378267);
+    put4(&payload[28], 373910983);
+    put4(&payload[32], 1375331);
+    put4(&payload[36], 1401000);
+    put4(&payload[40], 1500);
+    put4(&payload[44], 2500);
+    put4(&payload[48], (uint32_t) -12);
+    put4(&payload[52], 34);
+    put4(&payload[56], (uint32_t) -305000);
+    put4(&payload[60], 36);
+    put4(&payload[64], 10950000);
+    put4(&payload[68], 300);
+    payload[76] = 130;
+    return ubxBuildFrame(UBX_CLASS_NAV, UBX_NAV_PVT, payload, sizeof(payload), frame);
+}
+
+static int check(void)
+{
+    // From the u-blox M8 receiver description
+    static const uint8_t CFG_PRT[] =
+    {
+        0xB5, 0x62, 0x06, 0x00, 0x14, 0x00, 0x01, 0x00, 0x00, 0x00, 0xD0, 0x08, 0x00, 0x00,
+        0x00, 0xC2, 0x01, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0xB8, 0x42
+    };
+    static const uint8_t CFG_RATE[] = {0xB5, 0x62, 0x06, 0x08, 0x06, 0x00, 0x64, 0x00, 0x01, 0x00, 0x01, 0x00, 0x7A, 0x12};
+    static const uint8_t CFG_MSG[] = {0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0x01, 0x07, 0x01, 0x13, 0x51};
+    static const uint8_t ACK_ACK_RATE[] = {0xB5, 0x62, 0x05, 0x01, 0x02, 0x00, 0x06, 0x08, 0x16, 0x3F};
+    static const uint8_t ACK_NAK_MSG[] = {0xB5, 0x62, 0x05, 0x00, 0x02, 0x00, 0x06, 0x01, 0x0E, 0x33};
+    // $GPGGA then a repeated sync character before a frame
+    static const uint8_t NOISE[] = {'$', 'G', 'P', 'G', 'G', 'A', ',', 0x00, 0xFF, 0xB5, 0x13, 0xB5, 0xB5};
+
+    uint8_t frame[UBX_FRAME_OVERHEAD + UBX_MAX_SKIPPED_LENGTH];
+    uint8_t stream[MAX_STREAM];
+    uint16_t length;
+    size_t streamLength = 0;
+    UbxParser parser;
+    FeedResult result;
+    UbxNavPvt pvt;
+    UbxAck ack;
+
+    length = ubxCfgPrt(115200, UBX_PROTOCOL_UBX, UBX_PROTOCOL_UBX, frame);
+    expectBytes(frame, length, CFG_PRT, sizeof(CFG_PRT), "CFG-PRT 115200 UBX only");
+    length = ubxCfgRate(100, frame);
+    expectBytes(frame, length, CFG_RATE, sizeof(CFG_RATE), "CFG-RATE 100 ms");
+    length = ubxCfgMsg(UBX_CLASS_NAV, UBX_NAV_PVT, 1, frame);
+    expectBytes(frame, length, CFG_MSG, sizeof(CFG_MSG), "CFG-MSG NAV-PVT 1");
+
+    // Noise, NAV-PVT, acknowledgement
+    ubxInit(&parser);
+    memset(&result, 0, sizeof(result));
+    memcpy(stream, NOISE, sizeof(NOISE));
+    streamLength = sizeof(NOISE) - 1; // The last sync character starts the frame
+    streamLength += navPvtFrame(&stream[streamLength]);
+    feed(&parser, stream, streamLength, &result);
+    expect(result.frames_ == 1 && result.checksumErrors_ == 0, "NAV-PVT after noise is received");
+    expect(ubxDecodeNavPvt(&result.last_, &pvt), "NAV-PVT decodes");
+    expect(!ubxDecodeAck(&result.last_, &ack), "NAV-PVT is not an acknowledgement");
+    expect(pvt.iTow_ == 123456789, "NAV-PVT iTOW");
+    expect(pvt.year_ == 2026 && pvt.month_ == 10 && pvt.day_ == 18, "NAV-PVT date");
+    expect(pvt.hour_ == 17 && pvt.minute_ == 28 && pvt.second_ == 14 && pvt.nano_ == -250000, "NAV-PVT time");
+    expect(pvt.valid_ == (UBX_VALID_DATE | UBX_VALID_TIME), "NAV-PVT valid");
+    expect(pvt.fixType_ == UBX_FIX_3D && pvt.satellites_ == 14, "NAV-PVT fix");
+    expect(pvt.flags_ == (UBX_FLAGS_FIX_OK | UBX_FLAGS_DIFFERENTIAL | (2 << UBX_FLAGS_CARRIER_SHIFT)), "NAV-PVT flags");
+    expect(pvt.longitude_ == -1220378267 && pvt.latitude_ == 373910983, "NAV-PVT position");
+    expect(pvt.height_ == 1375331 && pvt.heightMsl_ == 1401000, "NAV-PVT height");
+    expect(pvt.horizontalAccuracy_ == 1500 && pvt.verticalAccuracy_ == 2500, "NAV-PVT accuracy");
+    expect(pvt.velocityNorth_ == -12 && pvt.velocityEast_ == 34 && pvt.velocityDown_ == -305000, "NAV-PVT velocity");
+    expect(pvt.groundSpeed_ == 36 && pvt.headingMotion_ == 10950000 && pvt.speedAccuracy_ == 300, "NAV-PVT speed");
+    expect(pvt.pdop_ == 130, "NAV-PVT pDOP");
+
+    memset(&result, 0, sizeof(result));
+    feed(&parser, ACK_ACK_RATE, sizeof(ACK_ACK_RATE), &result);
+    expect(result.frames_ == 1 && ubxDecodeAck(&result.last_, &ack), "ACK-ACK decodes");
+    expect(ack.acknowledged_ && ack.class_ == UBX_CLASS_CFG && ack.id_ == UBX_CFG_RATE, "ACK-ACK fields");
+    expect(!ubxDecodeNavPvt(&result.last_, &pvt), "ACK-ACK is not a NAV-PVT");
+
+    memset(&result, 0, sizeof(result));
+    feed(&parser, ACK_NAK_MSG, sizeof(ACK_NAK_MSG), &result);
+    expect(result.frames_ == 1 && ubxDecodeAck(&result.last_, &ack), "ACK-NAK decodes");
+    expect(!ack.acknowledged_ && ack.class_ == UBX_CLASS_CFG && ack.id_ == UBX_CFG_MSG, "ACK-NAK fields");
+
+    // Either checksum byte corrupted, then the parser takes the next frame
+    for (int corrupted = 0; corrupted < 2; corrupted++)
+    {
+        memset(&result, 0, sizeof(result));
+        memcpy(stream, ACK_ACK_RATE, sizeof(ACK_ACK_RATE));
+        stream[sizeof(ACK_ACK_RATE) - 2 + corrupted] ^= 0x01;
+        memcpy(&stream[sizeof(ACK_ACK_RATE)], ACK_NAK_MSG, sizeof(ACK_NAK_MSG));
+        feed(&parser, stream, sizeof(ACK_ACK_RATE) + sizeof(ACK_NAK_MSG), &result);
+        expect(result.checksumErrors_ == 1 && result.frames_ == 1 && result.last_.id_ == UBX_ACK_NAK, "Bad checksum dropped, next frame received");
+    }
+
+    // A payload too long to keep is skipped whole
+    memset(&result, 0, sizeof(result));
+    memset(stream, 0xB5, UBX_MAX_PAYLOAD_LENGTH + 1);
+    length = ubxBuildFrame(0x0A, 0x04, stream, UBX_MAX_PAYLOAD_LENGTH + 1, frame);
+    feed(&parser, frame, length, &result);
+    feed(&parser, ACK_ACK_RATE, sizeof(ACK_ACK_RATE), &result);
+    expect(result.unsupported_ == 1 && result.frames_ == 1 && result.last_.id_ == UBX_ACK_ACK, "Long frame skipped");
+
+    // A length no message has is a false sync
+    static const uint8_t FALSE_SYNC[] = {0xB5, 0x62, 0x01, 0x07, 0xFF, 0x7F};
+    memset(&result, 0, sizeof(result));
+    feed(&parser, FALSE_SYNC, sizeof(FALSE_SYNC), &result);
+    feed(&parser, ACK_ACK_RATE, sizeof(ACK_ACK_RATE), &result);
+    expect(result.formatErrors_ == 1 && result.frames_ == 1, "Impossible length resyncs");
+
+    // Wrong lengths are not decoded
+    UbxFrame shortPvt = {UBX_CLASS_NAV, UBX_NAV_PVT, UBX_NAV_PVT_LENGTH - 8};
+    UbxFrame longAck = {UBX_CLASS_ACK, UBX_ACK_ACK, UBX_ACK_LENGTH + 2};
+    expect(!ubxDecodeNavPvt(&shortPvt, &pvt), "Short NAV-PVT rejected");
+    expect(!ubxDecodeAck(&longAck, &ack), "Long acknowledgement rejected");
+
+    printf("%s: %d failures\n", failures ? "FAILED" : "passed", failures);
+    return failures ? 1 : 0;
+}
+
+/* Fuzzer --------------------------------------------------------------------*/
+
+static uint32_t state = 1;
+
+static uint32_t random32(void)
+{
+    // xorshift32
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static int fuzz(long iterations, uint32_t seed)
+{
+    uint8_t valid[UBX_FRAME_OVERHEAD + UBX_NAV_PVT_LENGTH];
+    uint16_t validLength = navPvtFrame(valid);
+    uint8_t stream[MAX_STREAM];
+    UbxParser parser;
+    UbxFrame frame;
+    long received = 0;
+    long recovered = 0;
+
+    state = seed ? seed : 1;
+    ubxInit(&parser);
+
+    for (long i = 0; i < iterations; i++)
+    {
+        size_t length = 0;
+        int mode = random32() % 3;
+
+        if (mode == 0)
+        {
+            // Random bytes, sync characters are frequent
+            size_t count = random32() % 64;
+
+            for (size_t j = 0; j < count; j++)
+            {
+                uint32_t r = random32();
+                stream[length++] = (r & 0x300) == 0 ? (r & 0x400 ? UBX_SYNC_1 : UBX_SYNC_2) : (uint8_t) r;
+            }
+        }
+        else
+        {
+            // A mutated frame, or one cut short
+            memcpy(stream, valid, validLength);
+            length = validLength;
+
+            if (mode == 1)
+            {
+                int flips = 1 + random32() % 4;
+
+                for (int j = 0; j < flips; j++)
+                {
+                    stream[random32() % length] ^= (uint8_t) (1 + random32() % 255);
+                }
+            }
+            else
+            {
+                length = random32() % validLength;
+            }
+        }
+
+        for (size_t j = 0; j < length; j++)
+        {
+            if (ubxParse(&parser, stream[j], &frame) == UBX_OK)
+            {
+                received++;
+
+                if (frame.length_ > UBX_MAX_PAYLOAD_LENGTH)
+                {
+                    printf("FAIL iteration %ld: frame of %u bytes handed out\n", i, frame.length_);
+                    return 1;
+                }
+            }
+        }
+
+        // Zeros end any frame still open without starting one, the parser is idle in state 0
+        for (int j = 0; j < UBX_FRAME_OVERHEAD + UBX_MAX_SKIPPED_LENGTH && parser.state_ != 0; j++)
+        {
+            if (ubxParse(&parser, 0x00, &frame) == UBX_OK)
+            {
+                received++;
+            }
+        }
+
+        // Then a valid frame must come out intact
+        int intact = 0;
+        UbxNavPvt pvt;
+
+        for (uint16_t j = 0; j < validLength; j++)
+        {
+            if (ubxParse(&parser, valid[j], &frame) == UBX_OK && j == validLength - 1)
+            {
+                intact = ubxDecodeNavPvt(&frame, &pvt) && pvt.latitude_ == 373910983 && pvt.velocityDown_ == -305000;
+            }
+        }
+
+        if (!intact)
+        {
+            printf("FAIL iteration %ld: valid frame after garbage not received\n", i);
+            return 1;
+        }
+
+        recovered++;
+    }
+
+    printf("passed: %ld iterations, %ld frames received, %ld recoveries\n", iterations, received, recovered);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc >= 2 && strcmp(argv[1], "check") == 0)
+    {
+        return check();
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "fuzz") == 0)
+    {
+        long iterations = argc >= 3 ? atol(argv[2]) : FUZZ_DEFAULT_ITERATIONS;
+        uint32_t seed = argc >= 4 ? (uint32_t) strtoul(argv[3], NULL, 0) : 1;
+        return fuzz(iterations, seed);
+    }
+
+    fprintf(stderr, "Usage: %s check | fuzz [iterations] [seed]\n", argv[0]);
+    return 2;
+}